@@ -0,0 +1,289 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/micro/kernels/conv.h"
+
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/kernels/internal/common.h"
+#include "tensorflow/lite/kernels/internal/quantization_util.h"
+#include "tensorflow/lite/kernels/internal/reference/conv.h"
+#include "tensorflow/lite/kernels/internal/reference/integer_ops/conv.h"
+#include "tensorflow/lite/kernels/internal/tensor_ctypes.h"
+#include "tensorflow/lite/kernels/kernel_util.h"
+#include "tensorflow/lite/kernels/padding.h"
+#include "tensorflow/lite/micro/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/kernels/riscv/riscv_kernels.h"
+
+namespace tflite {
+namespace {
+
+struct OpData {
+    // First, so that ConvPrepare and the reference kernels see an OpDataConv.
+    OpDataConv reference_op_data;
+
+    // bias + input_offset * the filter sum per output channel, nullptr when
+    // the int8 path does not apply. Filled in Prepare for a constant filter,
+    // in every Eval otherwise.
+    int32_t *bias_sums;
+    bool bias_sums_ready;
+
+    // im2col tile of tile_pixels rows, -1 when a 1x1 conv reads its input in
+    // place.
+    int im2col_index;
+    int tile_pixels;
+};
+
+void *Init(TfLiteContext *context, const char *buffer, size_t length)
+{
+    TFLITE_DCHECK(context->AllocatePersistentBuffer != nullptr);
+    return context->AllocatePersistentBuffer(context, sizeof(OpData));
+}
+
+TfLiteStatus Prepare(TfLiteContext *context, TfLiteNode *node)
+{
+    TF_LITE_ENSURE_STATUS(ConvPrepare(context, node));
+
+    OpData *data = static_cast<OpData *>(node->user_data);
+    const auto &params =
+        *(static_cast<const TfLiteConvParams *>(node->builtin_data));
+    data->bias_sums = nullptr;
+    data->bias_sums_ready = false;
+    data->im2col_index = -1;
+
+    const TfLiteTensor *input = GetInput(context, node, kConvInputTensor);
+    const TfLiteTensor *filter = GetInput(context, node, kConvWeightsTensor);
+    const TfLiteTensor *bias =
+        GetOptionalInputTensor(context, node, kConvBiasTensor);
+    const TfLiteTensor *output = GetOutput(context, node, kConvOutputTensor);
+    if (input->type != kTfLiteInt8 ||
+        filter->dims->data[3] != input->dims->data[3]) {
+        return kTfLiteOk;
+    }
+
+    const int output_depth = filter->dims->data[kConvQuantizedDimension];
+    const int input_depth = input->dims->data[3];
+    const int depth = filter->dims->data[1] * filter->dims->data[2] * input_depth;
+    const int pixels = output->dims->data[1] * output->dims->data[2];
+    data->bias_sums = static_cast<int32_t *>(context->AllocatePersistentBuffer(
+        context, output_depth * sizeof(int32_t)));
+    TF_LITE_ENSURE(context, data->bias_sums != nullptr);
+    if (IsConstantTensor(filter) && (bias == nullptr || IsConstantTensor(bias))) {
+        riscv::BiasSumsInt8(GetTensorData<int8_t>(filter), output_depth, depth,
+                            bias != nullptr ? GetTensorData<int32_t>(bias) : nullptr,
+                            -data->reference_op_data.input_zero_point,
+                            data->bias_sums);
+        data->bias_sums_ready = true;
+    }
+
+    // As many output pixels as fit TFLM_RISCV_TILE_BYTES of im2col, at least
+    // two for the 2x2 dot products.
+    data->tile_pixels = TFLM_RISCV_TILE_BYTES / depth;
+    data->tile_pixels = data->tile_pixels < 2 ? 2 : data->tile_pixels;
+    data->tile_pixels = data->tile_pixels > pixels ? pixels : data->tile_pixels;
+    const bool in_place = filter->dims->data[1] == 1 &&
+                          filter->dims->data[2] == 1 &&
+                          params.stride_width == 1 && params.stride_height == 1 &&
+                          data->reference_op_data.padding.width == 0 &&
+                          data->reference_op_data.padding.height == 0;
+    if (!in_place) {
+        TF_LITE_ENSURE_STATUS(context->RequestScratchBufferInArena(
+            context, data->tile_pixels * depth, &data->im2col_index));
+    }
+    return kTfLiteOk;
+}
+
+// Rows of the output pixels first..first + count - 1, one tap after the other,
+// the taps outside the image filled with the input zero point, which the
+// input offset turns into 0 like the reference kernel skipping them.
+void Im2col(const ConvParams &params, const RuntimeShape &input_shape,
+            const int8_t *input_data, const RuntimeShape &filter_shape,
+            int output_width, int first, int count, int8_t *col)
+{
+    const int input_height = input_shape.Dims(1);
+    const int input_width = input_shape.Dims(2);
+    const int input_depth = input_shape.Dims(3);
+    const int filter_height = filter_shape.Dims(1);
+    const int filter_width = filter_shape.Dims(2);
+    const int8_t pad_value = static_cast<int8_t>(-params.input_offset);
+    for (int p = first; p < first + count; ++p) {
+        const int in_y_origin = (p / output_width) * params.stride_height -
+                                params.padding_values.height;
+        const int in_x_origin = (p % output_width) * params.stride_width -
+                                params.padding_values.width;
+        for (int filter_y = 0; filter_y < filter_height; ++filter_y) {
+            const int in_y = in_y_origin + params.dilation_height_factor * filter_y;
+            for (int filter_x = 0; filter_x < filter_width; ++filter_x) {
+                const int in_x = in_x_origin + params.dilation_width_factor * filter_x;
+                if (in_y >= 0 && in_y < input_height && in_x >= 0 &&
+                    in_x < input_width) {
+                    memcpy(col, input_data + (in_y * input_width + in_x) * input_depth,
+                           input_depth);
+                } else {
+                    memset(col, pad_value, input_depth);
+                }
+                col += input_depth;
+            }
+        }
+    }
+}
+
+void EvalQuantizedPerChannel(TfLiteContext *context, const TfLiteConvParams &params,
+                             OpData &data, const TfLiteEvalTensor *input,
+                             const TfLiteEvalTensor *filter,
+                             const TfLiteEvalTensor *bias,
+                             TfLiteEvalTensor *output)
+{
+    const ConvParams op_params = ConvParamsQuantized(params, data.reference_op_data);
+    const RuntimeShape input_shape = tflite::micro::GetTensorShape(input);
+    const RuntimeShape filter_shape = tflite::micro::GetTensorShape(filter);
+    const RuntimeShape output_shape = tflite::micro::GetTensorShape(output);
+    const int8_t *input_data = tflite::micro::GetTensorData<int8_t>(input);
+    const int8_t *filter_data = tflite::micro::GetTensorData<int8_t>(filter);
+    int8_t *output_data = tflite::micro::GetTensorData<int8_t>(output);
+
+    const int batches = MatchingDim(input_shape, 0, output_shape, 0);
+    const int input_size = input_shape.Dims(1) * input_shape.Dims(2) * input_shape.Dims(3);
+    const int output_depth = MatchingDim(filter_shape, 0, output_shape, 3);
+    const int output_width = output_shape.Dims(2);
+    const int pixels = output_shape.Dims(1) * output_width;
+    const int depth = filter_shape.Dims(1) * filter_shape.Dims(2) * filter_shape.Dims(3);
+
+    if (!data.bias_sums_ready) {
+        riscv::BiasSumsInt8(filter_data, output_depth, depth,
+                            bias != nullptr ? tflite::micro::GetTensorData<int32_t>(bias) : nullptr,
+                            op_params.input_offset, data.bias_sums);
+    }
+    int8_t *col = data.im2col_index < 0 ? nullptr : static_cast<int8_t *>(context->GetScratchBuffer(context, data.im2col_index));
+
+    for (int batch = 0; batch < batches; ++batch) {
+        const int8_t *batch_input = input_data + batch * input_size;
+        int8_t *batch_output = output_data + batch * pixels * output_depth;
+        for (int first = 0; first < pixels; first += data.tile_pixels) {
+            const int count = pixels - first < data.tile_pixels ? pixels - first : data.tile_pixels;
+            const int8_t *lhs = batch_input + first * depth;
+            if (col != nullptr) {
+                Im2col(op_params, input_shape, batch_input, filter_shape,
+                       output_width, first, count, col);
+                lhs = col;
+            }
+            riscv::GemmInt8(lhs, count, filter_data, output_depth, depth,
+                            data.bias_sums,
+                            data.reference_op_data.per_channel_output_multiplier,
+                            data.reference_op_data.per_channel_output_shift, 1,
+                            op_params.output_offset,
+                            op_params.quantized_activation_min,
+                            op_params.quantized_activation_max,
+                            batch_output + first * output_depth, output_depth);
+        }
+    }
+}
+
+TfLiteStatus Eval(TfLiteContext *context, TfLiteNode *node)
+{
+    const TfLiteEvalTensor *input =
+        tflite::micro::GetEvalInput(context, node, kConvInputTensor);
+    const TfLiteEvalTensor *filter =
+        tflite::micro::GetEvalInput(context, node, kConvWeightsTensor);
+    const TfLiteEvalTensor *bias =
+        (NumInputs(node) == 3) ? tflite::micro::GetEvalInput(context, node, kConvBiasTensor) : nullptr;
+    TfLiteEvalTensor *output =
+        tflite::micro::GetEvalOutput(context, node, kConvOutputTensor);
+
+    TFLITE_DCHECK(node->builtin_data != nullptr);
+    const auto &params =
+        *(reinterpret_cast<TfLiteConvParams *>(node->builtin_data));
+    TFLITE_DCHECK(node->user_data != nullptr);
+    auto &data = *(static_cast<OpData *>(node->user_data));
+
+    TF_LITE_ENSURE_EQ(context, input->type, output->type);
+    TF_LITE_ENSURE_MSG(
+        context,
+        input->type == filter->type ||
+            (input->type == kTfLiteInt16 && filter->type == kTfLiteInt8),
+        "Hybrid models are not supported on TFLite Micro.");
+
+    switch (input->type) { // Already know in/out types are same.
+        case kTfLiteFloat32: {
+            tflite::reference_ops::Conv(
+                ConvParamsFloat(params, data.reference_op_data),
+                tflite::micro::GetTensorShape(input),
+                tflite::micro::GetTensorData<float>(input),
+                tflite::micro::GetTensorShape(filter),
+                tflite::micro::GetTensorData<float>(filter),
+                tflite::micro::GetTensorShape(bias),
+                tflite::micro::GetTensorData<float>(bias),
+                tflite::micro::GetTensorShape(output),
+                tflite::micro::GetTensorData<float>(output),
+                tflite::micro::GetTensorShape(nullptr), nullptr);
+            break;
+        }
+        case kTfLiteInt16: {
+            reference_integer_ops::ConvPerChannel(
+                ConvParamsQuantized(params, data.reference_op_data),
+                data.reference_op_data.per_channel_output_multiplier,
+                data.reference_op_data.per_channel_output_shift,
+                tflite::micro::GetTensorShape(input),
+                tflite::micro::GetTensorData<int16_t>(input),
+                tflite::micro::GetTensorShape(filter),
+                tflite::micro::GetTensorData<int8_t>(filter),
+                tflite::micro::GetTensorShape(bias),
+                tflite::micro::GetTensorData<std::int64_t>(bias),
+                tflite::micro::GetTensorShape(output),
+                tflite::micro::GetTensorData<int16_t>(output));
+            break;
+        }
+        case kTfLiteInt8: {
+            if (data.bias_sums != nullptr) {
+                EvalQuantizedPerChannel(context, params, data, input, filter, bias, output);
+                break;
+            }
+            reference_integer_ops::ConvPerChannel(
+                ConvParamsQuantized(params, data.reference_op_data),
+                data.reference_op_data.per_channel_output_multiplier,
+                data.reference_op_data.per_channel_output_shift,
+                tflite::micro::GetTensorShape(input),
+                tflite::micro::GetTensorData<int8_t>(input),
+                tflite::micro::GetTensorShape(filter),
+                tflite::micro::GetTensorData<int8_t>(filter),
+                tflite::micro::GetTensorShape(bias),
+                tflite::micro::GetTensorData<int32_t>(bias),
+                tflite::micro::GetTensorShape(output),
+                tflite::micro::GetTensorData<int8_t>(output));
+            break;
+        }
+        default:
+            TF_LITE_KERNEL_LOG(context, "Type %s (%d) not supported.",
+                               TfLiteTypeGetName(input->type), input->type);
+            return kTfLiteError;
+    }
+    return kTfLiteOk;
+}
+
+} // namespace
+
+TfLiteRegistration Register_CONV_2D()
+{
+    return { /*init=*/Init,
+             /*free=*/nullptr,
+             /*prepare=*/Prepare,
+             /*invoke=*/Eval,
+             /*profiling_string=*/nullptr,
+             /*builtin_code=*/0,
+             /*custom_name=*/nullptr,
+             /*version=*/0 };
+}
+
+} // namespace tflite
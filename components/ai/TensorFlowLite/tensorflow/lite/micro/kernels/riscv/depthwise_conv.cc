@@ -0,0 +1,233 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/micro/kernels/depthwise_conv.h"
+
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/kernels/internal/common.h"
+#include "tensorflow/lite/kernels/internal/quantization_util.h"
+#include "tensorflow/lite/kernels/internal/reference/depthwiseconv_float.h"
+#include "tensorflow/lite/kernels/internal/reference/integer_ops/depthwise_conv.h"
+#include "tensorflow/lite/kernels/internal/tensor_ctypes.h"
+#include "tensorflow/lite/kernels/kernel_util.h"
+#include "tensorflow/lite/kernels/padding.h"
+#include "tensorflow/lite/micro/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/kernels/riscv/riscv_kernels.h"
+
+namespace tflite {
+namespace {
+
+struct OpData {
+    // First, so that DepthwiseConvPrepare and the reference kernels see an
+    // OpDataConv.
+    OpDataConv reference_op_data;
+
+    // int32 sums of one output pixel, -1 when the int8 path does not apply.
+    int acc_index;
+};
+
+void *Init(TfLiteContext *context, const char *buffer, size_t length)
+{
+    TFLITE_DCHECK(context->AllocatePersistentBuffer != nullptr);
+    return context->AllocatePersistentBuffer(context, sizeof(OpData));
+}
+
+TfLiteStatus Prepare(TfLiteContext *context, TfLiteNode *node)
+{
+    TF_LITE_ENSURE_STATUS(DepthwiseConvPrepare(context, node));
+
+    OpData *data = static_cast<OpData *>(node->user_data);
+    const auto &params =
+        *(static_cast<const TfLiteDepthwiseConvParams *>(node->builtin_data));
+    data->acc_index = -1;
+
+    const TfLiteTensor *input = GetInput(context, node, kDepthwiseConvInputTensor);
+    const TfLiteTensor *output = GetOutput(context, node, kDepthwiseConvOutputTensor);
+    // Output channel ic * depth_multiplier + j reads input channel ic.
+    if (input->type != kTfLiteInt8 ||
+        output->dims->data[3] != input->dims->data[3] * params.depth_multiplier) {
+        return kTfLiteOk;
+    }
+    return context->RequestScratchBufferInArena(
+        context, output->dims->data[3] * sizeof(int32_t), &data->acc_index);
+}
+
+// acc[ic * m + j] += (in[ic] + input_offset) * filter[ic * m + j]: one tap of a
+// depthwise conv with depth multiplier m > 1.
+inline void MacInt8Multiplier(const int8_t *in, const int8_t *filter,
+                              int32_t input_offset, int input_depth, int m,
+                              int32_t *acc)
+{
+    for (int ic = 0; ic < input_depth; ++ic) {
+        const int32_t x = in[ic] + input_offset;
+        for (int j = 0; j < m; ++j) {
+            acc[j] += x * filter[j];
+        }
+        filter += m;
+        acc += m;
+    }
+}
+
+// Per output pixel: the bias, then every tap inside the image as one row of
+// channels, then the output stage.
+void EvalQuantizedPerChannel(TfLiteContext *context,
+                             const TfLiteDepthwiseConvParams &params,
+                             const OpData &data, const TfLiteEvalTensor *input,
+                             const TfLiteEvalTensor *filter,
+                             const TfLiteEvalTensor *bias,
+                             TfLiteEvalTensor *output)
+{
+    const DepthwiseParams op_params =
+        DepthwiseConvParamsQuantized(params, data.reference_op_data);
+    const RuntimeShape input_shape = tflite::micro::GetTensorShape(input);
+    const RuntimeShape filter_shape = tflite::micro::GetTensorShape(filter);
+    const RuntimeShape output_shape = tflite::micro::GetTensorShape(output);
+    const int8_t *input_data = tflite::micro::GetTensorData<int8_t>(input);
+    const int8_t *filter_data = tflite::micro::GetTensorData<int8_t>(filter);
+    const int32_t *bias_data = bias != nullptr ? tflite::micro::GetTensorData<int32_t>(bias) : nullptr;
+    int8_t *output_data = tflite::micro::GetTensorData<int8_t>(output);
+    const int32_t *multiplier = data.reference_op_data.per_channel_output_multiplier;
+    const int32_t *shift = data.reference_op_data.per_channel_output_shift;
+    int32_t *acc = static_cast<int32_t *>(context->GetScratchBuffer(context, data.acc_index));
+
+    const int batches = MatchingDim(input_shape, 0, output_shape, 0);
+    const int depth = MatchingDim(filter_shape, 3, output_shape, 3);
+    const int input_depth = input_shape.Dims(3);
+    const int depth_multiplier = op_params.depth_multiplier;
+    const int input_height = input_shape.Dims(1);
+    const int input_width = input_shape.Dims(2);
+    const int filter_height = filter_shape.Dims(1);
+    const int filter_width = filter_shape.Dims(2);
+    const int output_height = output_shape.Dims(1);
+    const int output_width = output_shape.Dims(2);
+
+    for (int batch = 0; batch < batches; ++batch) {
+        const int8_t *batch_input = input_data + batch * input_height * input_width * input_depth;
+        for (int out_y = 0; out_y < output_height; ++out_y) {
+            const int in_y_origin = out_y * op_params.stride_height - op_params.padding_values.height;
+            for (int out_x = 0; out_x < output_width; ++out_x) {
+                const int in_x_origin = out_x * op_params.stride_width - op_params.padding_values.width;
+                if (bias_data != nullptr) {
+                    memcpy(acc, bias_data, depth * sizeof(int32_t));
+                } else {
+                    memset(acc, 0, depth * sizeof(int32_t));
+                }
+                for (int filter_y = 0; filter_y < filter_height; ++filter_y) {
+                    const int in_y = in_y_origin + op_params.dilation_height_factor * filter_y;
+                    if (in_y < 0 || in_y >= input_height) {
+                        continue;
+                    }
+                    for (int filter_x = 0; filter_x < filter_width; ++filter_x) {
+                        const int in_x = in_x_origin + op_params.dilation_width_factor * filter_x;
+                        if (in_x < 0 || in_x >= input_width) {
+                            continue;
+                        }
+                        const int8_t *in = batch_input + (in_y * input_width + in_x) * input_depth;
+                        const int8_t *f = filter_data + (filter_y * filter_width + filter_x) * depth;
+                        if (depth_multiplier == 1) {
+                            riscv::MacInt8(in, f, op_params.input_offset, depth, acc);
+                        } else {
+                            MacInt8Multiplier(in, f, op_params.input_offset, input_depth,
+                                              depth_multiplier, acc);
+                        }
+                    }
+                }
+                for (int c = 0; c < depth; ++c) {
+                    output_data[c] = riscv::RequantizeInt8(
+                        acc[c], multiplier[c], shift[c], op_params.output_offset,
+                        op_params.quantized_activation_min,
+                        op_params.quantized_activation_max);
+                }
+                output_data += depth;
+            }
+        }
+    }
+}
+
+TfLiteStatus Eval(TfLiteContext *context, TfLiteNode *node)
+{
+    TFLITE_DCHECK(node->user_data != nullptr);
+    TFLITE_DCHECK(node->builtin_data != nullptr);
+
+    auto &params =
+        *(reinterpret_cast<TfLiteDepthwiseConvParams *>(node->builtin_data));
+    const OpData &data = *(static_cast<const OpData *>(node->user_data));
+
+    TfLiteEvalTensor *output =
+        tflite::micro::GetEvalOutput(context, node, kDepthwiseConvOutputTensor);
+    const TfLiteEvalTensor *input =
+        tflite::micro::GetEvalInput(context, node, kDepthwiseConvInputTensor);
+    const TfLiteEvalTensor *filter =
+        tflite::micro::GetEvalInput(context, node, kDepthwiseConvWeightsTensor);
+    const TfLiteEvalTensor *bias =
+        (NumInputs(node) == 3) ? tflite::micro::GetEvalInput(context, node, kDepthwiseConvBiasTensor) : nullptr;
+
+    switch (input->type) { // Already know in/out types are same.
+        case kTfLiteFloat32: {
+            tflite::reference_ops::DepthwiseConv(
+                DepthwiseConvParamsFloat(params, data.reference_op_data),
+                tflite::micro::GetTensorShape(input),
+                tflite::micro::GetTensorData<float>(input),
+                tflite::micro::GetTensorShape(filter),
+                tflite::micro::GetTensorData<float>(filter),
+                tflite::micro::GetTensorShape(bias),
+                tflite::micro::GetTensorData<float>(bias),
+                tflite::micro::GetTensorShape(output),
+                tflite::micro::GetTensorData<float>(output));
+            break;
+        }
+        case kTfLiteInt8: {
+            if (data.acc_index >= 0) {
+                EvalQuantizedPerChannel(context, params, data, input, filter, bias, output);
+                break;
+            }
+            reference_integer_ops::DepthwiseConvPerChannel(
+                DepthwiseConvParamsQuantized(params, data.reference_op_data),
+                data.reference_op_data.per_channel_output_multiplier,
+                data.reference_op_data.per_channel_output_shift,
+                tflite::micro::GetTensorShape(input),
+                tflite::micro::GetTensorData<int8_t>(input),
+                tflite::micro::GetTensorShape(filter),
+                tflite::micro::GetTensorData<int8_t>(filter),
+                tflite::micro::GetTensorShape(bias),
+                tflite::micro::GetTensorData<int32_t>(bias),
+                tflite::micro::GetTensorShape(output),
+                tflite::micro::GetTensorData<int8_t>(output));
+            break;
+        }
+        default:
+            TF_LITE_KERNEL_LOG(context, "Type %s (%d) not supported.",
+                               TfLiteTypeGetName(input->type), input->type);
+            return kTfLiteError;
+    }
+    return kTfLiteOk;
+}
+
+} // namespace
+
+TfLiteRegistration Register_DEPTHWISE_CONV_2D()
+{
+    return { /*init=*/Init,
+             /*free=*/nullptr,
+             /*prepare=*/Prepare,
+             /*invoke=*/Eval,
+             /*profiling_string=*/nullptr,
+             /*builtin_code=*/0,
+             /*custom_name=*/nullptr,
+             /*version=*/0 };
+}
+
+} // namespace tflite
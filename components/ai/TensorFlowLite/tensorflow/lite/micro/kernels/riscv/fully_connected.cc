@@ -0,0 +1,211 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/micro/kernels/fully_connected.h"
+
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/kernels/internal/common.h"
+#include "tensorflow/lite/kernels/internal/quantization_util.h"
+#include "tensorflow/lite/kernels/internal/reference/fully_connected.h"
+#include "tensorflow/lite/kernels/internal/reference/integer_ops/fully_connected.h"
+#include "tensorflow/lite/kernels/internal/tensor_ctypes.h"
+#include "tensorflow/lite/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/kernels/riscv/riscv_kernels.h"
+
+namespace tflite {
+namespace {
+
+struct OpData {
+    OpDataFullyConnected reference_op_data;
+
+    // bias + input_offset * the filter sum per output unit, nullptr when the
+    // int8 path does not apply. Filled in Prepare for a constant filter, in
+    // every Eval otherwise.
+    int32_t *bias_sums;
+    bool bias_sums_ready;
+
+    // Input rows (batches) per GemmInt8 call.
+    int tile_rows;
+};
+
+void *Init(TfLiteContext *context, const char *buffer, size_t length)
+{
+    TFLITE_DCHECK(context->AllocatePersistentBuffer != nullptr);
+    return context->AllocatePersistentBuffer(context, sizeof(OpData));
+}
+
+TfLiteStatus Prepare(TfLiteContext *context, TfLiteNode *node)
+{
+    TFLITE_DCHECK(node->user_data != nullptr);
+    TFLITE_DCHECK(node->builtin_data != nullptr);
+
+    auto *data = static_cast<OpData *>(node->user_data);
+    const auto params =
+        static_cast<const TfLiteFullyConnectedParams *>(node->builtin_data);
+
+    const TfLiteTensor *input =
+        GetInput(context, node, kFullyConnectedInputTensor);
+    TF_LITE_ENSURE(context, input != nullptr);
+    const TfLiteTensor *filter =
+        GetInput(context, node, kFullyConnectedWeightsTensor);
+    TF_LITE_ENSURE(context, filter != nullptr);
+    const TfLiteTensor *bias =
+        GetOptionalInputTensor(context, node, kFullyConnectedBiasTensor);
+    TfLiteTensor *output = GetOutput(context, node, kFullyConnectedOutputTensor);
+    TF_LITE_ENSURE(context, output != nullptr);
+
+    TF_LITE_ENSURE_TYPES_EQ(context, input->type, output->type);
+    TF_LITE_ENSURE_MSG(context, input->type == filter->type,
+                       "Hybrid models are not supported on TFLite Micro.");
+
+    TF_LITE_ENSURE_STATUS(CalculateOpDataFullyConnected(
+        context, params->activation, input->type, input, filter, bias, output,
+        &data->reference_op_data));
+
+    data->bias_sums = nullptr;
+    data->bias_sums_ready = false;
+    if (input->type != kTfLiteInt8 || data->reference_op_data.filter_zero_point != 0 ||
+        output->dims->size != 2) {
+        return kTfLiteOk;
+    }
+    const int units = output->dims->data[1];
+    const int depth = filter->dims->data[filter->dims->size - 1];
+    data->bias_sums = static_cast<int32_t *>(
+        context->AllocatePersistentBuffer(context, units * sizeof(int32_t)));
+    TF_LITE_ENSURE(context, data->bias_sums != nullptr);
+    if (IsConstantTensor(filter) && (bias == nullptr || IsConstantTensor(bias))) {
+        riscv::BiasSumsInt8(GetTensorData<int8_t>(filter), units, depth,
+                            bias != nullptr ? GetTensorData<int32_t>(bias) : nullptr,
+                            -data->reference_op_data.input_zero_point,
+                            data->bias_sums);
+        data->bias_sums_ready = true;
+    }
+    data->tile_rows = TFLM_RISCV_TILE_BYTES / depth;
+    data->tile_rows = data->tile_rows < 1 ? 1 : data->tile_rows;
+    return kTfLiteOk;
+}
+
+void EvalQuantized(OpData &data, const TfLiteEvalTensor *input,
+                   const TfLiteEvalTensor *filter, const TfLiteEvalTensor *bias,
+                   TfLiteEvalTensor *output)
+{
+    const FullyConnectedParams op_params =
+        FullyConnectedParamsQuantized(data.reference_op_data);
+    const RuntimeShape filter_shape = tflite::micro::GetTensorShape(filter);
+    const RuntimeShape output_shape = tflite::micro::GetTensorShape(output);
+    const int8_t *input_data = tflite::micro::GetTensorData<int8_t>(input);
+    const int8_t *filter_data = tflite::micro::GetTensorData<int8_t>(filter);
+    int8_t *output_data = tflite::micro::GetTensorData<int8_t>(output);
+
+    const int batches = output_shape.Dims(0);
+    const int units = output_shape.Dims(1);
+    const int depth = filter_shape.Dims(filter_shape.DimensionsCount() - 1);
+    const int32_t multiplier = op_params.output_multiplier;
+    const int32_t shift = op_params.output_shift;
+
+    if (!data.bias_sums_ready) {
+        riscv::BiasSumsInt8(filter_data, units, depth,
+                            bias != nullptr ? tflite::micro::GetTensorData<int32_t>(bias) : nullptr,
+                            op_params.input_offset, data.bias_sums);
+    }
+    for (int first = 0; first < batches; first += data.tile_rows) {
+        const int count = batches - first < data.tile_rows ? batches - first : data.tile_rows;
+        riscv::GemmInt8(input_data + first * depth, count, filter_data, units,
+                        depth, data.bias_sums, &multiplier, &shift, 0,
+                        op_params.output_offset,
+                        op_params.quantized_activation_min,
+                        op_params.quantized_activation_max,
+                        output_data + first * units, units);
+    }
+}
+
+TfLiteStatus Eval(TfLiteContext *context, TfLiteNode *node)
+{
+    TFLITE_DCHECK(node->builtin_data != nullptr);
+    const auto *params =
+        static_cast<const TfLiteFullyConnectedParams *>(node->builtin_data);
+
+    const TfLiteEvalTensor *input =
+        tflite::micro::GetEvalInput(context, node, kFullyConnectedInputTensor);
+    const TfLiteEvalTensor *filter =
+        tflite::micro::GetEvalInput(context, node, kFullyConnectedWeightsTensor);
+    const TfLiteEvalTensor *bias =
+        tflite::micro::GetEvalInput(context, node, kFullyConnectedBiasTensor);
+    TfLiteEvalTensor *output =
+        tflite::micro::GetEvalOutput(context, node, kFullyConnectedOutputTensor);
+
+    TFLITE_DCHECK(node->user_data != nullptr);
+    auto &data = *(static_cast<OpData *>(node->user_data));
+
+    // Checks in Prepare ensure input, output and filter types are all the same.
+    switch (input->type) {
+        case kTfLiteFloat32: {
+            tflite::reference_ops::FullyConnected(
+                FullyConnectedParamsFloat(params->activation),
+                tflite::micro::GetTensorShape(input),
+                tflite::micro::GetTensorData<float>(input),
+                tflite::micro::GetTensorShape(filter),
+                tflite::micro::GetTensorData<float>(filter),
+                tflite::micro::GetTensorShape(bias),
+                tflite::micro::GetTensorData<float>(bias),
+                tflite::micro::GetTensorShape(output),
+                tflite::micro::GetTensorData<float>(output));
+            break;
+        }
+
+        case kTfLiteInt8: {
+            if (data.bias_sums != nullptr) {
+                EvalQuantized(data, input, filter, bias, output);
+                break;
+            }
+            tflite::reference_integer_ops::FullyConnected(
+                FullyConnectedParamsQuantized(data.reference_op_data),
+                tflite::micro::GetTensorShape(input),
+                tflite::micro::GetTensorData<int8_t>(input),
+                tflite::micro::GetTensorShape(filter),
+                tflite::micro::GetTensorData<int8_t>(filter),
+                tflite::micro::GetTensorShape(bias),
+                tflite::micro::GetTensorData<int32_t>(bias),
+                tflite::micro::GetTensorShape(output),
+                tflite::micro::GetTensorData<int8_t>(output));
+            break;
+        }
+
+        default: {
+            TF_LITE_KERNEL_LOG(context, "Type %s (%d) not supported.",
+                               TfLiteTypeGetName(input->type), input->type);
+            return kTfLiteError;
+        }
+    }
+    return kTfLiteOk;
+}
+
+} // namespace
+
+TfLiteRegistration Register_FULLY_CONNECTED()
+{
+    return { /*init=*/Init,
+             /*free=*/nullptr,
+             /*prepare=*/Prepare,
+             /*invoke=*/Eval,
+             /*profiling_string=*/nullptr,
+             /*builtin_code=*/0,
+             /*custom_name=*/nullptr,
+             /*version=*/0 };
+}
+
+} // namespace tflite
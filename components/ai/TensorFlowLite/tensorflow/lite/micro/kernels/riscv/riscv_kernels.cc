@@ -0,0 +1,86 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/micro/kernels/riscv/riscv_kernels.h"
+
+namespace tflite {
+namespace riscv {
+
+void BiasSumsInt8(const int8_t *rhs, int cols, int depth, const int32_t *bias,
+                  int32_t input_offset, int32_t *bias_sums)
+{
+    for (int c = 0; c < cols; ++c) {
+        int32_t sum = 0;
+        for (int i = 0; i < depth; ++i) {
+            sum += rhs[c * depth + i];
+        }
+        bias_sums[c] = (bias != nullptr ? bias[c] : 0) + input_offset * sum;
+    }
+}
+
+void GemmInt8(const int8_t *lhs, int rows, const int8_t *rhs, int cols,
+              int depth, const int32_t *bias_sums, const int32_t *multiplier,
+              const int32_t *shift, int quant_step, int32_t output_offset,
+              int32_t act_min, int32_t act_max, int8_t *out, int out_stride)
+{
+    int32_t sums[4];
+    int c = 0;
+    // Two filter rows at a time against the whole lhs tile, which the caller
+    // sized to stay in the data cache.
+    for (; c + 2 <= cols; c += 2) {
+        const int8_t *b0 = rhs + c * depth;
+        const int8_t *b1 = b0 + depth;
+        const int32_t m0 = multiplier[c * quant_step];
+        const int32_t m1 = multiplier[(c + 1) * quant_step];
+        const int32_t s0 = shift[c * quant_step];
+        const int32_t s1 = shift[(c + 1) * quant_step];
+        int r = 0;
+        for (; r + 2 <= rows; r += 2) {
+            const int8_t *a0 = lhs + r * depth;
+            DotInt8x2x2(a0, a0 + depth, b0, b1, depth, sums);
+            int8_t *o = out + r * out_stride + c;
+            o[0] = RequantizeInt8(sums[0] + bias_sums[c], m0, s0, output_offset, act_min, act_max);
+            o[1] = RequantizeInt8(sums[1] + bias_sums[c + 1], m1, s1, output_offset, act_min, act_max);
+            o[out_stride] = RequantizeInt8(sums[2] + bias_sums[c], m0, s0, output_offset, act_min, act_max);
+            o[out_stride + 1] = RequantizeInt8(sums[3] + bias_sums[c + 1], m1, s1, output_offset, act_min, act_max);
+        }
+        if (r < rows) {
+            DotInt8x2(lhs + r * depth, b0, b1, depth, sums);
+            int8_t *o = out + r * out_stride + c;
+            o[0] = RequantizeInt8(sums[0] + bias_sums[c], m0, s0, output_offset, act_min, act_max);
+            o[1] = RequantizeInt8(sums[1] + bias_sums[c + 1], m1, s1, output_offset, act_min, act_max);
+        }
+    }
+    if (c < cols) {
+        // The odd filter row, two lhs rows at a time: the dot product is symmetric.
+        const int8_t *b = rhs + c * depth;
+        const int32_t m = multiplier[c * quant_step];
+        const int32_t s = shift[c * quant_step];
+        int r = 0;
+        for (; r + 2 <= rows; r += 2) {
+            const int8_t *a0 = lhs + r * depth;
+            DotInt8x2(b, a0, a0 + depth, depth, sums);
+            out[r * out_stride + c] = RequantizeInt8(sums[0] + bias_sums[c], m, s, output_offset, act_min, act_max);
+            out[(r + 1) * out_stride + c] = RequantizeInt8(sums[1] + bias_sums[c], m, s, output_offset, act_min, act_max);
+        }
+        if (r < rows) {
+            out[r * out_stride + c] = RequantizeInt8(DotInt8(lhs + r * depth, b, depth) + bias_sums[c],
+                                                     m, s, output_offset, act_min, act_max);
+        }
+    }
+}
+
+} // namespace riscv
+} // namespace tflite
@@ -0,0 +1,236 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_KERNELS_RISCV_RISCV_KERNELS_H_
+#define TENSORFLOW_LITE_MICRO_KERNELS_RISCV_RISCV_KERNELS_H_
+
+#include <cstdint>
+#include <cstring>
+
+#include "tensorflow/lite/kernels/internal/common.h"
+
+// The int8 inner loops of the RISC-V conv, depthwise_conv and fully_connected
+// kernels. The instruction set is picked from the compiler flags:
+//  - RVV 1.0 (the __riscv_ prefixed intrinsics), any VLEN.
+//  - P extension (E907 on BL616/BL808 M0), smaqa through inline asm, or
+//    through rvp_intrinsic.h with TFLM_RISCV_THEAD_EXT=0.
+//  - Portable C otherwise, e.g. the C906, whose 0.7.1 vector draft does not
+//    take the RVV 1.0 intrinsics.
+// All paths give bit exact results against the reference kernels.
+#if defined(__riscv_vector) && defined(__riscv_v_intrinsic)
+#define TFLM_RISCV_RVV 1
+#include <riscv_vector.h>
+#elif defined(__riscv_dsp)
+#define TFLM_RISCV_RVP 1
+#ifndef TFLM_RISCV_THEAD_EXT
+#define TFLM_RISCV_THEAD_EXT 1
+#endif
+#if !TFLM_RISCV_THEAD_EXT
+#include <rvp_intrinsic.h>
+#endif
+#endif
+
+// Bytes of im2col rows (conv) or input rows (fully_connected) kept hot in the
+// data cache while every filter row streams over them once.
+#ifndef TFLM_RISCV_TILE_BYTES
+#define TFLM_RISCV_TILE_BYTES (8 * 1024)
+#endif
+
+namespace tflite {
+namespace riscv {
+
+#if defined(TFLM_RISCV_RVP)
+// acc + the 4 signed byte products of a and b.
+inline int32_t Smaqa(int32_t acc, uint32_t a, uint32_t b)
+{
+#if TFLM_RISCV_THEAD_EXT
+    asm("smaqa %0,%1,%2"
+        : "+r"(acc)
+        : "r"(a), "r"(b));
+    return acc;
+#else
+    return static_cast<int32_t>(__rv_smaqa(acc, a, b));
+#endif
+}
+
+// Rows are not word aligned in general.
+inline uint32_t Load32(const int8_t *p)
+{
+    uint32_t x;
+    memcpy(&x, p, 4);
+    return x;
+}
+#endif
+
+// Sum of a[i] * b[i], i < n.
+inline int32_t DotInt8(const int8_t *a, const int8_t *b, int n)
+{
+    int i = 0;
+    int32_t sum = 0;
+#if defined(TFLM_RISCV_RVV)
+    vint32m1_t sumv = __riscv_vmv_v_x_i32m1(0, 1);
+    for (size_t vl; i < n; i += vl) {
+        vl = __riscv_vsetvl_e8m1(n - i);
+        vint16m2_t p = __riscv_vwmul_vv_i16m2(__riscv_vle8_v_i8m1(a + i, vl),
+                                              __riscv_vle8_v_i8m1(b + i, vl), vl);
+        sumv = __riscv_vwredsum_vs_i16m2_i32m1(p, sumv, vl);
+    }
+    sum = __riscv_vmv_x_s_i32m1_i32(sumv);
+#elif defined(TFLM_RISCV_RVP)
+    for (; i + 4 <= n; i += 4) {
+        sum = Smaqa(sum, Load32(a + i), Load32(b + i));
+    }
+#endif
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+// out[0] = a.b0, out[1] = a.b1: every byte of a is loaded once for two sums.
+inline void DotInt8x2(const int8_t *a, const int8_t *b0, const int8_t *b1,
+                      int n, int32_t *out)
+{
+    int i = 0;
+    int32_t s0 = 0, s1 = 0;
+#if defined(TFLM_RISCV_RVV)
+    vint32m1_t s0v = __riscv_vmv_v_x_i32m1(0, 1);
+    vint32m1_t s1v = __riscv_vmv_v_x_i32m1(0, 1);
+    for (size_t vl; i < n; i += vl) {
+        vl = __riscv_vsetvl_e8m1(n - i);
+        vint8m1_t av = __riscv_vle8_v_i8m1(a + i, vl);
+        s0v = __riscv_vwredsum_vs_i16m2_i32m1(
+            __riscv_vwmul_vv_i16m2(av, __riscv_vle8_v_i8m1(b0 + i, vl), vl), s0v, vl);
+        s1v = __riscv_vwredsum_vs_i16m2_i32m1(
+            __riscv_vwmul_vv_i16m2(av, __riscv_vle8_v_i8m1(b1 + i, vl), vl), s1v, vl);
+    }
+    s0 = __riscv_vmv_x_s_i32m1_i32(s0v);
+    s1 = __riscv_vmv_x_s_i32m1_i32(s1v);
+#elif defined(TFLM_RISCV_RVP)
+    for (; i + 4 <= n; i += 4) {
+        const uint32_t aw = Load32(a + i);
+        s0 = Smaqa(s0, aw, Load32(b0 + i));
+        s1 = Smaqa(s1, aw, Load32(b1 + i));
+    }
+#endif
+    for (; i < n; ++i) {
+        s0 += a[i] * b0[i];
+        s1 += a[i] * b1[i];
+    }
+    out[0] = s0;
+    out[1] = s1;
+}
+
+// out = {a0.b0, a0.b1, a1.b0, a1.b1}: a 2x2 block of sums in registers, two
+// loads per two multiply-adds instead of two per one.
+inline void DotInt8x2x2(const int8_t *a0, const int8_t *a1, const int8_t *b0,
+                        const int8_t *b1, int n, int32_t *out)
+{
+    int i = 0;
+    int32_t s00 = 0, s01 = 0, s10 = 0, s11 = 0;
+#if defined(TFLM_RISCV_RVV)
+    vint32m1_t s00v = __riscv_vmv_v_x_i32m1(0, 1);
+    vint32m1_t s01v = __riscv_vmv_v_x_i32m1(0, 1);
+    vint32m1_t s10v = __riscv_vmv_v_x_i32m1(0, 1);
+    vint32m1_t s11v = __riscv_vmv_v_x_i32m1(0, 1);
+    for (size_t vl; i < n; i += vl) {
+        vl = __riscv_vsetvl_e8m1(n - i);
+        vint8m1_t a0v = __riscv_vle8_v_i8m1(a0 + i, vl);
+        vint8m1_t a1v = __riscv_vle8_v_i8m1(a1 + i, vl);
+        vint8m1_t b0v = __riscv_vle8_v_i8m1(b0 + i, vl);
+        vint8m1_t b1v = __riscv_vle8_v_i8m1(b1 + i, vl);
+        s00v = __riscv_vwredsum_vs_i16m2_i32m1(__riscv_vwmul_vv_i16m2(a0v, b0v, vl), s00v, vl);
+        s01v = __riscv_vwredsum_vs_i16m2_i32m1(__riscv_vwmul_vv_i16m2(a0v, b1v, vl), s01v, vl);
+        s10v = __riscv_vwredsum_vs_i16m2_i32m1(__riscv_vwmul_vv_i16m2(a1v, b0v, vl), s10v, vl);
+        s11v = __riscv_vwredsum_vs_i16m2_i32m1(__riscv_vwmul_vv_i16m2(a1v, b1v, vl), s11v, vl);
+    }
+    s00 = __riscv_vmv_x_s_i32m1_i32(s00v);
+    s01 = __riscv_vmv_x_s_i32m1_i32(s01v);
+    s10 = __riscv_vmv_x_s_i32m1_i32(s10v);
+    s11 = __riscv_vmv_x_s_i32m1_i32(s11v);
+#elif defined(TFLM_RISCV_RVP)
+    for (; i + 4 <= n; i += 4) {
+        const uint32_t a0w = Load32(a0 + i), a1w = Load32(a1 + i);
+        const uint32_t b0w = Load32(b0 + i), b1w = Load32(b1 + i);
+        s00 = Smaqa(s00, a0w, b0w);
+        s01 = Smaqa(s01, a0w, b1w);
+        s10 = Smaqa(s10, a1w, b0w);
+        s11 = Smaqa(s11, a1w, b1w);
+    }
+#endif
+    for (; i < n; ++i) {
+        s00 += a0[i] * b0[i];
+        s01 += a0[i] * b1[i];
+        s10 += a1[i] * b0[i];
+        s11 += a1[i] * b1[i];
+    }
+    out[0] = s00;
+    out[1] = s01;
+    out[2] = s10;
+    out[3] = s11;
+}
+
+// acc[i] += (in[i] + input_offset) * filter[i], i < n: one depthwise tap over
+// a row of channels.
+inline void MacInt8(const int8_t *in, const int8_t *filter,
+                    int32_t input_offset, int n, int32_t *acc)
+{
+    int i = 0;
+#if defined(TFLM_RISCV_RVV)
+    for (size_t vl; i < n; i += vl) {
+        vl = __riscv_vsetvl_e8m1(n - i);
+        vint16m2_t x = __riscv_vadd_vx_i16m2(
+            __riscv_vsext_vf2_i16m2(__riscv_vle8_v_i8m1(in + i, vl), vl),
+            static_cast<int16_t>(input_offset), vl);
+        vint16m2_t f = __riscv_vsext_vf2_i16m2(__riscv_vle8_v_i8m1(filter + i, vl), vl);
+        vint32m4_t a = __riscv_vle32_v_i32m4(acc + i, vl);
+        __riscv_vse32_v_i32m4(acc + i, __riscv_vwmacc_vv_i32m4(a, x, f, vl), vl);
+    }
+#endif
+    for (; i < n; ++i) {
+        acc[i] += (in[i] + input_offset) * filter[i];
+    }
+}
+
+// The output stage of the reference kernels.
+inline int8_t RequantizeInt8(int32_t acc, int32_t multiplier, int32_t shift,
+                             int32_t output_offset, int32_t act_min,
+                             int32_t act_max)
+{
+    acc = MultiplyByQuantizedMultiplier(acc, multiplier, shift) + output_offset;
+    acc = acc < act_min ? act_min : acc;
+    acc = acc > act_max ? act_max : acc;
+    return static_cast<int8_t>(acc);
+}
+
+// bias_sums[c] = bias[c] + input_offset * the sum of rhs row c, which takes
+// the input offset out of the inner loops. bias may be nullptr.
+void BiasSumsInt8(const int8_t *rhs, int cols, int depth, const int32_t *bias,
+                  int32_t input_offset, int32_t *bias_sums);
+
+// out[r * out_stride + c] = requantized bias_sums[c] + lhs row r . rhs row c,
+// for r < rows, c < cols, both rows depth bytes long. lhs is the small operand
+// that stays in cache (an im2col or input tile), each rhs row (filters) is read
+// once. multiplier and shift advance by quant_step per column: 1 per channel,
+// 0 per tensor.
+void GemmInt8(const int8_t *lhs, int rows, const int8_t *rhs, int cols,
+              int depth, const int32_t *bias_sums, const int32_t *multiplier,
+              const int32_t *shift, int quant_step, int32_t output_offset,
+              int32_t act_min, int32_t act_max, int8_t *out, int out_stride);
+
+} // namespace riscv
+} // namespace tflite
+
+#endif // TENSORFLOW_LITE_MICRO_KERNELS_RISCV_RISCV_KERNELS_H_
@@ -14,6 +14,10 @@ def runcmd(cmd):
         a.append(line.decode("utf8").strip())
     return a
 
+# python3 auto_test.py bench ...: per layer benchmark of the bundled models per backend, see bench.py
+if len(sys.argv) > 1 and sys.argv[1] == "bench":
+    from bench import bench
+    exit(bench(sys.argv[2:]))
 
 print("This script only test INT8/FP32, you need change OPT0&OPT1")
 t00= time.time()
@@ -0,0 +1,108 @@
+import os,sys,json,platform
+from subprocess import *
+
+### benchmark of every bundled model per backend, with bench/main.c and the tm_prof_* profiler
+#   python3 auto_test.py bench [-n runs] [-o out.json] [-b baseline.json] [-t 10] [-l uart.log]
+#   -o: results, per build and model: total us, per layer us/ops/bytes and the output check
+#   -b: fail if a model is more than -t percent slower than in an older -o file
+#   -l: a target log of tm_bench (csv), checked against the host outputs and added to -o
+# int8 outputs must match the CPU O0 build bit by bit, float ones on the top class.
+
+BENCH_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "bench")
+
+# name, TM_ARCH, TM_OPT_LEVEL, TM_MDL_TYPE
+BUILDS = [
+    ("cpu_o0_q",  "TM_ARCH_CPU",      "TM_OPT0", "TM_MDL_INT8"),
+    ("cpu_o1_q",  "TM_ARCH_CPU",      "TM_OPT1", "TM_MDL_INT8"),
+    ("cpu_o2_q",  "TM_ARCH_CPU",      "TM_OPT2", "TM_MDL_INT8"),
+    ("sse2_o1_q", "TM_ARCH_X86_SSE2", "TM_OPT1", "TM_MDL_INT8"),
+    ("sse2_o2_q", "TM_ARCH_X86_SSE2", "TM_OPT2", "TM_MDL_INT8"),
+    ("cpu_o0_f",  "TM_ARCH_CPU",      "TM_OPT0", "TM_MDL_FP32"),
+    ("cpu_o1_f",  "TM_ARCH_CPU",      "TM_OPT1", "TM_MDL_FP32"),
+    ("sse2_o1_f", "TM_ARCH_X86_SSE2", "TM_OPT1", "TM_MDL_FP32"),
+]
+
+def runcmd(cmd):
+    r = run(cmd, shell=True, stdout=PIPE, stderr=STDOUT)
+    return r.returncode, r.stdout.decode("utf8", "replace").splitlines()
+
+def parse_log(lines):
+    mdls = {}
+    for line in lines:
+        line = line.strip()
+        if line.startswith("# ") and " crc " in line:     # name crc xxxxxxxx top n buf n
+            f = line[2:].split()
+            m = mdls.setdefault(f[0], {"layers":[]})
+            m.update({"crc":f[2], "top":int(f[4]), "buf":int(f[6])})
+        elif line.count(",") == 11 and not line.startswith("model,"):
+            f = line.split(",")
+            m = mdls.setdefault(f[0], {"layers":[]})
+            if f[1] == "-1":
+                m.update({"ops":int(f[6]), "cycles":int(f[9]), "us":float(f[10])})
+            else:
+                m["layers"].append({"idx":int(f[1]), "layer":f[2], "out":[int(x) for x in f[3:6]], "ops":int(f[6]),
+                    "rd_bytes":int(f[7]), "wr_bytes":int(f[8]), "cycles":int(f[9]), "us":float(f[10]),
+                    "ops_per_cycle":float(f[11])})
+    return mdls
+
+def build_run(name, arch, opt, mdl_type, runs):
+    bdir = os.path.join(BENCH_DIR, "build", name)
+    code, out = runcmd("cmake -S %s -B %s -DTM_ARCH=%s -DTM_OPT_LEVEL=%s -DTM_MDL_TYPE=%s > /dev/null && cmake --build %s"\
+        %(BENCH_DIR, bdir, arch, opt, mdl_type, bdir))
+    if code != 0:
+        print("\n".join(out[-20:]))
+        return None
+    code, out = runcmd("%s -n %d"%(os.path.join(bdir, "tm_bench"), runs))
+    if code != 0:
+        print("\n".join(out[-5:]))
+        return None
+    return parse_log(out)
+
+def same_output(a, b, is_int):
+    return a["crc"] == b["crc"] if is_int else a["top"] == b["top"]
+
+def bench(argv):
+    opts = {"-n":"20", "-o":"bench.json", "-b":None, "-t":"10", "-l":None}
+    for i in range(0, len(argv)-1, 2):
+        opts[argv[i]] = argv[i+1]
+    runs = int(opts["-n"])
+    builds = [b for b in BUILDS if "SSE2" not in b[1] or platform.machine() in ["x86_64", "AMD64", "i686"]]
+    res, err = {}, 0
+    for name, arch, opt, mdl_type in builds:
+        r = build_run(name, arch, opt, mdl_type, runs)
+        if r is None:
+            print("====%s: build or run ERR!!!"%name)
+            return -1
+        res[name] = r
+        ref = res["cpu_o0_q" if mdl_type == "TM_MDL_INT8" else "cpu_o0_f"]
+        for m in r:
+            ok = same_output(r[m], ref[m], mdl_type == "TM_MDL_INT8")
+            err |= not ok
+            print("%-10s %-16s %10.1f us  %8.1f MOPS  %s"%(name, m, r[m]["us"], r[m]["ops"]/max(r[m]["us"], 1),
+                "OK" if ok else "OUTPUT DIFF!!!"))
+    if opts["-l"]:      # target log: int8 outputs against the host reference
+        with open(opts["-l"], "r", errors="replace") as f:
+            r = parse_log(f.readlines())
+        res["target"] = r
+        for m in r:
+            ref = res["cpu_o0_q"].get(m) or res["cpu_o0_f"].get(m)
+            ok = ref is not None and same_output(r[m], ref, m.endswith("_q"))
+            err |= not ok
+            print("%-10s %-16s %10.1f us  %8.1f MOPS  %s"%("target", m, r[m].get("us", 0), \
+                r[m].get("ops", 0)/max(r[m].get("us", 1), 1), "OK" if ok else "OUTPUT DIFF!!!"))
+    if opts["-b"]:      # regressions against an older run
+        with open(opts["-b"], "r") as f:
+            base = json.load(f)
+        limit = 1 + float(opts["-t"])/100
+        for b in res:
+            for m in res[b]:
+                if b in base and m in base[b] and res[b][m]["us"] > base[b][m]["us"]*limit:
+                    print("====%s %s: %.1f us, was %.1f us, SLOWER!!!"%(b, m, res[b][m]["us"], base[b][m]["us"]))
+                    err = 1
+    with open(opts["-o"], "w") as f:
+        json.dump(res, f, indent=1)
+    print("Saved to %s"%opts["-o"])
+    return -2 if err else 0
+
+if __name__ == '__main__':
+    exit(bench(sys.argv[1:]))
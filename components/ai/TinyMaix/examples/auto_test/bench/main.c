@@ -0,0 +1,188 @@
+/* Copyright 2022 Sipeed Technology Co., Ltd. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+// benchmark of every bundled model of the built TM_MDL_TYPE: per layer cycles, ops,
+// bytes and ops/cycle from the tm_prof_* profiler, and the output crc to compare
+// backends. On RISC-V targets TM_GET_CYCLE counts mcycle, read the uart log;
+// auto_test.py --bench runs it on the host and compares with a baseline.
+//   ./tm_bench [-n runs] [-f table|csv|json]
+
+#include <stdio.h>
+#include <string.h>
+#include "tinymaix.h"
+
+#ifndef BENCH_RUNS
+#define BENCH_RUNS  (10)
+#endif
+#ifndef BENCH_FMT
+#define BENCH_FMT   TM_PROF_CSV
+#endif
+#define BENCH_MAX_LAYERS (64)
+#define BENCH_MAX_IN     (128*128*3)
+
+//the model headers all define mdl_data, rename them one by one
+#if TM_MDL_TYPE == TM_MDL_INT8
+#define mdl_data cifar10_mdl
+#include "../../../tools/tmdl/cifar10_q.h"
+#undef mdl_data
+#undef __MODEL_FILE__H
+#undef MDL_BUF_LEN
+#undef LBUF_LEN
+#define mdl_data mbnet128_mdl
+#include "../../../tools/tmdl/mbnet128_0.25_q.h"
+#undef mdl_data
+#undef __MODEL_FILE__H
+#undef MDL_BUF_LEN
+#undef LBUF_LEN
+#define mdl_data mbnet96_mdl
+#include "../../../tools/tmdl/mbnet96_0.25_q.h"
+#undef mdl_data
+#undef __MODEL_FILE__H
+#undef MDL_BUF_LEN
+#undef LBUF_LEN
+#define mdl_data mnist_arduino_mdl
+#include "../../../tools/tmdl/mnist_arduino_q.h"
+#undef mdl_data
+#undef __MODEL_FILE__H
+#undef MDL_BUF_LEN
+#undef LBUF_LEN
+#define mdl_data mnist_resnet_mdl
+#include "../../../tools/tmdl/mnist_resnet_q.h"
+#undef mdl_data
+#undef __MODEL_FILE__H
+#undef MDL_BUF_LEN
+#undef LBUF_LEN
+#define mdl_data mnist_valid_mdl
+#include "../../../tools/tmdl/mnist_valid_q.h"
+#undef mdl_data
+#undef __MODEL_FILE__H
+#undef MDL_BUF_LEN
+#undef LBUF_LEN
+#define mdl_data vww96_mdl
+#include "../../../tools/tmdl/vww96_q.h"
+#undef mdl_data
+
+static const struct {const char* name; const uint8_t* bin;} bench_mdls[] = {
+    {"cifar10_q",         cifar10_mdl},
+    {"mbnet128_0.25_q",   mbnet128_mdl},
+    {"mbnet96_0.25_q",    mbnet96_mdl},
+    {"mnist_arduino_q",   mnist_arduino_mdl},
+    {"mnist_resnet_q",    mnist_resnet_mdl},
+    {"mnist_valid_q",     mnist_valid_mdl},
+    {"vww96_q",           vww96_mdl},
+};
+#define BENCH_PP TMPP_UINT2INT
+#elif TM_MDL_TYPE == TM_MDL_FP32
+#define mdl_data cifar10_mdl
+#include "../../../tools/tmdl/cifar10_f.h"
+#undef mdl_data
+#undef __MODEL_FILE__H
+#undef MDL_BUF_LEN
+#undef LBUF_LEN
+#define mdl_data mnist_dw_mdl
+#include "../../../tools/tmdl/mnist_dw_f.h"
+#undef mdl_data
+#undef __MODEL_FILE__H
+#undef MDL_BUF_LEN
+#undef LBUF_LEN
+#define mdl_data mnist_resnet_mdl
+#include "../../../tools/tmdl/mnist_resnet_f.h"
+#undef mdl_data
+#undef __MODEL_FILE__H
+#undef MDL_BUF_LEN
+#undef LBUF_LEN
+#define mdl_data mnist_valid_mdl
+#include "../../../tools/tmdl/mnist_valid_f.h"
+#undef mdl_data
+
+static const struct {const char* name; const uint8_t* bin;} bench_mdls[] = {
+    {"cifar10_f",         cifar10_mdl},
+    {"mnist_dw_f",        mnist_dw_mdl},
+    {"mnist_resnet_f",    mnist_resnet_mdl},
+    {"mnist_valid_f",     mnist_valid_mdl},
+};
+#define BENCH_PP TMPP_UINT2FP01
+#else
+#error "bench has int8 and fp32 models only"
+#endif
+
+static tm_prof_layer_t bench_layers[BENCH_MAX_LAYERS];
+static uint8_t bench_img[BENCH_MAX_IN];
+
+static uint32_t crc32(const uint8_t* p, uint32_t len)
+{
+    uint32_t crc = 0xffffffff;
+    while(len--) {
+        crc ^= *p++;
+        for(int i = 0; i < 8; i++)
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+static tm_err_t bench_model(const char* name, const uint8_t* bin, int runs, tm_prof_fmt_t fmt)
+{
+    tm_mdl_t mdl;
+    tm_mat_t in, outs[1];
+    tm_prof_t prof;
+    tm_err_t res = tm_load(&mdl, bin, NULL, tm_prof_cb, &in);
+    if(res != TM_OK) return res;
+    res = tm_prof_init(&prof, name, &mdl, bench_layers, BENCH_MAX_LAYERS);
+    if(res == TM_OK && in.h*in.w*in.c > BENCH_MAX_IN) res = TM_ERR_OOM;
+    if(res != TM_OK) {
+        tm_unload(&mdl);
+        return res;
+    }
+    uint32_t x = 2463534242u;   //same input on every backend
+    for(int i = 0; i < in.h*in.w*in.c; i++) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        bench_img[i] = x;
+    }
+    tm_mat_t in_uint8 = {3, in.h, in.w, in.c, {(mtype_t*)bench_img}};
+    for(int r = 0; r < runs && res == TM_OK; r++) {
+        tm_preprocess(&mdl, BENCH_PP, &in_uint8, &in);
+        tm_prof_start(&prof);
+        res = tm_run(&mdl, &in, outs);
+        tm_prof_end(&prof);
+    }
+    if(res == TM_OK) {    //int8 backends agree on the crc, float ones on the top class
+        int is_f = mdl.b->out_deq || TM_MDL_TYPE == TM_MDL_FP32;
+        int n = outs[0].h*outs[0].w*outs[0].c, top = 0;
+        for(int i = 1; i < n; i++)
+            if(is_f ? outs[0].dataf[i] > outs[0].dataf[top] : outs[0].data[i] > outs[0].data[top]) top = i;
+        tm_prof_print(&prof, fmt);
+        TM_PRINTF("# %s crc %08x top %d buf %d\n", name, crc32((uint8_t*)outs[0].data, n*(is_f ? sizeof(float) : sizeof(mtype_t))),
+            top, mdl.b->buf_size);
+    }
+    tm_unload(&mdl);
+    return res;
+}
+
+int main(int argc, char** argv)
+{
+    int runs = BENCH_RUNS;
+    tm_prof_fmt_t fmt = BENCH_FMT;
+    for(int i = 1; i + 1 < argc; i += 2) {
+        if(strcmp(argv[i], "-n") == 0) runs = atoi(argv[i+1]);
+        else if(strcmp(argv[i], "-f") == 0)
+            fmt = strcmp(argv[i+1], "json") == 0 ? TM_PROF_JSON : strcmp(argv[i+1], "table") == 0 ? TM_PROF_TABLE : TM_PROF_CSV;
+    }
+    if(runs < 1) runs = 1;
+    TM_PRINTF("# tm_bench arch %d opt %d mdl_type %d\n", TM_ARCH, TM_OPT_LEVEL, TM_MDL_TYPE);
+    for(int i = 0; i < (int)(sizeof(bench_mdls)/sizeof(bench_mdls[0])); i++) {
+        tm_err_t res = bench_model(bench_mdls[i].name, bench_mdls[i].bin, runs, fmt);
+        if(res != TM_OK) {
+            TM_PRINTF("# %s err %d\n", bench_mdls[i].name, res);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,394 @@
+# Copyright 2022 Sipeed Technology Co., Ltd. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+
+# convert-then-run cases for tm_layer_test, without tensorflow: small graphs of pool, concat, mul,
+# add, resize, hard-swish, conv, fc and softmax are built as the layer list read_tflite returns (two
+# input layers go through its split_two_inputs), packed by tflite2tmdl with and without tmdl_opt, and
+# written as C headers with a random input and the output of a numpy copy of the TFLite reference ops.
+# Conv and fc requantize as the TinyMaix postprocess does (float32, truncated), so that the layers
+# after them see the very same int8 input with or without the tmdl_opt fusion
+#   python3 mk_convert.py convert
+
+import os,sys,io,contextlib
+import numpy as np
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "../tools"))
+from tflite_reader import split_two_inputs
+from tflite2tmdl import pack_tmdl, TM_MDL_INT8, TM_MDL_FP32
+
+ACT_RELU, ACT_RELU6 = 1, 3
+
+############################### REFERENCE OPS #####################################
+#hwc float arrays, as the TFLite reference kernels
+def same_pads(n, k, s):
+    o = (n + s - 1)//s
+    p = max((o - 1)*s + k - n, 0)
+    return o, p//2
+
+def ref_pool(x, k, s, same, is_max):    #padding is not counted
+    h, w, c = x.shape
+    if same:
+        oh, pt = same_pads(h, k, s)
+        ow, pl = same_pads(w, k, s)
+    else:
+        oh, pt = (h - k)//s + 1, 0
+        ow, pl = (w - k)//s + 1, 0
+    y = np.zeros((oh, ow, c))
+    for oy in range(oh):
+        for ox in range(ow):
+            y0, x0 = oy*s - pt, ox*s - pl
+            win = x[max(y0, 0):min(y0+k, h), max(x0, 0):min(x0+k, w)].reshape(-1, c)
+            y[oy, ox] = win.max(0) if is_max else win.mean(0)
+    return y
+
+def ref_hardswish(x):
+    return x*np.clip(x+3, 0, 6)/6
+
+def ref_act(x, act):
+    if act == ACT_RELU:  return np.maximum(x, 0)
+    if act == ACT_RELU6: return np.clip(x, 0, 6)
+    return x
+
+#sum of the int8 taps less zp, as the kernels with zp in the bias: padding taps add nothing
+def ref_conv_sum(x, w, s, pads, dw):
+    h, wd, c = x.shape
+    co, kh, kw = w.shape[0] if not dw else w.shape[3], w.shape[1], w.shape[2]
+    pt, pl = pads
+    oh, ow = (h + 2*pt - kh)//s + 1, (wd + 2*pl - kw)//s + 1
+    xp = np.zeros((h + 2*pt + s, wd + 2*pl + s, c), dtype=x.dtype)
+    xp[pt:pt+h, pl:pl+wd] = x
+    y = np.zeros((oh, ow, co), dtype=x.dtype)
+    for oy in range(oh):
+        for ox in range(ow):
+            win = xp[oy*s:oy*s+kh, ox*s:ox*s+kw]
+            y[oy, ox] = (win*w[0]).sum((0, 1)) if dw else np.tensordot(w, win, ([1, 2, 3], [0, 1, 2]))
+    return y
+
+#tm_postprocess_sum: float32 scale, act, truncated requant
+def tm_requant(sumf, act, o_s, o_zp):
+    sumf = sumf.astype(np.float32)
+    if act in (ACT_RELU, ACT_RELU6): sumf = np.maximum(sumf, np.float32(0))
+    if act == ACT_RELU6: sumf = np.minimum(sumf, np.float32(6))
+    return np.trunc(sumf*np.float32(1/np.float32(o_s)) + np.float32(o_zp)).astype(np.int64)
+
+def resize_scale(n, o, align_corners):
+    return (n-1)/(o-1) if align_corners and o > 1 else n/o
+
+def ref_resize(x, oh, ow, bilinear, align_corners, half_pixel):
+    h, w, c = x.shape
+    sy, sx = resize_scale(h, oh, align_corners), resize_scale(w, ow, align_corners)
+    def nearest(o, scale, n):
+        v = (o + (0.5 if half_pixel else 0))*scale
+        i = int(np.floor(v + 0.5)) if align_corners else int(np.floor(v))
+        return min(max(i, 0), n-1)
+    def linear(o, scale, n):
+        v = (o+0.5)*scale-0.5 if half_pixel else o*scale
+        i0, i1 = max(int(np.floor(v)), 0), min(int(np.ceil(v)), n-1)
+        return i0, i1, v - i0
+    y = np.zeros((oh, ow, c))
+    for oy in range(oh):
+        for ox in range(ow):
+            if not bilinear:
+                y[oy, ox] = x[nearest(oy, sy, h), nearest(ox, sx, w)]
+                continue
+            y0, y1, fy = linear(oy, sy, h)
+            x0, x1, fx = linear(ox, sx, w)
+            y[oy, ox] = x[y0, x0]*(1-fy)*(1-fx) + x[y0, x1]*(1-fy)*fx + x[y1, x0]*fy*(1-fx) + x[y1, x1]*fy*fx
+    return y
+
+############################### GRAPH #####################################
+#tensors and layers as read_tflite has them, and the reference value of every tensor
+class Graph:
+    def __init__(self, shape, is_quant, rng):
+        self.is_quant = is_quant
+        self.rng = rng
+        self.tensors = []
+        self.layers = []
+        self.consts = {}
+        self.val = []       #int8 tensors: the int values, fp32: the values
+        x = rng.uniform(-4, 4, shape)
+        self.input = self.tensor("input", x)
+
+    def quant_of(self, x):
+        lo, hi = min(float(x.min()), 0.), max(float(x.max()), 0.)
+        s = (hi - lo)/255 if hi > lo else 1.
+        return s, int(np.clip(np.round(-128 - lo/s), -128, 127))
+
+    def quantize(self, x, s, zp):       #round half away from zero, saturate
+        q = x/s
+        return np.clip(np.sign(q)*np.floor(np.abs(q)+0.5) + zp, -128, 127).astype(np.int64)
+
+    def tensor(self, name, x, quant=None, const=False):
+        shape = [1] + list(x.shape) if not const else list(x.shape)
+        t = {"name":name, "shape":shape, "quantization":{"scale":None, "zero_point":None}}
+        if self.is_quant:
+            s, zp = quant if quant else self.quant_of(x)
+            t["quantization"] = {"scale":[s], "zero_point":[zp]}
+            x = self.quantize(x, s, zp)
+        else:
+            x = x.astype(np.float32)
+        self.tensors.append(t)
+        self.val.append(x)
+        if const:
+            self.consts[len(self.tensors)-1] = x
+        return len(self.tensors)-1
+
+    def deq(self, idx):
+        if not self.is_quant:
+            return self.val[idx].astype(np.float64)
+        q = self.tensors[idx]["quantization"]
+        return (self.val[idx] - q["zero_point"][0])*q["scale"][0]
+
+    def quant(self, idx):
+        q = self.tensors[idx]["quantization"]
+        return (q["scale"][0], q["zero_point"][0]) if self.is_quant else (1, 0)
+
+    def const(self, name, x):
+        return self.tensor(name, x, const=True)
+
+    #one layer: y is its reference output, same_quant keeps the quant of input 0 as TFLite does for pools,
+    #y_int(s, zp) the int8 output in the quant picked for y, if not rounded from y
+    def op(self, name, inputs, opts, y, same_quant=False, y_int=None):
+        if y.ndim == 4:     #broadcast with a constant that has the batch dim
+            y = y[0]
+        l = {"name":name, "is_keep":0, "is_output":0}
+        l.update(opts)
+        i = inputs[0]
+        l.update({"in_shape":self.tensors[i]["shape"], "in_name":self.tensors[i]["name"], "quant":int(self.is_quant)})
+        l["i_scale"], l["i_zeropoint"] = self.quant(i)
+        o = self.tensor("%s_%d"%(name.lower(), len(self.layers)), y, self.quant(i) if same_quant else None)
+        l.update({"out_shape":self.tensors[o]["shape"], "out_name":self.tensors[o]["name"]})
+        l["o_scale"], l["o_zeropoint"] = self.quant(o)
+        if self.is_quant and y_int:
+            self.val[o] = y_int(*self.quant(o))
+        if len(inputs) == 2:
+            split_two_inputs(l, self.layers, self.tensors, inputs[0], inputs[1], [self.input], \
+                lambda idx: self.consts.get(idx), lambda *a: None)
+        self.layers.append(l)
+        return o
+
+    def pool(self, x, k, s, same, is_max):
+        name = "MAX_POOL_2D" if is_max else "AVERAGE_POOL_2D"
+        opts = {"padding":0 if same else 1, "stride_w":s, "stride_h":s, "filter_width":k, "filter_height":k, \
+            "fused_activation_function":0}
+        if self.is_quant and not is_max:     #same quant: the integer average, rounded half away
+            y = ref_pool(self.val[x].astype(np.float64), k, s, same, is_max)
+            y = (np.sign(y)*np.floor(np.abs(y)+0.5) - self.quant(x)[1])*self.quant(x)[0]
+        else:
+            y = ref_pool(self.deq(x), k, s, same, is_max)
+        return self.op(name, [x], opts, y, same_quant=True)
+
+    def hardswish(self, x):
+        return self.op("HARD_SWISH", [x], {}, ref_hardswish(self.deq(x)))
+
+    def concat(self, a, b):
+        return self.op("CONCATENATION", [a, b], {"axis":-1, "fused_activation_function":0}, \
+            np.concatenate([self.deq(a), self.deq(b)], axis=-1))
+
+    def mul(self, a, b, act=0):
+        return self.op("MUL", [a, b], {"fused_activation_function":act}, ref_act(self.deq(a)*self.deq(b), act))
+
+    def add(self, a, b, act=0):
+        return self.op("ADD", [a, b], {"fused_activation_function":act}, ref_act(self.deq(a)+self.deq(b), act))
+
+    #int8: weights of at most 127 per channel of ch_axis (None: per tensor) and an int32 bias,
+    #in the fp32 model the float ones
+    def weights(self, shape, ch_axis, in_s):
+        cho = shape[0 if ch_axis is None else ch_axis]
+        w = self.rng.uniform(-1, 1, shape)
+        b = self.rng.uniform(-1, 1, (cho,))
+        if not self.is_quant:
+            return w.astype(np.float32), b.astype(np.float32), np.ones(1)
+        if ch_axis is None:
+            ws = np.array([np.abs(w).max()/127])
+            wb = ws[0]
+        else:
+            ws = np.abs(w).max(axis=tuple(i for i in range(len(shape)) if i != ch_axis))/127
+            wb = ws.reshape([cho if i == ch_axis else 1 for i in range(len(shape))])
+        return np.round(w/wb).astype(np.int8), np.round(b/(in_s*ws)).astype(np.int32), ws
+
+    def conv(self, x, cho, k, s, act=0, dw=False):
+        h, w, c = self.tensors[x]["shape"][1:]
+        in_s, in_zp = self.quant(x)
+        shape = (1, k, k, c) if dw else (cho, k, k, c)
+        wq, bq, ws = self.weights(shape, 3 if dw else 0, in_s)
+        oh, pt = same_pads(h, k, s)
+        ow, pl = same_pads(w, k, s)
+        xi = self.val[x] - in_zp if self.is_quant else self.val[x].astype(np.float64)
+        wi = wq.astype(np.int64 if self.is_quant else np.float64)
+        sums = ref_conv_sum(xi, wi, s, (pt, pl), dw) + bq
+        if self.is_quant:
+            sumf = sums.astype(np.float32)*(np.float32(ws)*np.float32(in_s)).astype(np.float32)
+            y = ref_act(sums*ws*in_s, act)
+        else:
+            y = ref_act(sums, ACT_RELU if act == ACT_RELU6 else act)     #fp32 conv takes relu6 as relu
+        name = "DEPTHWISE_CONV_2D" if dw else "CONV_2D"
+        opts = {"padding":0, "stride_w":s, "stride_h":s, "dilation_w_factor":1, "dilation_h_factor":1, \
+            "fused_activation_function":act, "weight":wq, "bias":bq, "w_scale":np.atleast_1d(ws), "w_zeropoint":0}
+        if dw: opts["depth_multiplier"] = 1
+        return self.op(name, [x], opts, y, y_int=lambda o_s, o_zp: tm_requant(sumf, act, o_s, o_zp))
+
+    def reshape(self, x):
+        return self.op("RESHAPE", [x], {}, self.deq(x).reshape(-1), same_quant=True)
+
+    def fc(self, x, cho):
+        chi = self.tensors[x]["shape"][-1]
+        in_s, in_zp = self.quant(x)
+        wq, bq, ws = self.weights((cho, chi), None, in_s)
+        xi = self.val[x] - in_zp if self.is_quant else self.val[x].astype(np.float64)
+        sums = wq.astype(np.int64 if self.is_quant else np.float64) @ xi + bq
+        y = sums*ws[0]*in_s if self.is_quant else sums
+        #tml_fc: (mtype_t)(sum*in_s*ws[0]/out_s + out_zp)
+        y_int = lambda o_s, o_zp: np.trunc(sums.astype(np.float32)*np.float32(in_s)*np.float32(ws[0])/np.float32(o_s) + \
+            np.float32(o_zp)).astype(np.int64)
+        opts = {"fused_activation_function":0, "weight":wq, "bias":bq, "w_scale":np.atleast_1d(ws), "w_zeropoint":0}
+        return self.op("FULLY_CONNECTED", [x], opts, y, y_int=y_int)
+
+    def softmax(self, x):
+        v = self.deq(x)
+        e = np.exp(v - v.max())
+        return self.op("SOFTMAX", [x], {"beta":1.0}, e/e.sum())
+
+    def resize(self, x, oh, ow, bilinear, align_corners=0, half_pixel=0):
+        name = "RESIZE_BILINEAR" if bilinear else "RESIZE_NEAREST_NEIGHBOR"
+        opts = {"align_corners":align_corners, "half_pixel_centers":half_pixel}
+        return self.op(name, [x], opts, ref_resize(self.deq(x), oh, ow, bilinear, align_corners, half_pixel), \
+            same_quant=True)
+
+############################### CASES #####################################
+def case_pool(g):
+    x = g.pool(g.input, 3, 2, 1, 1)
+    return g.pool(x, 2, 1, 0, 0)
+
+def case_pool_avg_same(g):
+    x = g.pool(g.input, 3, 2, 1, 0)
+    return g.pool(x, 2, 2, 0, 1)
+
+def case_concat_kept0(g):   #tflite input0 is the kept one, its channels go first
+    a = g.hardswish(g.input)
+    return g.concat(a, g.pool(a, 3, 1, 1, 1))
+
+def case_concat_kept1(g):
+    a = g.hardswish(g.input)
+    return g.concat(g.pool(a, 3, 1, 1, 0), a)
+
+def case_mul_const_c(g):    #a constant of shape [c], broadcast on h,w
+    a = g.hardswish(g.input)
+    c = g.tensors[a]["shape"][-1]
+    return g.mul(a, g.const("scale", g.rng.uniform(-2, 2, (c,))), ACT_RELU6)
+
+def case_mul_const_in0(g):  #a whole constant as tflite input0, in the middle of a row group after tmdl_opt
+    p = g.pool(g.input, 3, 1, 1, 0)
+    m = g.mul(g.const("mask", g.rng.uniform(-1, 1, g.tensors[p]["shape"])), p)
+    return g.pool(m, 2, 2, 0, 1)
+
+def case_mul_input(g):      #the model input is kept for the mul
+    return g.mul(g.input, g.pool(g.input, 3, 1, 1, 0))
+
+def case_mul_se_input(g):   #a 1x1xc scale near, the model input kept
+    h, w = g.tensors[g.input]["shape"][1:3]
+    s = g.hardswish(g.pool(g.input, h, 1, 0, 0))
+    return g.mul(s, g.input, ACT_RELU)
+
+def case_add_input(g):
+    return g.add(g.hardswish(g.input), g.input, ACT_RELU)
+
+def case_resize_nearest(g):
+    return g.hardswish(g.resize(g.input, 10, 12, 0, half_pixel=1))
+
+def case_resize_bilinear_align(g):
+    return g.resize(g.input, 9, 9, 1, align_corners=1)
+
+def case_resize_bilinear(g):
+    return g.resize(g.input, 5, 4, 1, half_pixel=1)
+
+def case_conv_add_relu(g):  #conv+ADD+act fused by tmdl_opt, the model input kept
+    return g.add(g.conv(g.input, 8, 3, 1, ACT_RELU), g.input, ACT_RELU)
+
+def case_pwconv_add(g):     #1x1 conv, the O2 GEMM
+    return g.add(g.conv(g.input, 16, 1, 1), g.input)
+
+def case_dwconv_add_in0(g): #tflite input0 is the kept one
+    a = g.hardswish(g.input)
+    return g.add(a, g.conv(a, 0, 3, 1, ACT_RELU6, dw=True), ACT_RELU6)
+
+def case_fc_softmax(g):
+    return g.softmax(g.fc(g.reshape(g.hardswish(g.input)), 10))
+
+#name, input shape (h,w,c), graph
+CASES = [
+    ("pool",                  (9,9,4),  case_pool),
+    ("pool_avg_same",         (8,7,5),  case_pool_avg_same),
+    ("concat_kept0",          (6,6,4),  case_concat_kept0),
+    ("concat_kept1",          (5,7,3),  case_concat_kept1),
+    ("mul_const_c",           (6,6,8),  case_mul_const_c),
+    ("mul_const_in0",         (12,12,4), case_mul_const_in0),
+    ("mul_input",             (7,6,4),  case_mul_input),
+    ("mul_se_input",          (6,6,8),  case_mul_se_input),
+    ("add_input",             (6,5,4),  case_add_input),
+    ("resize_nearest",        (5,6,3),  case_resize_nearest),
+    ("resize_bilinear_align", (5,5,3),  case_resize_bilinear_align),
+    ("resize_bilinear",       (8,6,4),  case_resize_bilinear),
+    ("conv_add_relu",         (7,6,8),  case_conv_add_relu),
+    ("pwconv_add",            (8,8,16), case_pwconv_add),
+    ("dwconv_add_in0",        (9,7,8),  case_dwconv_add_in0),
+    ("fc_softmax",            (3,3,8),  case_fc_softmax),
+]
+
+def c_array(fw, ctype, name, data, fmt, attr=""):
+    data = data.flatten()
+    fw.write("static const %s %s[%d]%s = {\n"%(ctype, name, data.size, attr))
+    for i in range(0, data.size, 16):
+        fw.write("    " + ", ".join(fmt%v for v in data[i:i+16]) + ",\n")
+    fw.write("};\n")
+
+def make_case(out_dir, name, shape, build, is_quant, opt):
+    tag = name + ("_q" if is_quant else "_f") + ("_opt" if opt else "")
+    g = Graph(shape, is_quant, np.random.default_rng(sum(map(ord, name))))
+    y = build(g)
+    g.layers[-1]["is_output"] = 1
+    tmdl_name = os.path.join(out_dir, tag+".tmdl")
+    with contextlib.redirect_stdout(io.StringIO()):
+        pack_tmdl(g.layers, tmdl_name, TM_MDL_INT8 if is_quant else TM_MDL_FP32, 0, list(shape), \
+            g.tensors[y]["shape"][1:], "<", write_c_header=False, opt=opt)
+    mdl = np.frombuffer(open(tmdl_name, "rb").read(), dtype=np.uint8)
+    os.remove(tmdl_name)
+
+    with open(os.path.join(out_dir, tag+".h"), "w") as fw:
+        fw.write("//generated by host/mk_convert.py, %s\n"%(" ".join(l["name"] for l in g.layers)))
+        c_array(fw, "uint8_t", "convert_%s_mdl"%tag, mdl, "0x%02x", " __attribute__((aligned(8)))")
+        fmt = "%d" if is_quant else "%#.9gf"
+        c_array(fw, "mtype_t", "convert_%s_in"%tag, g.val[g.input], fmt)
+        c_array(fw, "mtype_t", "convert_%s_out"%tag, g.val[y], fmt)
+    return tag
+
+def print_usage():
+    print("Usage: python3 mk_convert.py out_dir")
+
+if __name__ == '__main__':
+    if len(sys.argv) != 2:
+        print_usage()
+        exit()
+    out_dir = sys.argv[1]
+    os.makedirs(out_dir, exist_ok=True)
+    for is_quant in [1, 0]:
+        tags = [make_case(out_dir, name, shape, build, is_quant, opt) for name, shape, build in CASES for opt in [0, 1]]
+        with open(os.path.join(out_dir, "cases_q.h" if is_quant else "cases_f.h"), "w") as fw:
+            fw.write("//generated by host/mk_convert.py\n")
+            for tag in tags:
+                fw.write('#include "%s.h"\n'%tag)
+            fw.write("#define CONVERT_CASES \\\n")
+            for tag in tags:
+                fw.write("    CONVERT_CASE(%s) \\\n"%tag)
+            fw.write("\n")
@@ -0,0 +1,97 @@
+# Copyright 2022 Sipeed Technology Co., Ltd. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+
+# yolov2 stand-in for tm_bench: the MaixHub detection models are not in the tree, so take the
+# mobilenet 0.25 backbone of mbnet128_0.25_q at 224x224 and put a 1x1 conv head of 5 anchors x
+# (5+1 class) on its 7x7 output, in the legacy ping-pong layout
+#   python3 mk_yolo2.py yolo2_base.tmdl
+
+import os,sys,struct
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "../tools"))
+from tmdl_opt import *
+
+IMG_L     = 224
+HEAD_C    = 5*(5+1)
+BACKBONE  = 27      #mbnet layers before gap
+HEAD      = 28      #the 1x1 classifier conv, cut to HEAD_C channels
+
+def same_pads(n, k, s):
+    o = (n + s - 1)//s
+    p = max((o - 1)*s + k - n, 0)
+    return o, p//2, p - p//2
+
+def redim(l, h):    #conv/dwconv on an hxh input, SAME pads recomputed
+    raw = l["raw"]
+    kw,kh,sx,sy = struct.unpack("4B", raw[48:52])
+    c_in, c_out = l["in_dims"][3], l["out_dims"][3]
+    o, pt, pb = same_pads(h, kh, sy)
+    raw[16:32] = struct.pack("<8H", 3, h, h, c_in, 3, o, o, c_out)
+    raw[56:60] = struct.pack("4B", pt, pb, pt, pb)
+    return raw, o
+
+def cut_head(l, h):  #keep the first HEAD_C output channels of the 1x1 conv
+    raw = l["raw"]
+    ci = l["in_dims"][3]
+    ws_oft, w_oft, b_oft = struct.unpack("<3I", raw[68:80])
+    ws = raw[ws_oft:ws_oft+HEAD_C*4]
+    w  = raw[w_oft:w_oft+HEAD_C*ci]
+    b  = raw[b_oft:b_oft+HEAD_C*4]
+    body = bytearray(raw[:80])
+    body[16:32] = struct.pack("<8H", 3, h, h, ci, 3, h, h, HEAD_C)
+    body[2:4] = struct.pack("<H", 1)                                    #is_out
+    body[54:56] = struct.pack("<H", 0)                                  #linear act
+    ws_oft = len(body);           body += ws + bytes(align8(len(ws)) - len(ws))
+    w_oft  = len(body);           body += w  + bytes(align8(len(w))  - len(w))
+    b_oft  = len(body);           body += b  + bytes(align8(len(b))  - len(b))
+    body[68:80] = struct.pack("<3I", ws_oft, w_oft, b_oft)
+    return body
+
+def mk_yolo2(src):
+    mdl, layers = read_tmdl(read_c_header(src))
+    assert mdl["endian"] == "<" and mdl["mdl_type"] == TM_MDL_INT8
+    raws = []
+    h = IMG_L
+    for l in layers[:BACKBONE]:
+        raw, h = redim(l, h)
+        raws.append(raw)
+    raws.append(cut_head(layers[HEAD], h))
+    #ping-pong: outputs go to 0 and to the buffer end by turns, the output layer keeps room for the dequant floats
+    sizes = [align8(IMG_L*IMG_L*3)]
+    for raw in raws:
+        is_out = struct.unpack("<H", raw[2:4])[0]
+        dims = struct.unpack("<4H", raw[24:32])
+        sizes.append(tensor_bytes(mdl, dims, is_out))
+    buf_size = max(sizes[i] + sizes[i+1] for i in range(len(raws)))
+    oft = 0
+    for i, raw in enumerate(raws):
+        out_oft = buf_size - sizes[i+1] if oft == 0 else 0
+        raw[4:16] = struct.pack("<3I", len(raw), oft, out_oft)
+        oft = out_oft
+    head = bytearray(mdl["head"])
+    head[10:16] = struct.pack("<HI", len(raws), buf_size)
+    head[20:36] = struct.pack("<8H", 3, IMG_L, IMG_L, 3, 3, h, h, HEAD_C)
+    data = bytes(head) + b"".join(bytes(r) for r in raws)
+    return data, buf_size, MDLBINHEAD_SIZE + max(len(r) for r in raws)
+
+if __name__ == '__main__':
+    if len(sys.argv) != 2:
+        print("Usage: python3 mk_yolo2.py out.tmdl")
+        exit()
+    dst = sys.argv[1]
+    data, buf_size, lbuf = mk_yolo2(os.path.join(os.path.dirname(os.path.abspath(__file__)), "../tools/tmdl/mbnet128_0.25_q.h"))
+    with open(dst, "wb") as f:
+        f.write(data)
+    write_c_header(".".join(dst.split(".")[:-1])+".h", data, buf_size, lbuf)
+    print("Saved to %s, buffer %d B"%(dst, buf_size))
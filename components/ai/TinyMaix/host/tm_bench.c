@@ -0,0 +1,388 @@
+/* Copyright 2022 Sipeed Technology Co., Ltd. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+// host bench of the int8 layers: per layer time and output crc of two models,
+// crc of conv/pwconv shapes the models do not have (-t), and buffer and time
+// of the models against their tmdl_opt.py versions (-p)
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "tinymaix.h"
+
+//the model headers all define mdl_data and the pic headers pic, rename them one by one
+#define mdl_data mbnet_mdl
+#include "../tools/tmdl/mbnet128_0.25_q.h"
+#undef mdl_data
+#undef __MODEL_FILE__H
+#undef MDL_BUF_LEN
+#undef LBUF_LEN
+#define mdl_data vww_mdl
+#include "../tools/tmdl/vww96_q.h"
+#undef mdl_data
+#undef __MODEL_FILE__H
+#undef MDL_BUF_LEN
+#undef LBUF_LEN
+#define mdl_data resnet_mdl
+#include "../tools/tmdl/mnist_resnet_q.h"
+#undef mdl_data
+#undef __MODEL_FILE__H
+#undef MDL_BUF_LEN
+#undef LBUF_LEN
+//made by make: tmdl_opt.py outputs, and the yolov2 stand-in of mk_yolo2.py
+#define mdl_data mbnet_opt_mdl
+#include "mbnet128_0.25_q_opt.h"
+#undef mdl_data
+#undef __MODEL_FILE__H
+#undef MDL_BUF_LEN
+#undef LBUF_LEN
+#define mdl_data vww_opt_mdl
+#include "vww96_q_opt.h"
+#undef mdl_data
+#undef __MODEL_FILE__H
+#undef MDL_BUF_LEN
+#undef LBUF_LEN
+#define mdl_data resnet_opt_mdl
+#include "mnist_resnet_q_opt.h"
+#undef mdl_data
+#undef __MODEL_FILE__H
+#undef MDL_BUF_LEN
+#undef LBUF_LEN
+#define mdl_data yolo2_mdl
+#include "yolo2_base.h"
+#undef mdl_data
+#undef __MODEL_FILE__H
+#undef MDL_BUF_LEN
+#undef LBUF_LEN
+#define mdl_data yolo2_opt_mdl
+#include "yolo2_opt.h"
+#undef mdl_data
+#define pic mbnet_pic
+#include "../examples/mbnet/pic128.h"
+#undef pic
+#define pic vww_pic
+#include "../examples/vww/pic/pic_person1.h"
+#undef pic
+
+#define BENCH_MAX_LAYERS 64
+
+typedef struct {
+    const char*    name;
+    const uint8_t* bin;
+    const uint8_t* pic;
+    int            img_l;
+} bench_mdl_t;
+
+static const bench_mdl_t bench_mdls[] = {
+    {"mbnet128_0.25_q",     mbnet_mdl,     mbnet_pic, 128},
+    {"vww96_q",             vww_mdl,       vww_pic,   96},
+    {"mbnet128_0.25_q_opt", mbnet_opt_mdl, mbnet_pic, 128},
+    {"vww96_q_opt",         vww_opt_mdl,   vww_pic,   96},
+};
+
+typedef struct {
+    const char*    name;
+    const uint8_t* base;
+    const uint8_t* opt;
+    const uint8_t* pic;         //NULL: random input
+} bench_pair_t;
+
+static const bench_pair_t bench_pairs[] = {
+    {"mbnet128_0.25_q", mbnet_mdl,  mbnet_opt_mdl,  mbnet_pic},
+    {"vww96_q",         vww_mdl,    vww_opt_mdl,    vww_pic},
+    {"mnist_resnet_q",  resnet_mdl, resnet_opt_mdl, NULL},
+    {"yolo2_224",       yolo2_mdl,  yolo2_opt_mdl,  NULL},
+};
+
+static int      bench_runs  = 5;
+static int      bench_quiet = 0;
+static uint64_t bench_t0;
+static uint64_t bench_ns[BENCH_MAX_LAYERS];
+static uint32_t bench_crc[BENCH_MAX_LAYERS];
+
+static uint64_t host_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint32_t crc32(const uint8_t* p, uint32_t len)
+{
+    uint32_t crc = 0xffffffff;
+    while(len--) {
+        crc ^= *p++;
+        for(int i = 0; i < 8; i++)
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+static const char* layer_name(tml_head_t* h)
+{
+    static const char* names[TML_MAXCNT] = {"conv", "gap", "fc", "softmax", "reshape", "dwconv", "add",
+        "maxpool", "avgpool", "concat", "mul", "resize", "hswish", "group"};
+    if(h->type == TML_CONV2D && ((tml_conv2d_dw_t*)h)->kernel_w == 1 && ((tml_conv2d_dw_t*)h)->kernel_h == 1)
+        return "pwconv";
+    return h->type < TML_MAXCNT ? names[h->type] : "?";
+}
+
+static uint64_t layer_macs(tml_head_t* h)
+{
+    uint64_t outs = (uint64_t)h->out_dims[1]*h->out_dims[2]*h->out_dims[3];
+    if(h->type == TML_CONV2D || h->type == TML_DWCONV2D) {
+        tml_conv2d_dw_t* l = (tml_conv2d_dw_t*)h;
+        return outs*l->kernel_w*l->kernel_h*(l->depth_mul ? 1 : h->in_dims[3]);
+    }
+    if(h->type == TML_FC)
+        return outs*h->in_dims[1]*h->in_dims[2]*h->in_dims[3];
+    if(h->type == TML_GROUP) {
+        uint64_t m = 0;
+        uint8_t* body = (uint8_t*)h + sizeof(tml_group_t);
+        for(int j = 0; j < ((tml_group_t*)h)->cnt; j++) {
+            m += layer_macs((tml_head_t*)body);
+            body += ((tml_head_t*)body)->size;
+        }
+        return m;
+    }
+    return 0;
+}
+
+//time since the last callback is this layer, the crc is not counted
+static tm_err_t layer_cb(tm_mdl_t* mdl, tml_head_t* lh)
+{
+    uint64_t t = host_time_ns();
+    int i = mdl->layer_i;
+    if(i < BENCH_MAX_LAYERS) {
+        uint64_t ns = t - bench_t0;
+        if(bench_ns[i] == 0 || ns < bench_ns[i]) bench_ns[i] = ns;
+        bench_crc[i] = crc32((uint8_t*)TML_GET_OUTPUT(mdl, lh), lh->out_dims[1]*lh->out_dims[2]*lh->out_dims[3]*sizeof(mtype_t));
+    }
+    bench_t0 = host_time_ns();
+    return TM_OK;
+}
+
+static int bench_model(const bench_mdl_t* bm)
+{
+    tm_mdl_t mdl;
+    tm_mat_t in_uint8 = {3, bm->img_l, bm->img_l, 3, {(mtype_t*)bm->pic}};
+    tm_mat_t in;
+    tm_mat_t outs[1];
+    tm_err_t res;
+    uint64_t total = 0, conv = 0, macs = 0;
+
+    memset(bench_ns, 0, sizeof(bench_ns));
+    res = tm_load(&mdl, bm->bin, NULL, layer_cb, &in);
+    if(res != TM_OK) {
+        printf("%s: tm_load err %d\n", bm->name, res);
+        return -1;
+    }
+    for(int r = 0; r < bench_runs; r++) {
+        tm_preprocess(&mdl, TMPP_UINT2INT, &in_uint8, &in);
+        bench_t0 = host_time_ns();
+        res = tm_run(&mdl, &in, outs);
+        if(res != TM_OK) {
+            printf("%s: tm_run err %d\n", bm->name, res);
+            tm_unload(&mdl);
+            return -1;
+        }
+    }
+
+    printf("%s\n", bm->name);
+    if(!bench_quiet) printf("%3s %-8s %-14s %10s %10s %8s\n", "#", "layer", "out", "MAC", "us", "MAC/ns");
+    uint8_t* body = mdl.b->layers_body;
+    for(int i = 0; i < mdl.b->layer_cnt && i < BENCH_MAX_LAYERS; i++) {
+        tml_head_t* h = (tml_head_t*)body;
+        uint64_t m = layer_macs(h);
+        char dims[32];
+        snprintf(dims, sizeof(dims), "%dx%dx%d", h->out_dims[1], h->out_dims[2], h->out_dims[3]);
+        if(bench_quiet)
+            printf("%3d %-8s %-14s %08x\n", i, layer_name(h), dims, bench_crc[i]);
+        else
+            printf("%3d %-8s %-14s %10llu %10.1f %8.2f  %08x\n", i, layer_name(h), dims, (unsigned long long)m,
+                bench_ns[i]/1000.0, bench_ns[i] ? (double)m/bench_ns[i] : 0.0, bench_crc[i]);
+        total += bench_ns[i];
+        macs  += m;
+        if(h->type == TML_CONV2D) conv += bench_ns[i];
+        body += h->size;
+    }
+    if(!bench_quiet)
+        printf("total %.3f ms, conv+pwconv %.3f ms, %.2f MAC/ns\n", total/1e6, conv/1e6, (double)macs/total);
+    tm_unload(&mdl);
+    return 0;
+}
+
+//base and opt loaded side by side and run in turn, best of bench_runs each, no layer callback:
+//both see the same load of the host. ns and crc of the output per model
+static int bench_pair_run(const bench_pair_t* p, uint64_t ns[2], uint32_t crc[2])
+{
+    static uint8_t rand_img[224*224*3];
+    const uint8_t* bins[2] = {p->base, p->opt};
+    tm_mdl_t mdl[2];
+    tm_mat_t in[2], outs[2][1];
+    tm_err_t res = tm_load(&mdl[0], bins[0], NULL, NULL, &in[0]);
+    if(res != TM_OK) return res;
+    res = tm_load(&mdl[1], bins[1], NULL, NULL, &in[1]);
+    if(res != TM_OK) {
+        tm_unload(&mdl[0]);
+        return res;
+    }
+    tm_mat_t in_uint8 = {3, in[0].h, in[0].w, in[0].c, {(mtype_t*)p->pic}};
+    if(p->pic == NULL) {
+        if(in[0].h*in[0].w*in[0].c > (int)sizeof(rand_img)) res = TM_ERR_OOM;
+        uint32_t x = 12345;     //same input for base and opt
+        for(int i = 0; i < in[0].h*in[0].w*in[0].c && res == TM_OK; i++) {
+            x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+            rand_img[i] = x;
+        }
+        in_uint8.data = (mtype_t*)rand_img;
+    }
+    ns[0] = ns[1] = 0;
+    for(int r = 0; r < bench_runs && res == TM_OK; r++) {
+        for(int m = 0; m < 2 && res == TM_OK; m++) {
+            tm_preprocess(&mdl[m], TMPP_UINT2INT, &in_uint8, &in[m]);
+            uint64_t t = host_time_ns();
+            res = tm_run(&mdl[m], &in[m], outs[m]);
+            t = host_time_ns() - t;
+            if(ns[m] == 0 || t < ns[m]) ns[m] = t;
+        }
+    }
+    for(int m = 0; m < 2 && res == TM_OK; m++) {
+        int unit = (mdl[m].b->out_deq && TM_MDL_TYPE != TM_MDL_FP32) ? sizeof(float) : sizeof(mtype_t);
+        crc[m] = crc32((uint8_t*)outs[m][0].data, outs[m][0].h*outs[m][0].w*outs[m][0].c*unit);
+    }
+    tm_unload(&mdl[0]);
+    tm_unload(&mdl[1]);
+    return res;
+}
+
+//the opt model has to give the same output in less buffer
+static int bench_pairs_run(void)
+{
+    int err = 0;
+    if(!bench_quiet) printf("%-16s %10s %10s %10s %10s\n", "model", "buf", "opt buf", "ms", "opt ms");
+    for(int i = 0; i < (int)(sizeof(bench_pairs)/sizeof(bench_pairs[0])); i++) {
+        const bench_pair_t* p = &bench_pairs[i];
+        uint64_t ns[2];
+        uint32_t crc[2];
+        if(bench_pair_run(p, ns, crc) != TM_OK) {
+            printf("%s: run err\n", p->name);
+            return -1;
+        }
+        uint32_t buf0 = ((tm_mdlbin_t*)p->base)->buf_size, buf1 = ((tm_mdlbin_t*)p->opt)->buf_size;
+        if(bench_quiet)
+            printf("%-16s %10u %10u  %08x %s\n", p->name, buf0, buf1, crc[1], crc[0] == crc[1] ? "same" : "DIFF");
+        else
+            printf("%-16s %10u %10u %10.3f %10.3f  %08x %s\n", p->name, buf0, buf1, ns[0]/1e6, ns[1]/1e6, crc[1],
+                crc[0] == crc[1] ? "same" : "DIFF");
+        if(crc[0] != crc[1] || buf1 > buf0) err = -1;
+    }
+    return err;
+}
+
+/******************************* SHAPES ************************************/
+typedef struct {
+    uint16_t h, w, chi, cho;
+    uint8_t  k, s, pad, act;
+} bench_shape_t;
+
+//odd channel counts, k not a multiple of 4, pixel and channel tails, stride, pad, several weight tiles
+static const bench_shape_t bench_shapes[] = {
+    {32, 32,   3,  16, 3, 2, 1, TM_ACT_RELU},   //first layer, k=27
+    {15, 13,   5,  11, 3, 1, 1, TM_ACT_RELU6},
+    {16, 16,   8,  24, 3, 1, 0, TM_ACT_NONE},   //valid
+    {12, 12,  64, 100, 3, 1, 1, TM_ACT_RELU},   //k=576, cho over a weight tile
+    {9,   9,  17,  33, 5, 2, 2, TM_ACT_RELU},   //5x5
+    {16, 16,  16,  32, 1, 1, 0, TM_ACT_RELU},   //pwconv, rows in place
+    {16, 16,  17,  33, 1, 1, 0, TM_ACT_RELU6},  //pwconv, odd chi
+    {15, 15,  32,  64, 1, 2, 0, TM_ACT_NONE},   //pwconv, stride 2
+    {7,   7, 256, 256, 1, 1, 0, TM_ACT_RELU},   //pwconv, k=256, 4 weight tiles
+    {3,   5, 512, 129, 1, 1, 0, TM_ACT_RELU},   //pwconv, k=512
+};
+
+static uint32_t bench_rand(void)
+{
+    static uint32_t x = 2463534242u;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    return x;
+}
+
+static int bench_shapes_run(void)
+{
+    static mtype_t in_buf[32*32*512], out_buf[32*32*256];
+    static wtype_t w_buf[256*256*9];
+    static btype_t b_buf[TM_MAX_CSIZE];
+    static sctype_t ws_buf[TM_MAX_CSIZE];
+
+    for(int n = 0; n < (int)(sizeof(bench_shapes)/sizeof(bench_shapes[0])); n++) {
+        const bench_shape_t* s = &bench_shapes[n];
+        int oh = (s->h + 2*s->pad - s->k)/s->s + 1;
+        int ow = (s->w + 2*s->pad - s->k)/s->s + 1;
+        tm_mat_t in  = {3, s->h, s->w, s->chi, {in_buf}};
+        tm_mat_t out = {3, oh, ow, s->cho, {out_buf}};
+        for(int i = 0; i < s->h*s->w*s->chi; i++) in_buf[i] = bench_rand();
+        for(int i = 0; i < s->cho*s->chi*s->k*s->k; i++) w_buf[i] = bench_rand();
+        for(int c = 0; c < s->cho; c++) {
+            b_buf[c]  = (int32_t)(bench_rand() % 20001) - 10000;
+            ws_buf[c] = 0.002f + (bench_rand() % 1000)*0.00001f;
+        }
+        memset(out_buf, 0, sizeof(out_buf));
+        uint64_t t = host_time_ns();
+        tm_err_t res = TM_OK;
+        for(int r = 0; r < bench_runs && res == TM_OK; r++)
+            res = tml_conv2d_dwconv2d(&in, &out, w_buf, b_buf, s->k, s->k, s->s, s->s, 1, 1, s->act,
+                s->pad, s->pad, s->pad, s->pad, 0, ws_buf, 0.02f, -3, 0.05f, 5);
+        t = host_time_ns() - t;
+        if(res != TM_OK) {
+            printf("shape %d: err %d\n", n, res);
+            return -1;
+        }
+        if(bench_quiet)
+            printf("shape %2d %3dx%-3dx%-3d k%d s%d -> %3d  %08x\n", n, s->h, s->w, s->chi, s->k, s->s, s->cho,
+                crc32((uint8_t*)out_buf, oh*ow*s->cho));
+        else
+            printf("shape %2d %3dx%-3dx%-3d k%d s%d -> %3d  %10.1f us  %08x\n", n, s->h, s->w, s->chi, s->k, s->s, s->cho,
+                t/1000.0/bench_runs, crc32((uint8_t*)out_buf, oh*ow*s->cho));
+    }
+    return 0;
+}
+
+static void usage(void)
+{
+    printf("usage: tm_bench [-n runs] [-q] [-t] [-p]\n"
+           "  -q  crc only, for comparing builds\n"
+           "  -t  conv/pwconv shapes instead of the models\n"
+           "  -p  the models against their tmdl_opt.py versions\n");
+}
+
+int main(int argc, char** argv)
+{
+    int opt, shapes = 0, pairs = 0;
+    while((opt = getopt(argc, argv, "n:qtph")) != -1) {
+        switch(opt) {
+        case 'n': bench_runs = atoi(optarg); break;
+        case 'q': bench_quiet = 1; break;
+        case 't': shapes = 1; break;
+        case 'p': pairs = 1; break;
+        default: usage(); return 1;
+        }
+    }
+    if(bench_runs < 1) {
+        usage();
+        return 1;
+    }
+    if(shapes) return bench_shapes_run() ? 1 : 0;
+    if(pairs)  return bench_pairs_run() ? 1 : 0;
+    for(int i = 0; i < (int)(sizeof(bench_mdls)/sizeof(bench_mdls[0])); i++)
+        if(bench_model(&bench_mdls[i])) return 1;
+    return 0;
+}
@@ -0,0 +1,469 @@
+/* Copyright 2022 Sipeed Technology Co., Ltd. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+// host test of dilated conv/dwconv, depth multiplier, pool, concat, mul, resize and hard-swish:
+// each layer against a plain C copy of the TFLite reference op on random data, int8 within 1 LSB,
+// fp32 within float rounding; conv+ADD and FC+softmax against the two layers they fuse; then through tm_load/tm_run the convert-then-run cases of mk_convert.py in
+// convert/, and the TFLite interpreter goldens in golden/, if tools/layer_golden.py has made them
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "tinymaix.h"
+
+#if TM_MDL_TYPE == TM_MDL_INT8
+    #define GOLDEN_CASES_H "golden/cases_q.h"
+    #include "convert/cases_q.h"
+#else
+    #define GOLDEN_CASES_H "golden/cases_f.h"
+    #include "convert/cases_f.h"
+#endif
+#if defined(__has_include)
+#if __has_include(GOLDEN_CASES_H)
+    #include GOLDEN_CASES_H
+    #define TEST_GOLDEN 1
+#endif
+#endif
+#ifndef TEST_GOLDEN
+    #define GOLDEN_CASES
+#endif
+
+#define TEST_BUF (32*32*64)
+
+static mtype_t   in_buf[TEST_BUF], in1_buf[TEST_BUF], out_buf[TEST_BUF], ref_buf[TEST_BUF];
+static float     real_buf[TEST_BUF];
+static wtype_t   w_buf[64*64*25];
+static btype_t   b_buf[TM_MAX_CSIZE];
+static sctype_t  ws_buf[TM_MAX_CSIZE];
+static int       test_fail = 0;
+
+static uint32_t test_rand(void)
+{
+    static uint32_t x = 2463534242u;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    return x;
+}
+
+static float rand_f(float lo, float hi)
+{
+    return lo + (hi-lo)*(test_rand() % 10001)/10000.f;
+}
+
+#if TM_MDL_TYPE == TM_MDL_INT8
+//TFLite requantize: round half away from zero, saturate
+static mtype_t ref_quant(float x, float s, int zp)
+{
+    float q = roundf(x/s) + zp;
+    return q < -128 ? -128 : (q > 127 ? 127 : (mtype_t)q);
+}
+static float ref_deq(mtype_t q, float s, int zp) { return (q - zp)*s; }
+static mtype_t rand_m(void) { return (int8_t)test_rand(); }
+#else
+static mtype_t ref_quant(float x, float s, int zp) { return x; }
+static float ref_deq(mtype_t q, float s, int zp) { return q; }
+static mtype_t rand_m(void) { return rand_f(-4.f, 4.f); }
+#endif
+
+static void rand_fill(mtype_t* p, int n)
+{
+    for(int i = 0; i < n; i++) p[i] = rand_m();
+}
+
+//int8: 1 LSB; fp32: relative to the largest output
+static void check(const char* name, tm_err_t res, mtype_t* out, mtype_t* ref, int n)
+{
+    float maxd = 0, maxv = 0;
+    for(int i = 0; i < n; i++) {
+        float d = fabsf((float)out[i] - (float)ref[i]);
+        if(d > maxd) maxd = d;
+        if(fabsf((float)ref[i]) > maxv) maxv = fabsf((float)ref[i]);
+    }
+#if TM_MDL_TYPE == TM_MDL_INT8
+    int bad = res != TM_OK || maxd > 1;
+#else
+    int bad = res != TM_OK || maxd > 1e-5f*(1 + maxv);
+#endif
+    printf("%-30s %s  max diff %g\n", name, res != TM_OK ? "ERR " : (bad ? "FAIL" : "ok  "), maxd);
+    test_fail += bad;
+}
+
+static void rand_weights(int wn, int cho)
+{
+    for(int i = 0; i < wn; i++) {
+    #if TM_MDL_TYPE == TM_MDL_INT8
+        w_buf[i] = (int8_t)(test_rand() % 31) - 15;
+    #else
+        w_buf[i] = rand_f(-1.f, 1.f);
+    #endif
+    }
+    for(int c = 0; c < cho; c++) {
+    #if TM_MDL_TYPE == TM_MDL_INT8
+        b_buf[c]  = (int32_t)(test_rand() % 2001) - 1000;
+    #else
+        b_buf[c]  = rand_f(-1.f, 1.f);
+    #endif
+        ws_buf[c] = rand_f(0.001f, 0.003f);
+    }
+}
+
+/******************************* CONV ************************************/
+typedef struct {
+    const char* name;
+    uint16_t h, w, chi, cho;
+    uint8_t  k, s, d, pad, dmul, act;
+} conv_case_t;
+
+static const conv_case_t conv_cases[] = {
+    {"conv 3x3 d2 same",          16, 16,  8, 16, 3, 1, 2, 2, 0, TM_ACT_RELU},
+    {"conv 3x3 s2 d3",            15, 13,  5,  7, 3, 2, 3, 3, 0, TM_ACT_RELU6},
+    {"conv 5x5 d2 valid",         12, 12,  4,  6, 5, 1, 2, 0, 0, TM_ACT_NONE},
+    {"conv 3x3 d2 gemm",          20, 20, 16, 32, 3, 1, 2, 2, 0, TM_ACT_RELU},
+    {"conv 3x3 d2 2x1 pad",       10, 11,  3,  8, 3, 1, 2, 1, 0, TM_ACT_NONE},
+    {"dwconv 3x3 d2 same",        16, 16,  8,  8, 3, 1, 2, 2, 1, TM_ACT_RELU},
+    {"dwconv 3x3 s2 d2",          11, 11,  5,  5, 3, 2, 2, 2, 1, TM_ACT_RELU6},
+    {"dwconv 5x5 d2 same",         9,  9,  8,  8, 5, 1, 2, 4, 1, TM_ACT_NONE},
+    {"dwconv 3x3 dmul2",          10,  9,  3,  6, 3, 1, 1, 1, 2, TM_ACT_RELU},
+    {"dwconv 3x3 s2 d2 dmul3",    11, 11,  5, 15, 3, 2, 2, 2, 3, TM_ACT_NONE},
+};
+
+static void test_conv(const conv_case_t* t)
+{
+    int ek = (t->k-1)*t->d + 1;
+    int oh = (t->h + 2*t->pad - ek)/t->s + 1;
+    int ow = (t->w + 2*t->pad - ek)/t->s + 1;
+    int maxk = t->k*t->k;
+    int chi = t->dmul ? 1 : t->chi;    //weight channels per output
+    float in_s = 0.03f, out_s;
+    int in_zp = -3, out_zp = 4;
+    tm_mat_t in  = {3, t->h, t->w, t->chi, {in_buf}};
+    tm_mat_t out = {3, oh, ow, t->cho, {out_buf}};
+
+    rand_fill(in_buf, t->h*t->w*t->chi);
+    rand_weights(t->cho*chi*maxk, t->cho);
+
+    //sum as the kernel: taps in the padding read in_zp, bias as given
+    float maxv = 0;
+    for(int y = 0; y < oh; y++) for(int x = 0; x < ow; x++) for(int co = 0; co < t->cho; co++) {
+        sumtype_t sum = b_buf[co];
+        for(int cc = 0; cc < chi; cc++) {
+            int ci = t->dmul ? co/t->dmul : cc;
+            for(int ky = 0; ky < t->k; ky++) for(int kx = 0; kx < t->k; kx++) {
+                int iy = y*t->s - t->pad + ky*t->d;
+                int ix = x*t->s - t->pad + kx*t->d;
+                int inside = iy >= 0 && iy < t->h && ix >= 0 && ix < t->w;
+            #if TM_MDL_TYPE == TM_MDL_INT8
+                sumtype_t v = inside ? in_buf[(iy*t->w + ix)*t->chi + ci] : in_zp;
+            #else
+                sumtype_t v = inside ? in_buf[(iy*t->w + ix)*t->chi + ci] : 0;
+            #endif
+                sum += v*w_buf[(co*chi + cc)*maxk + ky*t->k + kx];
+            }
+        }
+    #if TM_MDL_TYPE == TM_MDL_INT8
+        float r = sum*ws_buf[co]*in_s;
+        if(t->act == TM_ACT_RELU6) r = r > 6 ? 6 : r;
+    #else
+        float r = sum;      //fp32 conv takes relu6 as relu
+    #endif
+        if(t->act == TM_ACT_RELU || t->act == TM_ACT_RELU6) r = r > 0 ? r : 0;
+        real_buf[(y*ow + x)*t->cho + co] = r;
+        if(fabsf(r) > maxv) maxv = fabsf(r);
+    }
+    out_s = maxv > 0 ? maxv/100 : 1;   //keep the truncating int8 postprocess off the rails
+    for(int i = 0; i < oh*ow*t->cho; i++) ref_buf[i] = ref_quant(real_buf[i], out_s, out_zp);
+
+    tm_err_t res = tml_conv2d_dwconv2d(&in, &out, w_buf, b_buf, t->k, t->k, t->s, t->s, t->d, t->d, t->act,
+        t->pad, t->pad, t->pad, t->pad, t->dmul, ws_buf, in_s, in_zp, out_s, out_zp);
+    check(t->name, res, out_buf, ref_buf, oh*ow*t->cho);
+}
+
+/******************************* CONV+ADD ************************************/
+static const conv_case_t conv_add_cases[] = {
+    {"conv+add 1x1 gemm",          8,  8, 16, 32, 1, 1, 1, 0, 0, TM_ACT_NONE},
+    {"conv+add 1x1 relu",          5,  3,  8, 12, 1, 1, 1, 0, 0, TM_ACT_RELU},
+    {"conv+add 3x3 pad",          10,  9,  5,  8, 3, 1, 1, 1, 0, TM_ACT_RELU6},
+    {"dwconv+add 3x3 s1",         11,  7,  8,  8, 3, 1, 1, 1, 1, TM_ACT_NONE},
+    {"dwconv+add 3x3 s2",         11, 11,  6,  6, 3, 2, 1, 1, 1, TM_ACT_RELU},
+};
+
+//tml_conv2d_add against tml_conv2d_dwconv2d then tml_add: the same rounding, so the same output,
+//in place the ADD writes over in1 as the converter plans it
+static void test_conv_add(const conv_case_t* t, int add_act, int in_place)
+{
+    char name[64];
+    int ek = (t->k-1)*t->d + 1;
+    int oh = (t->h + 2*t->pad - ek)/t->s + 1;
+    int ow = (t->w + 2*t->pad - ek)/t->s + 1;
+    int n  = oh*ow*t->cho;
+    float in_s = 0.03f, conv_s = 0.2f, s0 = 0.25f, s1 = 0.1f, out_s = 0.15f;
+    int in_zp = -3, conv_zp = 5, zp0 = 1, zp1 = -9, out_zp = 2;
+    tm_mat_t in   = {3, t->h, t->w, t->chi, {in_buf}};
+    tm_mat_t in1  = {3, oh, ow, t->cho, {in1_buf}};
+    tm_mat_t ref  = {3, oh, ow, t->cho, {ref_buf}};
+    tm_mat_t out  = {3, oh, ow, t->cho, {in_place ? in1_buf : out_buf}};
+
+    rand_fill(in_buf, t->h*t->w*t->chi);
+    rand_fill(in1_buf, n);
+    rand_weights(t->cho*(t->dmul ? 1 : t->chi)*t->k*t->k, t->cho);
+    tm_err_t res = tml_conv2d_dwconv2d(&in, &ref, w_buf, b_buf, t->k, t->k, t->s, t->s, t->d, t->d, t->act,
+        t->pad, t->pad, t->pad, t->pad, t->dmul, ws_buf, in_s, in_zp, conv_s, conv_zp);
+    if(res == TM_OK) res = tml_add(&ref, &in1, &ref, add_act, s0, zp0, s1, zp1, out_s, out_zp);
+    if(res == TM_OK) res = tml_conv2d_add(&in, &in1, &out, w_buf, b_buf, t->k, t->k, t->s, t->s, t->d, t->d, t->act,
+        t->pad, t->pad, t->pad, t->pad, t->dmul, ws_buf, in_s, in_zp, conv_s, conv_zp, add_act, s0, zp0, s1, zp1, out_s, out_zp);
+    snprintf(name, sizeof(name), "%s%s", t->name, in_place ? " in place" : "");
+    check(name, res, out.data, ref_buf, n);
+}
+
+//tml_fc_softmax against tml_fc then tml_softmax
+static void test_fc_softmax(const char* name, int chi, int cho)
+{
+    float in_s = 0.04f, fc_s = 0.1f, out_s = 1/256.f;
+    int in_zp = 7, fc_zp = -4, out_zp = -128;
+    tm_mat_t in  = {1, 1, 1, chi, {in_buf}};
+    tm_mat_t fc  = {1, 1, 1, cho, {in1_buf}};
+    tm_mat_t ref = {1, 1, 1, cho, {ref_buf}};
+    tm_mat_t out = {1, 1, 1, cho, {out_buf}};
+
+    rand_fill(in_buf, chi);
+    rand_weights(chi*cho, cho);
+    ws_buf[0] = 0.002f;     //fc is per tensor
+    tm_err_t res = tml_fc(&in, &fc, w_buf, b_buf, ws_buf, in_s, in_zp, fc_s, fc_zp);
+    if(res == TM_OK) res = tml_softmax(&fc, &ref, fc_s, fc_zp, out_s, out_zp);
+    if(res == TM_OK) res = tml_fc_softmax(&in, &out, w_buf, b_buf, ws_buf, in_s, in_zp, fc_s, fc_zp, out_s, out_zp);
+    check(name, res, out_buf, ref_buf, cho);
+}
+
+/******************************* POOL ************************************/
+typedef struct {
+    const char* name;
+    uint16_t h, w, c;
+    uint8_t  k, s, pt, pb, pl, pr, is_max, same_q;
+} pool_case_t;
+
+static const pool_case_t pool_cases[] = {
+    {"maxpool 2x2 s2",            16, 16,  8, 2, 2, 0, 0, 0, 0, 1, 1},
+    {"maxpool 3x3 s2 same",       15, 15,  5, 3, 2, 1, 1, 1, 1, 1, 1},
+    {"maxpool 3x3 s1 requant",     9,  7,  3, 3, 1, 1, 1, 1, 1, 1, 0},
+    {"avgpool 2x2 s2",            16, 16,  8, 2, 2, 0, 0, 0, 0, 0, 1},
+    {"avgpool 3x3 s2 same",       14, 14, 16, 3, 2, 0, 1, 0, 1, 0, 1},
+    {"avgpool 5x5 s1 same",        9, 11,  3, 5, 1, 2, 2, 2, 2, 0, 1},
+    {"avgpool 3x3 s2 requant",    13, 13,  4, 3, 2, 1, 1, 1, 1, 0, 0},
+};
+
+static void test_pool(const pool_case_t* t)
+{
+    int oh = (t->h + t->pt + t->pb - t->k)/t->s + 1;
+    int ow = (t->w + t->pl + t->pr - t->k)/t->s + 1;
+    float in_s = 0.05f, out_s = t->same_q ? in_s : 0.04f;
+    int in_zp = 7, out_zp = t->same_q ? in_zp : -2;
+    tm_mat_t in  = {3, t->h, t->w, t->c, {in_buf}};
+    tm_mat_t out = {3, oh, ow, t->c, {out_buf}};
+
+    rand_fill(in_buf, t->h*t->w*t->c);
+    for(int y = 0; y < oh; y++) for(int x = 0; x < ow; x++) for(int c = 0; c < t->c; c++) {
+        float m = -FLT_MAX, sum = 0;
+        int cnt = 0;
+        for(int ky = 0; ky < t->k; ky++) for(int kx = 0; kx < t->k; kx++) {
+            int iy = y*t->s - t->pt + ky;
+            int ix = x*t->s - t->pl + kx;
+            if(iy < 0 || iy >= t->h || ix < 0 || ix >= t->w) continue;
+            float v = ref_deq(in_buf[(iy*t->w + ix)*t->c + c], in_s, in_zp);
+            m = v > m ? v : m;
+            sum += v;
+            cnt++;
+        }
+        ref_buf[(y*ow + x)*t->c + c] = ref_quant(t->is_max ? m : sum/cnt, out_s, out_zp);
+    }
+    tm_err_t res = tml_pool2d(&in, &out, t->k, t->k, t->s, t->s, t->pt, t->pb, t->pl, t->pr, t->is_max,
+        in_s, in_zp, out_s, out_zp);
+    check(t->name, res, out_buf, ref_buf, oh*ow*t->c);
+}
+
+/******************************* CONCAT ************************************/
+static void test_concat(const char* name, int h, int w, int c0, int c1, int in1_first, int same_q)
+{
+    float s0 = 0.05f, s1 = same_q ? s0 : 0.08f, out_s = same_q ? s0 : 0.07f;
+    int zp0 = -5, zp1 = same_q ? zp0 : 11, out_zp = same_q ? zp0 : 2;
+    tm_mat_t in0 = {3, h, w, c0, {in_buf}};
+    tm_mat_t in1 = {3, h, w, c1, {in1_buf}};
+    tm_mat_t out = {3, h, w, c0+c1, {out_buf}};
+
+    rand_fill(in_buf, h*w*c0);
+    rand_fill(in1_buf, h*w*c1);
+    for(int p = 0; p < h*w; p++) {
+        mtype_t* r = ref_buf + p*(c0+c1);
+        for(int c = 0; c < c0; c++)
+            r[(in1_first ? c1 : 0) + c] = ref_quant(ref_deq(in_buf[p*c0 + c], s0, zp0), out_s, out_zp);
+        for(int c = 0; c < c1; c++)
+            r[(in1_first ? 0 : c0) + c] = ref_quant(ref_deq(in1_buf[p*c1 + c], s1, zp1), out_s, out_zp);
+    }
+    tm_err_t res = tml_concat(&in0, &in1, &out, in1_first, s0, zp0, s1, zp1, out_s, out_zp);
+    check(name, res, out_buf, ref_buf, h*w*(c0+c1));
+}
+
+/******************************* MUL ************************************/
+static void test_mul(const char* name, int h, int w, int c, int h1, int w1, int c1, int swap, int act)
+{
+    float s0 = 0.04f, s1 = 0.03f, out_s = 0.05f;
+    int zp0 = 3, zp1 = -7, out_zp = -1;
+    tm_mat_t in0 = {3, h, w, c, {in_buf}};
+    tm_mat_t in1 = {3, h1, w1, c1, {in1_buf}};
+    tm_mat_t out = {3, h, w, c, {out_buf}};
+    if(swap) {      //the broadcast one as input0
+        in0 = (tm_mat_t){3, h1, w1, c1, {in1_buf}};
+        in1 = (tm_mat_t){3, h, w, c, {in_buf}};
+    }
+
+    rand_fill(in_buf, h*w*c);
+    rand_fill(in1_buf, h1*w1*c1);
+    for(int y = 0; y < h; y++) for(int x = 0; x < w; x++) for(int ch = 0; ch < c; ch++) {
+        int i1 = ((h1 == 1 ? 0 : y)*w1 + (w1 == 1 ? 0 : x))*c1 + (c1 == 1 ? 0 : ch);
+        float a = ref_deq(in_buf[(y*w + x)*c + ch], swap ? s1 : s0, swap ? zp1 : zp0);
+        float b = ref_deq(in1_buf[i1], swap ? s0 : s1, swap ? zp0 : zp1);
+        float v = a*b;
+        if(act == TM_ACT_RELU || act == TM_ACT_RELU6) v = v > 0 ? v : 0;
+        if(act == TM_ACT_RELU6) v = v < 6 ? v : 6;
+        ref_buf[(y*w + x)*c + ch] = ref_quant(v, out_s, out_zp);
+    }
+    tm_err_t res = tml_mul(&in0, &in1, &out, act, s0, zp0, s1, zp1, out_s, out_zp);
+    check(name, res, out_buf, ref_buf, h*w*c);
+}
+
+/******************************* RESIZE ************************************/
+//tensorflow/lite/kernels/internal/reference/resize_nearest_neighbor.h, resize_bilinear.h
+static int ref_nearest(int o, int in_size, int out_size, int align_corners, int half_pixel)
+{
+    float scale = (align_corners && out_size > 1) ? (in_size-1)/(float)(out_size-1) : in_size/(float)out_size;
+    float offset = half_pixel ? 0.5f : 0.0f;
+    int v = align_corners ? (int)roundf((o + offset)*scale) : (int)floorf((o + offset)*scale);
+    v = v < in_size-1 ? v : in_size-1;
+    if(half_pixel) v = v > 0 ? v : 0;
+    return v;
+}
+
+static void ref_interp(int o, int in_size, int out_size, int align_corners, int half_pixel, float* v, int* lo, int* hi)
+{
+    float scale = (align_corners && out_size > 1) ? (in_size-1)/(float)(out_size-1) : in_size/(float)out_size;
+    *v = half_pixel ? (o + 0.5f)*scale - 0.5f : o*scale;
+    *lo = (int)floorf(*v) > 0 ? (int)floorf(*v) : 0;
+    *hi = (int)ceilf(*v) < in_size-1 ? (int)ceilf(*v) : in_size-1;
+}
+
+static void test_resize(const char* name, int h, int w, int c, int oh, int ow, int mode, int align_corners, int half_pixel)
+{
+    float s = 0.06f;
+    int zp = -9;
+    tm_mat_t in  = {3, h, w, c, {in_buf}};
+    tm_mat_t out = {3, oh, ow, c, {out_buf}};
+
+    rand_fill(in_buf, h*w*c);
+    for(int y = 0; y < oh; y++) for(int x = 0; x < ow; x++) for(int ch = 0; ch < c; ch++) {
+        float v;
+        if(mode == TM_RESIZE_NEAREST) {
+            int iy = ref_nearest(y, h, oh, align_corners, half_pixel);
+            int ix = ref_nearest(x, w, ow, align_corners, half_pixel);
+            v = ref_deq(in_buf[(iy*w + ix)*c + ch], s, zp);
+        } else {
+            float fy, fx;
+            int y0, y1, x0, x1;
+            ref_interp(y, h, oh, align_corners, half_pixel, &fy, &y0, &y1);
+            ref_interp(x, w, ow, align_corners, half_pixel, &fx, &x0, &x1);
+            v = ref_deq(in_buf[(y0*w + x0)*c + ch], s, zp)*(1 - (fy - y0))*(1 - (fx - x0)) +
+                ref_deq(in_buf[(y1*w + x0)*c + ch], s, zp)*(fy - y0)*(1 - (fx - x0)) +
+                ref_deq(in_buf[(y0*w + x1)*c + ch], s, zp)*(1 - (fy - y0))*(fx - x0) +
+                ref_deq(in_buf[(y1*w + x1)*c + ch], s, zp)*(fy - y0)*(fx - x0);
+        }
+        ref_buf[(y*ow + x)*c + ch] = ref_quant(v, s, zp);
+    }
+    tm_err_t res = tml_resize(&in, &out, mode, align_corners, half_pixel, s, zp, s, zp);
+    check(name, res, out_buf, ref_buf, oh*ow*c);
+}
+
+/******************************* HARD-SWISH ************************************/
+static void test_hardswish(const char* name, int n)
+{
+    float in_s = 0.05f, out_s = 0.03f;
+    int in_zp = 10, out_zp = -40;
+    tm_mat_t in  = {3, 1, 1, n, {in_buf}};
+    tm_mat_t out = {3, 1, 1, n, {out_buf}};
+
+    rand_fill(in_buf, n);
+    for(int i = 0; i < n; i++) {
+        float x = ref_deq(in_buf[i], in_s, in_zp);
+        float r6 = x + 3 > 0 ? (x + 3 < 6 ? x + 3 : 6) : 0;
+        ref_buf[i] = ref_quant(x*r6/6, out_s, out_zp);
+    }
+    tm_err_t res = tml_hardswish(&in, &out, in_s, in_zp, out_s, out_zp);
+    check(name, res, out_buf, ref_buf, n);
+}
+
+/******************************* GOLDEN ************************************/
+typedef struct {
+    const char*    name;
+    const uint8_t* mdl;
+    const mtype_t* in;
+    const mtype_t* out;
+    int            out_n;
+} golden_case_t;
+
+#define GOLDEN_CASE(x) {"tflite " #x, golden_##x##_mdl, golden_##x##_in, golden_##x##_out, sizeof(golden_##x##_out)/sizeof(mtype_t)},
+#define CONVERT_CASE(x) {"convert " #x, convert_##x##_mdl, convert_##x##_in, convert_##x##_out, sizeof(convert_##x##_out)/sizeof(mtype_t)},
+static const golden_case_t golden_cases[] = { CONVERT_CASES GOLDEN_CASES };
+
+static void test_golden(const golden_case_t* g)
+{
+    tm_mdl_t mdl;
+    tm_mat_t in, outs[1];
+    const char* name = g->name;
+    tm_err_t res = tm_load(&mdl, g->mdl, NULL, NULL, &in);
+    if(res != TM_OK) {
+        check(name, res, (mtype_t*)g->out, (mtype_t*)g->out, g->out_n);
+        return;
+    }
+    memcpy(in.data, g->in, in.h*in.w*in.c*sizeof(mtype_t));
+    res = tm_run(&mdl, &in, outs);
+    if(res == TM_OK && outs[0].h*outs[0].w*outs[0].c != g->out_n) res = TM_ERR_DIMS;
+    check(name, res, res == TM_OK ? outs[0].data : (mtype_t*)g->out, (mtype_t*)g->out, g->out_n);
+    tm_unload(&mdl);
+}
+
+int main(int argc, char** argv)
+{
+    for(int i = 0; i < (int)(sizeof(conv_cases)/sizeof(conv_cases[0])); i++) test_conv(&conv_cases[i]);
+    const int add_acts[] = {TM_ACT_NONE, TM_ACT_RELU, TM_ACT_RELU6};
+    for(int i = 0; i < (int)(sizeof(conv_add_cases)/sizeof(conv_add_cases[0])); i++)
+        test_conv_add(&conv_add_cases[i], add_acts[i % 3], 0);
+    test_conv_add(&conv_add_cases[0], TM_ACT_RELU6, 1);
+    test_conv_add(&conv_add_cases[3], TM_ACT_RELU, 1);
+    test_fc_softmax("fc+softmax",            64, 10);
+    test_fc_softmax("fc+softmax 1000",       64, 1000);
+    for(int i = 0; i < (int)(sizeof(pool_cases)/sizeof(pool_cases[0])); i++) test_pool(&pool_cases[i]);
+    test_concat("concat",                     8,  8, 16,  8, 0, 1);
+    test_concat("concat in1 first requant",   7,  5,  3, 13, 1, 0);
+    test_mul("mul",                          8,  8, 16,  8,  8, 16, 0, TM_ACT_NONE);
+    test_mul("mul 1x1xc relu6",              8,  8, 16,  1,  1, 16, 0, TM_ACT_RELU6);
+    test_mul("mul 1x1xc as in0 relu",        6,  5,  7,  1,  1,  7, 1, TM_ACT_RELU);
+    test_mul("mul hxwx1",                    6,  5,  7,  6,  5,  1, 0, TM_ACT_NONE);
+    test_resize("nearest 2x half_pixel",     8,  8,  4, 16, 16, TM_RESIZE_NEAREST,  0, 1);
+    test_resize("nearest 5->9 align",        5,  5,  3,  9,  9, TM_RESIZE_NEAREST,  1, 0);
+    test_resize("nearest 12->7",            12, 12,  3,  7,  7, TM_RESIZE_NEAREST,  0, 0);
+    test_resize("bilinear 2x half_pixel",    8,  6,  4, 16, 12, TM_RESIZE_BILINEAR, 0, 1);
+    test_resize("bilinear 5->9 align",       5,  5,  3,  9,  9, TM_RESIZE_BILINEAR, 1, 0);
+    test_resize("bilinear 12->7",           12, 10,  3,  7,  6, TM_RESIZE_BILINEAR, 0, 0);
+    test_hardswish("hard-swish", 4096);
+    for(int i = 0; i < (int)(sizeof(golden_cases)/sizeof(golden_cases[0])); i++) test_golden(&golden_cases[i]);
+#ifndef TEST_GOLDEN
+    printf("no %s, run tools/layer_golden.py for the TFLite goldens\n", GOLDEN_CASES_H);
+#endif
+    printf("%s\n", test_fail ? "FAILED" : "all ok");
+    return test_fail ? 1 : 0;
+}
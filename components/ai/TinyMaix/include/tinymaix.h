@@ -32,6 +32,7 @@ limitations under the License.
 #define TM_ALIGN(addr)  ((((size_t)(addr))+(TM_ALIGN_SIZE-1))/TM_ALIGN_SIZE*TM_ALIGN_SIZE)
 #define TM_MATP(mat,y,x,ch) ((mat)->data + ((y)*(mat)->w + (x))*(mat)->c + (ch))
                                 //HWC
+#define TM_GROUP_MAXCNT (8)     //max layers in a TML_GROUP
 #if   TM_MDL_TYPE == TM_MDL_INT8
     typedef int8_t  mtype_t;    //mat data type
     typedef int8_t  wtype_t;    //weight data type
@@ -112,6 +113,13 @@ typedef enum{
     TML_RESHAPE   = 4,
     TML_DWCONV2D  = 5,
     TML_ADD       = 6,
+    TML_MAXPOOL   = 7,
+    TML_AVGPOOL   = 8,
+    TML_CONCAT    = 9,
+    TML_MUL       = 10,
+    TML_RESIZE    = 11,
+    TML_HARDSWISH = 12,
+    TML_GROUP     = 13,
     TML_MAXCNT    ,
 }tm_layer_type_t;
 
@@ -120,6 +128,11 @@ typedef enum{
     TM_PAD_SAME   = 1,
 }tm_pad_type_t;
 
+typedef enum{
+    TM_RESIZE_NEAREST  = 0,
+    TM_RESIZE_BILINEAR = 1,
+}tm_resize_type_t;
+
 typedef enum{
     TM_ACT_NONE   = 0,
     TM_ACT_RELU   = 1,
@@ -275,9 +288,63 @@ typedef struct{
     uint32_t in_oft1;
     sctype_t in_s1;          //input scale, 
     zptype_t in_zp1;         //input zeropoint
-    uint32_t reserve;        //align8
+    uint32_t act;            //0 none, 1 relu, 3 relu6
 }tml_add_t;
 
+typedef struct{
+    tml_head_t h;
+
+    uint8_t  kernel_w;
+    uint8_t  kernel_h;
+    uint8_t  stride_w;
+    uint8_t  stride_h;
+    uint8_t  pad[4];        //top,bottom,left,right
+}tml_pool_t;  //compatible with maxpool and avgpool
+
+typedef struct{
+    tml_head_t h;           //in_dims is input0, out_dims is the concat
+    uint32_t in_oft1;
+    sctype_t in_s1;          //input1 scale, 
+    zptype_t in_zp1;         //input1 zeropoint
+    uint16_t in_c1;          //input1 channels, same h,w as input0
+    uint16_t in1_first;      //1: input1 channels go before input0's
+}tml_concat_t; //concat on channel
+
+typedef struct{
+    tml_head_t h;           //in_dims is input0, out_dims is the product
+    uint32_t in_oft1;        //in buf, or from the layer head if in1_const
+    sctype_t in_s1;          //input1 scale, 
+    zptype_t in_zp1;         //input1 zeropoint
+    uint16_t in_dims1[4];    //same as out_dims, or 1,1,c broadcast on h,w
+    uint16_t act;            //0 none, 1 relu, 3 relu6
+    uint16_t in1_const;      //1: input1 is constant data in the layer body
+}tml_mul_t;
+
+typedef struct{
+    tml_head_t h;
+    uint8_t  mode;           //0 nearest, 1 bilinear
+    uint8_t  align_corners;
+    uint8_t  half_pixel;     //half_pixel_centers
+    uint8_t  reserve[5];     //align8
+}tml_resize_t; //upsample or downsample on h,w
+
+typedef struct{
+    tml_head_t h;
+}tml_hardswish_t;
+
+typedef struct{
+    tml_head_t h;           //in of the first member, out of the last
+    uint16_t cnt;           //member layers, they follow this head
+    uint16_t band;          //output rows of the last member per step
+    uint32_t reserve;       //align8
+}tml_group_t; //chain of conv/pool and rowwise layers run band by band, the members in between
+              //write line buffers of the rows still needed, at their out_oft
+
+//group members run as one, the first has no line buffer: a conv and the ADD of its output
+//(tml_conv2d_add), FC and the softmax of its output (tml_fc_softmax)
+#define TML_GROUP_FUSED(a, b) ((((a)->type == TML_CONV2D || (a)->type == TML_DWCONV2D) && (b)->type == TML_ADD) || \
+                               ((a)->type == TML_FC && (b)->type == TML_SOFTMAX))
+
 
 /******************************* TYPE ************************************/
 typedef tm_err_t (*tml_stat_t)(tml_head_t* layer, tm_mat_t* in, tm_mat_t* out);
@@ -304,12 +371,73 @@ tm_err_t tml_fc(tm_mat_t* in, tm_mat_t* out,  wtype_t* w, btype_t* b, \
     sctype_t* ws, sctype_t in_s, zptype_t in_zp, sctype_t out_s, zptype_t out_zp);
 tm_err_t tml_softmax(tm_mat_t* in, tm_mat_t* out, sctype_t in_s, zptype_t in_zp, sctype_t out_s, zptype_t out_zp);
 tm_err_t tml_reshape(tm_mat_t* in, tm_mat_t* out, sctype_t in_s, zptype_t in_zp, sctype_t out_s, zptype_t out_zp);
-tm_err_t tml_add(tm_mat_t* in0, tm_mat_t* in1, tm_mat_t* out, \
+tm_err_t tml_add(tm_mat_t* in0, tm_mat_t* in1, tm_mat_t* out, int act, \
     sctype_t in_s0, zptype_t in_zp0, sctype_t in_s1, zptype_t in_zp1, sctype_t out_s, zptype_t out_zp);
+tm_err_t tml_pool2d(tm_mat_t* in, tm_mat_t* out, int kw, int kh, int sx, int sy, \
+    int pad_top, int pad_bottom, int pad_left, int pad_right, int is_max, \
+    sctype_t in_s, zptype_t in_zp, sctype_t out_s, zptype_t out_zp);
+tm_err_t tml_concat(tm_mat_t* in0, tm_mat_t* in1, tm_mat_t* out, int in1_first, \
+    sctype_t in_s0, zptype_t in_zp0, sctype_t in_s1, zptype_t in_zp1, sctype_t out_s, zptype_t out_zp);
+tm_err_t tml_mul(tm_mat_t* in0, tm_mat_t* in1, tm_mat_t* out, int act, \
+    sctype_t in_s0, zptype_t in_zp0, sctype_t in_s1, zptype_t in_zp1, sctype_t out_s, zptype_t out_zp);
+tm_err_t tml_resize(tm_mat_t* in, tm_mat_t* out, int mode, int align_corners, int half_pixel, \
+    sctype_t in_s, zptype_t in_zp, sctype_t out_s, zptype_t out_zp);
+tm_err_t tml_hardswish(tm_mat_t* in, tm_mat_t* out, sctype_t in_s, zptype_t in_zp, sctype_t out_s, zptype_t out_zp);
+//conv then ADD of in1 and add_act, the conv output (conv_s, conv_zp) is added in the conv postprocess and never
+//stored, read back as the ADD's input 0 (in_s0, in_zp0); in1 may be out. Same result as tml_conv2d_dwconv2d and tml_add
+tm_err_t tml_conv2d_add(tm_mat_t* in, tm_mat_t* in1, tm_mat_t* out, wtype_t* w, btype_t* b, \
+    int kw, int kh, int sx, int sy, int dx, int dy, int act, \
+    int pad_top, int pad_bottom, int pad_left, int pad_right, int dmul, \
+    sctype_t* ws, sctype_t in_s, zptype_t in_zp, sctype_t conv_s, zptype_t conv_zp, \
+    int add_act, sctype_t in_s0, zptype_t in_zp0, sctype_t in_s1, zptype_t in_zp1, sctype_t out_s, zptype_t out_zp);
+//FC then softmax, the logits (fc_s, fc_zp) go to the float softmax buffer as they are made.
+//Same result as tml_fc and tml_softmax
+tm_err_t tml_fc_softmax(tm_mat_t* in, tm_mat_t* out,  wtype_t* w, btype_t* b, \
+    sctype_t* ws, sctype_t in_s, zptype_t in_zp, sctype_t fc_s, zptype_t fc_zp, sctype_t out_s, zptype_t out_zp);
+#if TM_OPT_LEVEL == TM_OPT2
+tm_err_t tml_conv2d_gemm(tm_mat_t* in, tm_mat_t* out, wtype_t* w, btype_t* b, \
+    int kw, int kh, int sx, int sy, int dx, int dy, int act, \
+    int pad_top, int pad_bottom, int pad_left, int pad_right, int dmul, \
+    sctype_t* ws, sctype_t in_s, zptype_t in_zp, sctype_t out_s, zptype_t out_zp);
+#endif
 
 /******************************* STAT FUNCTION ************************************/
 #if TM_ENABLE_STAT
 tm_err_t tm_stat(tm_mdlbin_t* mdl);                    //stat model
+
+//layer profiler: tm_prof_cb as the tm_load callback (or called from yours),
+//tm_prof_start/tm_prof_end around tm_run, best cycles of each layer over the runs
+typedef enum {
+    TM_PROF_TABLE = 0,
+    TM_PROF_CSV   = 1,
+    TM_PROF_JSON  = 2,
+} tm_prof_fmt_t;
+
+typedef struct{
+    uint16_t type;          //layer type, TML_GROUP for a group
+    uint16_t out_dims[4];
+    uint16_t reserve;
+    uint32_t rd_bytes;      //activations and params one run reads
+    uint32_t wr_bytes;      //activations one run writes, a group counts its line buffers
+    uint64_t ops;           //MAC for conv/fc, compare or add for pool/gap
+    uint64_t cycles;        //best of the runs, TM_GET_CYCLE ticks
+}tm_prof_layer_t;
+
+typedef struct{
+    const char*      name;  //model name in the output
+    tm_prof_layer_t* layers;//layer_cnt of them
+    int      layer_cnt;
+    int      runs;
+    uint64_t t0;            //end of the last layer
+    uint64_t run_t0;        //start of this run
+    uint64_t cycles;        //best whole run
+}tm_prof_t;
+
+tm_err_t tm_prof_init (tm_prof_t* p, const char* name, tm_mdl_t* mdl, tm_prof_layer_t* layers, int cnt);
+void     tm_prof_start(tm_prof_t* p);
+tm_err_t tm_prof_cb   (tm_mdl_t* mdl, tml_head_t* lh);
+void     tm_prof_end  (tm_prof_t* p);
+void     tm_prof_print(tm_prof_t* p, tm_prof_fmt_t fmt);
 #endif
 
 /******************************* UTILS FUNCTION ************************************/
@@ -333,6 +461,46 @@ float TM_WEAK tm_fp8to32(uint8_t fp8);
     #define TM_QUANT(x,s,zp)    (x)
 #endif
 
+/******************************* CONV EPILOGUE  ************************************/
+#if (TM_MDL_TYPE != TM_MDL_FP8_143) && (TM_MDL_TYPE != TM_MDL_FP8_152)
+//the ADD of tml_conv2d_add, set for that call only: TM_POSTPROCESS adds in1 to each conv output
+typedef struct{
+    mtype_t* out;           //conv output, in1 has its layout
+    mtype_t* in1;           //NULL: conv alone
+    int      act;
+    sctype_t in_s0;         //ADD input quant of the conv output
+    zptype_t in_zp0;
+    sctype_t in_s1;
+    zptype_t in_zp1;
+    sctype_t out_s;
+    zptype_t out_zp;
+}tm_epi_t;
+extern tm_epi_t tm_epi;
+
+#define TM_EPI_MAXN (16)    //most outputs of one postprocess call: BATCH_SIZE, TM_GEMM_NR
+
+//tm_postprocess_sum of the conv kernels, with the ADD of tm_epi if set: the conv outputs stay in a
+//local and each in1 is read before its out is written, so in1 may be out
+#define TM_POSTPROCESS(n, sums, bs, act_, outp, scales, os_, ozp_) do{ \
+    if(tm_epi.in1 == NULL) { \
+        tm_postprocess_sum(n, sums, bs, act_, outp, scales, os_, ozp_); \
+    } else { \
+        mtype_t _q[TM_EPI_MAXN]; \
+        mtype_t* _o = (outp); \
+        mtype_t* _r = tm_epi.in1 + (_o - tm_epi.out); \
+        tm_postprocess_sum(n, sums, bs, act_, _q, scales, os_, ozp_); \
+        for(int _i = 0; _i < (n); _i++) { \
+            float _v = TM_DEQUANT(_q[_i], tm_epi.in_s0, tm_epi.in_zp0) + TM_DEQUANT(_r[_i], tm_epi.in_s1, tm_epi.in_zp1); \
+            if(tm_epi.act == TM_ACT_RELU) _v = _v > 0 ? _v : 0; \
+            else if(tm_epi.act == TM_ACT_RELU6) _v = _v > 0 ? (_v < 6 ? _v : 6) : 0; \
+            _o[_i] = TM_QUANT(_v, tm_epi.out_s, tm_epi.out_zp); \
+        } \
+    } \
+}while(0)
+#else
+#define TM_POSTPROCESS tm_postprocess_sum
+#endif
+
 /******************************* LOCAL MATH FUNCTION  ************************************/
 #if TM_LOCAL_MATH
 //http://www.machinedlearnings.com/2011/06/fast-approximate-logarithm-exponential.html
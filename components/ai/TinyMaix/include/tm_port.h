@@ -21,21 +21,29 @@ limitations under the License.
 #define TM_ARCH_RV64V       (5) //T-head C906,C910, etc.
 #define TM_ARCH_CSKYV2      (6) //cskyv2 with dsp core
 #define TM_ARCH_X86_SSE2    (7) //x86 sse2
+#define TM_ARCH_RVV         (8) //RVV 1.0 cores, VLEN>=128
 
 #define TM_OPT0             (0) //default, least code and buf
 #define TM_OPT1             (1) //opt for speed, need more code and buf
-#define TM_OPT2             (2) //TODO
+#define TM_OPT2             (2) //O1 + im2col and blocked GEMM for conv and pwconv, need TM_GEMM_WSIZE buf
 
 /******************************* PORT CONFIG  ************************************/
+#ifndef TM_ARCH
 #define TM_ARCH         TM_ARCH_RV32P
+#endif
+#ifndef TM_OPT_LEVEL
 #define TM_OPT_LEVEL    TM_OPT1
+#endif
+#ifndef TM_MDL_TYPE
 #define TM_MDL_TYPE     TM_MDL_INT8
+#endif
 #define TM_FASTSCALE    (0)         //enable if your chip don't have FPU, may speed up 1/3, but decrease accuracy
 #define TM_LOCAL_MATH   (0)         //use local math func (like exp()) to avoid libm
 #define TM_ENABLE_STAT  (1)         //enable mdl stat functions
 #define TM_MAX_CSIZE    (1000)      //max channel num //used if INT8 mdl  //cost TM_MAX_CSIZE*4 Byte
 #define TM_MAX_KSIZE    (5*5)       //max kernel_size   //cost TM_MAX_KSIZE*4 Byte
 #define TM_MAX_KCSIZE   (3*3*256)   //max kernel_size*channels //cost TM_MAX_KSIZE*sizeof(mtype_t) Byte
+#define TM_GEMM_WSIZE   (16*1024)   //O2 weight tile copied to ram //cost TM_GEMM_WSIZE*sizeof(wtype_t) Byte
 
 #define TM_INLINE       __attribute__((always_inline)) static inline
 #define TM_WEAK         __attribute__((weak))
@@ -60,6 +68,38 @@ limitations under the License.
                             TM_PRINTF("===%s use %.3f ms\n", (x), _time);\
                             _start=TM_GET_US();}
 
+/******************************* PROFILER CONFIG  ************************************/
+//tick of the layer profiler (tm_prof_*): mcycle on RISC-V, us elsewhere (host builds);
+//define both for other chips, e.g. DWT->CYCCNT on Cortex-M. TM_CYCLE_PERUS turns ticks to us
+#ifndef TM_GET_CYCLE
+#if defined(__riscv)
+#include "bflb_clock.h"
+TM_INLINE uint64_t tm_get_cycle(void)
+{
+#if __riscv_xlen == 32
+    uint32_t hi, lo, hi2;
+    do {    //mcycle may carry into mcycleh between the reads
+        __asm__ volatile("csrr %0, mcycleh" : "=r"(hi));
+        __asm__ volatile("csrr %0, mcycle" : "=r"(lo));
+        __asm__ volatile("csrr %0, mcycleh" : "=r"(hi2));
+    } while (hi != hi2);
+    return ((uint64_t)hi << 32) | lo;
+#else
+    uint64_t c;
+    __asm__ volatile("csrr %0, mcycle" : "=r"(c));
+    return c;
+#endif
+}
+#define  TM_GET_CYCLE()    tm_get_cycle()
+#ifndef TM_CYCLE_PERUS
+#define  TM_CYCLE_PERUS    ((int)(bflb_clk_get_system_clock(BFLB_SYSTEM_CPU_CLK) / 1000000))
+#endif
+#else
+#define  TM_GET_CYCLE()    ((uint64_t)TM_GET_US())
+#define  TM_CYCLE_PERUS    (1)
+#endif
+#endif
+
 /******************************* DBG PERFORMANCE CONFIG  ************************************/
 //need clock tick to make accurate statistics
 #define TM_EN_PERF 0
@@ -20,7 +20,10 @@ limitations under the License.
 //https://occ.t-head.cn/vendor/cpu/index?id=3900588052540035072&key=download#sticky   //pdf
 //https://github.com/T-head-Semi
 //We use T-head Xuantie E907 as example, it have its own instructions!!!
+//0: standard P extension through the rvp_intrinsic.h intrinsics
+#ifndef ENABLE_THEAD_EXT
 #define ENABLE_THEAD_EXT 1
+#endif
 
 #if TM_MDL_TYPE == TM_MDL_INT8
 #if ENABLE_THEAD_EXT
@@ -136,6 +139,66 @@ TM_INLINE  void tm_dot_prod_pack2(mtype_t* sptr, mtype_t* kptr, uint32_t size, s
     result[1] = sum1;
     return;
 }
+
+//sum += 4 int8 products of a and b
+TM_INLINE int32_t tm_smaqa(int32_t sum, uint32_t a, uint32_t b)
+{
+    asm("smaqa %0,%1,%2" : "+r"(sum) : "r"(a), "r"(b));
+    return sum;
+}
+
+#else
+#include <rvp_intrinsic.h>
+
+TM_INLINE int32_t tm_smaqa(int32_t sum, uint32_t a, uint32_t b)
+{
+    return (int32_t)__rv_smaqa(sum, a, b);
+}
+
+//sptr, kptr may be unaligned here
+TM_INLINE uint32_t tm_ld32(mtype_t* p)
+{
+    uint32_t x;
+    memcpy(&x, p, 4);
+    return x;
+}
+
+TM_INLINE void tm_dot_prod(mtype_t* sptr, mtype_t* kptr,uint32_t size, sumtype_t* result)
+{
+    int32_t sum = 0;
+    uint32_t i = 0;
+    for(; i+4 <= size; i+=4){
+        sum = tm_smaqa(sum, tm_ld32(sptr+i), tm_ld32(kptr+i));
+    }
+    for(; i <size; i++){
+        sum += sptr[i]*kptr[i];
+    }
+    *result = sum;
+    return;
+}
+
+TM_INLINE void tm_dot_prod_pack2(mtype_t* sptr, mtype_t* kptr, uint32_t size, sumtype_t* result)
+{
+    mtype_t* kptr0 = kptr;
+    mtype_t* kptr1 = kptr+size;
+    int32_t sum0 = 0;
+    int32_t sum1 = 0;
+    uint32_t i = 0;
+    for(; i+4 <= size; i+=4){
+        uint32_t s = tm_ld32(sptr+i);
+        sum0 = tm_smaqa(sum0, s, tm_ld32(kptr0+i));
+        sum1 = tm_smaqa(sum1, s, tm_ld32(kptr1+i));
+    }
+    for(; i <size; i++){
+        sum0 += sptr[i]*kptr0[i];
+        sum1 += sptr[i]*kptr1[i];
+    }
+    result[0] = sum0;
+    result[1] = sum1;
+    return;
+}
+
+#endif
  
 TM_INLINE void tm_dot_prod_3x3x1(mtype_t* sptr, mtype_t* kptr, sumtype_t* result)
 {
@@ -176,9 +239,45 @@ TM_INLINE void tm_dot_prod_gap_3x3x1(mtype_t* sptr, mtype_t* kptr, uint32_t* k_o
     return;                  
 }
 
-#else
-#error "standard RV32P is not implement yet!"
-#endif
+
+//O2 GEMM kernel: 4 pixels x 4 channels, 16 sums in registers, one smaqa is 4 k
+//wp: packed weights [k/4][TM_GEMM_NR][4]; a: TM_GEMM_MR im2col rows, 4 byte aligned; sums: [TM_GEMM_MR][TM_GEMM_NR]
+#define TM_GEMM_MR (4)
+#define TM_GEMM_NR (4)
+#define TM_GEMM_KP (4)
+typedef uint32_t __attribute__((may_alias)) tm_u32a_t;
+TM_INLINE void tm_gemm_kernel(mtype_t** a, wtype_t* wp, uint32_t k, sumtype_t* sums)
+{
+    tm_u32a_t* a0 = (tm_u32a_t*)a[0];
+    tm_u32a_t* a1 = (tm_u32a_t*)a[1];
+    tm_u32a_t* a2 = (tm_u32a_t*)a[2];
+    tm_u32a_t* a3 = (tm_u32a_t*)a[3];
+    tm_u32a_t* w  = (tm_u32a_t*)wp;
+    int32_t s00=0, s01=0, s02=0, s03=0, s10=0, s11=0, s12=0, s13=0;
+    int32_t s20=0, s21=0, s22=0, s23=0, s30=0, s31=0, s32=0, s33=0;
+    for(uint32_t i = 0; i < k/4; i++){
+        uint32_t x0 = a0[i], x1 = a1[i], x2 = a2[i], x3 = a3[i];
+        uint32_t w0 = w[0];
+        s00 = tm_smaqa(s00, x0, w0); s10 = tm_smaqa(s10, x1, w0);
+        s20 = tm_smaqa(s20, x2, w0); s30 = tm_smaqa(s30, x3, w0);
+        uint32_t w1 = w[1];
+        s01 = tm_smaqa(s01, x0, w1); s11 = tm_smaqa(s11, x1, w1);
+        s21 = tm_smaqa(s21, x2, w1); s31 = tm_smaqa(s31, x3, w1);
+        uint32_t w2 = w[2];
+        s02 = tm_smaqa(s02, x0, w2); s12 = tm_smaqa(s12, x1, w2);
+        s22 = tm_smaqa(s22, x2, w2); s32 = tm_smaqa(s32, x3, w2);
+        uint32_t w3 = w[3];
+        s03 = tm_smaqa(s03, x0, w3); s13 = tm_smaqa(s13, x1, w3);
+        s23 = tm_smaqa(s23, x2, w3); s33 = tm_smaqa(s33, x3, w3);
+        w += 4;
+    }
+    sums[0]  = s00; sums[1]  = s01; sums[2]  = s02; sums[3]  = s03;
+    sums[4]  = s10; sums[5]  = s11; sums[6]  = s12; sums[7]  = s13;
+    sums[8]  = s20; sums[9]  = s21; sums[10] = s22; sums[11] = s23;
+    sums[12] = s30; sums[13] = s31; sums[14] = s32; sums[15] = s33;
+    return;
+}
+
 
 #else
 #error "RV32P opt for FP32 in not implement yet!"
@@ -0,0 +1,179 @@
+/* Copyright 2022 Sipeed Technology Co., Ltd. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stdlib.h"
+#include "stdint.h"
+#include "math.h"
+#include "tm_port.h"
+
+#ifndef __riscv_vector
+#error "Vector intrinsics require the vector extension."
+#endif
+#include <riscv_vector.h>
+
+//RVV 1.0 acceleration, ratified vector spec and the __riscv_ prefixed intrinsics
+//https://github.com/riscv/riscv-v-spec/releases/tag/v1.0
+//https://github.com/riscv-non-isa/rvv-intrinsic-doc (v0.12 and later)
+//-march=rv64gcv or rv32imafcv, gcc 13+ or clang 16+
+//T-head C906 implements the 0.7.1 draft, use TM_ARCH_RV64V with the T-head toolchain there
+//strip-mined with vsetvl, so any VLEN works except the GEMM kernel which needs VLEN>=128
+
+#if TM_MDL_TYPE == TM_MDL_INT8
+//sum = SUM(Ai*Bi), i8*i8 fits i16, widening reduce into i32
+TM_INLINE void tm_dot_prod(mtype_t* sptr, mtype_t* kptr,uint32_t size, sumtype_t* result)
+{
+    vint32m1_t sumv = __riscv_vmv_v_x_i32m1(0, 1);
+    while(size > 0){
+        size_t vl = __riscv_vsetvl_e8m1(size);
+        vint8m1_t  s8  = __riscv_vle8_v_i8m1(sptr, vl);
+        vint8m1_t  k8  = __riscv_vle8_v_i8m1(kptr, vl);
+        vint16m2_t p16 = __riscv_vwmul_vv_i16m2(s8, k8, vl);
+        sumv = __riscv_vwredsum_vs_i16m2_i32m1(p16, sumv, vl);
+        sptr += vl;
+        kptr += vl;
+        size -= vl;
+    }
+    *result = __riscv_vmv_x_s_i32m1_i32(sumv);
+    return;
+}
+
+TM_INLINE void tm_dot_prod_pack2(mtype_t* sptr, mtype_t* kptr, uint32_t size, sumtype_t* result)
+{
+    mtype_t* kptr0 = kptr;
+    mtype_t* kptr1 = kptr+size;
+    vint32m1_t sumv0 = __riscv_vmv_v_x_i32m1(0, 1);
+    vint32m1_t sumv1 = __riscv_vmv_v_x_i32m1(0, 1);
+    while(size > 0){
+        size_t vl = __riscv_vsetvl_e8m1(size);
+        vint8m1_t s8  = __riscv_vle8_v_i8m1(sptr, vl);
+        vint8m1_t k80 = __riscv_vle8_v_i8m1(kptr0, vl);
+        vint8m1_t k81 = __riscv_vle8_v_i8m1(kptr1, vl);
+        sumv0 = __riscv_vwredsum_vs_i16m2_i32m1(__riscv_vwmul_vv_i16m2(s8, k80, vl), sumv0, vl);
+        sumv1 = __riscv_vwredsum_vs_i16m2_i32m1(__riscv_vwmul_vv_i16m2(s8, k81, vl), sumv1, vl);
+        sptr  += vl;
+        kptr0 += vl;
+        kptr1 += vl;
+        size  -= vl;
+    }
+    result[0] = __riscv_vmv_x_s_i32m1_i32(sumv0);
+    result[1] = __riscv_vmv_x_s_i32m1_i32(sumv1);
+    return;
+}
+
+TM_INLINE void tm_dot_prod_gap_3x3x1(mtype_t* sptr, mtype_t* kptr, uint32_t* k_oft, sumtype_t* result)
+{
+    *result = sptr[k_oft[0]]*kptr[0] + sptr[k_oft[1]]*kptr[1] + sptr[k_oft[2]]*kptr[2] + \
+        sptr[k_oft[3]]*kptr[3] + sptr[k_oft[4]]*kptr[4] + sptr[k_oft[5]]*kptr[5] + \
+        sptr[k_oft[6]]*kptr[6] + sptr[k_oft[7]]*kptr[7] + sptr[k_oft[8]]*kptr[8] ;
+    return;
+}
+
+TM_INLINE void tm_dot_prod_3x3x1(mtype_t* sptr, mtype_t* kptr, sumtype_t* result)
+{
+    *result = sptr[0]*kptr[0] + sptr[1]*kptr[1] + sptr[2]*kptr[2] + \
+        sptr[3]*kptr[3] + sptr[4]*kptr[4] + sptr[5]*kptr[5] + \
+        sptr[6]*kptr[6] + sptr[7]*kptr[7] + sptr[8]*kptr[8] ;
+    return;
+}
+
+//O2 GEMM kernel: 4 pixels x 16 channels, the channels are the vector lanes, no reduction
+//wp: packed weights [k][TM_GEMM_NR]; a: TM_GEMM_MR im2col rows; sums: [TM_GEMM_MR][TM_GEMM_NR]
+//per k one weight load and 4 vwmul.vx+vwadd.wv for 64 MACs, 4 i32m4 accumulators are 16 registers
+#if __riscv_v_min_vlen < 128
+#error "RVV GEMM kernel needs VLEN>=128"
+#endif
+#define TM_GEMM_MR (4)
+#define TM_GEMM_NR (16)
+#define TM_GEMM_KP (1)
+TM_INLINE void tm_gemm_kernel(mtype_t** a, wtype_t* wp, uint32_t k, sumtype_t* sums)
+{
+    size_t vl = __riscv_vsetvl_e8m1(TM_GEMM_NR);
+    mtype_t* a0 = a[0];
+    mtype_t* a1 = a[1];
+    mtype_t* a2 = a[2];
+    mtype_t* a3 = a[3];
+    vint32m4_t acc0 = __riscv_vmv_v_x_i32m4(0, vl);
+    vint32m4_t acc1 = __riscv_vmv_v_x_i32m4(0, vl);
+    vint32m4_t acc2 = __riscv_vmv_v_x_i32m4(0, vl);
+    vint32m4_t acc3 = __riscv_vmv_v_x_i32m4(0, vl);
+    for(uint32_t i = 0; i < k; i++){
+        vint8m1_t w8 = __riscv_vle8_v_i8m1(wp, vl);
+        acc0 = __riscv_vwadd_wv_i32m4(acc0, __riscv_vwmul_vx_i16m2(w8, a0[i], vl), vl);
+        acc1 = __riscv_vwadd_wv_i32m4(acc1, __riscv_vwmul_vx_i16m2(w8, a1[i], vl), vl);
+        acc2 = __riscv_vwadd_wv_i32m4(acc2, __riscv_vwmul_vx_i16m2(w8, a2[i], vl), vl);
+        acc3 = __riscv_vwadd_wv_i32m4(acc3, __riscv_vwmul_vx_i16m2(w8, a3[i], vl), vl);
+        wp += TM_GEMM_NR;
+    }
+    __riscv_vse32_v_i32m4(sums + 0*TM_GEMM_NR, acc0, vl);
+    __riscv_vse32_v_i32m4(sums + 1*TM_GEMM_NR, acc1, vl);
+    __riscv_vse32_v_i32m4(sums + 2*TM_GEMM_NR, acc2, vl);
+    __riscv_vse32_v_i32m4(sums + 3*TM_GEMM_NR, acc3, vl);
+    return;
+}
+
+#else
+#error "RVV opt for this mdl type is not implement yet, FP16/FP32 use TM_ARCH_RV64V"
+#endif
+
+#if !TM_FASTSCALE
+TM_INLINE void tm_postprocess_sum(int n, sumtype_t* sums, btype_t* bs, int act, mtype_t* outp, sctype_t* scales, sctype_t out_s_inv, zptype_t out_zp)
+#else
+TM_INLINE void tm_postprocess_sum(int n, sumtype_t* sums, btype_t* bs, int act, mtype_t* outp, int32_t* scales, int32_t out_s, zptype_t out_zp)
+#endif
+{
+#if !TM_FASTSCALE
+    //same float steps as the scalar code, rtz is the C cast
+    while(n > 0) {
+        size_t vl = __riscv_vsetvl_e32m4(n);
+        vint32m4_t s32 = __riscv_vle32_v_i32m4(sums, vl);
+        s32 = __riscv_vadd_vv_i32m4(s32, __riscv_vle32_v_i32m4(bs, vl), vl);
+        vfloat32m4_t sumsf = __riscv_vfcvt_f_x_v_f32m4(s32, vl);
+        sumsf = __riscv_vfmul_vv_f32m4(sumsf, __riscv_vle32_v_f32m4(scales, vl), vl);
+        switch(act){    //activation func
+        case TM_ACT_RELU:
+            sumsf = __riscv_vfmax_vf_f32m4(sumsf, 0.f, vl);
+            break;
+        case TM_ACT_RELU6:
+            sumsf = __riscv_vfmax_vf_f32m4(sumsf, 0.f, vl);
+            sumsf = __riscv_vfmin_vf_f32m4(sumsf, 6.f, vl);
+            break;
+        default:
+            break;
+        }
+        sumsf = __riscv_vfmul_vf_f32m4(sumsf, out_s_inv, vl);
+        sumsf = __riscv_vfadd_vf_f32m4(sumsf, (float)out_zp, vl);
+        vint16m2_t s16 = __riscv_vfncvt_rtz_x_f_w_i16m2(sumsf, vl);
+        __riscv_vse8_v_i8m1(outp, __riscv_vncvt_x_x_w_i8m1(s16, vl), vl);
+        sums += vl; bs += vl; scales += vl; outp += vl;
+        n -= vl;
+    }
+#else
+    for(int i = 0; i < n; i++) {
+        sumtype_t sum = sums[i];
+        sum += bs[i];
+        sumtype_t sumf = (sum<<TM_FASTSCALE_SHIFT)/scales[i];
+        switch(act){    //activation func
+        case TM_ACT_RELU:
+            sumf = sumf>0?sumf:0;
+            break;
+        case TM_ACT_RELU6:
+            sumf = sumf>0?sumf:0;
+            sumf = sumf>(6<<TM_FASTSCALE_SHIFT)?(6<<TM_FASTSCALE_SHIFT):sumf;
+            break;
+        default:
+            break;
+        }
+        outp[i] = (mtype_t)(((sumf*out_s)>>(TM_FASTSCALE_SHIFT+TM_FASTSCALE_SHIFT))+out_zp);
+    }
+#endif
+    return;
+}
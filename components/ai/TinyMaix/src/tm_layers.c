@@ -32,6 +32,8 @@ limitations under the License.
     #include "arch_cskyv2.h"
 #elif TM_ARCH==TM_ARCH_X86_SSE2
     #include "arch_x86_sse2.h"
+#elif TM_ARCH==TM_ARCH_RVV
+    #include "arch_rvv.h"
 #else
     #error "UNSUPPORT ARCH!"
 #endif
@@ -69,7 +71,7 @@ tm_err_t TM_WEAK tml_conv2d_dwconv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, bt
     TM_PERF_INIT(t_valid);TM_PERF_INIT(t_pad);
     TM_PERF_INIT(t_conv); TM_PERF_INIT(t_pwconv); TM_PERF_INIT(t_dwconv);
     int pad_flag = (pad_top != 0 ||pad_bottom != 0 ||pad_left != 0 ||pad_right != 0);
-    if(dx!=1 || dy!= 1) return TM_ERR_TODO;
+    if(dx<1 || dy<1) return TM_ERR_UNSUPPORT;
     if(act >= TM_ACT_MAXCNT) return TM_ERR_UNSUPPORT;
     int maxk = kw*kh;
     if(maxk>TM_MAX_KSIZE) return TM_ERR_KSIZE;
@@ -103,14 +105,14 @@ tm_err_t TM_WEAK tml_conv2d_dwconv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, bt
                 for(; c<out->c-BATCH_SIZE+1; ){
                     for(int bat = 0; bat < BATCH_SIZE; bat+=2)
                         tm_dot_prod_pack2(sptr, kptr + chi*bat, chi, sums + bat);
-                    tm_postprocess_sum(BATCH_SIZE, sums, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp);
+                    TM_POSTPROCESS(BATCH_SIZE, sums, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp);
                     c += BATCH_SIZE;
                     outp += BATCH_SIZE;
                     kptr += chi*BATCH_SIZE;//*2;
                 }
                 for(; c<out->c; c++){
                     tm_dot_prod(sptr, kptr, chi, &sum); //size=maxk*chi //pw maxk==1
-                    tm_postprocess_sum(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
+                    TM_POSTPROCESS(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
                     kptr += chi;
                 }
             }
@@ -122,22 +124,24 @@ tm_err_t TM_WEAK tml_conv2d_dwconv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, bt
     if(dmul) {TM_PERF_START(t_dwconv);} else {TM_PERF_START(t_conv);};
     int oft = 0;
     int idx = 0;
-    for(int y=0; y<kh; y++){    //gen k_oft table
+    for(int y=0; y<kh; y++){    //gen k_oft table, dilated taps are dx,dy apart
         for(int x=0; x<kw; x++){
             k_oft[idx] = oft;
             idx += 1;
-            oft += chi;
+            oft += dx*chi;
         }
-        oft += (in->w - kw)*chi;
+        oft += (in->w*dy - kw*dx)*chi;
     }
     chi  = dmul ? 1 : in->c; // dmul>=1 indicate depthwise; dummy chi for dwconv compatible
+    int ekw = (kw-1)*dx+1;      //kernel extent in the input
+    int ekh = (kh-1)*dy+1;
     int slow_flag = 0; //same pad part is slow
     for (int y = 0; y < out->h; y++) {
         int src_y0 = sy*y - pad_top;
         for (int x = 0; x < out->w; x++) {
             int src_x0 = sx*x - pad_left;
             sumtype_t sum;
-            slow_flag = ((src_y0<0)+(src_x0<0)+(src_y0+kh>in->h)+(src_x0+kw>in->w));
+            slow_flag = ((src_y0<0)+(src_x0<0)+(src_y0+ekh>in->h)+(src_x0+ekw>in->w));
             //TM_PERF_START(t_sbuf);
             if(!slow_flag) {TM_PERF_START(t_valid); //valid or same valid part
                 mtype_t* sptr_base = (mtype_t*)TM_MATP(in, src_y0, src_x0, 0); //?c/dmul:0
@@ -151,10 +155,10 @@ tm_err_t TM_WEAK tml_conv2d_dwconv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, bt
                     sptr = sptr_base + (dmul?(cc+1)/dmul:(cc+1));
                 }
             } else {  TM_PERF_START(t_pad);       //same pad part
-                int _ky0 = src_y0<0 ? -src_y0 : 0;
-                int _kx0 = src_x0<0 ? -src_x0 : 0;
-                int _ky1 = in->h-src_y0>kh ? kh : in->h-src_y0;
-                int _kx1 = in->w-src_x0>kw ? kw : in->w-src_x0;
+                int _ky0 = src_y0<0 ? (-src_y0+dy-1)/dy : 0;   //first and last tap inside the input
+                int _kx0 = src_x0<0 ? (-src_x0+dx-1)/dx : 0;
+                int _ky1 = in->h-src_y0>=ekh ? kh : (in->h-src_y0+dy-1)/dy;
+                int _kx1 = in->w-src_x0>=ekw ? kw : (in->w-src_x0+dx-1)/dx;
                 uint32_t sidx=0;    //sbuf:cho,chi,maxk //dw:chi==1;
                 uint32_t s_step = (_ky1-_ky0)*(_kx1-_kx0);
                 mtype_t* sptr_base = (mtype_t*)TM_MATP(in, src_y0, src_x0, 0);
@@ -183,14 +187,14 @@ tm_err_t TM_WEAK tml_conv2d_dwconv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, bt
                 for(int c=0; c<out->c; c++){
                     wtype_t* kptr = (wtype_t*)w + c*chi*maxk;//TM_PERF_START(t_dotp);
                     tm_dot_prod_3x3x1(sptr, kptr, &sum);//TM_PERF_ADD(t_dotp);TM_PERF_START(t_post);
-                    tm_postprocess_sum(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;//TM_PERF_ADD(t_post);
+                    TM_POSTPROCESS(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;//TM_PERF_ADD(t_post);
                     sptr += maxk; //dwconv need move step
                 }
             }else {
                 for(int c=0; c<out->c; c++){
                     wtype_t* kptr = (wtype_t*)w + c*chi*maxk;//TM_PERF_START(t_dotp);
                     tm_dot_prod(sptr, kptr, maxk*chi, &sum);//TM_PERF_ADD(t_dotp);TM_PERF_START(t_post);
-                    tm_postprocess_sum(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;//TM_PERF_ADD(t_post);
+                    TM_POSTPROCESS(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;//TM_PERF_ADD(t_post);
                     if(dmul) sptr += maxk; //dwconv need move step
                 }
             }
@@ -243,6 +247,26 @@ tm_err_t TM_WEAK tml_fc(tm_mat_t* in, tm_mat_t* out,  wtype_t* w, btype_t* b, \
 }
 
 /*************************** TML_SOFTMAX **********************************/
+//dout holds the float logits, their max is dmax: exp, normalize and requant to out
+TM_INLINE void l_softmax_exp(float* dout, float dmax, int n, tm_mat_t* out, sctype_t out_s, zptype_t out_zp)
+{
+    float sum = 0;
+    for(int c=0; c <n; c++){
+        dout[c] -= dmax;
+        dout[c] = (float)tm_exp(dout[c]);
+        sum     += dout[c];
+        dout[c] -= 0.000001;  //prevent 1.0 value (cause 256 overflow)
+    }
+    for(int c=0; c <n; c++){  //int8/int16 <= fp32, so it is ok
+    #if TM_MDL_TYPE == TM_MDL_INT8 || TM_MDL_TYPE == TM_MDL_INT16
+        out->data[c] = (mtype_t)(dout[c]/sum/out_s + out_zp); //requant
+    #else
+        out->data[c] = (mtype_t)(dout[c]/sum);
+    #endif
+    }
+    return;
+}
+
 tm_err_t TM_WEAK tml_softmax(tm_mat_t* in, tm_mat_t* out, sctype_t in_s, zptype_t in_zp, sctype_t out_s, zptype_t out_zp)
 {   TM_DBGT_INIT(); //note we have float size output buf even in INT8/INT16 mode
     mtype_t* din = in->data;
@@ -256,20 +280,31 @@ tm_err_t TM_WEAK tml_softmax(tm_mat_t* in, tm_mat_t* out, sctype_t in_s, zptype_
     #endif
         if(dout[c] > dmax) dmax = dout[c];
     }
-    float sum = 0;
-    for(int c=0; c <in->c; c++){
-        dout[c] -= dmax;
-        dout[c] = (float)tm_exp(dout[c]);
-        sum     += dout[c];
-        dout[c] -= 0.000001;  //prevent 1.0 value (cause 256 overflow)
-    }
-    for(int c=0; c <in->c; c++){  //int8/int16 <= fp32, so it is ok
+    l_softmax_exp(dout, dmax, in->c, out, out_s, out_zp);
+    return TM_OK;
+}
+
+/*************************** TML_FC + TML_SOFTMAX **********************************/
+//each logit quantized as tml_fc does, then straight to the float buffer as tml_softmax reads it
+tm_err_t TM_WEAK tml_fc_softmax(tm_mat_t* in, tm_mat_t* out,  wtype_t* w, btype_t* b, \
+    sctype_t* ws, sctype_t in_s, zptype_t in_zp, sctype_t fc_s, zptype_t fc_zp, sctype_t out_s, zptype_t out_zp)
+{   TM_DBGT_INIT();
+    mtype_t* data = in->data;
+    float*  dout = (float*)(out->data);
+    float   dmax =  -FLT_MAX;
+    for(int c=0; c <out->c; c++){
+        sumtype_t sum = 0;
+        tm_dot_prod(data, w+c*in->c, in->c, &sum);
+        sum += b[c];    //fuse with zp
     #if TM_MDL_TYPE == TM_MDL_INT8 || TM_MDL_TYPE == TM_MDL_INT16
-        out->data[c] = (mtype_t)(dout[c]/sum/out_s + out_zp); //requant
+        mtype_t q = (mtype_t)(sum*in_s*ws[0]/fc_s + fc_zp); //requant
+        dout[c] = (float)((sumtype_t)q - fc_zp)*fc_s;
     #else
-        out->data[c] = (mtype_t)(dout[c]/sum);
+        dout[c] = (mtype_t)(sum);
     #endif
+        if(dout[c] > dmax) dmax = dout[c];
     }
+    l_softmax_exp(dout, dmax, out->c, out, out_s, out_zp);
     return TM_OK;
 }
 
@@ -281,7 +316,7 @@ tm_err_t TM_WEAK tml_reshape(tm_mat_t* in, tm_mat_t* out, sctype_t in_s, zptype_
 }
 
 
-tm_err_t TM_WEAK tml_add(tm_mat_t* in0, tm_mat_t* in1, tm_mat_t* out, \
+tm_err_t TM_WEAK tml_add(tm_mat_t* in0, tm_mat_t* in1, tm_mat_t* out, int act, \
     sctype_t in_s0, zptype_t in_zp0, sctype_t in_s1, zptype_t in_zp1, sctype_t out_s, zptype_t out_zp)
 {   //TODO: check in0 shape == in1 shape 
     //It is simple and experimental implement for ADD, could be more way faster
@@ -289,17 +324,13 @@ tm_err_t TM_WEAK tml_add(tm_mat_t* in0, tm_mat_t* in1, tm_mat_t* out, \
     mtype_t* d1 = in1->data;
     mtype_t* res = out->data; 
     int size = in0->h*in0->w*in0->c;
-    TM_PRINTF("s0=%.3f,zp0=%d; s1=%.3f,zp1=%d\r\n", in_s0, in_zp0, in_s1, in_zp1);
 #if TM_MDL_TYPE == TM_MDL_FP16 || TM_MDL_TYPE == TM_MDL_FP32 || TM_MDL_TYPE == TM_MDL_INT8
-    int i;
-    for(i=0; i+4<=size; ){
-        res[i] = TM_QUANT(TM_DEQUANT(d0[i],in_s0,in_zp0)+TM_DEQUANT(d1[i],in_s1,in_zp1), out_s, out_zp); i++;
-        res[i] = TM_QUANT(TM_DEQUANT(d0[i],in_s0,in_zp0)+TM_DEQUANT(d1[i],in_s1,in_zp1), out_s, out_zp); i++;
-        res[i] = TM_QUANT(TM_DEQUANT(d0[i],in_s0,in_zp0)+TM_DEQUANT(d1[i],in_s1,in_zp1), out_s, out_zp); i++;
-        res[i] = TM_QUANT(TM_DEQUANT(d0[i],in_s0,in_zp0)+TM_DEQUANT(d1[i],in_s1,in_zp1), out_s, out_zp); i++;
-    }
-    for(; i<size; i++){
-        res[i] = TM_QUANT(TM_DEQUANT(d0[i],in_s0,in_zp0)+TM_DEQUANT(d1[i],in_s1,in_zp1), out_s, out_zp);
+    if(act != TM_ACT_NONE && act != TM_ACT_RELU && act != TM_ACT_RELU6) return TM_ERR_UNSUPPORT;
+    for(int i=0; i<size; i++){  //res may be d0 or d1, in place
+        float v = TM_DEQUANT(d0[i],in_s0,in_zp0)+TM_DEQUANT(d1[i],in_s1,in_zp1);
+        if(act == TM_ACT_RELU) v = v > 0 ? v : 0;
+        else if(act == TM_ACT_RELU6) v = v > 0 ? (v < 6 ? v : 6) : 0;
+        res[i] = TM_QUANT(v, out_s, out_zp);
     }
 #else
     #error "ADD not support this data type yet"
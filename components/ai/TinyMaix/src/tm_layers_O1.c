@@ -9,7 +9,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
-// It is O1 implement
+// It is O1 implement, also used by O2 (conv and pwconv go to tml_conv2d_gemm in tm_layers_O2.c first)
 // warning: O1 code bloat much to get better performance, experimental now
 /*
 pwconv
@@ -24,7 +24,7 @@ conv
 #include "float.h"
 #include "math.h"
 
-#if TM_OPT_LEVEL == TM_OPT1
+#if (TM_OPT_LEVEL == TM_OPT1) || (TM_OPT_LEVEL == TM_OPT2)
 
 #if TM_ARCH==TM_ARCH_CPU
     #include "arch_cpu.h"
@@ -42,6 +42,8 @@ conv
     #include "arch_cskyv2.h"
 #elif TM_ARCH==TM_ARCH_X86_SSE2
     #include "arch_x86_sse2.h"
+#elif TM_ARCH==TM_ARCH_RVV
+    #include "arch_rvv.h"
 #else
     #error "UNSUPPORT ARCH!"
 #endif
@@ -97,14 +99,14 @@ TM_INLINE tm_err_t l_tml_pwconv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, btype
             for(; c<out->c-BATCH_SIZE+1; ){
                 for(int bat = 0; bat < BATCH_SIZE; bat+=2)
                     tm_dot_prod_pack2(sptr, kptr + chi*bat, chi, sums + bat);
-                tm_postprocess_sum(BATCH_SIZE, sums, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp);
+                TM_POSTPROCESS(BATCH_SIZE, sums, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp);
                 c += BATCH_SIZE;
                 outp += BATCH_SIZE;
                 kptr += chi*BATCH_SIZE;//*2;
             }
             for(; c<out->c; c++){
                 tm_dot_prod(sptr, kptr, chi, &sum); //size=maxk*chi //pw maxk==1
-                tm_postprocess_sum(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
+                TM_POSTPROCESS(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
                 kptr += chi;
             }
         }
@@ -127,14 +129,16 @@ TM_INLINE tm_err_t l_tml_conv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, btype_t
 
     int oft = 0;
     int idx = 0;
-    for(int y=0; y<kh; y++){    //gen k_oft table
+    for(int y=0; y<kh; y++){    //gen k_oft table, dilated taps are dx,dy apart
         for(int x=0; x<kw; x++){
             k_oft[idx] = oft;
             idx += 1;
-            oft += chi;
+            oft += dx*chi;
         }
-        oft += (in->w - kw)*chi; 
+        oft += (in->w*dy - kw*dx)*chi; 
     }
+    int ekw = (kw-1)*dx+1;      //kernel extent in the input
+    int ekh = (kh-1)*dy+1;
     int slow_flag = 0; //same pad part is slow
 
     for (int y = 0; y < out->h; y++) {
@@ -142,7 +146,7 @@ TM_INLINE tm_err_t l_tml_conv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, btype_t
         for (int x = 0; x < out->w; x++) {
             int src_x0 = sx*x - pad_left;
             sumtype_t sum; 
-            slow_flag = ((src_y0<0)+(src_x0<0)+(src_y0+kh>in->h)+(src_x0+kw>in->w)); 
+            slow_flag = ((src_y0<0)+(src_x0<0)+(src_y0+ekh>in->h)+(src_x0+ekw>in->w)); 
             if(!slow_flag) {//valid or same valid part
                 mtype_t* sptr_base = (mtype_t*)TM_MATP(in, src_y0, src_x0, 0); //?c/dmul:0
                 mtype_t* sptr = sptr_base; //= (mtype_t*)TM_MATP(in, src_y0, src_x0, 0); //sbuf 不变
@@ -155,10 +159,10 @@ TM_INLINE tm_err_t l_tml_conv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, btype_t
                     sptr += 1;
                 }
             } else {        //same pad part
-                int _ky0 = src_y0<0 ? -src_y0 : 0;
-                int _kx0 = src_x0<0 ? -src_x0 : 0;
-                int _ky1 = in->h-src_y0>kh ? kh : in->h-src_y0;
-                int _kx1 = in->w-src_x0>kw ? kw : in->w-src_x0;
+                int _ky0 = src_y0<0 ? (-src_y0+dy-1)/dy : 0;   //first and last tap inside the input
+                int _kx0 = src_x0<0 ? (-src_x0+dx-1)/dx : 0;
+                int _ky1 = in->h-src_y0>=ekh ? kh : (in->h-src_y0+dy-1)/dy;
+                int _kx1 = in->w-src_x0>=ekw ? kw : (in->w-src_x0+dx-1)/dx;
                 uint32_t sidx=0;    //sbuf:cho,chi,maxk //dw:chi==1;
                 uint32_t s_step = (_ky1-_ky0)*(_kx1-_kx0);
                 mtype_t* sptr_base = (mtype_t*)TM_MATP(in, src_y0, src_x0, 0); 
@@ -188,14 +192,14 @@ TM_INLINE tm_err_t l_tml_conv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, btype_t
             for(; c<out->c-BATCH_SIZE+1; ){
                 for(int bat = 0; bat < BATCH_SIZE; bat+=2)
                     tm_dot_prod_pack2(sptr, kptr + chi*maxk*bat, maxk*chi, sums + bat);
-                tm_postprocess_sum(BATCH_SIZE, sums, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp);
+                TM_POSTPROCESS(BATCH_SIZE, sums, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp);
                 c += BATCH_SIZE;
                 outp += BATCH_SIZE;
                 kptr += chi*maxk*BATCH_SIZE;
             }
             for(; c<out->c; c++){
                 tm_dot_prod(sptr, kptr, maxk*chi, &sum); 
-                tm_postprocess_sum(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
+                TM_POSTPROCESS(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
                 kptr += chi*maxk;
             }
         }
@@ -218,14 +222,16 @@ TM_INLINE tm_err_t l_tml_dwconv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, btype
 
     int oft = 0;
     int idx = 0;
-    for(int y=0; y<kh; y++){    //gen k_oft table
+    for(int y=0; y<kh; y++){    //gen k_oft table, dilated taps are dx,dy apart
         for(int x=0; x<kw; x++){
             k_oft[idx] = oft;
             idx += 1;
-            oft += chi;
+            oft += dx*chi;
         }
-        oft += (in->w - kw)*chi; 
+        oft += (in->w*dy - kw*dx)*chi; 
     }
+    int ekw = (kw-1)*dx+1;      //kernel extent in the input
+    int ekh = (kh-1)*dy+1;
     int slow_flag = 0; //same pad part is slow
 
     for (int y = 0; y < out->h; y++) {
@@ -233,7 +239,7 @@ TM_INLINE tm_err_t l_tml_dwconv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, btype
         for (int x = 0; x < out->w; x++) {
             int src_x0 = sx*x - pad_left;
             sumtype_t sum; 
-            slow_flag = ((src_y0<0)+(src_x0<0)+(src_y0+kh>in->h)+(src_x0+kw>in->w)); 
+            slow_flag = ((src_y0<0)+(src_x0<0)+(src_y0+ekh>in->h)+(src_x0+ekw>in->w)); 
             if(!slow_flag) {//valid or same valid part
                 mtype_t* sptr_base = (mtype_t*)TM_MATP(in, src_y0, src_x0, 0); //?c/dmul:0
                 mtype_t* sptr = sptr_base; //= (mtype_t*)TM_MATP(in, src_y0, src_x0, 0); //sbuf 不变
@@ -241,7 +247,7 @@ TM_INLINE tm_err_t l_tml_dwconv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, btype
                     for (int c = 0; c < cho; c++) {
                         wtype_t* kptr = (wtype_t*)w + c*9;
                         tm_dot_prod_gap_3x3x1(sptr, kptr, k_oft, &sum);
-                        tm_postprocess_sum(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
+                        TM_POSTPROCESS(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
                         sptr += 1;
                     }
                 } else {
@@ -259,15 +265,15 @@ TM_INLINE tm_err_t l_tml_dwconv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, btype
                         wtype_t* kptr = (wtype_t*)w + c*maxk;
                         tm_dot_prod(sptr, kptr, maxk, &sum);
                         //sum = sptr[0]*kptr[0] + sptr[1]*kptr[1] + sptr[2]*kptr[2] + sptr[3]*kptr[3] + sptr[4]*kptr[4] + sptr[5]*kptr[5] + sptr[6]*kptr[6] + sptr[7]*kptr[7] + sptr[8]*kptr[8] ;
-                        tm_postprocess_sum(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
+                        TM_POSTPROCESS(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
                         sptr += maxk; //dwconv need move step
                     }
                 }
             } else {        //same pad part
-                int _ky0 = src_y0<0 ? -src_y0 : 0;
-                int _kx0 = src_x0<0 ? -src_x0 : 0;
-                int _ky1 = in->h-src_y0>kh ? kh : in->h-src_y0;
-                int _kx1 = in->w-src_x0>kw ? kw : in->w-src_x0;
+                int _ky0 = src_y0<0 ? (-src_y0+dy-1)/dy : 0;   //first and last tap inside the input
+                int _kx0 = src_x0<0 ? (-src_x0+dx-1)/dx : 0;
+                int _ky1 = in->h-src_y0>=ekh ? kh : (in->h-src_y0+dy-1)/dy;
+                int _kx1 = in->w-src_x0>=ekw ? kw : (in->w-src_x0+dx-1)/dx;
                 uint32_t sidx=0;    //sbuf:cho,chi,maxk //dw:chi==1;
                 uint32_t s_step = (_ky1-_ky0)*(_kx1-_kx0);
                 mtype_t* sptr_base = (mtype_t*)TM_MATP(in, src_y0, src_x0, 0); 
@@ -294,14 +300,14 @@ TM_INLINE tm_err_t l_tml_dwconv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, btype
                     for (int c = 0; c < cho; c++) {
                         wtype_t* kptr = (wtype_t*)w + c*9;
                         tm_dot_prod_3x3x1(sptr, kptr, &sum);
-                        tm_postprocess_sum(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
+                        TM_POSTPROCESS(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
                         sptr += maxk;
                     }
                 } else { 
                     for(int c=0; c<out->c; c++){
                         wtype_t* kptr = (wtype_t*)w + c*maxk;
                         tm_dot_prod(sptr, kptr, maxk, &sum);
-                        tm_postprocess_sum(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
+                        TM_POSTPROCESS(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
                         sptr += maxk; //dwconv need move step
                     }
                 }
@@ -327,36 +333,39 @@ TM_INLINE tm_err_t l_tml_dwconv2d_3x3_part(tm_mat_t* in, tm_mat_t* out, wtype_t*
 
     int oft = 0;
     int idx = 0;
-    for(int y=0; y<kh; y++){    //gen k_oft table
+    for(int y=0; y<kh; y++){    //gen k_oft table, dilated taps are dx,dy apart
         for(int x=0; x<kw; x++){
             k_oft[idx] = oft;
             idx += 1;
-            oft += chi;
+            oft += dx*chi;
         }
-        oft += (in->w - kw)*chi; 
+        oft += (in->w*dy - kw*dx)*chi; 
     }
+    int ekw = (kw-1)*dx+1;      //kernel extent in the input
+    int ekh = (kh-1)*dy+1;
     int slow_flag = 0; //same pad part is slow
 
-    for (int y = 0; y < out->h; y++) {
+    for (int y = y0; y < y1; y++) {     //only out rows [y0,y1) and columns [x0,x1)
         int src_y0 = sy*y - pad_top;
-        for (int x = 0; x < out->w; x++) {
+        for (int x = x0; x < x1; x++) {
             int src_x0 = sx*x - pad_left;
             sumtype_t sum; 
-            slow_flag = ((src_y0<0)+(src_x0<0)+(src_y0+kh>in->h)+(src_x0+kw>in->w)); 
+            slow_flag = ((src_y0<0)+(src_x0<0)+(src_y0+ekh>in->h)+(src_x0+ekw>in->w)); 
+            outp = out->data + (y*out->w+x)*cho;
             if(!slow_flag) {//valid or same valid part
                 mtype_t* sptr_base = (mtype_t*)TM_MATP(in, src_y0, src_x0, 0); //?c/dmul:0
                 mtype_t* sptr = sptr_base; //= (mtype_t*)TM_MATP(in, src_y0, src_x0, 0); //sbuf 不变
                 for (int c = 0; c < cho; c++) {
                     wtype_t* kptr = (wtype_t*)w + c*9;
                     tm_dot_prod_gap_3x3x1(sptr, kptr, k_oft, &sum);
-                    tm_postprocess_sum(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
+                    TM_POSTPROCESS(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
                     sptr += 1;
                 }
             } else {        //same pad part
-                int _ky0 = src_y0<0 ? -src_y0 : 0;
-                int _kx0 = src_x0<0 ? -src_x0 : 0;
-                int _ky1 = in->h-src_y0>kh ? kh : in->h-src_y0;
-                int _kx1 = in->w-src_x0>kw ? kw : in->w-src_x0;
+                int _ky0 = src_y0<0 ? (-src_y0+dy-1)/dy : 0;   //first and last tap inside the input
+                int _kx0 = src_x0<0 ? (-src_x0+dx-1)/dx : 0;
+                int _ky1 = in->h-src_y0>=ekh ? kh : (in->h-src_y0+dy-1)/dy;
+                int _kx1 = in->w-src_x0>=ekw ? kw : (in->w-src_x0+dx-1)/dx;
                 uint32_t sidx=0;    //sbuf:cho,chi,maxk //dw:chi==1;
                 uint32_t s_step = (_ky1-_ky0)*(_kx1-_kx0);
                 mtype_t* sptr_base = (mtype_t*)TM_MATP(in, src_y0, src_x0, 0); 
@@ -379,11 +388,10 @@ TM_INLINE tm_err_t l_tml_dwconv2d_3x3_part(tm_mat_t* in, tm_mat_t* out, wtype_t*
                     sptr += 1;
                 }
                 sptr = sbuf;    //sbuf prepare ok~    
-                outp = out->data + (y*out->w+x)*cho;      
                 for (int c = 0; c < cho; c++) {
                     wtype_t* kptr = (wtype_t*)w + c*9;
                     tm_dot_prod_3x3x1(sptr, kptr, &sum);
-                    tm_postprocess_sum(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
+                    TM_POSTPROCESS(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
                     sptr += maxk;
                 }
             }
@@ -462,10 +470,10 @@ TM_INLINE tm_err_t l_tml_dwconv2d_3x3_nostride(tm_mat_t* in, tm_mat_t* out, wtyp
                     sum3 = sptr[dw_koft[5]]*kptr[0] + sptr[dw_koft[6]]*kptr[1] + sptr[dw_koft[7]]*kptr[2] + \
                         sptr[dw_koft[9]]*kptr[3] + sptr[dw_koft[10]]*kptr[4] + sptr[dw_koft[11]]*kptr[5] + \
                         sptr[dw_koft[13]]*kptr[6] + sptr[dw_koft[14]]*kptr[7] + sptr[dw_koft[15]]*kptr[8] ;
-                    tm_postprocess_sum(1, &sum0, b + c, act, outp+0*cho, SUMSCALE, OUTSCALE, out_zp); 
-                    tm_postprocess_sum(1, &sum1, b + c, act, outp+1*cho, SUMSCALE, OUTSCALE, out_zp); 
-                    tm_postprocess_sum(1, &sum2, b + c, act, outp+(out->w+0)*cho, SUMSCALE, OUTSCALE, out_zp); 
-                    tm_postprocess_sum(1, &sum3, b + c, act, outp+(out->w+1)*cho, SUMSCALE, OUTSCALE, out_zp); 
+                    TM_POSTPROCESS(1, &sum0, b + c, act, outp+0*cho, SUMSCALE, OUTSCALE, out_zp); 
+                    TM_POSTPROCESS(1, &sum1, b + c, act, outp+1*cho, SUMSCALE, OUTSCALE, out_zp); 
+                    TM_POSTPROCESS(1, &sum2, b + c, act, outp+(out->w+0)*cho, SUMSCALE, OUTSCALE, out_zp); 
+                    TM_POSTPROCESS(1, &sum3, b + c, act, outp+(out->w+1)*cho, SUMSCALE, OUTSCALE, out_zp); 
                     outp ++;
                     sptr ++;
                 }
@@ -514,10 +522,10 @@ TM_INLINE tm_err_t l_tml_dwconv2d_3x3_nostride(tm_mat_t* in, tm_mat_t* out, wtyp
                     sum3 = sptr[5]*kptr[0] + sptr[6]*kptr[1] + sptr[7]*kptr[2] + \
                         sptr[9]*kptr[3] + sptr[10]*kptr[4] + sptr[11]*kptr[5] + \
                         sptr[13]*kptr[6] + sptr[14]*kptr[7] + sptr[15]*kptr[8] ;
-                    tm_postprocess_sum(1, &sum0, b + c, act, outp+0*cho, SUMSCALE, OUTSCALE, out_zp); 
-                    tm_postprocess_sum(1, &sum1, b + c, act, outp+1*cho, SUMSCALE, OUTSCALE, out_zp); 
-                    tm_postprocess_sum(1, &sum2, b + c, act, outp+(out->w+0)*cho, SUMSCALE, OUTSCALE, out_zp); 
-                    tm_postprocess_sum(1, &sum3, b + c, act, outp+(out->w+1)*cho, SUMSCALE, OUTSCALE, out_zp); 
+                    TM_POSTPROCESS(1, &sum0, b + c, act, outp+0*cho, SUMSCALE, OUTSCALE, out_zp); 
+                    TM_POSTPROCESS(1, &sum1, b + c, act, outp+1*cho, SUMSCALE, OUTSCALE, out_zp); 
+                    TM_POSTPROCESS(1, &sum2, b + c, act, outp+(out->w+0)*cho, SUMSCALE, OUTSCALE, out_zp); 
+                    TM_POSTPROCESS(1, &sum3, b + c, act, outp+(out->w+1)*cho, SUMSCALE, OUTSCALE, out_zp); 
                     //printf("==%.1f,%.1f,%.1f,%.1f\r\n", out->data[0], out->data[1], out->data[2], out->data[3]);
                     sptr += maxk_blk; //dwconv need move step
                     outp++;
@@ -527,15 +535,17 @@ TM_INLINE tm_err_t l_tml_dwconv2d_3x3_nostride(tm_mat_t* in, tm_mat_t* out, wtyp
         //x loop end
     } 
 
-    if(out->w % CONV_BLK_W != 0 || out->h % CONV_BLK_H != 0) {  //cal rest part
-        // x = [out->w-out->w%CONV_BLK_W, out->w), y = [0, out->h/CONV_BLK_H*CONV_BLK_H)
-        // x = [0, out->w), y = [out->h-out->h%CONV_BLK_H, out->h/CONV_BLK_H*CONV_BLK_H)
+    int bw = out->w/CONV_BLK_STEPX*CONV_BLK_STEPX;  //the blocks did x < bw, y < bh
+    int bh = out->h/CONV_BLK_STEPY*CONV_BLK_STEPY;
+    if(bw != out->w || bh != out->h) {  //cal rest part
+        // x = [bw, out->w), y = [0, bh)
+        // x = [0, out->w),  y = [bh, out->h)
         l_tml_dwconv2d_3x3_part(in,out,w,b, kw,kh, sx,sy, dx,dy, act, \
                     pad_top, pad_bottom, pad_left, pad_right, dmul, ws, in_s, in_zp, out_s, out_zp,\
-                    out->w-out->w%CONV_BLK_W, out->w,  0, out->h/CONV_BLK_H*CONV_BLK_H);
+                    bw, out->w,  0, bh);
         l_tml_dwconv2d_3x3_part(in,out,w,b, kw,kh, sx,sy, dx,dy, act, \
                     pad_top, pad_bottom, pad_left, pad_right, dmul, ws, in_s, in_zp, out_s, out_zp,\
-                    0, out->w,  out->h-out->h%CONV_BLK_H, out->h/CONV_BLK_H*CONV_BLK_H);
+                    0, out->w,  bh, out->h);
     }
     
     //TODO: rest
@@ -558,14 +568,16 @@ TM_INLINE tm_err_t l_tml_mdwconv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, btyp
 
     int oft = 0;
     int idx = 0;
-    for(int y=0; y<kh; y++){    //gen k_oft table
+    for(int y=0; y<kh; y++){    //gen k_oft table, dilated taps are dx,dy apart
         for(int x=0; x<kw; x++){
             k_oft[idx] = oft;
             idx += 1;
-            oft += chi;
+            oft += dx*chi;
         }
-        oft += (in->w - kw)*chi; 
+        oft += (in->w*dy - kw*dx)*chi; 
     }
+    int ekw = (kw-1)*dx+1;      //kernel extent in the input
+    int ekh = (kh-1)*dy+1;
     int slow_flag = 0; //same pad part is slow
 
     for (int y = 0; y < out->h; y++) {
@@ -573,7 +585,7 @@ TM_INLINE tm_err_t l_tml_mdwconv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, btyp
         for (int x = 0; x < out->w; x++) {
             int src_x0 = sx*x - pad_left;
             sumtype_t sum; 
-            slow_flag = ((src_y0<0)+(src_x0<0)+(src_y0+kh>in->h)+(src_x0+kw>in->w)); 
+            slow_flag = ((src_y0<0)+(src_x0<0)+(src_y0+ekh>in->h)+(src_x0+ekw>in->w)); 
             if(!slow_flag) {//valid or same valid part
                 mtype_t* sptr_base = (mtype_t*)TM_MATP(in, src_y0, src_x0, 0); //?c/dmul:0
                 mtype_t* sptr = sptr_base; //= (mtype_t*)TM_MATP(in, src_y0, src_x0, 0); //sbuf 不变
@@ -586,10 +598,10 @@ TM_INLINE tm_err_t l_tml_mdwconv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, btyp
                     sptr = sptr_base + (cc+1)/dmul;
                 }
             } else {        //same pad part
-                int _ky0 = src_y0<0 ? -src_y0 : 0;
-                int _kx0 = src_x0<0 ? -src_x0 : 0;
-                int _ky1 = in->h-src_y0>kh ? kh : in->h-src_y0;
-                int _kx1 = in->w-src_x0>kw ? kw : in->w-src_x0;
+                int _ky0 = src_y0<0 ? (-src_y0+dy-1)/dy : 0;   //first and last tap inside the input
+                int _kx0 = src_x0<0 ? (-src_x0+dx-1)/dx : 0;
+                int _ky1 = in->h-src_y0>=ekh ? kh : (in->h-src_y0+dy-1)/dy;
+                int _kx1 = in->w-src_x0>=ekw ? kw : (in->w-src_x0+dx-1)/dx;
                 uint32_t sidx=0;    //sbuf:cho,chi,maxk //dw:chi==1;
                 uint32_t s_step = (_ky1-_ky0)*(_kx1-_kx0);
                 mtype_t* sptr_base = (mtype_t*)TM_MATP(in, src_y0, src_x0, 0); 
@@ -617,7 +629,7 @@ TM_INLINE tm_err_t l_tml_mdwconv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, btyp
                 sum = 0;
                 wtype_t* kptr = (wtype_t*)w + c*maxk;
                 tm_dot_prod(sptr, kptr, maxk, &sum);
-                tm_postprocess_sum(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
+                TM_POSTPROCESS(1, &sum, b + c, act, outp, SUMSCALE, OUTSCALE, out_zp); outp++;
                 sptr += maxk; //dwconv need move step
             }
         }
@@ -632,11 +644,15 @@ tm_err_t tml_conv2d_dwconv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, btype_t* b
     sctype_t* ws, sctype_t in_s, zptype_t in_zp, sctype_t out_s, zptype_t out_zp) //kernel: (cho, chi, h, w)
 {   TM_PERF_INIT(t_conv); TM_PERF_INIT(t_pwconv); TM_PERF_INIT(t_dwconv); 
     int pad_flag = (pad_top != 0 ||pad_bottom != 0 ||pad_left != 0 ||pad_right != 0);
-    if(dx!=1 || dy!= 1) return TM_ERR_TODO;   
+    if(dx<1 || dy<1) return TM_ERR_UNSUPPORT;   
     if(act >= TM_ACT_MAXCNT) return TM_ERR_UNSUPPORT;   
     int maxk = kw*kh;
     if(maxk>TM_MAX_KSIZE) return TM_ERR_KSIZE;
     if(maxk==1 && (pad_flag||dmul)) return TM_ERR_UNSUPPORT;   //assume no pad or dwconv when pwconv
+#if TM_OPT_LEVEL == TM_OPT2
+    if((maxk == 1 || dmul == 0) && tml_conv2d_gemm(in,out,w,b, kw,kh, sx,sy, dx,dy, act, \
+        pad_top, pad_bottom, pad_left, pad_right, dmul, ws, in_s, in_zp, out_s, out_zp) == TM_OK) return TM_OK;
+#endif
 
     #if (TM_MDL_TYPE == TM_MDL_INT8) || (TM_MDL_TYPE == TM_MDL_INT16)
     #if TM_FASTSCALE
@@ -660,7 +676,7 @@ tm_err_t tml_conv2d_dwconv2d(tm_mat_t* in, tm_mat_t* out, wtype_t* w, btype_t* b
             pad_top, pad_bottom, pad_left, pad_right, dmul, ws, in_s, in_zp, out_s, out_zp);
         TM_PERF_ADD(t_conv); 
     } else if(dmul == 1) { TM_PERF_START(t_dwconv);   //dw conv
-        if(kh==3 && kw==3){ //opt for 3x3 dwconv
+        if(kh==3 && kw==3 && dx==1 && dy==1){ //opt for 3x3 dwconv
             if(sx==1&&sy==1){
                 l_tml_dwconv2d_3x3_nostride(in,out,w,b, kw,kh, sx,sy, dx,dy, act, \
                     pad_top, pad_bottom, pad_left, pad_right, dmul, ws, in_s, in_zp, out_s, out_zp);
@@ -725,6 +741,26 @@ tm_err_t TM_WEAK tml_fc(tm_mat_t* in, tm_mat_t* out,  wtype_t* w, btype_t* b, \
 }
 
 /*************************** TML_SOFTMAX **********************************/
+//dout holds the float logits, their max is dmax: exp, normalize and requant to out
+TM_INLINE void l_softmax_exp(float* dout, float dmax, int n, tm_mat_t* out, sctype_t out_s, zptype_t out_zp)
+{
+    float sum = 0;
+    for(int c=0; c <n; c++){
+        dout[c] -= dmax;
+        dout[c] = (float)tm_exp(dout[c]);
+        sum     += dout[c];
+        dout[c] -= 0.000001;  //prevent 1.0 value (cause 256 overflow)
+    }
+    for(int c=0; c <n; c++){  //int8/int16 <= fp32, so it is ok
+    #if TM_MDL_TYPE == TM_MDL_INT8 || TM_MDL_TYPE == TM_MDL_INT16 
+        out->data[c] = (mtype_t)(dout[c]/sum/out_s + out_zp); //requant
+    #else
+        out->data[c] = (mtype_t)(dout[c]/sum);
+    #endif
+    }
+    return;
+}
+
 tm_err_t TM_WEAK tml_softmax(tm_mat_t* in, tm_mat_t* out, sctype_t in_s, zptype_t in_zp, sctype_t out_s, zptype_t out_zp)
 {   TM_DBGT_INIT(); //note we have float size output buf even in INT8/INT16 mode
     mtype_t* din = in->data;
@@ -738,20 +774,31 @@ tm_err_t TM_WEAK tml_softmax(tm_mat_t* in, tm_mat_t* out, sctype_t in_s, zptype_
     #endif
         if(dout[c] > dmax) dmax = dout[c];
     }
-    float sum = 0;
-    for(int c=0; c <in->c; c++){
-        dout[c] -= dmax;
-        dout[c] = (float)tm_exp(dout[c]);
-        sum     += dout[c];
-        dout[c] -= 0.000001;  //prevent 1.0 value (cause 256 overflow)
-    }
-    for(int c=0; c <in->c; c++){  //int8/int16 <= fp32, so it is ok
-    #if TM_MDL_TYPE == TM_MDL_INT8 || TM_MDL_TYPE == TM_MDL_INT16 
-        out->data[c] = (mtype_t)(dout[c]/sum/out_s + out_zp); //requant
+    l_softmax_exp(dout, dmax, in->c, out, out_s, out_zp);
+    return TM_OK;
+}
+
+/*************************** TML_FC + TML_SOFTMAX **********************************/
+//each logit quantized as tml_fc does, then straight to the float buffer as tml_softmax reads it
+tm_err_t TM_WEAK tml_fc_softmax(tm_mat_t* in, tm_mat_t* out,  wtype_t* w, btype_t* b, \
+    sctype_t* ws, sctype_t in_s, zptype_t in_zp, sctype_t fc_s, zptype_t fc_zp, sctype_t out_s, zptype_t out_zp)
+{   TM_DBGT_INIT();
+    mtype_t* data = in->data;
+    float*  dout = (float*)(out->data);
+    float   dmax =  -FLT_MAX;
+    for(int c=0; c <out->c; c++){
+        sumtype_t sum = 0;
+        tm_dot_prod(data, w+c*in->c, in->c, &sum);
+        sum += b[c];    //fuse with zp
+    #if TM_MDL_TYPE == TM_MDL_INT8 || TM_MDL_TYPE == TM_MDL_INT16
+        mtype_t q = (mtype_t)(sum*in_s*ws[0]/fc_s + fc_zp); //requant
+        dout[c] = (float)((sumtype_t)q - fc_zp)*fc_s;
     #else
-        out->data[c] = (mtype_t)(dout[c]/sum);
+        dout[c] = (mtype_t)(sum);
     #endif
+        if(dout[c] > dmax) dmax = dout[c];
     }
+    l_softmax_exp(dout, dmax, out->c, out, out_s, out_zp);
     return TM_OK;
 }
 
@@ -762,7 +809,7 @@ tm_err_t TM_WEAK tml_reshape(tm_mat_t* in, tm_mat_t* out, sctype_t in_s, zptype_
     return TM_OK;
 }
 
-tm_err_t TM_WEAK tml_add(tm_mat_t* in0, tm_mat_t* in1, tm_mat_t* out, \
+tm_err_t TM_WEAK tml_add(tm_mat_t* in0, tm_mat_t* in1, tm_mat_t* out, int act, \
     sctype_t in_s0, zptype_t in_zp0, sctype_t in_s1, zptype_t in_zp1, sctype_t out_s, zptype_t out_zp)
 {   //TODO: check in0 shape == in1 shape 
     //It is simple and experimental implement for ADD, could be more way faster
@@ -770,17 +817,13 @@ tm_err_t TM_WEAK tml_add(tm_mat_t* in0, tm_mat_t* in1, tm_mat_t* out, \
     mtype_t* d1 = in1->data;
     mtype_t* res = out->data; 
     int size = in0->h*in0->w*in0->c;
-    TM_PRINTF("s0=%.3f,zp0=%d; s1=%.3f,zp1=%d\r\n", in_s0, in_zp0, in_s1, in_zp1);
 #if TM_MDL_TYPE == TM_MDL_FP16 || TM_MDL_TYPE == TM_MDL_FP32 || TM_MDL_TYPE == TM_MDL_INT8
-    int i;
-    for(i=0; i+4<=size; ){
-        res[i] = TM_QUANT(TM_DEQUANT(d0[i],in_s0,in_zp0)+TM_DEQUANT(d1[i],in_s1,in_zp1), out_s, out_zp); i++;
-        res[i] = TM_QUANT(TM_DEQUANT(d0[i],in_s0,in_zp0)+TM_DEQUANT(d1[i],in_s1,in_zp1), out_s, out_zp); i++;
-        res[i] = TM_QUANT(TM_DEQUANT(d0[i],in_s0,in_zp0)+TM_DEQUANT(d1[i],in_s1,in_zp1), out_s, out_zp); i++;
-        res[i] = TM_QUANT(TM_DEQUANT(d0[i],in_s0,in_zp0)+TM_DEQUANT(d1[i],in_s1,in_zp1), out_s, out_zp); i++;
-    }
-    for(; i<size; i++){
-        res[i] = TM_QUANT(TM_DEQUANT(d0[i],in_s0,in_zp0)+TM_DEQUANT(d1[i],in_s1,in_zp1), out_s, out_zp);
+    if(act != TM_ACT_NONE && act != TM_ACT_RELU && act != TM_ACT_RELU6) return TM_ERR_UNSUPPORT;
+    for(int i=0; i<size; i++){  //res may be d0 or d1, in place
+        float v = TM_DEQUANT(d0[i],in_s0,in_zp0)+TM_DEQUANT(d1[i],in_s1,in_zp1);
+        if(act == TM_ACT_RELU) v = v > 0 ? v : 0;
+        else if(act == TM_ACT_RELU6) v = v > 0 ? (v < 6 ? v : 6) : 0;
+        res[i] = TM_QUANT(v, out_s, out_zp);
     }
 #else
     #error "ADD not support this data type yet"
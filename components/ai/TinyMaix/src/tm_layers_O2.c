@@ -0,0 +1,225 @@
+/* Copyright 2022 Sipeed Technology Co., Ltd. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+// It is O2 implement, conv and pwconv only; other layers are tm_layers_O1.c
+/*
+out[pixel][cho] = im2col[pixel][chi*kh*kw] x w[cho][chi*kh*kw]^T
+    weights: a tile of channels is packed to ram once per layer, panels of TM_GEMM_NR channels
+    input:   TM_GEMM_MR im2col rows at a time, pwconv reads the input in place
+    kernel:  tm_gemm_kernel from arch_xxx.h, MRxNR sums in registers
+*/
+
+#include "tinymaix.h"
+#include "float.h"
+#include "math.h"
+
+#if TM_OPT_LEVEL == TM_OPT2
+
+#if TM_ARCH==TM_ARCH_CPU
+    #include "arch_cpu.h"
+#elif TM_ARCH==TM_ARCH_ARM_SIMD
+    #include "arch_arm_simd.h"
+#elif TM_ARCH==TM_ARCH_ARM_NEON
+    #include "arch_arm_neon.h"
+#elif TM_ARCH==TM_ARCH_ARM_MVEI
+    #include "arch_arm_mvei.h"
+#elif TM_ARCH==TM_ARCH_RV32P
+    #include "arch_rv32p.h"
+#elif TM_ARCH==TM_ARCH_RV64V
+    #include "arch_rv64v.h"
+#elif TM_ARCH==TM_ARCH_CSKYV2
+    #include "arch_cskyv2.h"
+#elif TM_ARCH==TM_ARCH_X86_SSE2
+    #include "arch_x86_sse2.h"
+#elif TM_ARCH==TM_ARCH_RVV
+    #include "arch_rvv.h"
+#else
+    #error "UNSUPPORT ARCH!"
+#endif
+
+#ifndef TM_GEMM_MR  //no kernel for this arch, plain C the compiler can vectorize over the channels
+#define TM_GEMM_MR (4)
+#define TM_GEMM_NR (8)
+#define TM_GEMM_KP (1)
+TM_INLINE void tm_gemm_kernel(mtype_t** a, wtype_t* wp, uint32_t k, sumtype_t* sums)
+{
+    sumtype_t acc[TM_GEMM_MR][TM_GEMM_NR] = {0};
+    for(uint32_t i = 0; i < k; i++){
+        for(int r = 0; r < TM_GEMM_MR; r++){
+            sumtype_t x = a[r][i];
+            for(int j = 0; j < TM_GEMM_NR; j++)
+                acc[r][j] += x*wp[j];
+        }
+        wp += TM_GEMM_NR;
+    }
+    memcpy(sums, acc, sizeof(acc));
+    return;
+}
+#endif
+
+#if TM_GEMM_NR > TM_EPI_MAXN
+    #error "TM_POSTPROCESS takes at most TM_EPI_MAXN outputs"
+#endif
+
+#define GEMM_KMAX (((TM_MAX_KCSIZE>TM_MAX_CSIZE?TM_MAX_KCSIZE:TM_MAX_CSIZE)+3)/4*4)
+#define GEMM_MIN_PIX (4*TM_GEMM_MR)   //each packed weight used at least this many times
+
+static wtype_t gemm_w[TM_GEMM_WSIZE] __attribute__((aligned(8)));
+static mtype_t gemm_a[TM_GEMM_MR*GEMM_KMAX] __attribute__((aligned(8)));
+static uint32_t gemm_koft[TM_MAX_KSIZE];
+#if (TM_MDL_TYPE==TM_MDL_FP32) || (TM_MDL_TYPE==TM_MDL_FP16)
+#define SUMSCALE NULL
+static sctype_t outscale;
+#define OUTSCALE outscale
+
+#elif (TM_MDL_TYPE==TM_MDL_INT8) || (TM_MDL_TYPE==TM_MDL_INT16)
+
+#if TM_FASTSCALE
+    static int32_t sumscale[TM_MAX_CSIZE];
+    static int32_t outscale;
+    #define OUTSCALE outscale
+#else
+    static float sumscale[TM_MAX_CSIZE];
+    static sctype_t outscale;
+    static sctype_t outscale_inv;
+    #define OUTSCALE outscale_inv
+#endif
+#define SUMSCALE (sumscale + c)
+#endif
+
+//channels [c0, c0+n) to panels [n/NR][kp/KP][NR][KP], zero past k and past cho
+static void gemm_pack_w(wtype_t* w, int k, int kp, int c0, int n, int cho)
+{
+    wtype_t* wp = gemm_w;
+    for(int j = 0; j < n; j += TM_GEMM_NR){
+        for(int i = 0; i < kp; i += TM_GEMM_KP){
+            for(int r = 0; r < TM_GEMM_NR; r++){
+                int c = c0 + j + r;
+                wtype_t* src = w + c*k + i;
+                for(int q = 0; q < TM_GEMM_KP; q++)
+                    *wp++ = (c < cho && i+q < k) ? src[q] : 0;
+            }
+        }
+    }
+    return;
+}
+
+//im2col row of one output pixel, [chi][kh][kw] as the weights, same pad with in_zp
+static mtype_t* gemm_im2col(mtype_t* row, tm_mat_t* in, int src_y0, int src_x0, int kw, int kh, int dx, int dy, int kp, zptype_t in_zp)
+{
+    int chi  = in->c;
+    int maxk = kw*kh;
+    int ekw  = (kw-1)*dx+1;
+    int ekh  = (kh-1)*dy+1;
+    mtype_t* sptr = (mtype_t*)TM_MATP(in, src_y0, src_x0, 0);
+    if(src_y0 >= 0 && src_x0 >= 0 && src_y0+ekh <= in->h && src_x0+ekw <= in->w) {
+        for(int cc = 0; cc < chi; cc++){
+            for(int k = 0; k < maxk; k++)
+                row[cc*maxk + k] = sptr[gemm_koft[k] + cc];
+        }
+    } else {
+        int _ky0 = src_y0<0 ? (-src_y0+dy-1)/dy : 0;
+        int _kx0 = src_x0<0 ? (-src_x0+dx-1)/dx : 0;
+        int _ky1 = in->h-src_y0>=ekh ? kh : (in->h-src_y0+dy-1)/dy;
+        int _kx1 = in->w-src_x0>=ekw ? kw : (in->w-src_x0+dx-1)/dx;
+        for(int i = 0; i < chi*maxk; i++)
+    #if TM_MDL_TYPE == TM_MDL_INT8
+            row[i] = in_zp;
+    #else
+            row[i] = 0;
+    #endif
+        for(int cc = 0; cc < chi; cc++){
+            for(int _ky=_ky0; _ky<_ky1; _ky++){
+                for(int _kx=_kx0; _kx<_kx1; _kx++){
+                    int k = _ky*kw + _kx;
+                    row[cc*maxk + k] = sptr[gemm_koft[k] + cc];
+                }
+            }
+        }
+    }
+    for(int i = chi*maxk; i < kp; i++)
+        row[i] = 0;
+    return row;
+}
+
+//conv (dmul==0) and pwconv as GEMM; TM_ERR_UNSUPPORT if it does not fit the buffers, then O1 runs it
+tm_err_t tml_conv2d_gemm(tm_mat_t* in, tm_mat_t* out, wtype_t* w, btype_t* b, \
+    int kw, int kh, int sx, int sy, int dx, int dy, int act, \
+    int pad_top, int pad_bottom, int pad_left, int pad_right, int dmul, \
+    sctype_t* ws, sctype_t in_s, zptype_t in_zp, sctype_t out_s, zptype_t out_zp)
+{
+    int maxk = kw*kh;
+    int chi  = in->c;
+    int cho  = out->c;
+    int k    = chi*maxk;
+    int kp   = (k+TM_GEMM_KP-1)/TM_GEMM_KP*TM_GEMM_KP;
+    int nc   = TM_GEMM_WSIZE/kp/TM_GEMM_NR*TM_GEMM_NR;  //channels in one weight tile
+    int npix = out->h*out->w;
+    if(dmul != 0 || kp > GEMM_KMAX || nc == 0 || cho > TM_MAX_CSIZE) return TM_ERR_UNSUPPORT;
+    if(npix < GEMM_MIN_PIX) return TM_ERR_UNSUPPORT;  //few pixels, packing the weights costs more than it saves
+    //pwconv rows are the input pixels when they need no padding to kp and are word aligned
+    int direct = (maxk == 1 && kp == k && ((size_t)in->data % 4) == 0);
+
+#if (TM_MDL_TYPE == TM_MDL_INT8) || (TM_MDL_TYPE == TM_MDL_INT16)
+    #if TM_FASTSCALE
+        outscale = (1<<TM_FASTSCALE_SHIFT)/out_s;
+        for(int c=0; c<cho;c++) sumscale[c]=1.0/ws[c]/in_s;
+    #else
+        outscale = out_s;
+        outscale_inv = 1.f / outscale;
+        for(int c=0; c<cho;c++) sumscale[c]=ws[c]*in_s;
+    #endif
+#else
+    outscale = out_s;
+#endif
+
+    int oft = 0;
+    int idx = 0;
+    for(int y=0; y<kh; y++){    //gen k_oft table
+        for(int x=0; x<kw; x++){
+            gemm_koft[idx] = oft;
+            idx += 1;
+            oft += dx*chi;
+        }
+        oft += (in->w*dy - kw*dx)*chi;
+    }
+
+    for(int c0 = 0; c0 < cho; c0 += nc){
+        int n = cho-c0 < nc ? cho-c0 : nc;
+        gemm_pack_w(w, k, kp, c0, n, cho);
+        for(int p0 = 0; p0 < npix; p0 += TM_GEMM_MR){
+            mtype_t* rows[TM_GEMM_MR];
+            int m = npix-p0 < TM_GEMM_MR ? npix-p0 : TM_GEMM_MR;
+            for(int r = 0; r < TM_GEMM_MR; r++){
+                int p = p0 + (r < m ? r : 0);   //tail rows repeat the first one
+                int y = p / out->w;
+                int x = p % out->w;
+                if(direct)
+                    rows[r] = (mtype_t*)TM_MATP(in, sy*y, sx*x, 0);
+                else if(r < m)
+                    rows[r] = gemm_im2col(gemm_a + r*kp, in, sy*y - pad_top, sx*x - pad_left, kw, kh, dx, dy, kp, in_zp);
+                else
+                    rows[r] = rows[0];
+            }
+            for(int j = 0; j < n; j += TM_GEMM_NR){
+                sumtype_t sums[TM_GEMM_MR*TM_GEMM_NR];
+                int c  = c0 + j;
+                int nr = n-j < TM_GEMM_NR ? n-j : TM_GEMM_NR;
+                tm_gemm_kernel(rows, gemm_w + j*kp, kp, sums);
+                for(int r = 0; r < m; r++)
+                    TM_POSTPROCESS(nr, sums + r*TM_GEMM_NR, b + c, act, out->data + (p0+r)*cho + c, SUMSCALE, OUTSCALE, out_zp);
+            }
+        }
+    }
+    return TM_OK;
+}
+
+#endif
@@ -0,0 +1,312 @@
+/* Copyright 2022 Sipeed Technology Co., Ltd. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+// pool, concat, mul, resize and hard-swish, and conv+ADD, plain C shared by all opt levels
+// TM_WEAK, so an arch or opt level can override any of them
+// int8/int16 results round half away from zero and saturate, as the TFLite kernels
+
+#include "tinymaix.h"
+#include "float.h"
+#include "math.h"
+
+#if (TM_MDL_TYPE == TM_MDL_INT8) || (TM_MDL_TYPE == TM_MDL_INT16) || (TM_MDL_TYPE == TM_MDL_FP32) || (TM_MDL_TYPE == TM_MDL_FP16)
+
+#if (TM_MDL_TYPE == TM_MDL_INT8) || (TM_MDL_TYPE == TM_MDL_INT16)
+#if TM_MDL_TYPE == TM_MDL_INT8
+    #define L_QMIN (-128)
+    #define L_QMAX (127)
+#else
+    #define L_QMIN (-32768)
+    #define L_QMAX (32767)
+#endif
+    #define L_DEQUANT(x,s,zp)   (((float)(x)-(zp))*(s))
+    #define L_QUANT(x,s,zp)     l_quant((x),(s),(zp))
+    #define L_SAMEQ(s0,zp0,s1,zp1) ((s0)==(s1) && (zp0)==(zp1))
+TM_INLINE mtype_t l_quant(float x, sctype_t s, zptype_t zp)
+{
+    float q = x/s;
+    if(q <= L_QMIN-zp) return L_QMIN;
+    if(q >= L_QMAX-zp) return L_QMAX;
+    return (mtype_t)((int32_t)(q >= 0 ? q+0.5f : q-0.5f) + zp);
+}
+#else
+    #define L_DEQUANT(x,s,zp)   ((float)(x))
+    #define L_QUANT(x,s,zp)     ((mtype_t)(x))
+    #define L_SAMEQ(s0,zp0,s1,zp1) (1)
+#endif
+
+static sumtype_t pool_sum[TM_MAX_CSIZE];
+
+/*************************** TML_MAXPOOL, TML_AVGPOOL **********************************/
+//padding is not counted: max of the taps inside the input, avg divides by their count
+tm_err_t TM_WEAK tml_pool2d(tm_mat_t* in, tm_mat_t* out, int kw, int kh, int sx, int sy, \
+    int pad_top, int pad_bottom, int pad_left, int pad_right, int is_max, \
+    sctype_t in_s, zptype_t in_zp, sctype_t out_s, zptype_t out_zp)
+{
+    int chi = in->c;
+    int same = L_SAMEQ(in_s, in_zp, out_s, out_zp);
+    mtype_t* outp = out->data;
+    if(chi != out->c) return TM_ERR_DIMS;
+    if(!is_max && chi > TM_MAX_CSIZE) return TM_ERR_UNSUPPORT;
+    for(int y = 0; y < out->h; y++){
+        int src_y0 = sy*y - pad_top;
+        int _ky0 = src_y0<0 ? -src_y0 : 0;
+        int _ky1 = in->h-src_y0>kh ? kh : in->h-src_y0;
+        for(int x = 0; x < out->w; x++){
+            int src_x0 = sx*x - pad_left;
+            int _kx0 = src_x0<0 ? -src_x0 : 0;
+            int _kx1 = in->w-src_x0>kw ? kw : in->w-src_x0;
+            int cnt = (_ky1-_ky0)*(_kx1-_kx0);
+            if(_ky1 <= _ky0 || _kx1 <= _kx0) {  //window all in the padding
+                for(int c = 0; c < chi; c++) outp[c] = L_QUANT(0, out_s, out_zp);
+                outp += chi;
+                continue;
+            }
+            if(is_max) {
+                memcpy(outp, TM_MATP(in, src_y0+_ky0, src_x0+_kx0, 0), chi*sizeof(mtype_t));
+                for(int _ky = _ky0; _ky < _ky1; _ky++){
+                    for(int _kx = _kx0; _kx < _kx1; _kx++){
+                        mtype_t* sptr = TM_MATP(in, src_y0+_ky, src_x0+_kx, 0);
+                        for(int c = 0; c < chi; c++)
+                            if(sptr[c] > outp[c]) outp[c] = sptr[c];
+                    }
+                }
+                if(!same) {
+                    for(int c = 0; c < chi; c++)
+                        outp[c] = L_QUANT(L_DEQUANT(outp[c], in_s, in_zp), out_s, out_zp);
+                }
+            } else {
+                memset(pool_sum, 0, chi*sizeof(sumtype_t));
+                for(int _ky = _ky0; _ky < _ky1; _ky++){
+                    for(int _kx = _kx0; _kx < _kx1; _kx++){
+                        mtype_t* sptr = TM_MATP(in, src_y0+_ky, src_x0+_kx, 0);
+                        for(int c = 0; c < chi; c++)
+                            pool_sum[c] += sptr[c];
+                    }
+                }
+                for(int c = 0; c < chi; c++){
+                #if (TM_MDL_TYPE == TM_MDL_INT8) || (TM_MDL_TYPE == TM_MDL_INT16)
+                    if(same)    //integer average, rounded as TFLite
+                        outp[c] = pool_sum[c] >= 0 ? (pool_sum[c] + cnt/2)/cnt : (pool_sum[c] - cnt/2)/cnt;
+                    else
+                        outp[c] = L_QUANT(L_DEQUANT((float)pool_sum[c]/cnt, in_s, in_zp), out_s, out_zp);
+                #else
+                    outp[c] = pool_sum[c]/cnt;
+                #endif
+                }
+            }
+            outp += chi;
+        }
+    }
+    return TM_OK;
+}
+
+/*************************** TML_CONCAT **********************************/
+TM_INLINE void l_concat_copy(mtype_t* dst, mtype_t* src, int n, int same, \
+    sctype_t in_s, zptype_t in_zp, sctype_t out_s, zptype_t out_zp)
+{
+    if(same) {
+        memcpy(dst, src, n*sizeof(mtype_t));
+    } else {
+        for(int c = 0; c < n; c++)
+            dst[c] = L_QUANT(L_DEQUANT(src[c], in_s, in_zp), out_s, out_zp);
+    }
+    return;
+}
+
+//on channel, in0 and in1 have the same h,w; each input requantized to the output scale
+tm_err_t TM_WEAK tml_concat(tm_mat_t* in0, tm_mat_t* in1, tm_mat_t* out, int in1_first, \
+    sctype_t in_s0, zptype_t in_zp0, sctype_t in_s1, zptype_t in_zp1, sctype_t out_s, zptype_t out_zp)
+{
+    int c0 = in0->c;
+    int c1 = in1->c;
+    int same0 = L_SAMEQ(in_s0, in_zp0, out_s, out_zp);
+    int same1 = L_SAMEQ(in_s1, in_zp1, out_s, out_zp);
+    int size = out->h*out->w;
+    mtype_t* d0 = in0->data;
+    mtype_t* d1 = in1->data;
+    mtype_t* res = out->data;
+    if(c0 + c1 != out->c || in1->h != out->h || in1->w != out->w) return TM_ERR_DIMS;
+    for(int i = 0; i < size; i++){
+        if(in1_first) {
+            l_concat_copy(res,      d1, c1, same1, in_s1, in_zp1, out_s, out_zp);
+            l_concat_copy(res + c1, d0, c0, same0, in_s0, in_zp0, out_s, out_zp);
+        } else {
+            l_concat_copy(res,      d0, c0, same0, in_s0, in_zp0, out_s, out_zp);
+            l_concat_copy(res + c0, d1, c1, same1, in_s1, in_zp1, out_s, out_zp);
+        }
+        d0  += c0;
+        d1  += c1;
+        res += c0 + c1;
+    }
+    return TM_OK;
+}
+
+/*************************** TML_MUL **********************************/
+//elementwise; a dim of size 1 in either input broadcasts, as the squeeze-excite 1x1xc scale
+tm_err_t TM_WEAK tml_mul(tm_mat_t* in0, tm_mat_t* in1, tm_mat_t* out, int act, \
+    sctype_t in_s0, zptype_t in_zp0, sctype_t in_s1, zptype_t in_zp1, sctype_t out_s, zptype_t out_zp)
+{
+    if(act != TM_ACT_NONE && act != TM_ACT_RELU && act != TM_ACT_RELU6) return TM_ERR_UNSUPPORT;
+    if((in0->h != out->h && in0->h != 1) || (in0->w != out->w && in0->w != 1) || (in0->c != out->c && in0->c != 1) || \
+       (in1->h != out->h && in1->h != 1) || (in1->w != out->w && in1->w != 1) || (in1->c != out->c && in1->c != 1))
+        return TM_ERR_DIMS;
+    int sy0 = in0->h == 1 ? 0 : in0->w*in0->c;    //element steps, 0 on a broadcast dim
+    int sx0 = in0->w == 1 ? 0 : in0->c;
+    int sc0 = in0->c == 1 ? 0 : 1;
+    int sy1 = in1->h == 1 ? 0 : in1->w*in1->c;
+    int sx1 = in1->w == 1 ? 0 : in1->c;
+    int sc1 = in1->c == 1 ? 0 : 1;
+    float s01 = in_s0*in_s1;
+    mtype_t* res = out->data;
+    for(int y = 0; y < out->h; y++){
+        for(int x = 0; x < out->w; x++){
+            mtype_t* d0 = in0->data + y*sy0 + x*sx0;
+            mtype_t* d1 = in1->data + y*sy1 + x*sx1;
+            for(int c = 0; c < out->c; c++){
+            #if (TM_MDL_TYPE == TM_MDL_INT8) || (TM_MDL_TYPE == TM_MDL_INT16)
+                float v = (float)(((sumtype_t)d0[c*sc0]-in_zp0)*((sumtype_t)d1[c*sc1]-in_zp1))*s01;
+            #else
+                float v = (float)d0[c*sc0]*(float)d1[c*sc1];
+            #endif
+                if(act == TM_ACT_RELU) v = v > 0 ? v : 0;
+                else if(act == TM_ACT_RELU6) v = v > 0 ? (v < 6 ? v : 6) : 0;
+                *res++ = L_QUANT(v, out_s, out_zp);
+            }
+        }
+    }
+    return TM_OK;
+}
+
+/*************************** TML_RESIZE **********************************/
+//input pixel per output pixel, as TFLite resize_nearest_neighbor and resize_bilinear
+TM_INLINE float l_resize_scale(int in_size, int out_size, int align_corners)
+{
+    return (align_corners && out_size > 1) ? (in_size-1)/(float)(out_size-1) : in_size/(float)out_size;
+}
+
+TM_INLINE int l_resize_nearest(int o, float scale, int in_size, int align_corners, int half_pixel)
+{
+    float v = (o + (half_pixel ? 0.5f : 0.f))*scale;
+    int i = align_corners ? (int)roundf(v) : (int)floorf(v);
+    if(i > in_size-1) i = in_size-1;
+    if(i < 0) i = 0;
+    return i;
+}
+
+//interpolation point v, its taps i0,i1 and the weight of i1
+TM_INLINE float l_resize_linear(int o, float scale, int in_size, int half_pixel, int* i0, int* i1)
+{
+    float v = half_pixel ? (o+0.5f)*scale-0.5f : o*scale;
+    int lo = (int)floorf(v);
+    int hi = (int)ceilf(v);
+    *i0 = lo < 0 ? 0 : lo;
+    *i1 = hi > in_size-1 ? in_size-1 : hi;
+    return v - *i0;
+}
+
+tm_err_t TM_WEAK tml_resize(tm_mat_t* in, tm_mat_t* out, int mode, int align_corners, int half_pixel, \
+    sctype_t in_s, zptype_t in_zp, sctype_t out_s, zptype_t out_zp)
+{
+    int chi = in->c;
+    int same = L_SAMEQ(in_s, in_zp, out_s, out_zp);
+    float scale_y = l_resize_scale(in->h, out->h, align_corners);
+    float scale_x = l_resize_scale(in->w, out->w, align_corners);
+    mtype_t* outp = out->data;
+    if(chi != out->c) return TM_ERR_DIMS;
+    if(mode == TM_RESIZE_NEAREST) {
+        for(int y = 0; y < out->h; y++){
+            int iy = l_resize_nearest(y, scale_y, in->h, align_corners, half_pixel);
+            for(int x = 0; x < out->w; x++){
+                int ix = l_resize_nearest(x, scale_x, in->w, align_corners, half_pixel);
+                l_concat_copy(outp, TM_MATP(in, iy, ix, 0), chi, same, in_s, in_zp, out_s, out_zp);
+                outp += chi;
+            }
+        }
+    } else if(mode == TM_RESIZE_BILINEAR) {
+        for(int y = 0; y < out->h; y++){
+            int y0, y1;
+            float fy = l_resize_linear(y, scale_y, in->h, half_pixel, &y0, &y1);
+            for(int x = 0; x < out->w; x++){
+                int x0, x1;
+                float fx = l_resize_linear(x, scale_x, in->w, half_pixel, &x0, &x1);
+                mtype_t* p00 = TM_MATP(in, y0, x0, 0);
+                mtype_t* p01 = TM_MATP(in, y0, x1, 0);
+                mtype_t* p10 = TM_MATP(in, y1, x0, 0);
+                mtype_t* p11 = TM_MATP(in, y1, x1, 0);
+                float w00 = (1-fy)*(1-fx), w01 = (1-fy)*fx, w10 = fy*(1-fx), w11 = fy*fx;
+                for(int c = 0; c < chi; c++){
+                    float v = p00[c]*w00 + p01[c]*w01 + p10[c]*w10 + p11[c]*w11;  //linear, so the zeropoint passes through
+                    outp[c] = L_QUANT(L_DEQUANT(v, in_s, in_zp), out_s, out_zp);
+                }
+                outp += chi;
+            }
+        }
+    } else {
+        return TM_ERR_UNSUPPORT;
+    }
+    return TM_OK;
+}
+
+/*************************** TML_HARDSWISH **********************************/
+TM_INLINE float l_hardswish(float x)
+{
+    float r6 = x + 3.f;
+    r6 = r6 > 0 ? (r6 < 6.f ? r6 : 6.f) : 0;
+    return x*r6/6.f;
+}
+
+//x*relu6(x+3)/6; int8 goes through a 256 entry table
+tm_err_t TM_WEAK tml_hardswish(tm_mat_t* in, tm_mat_t* out, sctype_t in_s, zptype_t in_zp, sctype_t out_s, zptype_t out_zp)
+{
+    int size = out->h*out->w*out->c;
+    mtype_t* d = in->data;
+    mtype_t* res = out->data;
+#if TM_MDL_TYPE == TM_MDL_INT8
+    mtype_t lut[256];
+    for(int i = -128; i < 128; i++)
+        lut[i+128] = L_QUANT(l_hardswish(L_DEQUANT(i, in_s, in_zp)), out_s, out_zp);
+    for(int i = 0; i < size; i++)
+        res[i] = lut[d[i]+128];
+#else
+    for(int i = 0; i < size; i++)
+        res[i] = L_QUANT(l_hardswish(L_DEQUANT(d[i], in_s, in_zp)), out_s, out_zp);
+#endif
+    return TM_OK;
+}
+
+/*************************** TML_CONV2D + TML_ADD **********************************/
+tm_epi_t tm_epi;
+
+//any conv kernel of the opt level, its TM_POSTPROCESS does the ADD as tml_add would
+tm_err_t TM_WEAK tml_conv2d_add(tm_mat_t* in, tm_mat_t* in1, tm_mat_t* out, wtype_t* w, btype_t* b, \
+    int kw, int kh, int sx, int sy, int dx, int dy, int act, \
+    int pad_top, int pad_bottom, int pad_left, int pad_right, int dmul, \
+    sctype_t* ws, sctype_t in_s, zptype_t in_zp, sctype_t conv_s, zptype_t conv_zp, \
+    int add_act, sctype_t in_s0, zptype_t in_zp0, sctype_t in_s1, zptype_t in_zp1, sctype_t out_s, zptype_t out_zp)
+{
+    if(add_act != TM_ACT_NONE && add_act != TM_ACT_RELU && add_act != TM_ACT_RELU6) return TM_ERR_UNSUPPORT;
+    tm_epi.out    = out->data;
+    tm_epi.in1    = in1->data;
+    tm_epi.act    = add_act;
+    tm_epi.in_s0  = in_s0;
+    tm_epi.in_zp0 = in_zp0;
+    tm_epi.in_s1  = in_s1;
+    tm_epi.in_zp1 = in_zp1;
+    tm_epi.out_s  = out_s;
+    tm_epi.out_zp = out_zp;
+    tm_err_t res = tml_conv2d_dwconv2d(in, out, w, b, kw, kh, sx, sy, dx, dy, act, \
+        pad_top, pad_bottom, pad_left, pad_right, dmul, ws, in_s, in_zp, conv_s, conv_zp);
+    tm_epi.in1 = NULL;
+    return res;
+}
+
+#endif
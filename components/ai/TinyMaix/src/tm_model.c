@@ -36,7 +36,7 @@ tm_err_t TM_WEAK tm_load  (tm_mdl_t* mdl, const uint8_t* bin, uint8_t*buf, tm_cb
     mdl->layer_i    = 0;
     mdl->layer_body = mdl->b->layers_body;
     memcpy((void*)in, (void*)mdl->b->in_dims, sizeof(tm_mat_t));
-    in->data = (mtype_t*)mdl->buf; //input at 0 oft
+    in->data = (mtype_t*)(mdl->buf + ((tml_head_t*)mdl->b->layers_body)->in_oft); //0 oft unless planned by tmdl_opt
     return TM_OK;
 }
 
@@ -82,6 +82,167 @@ tm_err_t TM_WEAK tm_preprocess(tm_mdl_t* mdl, tm_pp_t pp_type, tm_mat_t* in, tm_
 }
 
 
+/*************************** TML_GROUP **********************************/
+//input rows [*iy0,*iy1) that output rows [y0,y1) of a group member read
+static void tm_group_in_rows(tml_head_t* h, int y0, int y1, int* iy0, int* iy1)
+{
+    int sy = 1, ekh = 1, pt = 0;
+    if(h->type == TML_CONV2D || h->type == TML_DWCONV2D) {
+        tml_conv2d_dw_t* l = (tml_conv2d_dw_t*)h;
+        sy = l->stride_h; ekh = (l->kernel_h-1)*l->dilation_h+1; pt = l->pad[0];
+    } else if(h->type == TML_MAXPOOL || h->type == TML_AVGPOOL) {
+        tml_pool_t* l = (tml_pool_t*)h;
+        sy = l->stride_h; ekh = l->kernel_h; pt = l->pad[0];
+    }
+    *iy0 = y0*sy - pt;
+    *iy1 = (y1-1)*sy - pt + ekh;
+    if(*iy0 < 0) *iy0 = 0;
+    if(*iy1 > h->in_dims[1]) *iy1 = h->in_dims[1];
+}
+
+//output rows [y0,y1) of a group member to out; its input rows from in_row0 are at in,
+//the far inputs of ADD, CONCAT and MUL are whole
+static tm_err_t tm_group_rows(tm_mdl_t* mdl, tml_head_t* h, mtype_t* in, int in_row0, mtype_t* out, int y0, int y1)
+{
+    tm_mat_t _in, _in1, _out;
+    int iy0, iy1;
+    tm_group_in_rows(h, y0, y1, &iy0, &iy1);
+    memcpy((void*)&_in, (void*)(h->in_dims), sizeof(uint16_t)*4);
+    memcpy((void*)&_out, (void*)(h->out_dims), sizeof(uint16_t)*4);
+    _in.data  = in + (iy0-in_row0)*_in.w*_in.c;
+    _in.h     = iy1-iy0;
+    _out.data = out;
+    _out.h    = y1-y0;
+    switch(h->type){
+    case TML_CONV2D:
+    case TML_DWCONV2D: {
+        tml_conv2d_dw_t* l = (tml_conv2d_dw_t*)h;
+        int pt = iy0 - (y0*l->stride_h - l->pad[0]);    //padding rows left in this band
+        int pb = (y1-1)*l->stride_h - l->pad[0] + (l->kernel_h-1)*l->dilation_h+1 - iy1;
+        return tml_conv2d_dwconv2d(&_in, &_out, (wtype_t*)((uint8_t*)h + l->w_oft), (btype_t*)((uint8_t*)h + l->b_oft), \
+            l->kernel_w, l->kernel_h, l->stride_w, l->stride_h, l->dilation_w, l->dilation_h, \
+            l->act, pt, pb, l->pad[2], l->pad[3], l->depth_mul, \
+            (sctype_t*)((uint8_t*)h + l->ws_oft), h->in_s, h->in_zp, h->out_s, h->out_zp);}
+    case TML_MAXPOOL:
+    case TML_AVGPOOL: {
+        tml_pool_t* l = (tml_pool_t*)h;
+        int pt = iy0 - (y0*l->stride_h - l->pad[0]);
+        int pb = (y1-1)*l->stride_h - l->pad[0] + l->kernel_h - iy1;
+        return tml_pool2d(&_in, &_out, l->kernel_w, l->kernel_h, l->stride_w, l->stride_h, \
+            pt, pb, l->pad[2], l->pad[3], h->type == TML_MAXPOOL, h->in_s, h->in_zp, h->out_s, h->out_zp);}
+    case TML_ADD: {
+        tml_add_t* l = (tml_add_t*)h;
+        memcpy((void*)&_in1, (void*)&_in, sizeof(tm_mat_t));
+        _in1.data = (mtype_t*)(mdl->buf + l->in_oft1) + y0*_in.w*_in.c;
+        return tml_add(&_in, &_in1, &_out, l->act, h->in_s, h->in_zp, l->in_s1, l->in_zp1, h->out_s, h->out_zp);}
+    case TML_CONCAT: {
+        tml_concat_t* l = (tml_concat_t*)h;
+        memcpy((void*)&_in1, (void*)&_in, sizeof(tm_mat_t));
+        _in1.c = l->in_c1;
+        _in1.data = (mtype_t*)(mdl->buf + l->in_oft1) + y0*_in1.w*_in1.c;
+        return tml_concat(&_in, &_in1, &_out, l->in1_first, h->in_s, h->in_zp, l->in_s1, l->in_zp1, h->out_s, h->out_zp);}
+    case TML_MUL: {
+        tml_mul_t* l = (tml_mul_t*)h;
+        memcpy((void*)&_in1, (void*)(l->in_dims1), sizeof(uint16_t)*4);
+        _in1.data = (mtype_t*)((l->in1_const ? (uint8_t*)h : mdl->buf) + l->in_oft1);
+        if(_in1.h != 1) {   //else the one row broadcasts
+            _in1.data += y0*_in1.w*_in1.c;
+            _in1.h = y1-y0;
+        }
+        return tml_mul(&_in, &_in1, &_out, l->act, h->in_s, h->in_zp, l->in_s1, l->in_zp1, h->out_s, h->out_zp);}
+    case TML_HARDSWISH:
+        return tml_hardswish(&_in, &_out, h->in_s, h->in_zp, h->out_s, h->out_zp);
+    default:
+        return TM_ERR_LAYERTYPE;
+    }
+}
+
+//output rows [y0,y1) of a member and the fused one f before it (TML_GROUP_FUSED), from the input rows
+//of f; the FC before a softmax reads its whole input
+static tm_err_t tm_group_fused_rows(tm_mdl_t* mdl, tml_head_t* f, tml_head_t* h, mtype_t* in, int in_row0, mtype_t* out, int y0, int y1)
+{
+    tm_mat_t _in, _in1, _out;
+    memcpy((void*)&_in, (void*)(f->in_dims), sizeof(uint16_t)*4);
+    memcpy((void*)&_out, (void*)(h->out_dims), sizeof(uint16_t)*4);
+    _in.data  = in;
+    _out.data = out;
+    if(f->type == TML_FC) {
+        tml_fc_t* l = (tml_fc_t*)f;
+        return tml_fc_softmax(&_in, &_out, (wtype_t*)((uint8_t*)f + l->w_oft), (btype_t*)((uint8_t*)f + l->b_oft), \
+            (sctype_t*)((uint8_t*)f + l->ws_oft), f->in_s, f->in_zp, f->out_s, f->out_zp, h->out_s, h->out_zp);
+    }
+#if (TM_MDL_TYPE == TM_MDL_FP8_143) || (TM_MDL_TYPE == TM_MDL_FP8_152)
+    return TM_ERR_UNSUPPORT;    //no tml_conv2d_add
+#else
+    tml_conv2d_dw_t* l = (tml_conv2d_dw_t*)f;
+    tml_add_t* a = (tml_add_t*)h;
+    int iy0, iy1;
+    tm_group_in_rows(f, y0, y1, &iy0, &iy1);
+    int pt = iy0 - (y0*l->stride_h - l->pad[0]);
+    int pb = (y1-1)*l->stride_h - l->pad[0] + (l->kernel_h-1)*l->dilation_h+1 - iy1;
+    _in.data += (iy0-in_row0)*_in.w*_in.c;
+    _in.h     = iy1-iy0;
+    _out.h    = y1-y0;
+    memcpy((void*)&_in1, (void*)&_out, sizeof(tm_mat_t));
+    _in1.data = (mtype_t*)(mdl->buf + a->in_oft1) + y0*_out.w*_out.c;
+    return tml_conv2d_add(&_in, &_in1, &_out, (wtype_t*)((uint8_t*)f + l->w_oft), (btype_t*)((uint8_t*)f + l->b_oft), \
+        l->kernel_w, l->kernel_h, l->stride_w, l->stride_h, l->dilation_w, l->dilation_h, \
+        l->act, pt, pb, l->pad[2], l->pad[3], l->depth_mul, (sctype_t*)((uint8_t*)f + l->ws_oft), \
+        f->in_s, f->in_zp, f->out_s, f->out_zp, a->act, h->in_s, h->in_zp, a->in_s1, a->in_zp1, h->out_s, h->out_zp);
+#endif
+}
+
+//steps band output rows of the last member; going back, each member needs some rows of the one
+//before, which keeps rows [lo,hi) in its line buffer and only makes the ones it did not have.
+//A member fused into the next one (TML_GROUP_FUSED) is made by it and has no line buffer
+static tm_err_t tm_run_group(tm_mdl_t* mdl, tml_group_t* g, mtype_t* in)
+{
+    tml_head_t* hs[TM_GROUP_MAXCNT];
+    int lo[TM_GROUP_MAXCNT], hi[TM_GROUP_MAXCNT];   //rows this step
+    int plo[TM_GROUP_MAXCNT], phi[TM_GROUP_MAXCNT]; //rows in the line buffer
+    int n = g->cnt;
+    if(n < 1 || n > TM_GROUP_MAXCNT || g->band < 1) return TM_ERR_UNSUPPORT;
+    uint8_t* body = (uint8_t*)g + sizeof(tml_group_t);
+    for(int j = 0; j < n; j++) {
+        hs[j] = (tml_head_t*)body;
+        body += hs[j]->size;
+        plo[j] = phi[j] = 0;
+    }
+    int out_h = hs[n-1]->out_dims[1];
+    for(int y = 0; y < out_h; y += g->band) {
+        lo[n-1] = y;
+        hi[n-1] = y + g->band < out_h ? y + g->band : out_h;
+        for(int j = n-1; j > 0; j--)
+            tm_group_in_rows(hs[j], lo[j], hi[j], &lo[j-1], &hi[j-1]);
+        for(int j = 0; j < n; j++) {
+            tml_head_t* h = hs[j];
+            if(j < n-1 && TML_GROUP_FUSED(h, hs[j+1])) continue;
+            int f  = j > 0 && TML_GROUP_FUSED(hs[j-1], h);  //from the input of member j-f
+            int rs = h->out_dims[2]*h->out_dims[3];     //row size
+            mtype_t* out = (mtype_t*)(mdl->buf + h->out_oft);
+            int y0 = lo[j];
+            if(j < n-1) {
+                if(phi[j] > lo[j]) {
+                    if(lo[j] > plo[j]) memmove(out, out + (lo[j]-plo[j])*rs, (phi[j]-lo[j])*rs*sizeof(mtype_t));
+                    y0 = phi[j];
+                }
+                out += (y0-lo[j])*rs;
+                plo[j] = lo[j];
+                phi[j] = hi[j];
+            } else {
+                out += y0*rs;
+            }
+            if(y0 >= hi[j]) continue;
+            mtype_t* jin = j-f == 0 ? in : (mtype_t*)(mdl->buf + hs[j-f-1]->out_oft);
+            int jrow0    = j-f == 0 ? 0 : lo[j-f-1];
+            tm_err_t res = f ? tm_group_fused_rows(mdl, hs[j-1], h, jin, jrow0, out, y0, hi[j]) : \
+                tm_group_rows(mdl, h, jin, jrow0, out, y0, hi[j]);
+            if(res != TM_OK) return res;
+        }
+    }
+    return TM_OK;
+}
+
 //run model
 //mdl: model handle; in: input mat; out: output mat
 tm_err_t TM_WEAK tm_run(tm_mdl_t* mdl, tm_mat_t* in, tm_mat_t* out)
@@ -129,8 +290,39 @@ tm_err_t TM_WEAK tm_run(tm_mdl_t* mdl, tm_mat_t* in, tm_mat_t* out)
             tml_add_t* l = (tml_add_t*)(mdl->layer_body);
             memcpy((void*)&_in1, (void*)(h->in_dims), sizeof(uint16_t)*4);
             _in1.data = (mtype_t *)(mdl->buf + l->in_oft1);
-            res = tml_add(&_in, &_in1, &_out, h->in_s, h->in_zp, l->in_s1, l->in_zp1, h->out_s, h->out_zp);
+            res = tml_add(&_in, &_in1, &_out, l->act, h->in_s, h->in_zp, l->in_s1, l->in_zp1, h->out_s, h->out_zp);
             break; }
+        case TML_MAXPOOL: 
+        case TML_AVGPOOL: {
+            tml_pool_t* l = (tml_pool_t*)(mdl->layer_body);
+            res = tml_pool2d(&_in, &_out, l->kernel_w, l->kernel_h, l->stride_w, l->stride_h, \
+                l->pad[0], l->pad[1], l->pad[2], l->pad[3], h->type == TML_MAXPOOL, \
+                h->in_s, h->in_zp, h->out_s, h->out_zp);
+            break; }
+        case TML_CONCAT: {
+            tml_concat_t* l = (tml_concat_t*)(mdl->layer_body);
+            memcpy((void*)&_in1, (void*)(h->in_dims), sizeof(uint16_t)*4);
+            _in1.c = l->in_c1;
+            _in1.data = (mtype_t *)(mdl->buf + l->in_oft1);
+            res = tml_concat(&_in, &_in1, &_out, l->in1_first, h->in_s, h->in_zp, l->in_s1, l->in_zp1, h->out_s, h->out_zp);
+            break; }
+        case TML_MUL: {
+            tml_mul_t* l = (tml_mul_t*)(mdl->layer_body);
+            memcpy((void*)&_in1, (void*)(l->in_dims1), sizeof(uint16_t)*4);
+            _in1.data = (mtype_t *)((l->in1_const ? (uint8_t*)h : mdl->buf) + l->in_oft1);
+            res = tml_mul(&_in, &_in1, &_out, l->act, h->in_s, h->in_zp, l->in_s1, l->in_zp1, h->out_s, h->out_zp);
+            break; }
+        case TML_RESIZE: {
+            tml_resize_t* l = (tml_resize_t*)(mdl->layer_body);
+            res = tml_resize(&_in, &_out, l->mode, l->align_corners, l->half_pixel, h->in_s, h->in_zp, h->out_s, h->out_zp);
+            break; }
+        case TML_HARDSWISH: {
+            tml_hardswish_t* l = (tml_hardswish_t*)(mdl->layer_body);
+            res = tml_hardswish(&_in, &_out, h->in_s, h->in_zp, h->out_s, h->out_zp);
+            break; }
+        case TML_GROUP:
+            res = tm_run_group(mdl, (tml_group_t*)(mdl->layer_body), _in.data);
+            break;
         default:
             res = TM_ERR_LAYERTYPE;
             break;
@@ -30,6 +30,13 @@ static const char* tml_str_tbl[TML_MAXCNT] = {
     "Reshape",  /*TML_RESHAPE = 4,*/
     "DWConv2D", /*TML_DWCONV2D= 5,*/
     "ADD",      /*TML_ADD     = 6,*/
+    "MaxPool",  /*TML_MAXPOOL = 7,*/
+    "AvgPool",  /*TML_AVGPOOL = 8,*/
+    "Concat",   /*TML_CONCAT  = 9,*/
+    "MUL",      /*TML_MUL     = 10,*/
+    "Resize",   /*TML_RESIZE  = 11,*/
+    "HSwish",   /*TML_HARDSWISH=12,*/
+    "Group",    /*TML_GROUP   = 13,*/
 };
 
 static const int tml_headsize_tbl[TML_MAXCNT] = {
@@ -40,8 +47,145 @@ static const int tml_headsize_tbl[TML_MAXCNT] = {
     sizeof(tml_reshape_t),
     sizeof(tml_conv2d_dw_t),
     sizeof(tml_add_t),
+    sizeof(tml_pool_t),
+    sizeof(tml_pool_t),
+    sizeof(tml_concat_t),
+    sizeof(tml_mul_t),
+    sizeof(tml_resize_t),
+    sizeof(tml_hardswish_t),
+    sizeof(tml_group_t),
 };
 
+//ops of one run (MAC for conv/fc, compare or add for pool/gap), and the bytes of
+//activations and params it reads and writes; a group is the sum of its members, less the
+//output of a member fused into the next one (TML_GROUP_FUSED), never written nor read back
+static uint64_t tm_layer_cost(tml_head_t* h, uint32_t* rd, uint32_t* wr)
+{
+    uint8_t* layer_body = (uint8_t*)h;
+    uint64_t memin  = (uint64_t)h->in_dims[1]*h->in_dims[2]*h->in_dims[3];
+    uint64_t memout = (uint64_t)h->out_dims[1]*h->out_dims[2]*h->out_dims[3];
+    uint64_t ops = 0;
+    uint32_t in1 = 0;
+    if(h->type == TML_GROUP) {
+        uint32_t r = 0, w = 0, r1, w1;
+        uint8_t* mbody = layer_body + sizeof(tml_group_t);
+        tml_head_t* prev = NULL;
+        for(int j = 0; j < ((tml_group_t*)h)->cnt; j++) {
+            tml_head_t* m = (tml_head_t*)mbody;
+            ops += tm_layer_cost(m, &r1, &w1);
+            r += r1; w += w1;
+            if(prev && TML_GROUP_FUSED(prev, m)) {
+                uint32_t n = m->in_dims[1]*m->in_dims[2]*m->in_dims[3]*sizeof(mtype_t);
+                w -= prev->out_dims[1]*prev->out_dims[2]*prev->out_dims[3]*sizeof(mtype_t);
+                r -= n;
+            }
+            prev = m;
+            mbody += m->size;
+        }
+        if(rd) *rd = r;
+        if(wr) *wr = w;
+        return ops;
+    }
+    switch(h->type){
+    case TML_CONV2D:
+    case TML_DWCONV2D: {
+        tml_conv2d_dw_t* l = (tml_conv2d_dw_t*)(layer_body);
+        ops = memout*(l->kernel_w)*(l->kernel_h)*(h->type == TML_CONV2D ? h->in_dims[3] : 1);
+        break;}
+    case TML_GAP:
+        ops = memin;
+        break;
+    case TML_FC:
+        ops = memout*memin;
+        break;
+    case TML_SOFTMAX:
+        ops = 6*memout;                             //mixed
+        break;
+    case TML_MAXPOOL:
+    case TML_AVGPOOL: {
+        tml_pool_t* l = (tml_pool_t*)(layer_body);
+        ops = memout*(l->kernel_w)*(l->kernel_h);
+        break;}
+    case TML_ADD:
+        in1 = memout;
+        break;
+    case TML_CONCAT:
+        in1 = h->in_dims[1]*h->in_dims[2]*((tml_concat_t*)h)->in_c1;
+        break;
+    case TML_MUL: {
+        tml_mul_t* l = (tml_mul_t*)(layer_body);
+        in1 = l->in_dims1[1]*l->in_dims1[2]*l->in_dims1[3];
+        ops = memout;
+        break;}
+    case TML_HARDSWISH:
+        ops = memout;
+        break;
+    case TML_RESIZE: {
+        tml_resize_t* l = (tml_resize_t*)(layer_body);
+        ops = l->mode == TM_RESIZE_BILINEAR ? 4*memout : 0;
+        break;}
+    default:
+        break;
+    }
+    if(rd) *rd = (memin + in1)*sizeof(mtype_t) + (h->type == TML_RESHAPE ? 0 : h->size - tml_headsize_tbl[h->type]);
+    if(wr) *wr = h->type == TML_RESHAPE ? 0 : memout*sizeof(mtype_t);
+    return ops;
+}
+
+static tm_err_t tm_stat_layer(int layer_i, tml_head_t* h, int* sum_param, int* sum_ops)
+{
+    uint8_t* layer_body = (uint8_t*)h;
+    TM_DBG("type=%d, is_out=%d, size=%d, in_oft=%d, out_oft=%d, in_dims=[%d,%d,%d,%d], out_dims=[%d,%d,%d,%d], in_s=%.3f, in_zp=%d, out_s=%.3f, out_zp=%d\n",\
+            h->type,h->is_out,h->size,h->in_oft,h->out_oft,\
+            h->in_dims[0],h->in_dims[1],h->in_dims[2],h->in_dims[3],\
+            h->out_dims[0],h->out_dims[1],h->out_dims[2],h->out_dims[3],\
+            h->in_s,(int32_t)(h->in_zp),h->out_s,(int32_t)(h->out_zp));
+    if(h->type < TML_MAXCNT) {
+        int memout = h->out_dims[1]*h->out_dims[2]*h->out_dims[3];
+        *sum_param += (h->size - tml_headsize_tbl[h->type]);
+        int ops = (int)tm_layer_cost(h, NULL, NULL);
+        switch(h->type){
+        case TML_CONV2D: {
+            tml_conv2d_dw_t* l = (tml_conv2d_dw_t*)(layer_body);
+            TM_DBG("Conv2d: kw=%d, kh=%d, sw=%d, sh=%d, dw=%d, dh=%d, act=%d, pad=[%d,%d,%d,%d], dmul=%d, ws_oft=%d, w_oft=%d, b_oft=%d\n",\
+                l->kernel_w, l->kernel_h, l->stride_w, l->stride_h, l->dilation_w, l->dilation_h, \
+                l->act, l->pad[0], l->pad[1], l->pad[2], l->pad[3], l->depth_mul, \
+                l->ws_oft, l->w_oft, l->b_oft);
+            break;}
+        case TML_FC: {
+            tml_fc_t* l = (tml_fc_t*)(layer_body);
+            TM_DBG("FC: ws_oft=%d, w_oft=%d, b_oft=%d\n",\
+                l->ws_oft, l->w_oft, l->b_oft);
+            break;}
+        case TML_DWCONV2D: {
+            tml_conv2d_dw_t* l = (tml_conv2d_dw_t*)(layer_body);
+            TM_DBG("DWConv2d: kw=%d, kh=%d, sw=%d, sh=%d, dw=%d, dh=%d, act=%d, pad=[%d,%d,%d,%d], dmul=%d, ws_oft=%d, w_oft=%d, b_oft=%d\n",\
+                l->kernel_w, l->kernel_h, l->stride_w, l->stride_h, l->dilation_w, l->dilation_h, \
+                l->act, l->pad[0], l->pad[1], l->pad[2], l->pad[3], l->depth_mul,\
+                l->ws_oft, l->w_oft, l->b_oft);
+            break;}
+        case TML_MAXPOOL:
+        case TML_AVGPOOL: {
+            tml_pool_t* l = (tml_pool_t*)(layer_body);
+            TM_DBG("Pool: kw=%d, kh=%d, sw=%d, sh=%d, pad=[%d,%d,%d,%d]\n",\
+                l->kernel_w, l->kernel_h, l->stride_w, l->stride_h, \
+                l->pad[0], l->pad[1], l->pad[2], l->pad[3]);
+            break;}
+        default:
+            break;
+        }
+        *sum_ops += ops;
+        printf("%03d\t%s      \t%3d,%3d,%3d\t%d\t%d\t%d\t%ld\t", layer_i, tml_str_tbl[h->type], \
+            h->out_dims[1], h->out_dims[2], h->out_dims[3], \
+            h->in_oft, h->out_oft, h->size - tml_headsize_tbl[h->type], \
+            (long int)(memout*sizeof(mtype_t)));
+        printf("%d\r\n", ops);
+    } else {
+        return TM_ERR_LAYERTYPE;
+    }
+    return TM_OK;
+}
+
 tm_err_t tm_stat(tm_mdlbin_t* b)
 {   
     printf("================================ model stat ================================\n");
@@ -68,56 +212,16 @@ tm_err_t tm_stat(tm_mdlbin_t* b)
     int layer_i;
     for(layer_i = 0; layer_i < b->layer_cnt; layer_i++){
         tml_head_t* h = (tml_head_t*)(layer_body);
-        TM_DBG("body oft = %d\n", (uint32_t)((size_t)h - (size_t)(b)));
-        TM_DBG("type=%d, is_out=%d, size=%d, in_oft=%d, out_oft=%d, in_dims=[%d,%d,%d,%d], out_dims=[%d,%d,%d,%d], in_s=%.3f, in_zp=%d, out_s=%.3f, out_zp=%d\n",\
-                h->type,h->is_out,h->size,h->in_oft,h->out_oft,\
-                h->in_dims[0],h->in_dims[1],h->in_dims[2],h->in_dims[3],\
-                h->out_dims[0],h->out_dims[1],h->out_dims[2],h->out_dims[3],\
-                h->in_s,(int32_t)(h->in_zp),h->out_s,(int32_t)(h->out_zp));
-        if(h->type < TML_MAXCNT) {
-            int memout = h->out_dims[1]*h->out_dims[2]*h->out_dims[3];
-            sum_param += (h->size - tml_headsize_tbl[h->type]);
-            int ops = 0;
-            switch(h->type){
-            case TML_CONV2D: {
-                tml_conv2d_dw_t* l = (tml_conv2d_dw_t*)(layer_body);
-                ops = memout*(l->kernel_w)*(l->kernel_h)*(h->in_dims[3]);   //MAC as ops
-                TM_DBG("Conv2d: kw=%d, kh=%d, sw=%d, sh=%d, dw=%d, dh=%d, act=%d, pad=[%d,%d,%d,%d], dmul=%d, ws_oft=%d, w_oft=%d, b_oft=%d\n",\
-                    l->kernel_w, l->kernel_h, l->stride_w, l->stride_h, l->dilation_w, l->dilation_h, \
-                    l->act, l->pad[0], l->pad[1], l->pad[2], l->pad[3], l->depth_mul, \
-                    l->ws_oft, l->w_oft, l->b_oft);
-                break;}
-            case TML_GAP:
-                ops = (h->in_dims[1])*(h->in_dims[2])*(h->in_dims[3]);  //SUM as ops
-                break;
-            case TML_FC: {
-                tml_fc_t* l = (tml_fc_t*)(layer_body);
-                ops = (h->out_dims[3])*(h->in_dims[3]);         //MAC as ops
-                TM_DBG("FC: ws_oft=%d, w_oft=%d, b_oft=%d\n",\
-                    l->ws_oft, l->w_oft, l->b_oft);
-                break;}
-            case TML_SOFTMAX:
-                ops = 6*(h->out_dims[3]);                       //mixed
-                break;
-            case TML_DWCONV2D: {
-                tml_conv2d_dw_t* l = (tml_conv2d_dw_t*)(layer_body);
-                ops = memout*(l->kernel_w)*(l->kernel_h)*1;   //MAC as ops
-                TM_DBG("DWConv2d: kw=%d, kh=%d, sw=%d, sh=%d, dw=%d, dh=%d, act=%d, pad=[%d,%d,%d,%d], dmul=%d, ws_oft=%d, w_oft=%d, b_oft=%d\n",\
-                    l->kernel_w, l->kernel_h, l->stride_w, l->stride_h, l->dilation_w, l->dilation_h, \
-                    l->act, l->pad[0], l->pad[1], l->pad[2], l->pad[3], l->depth_mul,\
-                    l->ws_oft, l->w_oft, l->b_oft);
-                break;}
-            default:
-                ops = 0;
-                break;
+        if(h->type == TML_GROUP) {      //the group, then its members
+            tml_group_t* g = (tml_group_t*)h;
+            printf("%03d\t%s(%d)  \t%3d,%3d,%3d\t%d\t%d\t%d rows a step\r\n", layer_i, tml_str_tbl[h->type], g->cnt, \
+                h->out_dims[1], h->out_dims[2], h->out_dims[3], h->in_oft, h->out_oft, g->band);
+            uint8_t* mbody = layer_body + sizeof(tml_group_t);
+            for(int j = 0; j < g->cnt; j++) {
+                if(tm_stat_layer(layer_i, (tml_head_t*)mbody, &sum_param, &sum_ops) != TM_OK) return TM_ERR_LAYERTYPE;
+                mbody += ((tml_head_t*)mbody)->size;
             }
-            sum_ops += ops;
-            printf("%03d\t%s      \t%3d,%3d,%3d\t%d\t%d\t%d\t%ld\t", layer_i, tml_str_tbl[h->type], \
-                h->out_dims[1], h->out_dims[2], h->out_dims[3], \
-                h->in_oft, h->out_oft, h->size - tml_headsize_tbl[h->type], \
-                (long int)(memout*sizeof(mtype_t)));
-            printf("%d\r\n", ops);
-        } else {
+        } else if(tm_stat_layer(layer_i, h, &sum_param, &sum_ops) != TM_OK) {
             return TM_ERR_LAYERTYPE;
         }
         layer_body += (h->size);
@@ -128,4 +232,105 @@ tm_err_t tm_stat(tm_mdlbin_t* b)
 } 
 
 
+/******************************* PROFILER ************************************/
+#ifndef TM_GET_CYCLE    //tm_port.h of an older tree
+#define TM_GET_CYCLE()  ((uint64_t)TM_GET_US())
+#define TM_CYCLE_PERUS  (1)
+#endif
+
+static tm_prof_t* prof_cur = NULL;
+
+tm_err_t tm_prof_init(tm_prof_t* p, const char* name, tm_mdl_t* mdl, tm_prof_layer_t* layers, int cnt)
+{
+    if(cnt < mdl->b->layer_cnt) return TM_ERR_OOM;
+    memset(p, 0, sizeof(tm_prof_t));
+    p->name      = name;
+    p->layers    = layers;
+    p->layer_cnt = mdl->b->layer_cnt;
+    uint8_t* body = mdl->b->layers_body;
+    for(int i = 0; i < p->layer_cnt; i++) {
+        tml_head_t* h = (tml_head_t*)body;
+        tm_prof_layer_t* l = &layers[i];
+        if(h->type >= TML_MAXCNT) return TM_ERR_LAYERTYPE;
+        memset(l, 0, sizeof(tm_prof_layer_t));
+        l->type = h->type;
+        memcpy(l->out_dims, h->out_dims, sizeof(l->out_dims));
+        l->ops  = tm_layer_cost(h, &l->rd_bytes, &l->wr_bytes);
+        body += h->size;
+    }
+    return TM_OK;
+}
+
+void tm_prof_start(tm_prof_t* p)
+{
+    prof_cur  = p;
+    p->run_t0 = TM_GET_CYCLE();
+    p->t0     = p->run_t0;
+}
+
+//time since the last layer end is this layer, the bookkeeping is not counted
+tm_err_t tm_prof_cb(tm_mdl_t* mdl, tml_head_t* lh)
+{
+    uint64_t t = TM_GET_CYCLE();
+    tm_prof_t* p = prof_cur;
+    if(p == NULL) return TM_OK;
+    if(mdl->layer_i < p->layer_cnt) {
+        tm_prof_layer_t* l = &p->layers[mdl->layer_i];
+        if(p->runs == 0 || t - p->t0 < l->cycles) l->cycles = t - p->t0;
+    }
+    p->t0 = TM_GET_CYCLE();
+    return TM_OK;
+}
+
+void tm_prof_end(tm_prof_t* p)
+{
+    uint64_t t = TM_GET_CYCLE() - p->run_t0;
+    if(p->runs == 0 || t < p->cycles) p->cycles = t;
+    p->runs++;
+    prof_cur = NULL;
+}
+
+void tm_prof_print(tm_prof_t* p, tm_prof_fmt_t fmt)
+{
+    uint64_t ops = 0, cycles = 0;
+    if(fmt == TM_PROF_TABLE) {
+        TM_PRINTF("==== %s: best of %d runs, %d cycles/us\n", p->name, p->runs, TM_CYCLE_PERUS);
+        TM_PRINTF("Idx\tLayer   \toutshape   \tOPS\tRD\tWR\tcycles\tus\tOPS/cycle\n");
+    } else if(fmt == TM_PROF_CSV) {
+        TM_PRINTF("model,idx,layer,h,w,c,ops,rd_bytes,wr_bytes,cycles,us,ops_per_cycle\n");
+    } else {
+        TM_PRINTF("{\"model\":\"%s\",\"runs\":%d,\"cycles_per_us\":%d,\"layers\":[\n", p->name, p->runs, TM_CYCLE_PERUS);
+    }
+    for(int i = 0; i < p->layer_cnt; i++) {
+        tm_prof_layer_t* l = &p->layers[i];
+        double us  = (double)l->cycles/TM_CYCLE_PERUS;
+        double opc = l->cycles ? (double)l->ops/l->cycles : 0;
+        ops += l->ops; cycles += l->cycles;
+        if(fmt == TM_PROF_TABLE)
+            TM_PRINTF("%03d\t%-8s\t%3d,%3d,%3d\t%lu\t%lu\t%lu\t%lu\t%.1f\t%.3f\n", i, tml_str_tbl[l->type], \
+                l->out_dims[1], l->out_dims[2], l->out_dims[3], (unsigned long)l->ops, (unsigned long)l->rd_bytes, \
+                (unsigned long)l->wr_bytes, (unsigned long)l->cycles, us, opc);
+        else if(fmt == TM_PROF_CSV)
+            TM_PRINTF("%s,%d,%s,%d,%d,%d,%lu,%lu,%lu,%lu,%.1f,%.3f\n", p->name, i, tml_str_tbl[l->type], \
+                l->out_dims[1], l->out_dims[2], l->out_dims[3], (unsigned long)l->ops, (unsigned long)l->rd_bytes, \
+                (unsigned long)l->wr_bytes, (unsigned long)l->cycles, us, opc);
+        else
+            TM_PRINTF(" {\"idx\":%d,\"layer\":\"%s\",\"out\":[%d,%d,%d],\"ops\":%lu,\"rd_bytes\":%lu,\"wr_bytes\":%lu,\"cycles\":%lu,\"us\":%.1f,\"ops_per_cycle\":%.3f}%s\n", \
+                i, tml_str_tbl[l->type], l->out_dims[1], l->out_dims[2], l->out_dims[3], (unsigned long)l->ops, \
+                (unsigned long)l->rd_bytes, (unsigned long)l->wr_bytes, (unsigned long)l->cycles, us, opc, \
+                i == p->layer_cnt-1 ? "" : ",");
+    }
+    //the whole run also counts tm_run itself and the callbacks
+    if(fmt == TM_PROF_TABLE)
+        TM_PRINTF("total %lu cycles, %.3f ms, layers %lu cycles, %.3f OPS/cycle\n", (unsigned long)p->cycles, \
+            (double)p->cycles/TM_CYCLE_PERUS/1000, (unsigned long)cycles, cycles ? (double)ops/cycles : 0);
+    else if(fmt == TM_PROF_CSV)
+        TM_PRINTF("%s,-1,Total,0,0,0,%lu,0,0,%lu,%.1f,%.3f\n", p->name, (unsigned long)ops, (unsigned long)p->cycles, \
+            (double)p->cycles/TM_CYCLE_PERUS, p->cycles ? (double)ops/p->cycles : 0);
+    else
+        TM_PRINTF("],\"ops\":%lu,\"cycles\":%lu,\"us\":%.1f}\n", (unsigned long)ops, (unsigned long)p->cycles, \
+            (double)p->cycles/TM_CYCLE_PERUS);
+}
+
+
 #endif
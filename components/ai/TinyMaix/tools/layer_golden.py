@@ -0,0 +1,141 @@
+# Copyright 2022 Sipeed Technology Co., Ltd. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+
+# TFLite goldens for host/tm_layer_test.c: one small keras model per layer, int8 and fp32 tflite,
+# the TFLite interpreter output on a random input, and the tmdl from tflite2tmdl, as C headers
+#   python3 layer_golden.py ../host/golden
+
+import os,sys
+import numpy as np
+import tensorflow as tf
+from tensorflow.keras import layers as L
+try:
+    from .tflite_reader import read_tflite
+    from .tflite2tmdl import pack_tmdl, TM_MDL_INT8, TM_MDL_FP32
+except:
+    from tflite_reader import read_tflite
+    from tflite2tmdl import pack_tmdl, TM_MDL_INT8, TM_MDL_FP32
+
+def concat_case(x):     #a is kept while b runs, its channels go first
+    a = L.Conv2D(8, 1, activation="relu")(x)
+    b = L.DepthwiseConv2D(3, padding="same")(a)
+    return L.Concatenate()([a, b])
+
+def se_case(x):         #squeeze-excite: mul by a 1x1xc scale
+    a = L.Conv2D(8, 1)(x)
+    s = L.GlobalAveragePooling2D(keepdims=True)(a)
+    s = L.Conv2D(8, 1, activation=tf.nn.relu6)(s)
+    return L.Multiply()([a, s])
+
+def hswish_case(x):     #the converter fuses x*relu6(x+3)/6 to HARD_SWISH
+    a = L.Conv2D(8, 1)(x)
+    return L.Lambda(lambda v: v*tf.nn.relu6(v+3.0)/6.0)(a)
+
+#name, input shape (h,w,c), model
+CASES = [
+    ("conv_d2",       (16,16,4), lambda x: L.Conv2D(8, 3, padding="same", dilation_rate=2, activation="relu")(x)),
+    ("dwconv_d2",     (16,16,8), lambda x: L.DepthwiseConv2D(3, padding="same", dilation_rate=2)(x)),
+    ("dwconv_dmul2",  (12,12,4), lambda x: L.DepthwiseConv2D(3, padding="same", depth_multiplier=2)(x)),
+    ("maxpool",       (16,16,8), lambda x: L.MaxPool2D(3, 2, padding="same")(x)),
+    ("avgpool",       (15,15,8), lambda x: L.AveragePooling2D(3, 2, padding="same")(x)),
+    ("avgpool_valid", (16,16,4), lambda x: L.AveragePooling2D(2)(x)),
+    ("concat",        (8,8,4),   concat_case),
+    ("mul_se",        (8,8,8),   se_case),
+    ("up_nearest",    (8,8,4),   lambda x: L.UpSampling2D(2, interpolation="nearest")(x)),
+    ("up_bilinear",   (8,8,4),   lambda x: L.UpSampling2D(2, interpolation="bilinear")(x)),
+    ("resize_align",  (6,6,4),   lambda x: L.Lambda(lambda v: tf.compat.v1.image.resize_bilinear(v, (11,11), align_corners=True))(x)),
+    ("hardswish",     (8,8,8),   hswish_case),
+]
+
+def to_tflite(model, shape, is_quant):
+    converter = tf.lite.TFLiteConverter.from_keras_model(model)
+    if is_quant:
+        def representative_data_gen():
+            rng = np.random.default_rng(1)
+            for i in range(64):
+                yield [rng.uniform(-1, 1, (1,)+shape).astype(np.float32)]
+        converter.optimizations = [tf.lite.Optimize.DEFAULT]
+        converter.representative_dataset = representative_data_gen
+        converter.target_spec.supported_ops = [tf.lite.OpsSet.TFLITE_BUILTINS_INT8]
+        converter.inference_input_type = tf.int8
+        converter.inference_output_type = tf.int8
+    return converter.convert()
+
+def run_tflite(tflite_model, x):
+    interpreter = tf.lite.Interpreter(model_content=tflite_model)
+    interpreter.allocate_tensors()
+    inp = interpreter.get_input_details()[0]
+    out = interpreter.get_output_details()[0]
+    if inp["dtype"] == np.int8:
+        s, zp = inp["quantization"]
+        x = np.clip(np.round(x/s)+zp, -128, 127).astype(np.int8)
+    interpreter.set_tensor(inp["index"], x)
+    interpreter.invoke()
+    return x, interpreter.get_tensor(out["index"])
+
+def c_array(fw, ctype, name, data, fmt, attr=""):
+    data = data.flatten()
+    fw.write("static const %s %s[%d]%s = {\n"%(ctype, name, data.size, attr))
+    for i in range(0, data.size, 16):
+        fw.write("    " + ", ".join(fmt%v for v in data[i:i+16]) + ",\n")
+    fw.write("};\n")
+
+def make_case(out_dir, name, shape, build, is_quant):
+    tag = name + ("_q" if is_quant else "_f")
+    x = L.Input(shape=shape, batch_size=1)
+    model = tf.keras.Model(x, build(x))
+    tflite_model = to_tflite(model, shape, is_quant)
+    tflite_name = os.path.join(out_dir, tag+".tflite")
+    tmdl_name = os.path.join(out_dir, tag+".tmdl")
+    open(tflite_name, "wb").write(tflite_model)
+
+    rng = np.random.default_rng(7)
+    x_in, y = run_tflite(tflite_model, rng.uniform(-1, 1, (1,)+shape).astype(np.float32))
+    layers = read_tflite(tflite_name, log_func=lambda *a: None)
+    pack_tmdl(layers, tmdl_name, TM_MDL_INT8 if is_quant else TM_MDL_FP32, 0, list(shape), list(y.shape[1:]), "<", write_c_header=False)
+    mdl = np.frombuffer(open(tmdl_name, "rb").read(), dtype=np.uint8)
+    os.remove(tflite_name)
+    os.remove(tmdl_name)
+
+    with open(os.path.join(out_dir, tag+".h"), "w") as fw:
+        fw.write("//generated by tools/layer_golden.py, TFLite %s, %s\n"%(tf.__version__, " ".join(l["name"] for l in layers)))
+        c_array(fw, "uint8_t", "golden_%s_mdl"%tag, mdl, "0x%02x", " __attribute__((aligned(8)))")
+        if is_quant:
+            c_array(fw, "mtype_t", "golden_%s_in"%tag, x_in, "%d")
+            c_array(fw, "mtype_t", "golden_%s_out"%tag, y, "%d")
+        else:
+            c_array(fw, "mtype_t", "golden_%s_in"%tag, x_in, "%#.9gf")
+            c_array(fw, "mtype_t", "golden_%s_out"%tag, y, "%#.9gf")
+    return tag
+
+def print_usage():
+    print("Usage: python3 layer_golden.py out_dir")
+
+if __name__ == '__main__':
+    if len(sys.argv) != 2:
+        print_usage()
+        exit()
+    out_dir = sys.argv[1]
+    os.makedirs(out_dir, exist_ok=True)
+    for is_quant in [1, 0]:
+        tags = [make_case(out_dir, name, shape, build, is_quant) for name, shape, build in CASES]
+        with open(os.path.join(out_dir, "cases_q.h" if is_quant else "cases_f.h"), "w") as fw:
+            fw.write("//generated by tools/layer_golden.py\n")
+            for tag in tags:
+                fw.write('#include "%s.h"\n'%tag)
+            fw.write("#define GOLDEN_CASES \\\n")
+            for tag in tags:
+                fw.write("    GOLDEN_CASE(%s) \\\n"%tag)
+            fw.write("\n")
@@ -15,13 +15,13 @@
 
 import os,sys
 import numpy as np
-import tensorflow as tf
 import time, struct
-from PIL import Image
 try:
     from .tflite_reader import read_tflite
+    from . import tmdl_opt
 except:
     from tflite_reader import read_tflite
+    import tmdl_opt
 
 
 # constant
@@ -43,12 +43,23 @@ TML_SOFTMAX   = 3
 TML_RESHAPE   = 4
 TML_DWCONV2D  = 5
 TML_ADD       = 6
+TML_MAXPOOL   = 7
+TML_AVGPOOL   = 8
+TML_CONCAT    = 9
+TML_MUL       = 10
+TML_RESIZE    = 11
+TML_HARDSWISH = 12
+TML_GROUP     = 13
 
 TM_PAD_VALID  = 0
 TM_PAD_SAME   = 1
 
 TM_ACT_NONE   = 0
 TM_ACT_RELU   = 1
+TM_ACT_RELU6  = 3
+
+TM_RESIZE_NEAREST  = 0
+TM_RESIZE_BILINEAR = 1
 
 layername2type={\
     "CONV_2D"          :TML_CONV2D, 
@@ -58,6 +69,13 @@ layername2type={\
     "RESHAPE"          :TML_RESHAPE,
     "DEPTHWISE_CONV_2D":TML_DWCONV2D,
     "ADD"              :TML_ADD,
+    "MAX_POOL_2D"      :TML_MAXPOOL,
+    "AVERAGE_POOL_2D"  :TML_AVGPOOL,
+    "CONCATENATION"    :TML_CONCAT,
+    "MUL"              :TML_MUL,
+    "RESIZE_NEAREST_NEIGHBOR":TML_RESIZE,
+    "RESIZE_BILINEAR"  :TML_RESIZE,
+    "HARD_SWISH"       :TML_HARDSWISH,
 }
 
 MDLBINHEAD_SIZE=64
@@ -98,6 +116,8 @@ def cal_buf_size(layers, mdl_type, out_deq):
     keep_sizes = [0]
     global unit_sizes 
     unit_size  = unit_sizes[mdl_type]
+    if layers[0].get("in_is_keep"):    #the model input is read again later, it stays in ADD-buf
+        keep_sizes.append(align8(np.prod(layers[0]["in_shape"])*unit_size))
     
     for l in layers:
         if l["is_output"] and out_deq and (mdl_type != TM_MDL_FP32) :  #fp16/fp8 also need deq
@@ -389,17 +409,95 @@ def pack_reshape(l, mdl_type, endian):
     return b''
 
 def pack_add(l, mdl_type, endian, buf_size):
+    act = l["fused_activation_function"]
+    if act not in [TM_ACT_NONE, TM_ACT_RELU, TM_ACT_RELU6]:
+        print("Not support ADD with fused_activation_function %d"%act)
+        assert 0
+    lbody = b''
+    lbody += struct.pack(endian+'i',  buf_size);  #input1-buf oft 
+    lbody += struct.pack(endian+'f',  l["i_scale1"]);  
+    lbody += struct.pack(endian+'f' if is_mdl_float(mdl_type) else endian+'i',  l["i_zeropoint1"])
+    lbody += struct.pack(endian+'I',  act);
+    return lbody
+
+def pack_pool(l, mdl_type, endian):     #maxpool and avgpool
+    if l["fused_activation_function"]:
+        print("Not support POOL with fused_activation_function now")
+        assert 0
+    kw = l["filter_width"]
+    kh = l["filter_height"]
+    lbody = b''
+    lbody += struct.pack('B',  kw);             #kernel_w
+    lbody += struct.pack('B',  kh);             #kernel_h
+    lbody += struct.pack('B',  l["stride_w"]);  #stride_w
+    lbody += struct.pack('B',  l["stride_h"]);  #stride_h
+    if l["padding"] == 0: #same
+        wpad = max(kw + (l["in_shape"][2] - 1) // l["stride_w"] * l["stride_w"] - l["in_shape"][2], 0)
+        hpad = max(kh + (l["in_shape"][1] - 1) // l["stride_h"] * l["stride_h"] - l["in_shape"][1], 0)
+        print("    padding same(T,B,L,R): %d,%d,%d,%d"%(hpad//2, hpad - hpad//2, wpad//2, wpad - wpad//2))
+        lbody += struct.pack('BBBB', int(hpad//2), int(hpad - hpad//2), int(wpad//2), int(wpad - wpad//2))
+    else:                  #valid
+        lbody += struct.pack(endian+'I',  0)
+        print("    padding valid")
+    assert len(lbody)%8 == 0
+    return lbody
+
+def pack_concat(l, mdl_type, endian, buf_size):
     if l["fused_activation_function"]:
-        assert "Not support ADD with fused_activation_function now"
+        print("Not support CONCATENATION with fused_activation_function now")
+        assert 0
+    assert list(l["in_shape"][1:-1]) == list(l["in_shape1"][1:-1])   #same h,w
     lbody = b''
     lbody += struct.pack(endian+'i',  buf_size);  #input1-buf oft 
     lbody += struct.pack(endian+'f',  l["i_scale1"]);  
     lbody += struct.pack(endian+'f' if is_mdl_float(mdl_type) else endian+'i',  l["i_zeropoint1"])
-    lbody += struct.pack(endian+'i',  0);
+    lbody += struct.pack(endian+'H',  l["in_shape1"][-1]);  #input1 channels
+    lbody += struct.pack(endian+'H',  l["in0_far"]);        #tflite input0 is the kept one, its channels go first
+    return lbody
+
+def pack_mul(l, mdl_type, endian, buf_size):
+    act = l["fused_activation_function"]
+    if act not in [TM_ACT_NONE, TM_ACT_RELU, TM_ACT_RELU6]:
+        print("Not support MUL with fused_activation_function %d"%act)
+        assert 0
+    tmp = list(l["in_shape1"])
+    if len(tmp) == len(l["out_shape"]):   #drop batch
+        tmp = tmp[1:]
+    is_const = "in1_const" in l
+    lbody = b''
+    lbody += struct.pack(endian+'i',  LAYERHEAD_SIZE+24 if is_const else buf_size);  #input1 oft, in the layer or in input1-buf
+    lbody += struct.pack(endian+'f',  l["i_scale1"]);  
+    lbody += struct.pack(endian+'f' if is_mdl_float(mdl_type) else endian+'i',  l["i_zeropoint1"])
+    lbody += struct.pack(endian+'4H', *shape2dims(tmp));    #input1 dims, 1 on broadcast dims
+    lbody += struct.pack(endian+'H',  act);
+    lbody += struct.pack(endian+'H',  1 if is_const else 0);
+    if is_const:
+        c = np.array(l["in1_const"]).flatten()
+        if mdl_type == TM_MDL_INT8:
+            lbody += c.astype(np.int8).tobytes()
+        elif mdl_type == TM_MDL_FP32:
+            lbody += struct.pack(endian+"%df"%(c.size),  *c)
+        elif mdl_type == TM_MDL_FP16:
+            lbody += struct.pack(endian+"%de"%(c.size),  *c)
+        else:
+            print("Not support constant MUL input for mdl type %d"%mdl_type)
+            assert 0
+        lbody += bytes(align8(len(lbody))-len(lbody))
+    assert len(lbody)%8 == 0
     return lbody
 
+def pack_resize(l, mdl_type, endian):
+    mode = TM_RESIZE_NEAREST if l["name"] == "RESIZE_NEAREST_NEIGHBOR" else TM_RESIZE_BILINEAR
+    lbody = b''
+    lbody += struct.pack('BBB', mode, int(l["align_corners"]), int(l["half_pixel_centers"]))
+    lbody += bytes(5)
+    return lbody
+
+def pack_hardswish(l, mdl_type, endian):
+    return b''
+
 ############################### PACK FUNCTIONS #####################################
-def pack_tmdl(layers, mdl_name, mdl_type, out_deq, in_dims, out_dims, endian, write_c_header=True):
+def pack_tmdl(layers, mdl_name, mdl_type, out_deq, in_dims, out_dims, endian, write_c_header=True, opt=True):
     global unit_size,w_type,b_type,b_type_np,bunit_size
     #mdl_name = "mnist.tmodel"
     fw = open(mdl_name, "wb")
@@ -452,6 +550,10 @@ def pack_tmdl(layers, mdl_name, mdl_type, out_deq, in_dims, out_dims, endian, wr
     out_size = np.prod(in_dims[1:])*unit_size
     layer_sizes = []
     keep_flag = 0
+    if layers[0].get("in_is_keep"):   #the model input goes in ADD-buf, as a kept layer output
+        out_oft = buf_size
+        out_oft_virt = 0
+        keep_flag = 1
     for index in range(len(layers)):
         l  = layers[index]
         print("%s    %s"%(l["name"], "KEEP" if l["is_keep"] else ""))
@@ -470,8 +572,7 @@ def pack_tmdl(layers, mdl_name, mdl_type, out_deq, in_dims, out_dims, endian, wr
                 assert 0
                 
         if l["is_keep"]:
-            if keep_flag == 1:
-                assert "Not support multi tmp buf for ADD branch"
+            assert keep_flag == 0, "Not support multi tmp buf for ADD branch"
             keep_flag = 1
 
         layer_size = 0  #dummy
@@ -533,6 +634,18 @@ def pack_tmdl(layers, mdl_name, mdl_type, out_deq, in_dims, out_dims, endian, wr
         elif l["name"] == "ADD":
             lbody = pack_add(l, mdl_type, endian, buf_size)
             keep_flag = 0
+        elif l["name"] == "MAX_POOL_2D" or l["name"] == "AVERAGE_POOL_2D":
+            lbody = pack_pool(l, mdl_type, endian)
+        elif l["name"] == "CONCATENATION":
+            lbody = pack_concat(l, mdl_type, endian, buf_size)
+            keep_flag = 0
+        elif l["name"] == "MUL":
+            lbody = pack_mul(l, mdl_type, endian, buf_size)
+            keep_flag = 0
+        elif l["name"] == "RESIZE_NEAREST_NEIGHBOR" or l["name"] == "RESIZE_BILINEAR":
+            lbody = pack_resize(l, mdl_type, endian)
+        elif l["name"] == "HARD_SWISH":
+            lbody = pack_hardswish(l, mdl_type, endian)
         else:
             print("unsupport layer type %s"%l["name"])
             assert 0
@@ -549,44 +662,47 @@ def pack_tmdl(layers, mdl_name, mdl_type, out_deq, in_dims, out_dims, endian, wr
 
     print("================    pack done!   ================")
     fw.close()
+    lbuf_len = MDLBINHEAD_SIZE+max(layer_sizes)
+    # layer groups and buffer planning, kept only if the buffer gets smaller
+    if opt:
+        print("================  optimize buffer ================")
+        fr=open(mdl_name, "rb")
+        data = fr.read()
+        fr.close()
+        data, opt_size, opt_lbuf = tmdl_opt.opt_tmdl(data)
+        if opt_lbuf is not None:
+            buf_size, keep_size = opt_size, 0
+            lbuf_len = max(lbuf_len, MDLBINHEAD_SIZE+opt_lbuf)
+            model_size = len(data)
+            with open(mdl_name, "wb") as fw:
+                fw.write(data)
     # write c header file
     if write_c_header:
         hmdl = ".".join(mdl_name.split(".")[:-1])+".h"
         fr=open(mdl_name, "rb")
         data = fr.read()
         fr.close()
-        with open(hmdl, "w", encoding="utf-8") as fw:
-            fw.writelines("#ifndef __MODEL_FILE__H\r\n")
-            fw.writelines("#define __MODEL_FILE__H\r\n\r\n")
-            fw.writelines("#include <stdint.h>\r\n")
-            fw.writelines("#define MDL_BUF_LEN (%d)\r\n"%buf_size)
-            fw.writelines("#define LBUF_LEN (%d)\r\n"%(MDLBINHEAD_SIZE+max(layer_sizes)))
-            fw.writelines("const uint8_t mdl_data[%d]={\\\r\n\t"%(len(data)))
-            for i in range(len(data)):
-                fw.writelines("0x%02x, "%(data[i]))
-                if i%16 == 15:
-                    fw.writelines("\r\n\t")
-            fw.writelines("\r};\r\n")
-            fw.writelines("\r\n#endif\r\n")
+        tmdl_opt.write_c_header(hmdl, data, buf_size, lbuf_len)
 
     print("    model  size %.1fKB (%d B) FLASH"%(model_size/1024, model_size))
     print("    buffer size %.1fKB (%d B) RAM"%(buf_size/1024, buf_size))
     print("    single layer mode subbuff size %.1fKB (%d+%d=%d B) RAM"%\
-        ((MDLBINHEAD_SIZE+max(layer_sizes))/1024, MDLBINHEAD_SIZE, max(layer_sizes), MDLBINHEAD_SIZE+max(layer_sizes)))
-    print("Saved to %s, %s" % (mdl_name, hmdl))
+        (lbuf_len/1024, MDLBINHEAD_SIZE, lbuf_len-MDLBINHEAD_SIZE, lbuf_len))
+    print("Saved to %s" % mdl_name + (", %s" % hmdl if write_c_header else ""))
     #!ls -lh $mdl_name
 
-def tflite2tmdl(tflite_name, tmdl_name, mdl_type, out_deq, in_dims, out_dims, endian, write_c_header=True, log_func=print):
+def tflite2tmdl(tflite_name, tmdl_name, mdl_type, out_deq, in_dims, out_dims, endian, write_c_header=True, log_func=print, opt=True):
     layers = read_tflite(tflite_name, log_func=log_func)
-    pack_tmdl(layers, tmdl_name, mdl_type, out_deq, in_dims, out_dims, endian, write_c_header=write_c_header)
+    pack_tmdl(layers, tmdl_name, mdl_type, out_deq, in_dims, out_dims, endian, write_c_header=write_c_header, opt=opt)
 
 def print_usage():
-    print("Usage: python3 tflite2tmdl.py tflite_name tmdl_name mdl_type out_deq in_dims out_dims [is_be]")
+    print("Usage: python3 tflite2tmdl.py tflite_name tmdl_name mdl_type out_deq in_dims out_dims [is_be] [opt]")
     print("       mdl_type: fp32, int8, int16, fp16, fp8_143, fp8_152")
     print("       out_deq: if enable output dequant")
     print("       in_dims,out_dims: dims except batch dim, max 3dims")
     print("       currently only support single input/output convert")
     print("       is_be: is big endian, default 0")
+    print("       opt: layer groups and buffer planning of tmdl_opt.py, default 1")
 
 
 # python3 tflite2tmdl.py tflite/mnist_dw_f.tflite tmdl/mnist_dw_fp16.tmdl fp16 1 28,28,1 10
@@ -611,12 +727,15 @@ if __name__ == '__main__':
     endian      = "<"
     if len(sys.argv) > 7:
         endian  = ">" if int(sys.argv[7]) != 0 else "<"
+    opt         = 1
+    if len(sys.argv) > 8:
+        opt     = int(sys.argv[8])
         
     in_dims  = in_dims.split(",")
     in_dims  = [int(i) for i in in_dims]
     out_dims = out_dims.split(",")
     out_dims = [int(i) for i in out_dims]
-    tflite2tmdl(tflite_name, tmdl_name, mdl_type, out_deq, in_dims, out_dims, endian)
+    tflite2tmdl(tflite_name, tmdl_name, mdl_type, out_deq, in_dims, out_dims, endian, opt=opt)
 
 
 
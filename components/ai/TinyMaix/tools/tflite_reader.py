@@ -14,23 +14,13 @@
 # ==============================================================================
 
 import numpy as np
-from keras.datasets import mnist
-from tensorflow.python.keras.backend import set_session
-from tensorflow.python.keras.models import load_model
-from tensorflow.keras.models import Model, load_model, Sequential
-from tensorflow.keras.layers import Conv2D, Dense, MaxPooling2D, Softmax, Activation, BatchNormalization, Flatten, Dropout, DepthwiseConv2D
-from tensorflow.keras.layers import MaxPool2D, AvgPool2D, AveragePooling2D, GlobalAveragePooling2D,ZeroPadding2D,Input,Embedding,PReLU
-from keras.callbacks import ModelCheckpoint
-from keras.callbacks import TensorBoard
-from keras.utils import np_utils
-from keras.preprocessing.image import ImageDataGenerator
-import keras.backend as K
-import tensorflow as tf
-import time
-
-#/tensorflow/lite/tools/visualize.py
 import re
-from tensorflow.lite.python import schema_py_generated as schema_fb
+try:    #split_two_inputs and tflite2tmdl's packing run without tensorflow, read_tflite needs it
+    import tensorflow as tf
+    #/tensorflow/lite/tools/visualize.py
+    from tensorflow.lite.python import schema_py_generated as schema_fb
+except ImportError:
+    tf = None
  
 def BuiltinCodeToName(code):
     """Converts a builtin op code enum to a readable name."""
@@ -66,6 +56,60 @@ def CreateDictFromFlatbuffer(buffer_data):
     return FlatbufferToDict(model, preserve_as_numpy=False)
 
 
+def tensor_quant(tensor):
+    if tensor["quantization"]['scale'] is not None:
+        return tensor['quantization']['scale'][0], tensor['quantization']['zero_point'][0]
+    return 1, 0
+
+# ADD, CONCATENATION, MUL: the nearer input runs right before this layer and comes in ping-pong buf (in_oft),
+# the farther one, a layer output or the model input, is kept in tmpbuf (in_oft1). in0_far is 1 if tflite
+# input0 is the kept one. A constant input of MUL goes in the layer body: const_func(idx) is the data of
+# tensor idx, None if it is not constant
+def split_two_inputs(l, layers, tensors, input_idx, input_idx1, graph_inputs, const_func, log_func):
+    def src(idx):   #the layer writing tensor idx, -1 the model input, None a constant
+        if const_func(idx) is not None:
+            return None
+        for _i in range(len(layers)-1, -1, -1):
+            if layers[_i]["out_name"] == tensors[idx]["name"]:
+                return _i
+        if idx in graph_inputs:
+            return -1
+        raise Exception("%s: not found input %s before"%(l["name"], tensors[idx]["name"]))
+    idx0 = src(input_idx)
+    idx1 = src(input_idx1)
+    if idx0 is None or idx1 is None:
+        if l["name"] != "MUL":
+            raise Exception("%s: only MUL takes a constant input"%l["name"])
+        if idx0 is None and idx1 is None:
+            raise Exception("%s: both inputs are constant"%l["name"])
+        near, near_idx, const_idx = (idx1, input_idx1, input_idx) if idx0 is None else (idx0, input_idx, input_idx1)
+        if near != len(layers)-1:
+            raise Exception("%s: the input must be the output of the layer before"%l["name"])
+        l.update({"in_shape":tensors[near_idx]["shape"], "in_name":tensors[near_idx]["name"]})
+        l.update({"in_shape1":tensors[const_idx]["shape"], "in_name1":tensors[const_idx]["name"]})
+        l["i_scale"],  l["i_zeropoint"]  = tensor_quant(tensors[near_idx])
+        l["i_scale1"], l["i_zeropoint1"] = tensor_quant(tensors[const_idx])
+        l["in1_const"] = const_func(const_idx)
+        l["in0_far"] = 0
+        log_func("    input1: %s, constant"%(tensors[const_idx]["name"]))
+        return
+    if idx0 == idx1:
+        raise Exception("%s: the same input twice is not supported"%l["name"])
+    near, far = (idx0, idx1) if idx0 > idx1 else (idx1, idx0)
+    if near != len(layers)-1:
+        raise Exception("%s: one input must be the output of the layer before"%l["name"])
+    if far >= 0:
+        layers[far]["is_keep"] = 1
+    else:   #the model input, tflite2tmdl puts it in tmpbuf from the start
+        layers[0]["in_is_keep"] = 1
+    near_idx, far_idx = (input_idx, input_idx1) if near == idx0 else (input_idx1, input_idx)
+    l.update({"in_shape":tensors[near_idx]["shape"], "in_name":tensors[near_idx]["name"]})
+    l.update({"in_shape1":tensors[far_idx]["shape"], "in_name1":tensors[far_idx]["name"]})
+    l["i_scale"],  l["i_zeropoint"]  = tensor_quant(tensors[near_idx])
+    l["i_scale1"], l["i_zeropoint1"] = tensor_quant(tensors[far_idx])
+    l["in0_far"] = 1 if far == idx0 else 0
+    log_func("    input1: %s, kept"%(tensors[far_idx]["name"]))
+
 def read_tflite(tflite_name, log_func=print):
     layers = []
     # Read the model.
@@ -81,6 +125,10 @@ def read_tflite(tflite_name, log_func=print):
     tensors = subg['tensors']          #weight, bias here
     input_idxs = subg['inputs']
     output_idxs = subg['outputs']
+    buffers = data['buffers']
+    def const_func(idx):    #tensors with a buffer are weights, constants of MUL here
+        buf = buffers[tensors[idx]['buffer']]['data']
+        return interpreter.get_tensor(idx) if buf is not None and len(buf) > 0 else None
 
     # convert name to utf readable
     for i in range(len(tensors)):
@@ -236,35 +284,27 @@ def read_tflite(tflite_name, log_func=print):
             else:
                 raise Exception("only deal with pad+conv/dwconv")
         elif layer_name == "ADD":
-            if len(input_tensor_idx)>1:
-                input_idx1 = input_tensor_idx[1]
-                l.update({"in_shape1":tensors[input_idx1]["shape"]})
-                l.update({"in_name1":tensors[input_idx1]["name"]})
-                log_func("    input1: %s"%(tensors[input_idx1]["name"]))
-                if tensors[input_idx]["quantization"]['scale'] is not None:
-                    l.update({"i_scale1":tensors[input_idx1]['quantization' ]['scale'][0]})
-                    l.update({"i_zeropoint1":tensors[input_idx1]['quantization' ]['zero_point'][0]})
-                else:
-                    l.update({"i_scale1":1})
-                    l.update({"i_zeropoint1":0})
-                is_in = 0
-                idx0 = -1
-                idx1 = -1
-                for _i in range(len(layers)):
-                    if layers[_i]["out_name"] ==  tensors[input_idx]["name"]:
-                        idx0 = _i
-                        break
-                for _i in range(len(layers)):
-                    if layers[_i]["out_name"] ==  tensors[input_idx1]["name"]:
-                        idx1 = _i
-                        break
-                if idx0 < 0 or idx1 < 0:
-                    raise Exception("not found input0 or input1 node before!")
-                if abs(idx-idx0) > abs(idx-idx1):   #keep far one in tmpbuf
-                    layers[idx0]["is_keep"] = 1
-                else:
-                    layers[idx1]["is_keep"] = 1
-            log_func("    add no param")
+            if len(input_tensor_idx) != 2:
+                raise Exception("only support ADD of 2 inputs")
+            #the quant of each input goes with the buffer it is read from
+            split_two_inputs(l, layers, tensors, input_idx, input_tensor_idx[1], input_idxs, const_func, log_func)
+        elif layer_name == "MAX_POOL_2D" or layer_name == "AVERAGE_POOL_2D":
+            log_func("    pool %dx%d, stride %d,%d"%(l["filter_width"], l["filter_height"], l["stride_w"], l["stride_h"]))
+        elif layer_name == "CONCATENATION":
+            if len(input_tensor_idx) != 2:
+                raise Exception("only support CONCATENATION of 2 inputs")
+            if l["axis"] not in [-1, len(tensors[input_idx]["shape"])-1]:
+                raise Exception("only support CONCATENATION on channel")
+            split_two_inputs(l, layers, tensors, input_idx, input_tensor_idx[1], input_idxs, const_func, log_func)
+        elif layer_name == "MUL":
+            if len(input_tensor_idx) != 2:
+                raise Exception("only support MUL of 2 inputs")
+            split_two_inputs(l, layers, tensors, input_idx, input_tensor_idx[1], input_idxs, const_func, log_func)
+        elif layer_name == "RESIZE_NEAREST_NEIGHBOR" or layer_name == "RESIZE_BILINEAR":
+            log_func("    resize to %s, align_corners %d, half_pixel_centers %d"%(str(l["out_shape"][1:3]), \
+                l["align_corners"], l["half_pixel_centers"]))
+        elif layer_name == "HARD_SWISH":
+            log_func("    hard_swish no param")
         elif layer_name in ["SHAPE", "STRIDED_SLICE", "PACK"]:
             log_func("    ignore %s" % layer_name)
             continue
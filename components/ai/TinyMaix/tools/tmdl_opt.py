@@ -0,0 +1,439 @@
+# Copyright 2022 Sipeed Technology Co., Ltd. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+
+# tmdl post-pass, plain python: fold RESHAPE, fuse layer chains into row-streamed groups and
+# place the activations by liveness instead of ping-pong + keep buf.
+#   python3 tmdl_opt.py in.tmdl|in.h out.tmdl [mdl_name]
+#
+# group: a chain of conv/dwconv/pool and rowwise layers (ADD, MUL, CONCAT, HARD_SWISH) that tm_run
+# steps band rows of the last member at a time. The members between the first and the last write
+# a line buffer holding only the rows the next member still reads, so their outputs never exist whole:
+#   conv -> ADD (-> HARD_SWISH): the ADD runs in the conv postprocess (tml_conv2d_add), the conv
+#   output is neither stored nor read back, and with no line buffer left the group is one step
+#   FC -> softmax: the logits go straight to the softmax floats (tml_fc_softmax)
+#   the first conv layers: the big early activations are streamed, as MCUNetV2 patch inference,
+#   without its recompute as the lines keep the overlapping rows
+# The other layers do the same work as before, in less RAM
+
+import sys, re, struct
+
+MDLBINHEAD_SIZE = 64
+LAYERHEAD_SIZE  = 48
+GROUPHEAD_SIZE  = 56
+GROUP_MAXCNT    = 8     #TM_GROUP_MAXCNT
+BAND_PIX        = 64    #band rows are raised to this many output pixels if it costs no memory
+
+TML_CONV2D    = 0
+TML_GAP       = 1
+TML_FC        = 2
+TML_SOFTMAX   = 3
+TML_RESHAPE   = 4
+TML_DWCONV2D  = 5
+TML_ADD       = 6
+TML_MAXPOOL   = 7
+TML_AVGPOOL   = 8
+TML_CONCAT    = 9
+TML_MUL       = 10
+TML_RESIZE    = 11
+TML_HARDSWISH = 12
+TML_GROUP     = 13
+
+TM_MDL_INT8   = 0
+TM_MDL_FP32   = 2
+unit_sizes    = [1,2,4,2,1,1]
+
+TYPE_NAMES = ["conv", "gap", "fc", "softmax", "reshape", "dwconv", "add", "maxpool", "avgpool",
+              "concat", "mul", "resize", "hswish", "group"]
+
+def align8(x):
+    return (x+7)//8*8
+
+############################### READ #####################################
+def read_c_header(name):
+    with open(name, "r") as f:
+        txt = f.read()
+    return bytes(int(x, 16) for x in re.findall(r"0x([0-9a-fA-F]{2})", txt.split("{", 1)[1]))
+
+def read_tmdl(data):
+    assert data[0:4] == b"MAIX", "not a tmdl"
+    endian = "<" if struct.unpack("<H", data[20:22])[0] <= 3 else ">"
+    mdl = {"endian":endian, "mdl_type":data[4], "out_deq":data[5], "head":bytearray(data[:MDLBINHEAD_SIZE])}
+    layer_cnt, buf_size = struct.unpack(endian+"HI", data[10:16])
+    mdl["buf_size"] = buf_size
+    mdl["in_dims"]  = list(struct.unpack(endian+"4H", data[20:28]))
+    mdl["out_dims"] = list(struct.unpack(endian+"4H", data[28:36]))
+    layers = []
+    oft = MDLBINHEAD_SIZE
+    for i in range(layer_cnt):
+        typ, is_out, size, in_oft, out_oft = struct.unpack(endian+"HHIII", data[oft:oft+16])
+        assert typ != TML_GROUP, "model is optimized already"
+        raw = bytearray(data[oft:oft+size])
+        l = {"type":typ, "is_out":is_out, "in_oft":in_oft, "out_oft":out_oft, "raw":raw,
+             "in_dims":list(struct.unpack(endian+"4H", raw[16:24])),
+             "out_dims":list(struct.unpack(endian+"4H", raw[24:32]))}
+        if typ == TML_CONV2D or typ == TML_DWCONV2D:
+            kw,kh,sx,sy,dx,dy,act,pt,pb,pl,pr = struct.unpack(endian+"6BH4B", raw[48:60])
+            l.update({"kh":kh, "sy":sy, "dy":dy, "pt":pt})
+        elif typ == TML_MAXPOOL or typ == TML_AVGPOOL:
+            kw,kh,sx,sy,pt,pb,pl,pr = struct.unpack("8B", raw[48:56])
+            l.update({"kh":kh, "sy":sy, "dy":1, "pt":pt})
+        if typ == TML_ADD or typ == TML_CONCAT or typ == TML_MUL:
+            l["in_oft1"] = struct.unpack(endian+"I", raw[48:52])[0]
+            if typ == TML_MUL:
+                l["in_dims1"] = list(struct.unpack(endian+"4H", raw[60:68]))
+                if struct.unpack(endian+"H", raw[70:72])[0]:    #in1_const: in the layer, not a tensor
+                    del l["in_oft1"]
+            elif typ == TML_CONCAT:
+                c1 = struct.unpack(endian+"H", raw[60:62])[0]
+                l["in_dims1"] = l["in_dims"][:3] + [c1]
+            else:
+                l["in_dims1"] = list(l["in_dims"])
+        layers.append(l)
+        oft += size
+    return mdl, layers
+
+############################### GRAPH #####################################
+def dims_hwc(dims):
+    return dims[1], dims[2], dims[3]
+
+def tensor_bytes(mdl, dims, is_out=0, is_softmax=0):
+    h, w, c = dims_hwc(dims)
+    n = h*w*c
+    unit = unit_sizes[mdl["mdl_type"]]
+    if is_out and mdl["out_deq"] and mdl["mdl_type"] != TM_MDL_FP32:   #room for the dequant floats
+        return align8(n*unit) + align8(n*4)
+    if is_softmax:          #float middle
+        return align8(n*4)
+    return align8(n*unit)
+
+# inputs from the ping-pong layout: a layer reads what the last layer writing that oft wrote
+def build_graph(mdl, layers):
+    writes = {layers[0]["in_oft"]: -1}      #tensor -1 is the model input, i the output of layer i
+    for i, l in enumerate(layers):
+        l["idx"] = i
+        l["src"] = writes[l["in_oft"]]
+        if "in_oft1" in l:
+            l["src1"] = writes[l["in_oft1"]]
+        writes[l["out_oft"]] = i
+    #a RESHAPE only changes dims, and every layer has its own in_dims: read through it
+    for i, l in enumerate(layers):
+        if l["type"] == TML_RESHAPE and not l["is_out"]:
+            l["folded"] = 1
+            for m in layers[i+1:]:
+                if m["src"] == i: m["src"] = l["src"]
+                if m.get("src1") == i: m["src1"] = l["src"]
+    return [l for l in layers if not l.get("folded")]
+
+def layer_srcs(l):
+    return [l["src"]] + ([l["src1"]] if "src1" in l else [])
+
+############################### GROUPS #####################################
+def is_window(l):
+    return l["type"] in (TML_CONV2D, TML_DWCONV2D, TML_MAXPOOL, TML_AVGPOOL)
+
+#out row y reads row y of the near input and of the far one, or all of a far MUL input of 1 row
+def is_rowwise(l):
+    if l["type"] not in (TML_ADD, TML_CONCAT, TML_MUL, TML_HARDSWISH):
+        return 0
+    if l["in_dims"][1:3] != l["out_dims"][1:3]:
+        return 0
+    if "in_dims1" not in l or l["in_dims1"][1:3] == l["out_dims"][1:3]:
+        return 1
+    return l["type"] == TML_MUL and l["in_dims1"][1] == 1
+
+def is_member(l):
+    return l["in_dims"][0] == 3 and l["out_dims"][0] == 3 and (is_window(l) or is_rowwise(l))
+
+#a is run by the next member b, as TML_GROUP_FUSED: no line buffer for its output
+def is_fused(a, b):
+    return (a["type"] in (TML_CONV2D, TML_DWCONV2D) and b["type"] == TML_ADD) or \
+        (a["type"] == TML_FC and b["type"] == TML_SOFTMAX)
+
+#input rows that output rows [y0,y1) read, as tm_group_in_rows()
+def in_rows(l, y0, y1):
+    if is_window(l):
+        ekh = (l["kh"]-1)*l["dy"]+1
+        a = y0*l["sy"] - l["pt"]
+        b = (y1-1)*l["sy"] - l["pt"] + ekh
+        return max(a, 0), min(b, l["in_dims"][1])
+    return y0, y1
+
+#rows each line buffer holds at most, stepping as tm_run_group()
+def group_lines(g, band):
+    n = len(g)
+    cap = [0]*n
+    out_h = g[-1]["out_dims"][1]
+    for y in range(0, out_h, band):
+        lo, hi = y, min(y+band, out_h)
+        for j in range(n-1, 0, -1):
+            lo, hi = in_rows(g[j], lo, hi)
+            cap[j-1] = max(cap[j-1], hi-lo)
+    return cap[:n-1]
+
+############################### PLAN #####################################
+#ops: lists of layers, one layer or a group. returns {tensor: oft}, line ofts per op and the size
+def plan(mdl, ops, layers, bands):
+    pos = {}            #layer index -> op index
+    for t, op in enumerate(ops):
+        for l in op:
+            pos[l["idx"]] = t
+    birth = {-1: -1}
+    death = {-1: -1}
+    size  = {-1: tensor_bytes(mdl, mdl["in_dims"])}
+    for l in layers:
+        i = l["idx"]
+        birth[i] = death[i] = pos[i]
+        size[i] = tensor_bytes(mdl, l["out_dims"], l["is_out"], l["type"] == TML_SOFTMAX)
+        if l["is_out"]: death[i] = len(ops)
+    for l in layers:
+        for s in layer_srcs(l):
+            death[s] = max(death[s], pos[l["idx"]])
+    lines = {}          #(op, j) -> bytes
+    for t, op in enumerate(ops):
+        if len(op) > 1:
+            for j, rows in enumerate(group_lines(op, bands[t])):
+                if not is_fused(op[j], op[j+1]):
+                    h, w, c = dims_hwc(op[j]["out_dims"])
+                    lines[(t, j)] = align8(rows*w*c*unit_sizes[mdl["mdl_type"]])
+                del size[op[j]["idx"]]
+
+    #in place: the output takes the buffer of an input that dies here
+    root = {}           #tensor -> (tensor it lives in, oft in it)
+    def find(x):
+        r, o = x, 0
+        while r in root:
+            o += root[r][1]; r = root[r][0]
+        return r, o
+    for t, op in enumerate(ops):
+        l = op[-1]
+        o = l["idx"]
+        cands = []
+        if l["type"] == TML_RESHAPE:
+            cands = [(l["src"], 0)]
+        elif l["type"] in (TML_ADD, TML_MUL, TML_HARDSWISH):
+            if len(op) == 1 and l["in_dims"] == l["out_dims"]:
+                cands.append((l["src"], 0))
+            #not over a tensor an earlier member still reads rows of in the later bands
+            if "src1" in l and l["in_dims1"] == l["out_dims"] and all(l["src1"] not in layer_srcs(m) for m in op[:-1]):
+                cands.append((l["src1"], 0))
+        elif l["type"] == TML_SOFTMAX and len(op) == 1:
+            #softmax reads input c before it writes float c: the input may sit at the tail of the floats
+            h, w, c = dims_hwc(l["out_dims"])
+            cands = [(l["src"], c*(4-unit_sizes[mdl["mdl_type"]]))]
+        for s, rel in cands:
+            if s in size and death[s] == t and find(s)[0] != o and (l["type"] == TML_RESHAPE or \
+                size[s] == size[o] or l["type"] == TML_SOFTMAX):
+                r, ro = find(s)
+                root[o] = (r, ro - rel)     #o lives in s's buffer, rel before s
+                break
+
+    bufs = {}           #root -> [birth, death, lo, hi]
+    for x in size:
+        r, o = find(x)
+        b = bufs.setdefault(r, [birth[x], death[x], o, o+size[x]])
+        b[0] = min(b[0], birth[x]); b[1] = max(b[1], death[x])
+        b[2] = min(b[2], o); b[3] = max(b[3], o+size[x])
+    for (t, j), sz in lines.items():
+        bufs[("line", t, j)] = [t, t, 0, sz]
+
+    #greedy by size: biggest first, lowest oft clear of everything live at the same time
+    placed = {}
+    for k in sorted(bufs, key=lambda k: (-(bufs[k][3]-bufs[k][2]), bufs[k][0], str(k))):
+        b0, d0, lo, hi = bufs[k]
+        sz = align8(hi-lo)
+        busy = sorted((placed[p], placed[p]+align8(bufs[p][3]-bufs[p][2])) for p in placed \
+            if bufs[p][0] <= d0 and b0 <= bufs[p][1])
+        oft = 0
+        for a, e in busy:
+            if oft+sz <= a: break
+            oft = max(oft, e)
+        placed[k] = oft
+    total = max(placed[k]+align8(bufs[k][3]-bufs[k][2]) for k in placed)
+
+    ofts = {}
+    for x in size:
+        r, o = find(x)
+        ofts[x] = placed[r] - bufs[r][2] + o
+    line_ofts = {tj: placed[("line",)+tj] for tj in lines}
+    return ofts, line_ofts, total
+
+############################### OPTIMIZE #####################################
+def make_ops(layers, groups):
+    ops = []
+    i = 0
+    for a, b in sorted(groups):
+        ops += [[l] for l in layers[i:a]]
+        ops.append(layers[a:b])
+        i = b
+    ops += [[l] for l in layers[i:]]
+    return ops
+
+#band rows of each group: least buffer, then up to BAND_PIX pixels a step; all of them in one
+#step if every member is fused into the next, as there is no line buffer to keep small
+def plan_bands(mdl, ops, layers):
+    bands = {t: 1 for t, op in enumerate(ops) if len(op) > 1}
+    for t in bands:
+        out_h, out_w = ops[t][-1]["out_dims"][1], ops[t][-1]["out_dims"][2]
+        if all(is_fused(a, b) for a, b in zip(ops[t], ops[t][1:])):
+            bands[t] = out_h
+            continue
+        best = None
+        b = 1
+        while b <= out_h and b <= 16:
+            bands[t] = b
+            total = plan(mdl, ops, layers, bands)[2]
+            if best is None or total < best[1] or (total == best[1] and best[0]*out_w < BAND_PIX):
+                best = (b, total)
+            b *= 2
+        bands[t] = best[0]
+    return bands
+
+def optimize(mdl, layers):
+    layers = build_graph(mdl, layers)
+    n = len(layers)
+    cons = {-1: []}
+    for l in layers:
+        cons[l["idx"]] = []
+    for l in layers:
+        for s in layer_srcs(l):
+            cons[s].append(l["idx"])
+    def chained(p):     #layers[p+1] is the only reader of layers[p]
+        a, b = layers[p], layers[p+1]
+        return b["src"] == a["idx"] and cons[a["idx"]] == [b["idx"]] and not a["is_out"] and \
+            is_member(a) and is_member(b)
+
+    #conv/pool -> rowwise layers
+    fused = []
+    p = 0
+    while p < n-1:
+        if is_window(layers[p]) and is_rowwise(layers[p+1]) and chained(p):
+            q = p+2
+            while q < n and q-p < GROUP_MAXCNT and is_rowwise(layers[q]) and chained(q-1):
+                q += 1
+            fused.append((p, q))
+            p = q
+        else:
+            p += 1
+    #FC -> softmax
+    for p in range(n-1):
+        a, b = layers[p], layers[p+1]
+        if a["type"] == TML_FC and b["type"] == TML_SOFTMAX and b["src"] == a["idx"] and \
+            cons[a["idx"]] == [b["idx"]] and not a["is_out"]:
+            fused.append((p, p+2))
+    #stream the first layers, as many as give the least buffer
+    chain = 1
+    while chain < n and chain < GROUP_MAXCNT and chained(chain-1):
+        chain += 1
+    best = None
+    for k in [0] + list(range(2, chain+1)):
+        groups = [g for g in fused if g[0] >= k] + ([(0, k)] if k else [])
+        ops = make_ops(layers, groups)
+        bands = plan_bands(mdl, ops, layers)
+        total = plan(mdl, ops, layers, bands)[2]
+        if best is None or total < best[0]:
+            best = (total, ops, bands)
+    total, ops, bands = best
+    ofts, line_ofts, total = plan(mdl, ops, layers, bands)
+    return ops, bands, ofts, line_ofts, total
+
+############################### WRITE #####################################
+def pack_opt(mdl, ops, bands, ofts, line_ofts, total):
+    e = mdl["endian"]
+    data = bytearray(mdl["head"])
+    struct.pack_into(e+"H", data, 10, len(ops))
+    struct.pack_into(e+"I", data, 12, total)
+    def patch(l, in_oft, out_oft):
+        raw = bytearray(l["raw"])
+        struct.pack_into(e+"II", raw, 8, in_oft, out_oft)
+        if "src1" in l:
+            struct.pack_into(e+"I", raw, 48, ofts[l["src1"]])
+        return raw
+    layer_sizes = []
+    for t, op in enumerate(ops):
+        if len(op) == 1:
+            body = patch(op[0], ofts[op[0]["src"]], ofts[op[0]["idx"]])
+        else:
+            def member_out(j):  #a member fused into the next one writes where that one does
+                if j == len(op)-1: return ofts[op[j]["idx"]]
+                return member_out(j+1) if is_fused(op[j], op[j+1]) else line_ofts[(t, j)]
+            body = b""
+            for j, l in enumerate(op):
+                body += patch(l, ofts[l["src"]] if j == 0 else member_out(j-1), member_out(j))
+            first, last = op[0]["raw"], op[-1]["raw"]
+            gh  = struct.pack(e+"HHIII", TML_GROUP, op[-1]["is_out"], GROUPHEAD_SIZE+len(body), \
+                ofts[op[0]["src"]], ofts[op[-1]["idx"]])
+            gh += first[16:24] + last[24:32] + first[32:40] + last[40:48]
+            gh += struct.pack(e+"HHI", len(op), bands[t], 0)
+            assert len(gh) == GROUPHEAD_SIZE
+            body = gh + body
+        layer_sizes.append(len(body))
+        data += body
+    return bytes(data), max(layer_sizes)
+
+def opt_tmdl(data, log_func=print):
+    mdl, layers = read_tmdl(data)
+    ops, bands, ofts, line_ofts, total = optimize(mdl, layers)
+    fused = 0
+    for t, op in enumerate(ops):
+        if len(op) > 1:
+            names = [TYPE_NAMES[l["type"]] for l in op]
+            for j in range(len(op)-1):
+                if is_fused(op[j], op[j+1]):
+                    names[j] += "(fused)"
+                    fused += 1
+            log_func("    group %s, %d rows a step"%("+".join(names), bands[t]))
+    if total > mdl["buf_size"] or (total == mdl["buf_size"] and not fused):
+        log_func("    buffer %d B, ping-pong layout kept"%(mdl["buf_size"]))
+        return data, mdl["buf_size"], None
+    log_func("    buffer %d -> %d B, %d -> %d layers"%(mdl["buf_size"], total, len(layers), len(ops)))
+    data, lbuf = pack_opt(mdl, ops, bands, ofts, line_ofts, total)
+    return data, total, lbuf
+
+def write_c_header(hmdl, data, buf_size, lbuf_len):
+    with open(hmdl, "w", encoding="utf-8") as fw:
+        fw.writelines("#ifndef __MODEL_FILE__H\r\n")
+        fw.writelines("#define __MODEL_FILE__H\r\n\r\n")
+        fw.writelines("#include <stdint.h>\r\n")
+        fw.writelines("#define MDL_BUF_LEN (%d)\r\n"%buf_size)
+        fw.writelines("#define LBUF_LEN (%d)\r\n"%lbuf_len)
+        fw.writelines("const uint8_t mdl_data[%d]={\\\r\n\t"%(len(data)))
+        for i in range(len(data)):
+            fw.writelines("0x%02x, "%(data[i]))
+            if i%16 == 15:
+                fw.writelines("\r\n\t")
+        fw.writelines("\r};\r\n")
+        fw.writelines("\r\n#endif\r\n")
+
+def print_usage():
+    print("Usage: python3 tmdl_opt.py in.tmdl|in.h out.tmdl")
+    print("       writes out.tmdl and out.h")
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        print_usage()
+        exit()
+    src, dst = sys.argv[1], sys.argv[2]
+    if src.endswith(".h"):
+        data = read_c_header(src)
+    else:
+        with open(src, "rb") as f:
+            data = f.read()
+    data, buf_size, lbuf = opt_tmdl(data)
+    if lbuf is None:
+        lbuf = max(len(l["raw"]) for l in read_tmdl(data)[1])
+    with open(dst, "wb") as f:
+        f.write(data)
+    write_c_header(".".join(dst.split(".")[:-1])+".h", data, buf_size, MDLBINHEAD_SIZE+lbuf)
+    print("Saved to %s"%dst)
@@ -0,0 +1,102 @@
+/* host stand-in of riscv_vector.h for the TinyMaix and TFLM host builds, VLEN 128, only
+ * the intrinsics TinyMaix arch_rvv.h and TFLM kernels/riscv use */
+#ifndef _RISCV_VECTOR_H
+#define _RISCV_VECTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RVV_VLEN 128
+
+/* lanes = VLEN / SEW * LMUL */
+typedef struct { int8_t v[RVV_VLEN / 8]; } vint8m1_t;
+typedef struct { int16_t v[RVV_VLEN / 8]; } vint16m2_t;
+typedef struct { int32_t v[RVV_VLEN / 32]; } vint32m1_t;
+typedef struct { int32_t v[RVV_VLEN / 8]; } vint32m4_t;
+typedef struct { float v[RVV_VLEN / 8]; } vfloat32m4_t;
+
+static inline size_t rvv_vl(size_t avl, size_t vlmax)
+{
+    return avl < vlmax ? avl : vlmax;
+}
+
+static inline size_t __riscv_vsetvl_e8m1(size_t avl) { return rvv_vl(avl, RVV_VLEN / 8); }
+static inline size_t __riscv_vsetvl_e32m4(size_t avl) { return rvv_vl(avl, RVV_VLEN / 8); }
+
+#define RVV_FOR for (size_t i = 0; i < vl; i++)
+
+static inline vint32m1_t __riscv_vmv_v_x_i32m1(int32_t x, size_t vl) { vint32m1_t r = {{0}}; RVV_FOR r.v[i] = x; return r; }
+static inline vint32m4_t __riscv_vmv_v_x_i32m4(int32_t x, size_t vl) { vint32m4_t r = {{0}}; RVV_FOR r.v[i] = x; return r; }
+static inline int32_t __riscv_vmv_x_s_i32m1_i32(vint32m1_t a) { return a.v[0]; }
+
+static inline vint8m1_t __riscv_vle8_v_i8m1(const int8_t *p, size_t vl) { vint8m1_t r = {{0}}; RVV_FOR r.v[i] = p[i]; return r; }
+static inline vint32m4_t __riscv_vle32_v_i32m4(const int32_t *p, size_t vl) { vint32m4_t r = {{0}}; RVV_FOR r.v[i] = p[i]; return r; }
+static inline vfloat32m4_t __riscv_vle32_v_f32m4(const float *p, size_t vl) { vfloat32m4_t r = {{0}}; RVV_FOR r.v[i] = p[i]; return r; }
+static inline void __riscv_vse8_v_i8m1(int8_t *p, vint8m1_t a, size_t vl) { RVV_FOR p[i] = a.v[i]; }
+static inline void __riscv_vse32_v_i32m4(int32_t *p, vint32m4_t a, size_t vl) { RVV_FOR p[i] = a.v[i]; }
+
+static inline vint16m2_t __riscv_vsext_vf2_i16m2(vint8m1_t a, size_t vl) { vint16m2_t r = {{0}}; RVV_FOR r.v[i] = a.v[i]; return r; }
+static inline vint16m2_t __riscv_vadd_vx_i16m2(vint16m2_t a, int16_t x, size_t vl) { RVV_FOR a.v[i] += x; return a; }
+
+static inline vint16m2_t __riscv_vwmul_vv_i16m2(vint8m1_t a, vint8m1_t b, size_t vl)
+{
+    vint16m2_t r = {{0}};
+    RVV_FOR r.v[i] = (int16_t)a.v[i] * b.v[i];
+    return r;
+}
+
+static inline vint16m2_t __riscv_vwmul_vx_i16m2(vint8m1_t a, int8_t x, size_t vl)
+{
+    vint16m2_t r = {{0}};
+    RVV_FOR r.v[i] = (int16_t)a.v[i] * x;
+    return r;
+}
+
+/* acc + a * b, widened */
+static inline vint32m4_t __riscv_vwmacc_vv_i32m4(vint32m4_t acc, vint16m2_t a, vint16m2_t b, size_t vl)
+{
+    RVV_FOR acc.v[i] += (int32_t)a.v[i] * b.v[i];
+    return acc;
+}
+
+static inline vint32m4_t __riscv_vwadd_wv_i32m4(vint32m4_t a, vint16m2_t b, size_t vl)
+{
+    RVV_FOR a.v[i] += b.v[i];
+    return a;
+}
+
+/* element 0 of the result is scalar[0] + the sum of the vl elements */
+static inline vint32m1_t __riscv_vwredsum_vs_i16m2_i32m1(vint16m2_t a, vint32m1_t scalar, size_t vl)
+{
+    vint32m1_t r = scalar;
+    RVV_FOR r.v[0] += a.v[i];
+    return r;
+}
+
+static inline vint32m4_t __riscv_vadd_vv_i32m4(vint32m4_t a, vint32m4_t b, size_t vl) { RVV_FOR a.v[i] += b.v[i]; return a; }
+static inline vfloat32m4_t __riscv_vfcvt_f_x_v_f32m4(vint32m4_t a, size_t vl) { vfloat32m4_t r = {{0}}; RVV_FOR r.v[i] = (float)a.v[i]; return r; }
+static inline vfloat32m4_t __riscv_vfmul_vv_f32m4(vfloat32m4_t a, vfloat32m4_t b, size_t vl) { RVV_FOR a.v[i] *= b.v[i]; return a; }
+static inline vfloat32m4_t __riscv_vfmul_vf_f32m4(vfloat32m4_t a, float x, size_t vl) { RVV_FOR a.v[i] *= x; return a; }
+static inline vfloat32m4_t __riscv_vfadd_vf_f32m4(vfloat32m4_t a, float x, size_t vl) { RVV_FOR a.v[i] += x; return a; }
+static inline vfloat32m4_t __riscv_vfmax_vf_f32m4(vfloat32m4_t a, float x, size_t vl) { RVV_FOR a.v[i] = a.v[i] > x ? a.v[i] : x; return a; }
+static inline vfloat32m4_t __riscv_vfmin_vf_f32m4(vfloat32m4_t a, float x, size_t vl) { RVV_FOR a.v[i] = a.v[i] < x ? a.v[i] : x; return a; }
+
+/* round toward zero, saturate to int16 */
+static inline vint16m2_t __riscv_vfncvt_rtz_x_f_w_i16m2(vfloat32m4_t a, size_t vl)
+{
+    vint16m2_t r = {{0}};
+    RVV_FOR r.v[i] = a.v[i] >= 32767.f ? 32767 : a.v[i] <= -32768.f ? -32768 : (int16_t)a.v[i];
+    return r;
+}
+
+/* keep the low byte */
+static inline vint8m1_t __riscv_vncvt_x_x_w_i8m1(vint16m2_t a, size_t vl)
+{
+    vint8m1_t r = {{0}};
+    RVV_FOR r.v[i] = (int8_t)a.v[i];
+    return r;
+}
+
+#undef RVV_FOR
+
+#endif
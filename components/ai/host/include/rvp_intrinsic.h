@@ -0,0 +1,19 @@
+/* host stand-in of rvp_intrinsic.h for the TinyMaix and TFLM host builds, only what
+ * TinyMaix arch_rv32p.h and TFLM kernels/riscv use */
+#ifndef _RVP_INTRINSIC_H
+#define _RVP_INTRINSIC_H
+
+#include <stdint.h>
+
+/* t + sum of the 4 signed byte products of a and b */
+static inline long __rv_smaqa(long t, unsigned long a, unsigned long b)
+{
+    int32_t sum = (int32_t)t;
+
+    for (int i = 0; i < 32; i += 8) {
+        sum += (int8_t)(a >> i) * (int8_t)(b >> i);
+    }
+    return sum;
+}
+
+#endif
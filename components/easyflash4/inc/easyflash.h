@@ -49,6 +49,13 @@ size_t ef_get_env_blob(const char *key, void *value_buf, size_t buf_len, size_t
 bool ef_get_env_obj(const char *key, env_node_obj_t env);
 size_t ef_read_env_value(env_node_obj_t env, uint8_t *value_buf, size_t buf_len);
 EfErrCode ef_set_env_blob(const char *key, const void *value_buf, size_t buf_len);
+bool ef_env_gc_step(size_t budget);
+EfErrCode ef_txn_begin(ef_txn_t txn, void *buf, size_t size);
+EfErrCode ef_txn_set_env_blob(ef_txn_t txn, const char *key, const void *value_buf, size_t buf_len);
+EfErrCode ef_txn_set_env(ef_txn_t txn, const char *key, const char *value);
+EfErrCode ef_txn_del_env(ef_txn_t txn, const char *key);
+EfErrCode ef_txn_commit(ef_txn_t txn);
+void ef_txn_abort(ef_txn_t txn);
 
 /* ef_env.c, ef_env_legacy_wl.c and ef_env_legacy.c */
 EfErrCode ef_load_env(void);
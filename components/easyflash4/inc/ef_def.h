@@ -122,6 +122,14 @@ struct env_node_obj {
 };
 typedef struct env_node_obj *env_node_obj_t;
 
+/* ENV transaction, all ENV staged in it are written and become visible together */
+typedef struct _ef_txn {
+    uint8_t *buf;                                /**< staging buffer */
+    size_t size;                                 /**< staging buffer size */
+    size_t used;                                 /**< staged size */
+    size_t count;                                /**< staged ENV number */
+} ef_txn, *ef_txn_t;
+
 #ifdef __cplusplus
 }
 #endif
@@ -66,6 +66,21 @@
 #define EF_GC_EMPTY_SEC_THRESHOLD                1
 #endif
 
+/* the total remain empty sector threshold before ef_env_gc_step starts to collect */
+#ifndef EF_GC_STEP_SEC_THRESHOLD
+#define EF_GC_STEP_SEC_THRESHOLD                 (EF_GC_EMPTY_SEC_THRESHOLD + 1)
+#endif
+
+/* the max ENV header number ef_env_gc_step reads in one step */
+#ifndef EF_GC_STEP_SCAN_MAX
+#define EF_GC_STEP_SCAN_MAX                      16
+#endif
+
+/* the sector number which has a live size estimate for ef_env_gc_step, the sectors after count as full of live ENV */
+#ifndef EF_GC_STEP_SECTOR_MAX
+#define EF_GC_STEP_SECTOR_MAX                    64
+#endif
+
 /* the ENV cache table size, it will improve ENV search speed when using cache */
 #ifndef EF_ENV_CACHE_TABLE_SIZE
 #define EF_ENV_CACHE_TABLE_SIZE                  16
@@ -84,6 +99,20 @@
 #define EF_ENV_USING_CACHE
 #endif
 
+/* the ENV index table size (slot number, 8 bytes each), 0 is disabled. It indexes all ENV by name CRC32,
+ * so a lookup does not scan the sectors. Keep it above the ENV number * 4 / 3, else index falls back to scan */
+#ifndef EF_ENV_INDEX_SIZE
+#define EF_ENV_INDEX_SIZE                        0
+#endif
+
+#if (EF_ENV_INDEX_SIZE & (EF_ENV_INDEX_SIZE - 1)) != 0
+#error "The ENV index table size must be power of 2"
+#endif
+
+#if EF_ENV_INDEX_SIZE > 0
+#define EF_ENV_USING_INDEX
+#endif
+
 /* the sector is not combined value */
 #define SECTOR_NOT_COMBINED                      0xFFFFFFFF
 /* the next address is get failed */
@@ -137,6 +166,15 @@ extern uint32_t SECTOR_NUM;
 #define ENV_NAME_LEN_OFFSET                      ((unsigned long)(&((struct env_hdr_data *)0)->name_len))
 
 #define VER_NUM_ENV_NAME                         "__ver_num__"
+/* the ENV transaction commit record name */
+#define TXN_ENV_NAME                             "__txn__"
+
+/* the ENV transaction staged node flag */
+#define TXN_NODE_SET                             0x00
+#define TXN_NODE_DEL                             0x01
+#define TXN_NODE_SKIP                            0x02
+/* the ENV transaction staged node size, name and value are aligned by 4 bytes in staging buffer */
+#define TXN_NODE_SIZE(name_len, value_len)       (sizeof(struct txn_node_data) + EF_ALIGN(name_len, 4) + EF_ALIGN(value_len, 4))
 
 enum sector_store_status {
     SECTOR_STORE_UNUSED,
@@ -199,6 +237,25 @@ struct env_cache_node {
 };
 typedef struct env_cache_node *env_cache_node_t;
 
+struct env_index_node {
+    uint32_t name_crc;                           /**< ENV name's CRC32 value */
+    uint32_t addr;                               /**< ENV node address, FAILED_ADDR: empty slot */
+};
+typedef struct env_index_node *env_index_node_t;
+
+struct txn_node_data {
+    uint8_t name_len;                            /**< name length */
+    uint8_t flag;                                /**< staged node flag, @see TXN_NODE_SET */
+    uint16_t reserved;
+    uint32_t value_len;                          /**< value length, 0 when delete */
+};
+typedef struct txn_node_data *txn_node_data_t;
+
+struct txn_commit_item {
+    uint32_t new_addr;                           /**< the new ENV address, FAILED_ADDR: only delete */
+    uint32_t old_addr;                           /**< the old ENV address, FAILED_ADDR: not exist before */
+};
+
 struct sector_cache_node {
     uint32_t addr;                               /**< sector start address */
     uint32_t empty_addr;                         /**< sector empty address */
@@ -221,6 +278,12 @@ static bool init_ok = false;
 static bool gc_request = false;
 /* is in recovery check status when first reboot */
 static bool in_recovery_check = false;
+/* the sector collecting by ef_env_gc_step */
+static uint32_t gc_step_sector = FAILED_ADDR;
+/* the next ENV address to check in the collecting sector, the ENV before it are moved or dead */
+static uint32_t gc_step_cursor = FAILED_ADDR;
+/* the live ENV bytes of each sector, an estimate kept by new_env, move_env and del_env */
+static uint32_t sector_live_size[EF_GC_STEP_SECTOR_MAX];
 
 #ifdef EF_ENV_USING_CACHE
 /* ENV cache table */
@@ -229,6 +292,15 @@ struct env_cache_node env_cache_table[EF_ENV_CACHE_TABLE_SIZE] = { 0 };
 struct sector_cache_node sector_cache_table[EF_SECTOR_CACHE_TABLE_SIZE] = { 0 };
 #endif /* EF_ENV_USING_CACHE */
 
+#ifdef EF_ENV_USING_INDEX
+/* ENV index table, linear probing open addressing by name CRC32 */
+static struct env_index_node env_index_table[EF_ENV_INDEX_SIZE];
+/* the ENV number in index table */
+static size_t env_index_count = 0;
+/* index is holding all ENV, only then a miss in index means the ENV is not exist */
+static bool env_index_ok = false;
+#endif /* EF_ENV_USING_INDEX */
+
 static size_t set_status(uint8_t status_table[], size_t status_num, size_t status_index)
 {
     size_t byte_index = ~0UL;
@@ -529,6 +601,29 @@ static uint32_t get_next_env_addr(sector_meta_data_t sector, env_node_obj_t pre_
     return addr;
 }
 
+static void update_sector_live(uint32_t addr, size_t len, bool add)
+{
+    size_t i = (EF_ALIGN_DOWN(addr, SECTOR_SIZE) - env_start_addr) / SECTOR_SIZE;
+
+    if (i >= EF_GC_STEP_SECTOR_MAX) {
+        return;
+    }
+    if (add) {
+        sector_live_size[i] += len;
+    } else if (sector_live_size[i] > len) {
+        sector_live_size[i] -= len;
+    } else {
+        sector_live_size[i] = 0;
+    }
+}
+
+static size_t get_sector_live(uint32_t sec_addr)
+{
+    size_t i = (sec_addr - env_start_addr) / SECTOR_SIZE;
+
+    return i < EF_GC_STEP_SECTOR_MAX ? sector_live_size[i] : SECTOR_SIZE;
+}
+
 static EfErrCode read_env(env_node_obj_t env)
 {
     struct env_hdr_data env_hdr;
@@ -744,10 +839,150 @@ static bool find_env_no_cache(const char *key, env_node_obj_t env)
     return find_ok;
 }
 
+#ifdef EF_ENV_USING_INDEX
+static void reset_env_index(void)
+{
+    size_t i;
+
+    for (i = 0; i < EF_ENV_INDEX_SIZE; i++) {
+        env_index_table[i].addr = FAILED_ADDR;
+    }
+    env_index_count = 0;
+}
+
+/*
+ * Check the ENV name on flash, the ENV status is not checked
+ */
+static bool env_index_name_match(uint32_t addr, const char *name, size_t name_len)
+{
+    uint8_t saved_name_len;
+    char saved_name[EF_WG_ALIGN(EF_ENV_NAME_MAX)];
+
+    ef_port_read(addr + ENV_NAME_LEN_OFFSET, (uint32_t *) &saved_name_len, sizeof(saved_name_len));
+    if (saved_name_len != name_len) {
+        return false;
+    }
+    ef_port_read(addr + ENV_HDR_DATA_SIZE, (uint32_t *) saved_name, EF_WG_ALIGN(name_len));
+
+    return !strncmp(name, saved_name, name_len);
+}
+
+/*
+ * Delete the index slot, and shift back the following slots of the same probe chain.
+ * So there is no tombstone and the probe length will not grow with the delete times.
+ */
+static void del_env_index_slot(size_t i)
+{
+    size_t j = i, home;
+
+    while (1) {
+        j = (j + 1) & (EF_ENV_INDEX_SIZE - 1);
+        if (env_index_table[j].addr == FAILED_ADDR) {
+            break;
+        }
+        home = env_index_table[j].name_crc & (EF_ENV_INDEX_SIZE - 1);
+        /* the slot j can move to i when its home is not in cyclic (i, j] */
+        if ((i <= j) ? (home <= i || home > j) : (home <= i && home > j)) {
+            env_index_table[i] = env_index_table[j];
+            i = j;
+        }
+    }
+    env_index_table[i].addr = FAILED_ADDR;
+    env_index_count--;
+}
+
+/*
+ * Add, update or delete (addr is FAILED_ADDR) the ENV address in index.
+ */
+static void update_env_index(const char *name, size_t name_len, uint32_t addr)
+{
+    size_t i;
+    uint32_t name_crc;
+
+    if (!env_index_ok) {
+        return;
+    }
+
+    name_crc = ef_calc_crc32(0, name, name_len);
+    for (i = name_crc & (EF_ENV_INDEX_SIZE - 1); env_index_table[i].addr != FAILED_ADDR;
+            i = (i + 1) & (EF_ENV_INDEX_SIZE - 1)) {
+        if (env_index_table[i].name_crc == name_crc && env_index_name_match(env_index_table[i].addr, name, name_len)) {
+            if (addr != FAILED_ADDR) {
+                env_index_table[i].addr = addr;
+            } else {
+                del_env_index_slot(i);
+            }
+            return;
+        }
+    }
+
+    if (addr == FAILED_ADDR) {
+        return;
+    }
+    /* keep 1/4 slots empty for short probe chain, when it's full the index is not complete any more */
+    if (env_index_count >= EF_ENV_INDEX_SIZE - EF_ENV_INDEX_SIZE / 4) {
+        EF_INFO("Warning: The ENV index is full (%d), fall back to scan the flash.\r\n", env_index_count);
+        env_index_ok = false;
+        return;
+    }
+    env_index_table[i].name_crc = name_crc;
+    env_index_table[i].addr = addr;
+    env_index_count++;
+}
+
+static bool find_env_by_index(const char *key, env_node_obj_t env)
+{
+    size_t i, key_len = strlen(key);
+    uint32_t name_crc = ef_calc_crc32(0, key, key_len);
+
+    for (i = name_crc & (EF_ENV_INDEX_SIZE - 1); env_index_table[i].addr != FAILED_ADDR;
+            i = (i + 1) & (EF_ENV_INDEX_SIZE - 1)) {
+        if (env_index_table[i].name_crc == name_crc) {
+            env->addr.start = env_index_table[i].addr;
+            if (read_env(env) == EF_NO_ERR && env->name_len == key_len && !strncmp(env->name, key, key_len)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static bool load_env_index_cb(env_node_obj_t env, void *arg1, void *arg2)
+{
+    if (env->crc_is_ok && env->status == ENV_WRITE) {
+        update_env_index(env->name, env->name_len, env->addr.start);
+    }
+    /* stop when index is full */
+    return !env_index_ok;
+}
+
+/*
+ * Build the ENV index by one scan of all sectors
+ */
+static void load_env_index(void)
+{
+    struct env_node_obj env;
+
+    reset_env_index();
+    env_index_ok = true;
+    env_iterator(&env, NULL, NULL, load_env_index_cb);
+
+    EF_DEBUG("ENV index loaded, %d ENV in %d slots.\r\n", env_index_count, EF_ENV_INDEX_SIZE);
+}
+#endif /* EF_ENV_USING_INDEX */
+
 static bool find_env(const char *key, env_node_obj_t env)
 {
     bool find_ok = false;
 
+#ifdef EF_ENV_USING_INDEX
+    /* the index is holding all ENV, no need to scan the flash when missed */
+    if (env_index_ok) {
+        return find_env_by_index(key, env);
+    }
+#endif /* EF_ENV_USING_INDEX */
+
 #ifdef EF_ENV_USING_CACHE
     size_t key_len = strlen(key);
 
@@ -768,6 +1003,19 @@ static bool find_env(const char *key, env_node_obj_t env)
     return find_ok;
 }
 
+/*
+ * The ENV transaction commit record name is reserved, ef_load_env applies an ENV with this name.
+ */
+static bool key_is_reserved(const char *key)
+{
+    return !strcmp(key, TXN_ENV_NAME);
+}
+
+static bool env_is_txn(env_node_obj_t env)
+{
+    return env->name_len == strlen(TXN_ENV_NAME) && !strncmp(env->name, TXN_ENV_NAME, env->name_len);
+}
+
 static bool ef_is_str(uint8_t *value, size_t len)
 {
 #define __is_print(ch)       ((unsigned int)((ch) - ' ') < 127u - ' ')
@@ -822,6 +1070,10 @@ bool ef_get_env_obj(const char *key, env_node_obj_t env)
         return 0;
     }
 
+    if (!key || key_is_reserved(key)) {
+        return false;
+    }
+
     /* lock the ENV cache */
     ef_port_env_lock();
 
@@ -861,6 +1113,14 @@ size_t ef_get_env_blob(const char *key, void *value_buf, size_t buf_len, size_t
         log_warn("key err. %d > %d\r\n", strlen(key), EF_ENV_NAME_MAX);
         return EF_ENV_ARG_ERR;
     }
+
+    if (key_is_reserved(key)) {
+        if (saved_value_len) {
+            *saved_value_len = 0;
+        }
+        return 0;
+    }
+
     /* lock the ENV cache */
     ef_port_env_lock();
 
@@ -971,6 +1231,8 @@ static EfErrCode format_sector(uint32_t addr, uint32_t combined_value)
         sec_hdr.gc_flag = 0xFFFFFFFF;
         /* save the header */
         result = ef_port_write(addr, (uint32_t *)&sec_hdr, sizeof(struct sector_hdr_data));
+        /* nothing is live in the erased sector */
+        update_sector_live(addr, SECTOR_SIZE, false);
 
 #ifdef EF_ENV_USING_CACHE
         /* delete the sector cache */
@@ -1114,6 +1376,9 @@ static EfErrCode del_env(const char *key, env_node_obj_t old_env, bool complete_
         last_is_complete_del = true;
     } else {
         result = write_status(old_env->addr.start, status_table, ENV_STATUS_NUM, ENV_DELETED);
+        if (result == EF_NO_ERR) {
+            update_sector_live(old_env->addr.start, old_env->len, false);
+        }
 
         if (!last_is_complete_del && result == EF_NO_ERR) {
 #ifdef EF_ENV_USING_CACHE
@@ -1126,6 +1391,13 @@ static EfErrCode del_env(const char *key, env_node_obj_t old_env, bool complete_
                 update_env_cache(old_env->name, old_env->name_len, FAILED_ADDR);
             }
 #endif /* EF_ENV_USING_CACHE */
+#ifdef EF_ENV_USING_INDEX
+            if (key != NULL) {
+                update_env_index(key, strlen(key), FAILED_ADDR);
+            } else if (old_env != NULL) {
+                update_env_index(old_env->name, old_env->name_len, FAILED_ADDR);
+            }
+#endif /* EF_ENV_USING_INDEX */
         }
 
         last_is_complete_del = false;
@@ -1191,12 +1463,16 @@ static EfErrCode move_env(env_node_obj_t env)
             result = ef_port_write(env_addr + ENV_MAGIC_OFFSET + len, (uint32_t *) buf, size);
         }
         write_status(env_addr, status_table, ENV_STATUS_NUM, ENV_WRITE);
+        update_sector_live(env_addr, env->len, true);
 
 #ifdef EF_ENV_USING_CACHE
         update_sector_cache(EF_ALIGN_DOWN(env_addr, SECTOR_SIZE),
                 env_addr + ENV_HDR_DATA_SIZE + EF_WG_ALIGN(env->name_len) + EF_WG_ALIGN(env->value_len));
         update_env_cache(env->name, env->name_len, env_addr);
 #endif /* EF_ENV_USING_CACHE */
+#ifdef EF_ENV_USING_INDEX
+        update_env_index(env->name, env->name_len, env_addr);
+#endif /* EF_ENV_USING_INDEX */
     }
 
     EF_DEBUG("Moved the ENV (%.*s) from 0x%08X to 0x%08X.\r\n", env->name_len, env->name, env->addr.start, env_addr);
@@ -1224,6 +1500,8 @@ __retry:
             EF_DEBUG("Error: Alloc an ENV (size %d) failed after GC. ENV full.\n", env_size);
             gc_request = false;
         }
+    } else {
+        update_sector_live(empty_env, env_size, true);
     }
 
     return empty_env;
@@ -1321,7 +1599,12 @@ static void gc_collect(void)
 
     /* do GC collect */
     EF_DEBUG("The remain empty sector is %d, GC threshold is %d.\r\n", empty_sec, EF_GC_EMPTY_SEC_THRESHOLD);
+#ifdef EF_GC_INCREMENTAL
+    /* the pending GC is left to ef_env_gc_step, only collect here when the empty sector is critical low */
+    if (empty_sec <= EF_GC_EMPTY_SEC_THRESHOLD) {
+#else
     if (empty_sec <= EF_GC_EMPTY_SEC_THRESHOLD || sector_hdr_gc_flag != DEFAULT_GC_FLAG) {
+#endif
         if((empty_sec <= EF_GC_EMPTY_SEC_THRESHOLD) && sector_hdr_gc_flag == DEFAULT_GC_FLAG) {
             sector_iterator(&sector, SECTOR_STORE_UNUSED, NULL, NULL, write_hdr_gc, false);
             first_gc = 1;
@@ -1334,6 +1617,134 @@ static void gc_collect(void)
     gc_request = false;
 }
 
+/*
+ * Select the full dirty sector which has the least live ENV, it needs the least moves to collect.
+ * Only the sector header is read, the live size is the estimate.
+ */
+static bool gc_step_sector_cb(sector_meta_data_t sector, void *arg1, void *arg2)
+{
+    uint32_t *gc_sector = arg1;
+    size_t *min_live = arg2, live;
+
+    if (!sector->check_ok) {
+        return false;
+    }
+    /* the sector collecting before power lost is the first */
+    if (sector->status.dirty == SECTOR_DIRTY_GC) {
+        *gc_sector = sector->addr;
+        return true;
+    }
+    if (sector->status.store == SECTOR_STORE_FULL && sector->status.dirty == SECTOR_DIRTY_TRUE) {
+        live = get_sector_live(sector->addr);
+        if (live < *min_live) {
+            *min_live = live;
+            *gc_sector = sector->addr;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Do a bounded step of GC. It checks at most EF_GC_STEP_SCAN_MAX ENV of the collecting sector
+ * from where the last step stopped and moves at most budget live ENV out of it, or erases the
+ * sector when all ENV in it are checked. The dead ENV are skipped by header, only the live ENV
+ * are read whole. It only starts to collect when the empty sector number is not more than
+ * EF_GC_STEP_SEC_THRESHOLD, and picks the full dirty sector with the least live ENV bytes.
+ * Call it from idle hook or background task until it returns false. With EF_GC_INCREMENTAL,
+ * the ENV set only does GC itself when the empty sector is critical low.
+ *
+ * @param budget the max ENV move number of this step
+ *
+ * @return true: GC has done something and may have more work to do
+ */
+bool ef_env_gc_step(size_t budget)
+{
+    struct sector_meta_data sector;
+    struct env_node_obj env;
+    struct env_hdr_data env_hdr;
+    size_t empty_sec = 0, moved = 0, scanned = 0, min_live = SIZE_MAX;
+    bool busy = false;
+
+    if (!init_ok) {
+        return false;
+    }
+
+    /* lock the ENV cache */
+    ef_port_env_lock();
+
+    if (gc_step_sector != FAILED_ADDR) {
+        read_sector_meta_data(gc_step_sector, &sector, false);
+        /* it's collected by the GC of ENV set */
+        if (!sector.check_ok || sector.status.dirty != SECTOR_DIRTY_GC) {
+            gc_step_sector = FAILED_ADDR;
+        }
+    }
+
+    if (gc_step_sector == FAILED_ADDR) {
+        sector_iterator(&sector, SECTOR_STORE_EMPTY, &empty_sec, NULL, gc_check_cb, false);
+        if (empty_sec > EF_GC_STEP_SEC_THRESHOLD) {
+            goto __exit;
+        }
+        sector_iterator(&sector, SECTOR_STORE_UNUSED, &gc_step_sector, &min_live, gc_step_sector_cb, false);
+        if (gc_step_sector == FAILED_ADDR) {
+            goto __exit;
+        }
+        read_sector_meta_data(gc_step_sector, &sector, false);
+        /* the ENV alloc skips the GC status sector, and the recovery will finish it after power lost */
+        if (sector.gc_flag == DEFAULT_GC_FLAG) {
+            write_hdr_gc(&sector, NULL, NULL);
+        }
+        if (sector.status.dirty != SECTOR_DIRTY_GC) {
+            uint8_t status_table[DIRTY_STATUS_TABLE_SIZE];
+            write_status(sector.addr + SECTOR_DIRTY_OFFSET, status_table, SECTOR_DIRTY_STATUS_NUM, SECTOR_DIRTY_GC);
+        }
+        EF_DEBUG("GC step collects the sector @0x%08X\r\n", gc_step_sector);
+        gc_step_cursor = gc_step_sector + SECTOR_HDR_DATA_SIZE;
+    }
+    busy = true;
+
+    /* the sector is full, no ENV is added behind the cursor */
+    while (gc_step_cursor != FAILED_ADDR && scanned < EF_GC_STEP_SCAN_MAX && moved < budget) {
+        env.addr.start = find_next_env_addr(gc_step_cursor, gc_step_sector + SECTOR_SIZE - SECTOR_HDR_DATA_SIZE);
+        if (env.addr.start == FAILED_ADDR) {
+            gc_step_cursor = FAILED_ADDR;
+            break;
+        }
+        scanned++;
+        ef_port_read(env.addr.start, (uint32_t *)&env_hdr, sizeof(struct env_hdr_data));
+        /* the length of a deleted ENV was checked when it was written */
+        if (get_status(env_hdr.status_table, ENV_STATUS_NUM) == ENV_DELETED
+                && env_hdr.len >= ENV_NAME_LEN_OFFSET && env_hdr.len <= SECTOR_SIZE - SECTOR_HDR_DATA_SIZE) {
+            gc_step_cursor = env.addr.start + env_hdr.len;
+            continue;
+        }
+        read_env(&env);
+        if (env.crc_is_ok && (env.status == ENV_WRITE || env.status == ENV_PRE_DELETE)) {
+            if (move_env(&env) != EF_NO_ERR) {
+                EF_DEBUG("Error: Moved the ENV (%.*s) for GC step failed.\r\n", env.name_len, env.name);
+                break;
+            }
+            moved++;
+        }
+        gc_step_cursor = env.crc_is_ok ? env.addr.start + env.len : env.addr.start + EF_WG_ALIGN(1);
+    }
+
+    /* the erase is a step itself */
+    if (gc_step_cursor == FAILED_ADDR && moved == 0 && scanned == 0) {
+        format_sector(gc_step_sector, SECTOR_NOT_COMBINED);
+        EF_DEBUG("GC step collected the sector @0x%08X\r\n", gc_step_sector);
+        gc_step_sector = FAILED_ADDR;
+        sector_iterator(&sector, SECTOR_STORE_UNUSED, NULL, NULL, read_hdr_gc, false);
+    }
+
+__exit:
+    /* unlock the ENV cache */
+    ef_port_env_unlock();
+
+    return busy;
+}
+
 static EfErrCode align_write(uint32_t addr, const uint32_t *buf, size_t size)
 {
     EfErrCode result = EF_NO_ERR;
@@ -1360,6 +1771,30 @@ static EfErrCode align_write(uint32_t addr, const uint32_t *buf, size_t size)
     return result;
 }
 
+/*
+ * CRC32 of header.name_len + header.value_len + name + value, the align bytes are 0xFF
+ */
+static uint32_t calc_env_crc32(env_hdr_data_t env_hdr, const char *key, const void *value)
+{
+    uint8_t ff = 0xFF;
+    uint32_t crc32;
+    size_t align_remain;
+
+    crc32 = ef_calc_crc32(0, &env_hdr->name_len, ENV_HDR_DATA_SIZE - ENV_NAME_LEN_OFFSET);
+    crc32 = ef_calc_crc32(crc32, key, env_hdr->name_len);
+    align_remain = EF_WG_ALIGN(env_hdr->name_len) - env_hdr->name_len;
+    while (align_remain--) {
+        crc32 = ef_calc_crc32(crc32, &ff, 1);
+    }
+    crc32 = ef_calc_crc32(crc32, value, env_hdr->value_len);
+    align_remain = EF_WG_ALIGN(env_hdr->value_len) - env_hdr->value_len;
+    while (align_remain--) {
+        crc32 = ef_calc_crc32(crc32, &ff, 1);
+    }
+
+    return crc32;
+}
+
 static EfErrCode create_env_blob(sector_meta_data_t sector, const char *key, const void *value, size_t len)
 {
     EfErrCode result = EF_NO_ERR;
@@ -1384,25 +1819,12 @@ static EfErrCode create_env_blob(sector_meta_data_t sector, const char *key, con
     }
 
     if (env_addr != FAILED_ADDR || (env_addr = new_env(sector, env_hdr.len)) != FAILED_ADDR) {
-        size_t align_remain;
         /* update the sector status */
         if (result == EF_NO_ERR) {
             result = update_sec_status(sector, env_hdr.len, &is_full);
         }
         if (result == EF_NO_ERR) {
-            uint8_t ff = 0xFF;
-            /* start calculate CRC32 */
-            env_hdr.crc32 = ef_calc_crc32(0, &env_hdr.name_len, ENV_HDR_DATA_SIZE - ENV_NAME_LEN_OFFSET);
-            env_hdr.crc32 = ef_calc_crc32(env_hdr.crc32, key, env_hdr.name_len);
-            align_remain = EF_WG_ALIGN(env_hdr.name_len) - env_hdr.name_len;
-            while (align_remain--) {
-                env_hdr.crc32 = ef_calc_crc32(env_hdr.crc32, &ff, 1);
-            }
-            env_hdr.crc32 = ef_calc_crc32(env_hdr.crc32, value, env_hdr.value_len);
-            align_remain = EF_WG_ALIGN(env_hdr.value_len) - env_hdr.value_len;
-            while (align_remain--) {
-                env_hdr.crc32 = ef_calc_crc32(env_hdr.crc32, &ff, 1);
-            }
+            env_hdr.crc32 = calc_env_crc32(&env_hdr, key, value);
             /* write ENV header data */
             result = write_env_hdr(env_addr, &env_hdr);
 
@@ -1418,6 +1840,9 @@ static EfErrCode create_env_blob(sector_meta_data_t sector, const char *key, con
             }
             update_env_cache(key, env_hdr.name_len, env_addr);
 #endif /* EF_ENV_USING_CACHE */
+#ifdef EF_ENV_USING_INDEX
+            update_env_index(key, env_hdr.name_len, env_addr);
+#endif /* EF_ENV_USING_INDEX */
         }
         /* write value */
         if (result == EF_NO_ERR) {
@@ -1461,6 +1886,11 @@ EfErrCode ef_del_env(const char *key)
         return EF_NO_ERR;
     }
 
+    if (key_is_reserved(key)) {
+        log_warn("key %s is reserved\r\n", key);
+        return EF_ENV_ARG_ERR;
+    }
+
     /* lock the ENV cache */
     ef_port_env_lock();
 
@@ -1559,6 +1989,11 @@ EfErrCode ef_set_env_blob(const char *key, const void *value_buf, size_t buf_len
         return EF_ENV_ARG_ERR;
     }
 
+    if (key_is_reserved(key)) {
+        log_warn("key %s is reserved\r\n", key);
+        return EF_ENV_ARG_ERR;
+    }
+
     /* lock the ENV cache */
     ef_port_env_lock();
 
@@ -1600,6 +2035,361 @@ EfErrCode ef_set_and_save_env(const char *key, const char *value)
     return ef_set_env_blob(key, value, strlen(value));
 }
 
+/*
+ * Write the staged ENV with ENV_PRE_WRITE status, it's invisible until the status is changed to ENV_WRITE.
+ */
+static EfErrCode write_txn_env(uint32_t env_addr, const char *key, size_t key_len, const void *value, size_t len)
+{
+    EfErrCode result = EF_NO_ERR;
+    struct env_hdr_data env_hdr;
+
+    memset(&env_hdr, 0xFF, sizeof(struct env_hdr_data));
+    env_hdr.magic = ENV_MAGIC_WORD;
+    env_hdr.name_len = key_len;
+    env_hdr.value_len = len;
+    env_hdr.len = ENV_HDR_DATA_SIZE + EF_WG_ALIGN(env_hdr.name_len) + EF_WG_ALIGN(env_hdr.value_len);
+    env_hdr.crc32 = calc_env_crc32(&env_hdr, key, value);
+
+    result = write_env_hdr(env_addr, &env_hdr);
+    if (result == EF_NO_ERR) {
+        result = align_write(env_addr + ENV_HDR_DATA_SIZE, (uint32_t *) key, env_hdr.name_len);
+    }
+    if (result == EF_NO_ERR) {
+        result = align_write(env_addr + ENV_HDR_DATA_SIZE + EF_WG_ALIGN(env_hdr.name_len), value, env_hdr.value_len);
+    }
+
+    return result;
+}
+
+static bool txn_addr_is_valid(uint32_t addr)
+{
+    return addr == FAILED_ADDR || (addr >= env_start_addr && addr < env_start_addr + ENV_AREA_SIZE);
+}
+
+/*
+ * Check the commit record before it is applied, every item must point into the ENV area.
+ */
+static bool txn_is_valid(env_node_obj_t txn_env)
+{
+    struct txn_commit_item item;
+    size_t i;
+
+    if (txn_env->value_len == 0 || txn_env->value_len % sizeof(struct txn_commit_item) != 0) {
+        return false;
+    }
+
+    for (i = 0; i < txn_env->value_len / sizeof(struct txn_commit_item); i++) {
+        ef_port_read(txn_env->addr.value + i * sizeof(struct txn_commit_item), (uint32_t *) &item, sizeof(item));
+        if (!txn_addr_is_valid(item.new_addr) || !txn_addr_is_valid(item.old_addr)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Apply the committed transaction: delete the old ENV, make the new ENV visible, then drop the commit record.
+ * Every step is checked by the flash status, so it can be redone after power loss.
+ */
+static void apply_txn(env_node_obj_t txn_env)
+{
+    struct txn_commit_item item;
+    struct env_node_obj env;
+    uint8_t status_table[ENV_STATUS_TABLE_SIZE];
+    size_t i;
+
+    if (!txn_is_valid(txn_env)) {
+        EF_INFO("Error: The ENV transaction commit record is invalid, it is not applied.\r\n");
+        return;
+    }
+
+    for (i = 0; i < txn_env->value_len / sizeof(struct txn_commit_item); i++) {
+        ef_port_read(txn_env->addr.value + i * sizeof(struct txn_commit_item), (uint32_t *) &item, sizeof(item));
+        if (item.old_addr != FAILED_ADDR) {
+            env.addr.start = item.old_addr;
+            read_env(&env);
+            if (env.crc_is_ok && (env.status == ENV_WRITE || env.status == ENV_PRE_DELETE)) {
+                del_env(NULL, &env, true);
+            }
+        }
+        if (item.new_addr != FAILED_ADDR) {
+            env.addr.start = item.new_addr;
+            read_env(&env);
+            if (!env.crc_is_ok) {
+                continue;
+            }
+            if (env.status == ENV_PRE_WRITE) {
+                write_status(item.new_addr, status_table, ENV_STATUS_NUM, ENV_WRITE);
+            }
+#ifdef EF_ENV_USING_CACHE
+            update_env_cache(env.name, env.name_len, item.new_addr);
+#endif /* EF_ENV_USING_CACHE */
+#ifdef EF_ENV_USING_INDEX
+            update_env_index(env.name, env.name_len, item.new_addr);
+#endif /* EF_ENV_USING_INDEX */
+        }
+    }
+
+    del_env(NULL, txn_env, true);
+}
+
+/**
+ * Begin an ENV transaction. The ENV set in transaction are staged in the buffer,
+ * nothing is written to flash until ef_txn_commit.
+ *
+ * @param txn transaction object
+ * @param buf staging buffer, 4 bytes aligned. It holds the name and value of all staged ENV
+ *            and 8 bytes for each ENV when commit.
+ * @param size staging buffer size
+ *
+ * @return result
+ */
+EfErrCode ef_txn_begin(ef_txn_t txn, void *buf, size_t size)
+{
+    EF_ASSERT(txn);
+
+    if (!buf || ((uintptr_t)buf & 0x3)) {
+        log_warn("buf = %p\r\n", buf);
+        return EF_ENV_ARG_ERR;
+    }
+
+    txn->buf = buf;
+    txn->size = size;
+    txn->used = 0;
+    txn->count = 0;
+
+    return EF_NO_ERR;
+}
+
+/**
+ * Stage a blob ENV in transaction. If it value is NULL, delete it when commit.
+ * The later staged value of the same ENV overrides the earlier one.
+ *
+ * @param txn transaction object
+ * @param key ENV name
+ * @param value_buf ENV value
+ * @param buf_len ENV value length
+ *
+ * @return result, EF_ENV_FULL: the staging buffer is full
+ */
+EfErrCode ef_txn_set_env_blob(ef_txn_t txn, const char *key, const void *value_buf, size_t buf_len)
+{
+    txn_node_data_t node;
+    size_t key_len, node_size, offset;
+
+    EF_ASSERT(txn);
+
+    if (!key || (key_len = strlen(key)) == 0 || key_len > EF_ENV_NAME_MAX) {
+        log_warn("key = %p\r\n", key);
+        return EF_ENV_ARG_ERR;
+    }
+
+    if (key_is_reserved(key)) {
+        log_warn("key %s is reserved\r\n", key);
+        return EF_ENV_ARG_ERR;
+    }
+
+    if (value_buf == NULL) {
+        buf_len = 0;
+    } else if (buf_len > EF_STR_ENV_VALUE_MAX_SIZE) {
+        log_warn("buf_len err. %d > %d\r\n", buf_len, EF_STR_ENV_VALUE_MAX_SIZE);
+        return EF_ENV_ARG_ERR;
+    }
+
+    node_size = TXN_NODE_SIZE(key_len, buf_len);
+    /* the commit items will be placed behind the staged ENV */
+    if (txn->used + node_size + (txn->count + 1) * sizeof(struct txn_commit_item) > txn->size) {
+        return EF_ENV_FULL;
+    }
+
+    for (offset = 0; offset < txn->used; offset += TXN_NODE_SIZE(node->name_len, node->value_len)) {
+        node = (txn_node_data_t)(txn->buf + offset);
+        if (node->flag != TXN_NODE_SKIP && node->name_len == key_len && !strncmp((char *)(node + 1), key, key_len)) {
+            node->flag = TXN_NODE_SKIP;
+            txn->count--;
+        }
+    }
+
+    node = (txn_node_data_t)(txn->buf + txn->used);
+    node->name_len = key_len;
+    node->flag = value_buf ? TXN_NODE_SET : TXN_NODE_DEL;
+    node->reserved = 0;
+    node->value_len = buf_len;
+    memcpy(node + 1, key, key_len);
+    if (buf_len) {
+        memcpy((uint8_t *)(node + 1) + EF_ALIGN(key_len, 4), value_buf, buf_len);
+    }
+    txn->used += node_size;
+    txn->count++;
+
+    return EF_NO_ERR;
+}
+
+/**
+ * Stage a string ENV in transaction. If it value is NULL, delete it when commit.
+ *
+ * @param txn transaction object
+ * @param key ENV name
+ * @param value ENV value
+ *
+ * @return result
+ */
+EfErrCode ef_txn_set_env(ef_txn_t txn, const char *key, const char *value)
+{
+    return ef_txn_set_env_blob(txn, key, value, value ? strlen(value) : 0);
+}
+
+/**
+ * Stage an ENV delete in transaction.
+ *
+ * @param txn transaction object
+ * @param key ENV name
+ *
+ * @return result
+ */
+EfErrCode ef_txn_del_env(ef_txn_t txn, const char *key)
+{
+    return ef_txn_set_env_blob(txn, key, NULL, 0);
+}
+
+/**
+ * Drop all staged ENV, the transaction can be used again.
+ *
+ * @param txn transaction object
+ */
+void ef_txn_abort(ef_txn_t txn)
+{
+    EF_ASSERT(txn);
+
+    txn->used = 0;
+    txn->count = 0;
+}
+
+/**
+ * Commit the transaction. All staged ENV and a commit record are written to one sector
+ * without GC between them. The new ENV become visible together after the commit record
+ * is written. When power lost before that, the whole transaction is discarded by ef_load_env,
+ * and after that, it is applied by ef_load_env.
+ *
+ * @param txn transaction object
+ *
+ * @return result, EF_ENV_FULL: the transaction is larger than a sector or no space
+ */
+EfErrCode ef_txn_commit(ef_txn_t txn)
+{
+    EfErrCode result = EF_NO_ERR;
+    struct sector_meta_data sector;
+    struct env_node_obj env;
+    struct txn_commit_item *items;
+    txn_node_data_t node;
+    size_t offset, i, total;
+    uint32_t env_addr, txn_addr;
+    bool is_full = false;
+    char name[EF_ENV_NAME_MAX + 1];
+
+    EF_ASSERT(txn);
+
+    if (!init_ok) {
+        EF_INFO("ENV isn't initialize OK.\r\n");
+        return EF_ENV_INIT_FAILED;
+    }
+
+    if (txn->count == 0) {
+        return EF_NO_ERR;
+    }
+
+    /* the size of all new ENV and commit record */
+    total = ENV_HDR_DATA_SIZE + EF_WG_ALIGN(strlen(TXN_ENV_NAME))
+            + EF_WG_ALIGN(txn->count * sizeof(struct txn_commit_item));
+    for (offset = 0; offset < txn->used; offset += TXN_NODE_SIZE(node->name_len, node->value_len)) {
+        node = (txn_node_data_t)(txn->buf + offset);
+        if (node->flag == TXN_NODE_SET) {
+            total += ENV_HDR_DATA_SIZE + EF_WG_ALIGN(node->name_len) + EF_WG_ALIGN(node->value_len);
+        }
+    }
+    if (total >= SECTOR_SIZE - SECTOR_HDR_DATA_SIZE) {
+        EF_INFO("Error: The ENV transaction size (%d) is too big\r\n", total);
+        return EF_ENV_FULL;
+    }
+
+    /* lock the ENV cache */
+    ef_port_env_lock();
+
+    /* GC only happens here, before any ENV is written */
+    if ((env_addr = new_env(&sector, total)) == FAILED_ADDR) {
+        result = EF_ENV_FULL;
+        goto __exit;
+    }
+    result = update_sec_status(&sector, total, &is_full);
+
+    /* write all new ENV in ENV_PRE_WRITE status */
+    items = (struct txn_commit_item *)(txn->buf + txn->used);
+    for (offset = 0, i = 0; offset < txn->used && result == EF_NO_ERR;
+            offset += TXN_NODE_SIZE(node->name_len, node->value_len)) {
+        node = (txn_node_data_t)(txn->buf + offset);
+        if (node->flag == TXN_NODE_SKIP) {
+            continue;
+        }
+        memcpy(name, node + 1, node->name_len);
+        name[node->name_len] = '\0';
+        items[i].old_addr = find_env(name, &env) ? env.addr.start : FAILED_ADDR;
+        items[i].new_addr = FAILED_ADDR;
+        if (node->flag == TXN_NODE_SET) {
+            result = write_txn_env(env_addr, name, node->name_len,
+                    (uint8_t *)(node + 1) + EF_ALIGN(node->name_len, 4), node->value_len);
+            items[i].new_addr = env_addr;
+            env_addr += ENV_HDR_DATA_SIZE + EF_WG_ALIGN(node->name_len) + EF_WG_ALIGN(node->value_len);
+        }
+        i++;
+    }
+
+    /* the transaction is committed when the commit record status is ENV_WRITE */
+    txn_addr = env_addr;
+    if (result == EF_NO_ERR) {
+        result = write_txn_env(txn_addr, TXN_ENV_NAME, strlen(TXN_ENV_NAME), items, i * sizeof(struct txn_commit_item));
+        env_addr += ENV_HDR_DATA_SIZE + EF_WG_ALIGN(strlen(TXN_ENV_NAME))
+                + EF_WG_ALIGN(i * sizeof(struct txn_commit_item));
+    }
+    if (result == EF_NO_ERR) {
+        uint8_t status_table[ENV_STATUS_TABLE_SIZE];
+
+        result = write_status(txn_addr, status_table, ENV_STATUS_NUM, ENV_WRITE);
+    }
+
+#ifdef EF_ENV_USING_CACHE
+    if (!is_full) {
+        update_sector_cache(sector.addr, env_addr);
+    }
+#endif /* EF_ENV_USING_CACHE */
+
+    if (result == EF_NO_ERR) {
+        env.addr.start = txn_addr;
+        read_env(&env);
+        apply_txn(&env);
+    }
+
+    /* trigger GC collect when current sector is full */
+    if (result == EF_NO_ERR && is_full) {
+        EF_DEBUG("Trigger a GC check after committed ENV transaction.\r\n");
+        gc_request = true;
+    }
+    sector_iterator(&sector, SECTOR_STORE_UNUSED, NULL, NULL, read_hdr_gc, false);
+    /* process the GC after commit */
+    if (gc_request || (sector_hdr_gc_flag != DEFAULT_GC_FLAG)) {
+        gc_collect();
+    }
+
+__exit:
+    /* unlock the ENV cache */
+    ef_port_env_unlock();
+
+    txn->used = 0;
+    txn->count = 0;
+
+    return result;
+}
+
 /**
  * Save ENV to flash.
  *
@@ -1627,6 +2417,10 @@ EfErrCode ef_env_set_default(void)
 
     /* lock the ENV cache */
     ef_port_env_lock();
+#ifdef EF_ENV_USING_INDEX
+    /* all ENV will be dropped */
+    reset_env_index();
+#endif /* EF_ENV_USING_INDEX */
     /* format all sectors */
     for (addr = env_start_addr; addr < env_start_addr + ENV_AREA_SIZE; addr += SECTOR_SIZE) {
         result = format_sector(addr, SECTOR_NOT_COMBINED);
@@ -1636,6 +2430,9 @@ EfErrCode ef_env_set_default(void)
     }
     /* create default ENV */
     for (i = 0; i < default_env_set_size; i++) {
+        if (key_is_reserved(default_env_set[i].key)) {
+            continue;
+        }
         /* It seems to be a string when value length is 0.
          * This mechanism is for compatibility with older versions (less then V4.0). */
         if (default_env_set[i].value_len == 0) {
@@ -1665,8 +2462,8 @@ static bool print_env_cb(env_node_obj_t env, void *arg1, void *arg2)
     if (env->crc_is_ok) {
         /* calculate the total using flash size */
         *using_size += env->len;
-        /* check ENV */
-        if (env->status == ENV_WRITE) {
+        /* check ENV, the transaction commit record is not an user ENV */
+        if (env->status == ENV_WRITE && !env_is_txn(env)) {
             ef_print("%.*s=", env->name_len, env->name);
 
             if (env->value_len < EF_STR_ENV_VALUE_MAX_SIZE ) {
@@ -1731,6 +2528,15 @@ void ef_print_env(void)
     ef_port_env_unlock();
 }
 
+static bool print_env_user_cb(env_node_obj_t env, void *arg1, void *arg2)
+{
+    if (env_is_txn(env)) {
+        return false;
+    }
+
+    return (*(print_env_cb_t *)arg2)(env, arg1, NULL);
+}
+
 /* Added by bouffalo  */
 void ef_print_env_cb(print_env_cb_t cb)
 {
@@ -1745,7 +2551,7 @@ void ef_print_env_cb(print_env_cb_t cb)
     /* lock the ENV cache */
     ef_port_env_lock();
 
-    env_iterator(&env, &using_size, NULL, cb);
+    env_iterator(&env, &using_size, &cb, print_env_user_cb);
 
     ef_print("\r\nmode: next generation\r\n");
     ef_print("size: %lu/%lu bytes.\r\n", using_size + (SECTOR_NUM - EF_GC_EMPTY_SEC_THRESHOLD) * SECTOR_HDR_DATA_SIZE,
@@ -1772,7 +2578,7 @@ static void env_auto_update(void)
             EF_DEBUG("Update the ENV from version %d to %d.\r\n", saved_ver_num, setting_ver_num);
             for (i = 0; i < default_env_set_size; i++) {
                 /* add a new ENV when it's not found */
-                if (!find_env(default_env_set[i].key, &env)) {
+                if (!key_is_reserved(default_env_set[i].key) && !find_env(default_env_set[i].key, &env)) {
                     /* It seems to be a string when value length is 0.
                      * This mechanism is for compatibility with older versions (less then V4.0). */
                     if (default_env_set[i].value_len == 0) {
@@ -1842,6 +2648,38 @@ static bool check_and_recovery_env_cb(env_node_obj_t env, void *arg1, void *arg2
     return false;
 }
 
+static bool check_and_recovery_txn_cb(env_node_obj_t env, void *arg1, void *arg2)
+{
+    /* the transaction is committed, but not applied completely */
+    if (env->crc_is_ok && env->status == ENV_WRITE && env_is_txn(env)) {
+        EF_INFO("Found a committed ENV transaction. Now will apply it.\r\n");
+        apply_txn(env);
+    }
+
+    return false;
+}
+
+static bool check_and_discard_txn_cb(env_node_obj_t env, void *arg1, void *arg2)
+{
+    /* the ENV of an uncommitted transaction, or not write finish */
+    if (env->status == ENV_PRE_WRITE) {
+        uint8_t status_table[ENV_STATUS_TABLE_SIZE];
+
+        write_status(env->addr.start, status_table, ENV_STATUS_NUM, ENV_ERR_HDR);
+    }
+
+    return false;
+}
+
+static bool load_sector_live_cb(env_node_obj_t env, void *arg1, void *arg2)
+{
+    if (env->crc_is_ok && (env->status == ENV_WRITE || env->status == ENV_PRE_DELETE)) {
+        update_sector_live(env->addr.start, env->len, true);
+    }
+
+    return false;
+}
+
 /**
  * Check and load the flash ENV meta data.
  *
@@ -1865,6 +2703,9 @@ EfErrCode ef_load_env(void)
 
     /* lock the ENV cache */
     ef_port_env_lock();
+    /* apply the committed transaction, then discard the uncommitted ones */
+    env_iterator(&env, NULL, NULL, check_and_recovery_txn_cb);
+    env_iterator(&env, NULL, NULL, check_and_discard_txn_cb);
     /* check all sector header for recovery GC */
     sector_iterator(&sector, SECTOR_STORE_UNUSED, NULL, NULL, check_and_recovery_gc_cb, false);
 
@@ -1878,6 +2719,15 @@ __retry:
 
     in_recovery_check = false;
 
+    /* count the live ENV of every sector for ef_env_gc_step */
+    memset(sector_live_size, 0, sizeof(sector_live_size));
+    env_iterator(&env, NULL, NULL, load_sector_live_cb);
+
+#ifdef EF_ENV_USING_INDEX
+    /* build the index after recovery, the flash will not change any more */
+    load_env_index();
+#endif /* EF_ENV_USING_INDEX */
+
     /* unlock the ENV cache */
     ef_port_env_unlock();
 
@@ -3,6 +3,29 @@
 
 #include "lfs.h"
 
+/* same prototype as bflb_flash_erase/write/read */
+typedef int (*lfs_xip_flash_erase_t)(uint32_t addr, uint32_t len);
+typedef int (*lfs_xip_flash_write_t)(uint32_t addr, uint8_t *data, uint32_t len);
+typedef int (*lfs_xip_flash_read_t)(uint32_t addr, uint8_t *data, uint32_t len);
+
+extern void lfs_xip_flash_set_operation(lfs_xip_flash_erase_t erase, lfs_xip_flash_write_t write,
+                                        lfs_xip_flash_read_t read);
+
+#ifdef CONFIG_LITTLEFS_CACHE_SIZE
+typedef struct {
+    uint32_t read_hit;    /*!< line reads served from RAM */
+    uint32_t read_miss;   /*!< line reads loaded from flash */
+    uint32_t readahead;   /*!< lines loaded ahead of a sequential read */
+    uint32_t read_bypass; /*!< large reads sent to flash directly */
+    uint32_t prog_call;   /*!< programs from littlefs */
+    uint32_t prog_flush;  /*!< programs sent to flash after coalescing */
+    uint32_t erase;       /*!< block erases */
+} lfs_xip_flash_cache_stat_t;
+
+extern void lfs_xip_flash_cache_stat(lfs_xip_flash_cache_stat_t *stat);
+extern void lfs_xip_flash_cache_reset(void);
+#endif
+
 extern int lfs_xip_flash_read(const struct lfs_config *c, lfs_block_t block,
                               lfs_off_t off, void *buffer, lfs_size_t size);
 extern int lfs_xip_flash_prog(const struct lfs_config *c, lfs_block_t block,
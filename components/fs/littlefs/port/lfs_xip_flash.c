@@ -1,11 +1,287 @@
 #include "lfs.h"
 #include "bflb_flash.h"
 #include "bflb_l1c.h"
+#include "lfs_port.h"
 
 #ifndef CONFIG_LITTLEFS_FLASH_ADDRESS
 #error "must define CONFIG_LITTLEFS_FLASH_ADDRESS"
 #endif
 
+#ifdef CONFIG_LITTLEFS_CACHE_SIZE
+
+#ifndef CONFIG_LITTLEFS_CACHE_LINE
+#define CONFIG_LITTLEFS_CACHE_LINE 256
+#endif
+
+#ifndef CONFIG_LITTLEFS_CACHE_READAHEAD
+#define CONFIG_LITTLEFS_CACHE_READAHEAD 4
+#endif
+
+#define CACHE_LINE_NUM (CONFIG_LITTLEFS_CACHE_SIZE / CONFIG_LITTLEFS_CACHE_LINE)
+#define CACHE_LINE_MASK (~(uint32_t)(CONFIG_LITTLEFS_CACHE_LINE - 1))
+
+#if (CONFIG_LITTLEFS_CACHE_LINE & (CONFIG_LITTLEFS_CACHE_LINE - 1)) || (CACHE_LINE_NUM < 2)
+#error "CONFIG_LITTLEFS_CACHE_LINE must be a power of 2 and CONFIG_LITTLEFS_CACHE_SIZE hold 2 lines at least"
+#endif
+
+struct xip_flash_cache_line {
+    uint32_t addr; /*!< flash address of the line */
+    uint32_t used; /*!< lru tick of the last access */
+    uint8_t valid;
+};
+
+static struct xip_flash_cache_line cache_line[CACHE_LINE_NUM];
+static uint8_t cache_data[CACHE_LINE_NUM][CONFIG_LITTLEFS_CACHE_LINE] __attribute__((aligned(4)));
+static uint32_t cache_tick;
+/* end of the last missed read, a miss starting here is sequential */
+static uint32_t cache_next_addr = 0xFFFFFFFF;
+
+/* programs are gathered here until they leave the line, a read hits them, or littlefs syncs */
+static uint8_t prog_data[CONFIG_LITTLEFS_CACHE_LINE] __attribute__((aligned(4)));
+static uint32_t prog_addr;
+static uint32_t prog_len;
+
+static lfs_xip_flash_cache_stat_t cache_stat;
+#endif
+
+static lfs_xip_flash_erase_t xip_flash_erase = bflb_flash_erase;
+static lfs_xip_flash_write_t xip_flash_write = bflb_flash_write;
+static lfs_xip_flash_read_t xip_flash_read = bflb_flash_read;
+
+#ifdef CONFIG_LITTLEFS_CACHE_SIZE
+static int cache_prog_flush(void)
+{
+    int ret = 0;
+
+    if (prog_len) {
+        ret = xip_flash_write(prog_addr, prog_data, prog_len);
+        prog_len = 0;
+        cache_stat.prog_flush++;
+    }
+    return ret;
+}
+
+static int cache_find(uint32_t addr)
+{
+    for (int i = 0; i < CACHE_LINE_NUM; i++) {
+        if (cache_line[i].valid && (cache_line[i].addr == addr)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int cache_victim(void)
+{
+    int victim = 0;
+
+    for (int i = 0; i < CACHE_LINE_NUM; i++) {
+        if (!cache_line[i].valid) {
+            return i;
+        }
+        if ((int32_t)(cache_line[i].used - cache_line[victim].used) < 0) {
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+/* load the line at addr, and the following lines up to end if the access is sequential */
+static int cache_fill(uint32_t addr, uint32_t end)
+{
+    int first = -1, idx, ret;
+    uint32_t count = 1;
+
+    /* never evict the requested line while reading ahead */
+    if (addr == cache_next_addr) {
+        count = CONFIG_LITTLEFS_CACHE_READAHEAD < CACHE_LINE_NUM / 2 ? CONFIG_LITTLEFS_CACHE_READAHEAD : CACHE_LINE_NUM / 2;
+    }
+    cache_next_addr = addr + CONFIG_LITTLEFS_CACHE_LINE;
+
+    for (uint32_t i = 0; (i < count) && (addr < end); i++, addr += CONFIG_LITTLEFS_CACHE_LINE) {
+        if ((i > 0) && (cache_find(addr) >= 0)) {
+            break;
+        }
+        idx = cache_victim();
+        ret = xip_flash_read(addr, cache_data[idx], CONFIG_LITTLEFS_CACHE_LINE);
+        if (ret < 0) {
+            cache_line[idx].valid = 0;
+            return ret;
+        }
+        /* the line may hold programs not on flash yet */
+        if (prog_len && ((prog_addr & CACHE_LINE_MASK) == addr)) {
+            for (uint32_t j = 0; j < prog_len; j++) {
+                cache_data[idx][(prog_addr - addr) + j] &= prog_data[j];
+            }
+        }
+        cache_line[idx].addr = addr;
+        cache_line[idx].valid = 1;
+        /* read ahead lines are older than the requested one */
+        cache_line[idx].used = cache_tick - (i ? 1 : 0);
+        if (i == 0) {
+            first = idx;
+        } else {
+            cache_stat.readahead++;
+            cache_next_addr = addr + CONFIG_LITTLEFS_CACHE_LINE;
+        }
+    }
+    return first;
+}
+
+static int cache_read(uint32_t addr, uint8_t *buf, uint32_t size, uint32_t end)
+{
+    uint32_t line, off, n;
+    int idx, ret;
+
+    /* large reads would only evict the metadata */
+    if (size >= CONFIG_LITTLEFS_CACHE_SIZE / 2) {
+        /* pending programs are not on flash yet */
+        if (prog_len && (addr < prog_addr + prog_len) && (prog_addr < addr + size)) {
+            ret = cache_prog_flush();
+            if (ret < 0) {
+                return ret;
+            }
+        }
+        cache_stat.read_bypass++;
+        return xip_flash_read(addr, buf, size);
+    }
+
+    /* lines hold the pending programs, so the read back of littlefs does not break coalescing */
+    while (size > 0) {
+        line = addr & CACHE_LINE_MASK;
+        off = addr - line;
+        n = CONFIG_LITTLEFS_CACHE_LINE - off;
+        if (n > size) {
+            n = size;
+        }
+
+        cache_tick++;
+        idx = cache_find(line);
+        if (idx < 0) {
+            cache_stat.read_miss++;
+            idx = cache_fill(line, end);
+            if (idx < 0) {
+                return idx;
+            }
+        } else {
+            cache_stat.read_hit++;
+        }
+        cache_line[idx].used = cache_tick;
+        memcpy(buf, &cache_data[idx][off], n);
+
+        addr += n;
+        buf += n;
+        size -= n;
+    }
+    return 0;
+}
+
+static int cache_prog(uint32_t addr, const uint8_t *buf, uint32_t size)
+{
+    uint32_t line, off, n;
+    int idx, ret;
+
+    cache_stat.prog_call++;
+    while (size > 0) {
+        line = addr & CACHE_LINE_MASK;
+        off = addr - line;
+        n = CONFIG_LITTLEFS_CACHE_LINE - off;
+        if (n > size) {
+            n = size;
+        }
+
+        /* NOR programming only clears bits, keep the cached line equal to flash */
+        idx = cache_find(line);
+        if (idx >= 0) {
+            for (uint32_t i = 0; i < n; i++) {
+                cache_data[idx][off + i] &= buf[i];
+            }
+        }
+
+        if (!prog_len || (addr != prog_addr + prog_len) || ((prog_addr & CACHE_LINE_MASK) != line)) {
+            ret = cache_prog_flush();
+            if (ret < 0) {
+                return ret;
+            }
+            prog_addr = addr;
+        }
+        memcpy(&prog_data[prog_len], buf, n);
+        prog_len += n;
+
+        addr += n;
+        buf += n;
+        size -= n;
+    }
+    return 0;
+}
+
+static int cache_erase(uint32_t addr, uint32_t size)
+{
+    int ret;
+
+    ret = cache_prog_flush();
+    if (ret < 0) {
+        return ret;
+    }
+
+    cache_stat.erase++;
+    ret = xip_flash_erase(addr, size);
+
+    /* erased lines stay cached, littlefs reads them back before programming */
+    for (int i = 0; i < CACHE_LINE_NUM; i++) {
+        if (cache_line[i].valid && (cache_line[i].addr >= addr) && (cache_line[i].addr < addr + size)) {
+            if (ret < 0) {
+                cache_line[i].valid = 0;
+            } else {
+                memset(cache_data[i], 0xff, CONFIG_LITTLEFS_CACHE_LINE);
+            }
+        }
+    }
+    return ret;
+}
+
+/*****************************************************************************
+* @brief        Get the cache counters.
+* @param[out]   stat
+*****************************************************************************/
+void lfs_xip_flash_cache_stat(lfs_xip_flash_cache_stat_t *stat)
+{
+    *stat = cache_stat;
+}
+
+/*****************************************************************************
+* @brief        Write back pending programs, drop all cached lines and clear
+*               the counters. Call it when the flash is changed without the
+*               block device, e.g. by OTA or a mass erase.
+*****************************************************************************/
+void lfs_xip_flash_cache_reset(void)
+{
+    cache_prog_flush();
+    for (int i = 0; i < CACHE_LINE_NUM; i++) {
+        cache_line[i].valid = 0;
+    }
+    cache_next_addr = 0xFFFFFFFF;
+    memset(&cache_stat, 0, sizeof(cache_stat));
+}
+#endif
+
+/*****************************************************************************
+* @brief        Replace the flash driver under the block device, e.g. with
+*               the flash simulator. NULL restores bflb_flash_xxx.
+* @param[in]    erase       
+* @param[in]    write       
+* @param[in]    read        
+*****************************************************************************/
+void lfs_xip_flash_set_operation(lfs_xip_flash_erase_t erase, lfs_xip_flash_write_t write, lfs_xip_flash_read_t read)
+{
+#ifdef CONFIG_LITTLEFS_CACHE_SIZE
+    lfs_xip_flash_cache_reset();
+#endif
+    xip_flash_erase = erase ? erase : bflb_flash_erase;
+    xip_flash_write = write ? write : bflb_flash_write;
+    xip_flash_read = read ? read : bflb_flash_read;
+}
+
 /*****************************************************************************
 * @brief        Read a region in a block. Negative error codes are propagated
 *               to the user.
@@ -20,8 +296,14 @@
 int lfs_xip_flash_read(const struct lfs_config *c, lfs_block_t block,
                        lfs_off_t off, void *buffer, lfs_size_t size)
 {
-    return bflb_flash_read(CONFIG_LITTLEFS_FLASH_ADDRESS + block * c->block_size + off,
-                           (uint8_t *)buffer, size);
+#ifdef CONFIG_LITTLEFS_CACHE_SIZE
+    return cache_read(CONFIG_LITTLEFS_FLASH_ADDRESS + block * c->block_size + off,
+                      (uint8_t *)buffer, size,
+                      CONFIG_LITTLEFS_FLASH_ADDRESS + (block + 1) * c->block_size);
+#else
+    return xip_flash_read(CONFIG_LITTLEFS_FLASH_ADDRESS + block * c->block_size + off,
+                          (uint8_t *)buffer, size);
+#endif
 }
 
 /*****************************************************************************
@@ -39,8 +321,13 @@ int lfs_xip_flash_read(const struct lfs_config *c, lfs_block_t block,
 int lfs_xip_flash_prog(const struct lfs_config *c, lfs_block_t block,
                        lfs_off_t off, const void *buffer, lfs_size_t size)
 {
-    return bflb_flash_write(CONFIG_LITTLEFS_FLASH_ADDRESS + block * c->block_size + off,
-                            (uint8_t *)buffer, size);
+#ifdef CONFIG_LITTLEFS_CACHE_SIZE
+    return cache_prog(CONFIG_LITTLEFS_FLASH_ADDRESS + block * c->block_size + off,
+                      (const uint8_t *)buffer, size);
+#else
+    return xip_flash_write(CONFIG_LITTLEFS_FLASH_ADDRESS + block * c->block_size + off,
+                           (uint8_t *)buffer, size);
+#endif
 }
 
 /*****************************************************************************
@@ -55,7 +342,11 @@ int lfs_xip_flash_prog(const struct lfs_config *c, lfs_block_t block,
 *****************************************************************************/
 int lfs_xip_flash_erase(const struct lfs_config *c, lfs_block_t block)
 {
-    return bflb_flash_erase(CONFIG_LITTLEFS_FLASH_ADDRESS + block * c->block_size, c->block_size);
+#ifdef CONFIG_LITTLEFS_CACHE_SIZE
+    return cache_erase(CONFIG_LITTLEFS_FLASH_ADDRESS + block * c->block_size, c->block_size);
+#else
+    return xip_flash_erase(CONFIG_LITTLEFS_FLASH_ADDRESS + block * c->block_size, c->block_size);
+#endif
 }
 
 /*****************************************************************************
@@ -67,6 +358,11 @@ int lfs_xip_flash_erase(const struct lfs_config *c, lfs_block_t block)
 *****************************************************************************/
 int lfs_xip_flash_sync(const struct lfs_config *c)
 {
+#ifdef CONFIG_LITTLEFS_CACHE_SIZE
+    /*!< littlefs expects everything programmed before sync on flash */
+    return cache_prog_flush();
+#else
     /*!< if use xip, may need to clean cache */
     return 0;
-}
\ No newline at end of file
+#endif
+}
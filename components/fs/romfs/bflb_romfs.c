@@ -31,6 +31,81 @@ static uint32_t dirent_size(void *addr);
 
 static char *romfs_root = NULL; /* The mount point of the physical addr */
 
+#ifndef ROMFS_INDEX_SIZE
+#define ROMFS_INDEX_SIZE 0
+#endif
+
+#if ROMFS_INDEX_SIZE
+#if (ROMFS_INDEX_SIZE & (ROMFS_INDEX_SIZE - 1)) || (ROMFS_INDEX_SIZE > 0x8000)
+#error "ROMFS_INDEX_SIZE must be a power of 2 and not larger than 0x8000"
+#endif
+
+#define ROMFS_INDEX_ROOT   0xFFFF
+#define ROMFS_HASH_INIT    0x811C9DC5
+#define ROMFS_HASH_PRIME   0x01000193
+
+/* path hash index, built at mount. slots never move, the parent slot is used to check the full path */
+struct romfs_index_node {
+    uint32_t hash;   /* hash of the path under the mountpoint, e.g. "dir/file.bin" */
+    uint32_t off;    /* dirent offset from romfs_root, 0 for an empty slot */
+    uint16_t parent; /* slot of the parent dir, ROMFS_INDEX_ROOT for entries in root */
+};
+
+static struct romfs_index_node romfs_index[ROMFS_INDEX_SIZE];
+static uint32_t romfs_index_count = 0;
+static uint8_t romfs_index_ok = 0;
+
+static void index_build(void);
+#endif
+
+#ifndef ROMFS_XZ_CACHE_NUM
+#define ROMFS_XZ_CACHE_NUM 0
+#endif
+
+#if ROMFS_XZ_CACHE_NUM
+#include "xz_private.h"
+
+#ifndef ROMFS_XZ_CHUNK_SIZE
+#define ROMFS_XZ_CHUNK_SIZE 4096
+#endif
+
+#define ROMFS_XZ_MAGIC     "RFXZ"
+#define ROMFS_XZ_VERSION   1
+#define ROMFS_XZ_SHIFT_MIN 12
+
+/* payload header of a file compressed by genromfs/romfs_xz.py, little endian */
+struct romfs_xz_header {
+    char magic[4];
+    uint8_t version;
+    uint8_t props;         /* LZMA2 dict props, see xz_dec_lzma2_reset */
+    uint8_t chunk_shift;   /* every chunk except the last holds 1 << chunk_shift raw bytes */
+    uint8_t reserved;
+    uint32_t size;         /* raw file size */
+    uint32_t chunk_off[];  /* chunk_num + 1 offsets from the header, chunk i is [off[i], off[i + 1]) */
+};
+
+/* decoded chunk cache, slots are replaced in lru order */
+struct romfs_xz_slot {
+    const struct romfs_xz_header *hdr; /* NULL for an empty slot */
+    uint32_t chunk;
+    uint32_t len;
+    uint32_t used;
+    uint8_t buf[ROMFS_XZ_CHUNK_SIZE];
+};
+
+static struct romfs_xz_slot romfs_xz_cache[ROMFS_XZ_CACHE_NUM];
+static uint32_t romfs_xz_used = 0;
+static struct xz_dec_lzma2 *romfs_xz_dec = NULL;
+static struct xz_heap romfs_xz_heap; /* no buf, the decoder state comes from malloc */
+
+#ifdef CONFIG_FREERTOS
+#include <FreeRTOS.h>
+#include <semphr.h>
+/* the decoder and the chunk cache are shared by all files, one compressed read at a time */
+static SemaphoreHandle_t romfs_xz_lock = NULL;
+#endif
+#endif
+
 static int is_path_ch(char ch)
 {
     if (((ch >= 'a') && (ch <= 'z')) ||
@@ -102,6 +177,23 @@ int romfs_mount(uint32_t addr)
 
     ROMFS_DEBUG("romfs: romfs size:%d*1024Byte\r\n", dirent_size(romfs_root) >> 10);
 
+#if ROMFS_INDEX_SIZE
+    index_build();
+#endif
+#if ROMFS_XZ_CACHE_NUM
+#ifdef CONFIG_FREERTOS
+    if (NULL == romfs_xz_lock) {
+        romfs_xz_lock = xSemaphoreCreateMutex();
+        if (NULL == romfs_xz_lock) {
+            ROMFS_ERROR("ERROR: romfs xz lock alloc failed.\r\n");
+            return -1;
+        }
+    }
+#endif
+    /* the partition may have been rewritten since the last mount */
+    memset(romfs_xz_cache, 0, sizeof(romfs_xz_cache));
+#endif
+
     return 0;
 }
 
@@ -138,6 +230,279 @@ static uint32_t dirent_size(void *addr)
     return U32HTONL(*((uint32_t *)addr + 2));
 }
 
+static char *dirent_payload(void *addr)
+{
+    return ((char *)addr) + ALIGNUP16(strlen(((char *)addr) + 16) + 1) + 16;
+}
+
+#if ROMFS_XZ_CACHE_NUM
+/* return the header if the file is compressed, NULL for a plain file */
+static const struct romfs_xz_header *xz_header(void *addr)
+{
+    const struct romfs_xz_header *hdr = (const struct romfs_xz_header *)dirent_payload(addr);
+    uint32_t payload_size = dirent_size(addr);
+    uint32_t chunk_num;
+
+    if ((payload_size < sizeof(struct romfs_xz_header)) || memcmp(hdr->magic, ROMFS_XZ_MAGIC, 4)) {
+        return NULL;
+    }
+    if ((hdr->version != ROMFS_XZ_VERSION) || (hdr->chunk_shift < ROMFS_XZ_SHIFT_MIN) ||
+        ((1UL << hdr->chunk_shift) > ROMFS_XZ_CHUNK_SIZE)) {
+        ROMFS_ERROR("ERROR: romfs xz version %d chunk_shift %d not supported.\r\n", hdr->version, hdr->chunk_shift);
+        return NULL;
+    }
+    chunk_num = (hdr->size + (1UL << hdr->chunk_shift) - 1) >> hdr->chunk_shift;
+    if ((chunk_num + 1 > (payload_size - sizeof(struct romfs_xz_header)) / 4) ||
+        (hdr->chunk_off[chunk_num] != payload_size)) {
+        ROMFS_ERROR("ERROR: romfs xz chunk table is broken.\r\n");
+        return NULL;
+    }
+    return hdr;
+}
+
+static uint32_t xz_chunk_len(const struct romfs_xz_header *hdr, uint32_t chunk)
+{
+    uint32_t start = chunk << hdr->chunk_shift;
+
+    if (hdr->size - start > (1UL << hdr->chunk_shift)) {
+        return 1UL << hdr->chunk_shift;
+    }
+    return hdr->size - start;
+}
+
+/* decode one chunk straight from xip flash, out must hold xz_chunk_len bytes */
+static int xz_decode(const struct romfs_xz_header *hdr, uint32_t chunk, uint8_t *out)
+{
+    struct xz_buf b;
+
+    if (hdr->chunk_off[chunk + 1] <= hdr->chunk_off[chunk]) {
+        return -1;
+    }
+
+    /* single call mode uses out as the dictionary, only the decoder state is allocated */
+    if (NULL == romfs_xz_dec) {
+        romfs_xz_dec = xz_dec_lzma2_create(XZ_SINGLE, 0, &romfs_xz_heap);
+        if (NULL == romfs_xz_dec) {
+            ROMFS_ERROR("ERROR: romfs xz decoder alloc failed.\r\n");
+            return -2;
+        }
+    }
+    if (XZ_OK != xz_dec_lzma2_reset(romfs_xz_dec, hdr->props)) {
+        return -3;
+    }
+
+    b.in = (const uint8_t *)hdr + hdr->chunk_off[chunk];
+    b.in_pos = 0;
+    b.in_size = hdr->chunk_off[chunk + 1] - hdr->chunk_off[chunk];
+    b.out = out;
+    b.out_pos = 0;
+    b.out_size = xz_chunk_len(hdr, chunk);
+
+    if ((XZ_STREAM_END != xz_dec_lzma2_run(romfs_xz_dec, &b)) || (b.out_pos != b.out_size)) {
+        ROMFS_ERROR("ERROR: romfs xz chunk %ld decode failed.\r\n", chunk);
+        return -4;
+    }
+    return 0;
+}
+
+static struct romfs_xz_slot *xz_cache_get(const struct romfs_xz_header *hdr, uint32_t chunk)
+{
+    struct romfs_xz_slot *slot = &romfs_xz_cache[0];
+    int i;
+
+    for (i = 0; i < ROMFS_XZ_CACHE_NUM; i++) {
+        if ((romfs_xz_cache[i].hdr == hdr) && (romfs_xz_cache[i].chunk == chunk)) {
+            romfs_xz_cache[i].used = ++romfs_xz_used;
+            return &romfs_xz_cache[i];
+        }
+        if (romfs_xz_cache[i].used < slot->used) {
+            slot = &romfs_xz_cache[i];
+        }
+    }
+
+    slot->hdr = NULL;
+    slot->used = 0;
+    if (xz_decode(hdr, chunk, slot->buf)) {
+        return NULL;
+    }
+    slot->hdr = hdr;
+    slot->chunk = chunk;
+    slot->len = xz_chunk_len(hdr, chunk);
+    slot->used = ++romfs_xz_used;
+    return slot;
+}
+
+/* only the chunks covering [offset, offset + length) are decoded */
+static size_t xz_read(const struct romfs_xz_header *hdr, romfs_file_t *fp, char *buf, size_t length)
+{
+    struct romfs_xz_slot *slot;
+    uint32_t chunk, off, len;
+    size_t total = 0;
+    int i;
+
+    if (fp->offset >= hdr->size) {
+        return 0;
+    }
+    if (length > hdr->size - fp->offset) {
+        length = hdr->size - fp->offset;
+    }
+
+    while (length > 0) {
+        chunk = fp->offset >> hdr->chunk_shift;
+        off = fp->offset & ((1UL << hdr->chunk_shift) - 1);
+        len = xz_chunk_len(hdr, chunk);
+        slot = NULL;
+
+        /* a whole chunk not in cache is decoded into buf directly */
+        if ((0 == off) && (length >= len)) {
+            for (i = 0; i < ROMFS_XZ_CACHE_NUM; i++) {
+                if ((romfs_xz_cache[i].hdr == hdr) && (romfs_xz_cache[i].chunk == chunk)) {
+                    slot = &romfs_xz_cache[i];
+                    break;
+                }
+            }
+            if ((NULL == slot) && xz_decode(hdr, chunk, (uint8_t *)buf)) {
+                break;
+            }
+        } else {
+            slot = xz_cache_get(hdr, chunk);
+            if (NULL == slot) {
+                break;
+            }
+        }
+
+        len -= off;
+        if (len > length) {
+            len = length;
+        }
+        if (slot) {
+            memcpy(buf, slot->buf + off, len);
+        }
+        buf += len;
+        fp->offset += len;
+        length -= len;
+        total += len;
+    }
+
+    return total;
+}
+#endif
+
+/* size seen by read/lseek/stat, the raw size for a compressed file */
+static uint32_t file_size(void *addr)
+{
+#if ROMFS_XZ_CACHE_NUM
+    const struct romfs_xz_header *hdr = xz_header(addr);
+
+    if (hdr) {
+        return hdr->size;
+    }
+#endif
+    return dirent_size(addr);
+}
+
+#if ROMFS_INDEX_SIZE
+static uint32_t index_hash(uint32_t hash, const char *str, size_t len)
+{
+    while (len--) {
+        hash = (hash ^ (uint8_t)*str++) * ROMFS_HASH_PRIME;
+    }
+    return hash;
+}
+
+/* the dirent names from the slot up to root must be the components of path */
+static int index_path_match(uint16_t slot, const char *path, size_t len)
+{
+    char *name;
+    size_t name_len;
+
+    while (1) {
+        name = romfs_root + romfs_index[slot].off + 16;
+        name_len = strlen(name);
+        if ((name_len > len) || memcmp(path + len - name_len, name, name_len)) {
+            return 0;
+        }
+        len -= name_len;
+        slot = romfs_index[slot].parent;
+        if (slot == ROMFS_INDEX_ROOT) {
+            return len == 0;
+        }
+        if ((len == 0) || (path[len - 1] != '/')) {
+            return 0;
+        }
+        len--;
+    }
+}
+
+static char *index_lookup(const char *path, size_t len)
+{
+    uint32_t hash = index_hash(ROMFS_HASH_INIT, path, len);
+    uint32_t i = hash & (ROMFS_INDEX_SIZE - 1);
+
+    while (romfs_index[i].off) {
+        if ((romfs_index[i].hash == hash) && index_path_match(i, path, len)) {
+            return romfs_root + romfs_index[i].off;
+        }
+        i = (i + 1) & (ROMFS_INDEX_SIZE - 1);
+    }
+    return NULL;
+}
+
+/* add every dirent of the dir starting at addr, then its sub dirs */
+static int index_dir(char *addr, uint32_t hash, uint16_t parent)
+{
+    char *end = (char *)romfs_endaddr();
+    char *name;
+    uint32_t name_hash, i;
+    int type;
+
+    while ((addr > romfs_root) && (addr < end)) {
+        type = dirent_type(addr);
+        name = addr + 16;
+        if (((ROMFH_DIR == type) || (ROMFH_REG == type)) && strcmp(name, ".") && strcmp(name, "..")) {
+            /* keep the table at most 3/4 full, a miss is then a short probe */
+            if ((romfs_index_count + 1) * 4 > ROMFS_INDEX_SIZE * 3) {
+                ROMFS_WARN("WARN: romfs index full, set ROMFS_INDEX_SIZE larger\r\n");
+                return -1;
+            }
+            name_hash = index_hash(hash, name, strlen(name));
+            i = name_hash & (ROMFS_INDEX_SIZE - 1);
+            while (romfs_index[i].off) {
+                i = (i + 1) & (ROMFS_INDEX_SIZE - 1);
+            }
+            romfs_index[i].hash = name_hash;
+            romfs_index[i].off = addr - romfs_root;
+            romfs_index[i].parent = parent;
+            romfs_index_count++;
+
+            if ((ROMFH_DIR == type) && dirent_childaddr(addr)) {
+                if (index_dir(romfs_root + dirent_childaddr(addr), index_hash(name_hash, "/", 1), i)) {
+                    return -1;
+                }
+            }
+        }
+        if (0 == dirent_hardfh(addr)) {
+            break;
+        }
+        addr = romfs_root + dirent_hardfh(addr);
+    }
+    return 0;
+}
+
+static void index_build(void)
+{
+    memset(romfs_index, 0, sizeof(romfs_index));
+    romfs_index_count = 0;
+    romfs_index_ok = 0;
+
+    /* first dirent after the volume name, same as the walk in file_info */
+    if (0 == index_dir(romfs_root + ALIGNUP16(strlen(romfs_root + 16) + 1) + 16, ROMFS_HASH_INIT, ROMFS_INDEX_ROOT)) {
+        romfs_index_ok = 1;
+    }
+    ROMFS_DEBUG("romfs: index %d entries, ok %d\r\n", romfs_index_count, romfs_index_ok);
+}
+#endif
+
 static int file_info(char *path, char **p_addr_start_input, char **p_addr_end_input)
 {
     char *addr_start = *p_addr_start_input;
@@ -237,6 +602,26 @@ uint32_t dirent_file(char *path, void **p_addr_start_input, void **p_addr_end_in
         p_name += 1;
     }
 
+#if ROMFS_INDEX_SIZE
+    /* the index holds every dirent, a miss needs no walk */
+    if (romfs_index_ok && (0 != *p_name)) {
+        size_t len = strlen(p_name);
+
+        if (p_name[len - 1] == '/') {
+            len--;
+        }
+        addr_start = index_lookup(p_name, len);
+        if (NULL == addr_start) {
+            ROMFS_WARN("WARN: not found path = %s\r\n", path);
+            return -1;
+        }
+        addr_end = dirent_hardfh(addr_start) ? (romfs_root + dirent_hardfh(addr_start)) : (char *)romfs_endaddr();
+        *p_addr_start_input = addr_start;
+        *p_addr_end_input = addr_end;
+        return 0;
+    }
+#endif
+
     /* search every one */
     addr_start = romfs_root;
     addr_end = (char *)romfs_endaddr();
@@ -338,7 +723,7 @@ int romfs_size(romfs_file_t *fp)
         return -1;
     }
 
-    return dirent_size(fp->f_arg);
+    return file_size(fp->f_arg);
 }
 
 size_t romfs_read(romfs_file_t *fp, char *buf, size_t length)
@@ -346,9 +731,23 @@ size_t romfs_read(romfs_file_t *fp, char *buf, size_t length)
     char *payload_buf;
     uint32_t payload_size;
     int len;
+#if ROMFS_XZ_CACHE_NUM
+    const struct romfs_xz_header *hdr = xz_header(fp->f_arg);
+
+    if (hdr) {
+#ifdef CONFIG_FREERTOS
+        xSemaphoreTake(romfs_xz_lock, portMAX_DELAY);
+        len = xz_read(hdr, fp, buf, length);
+        xSemaphoreGive(romfs_xz_lock);
+        return len;
+#else
+        return xz_read(hdr, fp, buf, length);
+#endif
+    }
+#endif
 
     /* init payload_buf and payload_size */
-    payload_buf = ((char *)fp->f_arg) + ALIGNUP16(strlen(((char *)fp->f_arg) + 16) + 1) + 16;
+    payload_buf = dirent_payload(fp->f_arg);
     payload_size = dirent_size(fp->f_arg);
 
     /* check arg */
@@ -371,28 +770,53 @@ size_t romfs_read(romfs_file_t *fp, char *buf, size_t length)
     return len;
 }
 
-// int romfs_ioctl(romfs_file_t *fp, int cmd, unsigned long arg)
-// {
-//     int ret = -1;
-//     romfs_filebuf_t *file_buf = (romfs_filebuf_t *)arg;
-
-//     if ((NULL == fp) || (NULL == file_buf)) {
-//         return -2;
-//     }
-//     switch (cmd) {
-//         case (IOCTL_ROMFS_GET_FILEBUF): {
-//             ROMFS_DEBUG("romfs: IOCTL_ROMFS_GET_FILEBUF.\r\n");
-//             file_buf->buf = ((char *)fp->f_arg) + ALIGNUP16(strlen(((char *)fp->f_arg) + 16) + 1) + 16;
-//             file_buf->bufsize = dirent_size(fp->f_arg);
-//             return 0;
-//         } break;
-//         default: {
-//             ret = -3;
-//         }
-//     }
-
-//     return ret;
-// }
+int romfs_ioctl(romfs_file_t *fp, int cmd, unsigned long arg)
+{
+    int ret = -1;
+    romfs_filebuf_t *file_buf = (romfs_filebuf_t *)arg;
+
+    if ((NULL == fp) || (NULL == fp->f_arg) || (NULL == file_buf)) {
+        return -2;
+    }
+    switch (cmd) {
+        case (IOCTL_ROMFS_GET_FILEBUF): {
+            ROMFS_DEBUG("romfs: IOCTL_ROMFS_GET_FILEBUF.\r\n");
+#if ROMFS_XZ_CACHE_NUM
+            /* a compressed file has no flash view */
+            if (xz_header(fp->f_arg)) {
+                return -4;
+            }
+#endif
+            file_buf->buf = dirent_payload(fp->f_arg);
+            file_buf->bufsize = dirent_size(fp->f_arg);
+            return 0;
+        } break;
+        default: {
+            ret = -3;
+        }
+    }
+
+    return ret;
+}
+
+/*
+ * zero copy view of a file, buf points to the payload in xip flash
+ * return: 0 success, other error
+ */
+int romfs_get_filebuf(const char *path, romfs_filebuf_t *file_buf)
+{
+    romfs_file_t fp;
+    int res;
+
+    res = romfs_open(&fp, path, 0);
+    if (res != 0) {
+        return res;
+    }
+    if (ROMFH_REG != dirent_type(fp.f_arg)) {
+        return -3;
+    }
+    return romfs_ioctl(&fp, IOCTL_ROMFS_GET_FILEBUF, (unsigned long)file_buf);
+}
 
 size_t romfs_lseek(romfs_file_t *fp, int off, romfs_whence_t whence)
 {
@@ -403,7 +827,7 @@ size_t romfs_lseek(romfs_file_t *fp, int off, romfs_whence_t whence)
         return -1;
     }
 
-    payload_size = dirent_size(fp->f_arg);
+    payload_size = file_size(fp->f_arg);
 
     if (whence == ROMFS_SEEK_SET) {
         if (off < 0) {
@@ -456,7 +880,7 @@ int romfs_stat(const char *path, romfs_stat_t *st)
             st->st_mode = ROMFS_S_IFDIR;
             ROMFS_DEBUG("romfs: st_size set 0");
         } else if (ROMFH_REG == dirent_type(start_addr)) {
-            st->st_size = dirent_size(start_addr);
+            st->st_size = file_size(start_addr);
             ROMFS_DEBUG("romfs: st_size set %ld\r\n", st->st_size);
             st->st_mode = ROMFS_S_IFREG;
         } else {
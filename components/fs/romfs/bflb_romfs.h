@@ -54,6 +54,8 @@
 #define ROMFS_S_IFDIR 0x0040000
 #define ROMFS_S_IFREG 0x0100000
 
+#define IOCTL_ROMFS_GET_FILEBUF 1
+
 typedef enum {
     ROMFS_SEEK_SET,
     ROMFS_SEEK_CUR,
@@ -71,6 +73,12 @@ typedef struct {
     int fd;        /* file fd */
 } romfs_file_t;
 
+/* IOCTL_ROMFS_GET_FILEBUF 返回的文件数据视图, buf 直接指向 xip flash, 只读, 无需拷贝 */
+typedef struct {
+    const char *buf; /* payload in xip flash */
+    size_t bufsize;  /* payload size */
+} romfs_filebuf_t;
+
 /* readdir 返回的路径结构体，被包含在 romfs_dir_t 中*/
 typedef struct {
     int d_ino;      /* file number */
@@ -92,6 +100,8 @@ int romfs_close(romfs_file_t *fp);
 int romfs_size(romfs_file_t *fp);
 size_t romfs_read(romfs_file_t *fp, char *buf, size_t length);
 size_t romfs_lseek(romfs_file_t *fp, int off, romfs_whence_t whence);
+int romfs_ioctl(romfs_file_t *fp, int cmd, unsigned long arg);
+int romfs_get_filebuf(const char *path, romfs_filebuf_t *file_buf);
 int romfs_stat(const char *path, romfs_stat_t *st);
 int romfs_opendir(romfs_dir_t *dp,const char *path);
 romfs_dirent_t *romfs_readdir(romfs_dir_t *dir);
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2023 Bouffalolab team
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# Compress the files of a romfs source tree into a staging tree, which is then
+# packed by genromfs as usual. Every compressed file is split into chunks of
+# raw LZMA2, bflb_romfs.c (ROMFS_XZ_CACHE_NUM) decodes only the chunks a read
+# touches. Payload layout, little endian:
+#
+#   char     magic[4]        "RFXZ"
+#   uint8_t  version         1
+#   uint8_t  props           LZMA2 dict props
+#   uint8_t  chunk_shift     raw chunk size is 1 << chunk_shift
+#   uint8_t  reserved
+#   uint32_t size            raw file size
+#   uint32_t chunk_off[n+1]  offsets of the chunks from the payload start
+#   chunk data
+
+import argparse
+import lzma
+import os
+import shutil
+import struct
+import sys
+
+MAGIC = b"RFXZ"
+VERSION = 1
+SHIFT_MIN = 12
+SHIFT_MAX = 16
+
+
+def lzma2_props(dict_size):
+    # same encoding as xz_dec_lzma2_reset
+    for props in range(40):
+        if ((2 | (props & 1)) << ((props >> 1) + 11)) >= dict_size:
+            return props
+    raise ValueError("dict size too large")
+
+
+def compress(data, shift, preset):
+    chunk_size = 1 << shift
+    filters = [{"id": lzma.FILTER_LZMA2, "preset": preset, "dict_size": chunk_size}]
+    chunks = [lzma.compress(data[i:i + chunk_size], format=lzma.FORMAT_RAW, filters=filters)
+              for i in range(0, len(data), chunk_size)]
+
+    off = 12 + 4 * (len(chunks) + 1)
+    table = []
+    for c in chunks:
+        table.append(off)
+        off += len(c)
+    table.append(off)
+
+    head = MAGIC + struct.pack("<BBBBI", VERSION, lzma2_props(chunk_size), shift, 0, len(data))
+    return head + struct.pack("<%dI" % len(table), *table) + b"".join(chunks)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="compress a romfs source tree for bflb_romfs")
+    parser.add_argument("-d", dest="src", required=True, help="romfs source dir")
+    parser.add_argument("-o", dest="dst", required=True, help="staging dir for genromfs -d, removed first")
+    parser.add_argument("-c", dest="chunk", type=int, default=4096,
+                        help="raw chunk size, power of 2 in 4096..65536 and not larger than CONFIG_ROMFS_XZ_CHUNK (default 4096)")
+    parser.add_argument("-r", dest="ratio", type=float, default=0.9,
+                        help="keep a file plain unless it shrinks below ratio of its size (default 0.9)")
+    parser.add_argument("-9", dest="extreme", action="store_true", help="slower, slightly better compression")
+    parser.add_argument("-v", dest="verbose", action="store_true", help="print every file")
+    args = parser.parse_args()
+
+    shift = args.chunk.bit_length() - 1
+    if (args.chunk != 1 << shift) or (shift < SHIFT_MIN) or (shift > SHIFT_MAX):
+        sys.exit("chunk size must be a power of 2 in 4096..65536")
+    if os.path.abspath(args.src) == os.path.abspath(args.dst):
+        sys.exit("staging dir must differ from source dir")
+    preset = 9 | lzma.PRESET_EXTREME if args.extreme else 9
+
+    if os.path.exists(args.dst):
+        shutil.rmtree(args.dst)
+
+    raw_total = 0
+    out_total = 0
+    packed = 0
+    for root, dirs, files in os.walk(args.src):
+        dirs.sort()
+        out_dir = os.path.join(args.dst, os.path.relpath(root, args.src))
+        os.makedirs(out_dir, exist_ok=True)
+        for name in sorted(files):
+            src = os.path.join(root, name)
+            with open(src, "rb") as f:
+                data = f.read()
+
+            out = data
+            if data:
+                packed_data = compress(data, shift, preset)
+                # a plain file starting with the magic would be taken as compressed
+                if len(packed_data) < len(data) * args.ratio or data.startswith(MAGIC):
+                    out = packed_data
+                    packed += 1
+
+            with open(os.path.join(out_dir, name), "wb") as f:
+                f.write(out)
+            shutil.copymode(src, os.path.join(out_dir, name))
+
+            raw_total += len(data)
+            out_total += len(out)
+            if args.verbose:
+                print("%-48s %8d -> %8d%s" % (os.path.relpath(src, args.src), len(data), len(out),
+                                              "" if out is data else " xz"))
+
+    print("romfs_xz: %d files compressed, %d -> %d bytes (%.2fx)" %
+          (packed, raw_total, out_total, raw_total / out_total if out_total else 1.0))
+
+
+if __name__ == "__main__":
+    main()
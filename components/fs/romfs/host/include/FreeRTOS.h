@@ -0,0 +1,13 @@
+/* host stand-in of FreeRTOS for romfs_xz_test, only the mutex bflb_romfs.c takes */
+#ifndef _FREERTOS_H
+#define _FREERTOS_H
+
+#include <pthread.h>
+#include <stdlib.h>
+
+typedef pthread_mutex_t *SemaphoreHandle_t;
+
+#define portMAX_DELAY 0xffffffffUL
+#define pdTRUE        1
+
+#endif
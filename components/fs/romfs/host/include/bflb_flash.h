@@ -0,0 +1,14 @@
+/* host stand-in of the lhal flash driver, romfs_xz_test maps the image at FLASH_XIP_BASE */
+#ifndef _BFLB_FLASH_H
+#define _BFLB_FLASH_H
+
+#include <stdint.h>
+
+#define FLASH_XIP_BASE 0x40000000
+
+static inline uint32_t bflb_flash_get_image_offset(void)
+{
+    return 0;
+}
+
+#endif
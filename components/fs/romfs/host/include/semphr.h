@@ -0,0 +1,30 @@
+/* host stand-in of semphr.h for romfs_xz_test, mutexes on pthread */
+#ifndef _SEMPHR_H
+#define _SEMPHR_H
+
+#include "FreeRTOS.h"
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t m = malloc(sizeof(*m));
+
+    if (m != NULL) {
+        pthread_mutex_init(m, NULL);
+    }
+    return m;
+}
+
+static inline int xSemaphoreTake(SemaphoreHandle_t m, unsigned long ticks)
+{
+    (void)ticks;
+    pthread_mutex_lock(m);
+    return pdTRUE;
+}
+
+static inline int xSemaphoreGive(SemaphoreHandle_t m)
+{
+    pthread_mutex_unlock(m);
+    return pdTRUE;
+}
+
+#endif
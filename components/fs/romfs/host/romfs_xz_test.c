@@ -0,0 +1,354 @@
+/**
+ * @file romfs_xz_test.c
+ * @brief host round trip of a romfs image against its source tree
+ *
+ * Copyright (c) 2023 Bouffalolab team
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "bflb_flash.h"
+#include "bflb_romfs.h"
+
+static const char *src_root;
+static int random_reads = 200;
+static uint32_t test_rand = 1;
+static int test_threads = 4;
+
+/* every file of the tree, for the reads from several threads at once */
+#define TEST_MAX_FILES 256
+struct test_file {
+    char rel[512];
+    uint8_t *ref;
+    size_t size;
+};
+static struct test_file test_files[TEST_MAX_FILES];
+static int test_file_num;
+
+static int file_num, file_packed, file_bad;
+static uint64_t raw_bytes;
+static double seq_ns, rnd_ns;
+static uint64_t seq_bytes, rnd_bytes, rnd_ops;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint32_t test_random_r(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static uint32_t test_random(void)
+{
+    return test_random_r(&test_rand);
+}
+
+static uint8_t *load(const char *path, size_t *size)
+{
+    FILE *fp = fopen(path, "rb");
+    uint8_t *data;
+    long n;
+
+    if (fp == NULL) {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    n = ftell(fp);
+    rewind(fp);
+    data = malloc(n + 1);
+    if (fread(data, 1, n, fp) != (size_t)n) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    *size = n;
+    return data;
+}
+
+/* compare one file through sequential reads, random lseek/read and stat */
+static int check_file(const char *rel, const uint8_t *ref, size_t size)
+{
+    char path[ROMFS_MAX_NAME_LEN * 4];
+    char *buf = malloc(size + 4096);
+    romfs_file_t fp;
+    romfs_stat_t st;
+    romfs_filebuf_t fb;
+    size_t pos, n, got, step;
+    uint32_t off, len;
+    double t;
+    int i;
+
+    snprintf(path, sizeof(path), "%s/%s", ROMFS_MOUNTPOINT, rel);
+    if (romfs_open(&fp, path, 0)) {
+        printf("%s: open failed\n", path);
+        return -1;
+    }
+    if ((romfs_size(&fp) != (int)size) || romfs_stat(path, &st) || (st.st_size != size) || (st.st_mode != ROMFS_S_IFREG)) {
+        printf("%s: size %d stat %u, expect %zu\n", path, romfs_size(&fp), st.st_size, size);
+        return -1;
+    }
+
+    /* odd step sizes cross chunk borders at every possible phase */
+    t = now_ns();
+    for (step = 1000, pos = 0; pos < size; pos += n) {
+        n = romfs_read(&fp, buf + pos, step);
+        if (n == 0) {
+            break;
+        }
+    }
+    seq_ns += now_ns() - t;
+    seq_bytes += size;
+    if ((pos != size) || memcmp(buf, ref, size) || romfs_read(&fp, buf, 1)) {
+        printf("%s: sequential read mismatch at %zu\n", path, pos);
+        return -1;
+    }
+
+    for (i = 0; (i < random_reads) && size; i++) {
+        off = test_random() % size;
+        len = test_random() % ((test_random() & 1) ? 64 : 20000) + 1;
+        t = now_ns();
+        if (romfs_lseek(&fp, off, ROMFS_SEEK_SET) != off) {
+            printf("%s: lseek %u failed\n", path, off);
+            return -1;
+        }
+        got = romfs_read(&fp, buf, len);
+        rnd_ns += now_ns() - t;
+        rnd_bytes += got;
+        rnd_ops++;
+        n = (len < size - off) ? len : size - off;
+        if ((got != n) || memcmp(buf, ref + off, n) || (fp.offset != off + n)) {
+            printf("%s: read %u at %u got %zu, mismatch\n", path, len, off, got);
+            return -1;
+        }
+    }
+
+    if (size && (romfs_lseek(&fp, -1, ROMFS_SEEK_END) != size - 1)) {
+        printf("%s: lseek end failed\n", path);
+        return -1;
+    }
+    if (size && ((romfs_read(&fp, buf, 16) != 1) || (buf[0] != (char)ref[size - 1]))) {
+        printf("%s: last byte mismatch\n", path);
+        return -1;
+    }
+
+    /* a compressed file has no flash view, a plain one must match */
+    if (romfs_get_filebuf(path, &fb) == 0) {
+        if ((fb.bufsize != size) || memcmp(fb.buf, ref, size)) {
+            printf("%s: filebuf mismatch\n", path);
+            return -1;
+        }
+    } else {
+        file_packed++;
+    }
+
+    romfs_close(&fp);
+    free(buf);
+    return 0;
+}
+
+static void walk(const char *rel)
+{
+    char dir_path[1024], file_path[1024], sub[512];
+    struct dirent *e;
+    struct stat sb;
+    uint8_t *ref;
+    size_t size;
+    DIR *dir;
+
+    snprintf(dir_path, sizeof(dir_path), "%s/%s", src_root, rel);
+    dir = opendir(dir_path);
+    if (dir == NULL) {
+        return;
+    }
+    while ((e = readdir(dir)) != NULL) {
+        if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) {
+            continue;
+        }
+        snprintf(sub, sizeof(sub), "%s%s%s", rel, *rel ? "/" : "", e->d_name);
+        snprintf(file_path, sizeof(file_path), "%s/%s", src_root, sub);
+        if (stat(file_path, &sb)) {
+            continue;
+        }
+        if (S_ISDIR(sb.st_mode)) {
+            walk(sub);
+        } else if (S_ISREG(sb.st_mode)) {
+            ref = load(file_path, &size);
+            if (ref == NULL) {
+                continue;
+            }
+            file_num++;
+            raw_bytes += size;
+            if (check_file(sub, ref, size)) {
+                file_bad++;
+            }
+            if (size && (test_file_num < TEST_MAX_FILES)) {
+                snprintf(test_files[test_file_num].rel, sizeof(test_files[0].rel), "%s", sub);
+                test_files[test_file_num].ref = ref;
+                test_files[test_file_num++].size = size;
+            } else {
+                free(ref);
+            }
+        }
+    }
+    closedir(dir);
+}
+
+/* random reads of random files, all threads at once, in the decoder and chunk cache they share */
+static void *thread_check(void *arg)
+{
+    uint32_t rand = (uint32_t)(uintptr_t)arg * 0x9E3779B9u | 1;
+    char path[ROMFS_MAX_NAME_LEN * 4];
+    char *buf = malloc(20000);
+    struct test_file *f;
+    romfs_file_t fp;
+    uint32_t off, len, n;
+    uintptr_t bad = 0;
+    int i;
+
+    for (i = 0; i < random_reads * test_file_num; i++) {
+        f = &test_files[test_random_r(&rand) % test_file_num];
+        snprintf(path, sizeof(path), "%s/%s", ROMFS_MOUNTPOINT, f->rel);
+        if (romfs_open(&fp, path, 0)) {
+            bad++;
+            continue;
+        }
+        off = test_random_r(&rand) % f->size;
+        len = test_random_r(&rand) % ((test_random_r(&rand) & 1) ? 64 : 20000) + 1;
+        n = (len < f->size - off) ? len : f->size - off;
+        romfs_lseek(&fp, off, ROMFS_SEEK_SET);
+        if ((romfs_read(&fp, buf, len) != n) || memcmp(buf, f->ref + off, n)) {
+            bad++;
+        }
+        romfs_close(&fp);
+    }
+    free(buf);
+    return (void *)bad;
+}
+
+static int threads_check(void)
+{
+    pthread_t tid[16];
+    uintptr_t bad = 0;
+    void *ret;
+    int i;
+
+    if (test_threads > 16) {
+        test_threads = 16;
+    }
+    for (i = 0; i < test_threads; i++) {
+        pthread_create(&tid[i], NULL, thread_check, (void *)(uintptr_t)(i + 1));
+    }
+    for (i = 0; i < test_threads; i++) {
+        pthread_join(tid[i], &ret);
+        bad += (uintptr_t)ret;
+    }
+    printf("  %d threads x %d random reads at once, %lu bad\n", test_threads,
+           random_reads * test_file_num, (unsigned long)bad);
+    return bad ? -1 : 0;
+}
+
+static void usage(void)
+{
+    printf("usage: romfs_xz_test -i <image> -s <source dir> [-n random reads per file] [-r seed] [-t threads]\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *image = NULL;
+    uint8_t *data;
+    size_t size;
+    void *xip;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:s:n:r:t:h")) != -1) {
+        switch (opt) {
+            case 'i':
+                image = optarg;
+                break;
+            case 's':
+                src_root = optarg;
+                break;
+            case 'n':
+                random_reads = atoi(optarg);
+                break;
+            case 'r':
+                test_rand = strtoul(optarg, NULL, 0) | 1;
+                break;
+            case 't':
+                test_threads = atoi(optarg);
+                break;
+            default:
+                usage();
+                return 1;
+        }
+    }
+    if ((image == NULL) || (src_root == NULL)) {
+        usage();
+        return 1;
+    }
+
+    data = load(image, &size);
+    if (data == NULL) {
+        printf("can not load %s\n", image);
+        return 1;
+    }
+    xip = mmap((void *)FLASH_XIP_BASE, size + 4096, PROT_READ | PROT_WRITE,
+               MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (xip == MAP_FAILED) {
+        printf("can not map the image at 0x%x\n", FLASH_XIP_BASE);
+        return 1;
+    }
+    memcpy(xip, data, size);
+    free(data);
+
+    if (romfs_mount(0)) {
+        return 1;
+    }
+
+    walk("");
+
+    printf("%s: %d files, %d compressed, %llu bytes in %zu byte image (%.2fx), %d bad\n",
+           image, file_num, file_packed, (unsigned long long)raw_bytes, size,
+           size ? (double)raw_bytes / size : 0, file_bad);
+    printf("  sequential read %.1f MB/s, random read %.2f us/op (%.1f MB/s)\n",
+           seq_ns ? seq_bytes * 1e3 / seq_ns : 0, rnd_ops ? rnd_ns / rnd_ops / 1e3 : 0,
+           rnd_ns ? rnd_bytes * 1e3 / rnd_ns : 0);
+
+    if ((test_threads > 1) && test_file_num && threads_check()) {
+        file_bad++;
+    }
+
+    return file_bad ? 1 : 0;
+}
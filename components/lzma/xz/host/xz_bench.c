@@ -0,0 +1,289 @@
+/**
+ * @file xz_bench.c
+ * @brief host bench of the xz decoder: ratio, decode speed and RAM per dictionary size
+ *
+ * Copyright (c) 2023 Bouffalolab team
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "xz_decompress.h"
+
+#define BENCH_IN_CHUNK  1460 /* network sized input */
+#define BENCH_OUT_CHUNK 4096 /* flash sector sized output */
+
+static int bench_repeat = 5;
+static int bench_bad;
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint8_t *load(const char *path, size_t *size)
+{
+    FILE *fp = fopen(path, "rb");
+    uint8_t *data;
+    long n;
+
+    if (fp == NULL) {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    n = ftell(fp);
+    rewind(fp);
+    data = malloc(n + 1);
+    if (fread(data, 1, n, fp) != (size_t)n) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    *size = n;
+    return data;
+}
+
+/* compress with the xz tool, the RISC-V filter needs xz 5.6 */
+static uint8_t *xz_tool(const char *path, uint32_t dict, int riscv, size_t *size)
+{
+    char cmd[1024];
+    uint8_t *out = NULL;
+    size_t cap = 0, n;
+    FILE *fp;
+
+    snprintf(cmd, sizeof(cmd), "xz -c -9 --format=xz --check=crc32 %s --lzma2=preset=9,dict=%u '%s'",
+             riscv ? "--riscv" : "", dict, path);
+    fp = popen(cmd, "r");
+    if (fp == NULL) {
+        return NULL;
+    }
+    *size = 0;
+    do {
+        if (*size == cap) {
+            cap = cap ? cap * 2 : 65536;
+            out = realloc(out, cap);
+        }
+        n = fread(out + *size, 1, cap - *size, fp);
+        *size += n;
+    } while (n);
+    if (pclose(fp) || (*size == 0)) {
+        free(out);
+        return NULL;
+    }
+    return out;
+}
+
+/* multi-call decode in network sized pieces into sector sized pieces */
+static int decode_multi(xz_ctx_t *ctx, const uint8_t *in, size_t in_size, uint8_t *out, size_t out_size)
+{
+    size_t in_pos = 0, out_pos = 0;
+    uint32_t in_len, out_len;
+    enum xz_ret ret;
+
+    do {
+        in_len = (in_size - in_pos < BENCH_IN_CHUNK) ? in_size - in_pos : BENCH_IN_CHUNK;
+        out_len = (out_size - out_pos < BENCH_OUT_CHUNK) ? out_size - out_pos : BENCH_OUT_CHUNK;
+        ret = xz_ctx_run(ctx, in + in_pos, &in_len, out + out_pos, &out_len);
+        in_pos += in_len;
+        out_pos += out_len;
+    } while (ret == XZ_OK);
+
+    return ((ret == XZ_STREAM_END) && (out_pos == out_size)) ? 0 : -1;
+}
+
+static void bench_one(const char *path, const uint8_t *raw, size_t raw_size, uint32_t dict, int riscv)
+{
+    uint8_t *packed, *out, *mem;
+    size_t packed_size;
+    uint32_t mem_size, in_len, out_len;
+    double t, multi = 1e9, single = 1e9;
+    xz_ctx_t ctx;
+    int i, ok = 1;
+
+    packed = xz_tool(path, dict, riscv, &packed_size);
+    if (packed == NULL) {
+        printf("%-10u %-6s xz tool failed\n", dict, riscv ? "riscv" : "-");
+        return;
+    }
+    out = malloc(raw_size);
+
+    /* XZ_PREALLOC in caller memory, as from PSRAM */
+    mem_size = xz_ctx_mem_size(XZ_PREALLOC, dict);
+    mem = malloc(mem_size);
+    if (xz_ctx_init(&ctx, XZ_PREALLOC, dict, mem, mem_size)) {
+        printf("%-10u init failed\n", dict);
+        bench_bad++;
+        return;
+    }
+    for (i = 0; i < bench_repeat; i++) {
+        xz_ctx_reset(&ctx);
+        memset(out, 0, raw_size);
+        t = now_s();
+        if (decode_multi(&ctx, packed, packed_size, out, raw_size) || memcmp(out, raw, raw_size)) {
+            ok = 0;
+        }
+        t = now_s() - t;
+        multi = (t < multi) ? t : multi;
+    }
+    xz_ctx_end(&ctx);
+
+    /* XZ_SINGLE needs no dictionary, the output is the history */
+    if (xz_ctx_init(&ctx, XZ_SINGLE, 0, NULL, 0) == 0) {
+        for (i = 0; i < bench_repeat; i++) {
+            in_len = packed_size;
+            out_len = raw_size;
+            t = now_s();
+            if ((xz_ctx_run(&ctx, packed, &in_len, out, &out_len) != XZ_STREAM_END) || (out_len != raw_size) ||
+                memcmp(out, raw, raw_size)) {
+                ok = 0;
+            }
+            t = now_s() - t;
+            single = (t < single) ? t : single;
+        }
+        xz_ctx_end(&ctx);
+    }
+
+    /* a smaller limit must refuse the stream instead of overrunning */
+    if ((dict > 4096) && (xz_ctx_init(&ctx, XZ_PREALLOC, dict / 2, mem, mem_size) == 0)) {
+        in_len = packed_size;
+        out_len = raw_size;
+        if (xz_ctx_run(&ctx, packed, &in_len, out, &out_len) != XZ_MEMLIMIT_ERROR) {
+            ok = 0;
+        }
+        xz_ctx_end(&ctx);
+    }
+
+    printf("%-10u %-6s %9zu %7.3f %8.1f %8.1f %10u %s\n", dict, riscv ? "riscv" : "-", packed_size,
+           (double)raw_size / packed_size, raw_size / multi / 1e6, raw_size / single / 1e6, mem_size,
+           ok ? "ok" : "MISMATCH");
+    if (!ok) {
+        bench_bad++;
+    }
+
+    free(mem);
+    free(out);
+    free(packed);
+}
+
+/* two contexts decoding in turns must not disturb each other */
+static void bench_interleave(const char *path, const uint8_t *raw, size_t raw_size)
+{
+    xz_ctx_t ctx[2];
+    uint8_t *packed[2], *out[2];
+    size_t packed_size[2], in_pos[2] = { 0 }, out_pos[2] = { 0 };
+    uint32_t in_len, out_len;
+    enum xz_ret ret[2] = { XZ_OK, XZ_OK };
+    int i;
+
+    packed[0] = xz_tool(path, 1 << 15, 0, &packed_size[0]);
+    packed[1] = xz_tool(path, 1 << 18, 1, &packed_size[1]);
+    if ((packed[0] == NULL) || (packed[1] == NULL)) {
+        return;
+    }
+    for (i = 0; i < 2; i++) {
+        out[i] = malloc(raw_size);
+        /* one in the malloc heap, one in caller memory */
+        if (xz_ctx_init(&ctx[i], XZ_DYNALLOC, 1 << 18, i ? malloc(xz_ctx_mem_size(XZ_DYNALLOC, 1 << 18)) : NULL,
+                        xz_ctx_mem_size(XZ_DYNALLOC, 1 << 18))) {
+            bench_bad++;
+            return;
+        }
+    }
+    while ((ret[0] == XZ_OK) || (ret[1] == XZ_OK)) {
+        for (i = 0; i < 2; i++) {
+            if (ret[i] != XZ_OK) {
+                continue;
+            }
+            in_len = (packed_size[i] - in_pos[i] < 333) ? packed_size[i] - in_pos[i] : 333;
+            out_len = (raw_size - out_pos[i] < 777) ? raw_size - out_pos[i] : 777;
+            ret[i] = xz_ctx_run(&ctx[i], packed[i] + in_pos[i], &in_len, out[i] + out_pos[i], &out_len);
+            in_pos[i] += in_len;
+            out_pos[i] += out_len;
+        }
+    }
+    for (i = 0; i < 2; i++) {
+        if ((ret[i] != XZ_STREAM_END) || (out_pos[i] != raw_size) || memcmp(out[i], raw, raw_size)) {
+            printf("interleaved decode %d failed\n", i);
+            bench_bad++;
+        }
+        xz_ctx_end(&ctx[i]);
+        free(ctx[i].heap.buf);
+        free(out[i]);
+        free(packed[i]);
+    }
+}
+
+static void usage(void)
+{
+    printf("usage: xz_bench [-d dict,dict,...] [-n repeat] file...\n");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t dicts[16] = { 1 << 15, 1 << 16, 1 << 17, 1 << 18, 1 << 20 };
+    int dict_num = 5, opt, i, f;
+    char *p;
+    uint8_t *raw;
+    size_t raw_size;
+
+    while ((opt = getopt(argc, argv, "d:n:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                for (dict_num = 0, p = optarg; p && *p && (dict_num < 16); p = strchr(p, ',') ? strchr(p, ',') + 1 : NULL) {
+                    dicts[dict_num++] = strtoul(p, NULL, 0);
+                }
+                break;
+            case 'n':
+                bench_repeat = atoi(optarg);
+                break;
+            default:
+                usage();
+                return 1;
+        }
+    }
+    if ((optind == argc) || (bench_repeat <= 0)) {
+        usage();
+        return 1;
+    }
+
+    for (f = optind; f < argc; f++) {
+        raw = load(argv[f], &raw_size);
+        if (raw == NULL) {
+            printf("can not load %s\n", argv[f]);
+            return 1;
+        }
+        printf("%s: %zu bytes\n", argv[f], raw_size);
+        printf("%-10s %-6s %9s %7s %8s %8s %10s\n", "dict", "bcj", "xz bytes", "ratio", "multi", "single", "RAM");
+        for (i = 0; i < dict_num; i++) {
+            bench_one(argv[f], raw, raw_size, dicts[i], 0);
+            bench_one(argv[f], raw, raw_size, dicts[i], 1);
+        }
+        bench_interleave(argv[f], raw, raw_size);
+        free(raw);
+    }
+
+    printf("%s\n", bench_bad ? "bench failed" : "all streams decoded and verified");
+    return bench_bad ? 1 : 0;
+}
@@ -197,6 +197,38 @@ struct xz_dec;
  */
 XZ_EXTERN struct xz_dec *xz_dec_init(enum xz_mode mode, uint32_t dict_max);
 
+/**
+ * struct xz_heap - Memory a decoder allocates from
+ * @buf:        Caller memory (e.g. PSRAM) the decoder state and dictionary
+ *              are carved from, or NULL to use malloc() and free()
+ * @size:       Size of buf
+ * @used:       Bytes of buf handed out, 0 for a new heap
+ * @last:       Offset of the newest allocation, so freeing it gives it back
+ *
+ * xz_dec_init() uses the heap of simple_malloc_init(), which all such
+ * decoders share. A decoder made by xz_dec_init_heap() only touches its
+ * own heap, so decoders on different heaps may run at the same time.
+ * xz_dec_mem_size() tells how large buf has to be.
+ */
+struct xz_heap {
+    uint8_t *buf;
+    uint32_t size;
+    uint32_t used;
+    uint32_t last;
+};
+
+/**
+ * xz_dec_init_heap() - Like xz_dec_init(), allocating from heap
+ * @heap:       Must stay valid until xz_dec_end(). NULL selects the heap of
+ *              simple_malloc_init().
+ */
+XZ_EXTERN struct xz_dec *xz_dec_init_heap(enum xz_mode mode, uint32_t dict_max, struct xz_heap *heap);
+
+/**
+ * xz_dec_mem_size() - Heap bytes xz_dec_init_heap() and xz_dec_run() take at most
+ */
+XZ_EXTERN uint32_t xz_dec_mem_size(enum xz_mode mode, uint32_t dict_max);
+
 /**
  * xz_dec_run() - Run the XZ decoder
  * @s:          Decoder state allocated using xz_dec_init()
@@ -298,6 +330,8 @@ XZ_EXTERN uint64_t xz_crc64(const uint8_t *buf, size_t size, uint64_t crc);
 #endif
 
 void simple_malloc_init(uint8_t *buf, uint32_t len);
+void *xz_heap_alloc(struct xz_heap *heap, uint32_t size);
+void xz_heap_free(struct xz_heap *heap, void *ptr);
 int xz_verify_header(uint8_t *buffer);
 
 #ifdef __cplusplus
@@ -17,18 +17,18 @@
 /* #define XZ_DEC_ARM */
 /* #define XZ_DEC_ARMTHUMB */
 /* #define XZ_DEC_SPARC */
+/* #define XZ_DEC_RISCV */
 
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <xz.h>
 
-extern void *simple_malloc(uint32_t size);
-extern void simple_free(void *p);
-#define kmalloc(size, flags) simple_malloc(size)
-#define kfree(ptr)           simple_free(ptr)
-#define vmalloc(size)        simple_malloc(size)
-#define vfree(ptr)           simple_free(ptr)
+/* every allocation names the heap of its decoder, see struct xz_heap */
+#define kmalloc(heap, size) xz_heap_alloc(heap, size)
+#define kfree(heap, ptr)    xz_heap_free(heap, ptr)
+#define vmalloc(heap, size) xz_heap_alloc(heap, size)
+#define vfree(heap, ptr)    xz_heap_free(heap, ptr)
 
 #define memeq(a, b, size)  (memcmp(a, b, size) == 0)
 #define memzero(buf, size) memset(buf, 0, size)
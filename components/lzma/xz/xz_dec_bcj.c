@@ -24,7 +24,8 @@ struct xz_dec_bcj {
         BCJ_IA64 = 6,     /* Big or little endian */
         BCJ_ARM = 7,      /* Little endian only */
         BCJ_ARMTHUMB = 8, /* Little endian only */
-        BCJ_SPARC = 9     /* Big or little endian */
+        BCJ_SPARC = 9,    /* Big or little endian */
+        BCJ_RISCV = 11    /* Little endian only */
     } type;
 
     /*
@@ -71,8 +72,9 @@ struct xz_dec_bcj {
          * ARM              4           0
          * ARM-Thumb        2           2
          * SPARC            4           0
+         * RISC-V           2           8
          */
-        uint8_t buf[16];
+        uint8_t buf[24];
     } temp;
 };
 
@@ -341,6 +343,98 @@ static size_t bcj_sparc(struct xz_dec_bcj *s, uint8_t *buf, size_t size)
 }
 #endif
 
+#ifdef XZ_DEC_RISCV
+/*
+ * RISC-V filter of xz 5.6: JAL targets and AUIPC pairs (AUIPC followed by an
+ * instruction using its rd) were made absolute by the encoder, the encoder
+ * also swapped the fields of the pair so that addresses compress well.
+ */
+static size_t bcj_riscv(struct xz_dec_bcj *s, uint8_t *buf, size_t size)
+{
+    size_t i;
+    uint32_t b1;
+    uint32_t b2;
+    uint32_t b3;
+    uint32_t instr;
+    uint32_t instr2;
+    uint32_t instr2_rs1;
+    uint32_t addr;
+
+    if (size < 8) {
+        return 0;
+    }
+
+    size -= 8;
+
+    for (i = 0; i <= size; i += 2) {
+        instr = buf[i];
+
+        if (instr == 0xEF) {
+            /* JAL with rd x1 or x5 */
+            b1 = buf[i + 1];
+
+            if ((b1 & 0x0D) != 0) {
+                continue;
+            }
+
+            b2 = buf[i + 2];
+            b3 = buf[i + 3];
+
+            addr = ((b1 & 0xF0) << 13) | (b2 << 9) | (b3 << 1);
+            addr -= s->pos + (uint32_t)i;
+
+            buf[i + 1] = (uint8_t)((b1 & 0x0F) | ((addr >> 8) & 0xF0));
+            buf[i + 2] = (uint8_t)(((addr >> 16) & 0x0F) | ((addr >> 7) & 0x10) | ((addr << 4) & 0xE0));
+            buf[i + 3] = (uint8_t)(((addr >> 4) & 0x7F) | ((addr >> 13) & 0x80));
+
+            i += 4 - 2;
+        } else if ((instr & 0x7F) == 0x17) {
+            /* AUIPC */
+            instr |= (uint32_t)buf[i + 1] << 8;
+            instr |= (uint32_t)buf[i + 2] << 16;
+            instr |= (uint32_t)buf[i + 3] << 24;
+
+            if (instr & 0xE80) {
+                /* rd is not x0 or x2: a pair is kept only if inst2 uses rd as rs1 */
+                instr2 = get_unaligned_le32(buf + i + 4);
+
+                if ((((instr << 8) ^ (instr2 - 3)) & 0xF8003) != 0) {
+                    i += 6 - 2;
+                    continue;
+                }
+
+                addr = (instr & 0xFFFFF000) + (instr2 >> 20);
+
+                instr = 0x17 | (2 << 7) | (instr2 << 12);
+                instr2 = addr;
+            } else {
+                /* rd is x0 or x2: the encoder stored a converted pair this way */
+                instr2_rs1 = instr >> 27;
+
+                if ((uint32_t)((instr - 0x3117) << 18) >= (instr2_rs1 & 0x1D)) {
+                    i += 4 - 2;
+                    continue;
+                }
+
+                addr = get_unaligned_be32(buf + i + 4);
+                addr -= s->pos + (uint32_t)i;
+
+                instr2 = (instr >> 12) | (addr << 20);
+
+                instr = 0x17 | (instr2_rs1 << 7) | ((addr + 0x800) & 0xFFFFF000);
+            }
+
+            put_unaligned_le32(instr, buf + i);
+            put_unaligned_le32(instr2, buf + i + 4);
+
+            i += 8 - 2;
+        }
+    }
+
+    return i;
+}
+#endif
+
 /*
  * Apply the selected BCJ filter. Update *pos and s->pos to match the amount
  * of data that got filtered.
@@ -394,6 +488,12 @@ static void bcj_apply(struct xz_dec_bcj *s,
             filtered = bcj_sparc(s, buf, size);
             break;
 #endif
+#ifdef XZ_DEC_RISCV
+
+        case BCJ_RISCV:
+            filtered = bcj_riscv(s, buf, size);
+            break;
+#endif
 
         default:
             /* Never reached but silence compiler warnings. */
@@ -548,9 +648,10 @@ XZ_EXTERN enum xz_ret xz_dec_bcj_run(struct xz_dec_bcj *s,
     return s->ret;
 }
 
-XZ_EXTERN struct xz_dec_bcj *xz_dec_bcj_create(bool single_call)
+XZ_EXTERN struct xz_dec_bcj *xz_dec_bcj_create(bool single_call,
+                                               struct xz_heap *heap)
 {
-    struct xz_dec_bcj *s = kmalloc(sizeof(*s), GFP_KERNEL);
+    struct xz_dec_bcj *s = kmalloc(heap, sizeof(*s));
 
     if (s != NULL) {
         s->single_call = single_call;
@@ -559,6 +660,11 @@ XZ_EXTERN struct xz_dec_bcj *xz_dec_bcj_create(bool single_call)
     return s;
 }
 
+XZ_EXTERN uint32_t xz_dec_bcj_size(void)
+{
+    return XZ_HEAP_ALIGN(sizeof(struct xz_dec_bcj));
+}
+
 XZ_EXTERN enum xz_ret xz_dec_bcj_reset(struct xz_dec_bcj *s, uint8_t id)
 {
     switch (id) {
@@ -580,6 +686,9 @@ XZ_EXTERN enum xz_ret xz_dec_bcj_reset(struct xz_dec_bcj *s, uint8_t id)
 #endif
 #ifdef XZ_DEC_SPARC
         case BCJ_SPARC:
+#endif
+#ifdef XZ_DEC_RISCV
+        case BCJ_RISCV:
 #endif
             break;
 
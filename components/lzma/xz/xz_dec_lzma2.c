@@ -276,6 +276,9 @@ struct xz_dec_lzma2 {
         uint32_t size;
         uint8_t buf[3 * LZMA_IN_REQUIRED];
     } temp;
+
+    /* Where the state and the dictionary were allocated */
+    struct xz_heap *heap;
 };
 
 /**************
@@ -1151,22 +1154,24 @@ XZ_EXTERN enum xz_ret xz_dec_lzma2_run(struct xz_dec_lzma2 *s,
 }
 
 XZ_EXTERN struct xz_dec_lzma2 *xz_dec_lzma2_create(enum xz_mode mode,
-                                                   uint32_t dict_max)
+                                                   uint32_t dict_max,
+                                                   struct xz_heap *heap)
 {
-    struct xz_dec_lzma2 *s = (struct xz_dec_lzma2 *)kmalloc(sizeof(*s), GFP_KERNEL);
+    struct xz_dec_lzma2 *s = (struct xz_dec_lzma2 *)kmalloc(heap, sizeof(*s));
 
     if (s == NULL) {
         return NULL;
     }
 
+    s->heap = heap;
     s->dict.mode = mode;
     s->dict.size_max = dict_max;
 
     if (DEC_IS_PREALLOC(mode)) {
-        s->dict.buf = (uint8_t *)vmalloc(dict_max);
+        s->dict.buf = (uint8_t *)vmalloc(heap, dict_max);
 
         if (s->dict.buf == NULL) {
-            kfree(s);
+            kfree(heap, s);
             return NULL;
         }
     } else if (DEC_IS_DYNALLOC(mode)) {
@@ -1196,8 +1201,9 @@ XZ_EXTERN enum xz_ret xz_dec_lzma2_reset(struct xz_dec_lzma2 *s, uint8_t props)
 
         if (DEC_IS_DYNALLOC(s->dict.mode)) {
             if (s->dict.allocated < s->dict.size) {
-                vfree(s->dict.buf);
-                s->dict.buf = (uint8_t *)vmalloc(s->dict.size);
+                s->dict.allocated = s->dict.size;
+                vfree(s->heap, s->dict.buf);
+                s->dict.buf = (uint8_t *)vmalloc(s->heap, s->dict.size);
 
                 if (s->dict.buf == NULL) {
                     s->dict.allocated = 0;
@@ -1220,8 +1226,13 @@ XZ_EXTERN enum xz_ret xz_dec_lzma2_reset(struct xz_dec_lzma2 *s, uint8_t props)
 XZ_EXTERN void xz_dec_lzma2_end(struct xz_dec_lzma2 *s)
 {
     if (DEC_IS_MULTI(s->dict.mode)) {
-        vfree(s->dict.buf);
+        vfree(s->heap, s->dict.buf);
     }
 
-    kfree(s);
+    kfree(s->heap, s);
+}
+
+XZ_EXTERN uint32_t xz_dec_lzma2_size(void)
+{
+    return XZ_HEAP_ALIGN(sizeof(struct xz_dec_lzma2));
 }
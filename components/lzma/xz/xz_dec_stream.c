@@ -153,6 +153,9 @@ struct xz_dec {
     struct xz_dec_bcj *bcj;
     bool bcj_active;
 #endif
+
+    /* Where all decoder memory comes from */
+    struct xz_heap *heap;
 };
 
 #ifdef XZ_DEC_ANY_CHECK
@@ -895,16 +898,28 @@ XZ_EXTERN enum xz_ret xz_dec_run(struct xz_dec *s, struct xz_buf *b)
 
 XZ_EXTERN struct xz_dec *xz_dec_init(enum xz_mode mode, uint32_t dict_max)
 {
-    struct xz_dec *s = (struct xz_dec *)kmalloc(sizeof(*s), GFP_KERNEL);
+    return xz_dec_init_heap(mode, dict_max, NULL);
+}
+
+XZ_EXTERN struct xz_dec *xz_dec_init_heap(enum xz_mode mode, uint32_t dict_max, struct xz_heap *heap)
+{
+    struct xz_dec *s;
+
+    if (heap == NULL) {
+        heap = xz_heap_default();
+    }
+
+    s = (struct xz_dec *)kmalloc(heap, sizeof(*s));
 
     if (s == NULL) {
         return NULL;
     }
 
+    s->heap = heap;
     s->mode = mode;
 
 #ifdef XZ_DEC_BCJ
-    s->bcj = xz_dec_bcj_create(DEC_IS_SINGLE(mode));
+    s->bcj = xz_dec_bcj_create(DEC_IS_SINGLE(mode), heap);
 
     if (s->bcj == NULL) {
         goto error_bcj;
@@ -912,7 +927,7 @@ XZ_EXTERN struct xz_dec *xz_dec_init(enum xz_mode mode, uint32_t dict_max)
 
 #endif
 
-    s->lzma2 = xz_dec_lzma2_create(mode, dict_max);
+    s->lzma2 = xz_dec_lzma2_create(mode, dict_max, heap);
 
     if (s->lzma2 == NULL) {
         goto error_lzma2;
@@ -923,13 +938,27 @@ XZ_EXTERN struct xz_dec *xz_dec_init(enum xz_mode mode, uint32_t dict_max)
 
 error_lzma2:
 #ifdef XZ_DEC_BCJ
-    xz_dec_bcj_end(s->bcj);
+    xz_dec_bcj_end(s->bcj, heap);
 error_bcj:
 #endif
-    kfree(s);
+    kfree(heap, s);
     return NULL;
 }
 
+XZ_EXTERN uint32_t xz_dec_mem_size(enum xz_mode mode, uint32_t dict_max)
+{
+    uint32_t size = XZ_HEAP_ALIGN(sizeof(struct xz_dec)) + xz_dec_lzma2_size();
+
+#ifdef XZ_DEC_BCJ
+    size += xz_dec_bcj_size();
+#endif
+    if (mode != XZ_SINGLE) {
+        size += XZ_HEAP_ALIGN(dict_max);
+    }
+
+    return size;
+}
+
 XZ_EXTERN void xz_dec_reset(struct xz_dec *s)
 {
     s->sequence = SEQ_STREAM_HEADER;
@@ -947,8 +976,8 @@ XZ_EXTERN void xz_dec_end(struct xz_dec *s)
     if (s != NULL) {
         xz_dec_lzma2_end(s->lzma2);
 #ifdef XZ_DEC_BCJ
-        xz_dec_bcj_end(s->bcj);
+        xz_dec_bcj_end(s->bcj, s->heap);
 #endif
-        kfree(s);
+        kfree(s->heap, s);
     }
 }
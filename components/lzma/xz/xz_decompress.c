@@ -1,19 +1,67 @@
-#include "xz.h"
+#include "xz_decompress.h"
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 
 static struct xz_dec *s;
 
+uint32_t xz_ctx_mem_size(enum xz_mode mode, uint32_t dict_max)
+{
+    return xz_dec_mem_size(mode, dict_max);
+}
+
+int xz_ctx_init(xz_ctx_t *ctx, enum xz_mode mode, uint32_t dict_max, uint8_t *mem, uint32_t mem_size)
+{
+    xz_crc32_init();
+
+    memset(ctx, 0, sizeof(xz_ctx_t));
+    ctx->heap.buf = mem;
+    ctx->heap.size = mem ? mem_size : 0;
+
+    ctx->dec = xz_dec_init_heap(mode, dict_max, &ctx->heap);
+
+    return (ctx->dec == NULL) ? 1 : 0;
+}
+
+enum xz_ret xz_ctx_run(xz_ctx_t *ctx, const uint8_t *in, uint32_t *in_len, uint8_t *out, uint32_t *out_len)
+{
+    struct xz_buf b;
+    enum xz_ret ret;
+
+    b.in = in;
+    b.in_pos = 0;
+    b.in_size = *in_len;
+    b.out = out;
+    b.out_pos = 0;
+    b.out_size = *out_len;
+
+    ret = xz_dec_run(ctx->dec, &b);
+
+    *in_len = b.in_pos;
+    *out_len = b.out_pos;
+    return ret;
+}
+
+void xz_ctx_reset(xz_ctx_t *ctx)
+{
+    xz_dec_reset(ctx->dec);
+}
+
+void xz_ctx_end(xz_ctx_t *ctx)
+{
+    xz_dec_end(ctx->dec);
+    ctx->dec = NULL;
+}
+
 int xz_uncompress_init(struct xz_buf *stream, uint8_t *sbuf, uint8_t *dbuf)
 {
     xz_crc32_init();
 
     /*
-     * Support up to 32 KiB dictionary. The actually needed memory
-     * is allocated once the headers have been parsed.
+     * Support up to XZ_UNCOMPRESS_DICT_MAX dictionary. The actually needed
+     * memory is allocated once the headers have been parsed.
      */
-    s = xz_dec_init(XZ_DYNALLOC, 1 << 15);
+    s = xz_dec_init(XZ_DYNALLOC, XZ_UNCOMPRESS_DICT_MAX);
 
     if (s == NULL) {
         return 1;
@@ -54,7 +102,7 @@ int xz_uncompress_stream(struct xz_buf *stream, uint8_t *sbuf, uint32_t slen,
     return status;
 }
 
-void xz_uncompress_end()
+void xz_uncompress_end(void)
 {
     xz_dec_end(s);
 }
@@ -0,0 +1,59 @@
+#ifndef XZ_DECOMPRESS_H
+#define XZ_DECOMPRESS_H
+
+#include "xz.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* dictionary limit of xz_uncompress_init(), streams with a larger one fail */
+#ifndef XZ_UNCOMPRESS_DICT_MAX
+#define XZ_UNCOMPRESS_DICT_MAX (1 << 15)
+#endif
+
+/*
+ * One decompression. Contexts do not share any state, so several may run
+ * at the same time, e.g. romfs reads during an OTA.
+ */
+typedef struct {
+    struct xz_heap heap;
+    struct xz_dec *dec;
+} xz_ctx_t;
+
+/*
+ * Bytes xz_ctx_init() needs in mem for this mode and dictionary limit.
+ * XZ_PREALLOC takes all of it at init, XZ_DYNALLOC takes the dictionary
+ * once the stream header tells its size.
+ */
+uint32_t xz_ctx_mem_size(enum xz_mode mode, uint32_t dict_max);
+
+/*
+ * mode is XZ_PREALLOC or XZ_DYNALLOC (multi-call) or XZ_SINGLE. With mem the
+ * decoder lives in the caller's memory (e.g. PSRAM) of mem_size bytes,
+ * without it in the malloc heap. Returns 0 on success.
+ */
+int xz_ctx_init(xz_ctx_t *ctx, enum xz_mode mode, uint32_t dict_max, uint8_t *mem, uint32_t mem_size);
+
+/*
+ * Decode from in into out. *in_len and *out_len are the sizes on entry and
+ * the bytes consumed and produced on return. Returns XZ_OK while more is
+ * to come, XZ_STREAM_END at the end of the stream, or an error.
+ */
+enum xz_ret xz_ctx_run(xz_ctx_t *ctx, const uint8_t *in, uint32_t *in_len, uint8_t *out, uint32_t *out_len);
+
+/* start the next stream with the same memory */
+void xz_ctx_reset(xz_ctx_t *ctx);
+void xz_ctx_end(xz_ctx_t *ctx);
+
+/* single decoder on the simple_malloc_init() heap */
+int xz_uncompress_init(struct xz_buf *stream, uint8_t *sbuf, uint8_t *dbuf);
+int xz_uncompress_stream(struct xz_buf *stream, uint8_t *sbuf, uint32_t slen,
+                         uint8_t *dbuf, uint32_t dlen, uint32_t *decomp_len);
+void xz_uncompress_end(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
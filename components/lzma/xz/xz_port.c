@@ -1,32 +1,63 @@
 #include "stdio.h"
 #include <stddef.h>
+#include "xz_private.h"
 
-static uint8_t *mallocBuf = NULL;
-static uint32_t malloced = 0;
-static uint32_t bufsize = 0;
+/* heap of xz_dec_init(), shared by all its decoders */
+static struct xz_heap simple_heap;
+
+struct xz_heap *xz_heap_default(void)
+{
+    return &simple_heap;
+}
 
 void simple_malloc_init(uint8_t *buf, uint32_t len)
 {
-    mallocBuf = buf;
-    malloced = 0;
-    bufsize = len;
+    simple_heap.buf = buf;
+    simple_heap.size = len;
+    simple_heap.used = 0;
+    simple_heap.last = 0;
 }
-void *simple_malloc(uint32_t size)
+
+void *xz_heap_alloc(struct xz_heap *heap, uint32_t size)
 {
     uint8_t *p;
+
     //printf("Simple Malloc %ld\r\n", size);
+    if (heap->buf == NULL) {
+        return malloc(size);
+    }
 
-    if (malloced + size < bufsize) {
-        p = mallocBuf + malloced;
-        malloced += size;
+    size = XZ_HEAP_ALIGN(size);
+    if ((heap->used <= heap->size) && (size <= heap->size - heap->used)) {
+        p = heap->buf + heap->used;
+        heap->last = heap->used;
+        heap->used += size;
         return p;
     }
 
     return NULL;
 }
 
+void xz_heap_free(struct xz_heap *heap, void *ptr)
+{
+    //printf("Simple Free %08x\r\n", ptr);
+    if (heap->buf == NULL) {
+        free(ptr);
+        return;
+    }
+
+    /* only the newest block can be given back, e.g. a dictionary that grows */
+    if ((ptr != NULL) && ((uint8_t *)ptr == heap->buf + heap->last)) {
+        heap->used = heap->last;
+    }
+}
+
+void *simple_malloc(uint32_t size)
+{
+    return xz_heap_alloc(&simple_heap, size);
+}
+
 void simple_free(void *p)
 {
-    //printf("Simple Free %08x\r\n", p);
-    return;
+    xz_heap_free(&simple_heap, p);
 }
@@ -37,6 +37,9 @@
 #ifdef CONFIG_XZ_DEC_SPARC
 #define XZ_DEC_SPARC
 #endif
+#ifdef CONFIG_XZ_DEC_RISCV
+#define XZ_DEC_RISCV
+#endif
 #define memeq(a, b, size)  (memcmp(a, b, size) == 0)
 #define memzero(buf, size) memset(buf, 0, size)
 #endif
@@ -93,17 +96,27 @@
  * XZ_DEC_BCJ is used to enable generic support for BCJ decoders.
  */
 #ifndef XZ_DEC_BCJ
-#if defined(XZ_DEC_X86) || defined(XZ_DEC_POWERPC) || defined(XZ_DEC_IA64) || defined(XZ_DEC_ARM) || defined(XZ_DEC_ARM) || defined(XZ_DEC_ARMTHUMB) || defined(XZ_DEC_SPARC)
+#if defined(XZ_DEC_X86) || defined(XZ_DEC_POWERPC) || defined(XZ_DEC_IA64) || defined(XZ_DEC_ARM) || defined(XZ_DEC_ARM) || defined(XZ_DEC_ARMTHUMB) || defined(XZ_DEC_SPARC) || defined(XZ_DEC_RISCV)
 #define XZ_DEC_BCJ
 #endif
 #endif
 
+/* Allocations are rounded up so every structure is aligned */
+#define XZ_HEAP_ALIGN(size) (((size) + 7) & ~(uint32_t)7)
+
+/* Heap of xz_dec_init(), set up by simple_malloc_init() */
+struct xz_heap *xz_heap_default(void);
+
 /*
  * Allocate memory for LZMA2 decoder. xz_dec_lzma2_reset() must be used
  * before calling xz_dec_lzma2_run().
  */
 XZ_EXTERN struct xz_dec_lzma2 *xz_dec_lzma2_create(enum xz_mode mode,
-                                                   uint32_t dict_max);
+                                                   uint32_t dict_max,
+                                                   struct xz_heap *heap);
+
+/* Heap bytes of the LZMA2 decoder state, without the dictionary */
+XZ_EXTERN uint32_t xz_dec_lzma2_size(void);
 
 /*
  * Decode the LZMA2 properties (one byte) and reset the decoder. Return
@@ -126,7 +139,11 @@ XZ_EXTERN void xz_dec_lzma2_end(struct xz_dec_lzma2 *s);
  * Allocate memory for BCJ decoders. xz_dec_bcj_reset() must be used before
  * calling xz_dec_bcj_run().
  */
-XZ_EXTERN struct xz_dec_bcj *xz_dec_bcj_create(bool single_call);
+XZ_EXTERN struct xz_dec_bcj *xz_dec_bcj_create(bool single_call,
+                                               struct xz_heap *heap);
+
+/* Heap bytes of the BCJ decoder state */
+XZ_EXTERN uint32_t xz_dec_bcj_size(void);
 
 /*
  * Decode the Filter ID of a BCJ filter. This implementation doesn't
@@ -146,7 +163,7 @@ XZ_EXTERN enum xz_ret xz_dec_bcj_run(struct xz_dec_bcj *s,
                                      struct xz_buf *b);
 
 /* Free the memory allocated for the BCJ filters. */
-#define xz_dec_bcj_end(s) kfree(s)
+#define xz_dec_bcj_end(s, heap) kfree(heap, s)
 #endif
 
 #endif
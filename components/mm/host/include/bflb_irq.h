@@ -0,0 +1,11 @@
+/* host stand-in of bflb_irq.h for mem_bench, only what the heap and the cache use */
+#ifndef _BFLB_IRQ_H
+#define _BFLB_IRQ_H
+
+#include <stdint.h>
+
+/* interrupts off on one core: one recursive lock over all threads, see mem_bench.c */
+uintptr_t bflb_irq_save(void);
+void bflb_irq_restore(uintptr_t flags);
+
+#endif
@@ -0,0 +1,384 @@
+/**
+ * @file mem_bench.c
+ * @brief host multi-thread bench of the tlsf heap against the small-object cache
+ *
+ * Copyright (c) 2023 Bouffalolab team
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "mem.h"
+#include "tlsf.h"
+#include "bflb_irq.h"
+
+#define BENCH_HEAP_SIZE    (512 * 1024)
+#define BENCH_SLOT_NUM     32
+#define BENCH_MAX_THREAD   16
+#define RECLAIM_HEAP_SIZE  (64 * 1024)
+#define RECLAIM_SIZE       (8 * 1024)
+
+struct bench_ops {
+    const char *name;
+    void *(*alloc)(size_t size);
+    void (*release)(void *ptr);
+};
+
+struct bench_slot {
+    uint8_t *ptr;
+    uint32_t size;
+    uint32_t tag;
+};
+
+static uint8_t bench_heap[BENCH_HEAP_SIZE] __attribute__((aligned(64)));
+static uint8_t reclaim_heap[RECLAIM_HEAP_SIZE] __attribute__((aligned(64)));
+static struct mem_heap_s heap;
+static struct mem_cache_s cache;
+
+static uint32_t ops_per_thread = 200000;
+static int max_threads = 8;
+static const struct bench_ops *cur_ops;
+static struct meminfo peak_info;
+static pthread_mutex_t peak_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* the irq lock, and how long it was held, only touched with it held */
+static pthread_mutex_t irq_lock;
+static __thread int irq_depth;
+static uint64_t irq_enter_ns;
+static uint64_t irq_held_ns;
+static uint64_t irq_max_ns;
+static uint64_t irq_sections;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* one core with interrupts off runs nothing else, on the host that is one lock */
+uintptr_t bflb_irq_save(void)
+{
+    pthread_mutex_lock(&irq_lock);
+    if (irq_depth++ == 0) {
+        irq_enter_ns = now_ns();
+    }
+    return 0;
+}
+
+void bflb_irq_restore(uintptr_t flags)
+{
+    uint64_t held;
+
+    (void)flags;
+    if (--irq_depth == 0) {
+        held = now_ns() - irq_enter_ns;
+        irq_held_ns += held;
+        irq_sections++;
+        if (held > irq_max_ns) {
+            irq_max_ns = held;
+        }
+    }
+    pthread_mutex_unlock(&irq_lock);
+}
+
+static void *heap_alloc(size_t size)
+{
+    return bflb_malloc(&heap, size);
+}
+
+static void heap_release(void *ptr)
+{
+    bflb_free(&heap, ptr);
+}
+
+static void *cache_alloc(size_t size)
+{
+    return bflb_mem_cache_malloc(&cache, size);
+}
+
+static void cache_release(void *ptr)
+{
+    bflb_mem_cache_free(&cache, ptr);
+}
+
+static const struct bench_ops bench_ops_tab[] = {
+    { "tlsf", heap_alloc, heap_release },
+    { "cache", cache_alloc, cache_release },
+};
+
+/* a block handed out twice, or written past, has another owner's tag somewhere */
+static void slot_fill(struct bench_slot *slot)
+{
+    memset(slot->ptr, (uint8_t)slot->tag, slot->size);
+    memcpy(slot->ptr, &slot->tag, sizeof(slot->tag));
+}
+
+static int slot_check(const struct bench_slot *slot)
+{
+    uint32_t tag;
+
+    memcpy(&tag, slot->ptr, sizeof(tag));
+    if (tag != slot->tag) {
+        return 1;
+    }
+    for (uint32_t i = sizeof(tag); i < slot->size; i++) {
+        if (slot->ptr[i] != (uint8_t)slot->tag) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* the workload of examples/memheap_bench: 32~512 bytes over a few slots per task */
+static void *bench_thread(void *arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+    uint32_t seed = id * 2654435761u + 1;
+    struct bench_slot slot[BENCH_SLOT_NUM];
+    struct meminfo info;
+    uintptr_t errors = 0;
+
+    memset(slot, 0, sizeof(slot));
+
+    for (uint32_t i = 0; i < ops_per_thread; i++) {
+        seed = seed * 1103515245 + 12345;
+        int idx = (seed >> 16) % BENCH_SLOT_NUM;
+
+        if (slot[idx].ptr) {
+            errors += slot_check(&slot[idx]);
+            cur_ops->release(slot[idx].ptr);
+            slot[idx].ptr = NULL;
+        } else {
+            slot[idx].size = 32 + ((seed >> 8) % 481);
+            slot[idx].tag = (id << 24) | (i & 0xffffff);
+            slot[idx].ptr = cur_ops->alloc(slot[idx].size);
+            slot_fill(&slot[idx]);
+        }
+    }
+
+    bflb_mem_usage(&heap, &info);
+    pthread_mutex_lock(&peak_lock);
+    if (peak_info.max_free_size == 0 || info.max_free_size < peak_info.max_free_size) {
+        peak_info = info;
+    }
+    pthread_mutex_unlock(&peak_lock);
+
+    for (int i = 0; i < BENCH_SLOT_NUM; i++) {
+        if (slot[i].ptr) {
+            errors += slot_check(&slot[i]);
+            cur_ops->release(slot[i].ptr);
+        }
+    }
+    return (void *)errors;
+}
+
+static int bench_run(const struct bench_ops *ops, int threads, const struct meminfo *idle)
+{
+    pthread_t tid[BENCH_MAX_THREAD];
+    struct mem_cache_info cinfo;
+    struct meminfo after;
+    uintptr_t errors = 0;
+    void *ret;
+    double t;
+
+    cur_ops = ops;
+    memset(&peak_info, 0, sizeof(peak_info));
+    irq_held_ns = irq_max_ns = irq_sections = 0;
+
+    t = now_ns();
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&tid[i], NULL, bench_thread, (void *)(uintptr_t)i);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tid[i], &ret);
+        errors += (uintptr_t)ret;
+    }
+    t = (now_ns() - t) / 1e9;
+
+    bflb_mem_cache_usage(&cache, &cinfo);
+    bflb_mem_cache_flush(&cache);
+
+    /* everything is back, the heap is whole again and tlsf agrees */
+    bflb_mem_usage(&heap, &after);
+    if ((after.free_size != idle->free_size) || (after.free_node != idle->free_node) || tlsf_check(heap.priv)) {
+        errors++;
+    }
+
+    /* lock/op and lock/cs: ns with interrupts off per kmalloc/kfree and per critical section */
+    printf("%-5s %2d %8.2f %8.1f %8.1f %8llu %13d %6d", ops->name, threads, threads * ops_per_thread / t / 1e6,
+           (double)irq_held_ns / ((uint64_t)threads * ops_per_thread),
+           (double)irq_held_ns / (irq_sections ? irq_sections : 1), (unsigned long long)irq_max_ns,
+           peak_info.max_free_size, peak_info.free_node);
+    if (ops->alloc == cache_alloc) {
+        printf(" %5.1f%%", 100.0 * cinfo.hit / ((cinfo.hit + cinfo.miss) ? (cinfo.hit + cinfo.miss) : 1));
+    } else {
+        printf("       ");
+    }
+    printf("  %lu bad\n", (unsigned long)errors);
+    return errors ? -1 : 0;
+}
+
+/*
+ * a heap whose free memory all sits in the magazines: every class is parked
+ * full, the blocks were allocated first so they merge into one free block
+ * when flushed, and the rest of the heap is taken
+ */
+static void *reclaim_setup(struct mem_heap_s *rheap, struct mem_cache_s *rcache)
+{
+    void *parked[MEM_CACHE_NR_CLASSES * CONFIG_MEM_CACHE_DEPTH];
+    void *old;
+    int n = 0;
+
+    bflb_mem_init(rheap, reclaim_heap, sizeof(reclaim_heap));
+    bflb_mem_cache_init(rcache, rheap);
+
+    for (int i = 0; i < MEM_CACHE_NR_CLASSES; i++) {
+        for (int j = 0; j < CONFIG_MEM_CACHE_DEPTH; j++) {
+            parked[n++] = bflb_mem_cache_malloc(rcache, (size_t)32 << i);
+        }
+    }
+    old = bflb_try_malloc(rheap, 64);
+    memset(old, 0x5a, 64);
+
+    for (size_t size = RECLAIM_HEAP_SIZE; size >= 8; size >>= 1) {
+        while (bflb_try_malloc(rheap, size) != NULL) {
+        }
+    }
+
+    while (n > 0) {
+        bflb_mem_cache_free(rcache, parked[--n]);
+    }
+    return old;
+}
+
+static void reclaim_timeout(int sig)
+{
+    /* the main thread spins in TLSF_MALLOC_ASSERT, out of stdio */
+    (void)sig;
+    printf("\nreclaim: allocation failed with blocks still parked, FAIL\n");
+    fflush(stdout);
+    _exit(1);
+}
+
+/* every allocation on a cached heap flushes the magazines before it fails */
+static int reclaim_check(void)
+{
+    static const char *name[] = { "cache", "malloc", "calloc", "realloc", "align" };
+    struct mem_heap_s rheap;
+    struct mem_cache_s rcache;
+    struct mem_cache_info cinfo;
+    uint8_t *old;
+    uint8_t *ptr = NULL;
+    int bad = 0;
+
+    signal(SIGALRM, reclaim_timeout);
+    printf("reclaim %d bytes:", RECLAIM_SIZE);
+    for (int i = 0; i < (int)(sizeof(name) / sizeof(name[0])); i++) {
+        old = reclaim_setup(&rheap, &rcache);
+        if (bflb_try_malloc(&rheap, RECLAIM_SIZE) != NULL) {
+            printf(" setup left room, FAIL\n");
+            return 1;
+        }
+
+        alarm(5);
+        switch (i) {
+            case 0:
+                ptr = bflb_mem_cache_malloc(&rcache, RECLAIM_SIZE);
+                break;
+            case 1:
+                ptr = bflb_malloc(&rheap, RECLAIM_SIZE);
+                break;
+            case 2:
+                ptr = bflb_calloc(&rheap, RECLAIM_SIZE / 8, 8);
+                break;
+            case 3:
+                ptr = bflb_realloc(&rheap, old, RECLAIM_SIZE);
+                break;
+            default:
+                ptr = bflb_malloc_align(&rheap, 256, RECLAIM_SIZE);
+                break;
+        }
+        alarm(0);
+
+        bflb_mem_cache_usage(&rcache, &cinfo);
+        if ((ptr == NULL) || cinfo.cached_node || ((i == 3) && (ptr[63] != 0x5a))) {
+            bad = 1;
+        }
+        printf(" %s %s", name[i], ptr ? "ok" : "NULL");
+    }
+    printf("%s\n", bad ? ", FAIL" : "");
+    return bad;
+}
+
+static void usage(void)
+{
+    printf("usage: mem_bench [-o ops per thread] [-t max threads]\n");
+}
+
+int main(int argc, char **argv)
+{
+    pthread_mutexattr_t attr;
+    struct meminfo idle;
+    int opt, bad = 0;
+
+    while ((opt = getopt(argc, argv, "o:t:h")) != -1) {
+        switch (opt) {
+            case 'o':
+                ops_per_thread = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                max_threads = atoi(optarg);
+                break;
+            default:
+                usage();
+                return 1;
+        }
+    }
+    if ((max_threads < 1) || (max_threads > BENCH_MAX_THREAD)) {
+        usage();
+        return 1;
+    }
+
+    /* the irq save/restore of the SDK nests */
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&irq_lock, &attr);
+
+    bflb_mem_init(&heap, bench_heap, sizeof(bench_heap));
+    bflb_mem_cache_init(&cache, &heap);
+    bflb_mem_usage(&heap, &idle);
+
+    bad |= reclaim_check();
+
+    printf("%ld cpus, %d KB heap, %d ops per thread, magazines of %d\n", sysconf(_SC_NPROCESSORS_ONLN),
+           BENCH_HEAP_SIZE / 1024, ops_per_thread, CONFIG_MEM_CACHE_DEPTH);
+    printf("path  th   Mops/s  lock/op  lock/cs   max cs  min max free  nodes   hit\n");
+    for (int th = 1; th <= max_threads; th *= 2) {
+        for (int i = 0; i < (int)(sizeof(bench_ops_tab) / sizeof(bench_ops_tab[0])); i++) {
+            bad |= bench_run(&bench_ops_tab[i], th, &idle);
+        }
+    }
+
+    printf(bad ? "FAIL\n" : "all ok\n");
+    return bad ? 1 : 0;
+}
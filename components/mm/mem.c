@@ -27,12 +27,28 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+#ifdef CONFIG_MEM_TRACE
+#define MEM_TRACE_ALLOC(heap, ptr, size) \
+    bflb_mem_trace_record(heap, MEM_TRACE_OP_MALLOC, ptr, size, __builtin_return_address(0))
+#define MEM_TRACE_FREE(heap, ptr) \
+    bflb_mem_trace_record(heap, MEM_TRACE_OP_FREE, ptr, bflb_malloc_usable_size(heap, ptr), __builtin_return_address(0))
+#define MEM_TRACE_FREE_SIZE(heap, ptr, size) \
+    bflb_mem_trace_record(heap, MEM_TRACE_OP_FREE, ptr, size, __builtin_return_address(0))
+#else
+#define MEM_TRACE_ALLOC(heap, ptr, size)
+#define MEM_TRACE_FREE(heap, ptr)
+#define MEM_TRACE_FREE_SIZE(heap, ptr, size)
+#endif
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
 
 struct mem_heap_s g_kmemheap;
 struct mem_heap_s g_pmemheap;
+#ifdef CONFIG_MEM_CACHE
+struct mem_cache_s g_kmemcache;
+#endif
 
 /****************************************************************************
  * Private Function Prototypes
@@ -57,6 +73,9 @@ void kmem_init(void *heapstart, size_t heapsize)
     MEM_LOG("Heap: start=%p size=%u\r\n", heapstart, heapsize);
 
     bflb_mem_init(KMEM_HEAP, heapstart, heapsize);
+#ifdef CONFIG_MEM_CACHE
+    bflb_mem_cache_init(&g_kmemcache, KMEM_HEAP);
+#endif
 }
 
 /****************************************************************************
@@ -77,7 +96,16 @@ void *kmalloc(size_t size)
 {
     MEM_LOG("kmalloc %d\r\n", size);
 
-    return bflb_malloc(KMEM_HEAP, size);
+    void *ptr;
+
+#ifdef CONFIG_MEM_CACHE
+    ptr = bflb_mem_cache_malloc(&g_kmemcache, size);
+#else
+    ptr = bflb_malloc(KMEM_HEAP, size);
+#endif
+    MEM_TRACE_ALLOC(KMEM_HEAP, ptr, size);
+
+    return ptr;
 }
 
 void *pvPortMallocStack(size_t xSize)
@@ -98,7 +126,12 @@ void kfree(void *addr)
 {
     MEM_LOG("kfree %p\r\n", addr);
 
+    MEM_TRACE_FREE(KMEM_HEAP, addr);
+#ifdef CONFIG_MEM_CACHE
+    bflb_mem_cache_free(&g_kmemcache, addr);
+#else
     bflb_free(KMEM_HEAP, addr);
+#endif
 }
 
 void vPortFreeStack(void *pv)
@@ -122,7 +155,11 @@ void vPortFreeStack(void *pv)
 
 void *kcalloc(size_t size, size_t len)
 {
-    return bflb_calloc(KMEM_HEAP, size, len);
+    void *ptr = bflb_calloc(KMEM_HEAP, size, len);
+
+    MEM_TRACE_ALLOC(KMEM_HEAP, ptr, size * len);
+
+    return ptr;
 }
 
 /****************************************************************************
@@ -160,7 +197,11 @@ void *malloc(size_t size)
 {
     MEM_LOG("malloc %d\r\n", size);
 
-    return bflb_malloc(PMEM_HEAP, size);
+    void *ptr = bflb_malloc(PMEM_HEAP, size);
+
+    MEM_TRACE_ALLOC(PMEM_HEAP, ptr, size);
+
+    return ptr;
 }
 
 /****************************************************************************
@@ -180,7 +221,20 @@ void *malloc(size_t size)
 
 void *realloc(void *old, size_t newlen)
 {
-    return bflb_realloc(PMEM_HEAP, old, newlen);
+    void *ptr;
+#ifdef CONFIG_MEM_TRACE
+    size_t oldlen = old ? bflb_malloc_usable_size(PMEM_HEAP, old) : 0;
+#endif
+
+    ptr = bflb_realloc(PMEM_HEAP, old, newlen);
+
+    /* on failure the old block stays live, newlen 0 frees it */
+    if (ptr != NULL || newlen == 0) {
+        MEM_TRACE_FREE_SIZE(PMEM_HEAP, old, oldlen);
+        MEM_TRACE_ALLOC(PMEM_HEAP, ptr, newlen);
+    }
+
+    return ptr;
 }
 
 /****************************************************************************
@@ -199,7 +253,11 @@ void *realloc(void *old, size_t newlen)
 
 void *calloc(size_t size, size_t len)
 {
-    return bflb_calloc(PMEM_HEAP, size, len);
+    void *ptr = bflb_calloc(PMEM_HEAP, size, len);
+
+    MEM_TRACE_ALLOC(PMEM_HEAP, ptr, size * len);
+
+    return ptr;
 }
 
 /****************************************************************************
@@ -217,7 +275,11 @@ void *calloc(size_t size, size_t len)
 
 void *memalign(size_t align, size_t size)
 {
-    return bflb_malloc_align(PMEM_HEAP, align, size);
+    void *ptr = bflb_malloc_align(PMEM_HEAP, align, size);
+
+    MEM_TRACE_ALLOC(PMEM_HEAP, ptr, size);
+
+    return ptr;
 }
 
 /****************************************************************************
@@ -233,6 +295,7 @@ void free(void *addr)
 {
     MEM_LOG("free %p\r\n", addr);
 
+    MEM_TRACE_FREE(PMEM_HEAP, addr);
     bflb_free(PMEM_HEAP, addr);
 }
 
@@ -287,6 +350,15 @@ int cmd_free(int argc, char **argv)
 
     free(mem);
 
+#ifdef CONFIG_MEM_CACHE
+    struct mem_cache_info cinfo;
+
+    bflb_mem_cache_usage(&g_kmemcache, &cinfo);
+    printf("cache: hit %u miss %u cached %u bytes in %u blocks\r\n",
+           (unsigned int)cinfo.hit, (unsigned int)cinfo.miss,
+           (unsigned int)cinfo.cached_size, (unsigned int)cinfo.cached_node);
+#endif
+
 #if defined(CONFIG_PSRAM) && defined(BL616) // only for bl618
     mem = malloc(64);
     bflb_mem_usage(PMEM_HEAP, &info);
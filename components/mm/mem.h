@@ -47,6 +47,37 @@
 
 #define MEM_IS_VALID(heap) ((heap) != NULL && (heap)->mem_impl != NULL)
 
+#ifndef CONFIG_MEM_CACHE_DEPTH
+#define CONFIG_MEM_CACHE_DEPTH 16
+#endif
+
+/* size classes served by the small-object cache: 32, 64, ... 512 bytes */
+#define MEM_CACHE_MIN_SHIFT  5
+#define MEM_CACHE_NR_CLASSES 5
+#define MEM_CACHE_MAX_SIZE   (1 << (MEM_CACHE_MIN_SHIFT + MEM_CACHE_NR_CLASSES - 1))
+
+#ifndef CONFIG_MEM_TRACE_DEPTH
+#define CONFIG_MEM_TRACE_DEPTH 512
+#endif
+
+#ifndef CONFIG_MEM_TRACE_SAMPLE_INTERVAL
+#define CONFIG_MEM_TRACE_SAMPLE_INTERVAL 64
+#endif
+
+#define MEM_TRACE_MAGIC       0x4352544d /* "MTRC" */
+#define MEM_TRACE_VERSION     1
+
+#define MEM_TRACE_OP_MALLOC   0
+#define MEM_TRACE_OP_FREE     1
+#define MEM_TRACE_OP_SAMPLE   2
+
+/* info word: op[31:30] heap[29] size[28:0] */
+#define MEM_TRACE_INFO(op, heap, size) \
+    (((uint32_t)(op) << 30) | ((uint32_t)(heap) << 29) | ((uint32_t)(size)&0x1fffffff))
+
+/* allocation histogram buckets: <=16, <=32, ... <=64K, larger */
+#define MEM_TRACE_HIST_NUM    14
+
 #define KMEM_HEAP          &g_kmemheap
 #if defined(CONFIG_PSRAM) && defined(BL616) // only for bl618
 #define PMEM_HEAP &g_pmemheap
@@ -58,10 +89,49 @@
  * Public Types
  ****************************************************************************/
 
+struct mem_cache_s;
+
 struct mem_heap_s {
     void *priv;
     void *heapstart;
     size_t heapsize;
+    struct mem_cache_s *cache; /* small-object cache in front, flushed before an allocation fails */
+};
+
+struct mem_cache_magazine_s {
+    uint16_t count;
+    uint16_t high_water;
+    uint32_t hit;
+    uint32_t miss;
+    void *slot[CONFIG_MEM_CACHE_DEPTH];
+};
+
+struct mem_cache_s {
+    struct mem_heap_s *heap;
+    struct mem_cache_magazine_s mag[MEM_CACHE_NR_CLASSES];
+};
+
+struct mem_cache_info {
+    uint32_t hit;         /* allocations served from the magazines */
+    uint32_t miss;        /* allocations that went down to the heap */
+    uint32_t cached_node; /* blocks currently parked in the magazines */
+    uint32_t cached_size; /* bytes currently parked in the magazines */
+};
+
+struct mem_trace_record {
+    uint32_t time;   /* bflb_mtimer_get_time_us(), low 32 bits */
+    uint32_t caller; /* return address of the alloc/free call, free_size for samples */
+    uint32_t ptr;    /* block address, free_node for samples */
+    uint32_t info;   /* MEM_TRACE_INFO(), size is max_free_size for samples */
+};
+
+struct mem_trace_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t record_num; /* records following the header, oldest first */
+    uint32_t dropped;    /* records overwritten since the last reset */
+    uint32_t hist[MEM_TRACE_HIST_NUM];
 };
 
 struct meminfo {
@@ -90,6 +160,9 @@ extern "C" {
 
 EXTERN struct mem_heap_s g_kmemheap;
 EXTERN struct mem_heap_s g_pmemheap;
+#ifdef CONFIG_MEM_CACHE
+EXTERN struct mem_cache_s g_kmemcache;
+#endif
 
 /****************************************************************************
  * Public Function Prototypes
@@ -120,6 +193,34 @@ void *bflb_malloc_align(struct mem_heap_s *heap, size_t align, size_t size);
 
 void bflb_mem_usage(struct mem_heap_s *heap, struct meminfo *info);
 
+void *bflb_try_malloc(struct mem_heap_s *heap, size_t nbytes);
+
+size_t bflb_malloc_usable_size(struct mem_heap_s *heap, void *ptr);
+
+/* allocation tracing */
+
+void bflb_mem_trace_enable(int enable);
+
+void bflb_mem_trace_reset(void);
+
+void bflb_mem_trace_record(struct mem_heap_s *heap, int op, void *ptr, size_t size, void *caller);
+
+void bflb_mem_trace_export(void (*output)(const void *data, size_t len));
+
+void bflb_mem_trace_dump(void);
+
+/* small-object cache layered over a heap */
+
+void bflb_mem_cache_init(struct mem_cache_s *cache, struct mem_heap_s *heap);
+
+void *bflb_mem_cache_malloc(struct mem_cache_s *cache, size_t nbytes);
+
+void bflb_mem_cache_free(struct mem_cache_s *cache, void *ptr);
+
+void bflb_mem_cache_flush(struct mem_cache_s *cache);
+
+void bflb_mem_cache_usage(struct mem_cache_s *cache, struct mem_cache_info *info);
+
 #undef EXTERN
 #ifdef __cplusplus
 }
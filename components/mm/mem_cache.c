@@ -0,0 +1,262 @@
+/****************************************************************************
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include "mem.h"
+#include "bflb_irq.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define MEM_CACHE_CLASS_SIZE(idx) ((size_t)1 << (MEM_CACHE_MIN_SHIFT + (idx)))
+
+/* blocks handed out by bflb_malloc are 32 byte aligned, keep it that way */
+#define MEM_CACHE_ALIGN_MASK      (MEM_CACHE_CLASS_SIZE(0) - 1)
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: mem_cache_alloc_class
+ *
+ * Description:
+ *   Get the smallest size class able to hold nbytes, -1 if too large.
+ *
+ ****************************************************************************/
+
+static int mem_cache_alloc_class(size_t nbytes)
+{
+    for (int i = 0; i < MEM_CACHE_NR_CLASSES; i++) {
+        if (nbytes <= MEM_CACHE_CLASS_SIZE(i)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/****************************************************************************
+ * Name: mem_cache_free_class
+ *
+ * Description:
+ *   Get the largest size class a block of usable bytes can serve, -1 if the
+ *   block is too small or would waste more than half of itself.
+ *
+ ****************************************************************************/
+
+static int mem_cache_free_class(size_t usable)
+{
+    if (usable >= (MEM_CACHE_MAX_SIZE << 1)) {
+        return -1;
+    }
+
+    for (int i = MEM_CACHE_NR_CLASSES - 1; i >= 0; i--) {
+        if (usable >= MEM_CACHE_CLASS_SIZE(i)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/****************************************************************************
+ * Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: bflb_mem_cache_init
+ *
+ * Description:
+ *   Attach an empty small-object cache to a heap. Every allocation on the
+ *   heap flushes it and retries before it fails.
+ *
+ ****************************************************************************/
+
+void bflb_mem_cache_init(struct mem_cache_s *cache, struct mem_heap_s *heap)
+{
+    memset(cache, 0, sizeof(struct mem_cache_s));
+    cache->heap = heap;
+    heap->cache = cache;
+}
+
+/****************************************************************************
+ * Name: bflb_mem_cache_malloc
+ *
+ * Description:
+ *   Allocate memory, serving small requests from the per-class magazines.
+ *   The critical section only covers a magazine pop, the tlsf search is
+ *   done on a miss only. Large requests go straight to the heap.
+ *
+ * Returned Value:
+ *   The address of the allocated memory (NULL on failure to allocate)
+ *
+ ****************************************************************************/
+
+void *bflb_mem_cache_malloc(struct mem_cache_s *cache, size_t nbytes)
+{
+    struct mem_cache_magazine_s *mag;
+    void *ret = NULL;
+    uintptr_t flag;
+    int idx;
+
+    idx = mem_cache_alloc_class(nbytes);
+    if (idx < 0) {
+        return bflb_malloc(cache->heap, nbytes);
+    }
+
+    mag = &cache->mag[idx];
+
+    flag = bflb_irq_save();
+    if (mag->count > 0) {
+        ret = mag->slot[--mag->count];
+        mag->hit++;
+    } else {
+        mag->miss++;
+    }
+    bflb_irq_restore(flag);
+
+    if (ret != NULL) {
+        return ret;
+    }
+
+    /* round up so the block can be recycled for the whole class,
+     * bflb_malloc flushes the parked blocks before failing for real */
+    ret = bflb_try_malloc(cache->heap, MEM_CACHE_CLASS_SIZE(idx));
+    if (ret == NULL) {
+        ret = bflb_malloc(cache->heap, nbytes);
+    }
+
+    return ret;
+}
+
+/****************************************************************************
+ * Name: bflb_mem_cache_free
+ *
+ * Description:
+ *   Park a small block in its class magazine, or return it to the heap when
+ *   the magazine is full or the block is not cacheable.
+ *
+ ****************************************************************************/
+
+void bflb_mem_cache_free(struct mem_cache_s *cache, void *ptr)
+{
+    struct mem_cache_magazine_s *mag;
+    uintptr_t flag;
+    int idx;
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    if (((uintptr_t)ptr & MEM_CACHE_ALIGN_MASK) != 0) {
+        bflb_free(cache->heap, ptr);
+        return;
+    }
+
+    idx = mem_cache_free_class(bflb_malloc_usable_size(cache->heap, ptr));
+    if (idx < 0) {
+        bflb_free(cache->heap, ptr);
+        return;
+    }
+
+    mag = &cache->mag[idx];
+
+    flag = bflb_irq_save();
+    if (mag->count < CONFIG_MEM_CACHE_DEPTH) {
+        mag->slot[mag->count++] = ptr;
+        if (mag->count > mag->high_water) {
+            mag->high_water = mag->count;
+        }
+        ptr = NULL;
+    }
+    bflb_irq_restore(flag);
+
+    if (ptr != NULL) {
+        bflb_free(cache->heap, ptr);
+    }
+}
+
+/****************************************************************************
+ * Name: bflb_mem_cache_flush
+ *
+ * Description:
+ *   Return every parked block to the heap.
+ *
+ ****************************************************************************/
+
+void bflb_mem_cache_flush(struct mem_cache_s *cache)
+{
+    struct mem_cache_magazine_s *mag;
+    void *ptr;
+    uintptr_t flag;
+
+    for (int i = 0; i < MEM_CACHE_NR_CLASSES; i++) {
+        mag = &cache->mag[i];
+
+        while (1) {
+            ptr = NULL;
+
+            flag = bflb_irq_save();
+            if (mag->count > 0) {
+                ptr = mag->slot[--mag->count];
+            }
+            bflb_irq_restore(flag);
+
+            if (ptr == NULL) {
+                break;
+            }
+
+            bflb_free(cache->heap, ptr);
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: bflb_mem_cache_usage
+ *
+ * Description:
+ *   Get hit/miss counters and the memory currently held by the cache.
+ *
+ ****************************************************************************/
+
+void bflb_mem_cache_usage(struct mem_cache_s *cache, struct mem_cache_info *info)
+{
+    struct mem_cache_magazine_s *mag;
+    uintptr_t flag;
+
+    memset(info, 0, sizeof(struct mem_cache_info));
+
+    flag = bflb_irq_save();
+    for (int i = 0; i < MEM_CACHE_NR_CLASSES; i++) {
+        mag = &cache->mag[i];
+
+        info->hit += mag->hit;
+        info->miss += mag->miss;
+        info->cached_node += mag->count;
+        for (int j = 0; j < mag->count; j++) {
+            info->cached_size += bflb_malloc_usable_size(cache->heap, mag->slot[j]);
+        }
+    }
+    bflb_irq_restore(flag);
+}
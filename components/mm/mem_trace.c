@@ -0,0 +1,274 @@
+/****************************************************************************
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include "mem.h"
+#include "bflb_irq.h"
+#include "bflb_mtimer.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* hex bytes per line of bflb_mem_trace_dump, decoded by scripts/mem_trace.py */
+#define MEM_TRACE_DUMP_LINE 32
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct mem_trace_record g_mem_trace_ring[CONFIG_MEM_TRACE_DEPTH];
+static uint32_t g_mem_trace_hist[MEM_TRACE_HIST_NUM];
+static uint32_t g_mem_trace_head;  /* next slot to write */
+static uint32_t g_mem_trace_total; /* records written since reset */
+static uint32_t g_mem_trace_event;
+static volatile int g_mem_trace_enable = 1;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static int mem_trace_hist_index(size_t size)
+{
+    int idx = 0;
+
+    while (idx < MEM_TRACE_HIST_NUM - 1 && size > ((size_t)16 << idx)) {
+        idx++;
+    }
+
+    return idx;
+}
+
+static void mem_trace_put(uint32_t caller, uint32_t ptr, uint32_t info)
+{
+    struct mem_trace_record *rec;
+    uint32_t time = (uint32_t)bflb_mtimer_get_time_us();
+    uintptr_t flag;
+
+    flag = bflb_irq_save();
+
+    rec = &g_mem_trace_ring[g_mem_trace_head];
+    rec->time = time;
+    rec->caller = caller;
+    rec->ptr = ptr;
+    rec->info = info;
+
+    g_mem_trace_head = (g_mem_trace_head + 1) % CONFIG_MEM_TRACE_DEPTH;
+    g_mem_trace_total++;
+
+    bflb_irq_restore(flag);
+}
+
+/****************************************************************************
+ * Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: bflb_mem_trace_enable
+ *
+ * Description:
+ *   Start or pause recording, the ring content is kept.
+ *
+ ****************************************************************************/
+
+void bflb_mem_trace_enable(int enable)
+{
+    g_mem_trace_enable = enable;
+}
+
+/****************************************************************************
+ * Name: bflb_mem_trace_reset
+ *
+ * Description:
+ *   Drop all records and clear the size histogram.
+ *
+ ****************************************************************************/
+
+void bflb_mem_trace_reset(void)
+{
+    uintptr_t flag;
+
+    flag = bflb_irq_save();
+    g_mem_trace_head = 0;
+    g_mem_trace_total = 0;
+    g_mem_trace_event = 0;
+    memset(g_mem_trace_hist, 0, sizeof(g_mem_trace_hist));
+    bflb_irq_restore(flag);
+}
+
+/****************************************************************************
+ * Name: bflb_mem_trace_record
+ *
+ * Description:
+ *   Record one allocation (op MEM_TRACE_OP_MALLOC) or release
+ *   (MEM_TRACE_OP_FREE). Every CONFIG_MEM_TRACE_SAMPLE_INTERVAL allocations
+ *   a heap usage sample is appended as well, which gives the free size and
+ *   largest-free-block timeline.
+ *
+ ****************************************************************************/
+
+void bflb_mem_trace_record(struct mem_heap_s *heap, int op, void *ptr, size_t size, void *caller)
+{
+    struct meminfo info;
+    int heap_id = (heap == &g_kmemheap) ? 0 : 1;
+    int sample = 0;
+    uintptr_t flag;
+
+    if (!g_mem_trace_enable || ptr == NULL) {
+        return;
+    }
+
+    mem_trace_put((uint32_t)(uintptr_t)caller, (uint32_t)(uintptr_t)ptr, MEM_TRACE_INFO(op, heap_id, size));
+
+    if (op != MEM_TRACE_OP_MALLOC) {
+        return;
+    }
+
+    flag = bflb_irq_save();
+    g_mem_trace_hist[mem_trace_hist_index(size)]++;
+    if (++g_mem_trace_event >= CONFIG_MEM_TRACE_SAMPLE_INTERVAL) {
+        g_mem_trace_event = 0;
+        sample = 1;
+    }
+    bflb_irq_restore(flag);
+
+    if (sample) {
+        bflb_mem_usage(heap, &info);
+        mem_trace_put(info.free_size, info.free_node, MEM_TRACE_INFO(MEM_TRACE_OP_SAMPLE, heap_id, info.max_free_size));
+    }
+}
+
+/****************************************************************************
+ * Name: bflb_mem_trace_export
+ *
+ * Description:
+ *   Stream a struct mem_trace_header followed by the records, oldest first,
+ *   to output. Recording is paused meanwhile so output may allocate.
+ *
+ ****************************************************************************/
+
+void bflb_mem_trace_export(void (*output)(const void *data, size_t len))
+{
+    struct mem_trace_header header;
+    uint32_t start;
+    int enable = g_mem_trace_enable;
+    uintptr_t flag;
+
+    g_mem_trace_enable = 0;
+
+    flag = bflb_irq_save();
+    header.magic = MEM_TRACE_MAGIC;
+    header.version = MEM_TRACE_VERSION;
+    header.record_size = sizeof(struct mem_trace_record);
+    if (g_mem_trace_total > CONFIG_MEM_TRACE_DEPTH) {
+        header.record_num = CONFIG_MEM_TRACE_DEPTH;
+        header.dropped = g_mem_trace_total - CONFIG_MEM_TRACE_DEPTH;
+        start = g_mem_trace_head;
+    } else {
+        header.record_num = g_mem_trace_total;
+        header.dropped = 0;
+        start = 0;
+    }
+    memcpy(header.hist, g_mem_trace_hist, sizeof(header.hist));
+    bflb_irq_restore(flag);
+
+    output(&header, sizeof(header));
+
+    for (uint32_t i = 0; i < header.record_num; i++) {
+        output(&g_mem_trace_ring[(start + i) % CONFIG_MEM_TRACE_DEPTH], sizeof(struct mem_trace_record));
+    }
+
+    g_mem_trace_enable = enable;
+}
+
+static uint8_t g_mem_trace_line[MEM_TRACE_DUMP_LINE];
+static size_t g_mem_trace_line_len;
+
+static void mem_trace_dump_flush(void)
+{
+    if (g_mem_trace_line_len == 0) {
+        return;
+    }
+
+    printf("MTRC:");
+    for (size_t i = 0; i < g_mem_trace_line_len; i++) {
+        printf("%02x", g_mem_trace_line[i]);
+    }
+    printf("\r\n");
+
+    g_mem_trace_line_len = 0;
+}
+
+static void mem_trace_dump_output(const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    while (len--) {
+        g_mem_trace_line[g_mem_trace_line_len++] = *p++;
+        if (g_mem_trace_line_len == MEM_TRACE_DUMP_LINE) {
+            mem_trace_dump_flush();
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: bflb_mem_trace_dump
+ *
+ * Description:
+ *   Print the trace as "MTRC:<hex>" lines on the console.
+ *
+ ****************************************************************************/
+
+void bflb_mem_trace_dump(void)
+{
+    g_mem_trace_line_len = 0;
+    bflb_mem_trace_export(mem_trace_dump_output);
+    mem_trace_dump_flush();
+}
+
+#ifdef CONFIG_SHELL
+#include <shell.h>
+
+int cmd_memtrace(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("usage: memtrace <dump|reset|on|off>\r\n");
+        return -1;
+    }
+
+    if (strcmp(argv[1], "dump") == 0) {
+        bflb_mem_trace_dump();
+    } else if (strcmp(argv[1], "reset") == 0) {
+        bflb_mem_trace_reset();
+    } else if (strcmp(argv[1], "on") == 0) {
+        bflb_mem_trace_enable(1);
+    } else if (strcmp(argv[1], "off") == 0) {
+        bflb_mem_trace_enable(0);
+    } else {
+        printf("unknown option %s\r\n", argv[1]);
+        return -1;
+    }
+
+    return 0;
+}
+SHELL_CMD_EXPORT_ALIAS(cmd_memtrace, memtrace, heap allocation trace);
+#endif
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Decode the heap allocation trace printed by the `memtrace dump` shell command
+(CONFIG_MEM_TRACE), and report which call sites fragment or leak the heap.
+
+usage: mem_trace.py console.log [--elf app.elf] [--addr2line riscv64-unknown-elf-addr2line]
+"""
+
+import argparse
+import struct
+import subprocess
+import sys
+
+MEM_TRACE_MAGIC = 0x4352544d
+MEM_TRACE_HIST_NUM = 14
+HEADER_FMT = "<IHHII%dI" % MEM_TRACE_HIST_NUM
+RECORD_FMT = "<IIII"
+
+OP_MALLOC = 0
+OP_FREE = 1
+OP_SAMPLE = 2
+HEAP_NAME = ("kmem", "pmem")
+
+
+def load_blob(path):
+    data = bytearray()
+    with open(path, "r", errors="ignore") as f:
+        for line in f:
+            pos = line.find("MTRC:")
+            if pos < 0:
+                continue
+            data += bytes.fromhex(line[pos + 5:].strip())
+    return bytes(data)
+
+
+def parse(blob):
+    hsize = struct.calcsize(HEADER_FMT)
+    if len(blob) < hsize:
+        raise ValueError("no trace found")
+    fields = struct.unpack_from(HEADER_FMT, blob, 0)
+    magic, version, record_size, record_num, dropped = fields[:5]
+    hist = fields[5:]
+    if magic != MEM_TRACE_MAGIC:
+        raise ValueError("bad magic 0x%08x" % magic)
+    records = []
+    offset = hsize
+    for _ in range(record_num):
+        if offset + record_size > len(blob):
+            break
+        time, caller, ptr, info = struct.unpack_from(RECORD_FMT, blob, offset)
+        records.append((time, caller, ptr, info >> 30, (info >> 29) & 1, info & 0x1fffffff))
+        offset += record_size
+    return version, dropped, hist, records
+
+
+def symbolize(addrs, elf, addr2line):
+    names = {}
+    if not elf or not addrs:
+        return names
+    cmd = [addr2line, "-f", "-C", "-e", elf] + ["0x%x" % a for a in addrs]
+    try:
+        out = subprocess.check_output(cmd, universal_newlines=True).splitlines()
+    except (OSError, subprocess.CalledProcessError):
+        return names
+    for i, addr in enumerate(addrs):
+        names[addr] = "%s %s" % (out[2 * i], out[2 * i + 1].split("/")[-1])
+    return names
+
+
+def main():
+    parser = argparse.ArgumentParser(description="bouffalo heap trace decoder")
+    parser.add_argument("log", help="console capture containing MTRC: lines")
+    parser.add_argument("--elf", help="firmware elf used to resolve caller addresses")
+    parser.add_argument("--addr2line", default="riscv64-unknown-elf-addr2line")
+    parser.add_argument("--top", type=int, default=20)
+    args = parser.parse_args()
+
+    version, dropped, hist, records = parse(load_blob(args.log))
+    print("trace v%d: %d records, %d dropped" % (version, len(records), dropped))
+
+    print("\nallocation size histogram")
+    for i, count in enumerate(hist):
+        if count == 0:
+            continue
+        if i == MEM_TRACE_HIST_NUM - 1:
+            label = "> %d" % (16 << (i - 1))
+        else:
+            label = "<= %d" % (16 << i)
+        print("  %-10s %d" % (label, count))
+
+    print("\nheap timeline (time_us heap free free_node max_free_block)")
+    for time, caller, ptr, op, heap, size in records:
+        if op == OP_SAMPLE:
+            print("  %-10u %s %-8u %-6u %u" % (time, HEAP_NAME[heap], caller, ptr, size))
+
+    # pair mallocs with frees, blocks still live at the end of the trace are
+    # what pins the heap into fragments (or leaks)
+    live = {}
+    sites = {}
+    for time, caller, ptr, op, heap, size in records:
+        if op == OP_MALLOC:
+            live[(heap, ptr)] = (caller, size, time)
+            site = sites.setdefault(caller, [0, 0, 0, 0])
+            site[0] += 1
+            site[1] += size
+        elif op == OP_FREE:
+            live.pop((heap, ptr), None)
+    end = records[-1][0] if records else 0
+    for caller, size, time in live.values():
+        site = sites.setdefault(caller, [0, 0, 0, 0])
+        site[2] += 1
+        site[3] += size
+
+    names = symbolize(sorted(sites), args.elf, args.addr2line)
+
+    print("\ncall sites by live blocks (count, bytes) at the end of the trace")
+    print("  %-10s %-8s %-10s %-6s %-8s %s" % ("caller", "allocs", "bytes", "live", "livebyte", "symbol"))
+    ranked = sorted(sites.items(), key=lambda kv: (kv[1][2], kv[1][3]), reverse=True)
+    for caller, (count, total, nlive, blive) in ranked[:args.top]:
+        print("  0x%08x %-8d %-10d %-6d %-8d %s" % (caller, count, total, nlive, blive, names.get(caller, "")))
+
+    oldest = sorted(live.items(), key=lambda kv: kv[1][2])[:args.top]
+    if oldest:
+        print("\noldest live blocks (possible leaks)")
+        for (heap, ptr), (caller, size, time) in oldest:
+            print("  %s 0x%08x %-6d age %-10u 0x%08x %s" % (HEAP_NAME[heap], ptr, size, (end - time) & 0xffffffff,
+                                                          caller, names.get(caller, "")))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
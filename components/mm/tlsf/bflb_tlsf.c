@@ -64,6 +64,27 @@ static void mem_tlfsinfo_walker(void *ptr, size_t size, int used,
     }
 }
 
+/****************************************************************************
+ * Name: mem_heap_reclaim
+ *
+ * Description:
+ *   Give the blocks parked in the heap's small-object cache back to it,
+ *   called with interrupts on before an allocation fails. Returns 0 if there
+ *   is no cache, and the allocation is not worth retrying.
+ *
+ ****************************************************************************/
+
+static int mem_heap_reclaim(struct mem_heap_s *heap)
+{
+#ifdef CONFIG_MEM_CACHE
+    if (heap->cache != NULL) {
+        bflb_mem_cache_flush(heap->cache);
+        return 1;
+    }
+#endif
+    return 0;
+}
+
 /****************************************************************************
  * Functions
  ****************************************************************************/
@@ -73,6 +94,7 @@ void bflb_mem_init(struct mem_heap_s *heap, void *heapstart, size_t heapsize)
     heap->heapstart = heapstart + tlsf_size();
     heap->heapsize = heapsize - tlsf_size();
     heap->priv = tlsf_create_with_pool(heapstart, heapsize);
+    heap->cache = NULL;
 }
 
 void *bflb_malloc(struct mem_heap_s *heap, size_t nbytes)
@@ -81,10 +103,29 @@ void *bflb_malloc(struct mem_heap_s *heap, size_t nbytes)
     uintptr_t flag;
 
     flag = bflb_irq_save();
-
     ret = tlsf_memalign(heap->priv, 32, nbytes);
+    bflb_irq_restore(flag);
+
+    if ((ret == NULL) && mem_heap_reclaim(heap)) {
+        flag = bflb_irq_save();
+        ret = tlsf_memalign(heap->priv, 32, nbytes);
+        bflb_irq_restore(flag);
+    }
+
     TLSF_MALLOC_ASSERT(heap, ret != NULL, nbytes);
 
+    return ret;
+}
+
+void *bflb_try_malloc(struct mem_heap_s *heap, size_t nbytes)
+{
+    void *ret = NULL;
+    uintptr_t flag;
+
+    flag = bflb_irq_save();
+
+    ret = tlsf_memalign(heap->priv, 32, nbytes);
+
     bflb_irq_restore(flag);
 
     return ret;
@@ -107,12 +148,18 @@ void *bflb_realloc(struct mem_heap_s *heap, void *ptr, size_t nbytes)
     uintptr_t flag;
 
     flag = bflb_irq_save();
-
     ret = tlsf_realloc(heap->priv, ptr, nbytes);
-    TLSF_MALLOC_ASSERT(heap, ret != NULL, nbytes);
-
     bflb_irq_restore(flag);
 
+    /* a failed realloc leaves ptr as it was, nbytes 0 frees it */
+    if ((ret == NULL) && (nbytes > 0) && mem_heap_reclaim(heap)) {
+        flag = bflb_irq_save();
+        ret = tlsf_realloc(heap->priv, ptr, nbytes);
+        bflb_irq_restore(flag);
+    }
+
+    TLSF_MALLOC_ASSERT(heap, ret != NULL, nbytes);
+
     return ret;
 }
 
@@ -122,18 +169,23 @@ void *bflb_calloc(struct mem_heap_s *heap, size_t count, size_t size)
     size_t total = count * size;
     uintptr_t flag;
 
+    if ((count == 0) || (size == 0) || (count > (SIZE_MAX / size))) {
+        return NULL;
+    }
+
     flag = bflb_irq_save();
+    ptr = tlsf_malloc(heap->priv, total);
+    bflb_irq_restore(flag);
 
-    if (count > 0 && size > 0) {
-        if (count <= (SIZE_MAX / size)) {
-            ptr = tlsf_malloc(heap->priv, total);
-            if (ptr) {
-                memset(ptr, 0, total);
-            }
-        }
+    if ((ptr == NULL) && mem_heap_reclaim(heap)) {
+        flag = bflb_irq_save();
+        ptr = tlsf_malloc(heap->priv, total);
+        bflb_irq_restore(flag);
     }
 
-    bflb_irq_restore(flag);
+    if (ptr) {
+        memset(ptr, 0, total);
+    }
 
     return ptr;
 }
@@ -144,15 +196,31 @@ void *bflb_malloc_align(struct mem_heap_s *heap, size_t align, size_t size)
     uintptr_t flag;
 
     flag = bflb_irq_save();
-
     ret = tlsf_memalign(heap->priv, align, size);
-    TLSF_MALLOC_ASSERT(heap, ret != NULL, size);
-
     bflb_irq_restore(flag);
 
+    if ((ret == NULL) && mem_heap_reclaim(heap)) {
+        flag = bflb_irq_save();
+        ret = tlsf_memalign(heap->priv, align, size);
+        bflb_irq_restore(flag);
+    }
+
+    TLSF_MALLOC_ASSERT(heap, ret != NULL, size);
+
     return ret;
 }
 
+size_t bflb_malloc_usable_size(struct mem_heap_s *heap, void *ptr)
+{
+    (void)heap;
+
+    if (ptr == NULL) {
+        return 0;
+    }
+
+    return tlsf_block_size(ptr);
+}
+
 void bflb_mem_usage(struct mem_heap_s *heap, struct meminfo *info)
 {
     uintptr_t flag;
@@ -0,0 +1,360 @@
+/**
+ * @file shell_bench.c
+ * @brief host bench of the shell: command dispatch, tab completion and buffered output
+ *
+ * Copyright (c) 2023 Bouffalolab team
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include "shell.h"
+
+#define BENCH_CAPTURE_SIZE (256 * 1024)
+
+static const char *bench_last;
+static int bench_argc;
+
+#define BENCH_CMD(n)                                   \
+    static int bench_fn_##n(int argc, char **argv)     \
+    {                                                  \
+        (void)argv;                                    \
+        bench_last = #n;                               \
+        bench_argc = argc;                             \
+        return 0;                                      \
+    }                                                  \
+    SHELL_CMD_EXPORT_ALIAS(bench_fn_##n, n, bench command)
+
+/* prefix_verb commands made by the Makefile, and two names that are prefixes of others */
+#include "bench_cmds.h"
+BENCH_CMD(net)
+BENCH_CMD(wifi)
+
+/* one SHELL_PRINTF longer than SHELL_OUTPUT_LINE_SIZE, as the commands in shell.c print */
+extern struct shell _shell;
+static struct shell *shell = &_shell;
+
+static int bench_long(int argc, char **argv)
+{
+    (void)argv;
+    bench_last = "long_line";
+    bench_argc = argc;
+    SHELL_PRINTF("%0600d\r\n", 7);
+    return 0;
+}
+SHELL_CMD_EXPORT_ALIAS(bench_long, long_line, bench command);
+
+/* the sdk linker scripts provide these, there are no variables here */
+const int __vsymtab_start = 0;
+const int __vsymtab_end = 0;
+extern const struct shell_syscall __start_FSymTab[];
+extern const struct shell_syscall __stop_FSymTab[];
+
+extern int shell_exec(char *cmd, uint32_t length);
+
+static uint32_t bench_baud = 2000000;
+static uint32_t bench_cpu = 25; /* device time per host time */
+static int bench_lines = 200000;
+
+/* everything the shell prints, and how much */
+static char bench_capture[BENCH_CAPTURE_SIZE];
+static uint32_t bench_captured;
+static uint64_t bench_out_bytes;
+
+static uint64_t host_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void bench_keep(const char *data, uint32_t len)
+{
+    bench_out_bytes += len;
+    if (len > BENCH_CAPTURE_SIZE - bench_captured) {
+        len = BENCH_CAPTURE_SIZE - bench_captured;
+    }
+    memcpy(bench_capture + bench_captured, data, len);
+    bench_captured += len;
+}
+
+/* the console as printf sees it, the shell waits for every byte */
+static void bench_print(char *fmt, ...)
+{
+    char line[1024];
+    va_list ap;
+    int len;
+
+    va_start(ap, fmt);
+    len = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (len > 0) {
+        bench_keep(line, len < (int)sizeof(line) ? len : (int)sizeof(line) - 1);
+    }
+}
+
+/* the console behind the buffered output */
+static void bench_sink(const uint8_t *data, uint32_t len)
+{
+    bench_keep((const char *)data, len);
+}
+
+static void bench_reset_capture(void)
+{
+    bench_captured = 0;
+    bench_out_bytes = 0;
+}
+
+static void bench_feed(const char *text)
+{
+    while (*text) {
+        shell_handler((uint8_t)*text++);
+    }
+}
+
+static int bench_captured_has(const char *what)
+{
+    bench_capture[bench_captured < BENCH_CAPTURE_SIZE ? bench_captured : BENCH_CAPTURE_SIZE - 1] = '\0';
+    return strstr(bench_capture, what) != NULL;
+}
+
+static uint32_t bench_cmd_names(const char **names)
+{
+    const struct shell_syscall *index;
+    uint32_t n = 0;
+
+    for (index = __start_FSymTab; index < __stop_FSymTab; index++) {
+        /* help prints them all, memtrace reads memory */
+        if (strcmp(index->name, "help") && strcmp(index->name, "memtrace")) {
+            names[n++] = index->name;
+        }
+    }
+    return n;
+}
+
+/* every command runs with its arguments, others are not found, completion lists the matches */
+static int bench_check(const char **names, uint32_t count)
+{
+    char line[SHELL_CMD_SIZE];
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        bench_last = NULL;
+        snprintf(line, sizeof(line), "%s 1 \"two words\"\r", names[i]);
+        bench_feed(line);
+        if ((bench_last == NULL) || strcmp(bench_last, names[i]) || (bench_argc != 3)) {
+            printf("check: %s ran %s with %d args\n", names[i], bench_last ? bench_last : "nothing", bench_argc);
+            return -1;
+        }
+    }
+
+    bench_reset_capture();
+    bench_last = NULL;
+    bench_feed("wifi_s\r  nope\rwif\r");
+    if (bench_last || !bench_captured_has("wifi_s: command not found") || !bench_captured_has("nope: command not found") ||
+        !bench_captured_has("wif: command not found")) {
+        printf("check: a name that is no command ran\n");
+        return -1;
+    }
+
+    bench_reset_capture();
+    bench_feed("wifi_s\t");
+    if (!bench_captured_has("wifi_scan") || !bench_captured_has("wifi_set") || !bench_captured_has("wifi_start") ||
+        !bench_captured_has("wifi_status") || !bench_captured_has("wifi_stop") || bench_captured_has("wifi_stat\r")) {
+        printf("check: completion of wifi_s missed a command\n");
+        return -1;
+    }
+    bench_feed("c\t\r");
+    if ((bench_last == NULL) || strcmp(bench_last, "wifi_scan")) {
+        printf("check: completion of wifi_sc ran %s\n", bench_last ? bench_last : "nothing");
+        return -1;
+    }
+    bench_feed("ne\t\r");
+    if ((bench_last == NULL) || strcmp(bench_last, "net")) {
+        printf("check: completion of ne ran %s\n", bench_last ? bench_last : "nothing");
+        return -1;
+    }
+
+    printf("check: %u commands dispatched, unknown names refused, completion ok\n", count);
+    return 0;
+}
+
+/* the same script printed directly and through the buffer must look the same */
+static int bench_check_output(const char **names, uint32_t count)
+{
+    static char direct[BENCH_CAPTURE_SIZE];
+    uint32_t direct_len = 0, i;
+    char line[SHELL_CMD_SIZE];
+    int pass;
+
+    for (pass = 0; pass < 2; pass++) {
+        if (pass == 0) {
+            shell_set_output(NULL);
+            shell_set_print(bench_print);
+        } else {
+            shell_set_output(bench_sink);
+        }
+        bench_reset_capture();
+        for (i = 0; i < count; i += 7) {
+            snprintf(line, sizeof(line), "%s x\r", names[i]);
+            bench_feed(line);
+        }
+        bench_feed("help\rwifi_s\t\rbad\rlong_line\r");
+        if (pass == 0) {
+            memcpy(direct, bench_capture, bench_captured);
+            direct_len = bench_captured;
+        }
+    }
+
+    if ((bench_captured != direct_len) || memcmp(direct, bench_capture, direct_len)) {
+        printf("check: buffered output differs from printf output\n");
+        return -1;
+    }
+
+    /* a NULL sink gives back the hook that was set, not printf */
+    shell_set_output(NULL);
+    bench_reset_capture();
+    bench_feed("bad\r");
+    if (!bench_captured_has("bad")) {
+        printf("check: shell_set_output(NULL) did not restore shell_set_print\n");
+        return -1;
+    }
+
+    printf("check: buffered output is the same as printf output, %u bytes\n", direct_len);
+    return 0;
+}
+
+static void bench_dispatch(const char **names, uint32_t count)
+{
+    char line[SHELL_CMD_SIZE];
+    uint32_t i, rand = 1;
+    uint64_t t, lookup = 0, handler = 0, complete = 0;
+    int n, len;
+
+    shell_set_output(bench_sink);
+
+    /* lookup and call only */
+    for (n = 0; n < bench_lines; n++) {
+        rand ^= rand << 13;
+        rand ^= rand >> 17;
+        rand ^= rand << 5;
+        len = snprintf(line, sizeof(line), "%s 1 2", names[rand % count]);
+        t = host_time_ns();
+        shell_exec(line, len);
+        lookup += host_time_ns() - t;
+    }
+
+    /* the whole line as typed: echo, history, split, dispatch and prompt */
+    bench_reset_capture();
+    for (n = 0; n < bench_lines; n++) {
+        rand ^= rand << 13;
+        rand ^= rand >> 17;
+        rand ^= rand << 5;
+        snprintf(line, sizeof(line), "%s 1 2\r", names[rand % count]);
+        t = host_time_ns();
+        bench_feed(line);
+        handler += host_time_ns() - t;
+        if (bench_captured > BENCH_CAPTURE_SIZE / 2) {
+            bench_captured = 0;
+        }
+    }
+
+    /* tab on the first 4 letters of a command, then clear the line */
+    for (n = 0; n < bench_lines / 10; n++) {
+        i = (n * 7) % count;
+        snprintf(line, sizeof(line), "%.4s", names[i]);
+        bench_feed(line);
+        t = host_time_ns();
+        shell_handler('\t');
+        complete += host_time_ns() - t;
+        bench_feed("\x03");
+        if (bench_captured > BENCH_CAPTURE_SIZE / 2) {
+            bench_captured = 0;
+        }
+    }
+
+    printf("%-6s %9u %12.0f %12.0f %12.1f %14.0f\n", SHELL_CMD_INDEX ? "index" : "scan", count + 2,
+           (double)lookup / bench_lines, (double)handler / bench_lines, (double)complete / (bench_lines / 10) / 1000,
+           1e9 * bench_lines / (handler * (double)bench_cpu));
+}
+
+/* how long a command line holds the shell task on the console */
+static void bench_burst(const char *line)
+{
+    double byte_ns = 10e9 / bench_baud;
+    uint64_t bytes;
+
+    shell_set_output(bench_sink);
+    bench_reset_capture();
+    bench_feed(line);
+    bytes = bench_out_bytes;
+
+    printf("%-16.*s %8llu %12.3f %12.3f\n", (int)strlen(line) - 1, line, (unsigned long long)bytes,
+           bytes * byte_ns / 1e6, (bytes > SHELL_OUTPUT_BUF_SIZE ? bytes - SHELL_OUTPUT_BUF_SIZE : 0) * byte_ns / 1e6);
+}
+
+static void usage(void)
+{
+    printf("usage: shell_bench [-n lines] [-b baud] [-k device factor]\n");
+}
+
+int main(int argc, char **argv)
+{
+    static const char *names[4096];
+    uint32_t count;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:b:k:h")) != -1) {
+        switch (opt) {
+            case 'n':
+                bench_lines = atoi(optarg);
+                break;
+            case 'b':
+                bench_baud = strtoul(optarg, NULL, 0);
+                break;
+            case 'k':
+                bench_cpu = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                usage();
+                return 1;
+        }
+    }
+    if ((bench_lines < 10) || (bench_baud == 0) || (bench_cpu == 0)) {
+        usage();
+        return 1;
+    }
+
+    shell_init();
+    shell_set_print(bench_print);
+    count = bench_cmd_names(names);
+
+    if (bench_check(names, count) || bench_check_output(names, count)) {
+        printf("shell_bench failed\n");
+        return 1;
+    }
+    printf("%-6s %9s %12s %12s %12s %14s\n", "lookup", "commands", "exec ns", "line ns", "tab us", "device cmd/s");
+    bench_dispatch(names, count);
+    printf("%-16s %8s %12s %12s   (ms at %u baud, %u byte buffer)\n", "line", "bytes", "direct", "buffered",
+           bench_baud, SHELL_OUTPUT_BUF_SIZE);
+    bench_burst("wifi_scan 1 2\r");
+    bench_burst("help\r");
+    return 0;
+}
@@ -19,6 +19,10 @@
  */
 
 #include "shell.h"
+#include <stdarg.h>
+#if SHELL_OUTPUT_BUF_SIZE
+#include "ring_buffer_lockfree.h"
+#endif
 #if defined(SHELL_USING_FS)
 #include "ff.h"
 #endif
@@ -37,6 +41,20 @@ extern int shell_start_exec(cmd_function_t func, int argc, char *argv[]);
 extern void shell_dup_line(char *cmd, uint32_t length);
 static volatile shell_sig_func_ptr shell_sig_func;
 
+#if SHELL_CMD_INDEX
+/* FSymTab sorted by name, NULL if there was no memory for it */
+static struct shell_syscall **shell_cmd_index = NULL;
+static uint32_t shell_cmd_count = 0;
+#endif
+
+#if SHELL_OUTPUT_BUF_SIZE
+static Ring_Buffer_Spsc_Type shell_output_rb;
+static uint8_t shell_output_buf[SHELL_OUTPUT_BUF_SIZE];
+static void (*shell_output_sink)(const uint8_t *data, uint32_t len) = NULL;
+/* shell_printf before shell_set_output, put back by a NULL sink */
+static void (*shell_output_prev)(char *fmt, ...) = NULL;
+#endif
+
 int shell_help(int argc, char **argv)
 {
     SHELL_DGB("shell commands list:\r\n");
@@ -147,6 +165,64 @@ static int str_common(const char *str1, const char *str2)
     return (str - str1);
 }
 
+#if SHELL_CMD_INDEX
+static int shell_cmd_compare(const void *a, const void *b)
+{
+    const struct shell_syscall *x = *(const struct shell_syscall *const *)a;
+    const struct shell_syscall *y = *(const struct shell_syscall *const *)b;
+    int ret = strcmp(x->name, y->name);
+
+    /* same name twice: the first in FSymTab wins, as with the scan */
+    if (ret == 0) {
+        ret = (x < y) ? -1 : (x > y);
+    }
+
+    return ret;
+}
+
+static void shell_cmd_index_init(void)
+{
+    struct shell_syscall *index;
+    uint32_t i = 0;
+
+    if (shell_cmd_index) {
+        SHELL_FREE(shell_cmd_index);
+    }
+
+    shell_cmd_count = _syscall_table_end - _syscall_table_begin;
+    shell_cmd_index = (struct shell_syscall **)SHELL_MALLOC(shell_cmd_count * sizeof(*shell_cmd_index));
+
+    if (shell_cmd_index == NULL) {
+        shell_cmd_count = 0;
+        return;
+    }
+
+    for (index = _syscall_table_begin; index < _syscall_table_end; index++) {
+        shell_cmd_index[i++] = index;
+    }
+
+    qsort(shell_cmd_index, shell_cmd_count, sizeof(*shell_cmd_index), shell_cmd_compare);
+}
+
+/* first command in the index whose name is not below the prefix */
+static uint32_t shell_cmd_lower_bound(const char *prefix, int size)
+{
+    uint32_t low = 0, high = shell_cmd_count, mid;
+
+    while (low < high) {
+        mid = low + (high - low) / 2;
+
+        if (strncmp(shell_cmd_index[mid]->name, prefix, size) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+#endif
+
 static void shell_handle_history(struct shell *shell)
 {
     SHELL_PRINTF("\033[2K\r");
@@ -346,6 +422,34 @@ static void shell_auto_complete(char *prefix)
 #endif
 
     /* checks in internal command */
+#if SHELL_CMD_INDEX
+    if (shell_cmd_index) {
+        uint32_t i;
+        int prefix_len = strlen(prefix);
+
+        /* the matches are one run of the sorted index */
+        for (i = shell_cmd_lower_bound(prefix, prefix_len); i < shell_cmd_count; i++) {
+            cmd_name = shell_cmd_index[i]->name;
+
+            if (strncmp(prefix, cmd_name, prefix_len) != 0) {
+                break;
+            }
+
+            if (min_length == 0) {
+                name_ptr = cmd_name;
+                min_length = strlen(name_ptr);
+            }
+
+            length = str_common(name_ptr, cmd_name);
+
+            if (length < min_length) {
+                min_length = length;
+            }
+
+            SHELL_CMD("%s\r\n", cmd_name);
+        }
+    } else
+#endif
     {
         for (index = _syscall_table_begin; index < _syscall_table_end; index++) {
             /* skip finsh shell function */
@@ -469,6 +573,20 @@ static cmd_function_t shell_get_cmd(char *cmd, int size)
     struct shell_syscall *index;
     cmd_function_t cmd_func = NULL;
 
+#if SHELL_CMD_INDEX
+    if (shell_cmd_index) {
+        uint32_t i = shell_cmd_lower_bound(cmd, size);
+
+        /* an exact name sorts before the longer names it is a prefix of */
+        if (i < shell_cmd_count && strncmp(shell_cmd_index[i]->name, cmd, size) == 0 &&
+            shell_cmd_index[i]->name[size] == '\0') {
+            cmd_func = (cmd_function_t)shell_cmd_index[i]->func;
+        }
+
+        return cmd_func;
+    }
+#endif
+
     for (index = _syscall_table_begin; index < _syscall_table_end; index++) {
         // if (strncmp(index->name, "__cmd_", 6) != 0) {
         //     continue;
@@ -521,6 +639,8 @@ static int shell_exec_cmd(char *cmd, uint32_t length, int *retp)
     /* exec this command */
     shell_signal(SHELL_SIGINT, SHELL_SIG_DFL);
     shell_dup_line(cmd, length);
+    /* the command may print without the shell, let the echo out first */
+    shell_output_flush();
     *retp = shell_start_exec(cmd_func, argc, argv);
     // *retp = cmd_func(argc, argv);
     return 0;
@@ -848,6 +968,146 @@ int shell_set_prompt(const char *prompt)
     return 0;
 }
 
+#if SHELL_OUTPUT_BUF_SIZE
+static void shell_output_write(const uint8_t *data, uint32_t len)
+{
+    uint32_t n;
+
+    shell_output_lock();
+
+    while (len > 0) {
+        n = Ring_Buffer_Spsc_Write(&shell_output_rb, data, len);
+        data += n;
+        len -= n;
+
+        if (n) {
+            shell_output_kick();
+        }
+
+        /* full: wait for the sink instead of dropping output */
+        if (len > 0) {
+            shell_output_wait();
+        }
+    }
+
+    shell_output_unlock();
+}
+
+static void shell_output_printf(char *fmt, ...)
+{
+    char line[SHELL_OUTPUT_LINE_SIZE];
+    char *buf = line;
+    va_list ap, aq;
+    int len, cut = 0;
+
+    va_start(ap, fmt);
+    va_copy(aq, ap);
+    len = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+
+    /* longer than a line: format it again into the heap, the ring takes it in parts */
+    if (len >= (int)sizeof(line)) {
+        buf = (char *)SHELL_MALLOC(len + 1);
+        if (buf != NULL) {
+            vsnprintf(buf, len + 1, fmt, aq);
+        } else {
+            buf = line;
+            len = sizeof(line) - 1;
+            cut = 1;
+        }
+    }
+    va_end(aq);
+
+    if (len <= 0) {
+        return;
+    }
+
+    shell_output_write((uint8_t *)buf, len);
+
+    if (buf != line) {
+        SHELL_FREE(buf);
+    } else if (cut) {
+        /* no memory for the rest, say it was cut */
+        shell_output_write((const uint8_t *)"...\r\n", 5);
+    }
+}
+#endif
+
+/*
+ * Send shell output through a ring buffer of SHELL_OUTPUT_BUF_SIZE to sink,
+ * which writes it to the console. The shell no longer waits for the console,
+ * except when the buffer is full. A NULL sink flushes and puts back the
+ * shell_printf that was set before.
+ *
+ * Only SHELL_PRINTF and friends go through the buffer. The buffer is flushed
+ * before a command starts, but a command that mixes SHELL_PRINTF and printf
+ * can see its printf lines overtake the SHELL_PRINTF lines still buffered;
+ * such a command should print through one of them only.
+ */
+int shell_set_output(void (*sink)(const uint8_t *data, uint32_t len))
+{
+#if SHELL_OUTPUT_BUF_SIZE
+    if (sink == NULL) {
+        shell_output_flush();
+        shell_output_sink = NULL;
+        if (shell->shell_printf == shell_output_printf) {
+            shell->shell_printf = shell_output_prev ? shell_output_prev : (void (*)(char *fmt, ...))printf;
+        }
+        return 0;
+    }
+
+    if (shell_output_sink == NULL) {
+        Ring_Buffer_Spsc_Init(&shell_output_rb, shell_output_buf, sizeof(shell_output_buf));
+    }
+
+    if (shell->shell_printf != shell_output_printf) {
+        shell_output_prev = shell->shell_printf;
+    }
+    shell_output_sink = sink;
+    shell->shell_printf = shell_output_printf;
+    return 0;
+#else
+    (void)sink;
+    return -1;
+#endif
+}
+
+/* give buffered output to the sink, for the one task or the kick that writes the console */
+uint32_t shell_output_drain(void)
+{
+    uint32_t total = 0;
+#if SHELL_OUTPUT_BUF_SIZE
+    uint8_t *span;
+    uint32_t len;
+
+    if (shell_output_sink == NULL) {
+        return 0;
+    }
+
+    while ((len = Ring_Buffer_Spsc_Peek_Read_Span(&shell_output_rb, &span)) > 0) {
+        shell_output_sink(span, len);
+        Ring_Buffer_Spsc_Consume(&shell_output_rb, len);
+        total += len;
+    }
+#endif
+    return total;
+}
+
+/* wait until the sink has all buffered output */
+void shell_output_flush(void)
+{
+#if SHELL_OUTPUT_BUF_SIZE
+    if (shell_output_sink == NULL) {
+        return;
+    }
+
+    while (Ring_Buffer_Spsc_Get_Length(&shell_output_rb) > 0) {
+        shell_output_kick();
+        shell_output_wait();
+    }
+#endif
+}
+
 int shell_set_print(void (*shell_printf)(char *fmt, ...))
 {
     if (shell_printf) {
@@ -882,6 +1142,9 @@ void shell_init(void)
     extern const int __vsymtab_end;
     shell_function_init(&__fsymtab_start, &__fsymtab_end);
     shell_var_init(&__vsymtab_start, &__vsymtab_end);
+#endif
+#if SHELL_CMD_INDEX
+    shell_cmd_index_init();
 #endif
     shell = &_shell;
     shell_set_prompt(SHELL_DEFAULT_NAME);
@@ -919,4 +1182,18 @@ __attribute__((weak)) void shell_dup_line(char *cmd, uint32_t length)
 {
     (void)cmd;
     (void)length;
+}
+__attribute__((weak)) void shell_output_lock(void)
+{
+}
+__attribute__((weak)) void shell_output_unlock(void)
+{
+}
+__attribute__((weak)) void shell_output_kick(void)
+{
+    shell_output_drain();
+}
+__attribute__((weak)) void shell_output_wait(void)
+{
+    shell_output_drain();
 }
\ No newline at end of file
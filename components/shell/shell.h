@@ -164,4 +164,14 @@ int shell_set_print(void (*shell_printf)(char *fmt, ...));
 void shell_init(void);
 void shell_exe_cmd(uint8_t *cmd, uint16_t len);
 shell_sig_func_ptr shell_signal(int sig, shell_sig_func_ptr func);
+
+/* buffered output of SHELL_PRINTF (not printf), needs SHELL_OUTPUT_BUF_SIZE, a NULL sink puts back the previous shell_printf */
+int shell_set_output(void (*sink)(const uint8_t *data, uint32_t len));
+uint32_t shell_output_drain(void);
+void shell_output_flush(void);
+/* port of the buffered output, the weak defaults drain in the caller */
+void shell_output_lock(void);
+void shell_output_unlock(void);
+void shell_output_kick(void);
+void shell_output_wait(void);
 #endif
\ No newline at end of file
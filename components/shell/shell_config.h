@@ -25,6 +25,22 @@
 #define SHELL_ARG_NUM 16
 #endif
 
+/* sorted index of FSymTab built by shell_init, command lookup and tab completion
+ * are binary searches instead of a scan of all commands */
+#ifndef SHELL_CMD_INDEX
+#define SHELL_CMD_INDEX 1
+#endif
+
+/* ring buffer of shell output, power of two, 0: shell_printf is called as output is made */
+#ifndef SHELL_OUTPUT_BUF_SIZE
+#define SHELL_OUTPUT_BUF_SIZE 0
+#endif
+
+/* SHELL_PRINTF formats on the stack up to this, longer output on the heap */
+#ifndef SHELL_OUTPUT_LINE_SIZE
+#define SHELL_OUTPUT_LINE_SIZE 256
+#endif
+
 //#define SHELL_USING_FS
 #define SHELL_USING_COLOR
 
@@ -44,4 +60,12 @@
 #define SHELL_EXEC_THREAD_PRIO 4
 #endif
 
+#ifndef SHELL_OUTPUT_THREAD_STACK_SIZE
+#define SHELL_OUTPUT_THREAD_STACK_SIZE 512
+#endif
+
+#ifndef SHELL_OUTPUT_THREAD_PRIO
+#define SHELL_OUTPUT_THREAD_PRIO SHELL_THREAD_PRIO
+#endif
+
 #endif
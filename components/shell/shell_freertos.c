@@ -88,6 +88,54 @@ void shell_release_sem(void)
 
 struct bflb_device_s *uart_shell = NULL;
 
+#if SHELL_OUTPUT_BUF_SIZE
+static TaskHandle_t shell_output_handle;
+static SemaphoreHandle_t sem_shell_output = NULL; /* output is waiting */
+static SemaphoreHandle_t sem_shell_space = NULL;  /* the output task made room */
+static SemaphoreHandle_t mutex_shell_output = NULL;
+
+void shell_output_lock(void)
+{
+    xSemaphoreTake(mutex_shell_output, portMAX_DELAY);
+}
+
+void shell_output_unlock(void)
+{
+    xSemaphoreGive(mutex_shell_output);
+}
+
+void shell_output_kick(void)
+{
+    xSemaphoreGive(sem_shell_output);
+}
+
+void shell_output_wait(void)
+{
+    /* the timeout covers room made between the check and the take */
+    xSemaphoreTake(sem_shell_space, pdMS_TO_TICKS(10));
+}
+
+static void shell_output_uart(const uint8_t *data, uint32_t len)
+{
+    if (uart_shell) {
+        bflb_uart_put(uart_shell, (uint8_t *)data, len);
+    } else {
+        printf("%.*s", (int)len, data);
+    }
+}
+
+static void shell_output_task(void *pvParameters)
+{
+    while (1) {
+        if (xSemaphoreTake(sem_shell_output, portMAX_DELAY) == pdTRUE) {
+            while (shell_output_drain()) {
+                xSemaphoreGive(sem_shell_space);
+            }
+        }
+    }
+}
+#endif
+
 void uart_shell_isr(int irq, void *arg)
 {
     uint32_t intstatus = bflb_uart_get_intstatus(uart_shell);
@@ -135,6 +183,15 @@ void shell_init_with_task(struct bflb_device_s *shell)
     Ring_Buffer_Init(&shell_rb, shell_buffer, sizeof(shell_buffer), NULL, NULL);
 
     shell_init();
+
+#if SHELL_OUTPUT_BUF_SIZE
+    vSemaphoreCreateBinary(sem_shell_output);
+    vSemaphoreCreateBinary(sem_shell_space);
+    mutex_shell_output = xSemaphoreCreateMutex();
+    xTaskCreate(shell_output_task, (char *)"shell_output", SHELL_OUTPUT_THREAD_STACK_SIZE, NULL, SHELL_OUTPUT_THREAD_PRIO, &shell_output_handle);
+    shell_set_output(shell_output_uart);
+#endif
+
     xTaskCreate(shell_task, (char *)"shell_task", SHELL_THREAD_STACK_SIZE, NULL, SHELL_THREAD_PRIO, &shell_handle);
 }
 
@@ -0,0 +1,288 @@
+/**
+ * @file bflb_slab.c
+ * @brief
+ *
+ * Copyright (c) 2023 Bouffalolab team
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "bflb_slab.h"
+#include "bflb_irq.h"
+
+#ifdef CONFIG_BFLB_BLOCK_POOL_DEBUG
+#define _BFLB_SLAB_CHECK(_expr, _ret) \
+    if (!(_expr))                     \
+    return _ret
+#else
+#define _BFLB_SLAB_CHECK(_expr, _ret) ((void)0)
+#endif
+
+/**
+ *   @brief         create a multi size class slab over one memory region
+ *   @param  slab                   slab instance
+ *   @param  cfg                    block size and count of each class
+ *   @param  cls_num                class num, at most CONFIG_BFLB_SLAB_CLASS_MAX
+ *   @param  blk_align              block align, BFLB_BLOCK_POOL_ALIGN_x
+ *   @param  pool_addr              pool address
+ *   @param  pool_size              pool size
+ *   @return int 
+ */
+int bflb_slab_create(bflb_slab_t *slab, const bflb_slab_class_cfg_t *cfg, uint32_t cls_num, uint32_t blk_align, void *pool_addr, uint32_t pool_size)
+{
+    _BFLB_SLAB_CHECK(slab != NULL, -1);
+    _BFLB_SLAB_CHECK(cfg != NULL, -1);
+    _BFLB_SLAB_CHECK(((blk_align >= BFLB_BLOCK_POOL_ALIGN_1) &&
+                      (blk_align <= BFLB_BLOCK_POOL_ALIGN_128)),
+                     -1);
+    _BFLB_SLAB_CHECK(pool_addr != NULL, -1);
+
+    uintptr_t bitmask = ((0x1 << blk_align) - 1);
+    uintptr_t address = (uintptr_t)pool_addr;
+    uintptr_t pool_end = (uintptr_t)pool_addr + pool_size;
+    bflb_slab_class_t *cls;
+    uint32_t blk_size;
+    uint32_t i, j;
+
+    if ((cls_num == 0) || (cls_num > CONFIG_BFLB_SLAB_CLASS_MAX)) {
+        return -1;
+    }
+
+    /*!< free blocks hold the list link, so keep them pointer aligned */
+    if (bitmask < (sizeof(void *) - 1)) {
+        bitmask = sizeof(void *) - 1;
+    }
+
+    slab->cls_num = 0;
+    slab->fallback_cnt = 0;
+    slab->fallback_alloc = NULL;
+    slab->fallback_free = NULL;
+
+    /*!< insert classes sorted by block size */
+    for (i = 0; i < cls_num; i++) {
+        if ((cfg[i].blk_size == 0) || (cfg[i].blk_count == 0)) {
+            return -1;
+        }
+
+        blk_size = (cfg[i].blk_size + bitmask) & ~bitmask;
+
+        for (j = slab->cls_num; (j > 0) && (slab->cls[j - 1].blk_size > blk_size); j--) {
+            slab->cls[j] = slab->cls[j - 1];
+        }
+
+        slab->cls[j].blk_size = blk_size;
+        slab->cls[j].blk_total = cfg[i].blk_count;
+        slab->cls_num++;
+    }
+
+    /*!< carve the region, class by class */
+    for (i = 0; i < slab->cls_num; i++) {
+        cls = &slab->cls[i];
+
+        address = (address + bitmask) & ~bitmask;
+
+        if ((address + (uintptr_t)cls->blk_size * cls->blk_total) > pool_end) {
+            slab->cls_num = 0;
+            return -1;
+        }
+
+        cls->blk_start = address;
+        cls->blk_end = address + cls->blk_size * cls->blk_total;
+
+        /*!< build list */
+        for (j = 0; j < cls->blk_total - 1; j++) {
+            *(void **)(address + j * cls->blk_size) = (void *)(address + (j + 1) * cls->blk_size);
+        }
+
+        /*!< last node link to NULL */
+        *(void **)(address + j * cls->blk_size) = NULL;
+
+        cls->free_list = (void *)address;
+        cls->blk_free = cls->blk_total;
+        cls->blk_min = cls->blk_total;
+        cls->alloc_cnt = 0;
+        cls->fail_cnt = 0;
+
+        address = cls->blk_end;
+    }
+
+    return 0;
+}
+
+/**
+ *   @brief         register or unregister allocator used when all fitting classes are exhausted
+ *   @param  slab                   slab instance
+ *   @param  alloc                  fallback alloc, e.g. kmalloc
+ *   @param  free                   fallback free, e.g. kfree
+ *   @return int 
+ */
+int bflb_slab_add_fallback(bflb_slab_t *slab, void *(*alloc)(size_t size), void (*free)(void *addr))
+{
+    _BFLB_SLAB_CHECK(slab != NULL, -1);
+
+    if ((alloc == NULL) || (free == NULL)) {
+        slab->fallback_alloc = NULL;
+        slab->fallback_free = NULL;
+    } else {
+        slab->fallback_alloc = alloc;
+        slab->fallback_free = free;
+    }
+
+    return 0;
+}
+
+/**
+ *   @brief         alloc a block, O(1) and safe from isr
+ *   @param  slab                   slab instance
+ *   @param  size                   wanted size
+ *   @return block pointer, NULL when no class nor fallback can serve it
+ */
+void *bflb_slab_alloc(bflb_slab_t *slab, uint32_t size)
+{
+    _BFLB_SLAB_CHECK(slab != NULL, NULL);
+
+    bflb_slab_class_t *cls;
+    void *node = NULL;
+    uintptr_t flag;
+
+    /*!< smallest fitting class first, spill to the larger ones */
+    for (uint32_t i = 0; i < slab->cls_num; i++) {
+        cls = &slab->cls[i];
+
+        if (cls->blk_size < size) {
+            continue;
+        }
+
+        flag = bflb_irq_save();
+
+        node = cls->free_list;
+
+        if (node != NULL) {
+            cls->free_list = *((void **)node);
+            cls->blk_free -= 1;
+            cls->alloc_cnt += 1;
+            if (cls->blk_free < cls->blk_min) {
+                cls->blk_min = cls->blk_free;
+            }
+        } else {
+            cls->fail_cnt += 1;
+        }
+
+        bflb_irq_restore(flag);
+
+        if (node != NULL) {
+            return node;
+        }
+    }
+
+    if (slab->fallback_alloc) {
+        node = slab->fallback_alloc(size);
+        if (node != NULL) {
+            flag = bflb_irq_save();
+            slab->fallback_cnt += 1;
+            bflb_irq_restore(flag);
+        }
+    }
+
+    return node;
+}
+
+/**
+ *   @brief         free a block, O(1) per class and safe from isr
+ *   @param  slab                   slab instance
+ *   @param  addr                   block pointer
+ *   @return int 
+ */
+int bflb_slab_free(bflb_slab_t *slab, void *addr)
+{
+    _BFLB_SLAB_CHECK(slab != NULL, -1);
+    _BFLB_SLAB_CHECK(addr != NULL, -1);
+
+    bflb_slab_class_t *cls;
+    uintptr_t flag;
+
+    for (uint32_t i = 0; i < slab->cls_num; i++) {
+        cls = &slab->cls[i];
+
+        if (((uintptr_t)addr < cls->blk_start) || ((uintptr_t)addr >= cls->blk_end)) {
+            continue;
+        }
+
+        /*!< this is not a block start */
+        if ((((uintptr_t)addr - cls->blk_start) % cls->blk_size) != 0) {
+            return -1;
+        }
+
+        flag = bflb_irq_save();
+
+        if (cls->blk_free == cls->blk_total) {
+            bflb_irq_restore(flag);
+            return -1;
+        }
+
+        *((void **)addr) = cls->free_list;
+        cls->free_list = addr;
+        cls->blk_free += 1;
+
+        bflb_irq_restore(flag);
+
+        return 0;
+    }
+
+    /*!< not in our region, it came from the fallback */
+    if (slab->fallback_free) {
+        slab->fallback_free(addr);
+        return 0;
+    }
+
+    return -1;
+}
+
+/**
+ *   @brief         get statistics of one class
+ *   @param  slab                   slab instance
+ *   @param  cls                    class index, classes are sorted by block size
+ *   @param  info                   info pointer
+ *   @return int 
+ */
+int bflb_slab_info_get(bflb_slab_t *slab, uint32_t cls, bflb_slab_info_t *info)
+{
+    _BFLB_SLAB_CHECK(slab != NULL, -1);
+    _BFLB_SLAB_CHECK(info != NULL, -1);
+
+    bflb_slab_class_t *c;
+    uintptr_t flag;
+
+    if (cls >= slab->cls_num) {
+        return -1;
+    }
+
+    c = &slab->cls[cls];
+
+    flag = bflb_irq_save();
+    info->blk_size = c->blk_size;
+    info->blk_total = c->blk_total;
+    info->blk_free = c->blk_free;
+    info->high_water = c->blk_total - c->blk_min;
+    info->alloc_cnt = c->alloc_cnt;
+    info->fail_cnt = c->fail_cnt;
+    bflb_irq_restore(flag);
+
+    return 0;
+}
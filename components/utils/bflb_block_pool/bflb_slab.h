@@ -0,0 +1,86 @@
+/**
+ * @file bflb_slab.h
+ * @brief
+ *
+ * Copyright (c) 2023 Bouffalolab team
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#ifndef _BFLB_SLAB_H
+#define _BFLB_SLAB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "bflb_block_pool.h"
+
+#ifndef CONFIG_BFLB_SLAB_CLASS_MAX
+#define CONFIG_BFLB_SLAB_CLASS_MAX 8
+#endif
+
+typedef struct {
+    uint32_t blk_size;  /*!< block size of this class  */
+    uint32_t blk_count; /*!< block number of this class */
+} bflb_slab_class_cfg_t;
+
+typedef struct {
+    void *free_list;     /*!< free block list, linked through the blocks */
+    uintptr_t blk_start; /*!< first block address      */
+    uintptr_t blk_end;   /*!< end of the last block    */
+    uint32_t blk_size;   /*!< block size (aligned)     */
+    uint32_t blk_total;  /*!< total block num          */
+    uint32_t blk_free;   /*!< free block num           */
+    uint32_t blk_min;    /*!< lowest free block num, gives the high-water mark */
+    uint32_t alloc_cnt;  /*!< allocations served       */
+    uint32_t fail_cnt;   /*!< requests this class could not serve */
+} bflb_slab_class_t;
+
+typedef struct {
+    bflb_slab_class_t cls[CONFIG_BFLB_SLAB_CLASS_MAX]; /*!< sorted by block size */
+    uint32_t cls_num;                                   /*!< class num            */
+    uint32_t fallback_cnt;                              /*!< allocations served by fallback */
+
+    void *(*fallback_alloc)(size_t size);
+    void (*fallback_free)(void *addr);
+} bflb_slab_t;
+
+typedef struct {
+    uint32_t blk_size;   /*!< block size               */
+    uint32_t blk_total;  /*!< total block num          */
+    uint32_t blk_free;   /*!< free block num           */
+    uint32_t high_water; /*!< most blocks ever in use  */
+    uint32_t alloc_cnt;  /*!< allocations served       */
+    uint32_t fail_cnt;   /*!< requests this class could not serve */
+} bflb_slab_info_t;
+
+extern int bflb_slab_create(bflb_slab_t *slab, const bflb_slab_class_cfg_t *cfg, uint32_t cls_num, uint32_t blk_align, void *pool_addr, uint32_t pool_size);
+extern int bflb_slab_add_fallback(bflb_slab_t *slab, void *(*alloc)(size_t size), void (*free)(void *addr));
+
+extern void *bflb_slab_alloc(bflb_slab_t *slab, uint32_t size);
+extern int bflb_slab_free(bflb_slab_t *slab, void *addr);
+
+extern int bflb_slab_info_get(bflb_slab_t *slab, uint32_t cls, bflb_slab_info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,350 @@
+/**
+ * @file bflb_flash_sim.c
+ * @brief
+ *
+ * Copyright (c) 2023 Bouffalolab team
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bflb_flash_sim.h"
+
+static bflb_flash_sim_config_t sim_cfg;
+static bflb_flash_sim_stat_t sim_stat;
+static uint8_t *sim_mem = NULL;
+static uint32_t *sim_erase_cycle = NULL;
+static uint32_t sim_rand;
+/* read time is below 1us, keep the remainder of time_us in ns */
+static uint32_t sim_time_ns;
+
+/* power loss injection, budget counts page programs and sector erases */
+static uint8_t sim_power_armed = 0;
+static uint8_t sim_power_lost = 0;
+static uint32_t sim_power_budget = 0;
+static void (*sim_power_callback)(void) = NULL;
+
+static uint32_t sim_random(void)
+{
+    /* xorshift32, reproducible torn data for a given seed */
+    sim_rand ^= sim_rand << 13;
+    sim_rand ^= sim_rand >> 17;
+    sim_rand ^= sim_rand << 5;
+    return sim_rand;
+}
+
+static int sim_check_range(uint32_t addr, uint32_t len)
+{
+    if ((sim_mem == NULL) || (addr > sim_cfg.size) || (len > sim_cfg.size - addr)) {
+        return BFLB_FLASH_SIM_ERR_RANGE;
+    }
+    return BFLB_FLASH_SIM_OK;
+}
+
+/* consume one unit of power budget, return 1 if power is lost during this unit */
+static int sim_power_consume(void)
+{
+    if (!sim_power_armed) {
+        return 0;
+    }
+    if (sim_power_budget > 0) {
+        sim_power_budget--;
+        return 0;
+    }
+    sim_power_armed = 0;
+    sim_power_lost = 1;
+    return 1;
+}
+
+static void sim_power_off(void)
+{
+    if (sim_power_callback) {
+        sim_power_callback();
+    }
+}
+
+/**
+ * @brief init the simulator, the flash is erased or loaded from cfg->path
+ * @param cfg flash geometry and timing
+ * @return BFLB_FLASH_SIM_OK or error
+ */
+int bflb_flash_sim_init(const bflb_flash_sim_config_t *cfg)
+{
+    FILE *fp;
+    uint32_t sector_num;
+
+    if ((cfg == NULL) || (cfg->sector_size == 0) || (cfg->page_size == 0) ||
+        (cfg->size == 0) || (cfg->size % cfg->sector_size) || (cfg->sector_size % cfg->page_size)) {
+        return BFLB_FLASH_SIM_ERR_RANGE;
+    }
+
+    bflb_flash_sim_deinit();
+
+    sim_cfg = *cfg;
+    sector_num = sim_cfg.size / sim_cfg.sector_size;
+    sim_mem = malloc(sim_cfg.size);
+    sim_erase_cycle = calloc(sector_num, sizeof(uint32_t));
+    if ((sim_mem == NULL) || (sim_erase_cycle == NULL)) {
+        bflb_flash_sim_deinit();
+        return BFLB_FLASH_SIM_ERR_RANGE;
+    }
+    memset(sim_mem, 0xff, sim_cfg.size);
+
+    if (sim_cfg.path) {
+        fp = fopen(sim_cfg.path, "rb");
+        if (fp) {
+            /* a short image keeps the erased tail */
+            fread(sim_mem, 1, sim_cfg.size, fp);
+            fclose(fp);
+        }
+    }
+
+    sim_rand = sim_cfg.seed ? sim_cfg.seed : 1;
+    sim_power_armed = 0;
+    sim_power_lost = 0;
+    sim_time_ns = 0;
+    memset(&sim_stat, 0, sizeof(sim_stat));
+
+    return BFLB_FLASH_SIM_OK;
+}
+
+/**
+ * @brief save the flash content to cfg->path
+ * @return BFLB_FLASH_SIM_OK or error
+ */
+int bflb_flash_sim_sync(void)
+{
+    FILE *fp;
+    size_t n;
+
+    if ((sim_mem == NULL) || (sim_cfg.path == NULL)) {
+        return BFLB_FLASH_SIM_OK;
+    }
+
+    fp = fopen(sim_cfg.path, "wb");
+    if (fp == NULL) {
+        return BFLB_FLASH_SIM_ERR_RANGE;
+    }
+    n = fwrite(sim_mem, 1, sim_cfg.size, fp);
+    fclose(fp);
+
+    return (n == sim_cfg.size) ? BFLB_FLASH_SIM_OK : BFLB_FLASH_SIM_ERR_RANGE;
+}
+
+/**
+ * @brief sync and free the simulator
+ */
+void bflb_flash_sim_deinit(void)
+{
+    if (sim_mem) {
+        bflb_flash_sim_sync();
+    }
+    free(sim_mem);
+    free(sim_erase_cycle);
+    sim_mem = NULL;
+    sim_erase_cycle = NULL;
+}
+
+/**
+ * @brief erase all sectors covered by [addr, addr + len)
+ * @param addr sector aligned address
+ * @param len length, rounded up to sector size
+ * @return BFLB_FLASH_SIM_OK or error
+ */
+int bflb_flash_sim_erase(uint32_t addr, uint32_t len)
+{
+    uint32_t sector, end, torn;
+    uint8_t *p;
+
+    if (sim_power_lost) {
+        return BFLB_FLASH_SIM_ERR_POWER;
+    }
+    if ((sim_check_range(addr, len) != BFLB_FLASH_SIM_OK) || (addr % sim_cfg.sector_size)) {
+        return BFLB_FLASH_SIM_ERR_RANGE;
+    }
+
+    end = addr + len;
+    for (; addr < end; addr += sim_cfg.sector_size) {
+        sector = addr / sim_cfg.sector_size;
+        p = sim_mem + addr;
+
+        if (sim_power_consume()) {
+            /* an interrupted erase leaves part of the sector erased */
+            torn = sim_random() % sim_cfg.sector_size;
+            memset(p, 0xff, torn);
+            sim_stat.time_us += sim_cfg.erase_us / 2;
+            sim_power_off();
+            return BFLB_FLASH_SIM_ERR_POWER;
+        }
+
+        memset(p, 0xff, sim_cfg.sector_size);
+        sim_erase_cycle[sector]++;
+        if (sim_erase_cycle[sector] > sim_stat.erase_max) {
+            sim_stat.erase_max = sim_erase_cycle[sector];
+        }
+        sim_stat.erase_count++;
+        sim_stat.time_us += sim_cfg.erase_us;
+    }
+
+    return BFLB_FLASH_SIM_OK;
+}
+
+/**
+ * @brief program data, NOR only clears bits, a write is split at page boundary
+ * @param addr flash address
+ * @param data source data
+ * @param len length
+ * @return BFLB_FLASH_SIM_OK or error
+ */
+int bflb_flash_sim_write(uint32_t addr, uint8_t *data, uint32_t len)
+{
+    uint32_t chunk, torn, i;
+    uint8_t *p;
+    int ret = BFLB_FLASH_SIM_OK;
+
+    if (sim_power_lost) {
+        return BFLB_FLASH_SIM_ERR_POWER;
+    }
+    if (sim_check_range(addr, len) != BFLB_FLASH_SIM_OK) {
+        return BFLB_FLASH_SIM_ERR_RANGE;
+    }
+
+    while (len > 0) {
+        chunk = sim_cfg.page_size - (addr % sim_cfg.page_size);
+        if (chunk > len) {
+            chunk = len;
+        }
+        p = sim_mem + addr;
+
+        if (sim_power_consume()) {
+            /* an interrupted program leaves a prefix written and one byte with random bits */
+            torn = sim_random() % chunk;
+            for (i = 0; i < torn; i++) {
+                p[i] &= data[i];
+            }
+            p[torn] &= (data[torn] | (uint8_t)sim_random());
+            sim_stat.time_us += sim_cfg.prog_us_per_page / 2;
+            sim_power_off();
+            return BFLB_FLASH_SIM_ERR_POWER;
+        }
+
+        for (i = 0; i < chunk; i++) {
+            if (data[i] & ~p[i]) {
+                sim_stat.violation++;
+                if (sim_cfg.strict) {
+                    ret = BFLB_FLASH_SIM_ERR_PROG;
+                }
+            }
+            p[i] &= data[i];
+        }
+
+        sim_stat.prog_pages++;
+        sim_stat.prog_bytes += chunk;
+        sim_stat.time_us += sim_cfg.prog_us_per_page;
+
+        addr += chunk;
+        data += chunk;
+        len -= chunk;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief read data
+ * @param addr flash address
+ * @param data destination buffer
+ * @param len length
+ * @return BFLB_FLASH_SIM_OK or error
+ */
+int bflb_flash_sim_read(uint32_t addr, uint8_t *data, uint32_t len)
+{
+    if (sim_power_lost) {
+        return BFLB_FLASH_SIM_ERR_POWER;
+    }
+    if (sim_check_range(addr, len) != BFLB_FLASH_SIM_OK) {
+        return BFLB_FLASH_SIM_ERR_RANGE;
+    }
+
+    memcpy(data, sim_mem + addr, len);
+    sim_stat.read_count++;
+    sim_stat.read_bytes += len;
+    sim_time_ns += sim_cfg.read_ns_per_call + len * sim_cfg.read_ns_per_byte;
+    sim_stat.time_us += sim_time_ns / 1000;
+    sim_time_ns %= 1000;
+
+    return BFLB_FLASH_SIM_OK;
+}
+
+void bflb_flash_sim_get_stat(bflb_flash_sim_stat_t *stat)
+{
+    *stat = sim_stat;
+}
+
+/**
+ * @brief clear the counters, erase cycles of each sector are kept as wear history
+ */
+void bflb_flash_sim_reset_stat(void)
+{
+    uint32_t erase_max = sim_stat.erase_max;
+
+    memset(&sim_stat, 0, sizeof(sim_stat));
+    sim_stat.erase_max = erase_max;
+    sim_time_ns = 0;
+}
+
+uint32_t bflb_flash_sim_get_erase_cycle(uint32_t sector)
+{
+    if ((sim_erase_cycle == NULL) || (sector >= sim_cfg.size / sim_cfg.sector_size)) {
+        return 0;
+    }
+    return sim_erase_cycle[sector];
+}
+
+uint8_t *bflb_flash_sim_get_memory(void)
+{
+    return sim_mem;
+}
+
+/**
+ * @brief power off after budget page programs and sector erases, the next one is torn
+ * @param budget units allowed to complete
+ * @param callback called right after the torn operation, may not return (longjmp/exit)
+ */
+void bflb_flash_sim_set_power_loss(uint32_t budget, void (*callback)(void))
+{
+    sim_power_budget = budget;
+    sim_power_callback = callback;
+    sim_power_armed = 1;
+    sim_power_lost = 0;
+}
+
+int bflb_flash_sim_is_power_lost(void)
+{
+    return sim_power_lost;
+}
+
+/**
+ * @brief power the flash on again, content is kept and injection is disarmed
+ */
+void bflb_flash_sim_power_on(void)
+{
+    sim_power_armed = 0;
+    sim_power_lost = 0;
+}
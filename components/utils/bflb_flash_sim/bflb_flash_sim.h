@@ -0,0 +1,103 @@
+/**
+ * @file bflb_flash_sim.h
+ * @brief
+ *
+ * Copyright (c) 2023 Bouffalolab team
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#ifndef _BFLB_FLASH_SIM_H
+#define _BFLB_FLASH_SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* NOR flash simulator, the erase/write/read have the same prototype as bflb_flash_erase/write/read,
+ * so it can be given to pt_table_set_flash_operation, bflb_mtd_set_flash_operation and
+ * lfs_xip_flash_set_operation. It only depends on libc, and builds for host and target. */
+
+#define BFLB_FLASH_SIM_OK         (0)
+#define BFLB_FLASH_SIM_ERR_RANGE  (-1) /*!< address out of flash or not aligned to sector on erase */
+#define BFLB_FLASH_SIM_ERR_PROG   (-2) /*!< program a 0 bit to 1 without erase, strict mode only */
+#define BFLB_FLASH_SIM_ERR_POWER  (-3) /*!< flash is powered off by the power loss injection */
+
+typedef struct {
+    uint32_t size;            /*!< flash size, multiple of sector size */
+    uint32_t sector_size;     /*!< erase unit, 4096 for most NOR flash */
+    uint32_t page_size;       /*!< program unit, a write is split at page boundary, 256 for most NOR flash */
+    uint32_t read_ns_per_call; /*!< command, address and dummy cycles of a read */
+    uint32_t read_ns_per_byte; /*!< read time per byte */
+    uint32_t prog_us_per_page; /*!< time of one page program, a partial page costs the same */
+    uint32_t erase_us;        /*!< time of one sector erase */
+    uint8_t strict;           /*!< 1: return error when program a 0 bit to 1, 0: AND the data as NOR does */
+    uint32_t seed;            /*!< random seed of the torn program/erase on power loss */
+    const char *path;         /*!< backing file, loaded by init and saved by sync/deinit, NULL: RAM only */
+} bflb_flash_sim_config_t;
+
+typedef struct {
+    uint64_t time_us;         /*!< simulated busy time */
+    uint64_t read_bytes;      /*!< bytes read */
+    uint64_t prog_bytes;      /*!< bytes programmed */
+    uint32_t read_count;      /*!< read calls */
+    uint32_t prog_pages;      /*!< page programs, a write crossing pages counts each page */
+    uint32_t erase_count;     /*!< sector erases */
+    uint32_t erase_max;       /*!< most erase cycles of one sector since init */
+    uint32_t violation;       /*!< program of a 0 bit to 1 */
+} bflb_flash_sim_stat_t;
+
+/* default NOR timing: 1us read setup, 50MB/s read, 0.7ms page program, 45ms sector erase */
+#define BFLB_FLASH_SIM_CONFIG_NOR(_size)     \
+    {                                        \
+        .size = (_size),                     \
+        .sector_size = 4096,                 \
+        .page_size = 256,                    \
+        .read_ns_per_call = 1000,            \
+        .read_ns_per_byte = 20,              \
+        .prog_us_per_page = 700,             \
+        .erase_us = 45000,                   \
+        .strict = 1,                         \
+        .seed = 1,                           \
+        .path = NULL,                        \
+    }
+
+extern int bflb_flash_sim_init(const bflb_flash_sim_config_t *cfg);
+extern int bflb_flash_sim_sync(void);
+extern void bflb_flash_sim_deinit(void);
+
+extern int bflb_flash_sim_erase(uint32_t addr, uint32_t len);
+extern int bflb_flash_sim_write(uint32_t addr, uint8_t *data, uint32_t len);
+extern int bflb_flash_sim_read(uint32_t addr, uint8_t *data, uint32_t len);
+
+extern void bflb_flash_sim_get_stat(bflb_flash_sim_stat_t *stat);
+extern void bflb_flash_sim_reset_stat(void);
+extern uint32_t bflb_flash_sim_get_erase_cycle(uint32_t sector);
+extern uint8_t *bflb_flash_sim_get_memory(void);
+
+extern void bflb_flash_sim_set_power_loss(uint32_t budget, void (*callback)(void));
+extern int bflb_flash_sim_is_power_lost(void);
+extern void bflb_flash_sim_power_on(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,978 @@
+/*
+ * Host benchmark of easyflash4 and littlefs on the NOR flash simulator.
+ *
+ * Every backend runs the same workload: random updates of 32 bytes records
+ * over a fixed key set. ef+gcstep runs ef_env_gc_step after every update,
+ * ef+txn4 commits every 4 updates as one ef_txn. Reported per backend:
+ *   write amplification  bytes programmed / bytes written by the user
+ *   erases, wear         sector erases and the most worn sector
+ *   set latency          simulated flash busy time per update and of the slowest
+ *                        one, an ef+txn4 commit is in the set that fills the batch,
+ *                        the GC steps between sets are idle time and not in it
+ *   mount                simulated time of ef_load_env / lfs_mount
+ *
+ * With -p the power is cut at increasing points of the workload, then the
+ * image is remounted and every record must be the old or the new one.
+ *
+ * With -g easyflash4 runs the updates alone and reports the worst set
+ * latency. Built with EF_GC_INCREMENTAL, one ef_env_gc_step runs between
+ * sets as an idle hook would, and the step cost is reported too.
+ *
+ * With -x one ef_txn_commit (sets, a delete and a new key) is cut after
+ * every byte it programs and every erase it does. After each reboot the
+ * keys of the transaction must be all old or all new. Before that, the
+ * public API must refuse the name of the commit record as a key.
+ * easyflash keeps its state in statics, so each run is a forked process.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "bflb_flash_sim.h"
+#include "easyflash.h"
+#include "lfs.h"
+#include "lfs_port.h"
+
+#define BENCH_FLASH_SIZE  (64 * 1024)
+#define BENCH_SECTOR_SIZE 4096
+#define BENCH_IMAGE_BASE  "flash_bench_base.bin"
+#define BENCH_IMAGE_TRIAL "flash_bench_trial.bin"
+
+#define EXIT_POWER_LOST   3
+#define EXIT_CORRUPT      4
+
+/* the transaction of -x: keys 0 ~ BENCH_TXN_SETS - 1 are set, the next one is deleted, key bench_keys is new */
+#define BENCH_TXN_SETS    4
+#define BENCH_TXN_OLD_SEQ 0x7000000u
+#define BENCH_TXN_NEW_SEQ 0x8000000u
+
+typedef struct {
+    uint32_t key;
+    uint32_t seq;
+    uint32_t data[5];
+    uint32_t sum;
+} bench_record_t;
+
+typedef struct {
+    const char *name;
+    int (*mount)(int format);
+    int (*set)(uint32_t key, const bench_record_t *rec);
+    int (*get)(uint32_t key, bench_record_t *rec);
+    int (*sync)(void);  /* write what set has staged, NULL: set is durable */
+    void (*idle)(void); /* background work between updates, untimed, NULL: none */
+} bench_backend_t;
+
+static uint32_t bench_ops = 2000;
+static uint32_t bench_keys = 64;
+static uint32_t bench_trials = 0;
+static bflb_flash_sim_config_t bench_cfg = BFLB_FLASH_SIM_CONFIG_NOR(BENCH_FLASH_SIZE);
+
+/* the power cut of the easyflash port: bench_cut_bytes more bytes are programmed, then the power goes */
+static int bench_cut_armed = 0;
+static uint32_t bench_cut_bytes = 0;
+static uint32_t bench_cut_erases = 0;
+
+static void bench_power_off(void);
+
+/* easyflash host port */
+
+extern EfErrCode ef_env_init(ef_env const *default_env, size_t default_env_size);
+
+uint32_t ENV_AREA_SIZE = BENCH_FLASH_SIZE;
+uint32_t SECTOR_NUM = BENCH_FLASH_SIZE / BENCH_SECTOR_SIZE;
+
+EfErrCode ef_port_read(uint32_t addr, uint32_t *buf, size_t size)
+{
+    return bflb_flash_sim_read(addr, (uint8_t *)buf, size) ? EF_READ_ERR : EF_NO_ERR;
+}
+
+EfErrCode ef_port_erase(uint32_t addr, size_t size)
+{
+    /* an erase counts as one byte, the simulator tears it */
+    if (bench_cut_armed) {
+        if (bench_cut_bytes == 0) {
+            bflb_flash_sim_set_power_loss(0, bench_power_off);
+        } else {
+            bench_cut_bytes--;
+        }
+        bench_cut_erases++;
+    }
+    return bflb_flash_sim_erase(addr, size) ? EF_ERASE_ERR : EF_NO_ERR;
+}
+
+EfErrCode ef_port_write(uint32_t addr, const uint32_t *buf, size_t size)
+{
+    if (bench_cut_armed) {
+        if (bench_cut_bytes < size) {
+            if (bench_cut_bytes) {
+                bflb_flash_sim_write(addr, (uint8_t *)buf, bench_cut_bytes);
+            }
+            bench_power_off();
+        }
+        bench_cut_bytes -= size;
+    }
+    return bflb_flash_sim_write(addr, (uint8_t *)buf, size) ? EF_WRITE_ERR : EF_NO_ERR;
+}
+
+void ef_port_env_lock(void)
+{
+}
+
+void ef_port_env_unlock(void)
+{
+}
+
+void ef_log_debug(const char *file, const long line, const char *format, ...)
+{
+}
+
+void ef_log_info(const char *format, ...)
+{
+}
+
+void ef_print(const char *format, ...)
+{
+}
+
+static int ef_bench_mount(int format)
+{
+    static const ef_env default_env_set[] = { { "boot_times", "3", 1 } };
+    static int inited = 0;
+
+    /* ef_env_init only loads once per process, remount is a reload */
+    if (inited) {
+        if (ef_load_env() != EF_NO_ERR) {
+            return -1;
+        }
+    } else if (ef_env_init(default_env_set, 1) != EF_NO_ERR) {
+        return -1;
+    }
+    inited = 1;
+    if (format) {
+        ef_env_set_default();
+    }
+    return 0;
+}
+
+static int ef_bench_set(uint32_t key, const bench_record_t *rec)
+{
+    char name[16];
+
+    snprintf(name, sizeof(name), "k.%u", key);
+    return ef_set_env_blob(name, rec, sizeof(*rec)) == EF_NO_ERR ? 0 : -1;
+}
+
+static int ef_bench_get(uint32_t key, bench_record_t *rec)
+{
+    char name[16];
+
+    snprintf(name, sizeof(name), "k.%u", key);
+    return ef_get_env_blob(name, rec, sizeof(*rec), NULL) == sizeof(*rec) ? 0 : -1;
+}
+
+static void ef_bench_gc_step(void)
+{
+    ef_env_gc_step(1);
+}
+
+/* the updates staged in one transaction, committed every BENCH_TXN_BATCH */
+#define BENCH_TXN_BATCH 4
+
+static ef_txn bench_txn;
+static uint8_t bench_txn_buf[512];
+
+static int ef_txn_bench_mount(int format)
+{
+    if (ef_bench_mount(format)) {
+        return -1;
+    }
+    return ef_txn_begin(&bench_txn, bench_txn_buf, sizeof(bench_txn_buf)) == EF_NO_ERR ? 0 : -1;
+}
+
+static int ef_txn_bench_sync(void)
+{
+    return ef_txn_commit(&bench_txn) == EF_NO_ERR ? 0 : -1;
+}
+
+static int ef_txn_bench_set(uint32_t key, const bench_record_t *rec)
+{
+    char name[16];
+
+    snprintf(name, sizeof(name), "k.%u", key);
+    if (ef_txn_set_env_blob(&bench_txn, name, rec, sizeof(*rec)) != EF_NO_ERR) {
+        return -1;
+    }
+    return bench_txn.count >= BENCH_TXN_BATCH ? ef_txn_bench_sync() : 0;
+}
+
+/* littlefs on the xip flash port, same geometry as examples/littlefs except the cache:
+ * a file is inlined in its directory only up to cache_size, a 16 bytes cache
+ * takes one block per record and the 16 blocks are full after 16 keys */
+
+static lfs_t bench_lfs;
+static int bench_lfs_mounted = 0;
+static const struct lfs_config bench_lfs_cfg = {
+    .read = lfs_xip_flash_read,
+    .prog = lfs_xip_flash_prog,
+    .erase = lfs_xip_flash_erase,
+    .sync = lfs_xip_flash_sync,
+    .read_size = 16,
+    .prog_size = 16,
+    .lookahead_size = 16,
+    .cache_size = 64,
+    .block_size = BENCH_SECTOR_SIZE,
+    .block_count = BENCH_FLASH_SIZE / BENCH_SECTOR_SIZE,
+    .block_cycles = 500,
+};
+
+static int lfs_bench_mount(int format)
+{
+    if (bench_lfs_mounted) {
+        lfs_unmount(&bench_lfs);
+        bench_lfs_mounted = 0;
+    }
+#ifdef CONFIG_LITTLEFS_CACHE_SIZE
+    /* a mount is a reboot, start with a cold cache */
+    lfs_xip_flash_cache_reset();
+#endif
+    if (format && lfs_format(&bench_lfs, &bench_lfs_cfg)) {
+        return -1;
+    }
+    if (lfs_mount(&bench_lfs, &bench_lfs_cfg)) {
+        return -1;
+    }
+    bench_lfs_mounted = 1;
+    return 0;
+}
+
+static int lfs_bench_set(uint32_t key, const bench_record_t *rec)
+{
+    char name[16];
+    lfs_file_t file;
+    int ret;
+
+    snprintf(name, sizeof(name), "k.%u", key);
+    if (lfs_file_open(&bench_lfs, &file, name, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC)) {
+        return -1;
+    }
+    ret = lfs_file_write(&bench_lfs, &file, rec, sizeof(*rec)) == sizeof(*rec) ? 0 : -1;
+    if (lfs_file_close(&bench_lfs, &file)) {
+        ret = -1;
+    }
+    return ret;
+}
+
+static int lfs_bench_get(uint32_t key, bench_record_t *rec)
+{
+    char name[16];
+    lfs_file_t file;
+    int ret;
+
+    snprintf(name, sizeof(name), "k.%u", key);
+    if (lfs_file_open(&bench_lfs, &file, name, LFS_O_RDONLY)) {
+        return -1;
+    }
+    ret = lfs_file_read(&bench_lfs, &file, rec, sizeof(*rec)) == sizeof(*rec) ? 0 : -1;
+    lfs_file_close(&bench_lfs, &file);
+    return ret;
+}
+
+#define BENCH_BACKEND_LFS 3
+
+static const bench_backend_t bench_backend[] = {
+    { "easyflash4", ef_bench_mount, ef_bench_set, ef_bench_get, NULL, NULL },
+    { "ef+gcstep", ef_bench_mount, ef_bench_set, ef_bench_get, NULL, ef_bench_gc_step },
+    { "ef+txn4", ef_txn_bench_mount, ef_txn_bench_set, ef_bench_get, ef_txn_bench_sync, NULL },
+    { "littlefs", lfs_bench_mount, lfs_bench_set, lfs_bench_get, NULL, NULL },
+};
+
+/* workload */
+
+static uint32_t bench_sum(const bench_record_t *rec)
+{
+    const uint32_t *p = (const uint32_t *)rec;
+    uint32_t sum = 0x5a5a5a5a;
+
+    for (size_t i = 0; i < offsetof(bench_record_t, sum) / 4; i++) {
+        sum = (sum << 5 | sum >> 27) ^ p[i];
+    }
+    return sum;
+}
+
+static void bench_fill(bench_record_t *rec, uint32_t key, uint32_t seq)
+{
+    rec->key = key;
+    rec->seq = seq;
+    for (int i = 0; i < 5; i++) {
+        rec->data[i] = key * 2654435761u + seq * 40503u + i;
+    }
+    rec->sum = bench_sum(rec);
+}
+
+/* write every key once, then bench_ops random updates */
+static int bench_populate(const bench_backend_t *backend)
+{
+    bench_record_t rec;
+
+    for (uint32_t key = 0; key < bench_keys; key++) {
+        bench_fill(&rec, key, 0);
+        if (backend->set(key, &rec)) {
+            return -1;
+        }
+    }
+    return backend->sync ? backend->sync() : 0;
+}
+
+static int bench_update(const bench_backend_t *backend, uint32_t ops, uint64_t *max_us)
+{
+    bflb_flash_sim_stat_t stat;
+    bench_record_t rec;
+    uint64_t start_us;
+
+    srand(1);
+    for (uint32_t i = 1; i <= ops; i++) {
+        bflb_flash_sim_get_stat(&stat);
+        start_us = stat.time_us;
+        bench_fill(&rec, rand() % bench_keys, i);
+        if (backend->set(rec.key, &rec)) {
+            return -1;
+        }
+        bflb_flash_sim_get_stat(&stat);
+        if (max_us && stat.time_us - start_us > *max_us) {
+            *max_us = stat.time_us - start_us;
+        }
+        if (backend->idle) {
+            backend->idle();
+        }
+    }
+    return backend->sync ? backend->sync() : 0;
+}
+
+static int bench_verify(const bench_backend_t *backend)
+{
+    bench_record_t rec;
+
+    for (uint32_t key = 0; key < bench_keys; key++) {
+        if (backend->get(key, &rec) || (rec.key != key) || (rec.sum != bench_sum(&rec))) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int bench_run(const bench_backend_t *backend)
+{
+    bflb_flash_sim_stat_t stat, mount;
+    uint64_t max_us = 0;
+    uint64_t user_bytes = (uint64_t)bench_ops * sizeof(bench_record_t);
+    uint32_t sector_num = BENCH_FLASH_SIZE / BENCH_SECTOR_SIZE, wear = 0;
+
+    bflb_flash_sim_init(&bench_cfg);
+    if (backend->mount(1) || bench_populate(backend)) {
+        printf("%-10s setup failed\n", backend->name);
+        return -1;
+    }
+
+    bflb_flash_sim_reset_stat();
+    if (bench_update(backend, bench_ops, &max_us)) {
+        printf("%-10s update failed\n", backend->name);
+        return -1;
+    }
+    bflb_flash_sim_get_stat(&stat);
+
+    for (uint32_t i = 0; i < sector_num; i++) {
+        wear += bflb_flash_sim_get_erase_cycle(i);
+    }
+
+    /* mount the aged image again */
+    bflb_flash_sim_reset_stat();
+    if (backend->mount(0)) {
+        printf("%-10s mount failed\n", backend->name);
+        return -1;
+    }
+    bflb_flash_sim_get_stat(&mount);
+
+    printf("%-10s %6.2f %8u %6u/%-6.1f %8llu %8llu %10llu %6s\n", backend->name,
+           (double)stat.prog_bytes / user_bytes, stat.erase_count, stat.erase_max, (double)wear / sector_num,
+           (unsigned long long)(stat.time_us / bench_ops), (unsigned long long)max_us,
+           (unsigned long long)mount.time_us, bench_verify(backend) ? "BAD" : "ok");
+
+    bflb_flash_sim_deinit();
+    return 0;
+}
+
+static void bench_power_off(void)
+{
+    /* the torn image is saved to BENCH_IMAGE_TRIAL by deinit */
+    bflb_flash_sim_deinit();
+    _exit(EXIT_POWER_LOST);
+}
+
+static int bench_fork(int (*func)(const bench_backend_t *, uint32_t), const bench_backend_t *backend, uint32_t arg)
+{
+    int status;
+    pid_t pid;
+
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0) {
+        status = func(backend, arg);
+        fflush(stdout);
+        _exit(status);
+    }
+    if ((pid < 0) || (waitpid(pid, &status, 0) < 0) || !WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+static int bench_child_run(const bench_backend_t *backend, uint32_t arg)
+{
+    return bench_run(backend) ? 1 : 0;
+}
+
+static int bench_child_base(const bench_backend_t *backend, uint32_t arg)
+{
+    bflb_flash_sim_config_t cfg = bench_cfg;
+
+    remove(BENCH_IMAGE_BASE);
+    cfg.path = BENCH_IMAGE_BASE;
+    bflb_flash_sim_init(&cfg);
+    if (backend->mount(1) || bench_populate(backend)) {
+        return 1;
+    }
+    bflb_flash_sim_deinit();
+    return 0;
+}
+
+static void bench_copy_image(const char *from, const char *to)
+{
+    FILE *src, *dst;
+    char buf[BENCH_SECTOR_SIZE];
+    size_t n;
+
+    src = fopen(from, "rb");
+    dst = fopen(to, "wb");
+    while (src && dst && (n = fread(buf, 1, sizeof(buf), src)) > 0) {
+        fwrite(buf, 1, n, dst);
+    }
+    if (src) {
+        fclose(src);
+    }
+    if (dst) {
+        fclose(dst);
+    }
+}
+
+static int bench_child_crash(const bench_backend_t *backend, uint32_t budget)
+{
+    bflb_flash_sim_config_t cfg = bench_cfg;
+
+    bench_copy_image(BENCH_IMAGE_BASE, BENCH_IMAGE_TRIAL);
+    cfg.path = BENCH_IMAGE_TRIAL;
+    cfg.seed = budget + 1;
+    bflb_flash_sim_init(&cfg);
+    if (backend->mount(0)) {
+        return 1;
+    }
+    bflb_flash_sim_set_power_loss(budget, bench_power_off);
+    bench_update(backend, bench_ops, NULL);
+    bflb_flash_sim_deinit();
+    return 0;
+}
+
+static int bench_child_check(const bench_backend_t *backend, uint32_t arg)
+{
+    bflb_flash_sim_config_t cfg = bench_cfg;
+
+    cfg.path = BENCH_IMAGE_TRIAL;
+    bflb_flash_sim_init(&cfg);
+    if (backend->mount(0) || bench_verify(backend)) {
+        return EXIT_CORRUPT;
+    }
+    /* the recovered image must still take updates */
+    if (bench_update(backend, bench_keys, NULL) || bench_verify(backend)) {
+        return EXIT_CORRUPT;
+    }
+    return 0;
+}
+
+/* cut the power after 0, stride, 2 * stride ... page programs and erases */
+static void bench_power_loss(const bench_backend_t *backend)
+{
+    uint32_t stride, cut = 0, bad = 0, trial;
+    int ret;
+
+    if (bench_fork(bench_child_base, backend, 0)) {
+        printf("%-10s power loss setup failed\n", backend->name);
+        return;
+    }
+
+    /* an update is a few page programs, spread the cuts over about 8 units per update,
+     * the loop stops at the first cut the workload does not reach */
+    stride = bench_ops * 8 / bench_trials ? bench_ops * 8 / bench_trials : 1;
+    for (trial = 0; trial < bench_trials; trial++) {
+        ret = bench_fork(bench_child_crash, backend, trial * stride);
+        if (ret == 0) {
+            /* workload finished before the cut */
+            break;
+        }
+        if (ret != EXIT_POWER_LOST) {
+            bad++;
+            continue;
+        }
+        cut++;
+        if (bench_fork(bench_child_check, backend, 0)) {
+            printf("%-10s corrupted after power cut at %u\n", backend->name, trial * stride);
+            bad++;
+        }
+    }
+
+    printf("%-10s power cuts %u, corrupted %u\n", backend->name, cut, bad);
+    remove(BENCH_IMAGE_BASE);
+    remove(BENCH_IMAGE_TRIAL);
+}
+
+/* the base image of -x: the workload, then the keys of the transaction at a known value */
+static int bench_child_txn_base(const bench_backend_t *backend, uint32_t arg)
+{
+    bflb_flash_sim_config_t cfg = bench_cfg;
+    bench_record_t rec;
+
+    remove(BENCH_IMAGE_BASE);
+    cfg.path = BENCH_IMAGE_BASE;
+    bflb_flash_sim_init(&cfg);
+    if (backend->mount(1) || bench_populate(backend) || bench_update(backend, bench_ops, NULL)) {
+        return 1;
+    }
+    for (uint32_t key = 0; key <= BENCH_TXN_SETS; key++) {
+        bench_fill(&rec, key, BENCH_TXN_OLD_SEQ);
+        if (backend->set(key, &rec)) {
+            return 1;
+        }
+    }
+    bflb_flash_sim_deinit();
+    return 0;
+}
+
+/* commit the transaction on a copy of the base image, the power goes after cut bytes */
+static int bench_child_txn_crash(const bench_backend_t *backend, uint32_t cut)
+{
+    bflb_flash_sim_config_t cfg = bench_cfg;
+    uint8_t buf[512];
+    bench_record_t rec;
+    char name[16];
+    ef_txn txn;
+    EfErrCode ret;
+
+    bench_copy_image(BENCH_IMAGE_BASE, BENCH_IMAGE_TRIAL);
+    cfg.path = BENCH_IMAGE_TRIAL;
+    cfg.seed = cut + 1;
+    bflb_flash_sim_init(&cfg);
+    if (backend->mount(0) || ef_txn_begin(&txn, buf, sizeof(buf))) {
+        return 1;
+    }
+    for (uint32_t key = 0; key < BENCH_TXN_SETS; key++) {
+        bench_fill(&rec, key, BENCH_TXN_NEW_SEQ);
+        snprintf(name, sizeof(name), "k.%u", key);
+        if (ef_txn_set_env_blob(&txn, name, &rec, sizeof(rec))) {
+            return 1;
+        }
+    }
+    snprintf(name, sizeof(name), "k.%u", BENCH_TXN_SETS);
+    ef_txn_del_env(&txn, name);
+    bench_fill(&rec, bench_keys, BENCH_TXN_NEW_SEQ);
+    snprintf(name, sizeof(name), "k.%u", bench_keys);
+    ef_txn_set_env_blob(&txn, name, &rec, sizeof(rec));
+
+    bench_cut_bytes = cut;
+    bench_cut_erases = 0;
+    bench_cut_armed = 1;
+    ret = ef_txn_commit(&txn);
+    bench_cut_armed = 0;
+    if (ret != EF_NO_ERR) {
+        return 1;
+    }
+    /* the commit is done before the cut */
+    printf("easyflash4 txn commit: %u bytes programmed, %u erases\n", cut - bench_cut_bytes - bench_cut_erases,
+           bench_cut_erases);
+    bflb_flash_sim_deinit();
+    return 0;
+}
+
+/* 0: the key has the value before the transaction, 1: after, -1: neither */
+static int bench_txn_state(const bench_backend_t *backend, uint32_t key, int deleted, int created)
+{
+    bench_record_t rec;
+
+    if (backend->get(key, &rec)) {
+        return deleted ? 1 : (created ? 0 : -1);
+    }
+    if ((rec.key != key) || (rec.sum != bench_sum(&rec))) {
+        return -1;
+    }
+    if (!deleted && (rec.seq == BENCH_TXN_NEW_SEQ)) {
+        return 1;
+    }
+    if (!created && (rec.seq == BENCH_TXN_OLD_SEQ)) {
+        return 0;
+    }
+    return -1;
+}
+
+static int bench_child_txn_check(const bench_backend_t *backend, uint32_t arg)
+{
+    bflb_flash_sim_config_t cfg = bench_cfg;
+    bench_record_t rec;
+    int state, first;
+
+    cfg.path = BENCH_IMAGE_TRIAL;
+    bflb_flash_sim_init(&cfg);
+    if (backend->mount(0)) {
+        return EXIT_CORRUPT;
+    }
+    first = bench_txn_state(backend, 0, 0, 0);
+    for (uint32_t key = 1; key <= BENCH_TXN_SETS + 1; key++) {
+        if (key < BENCH_TXN_SETS) {
+            state = bench_txn_state(backend, key, 0, 0);
+        } else if (key == BENCH_TXN_SETS) {
+            state = bench_txn_state(backend, key, 1, 0);
+        } else {
+            state = bench_txn_state(backend, bench_keys, 0, 1);
+        }
+        if ((first < 0) || (state != first)) {
+            return EXIT_CORRUPT;
+        }
+    }
+    /* the keys out of the transaction are untouched, and the image still takes updates */
+    bench_fill(&rec, BENCH_TXN_SETS, 0);
+    if (backend->set(BENCH_TXN_SETS, &rec) || bench_verify(backend) || bench_update(backend, bench_keys, NULL) ||
+        bench_verify(backend)) {
+        return EXIT_CORRUPT;
+    }
+    return 0;
+}
+
+/* the name of the commit record is not an user key, ef_load_env would apply its value */
+static int bench_child_txn_reserved(const bench_backend_t *backend, uint32_t arg)
+{
+    bflb_flash_sim_config_t cfg = bench_cfg;
+    uint8_t buf[128];
+    size_t saved_len = 1;
+    ef_txn txn;
+
+    remove(BENCH_IMAGE_TRIAL);
+    cfg.path = BENCH_IMAGE_TRIAL;
+    bflb_flash_sim_init(&cfg);
+    if (backend->mount(1) || ef_txn_begin(&txn, buf, sizeof(buf))) {
+        return 1;
+    }
+    if ((ef_set_env("__txn__", "x") != EF_ENV_ARG_ERR) || (ef_set_env_blob("__txn__", buf, 8) != EF_ENV_ARG_ERR) ||
+        (ef_del_env("__txn__") != EF_ENV_ARG_ERR) || (ef_txn_set_env(&txn, "__txn__", "x") != EF_ENV_ARG_ERR) ||
+        (ef_txn_del_env(&txn, "__txn__") != EF_ENV_ARG_ERR) || (txn.count != 0) ||
+        (ef_get_env_blob("__txn__", buf, sizeof(buf), &saved_len) != 0) || (saved_len != 0)) {
+        return 1;
+    }
+    bflb_flash_sim_deinit();
+    return 0;
+}
+
+/* cut the power after every byte programmed and every erase of one ef_txn_commit */
+static void bench_txn_power_loss(const bench_backend_t *backend)
+{
+    uint32_t cut, bad = 0;
+    int ret;
+
+    if (bench_fork(bench_child_txn_reserved, backend, 0)) {
+        printf("%-10s txn commit record name is not reserved\n", backend->name);
+        bad++;
+    }
+    if (bench_fork(bench_child_txn_base, backend, 0)) {
+        printf("%-10s txn setup failed\n", backend->name);
+        return;
+    }
+    for (cut = 0;; cut++) {
+        ret = bench_fork(bench_child_txn_crash, backend, cut);
+        if (ret == 0) {
+            break;
+        }
+        if (ret != EXIT_POWER_LOST) {
+            printf("%-10s txn commit failed at cut %u\n", backend->name, cut);
+            bad++;
+            break;
+        }
+        if (bench_fork(bench_child_txn_check, backend, 0)) {
+            printf("%-10s txn not all old or all new after power cut at byte %u\n", backend->name, cut);
+            bad++;
+        }
+    }
+
+    printf("%-10s txn power cuts %u, corrupted %u\n", backend->name, cut, bad);
+    remove(BENCH_IMAGE_BASE);
+    remove(BENCH_IMAGE_TRIAL);
+}
+
+/* littlefs metadata workload: small config files in a few directories and a log appended with sync */
+#define LFS_META_DIR_NUM    4
+#define LFS_META_FILE_NUM   16
+#define LFS_META_APPEND_NUM 200
+
+static uint64_t bench_sim_us(void)
+{
+    bflb_flash_sim_stat_t stat;
+
+    bflb_flash_sim_get_stat(&stat);
+    return stat.time_us;
+}
+
+static uint32_t bench_sim_reads(void)
+{
+    bflb_flash_sim_stat_t stat;
+
+    bflb_flash_sim_get_stat(&stat);
+    return stat.read_count;
+}
+
+static int bench_child_lfs_meta(const bench_backend_t *backend, uint32_t arg)
+{
+    char name[32];
+    uint8_t buf[64];
+    lfs_file_t file;
+    lfs_dir_t dir;
+    struct lfs_info info;
+    uint64_t start_us;
+    uint32_t start_reads, entries = 0, files = LFS_META_DIR_NUM * LFS_META_FILE_NUM;
+    bflb_flash_sim_stat_t stat;
+
+    bflb_flash_sim_init(&bench_cfg);
+    if (lfs_bench_mount(1)) {
+        return 1;
+    }
+    memset(buf, 0x5a, sizeof(buf));
+    for (uint32_t d = 0; d < LFS_META_DIR_NUM; d++) {
+        snprintf(name, sizeof(name), "d%u", d);
+        lfs_mkdir(&bench_lfs, name);
+        for (uint32_t f = 0; f < LFS_META_FILE_NUM; f++) {
+            snprintf(name, sizeof(name), "d%u/cfg%u", d, f);
+            if (lfs_file_open(&bench_lfs, &file, name, LFS_O_WRONLY | LFS_O_CREAT) ||
+                (lfs_file_write(&bench_lfs, &file, buf, 48) != 48) || lfs_file_close(&bench_lfs, &file)) {
+                return 1;
+            }
+        }
+    }
+
+    bflb_flash_sim_reset_stat();
+    if (lfs_bench_mount(0)) {
+        return 1;
+    }
+    printf("mount           %8llu us %6u reads\n", (unsigned long long)bench_sim_us(), bench_sim_reads());
+
+    start_us = bench_sim_us();
+    start_reads = bench_sim_reads();
+    for (uint32_t i = 0; i < files; i++) {
+        snprintf(name, sizeof(name), "d%u/cfg%u", i % LFS_META_DIR_NUM, i / LFS_META_DIR_NUM);
+        if (lfs_stat(&bench_lfs, name, &info)) {
+            return 1;
+        }
+    }
+    printf("stat            %8llu us %6u reads per file\n", (unsigned long long)(bench_sim_us() - start_us) / files,
+           (bench_sim_reads() - start_reads) / files);
+
+    start_us = bench_sim_us();
+    start_reads = bench_sim_reads();
+    for (uint32_t i = 0; i < files; i++) {
+        snprintf(name, sizeof(name), "d%u/cfg%u", i % LFS_META_DIR_NUM, i / LFS_META_DIR_NUM);
+        if (lfs_file_open(&bench_lfs, &file, name, LFS_O_RDONLY) ||
+            (lfs_file_read(&bench_lfs, &file, buf, sizeof(buf)) != 48) || lfs_file_close(&bench_lfs, &file)) {
+            return 1;
+        }
+    }
+    printf("open+read+close %8llu us %6u reads per file\n", (unsigned long long)(bench_sim_us() - start_us) / files,
+           (bench_sim_reads() - start_reads) / files);
+
+    start_us = bench_sim_us();
+    for (uint32_t d = 0; d < LFS_META_DIR_NUM; d++) {
+        snprintf(name, sizeof(name), "d%u", d);
+        if (lfs_dir_open(&bench_lfs, &dir, name)) {
+            return 1;
+        }
+        while (lfs_dir_read(&bench_lfs, &dir, &info) > 0) {
+            entries++;
+        }
+        lfs_dir_close(&bench_lfs, &dir);
+    }
+    printf("list            %8llu us for %u entries\n", (unsigned long long)(bench_sim_us() - start_us), entries);
+
+    bflb_flash_sim_reset_stat();
+    if (lfs_file_open(&bench_lfs, &file, "log", LFS_O_WRONLY | LFS_O_CREAT | LFS_O_APPEND)) {
+        return 1;
+    }
+    for (uint32_t i = 0; i < LFS_META_APPEND_NUM; i++) {
+        if ((lfs_file_write(&bench_lfs, &file, buf, sizeof(buf)) != sizeof(buf)) || lfs_file_sync(&bench_lfs, &file)) {
+            return 1;
+        }
+    }
+    lfs_file_close(&bench_lfs, &file);
+    bflb_flash_sim_get_stat(&stat);
+    printf("append+sync     %8llu B/s, %u page programs for %u records\n",
+           (unsigned long long)(LFS_META_APPEND_NUM * sizeof(buf) * 1000000ull / (stat.time_us ? stat.time_us : 1)),
+           stat.prog_pages, LFS_META_APPEND_NUM);
+
+#ifdef CONFIG_LITTLEFS_CACHE_SIZE
+    lfs_xip_flash_cache_stat_t cache;
+
+    lfs_xip_flash_cache_stat(&cache);
+    printf("cache %u bytes: hit %u miss %u readahead %u bypass %u, prog %u -> %u, erase %u\n",
+           CONFIG_LITTLEFS_CACHE_SIZE, cache.read_hit, cache.read_miss, cache.readahead, cache.read_bypass,
+           cache.prog_call, cache.prog_flush, cache.erase);
+#endif
+
+    /* the image must be the same for littlefs with or without the port cache */
+    if (lfs_bench_mount(0) || lfs_stat(&bench_lfs, "log", &info) ||
+        (info.size != LFS_META_APPEND_NUM * sizeof(buf))) {
+        printf("verify failed\n");
+        return 1;
+    }
+    return 0;
+}
+
+/* worst ef_set_env latency with the GC in the set, or with ef_env_gc_step between sets */
+static int bench_child_gc_step(const bench_backend_t *backend, uint32_t arg)
+{
+    bflb_flash_sim_stat_t stat;
+    bench_record_t rec;
+    uint64_t start_us, set_us = 0, set_max = 0, step_us = 0, step_max = 0;
+    uint32_t step_reads_max = 0, steps = 0, erases;
+
+    bflb_flash_sim_init(&bench_cfg);
+    if (backend->mount(1) || bench_populate(backend)) {
+        return 1;
+    }
+    bflb_flash_sim_reset_stat();
+    srand(1);
+    for (uint32_t i = 1; i <= bench_ops; i++) {
+        start_us = bench_sim_us();
+        bench_fill(&rec, rand() % bench_keys, i);
+        if (backend->set(rec.key, &rec)) {
+            return 1;
+        }
+        start_us = bench_sim_us() - start_us;
+        set_us += start_us;
+        if (start_us > set_max) {
+            set_max = start_us;
+        }
+#ifdef EF_GC_INCREMENTAL
+        uint32_t start_reads = bench_sim_reads();
+
+        start_us = bench_sim_us();
+        if (ef_env_gc_step(1)) {
+            steps++;
+            start_us = bench_sim_us() - start_us;
+            step_us += start_us;
+            if (start_us > step_max) {
+                step_max = start_us;
+            }
+            if (bench_sim_reads() - start_reads > step_reads_max) {
+                step_reads_max = bench_sim_reads() - start_reads;
+            }
+        }
+#endif
+    }
+    bflb_flash_sim_get_stat(&stat);
+    erases = stat.erase_count;
+
+    printf("%-11s %8llu %8llu %6u %8llu %8llu %10u %6u %6s\n",
+#ifdef EF_GC_INCREMENTAL
+           "incremental",
+#else
+           "foreground",
+#endif
+           (unsigned long long)(set_us / bench_ops), (unsigned long long)set_max, steps,
+           (unsigned long long)(steps ? step_us / steps : 0), (unsigned long long)step_max, step_reads_max, erases,
+           bench_verify(backend) ? "BAD" : "ok");
+    return 0;
+}
+
+static void bench_usage(const char *name)
+{
+    printf("usage: %s [-n ops] [-k keys] [-p trials] [-s] [-l] [-g] [-x]\n"
+           "  -n  random updates after the keys are written, default 2000\n"
+           "  -k  number of keys, default 64\n"
+           "  -p  power cut trials per backend, default 0\n"
+           "  -s  AND data on program over 0 bits instead of failing\n"
+           "  -l  littlefs metadata bench: mount, stat, open, list and append latency\n"
+           "  -g  easyflash4 set latency with the GC in the set, or ef_env_gc_step between sets\n"
+           "  -x  cut the power at every byte of an easyflash4 ef_txn_commit after the updates\n",
+           name);
+}
+
+int main(int argc, char **argv)
+{
+    int opt, meta = 0, gc_step = 0, txn = 0;
+
+    while ((opt = getopt(argc, argv, "n:k:p:slgxh")) != -1) {
+        switch (opt) {
+            case 'n':
+                bench_ops = strtoul(optarg, NULL, 0);
+                break;
+            case 'k':
+                bench_keys = strtoul(optarg, NULL, 0);
+                break;
+            case 'p':
+                bench_trials = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                bench_cfg.strict = 0;
+                break;
+            case 'l':
+                meta = 1;
+                break;
+            case 'g':
+                gc_step = 1;
+                break;
+            case 'x':
+                txn = 1;
+                break;
+            default:
+                bench_usage(argv[0]);
+                return 1;
+        }
+    }
+    if ((bench_ops == 0) || (bench_keys == 0) || (txn && (bench_keys <= BENCH_TXN_SETS))) {
+        bench_usage(argv[0]);
+        return 1;
+    }
+
+    if (meta) {
+        return bench_fork(bench_child_lfs_meta, &bench_backend[BENCH_BACKEND_LFS], 0);
+    }
+    if (gc_step) {
+        printf("%-11s %8s %8s %6s %8s %8s %10s %6s %6s\n", "gc", "set avg", "set max", "steps", "step avg",
+               "step max", "step reads", "erases", "verify");
+        return bench_fork(bench_child_gc_step, &bench_backend[0], 0);
+    }
+    if (txn) {
+        bench_txn_power_loss(&bench_backend[0]);
+        return 0;
+    }
+
+    printf("flash %uKB, sector %u, page %u, %u keys, %u updates of %u bytes\n",
+           BENCH_FLASH_SIZE / 1024, bench_cfg.sector_size, bench_cfg.page_size, bench_keys, bench_ops,
+           (unsigned)sizeof(bench_record_t));
+    printf("%-10s %6s %8s %13s %8s %8s %10s %6s\n", "backend", "WA", "erases", "wear max/avg",
+           "avg us", "max us", "mount us", "verify");
+
+    for (size_t i = 0; i < sizeof(bench_backend) / sizeof(bench_backend[0]); i++) {
+        bench_fork(bench_child_run, &bench_backend[i], 0);
+    }
+    if (bench_trials) {
+        for (size_t i = 0; i < sizeof(bench_backend) / sizeof(bench_backend[0]); i++) {
+            bench_power_loss(&bench_backend[i]);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,11 @@
+/* host stand-in of the lhal flash driver, the ports built by flash_bench run on the simulator */
+#ifndef _BFLB_FLASH_H
+#define _BFLB_FLASH_H
+
+#include "bflb_flash_sim.h"
+
+#define bflb_flash_erase bflb_flash_sim_erase
+#define bflb_flash_write bflb_flash_sim_write
+#define bflb_flash_read  bflb_flash_sim_read
+
+#endif
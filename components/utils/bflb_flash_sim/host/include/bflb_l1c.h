@@ -0,0 +1,5 @@
+/* host stand-in, no cache to maintain on host */
+#ifndef _BFLB_L1C_H
+#define _BFLB_L1C_H
+
+#endif
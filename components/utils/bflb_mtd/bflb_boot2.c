@@ -25,6 +25,10 @@ int bflb_boot2_update_ptable(bflb_partition_config_t *ptEntry_hal)
     ptEntry->active_index = !ptEntry->active_index;
     (ptEntry->age)++;
     ret = pt_table_update_entry(!boot2_partition_table.partition_active_idx, &boot2_partition_table.table, ptEntry);
+    if (ret == PT_ERROR_SUCCESS) {
+        /* the table in RAM is now the one just written, the next update goes to the other */
+        boot2_partition_table.partition_active_idx = !boot2_partition_table.partition_active_idx;
+    }
     return ret;
 }
 
@@ -263,7 +267,9 @@ void bflb_update_mfg_ptable(void)
             if (ptEntry_fw.start_address[1] == ptEntry_media.start_address[0]) {
 
                 memset(ptEntry_media.name, 0, sizeof(ptEntry_media.name));
-                pt_table_update_entry(!boot2_partition_table.partition_active_idx, &boot2_partition_table.table, &ptEntry_media);
+                if (PT_ERROR_SUCCESS == pt_table_update_entry(!boot2_partition_table.partition_active_idx, &boot2_partition_table.table, &ptEntry_media)) {
+                    boot2_partition_table.partition_active_idx = !boot2_partition_table.partition_active_idx;
+                }
 
                 printf("===== update mfg partition =====\r\n");
             }
@@ -11,6 +11,10 @@ struct bflb_mtd_handle_priv {
 };
 typedef struct bflb_mtd_handle_priv *bflb_mtd_handle_priv_t;
 
+static bflb_mtd_flash_erase_t mtd_flash_erase = bflb_flash_erase;
+static bflb_mtd_flash_write_t mtd_flash_write = bflb_flash_write;
+static bflb_mtd_flash_read_t mtd_flash_read = bflb_flash_read;
+
 static void __dump_mtd_handle(bflb_mtd_handle_priv_t handle_prv)
 {
     printf(  "[MTD] >>>>>> Hanlde info Dump >>>>>>\r\n");
@@ -36,7 +40,7 @@ static int _mtd_write_copy2ram(uint32_t addr, uint8_t *src, unsigned int len)
 
         memcpy(buf_tmp, src, len_tmp);
 
-        bflb_flash_write(addr, buf_tmp, len_tmp);
+        mtd_flash_write(addr, buf_tmp, len_tmp);
 
         addr += len_tmp;
         src += len_tmp;
@@ -49,7 +53,7 @@ static int _mtd_write_copy2ram(uint32_t addr, uint8_t *src, unsigned int len)
 static int _mtd_write(uint32_t addr, uint8_t *src, unsigned int len)
 {
 
-    bflb_flash_write(addr, src, len);
+    mtd_flash_write(addr, src, len);
 
     return 0;
 }
@@ -90,6 +94,14 @@ void bflb_mtd_init(void)
     bflb_boot2_init();
 }
 
+void bflb_mtd_set_flash_operation(bflb_mtd_flash_erase_t erase, bflb_mtd_flash_write_t write, bflb_mtd_flash_read_t read)
+{
+    /* NULL restores the on-chip flash driver */
+    mtd_flash_erase = erase ? erase : bflb_flash_erase;
+    mtd_flash_write = write ? write : bflb_flash_write;
+    mtd_flash_read = read ? read : bflb_flash_read;
+}
+
 int bflb_mtd_open(const char *name, bflb_mtd_handle_t *handle, unsigned int flags)
 {
     uint32_t addr = 0;
@@ -177,7 +189,7 @@ int bflb_mtd_erase(bflb_mtd_handle_t handle, unsigned int addr, unsigned int siz
 {
     bflb_mtd_handle_priv_t handle_prv = (bflb_mtd_handle_priv_t)handle;
 
-    bflb_flash_erase(
+    mtd_flash_erase(
             handle_prv->offset + addr,
             size
     );
@@ -189,7 +201,7 @@ int bflb_mtd_erase_all(bflb_mtd_handle_t handle)
 {
     bflb_mtd_handle_priv_t handle_prv = (bflb_mtd_handle_priv_t)handle;
 
-    bflb_flash_erase(
+    mtd_flash_erase(
             handle_prv->offset + 0,
             handle_prv->size
     );
@@ -216,7 +228,7 @@ int bflb_mtd_read(bflb_mtd_handle_t handle,  unsigned int addr, unsigned int siz
 {
     bflb_mtd_handle_priv_t handle_prv = (bflb_mtd_handle_priv_t)handle;
 
-    bflb_flash_read(
+    mtd_flash_read(
             handle_prv->offset + addr,
             data,
             size
@@ -16,7 +16,13 @@ typedef struct {
 #define BFLB_MTD_OPEN_FLAG_BACKUP        (1 << 0)
 #define BFLB_MTD_OPEN_FLAG_BUSADDR       (1 << 1)
 
+/* same prototype as bflb_flash_erase/write/read */
+typedef int (*bflb_mtd_flash_erase_t)(uint32_t addr, uint32_t len);
+typedef int (*bflb_mtd_flash_write_t)(uint32_t addr, uint8_t *data, uint32_t len);
+typedef int (*bflb_mtd_flash_read_t)(uint32_t addr, uint8_t *data, uint32_t len);
+
 void bflb_mtd_init(void);
+void bflb_mtd_set_flash_operation(bflb_mtd_flash_erase_t erase, bflb_mtd_flash_write_t write, bflb_mtd_flash_read_t read);
 int bflb_mtd_open(const char *name, bflb_mtd_handle_t *handle, unsigned int flags);
 int bflb_mtd_close(bflb_mtd_handle_t handle);
 int bflb_mtd_info(bflb_mtd_handle_t handle, bflb_mtd_info_t *info);
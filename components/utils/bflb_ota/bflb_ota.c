@@ -6,6 +6,9 @@
 #include <bflb_mtd.h>
 #include <bflb_ota.h>
 #include <bflb_flash.h>
+#ifdef BFLB_OTA_XZ
+#include <xz_decompress.h>
+#endif
 
 typedef struct ota_parm_s 
 {
@@ -167,7 +170,7 @@ int bflb_ota_finish(uint8_t check_hash)
     if (pt_table_get_active_entries_by_name(&pt_table_stuff[active_id], (uint8_t *)BL_MTD_PARTITION_NAME_FW_DEFAULT, &pt_fw_entry))
     {
         printf("PtTable_Get_Active_Entries fail\r\n");
-        blfb_mtd_close(ota_parm->mtd_handle);
+        bflb_mtd_close(ota_parm->mtd_handle);
         free(ota_parm);
         ota_parm = NULL;
         return -1;
@@ -186,7 +189,7 @@ int bflb_ota_finish(uint8_t check_hash)
 
         r_buf = malloc(CHECK_IMG_BUF_SIZE);
         if (r_buf == NULL) {
-            blfb_mtd_close(ota_parm->mtd_handle);
+            bflb_mtd_close(ota_parm->mtd_handle);
             free(ota_parm);
             ota_parm = NULL;
             printf("malloc error\r\n");
@@ -201,7 +204,7 @@ int bflb_ota_finish(uint8_t check_hash)
         offset = 0;
         while (offset < bin_size) {
             (bin_size - offset >= CHECK_IMG_BUF_SIZE) ? (read_size = CHECK_IMG_BUF_SIZE):(read_size = bin_size - offset);
-            if (blfb_mtd_read(ota_parm->mtd_handle, offset, read_size, r_buf)) {
+            if (bflb_mtd_read(ota_parm->mtd_handle, offset, read_size, r_buf)) {
                 printf("mtd read failed\r\n");
                 bflb_mtd_close(ota_parm->mtd_handle);
                 free(ota_parm);
@@ -217,7 +220,7 @@ int bflb_ota_finish(uint8_t check_hash)
         utils_sha256_finish(&sha256_ctx, sha_check);
         free(r_buf);
 
-        blfb_mtd_read(ota_parm->mtd_handle, offset, 32, dst_sha);
+        bflb_mtd_read(ota_parm->mtd_handle, offset, 32, dst_sha);
         for (i = 0; i < 32; i++) {
             printf("%02X", dst_sha[i]);
         }
@@ -247,7 +250,7 @@ int bflb_ota_finish(uint8_t check_hash)
         printf("pt table update fail! %d\r\n", status);
     }
 
-    blfb_mtd_close(ota_parm->mtd_handle);
+    bflb_mtd_close(ota_parm->mtd_handle);
     free(ota_parm);
     ota_parm = NULL;
 
@@ -266,7 +269,7 @@ int bflb_ota_read(uint32_t offset, uint8_t *buf, uint32_t buf_len)
         return -1;
     }
 
-    return blfb_mtd_read(ota_parm->mtd_handle, offset, buf_len, buf);
+    return bflb_mtd_read(ota_parm->mtd_handle, offset, buf_len, buf);
 }
 
 int bflb_ota_check(void)
@@ -278,7 +281,7 @@ int bflb_ota_check(void)
     uint32_t bin_size; 
 
     if (ota_parm->file_size <= 32) {
-        blfb_mtd_close(ota_parm->mtd_handle);
+        bflb_mtd_close(ota_parm->mtd_handle);
         free(ota_parm);
         ota_parm = NULL;
         return -1;
@@ -296,7 +299,7 @@ int bflb_ota_check(void)
 
     r_buf = malloc(CHECK_IMG_BUF_SIZE);
     if (r_buf == NULL) {
-        blfb_mtd_close(ota_parm->mtd_handle);
+        bflb_mtd_close(ota_parm->mtd_handle);
         free(ota_parm);
         ota_parm = NULL;
         printf("malloc error\r\n");
@@ -311,9 +314,9 @@ int bflb_ota_check(void)
     offset = 0;
     while (offset < bin_size) {
         (bin_size - offset >= CHECK_IMG_BUF_SIZE) ? (read_size = CHECK_IMG_BUF_SIZE):(read_size = bin_size - offset);
-        if (blfb_mtd_read(ota_parm->mtd_handle, offset, read_size, r_buf)) {
+        if (bflb_mtd_read(ota_parm->mtd_handle, offset, read_size, r_buf)) {
             printf("mtd read failed\r\n");
-            blfb_mtd_close(ota_parm->mtd_handle);
+            bflb_mtd_close(ota_parm->mtd_handle);
             free(ota_parm);
             ota_parm = NULL;
             free(r_buf);
@@ -327,7 +330,7 @@ int bflb_ota_check(void)
     utils_sha256_finish(&sha256_ctx, sha_check);
     free(r_buf);
 
-    blfb_mtd_read(ota_parm->mtd_handle, offset, 32, dst_sha);
+    bflb_mtd_read(ota_parm->mtd_handle, offset, 32, dst_sha);
     for (i = 0; i < 32; i++) {
         printf("%02X", dst_sha[i]);
     }
@@ -338,7 +341,7 @@ int bflb_ota_check(void)
 
     if (memcmp(sha_check, (const void *)dst_sha, 32) != 0) {
         printf("sha256 check error\r\n");
-        blfb_mtd_close(ota_parm->mtd_handle);
+        bflb_mtd_close(ota_parm->mtd_handle);
         free(ota_parm);
         ota_parm = NULL;
         utils_sha256_free(&sha256_ctx);
@@ -362,7 +365,7 @@ int bflb_ota_apply(void)
     int status = 0;
     
     if (ota_parm->file_size <= 32) {
-        blfb_mtd_close(ota_parm->mtd_handle);
+        bflb_mtd_close(ota_parm->mtd_handle);
         free(ota_parm);
         ota_parm = NULL;
         return -1;
@@ -382,7 +385,7 @@ int bflb_ota_apply(void)
     if (pt_table_get_active_entries_by_name(&pt_table_stuff[active_id], (uint8_t *)BL_MTD_PARTITION_NAME_FW_DEFAULT, &pt_fw_entry))
     {
         printf("PtTable_Get_Active_Entries fail\r\n");
-        blfb_mtd_close(ota_parm->mtd_handle);
+        bflb_mtd_close(ota_parm->mtd_handle);
         free(ota_parm);
         ota_parm = NULL;
         return -1;
@@ -397,7 +400,7 @@ int bflb_ota_apply(void)
         printf("pt table update fail! %d\r\n", status);
     }
 
-    blfb_mtd_close(ota_parm->mtd_handle);
+    bflb_mtd_close(ota_parm->mtd_handle);
     free(ota_parm);
     ota_parm = NULL;
     return 0;
@@ -406,9 +409,772 @@ void bflb_ota_abort(void)
 {
     if (ota_parm != NULL) 
     {
-        blfb_mtd_close(ota_parm->mtd_handle);
+        bflb_mtd_close(ota_parm->mtd_handle);
         free(ota_parm);
         ota_parm = NULL;
     }
 
-}
\ No newline at end of file
+}
+
+/*
+ * Streaming writer. Data must arrive in order, it is hashed as it is programmed
+ * so finish only reads the 32 byte trailer back. Two buffers let the caller
+ * receive into one while the other is programmed, and idle poll calls erase
+ * sectors ahead of the write cursor. Every BFLB_OTA_STREAM_CKPT_INTERVAL bytes
+ * the hash state is saved in the last two sectors of the partition, so a
+ * download with the same tag resumes from there after a reset or an abort.
+ *
+ * With BFLB_OTA_STREAM_FLAG_XZ and/or BFLB_OTA_STREAM_FLAG_DELTA the data is
+ * decoded in front of the buffers: an .xz stream (CRC32 or no check, LZMA2
+ * dictionary up to BFLB_OTA_XZ_DICT_MAX, the RISC-V BCJ filter when xz is
+ * built with CONFIG_XZ_BCJ_RISCV) and/or a patch against the image in
+ * the active FW partition, made by tools/ota_pack.py. Such downloads can not
+ * be resumed, the decoder state is not saved.
+ */
+#ifndef BFLB_OTA_STREAM_BUF_SIZE
+#define BFLB_OTA_STREAM_BUF_SIZE        4096
+#endif
+#ifndef BFLB_OTA_STREAM_ERASE_AHEAD
+#define BFLB_OTA_STREAM_ERASE_AHEAD     4
+#endif
+#ifndef BFLB_OTA_STREAM_CKPT_INTERVAL
+#define BFLB_OTA_STREAM_CKPT_INTERVAL   0x10000
+#endif
+
+#ifndef BFLB_OTA_XZ_DICT_MAX
+#define BFLB_OTA_XZ_DICT_MAX            0x8000
+#endif
+#define BFLB_OTA_DEC_BUF_SIZE           512
+
+#define BFLB_OTA_SECTOR_SIZE            4096
+#define BFLB_OTA_CKPT_MAGIC             0x4b43544f /* "OTCK" */
+#define BFLB_OTA_CKPT_SLOT_SIZE         256
+#define BFLB_OTA_CKPT_SLOT_NUM          (2 * BFLB_OTA_SECTOR_SIZE / BFLB_OTA_CKPT_SLOT_SIZE)
+#define BFLB_OTA_DELTA_MAGIC            0x4c444642 /* "BFDL" */
+#define BFLB_OTA_DELTA_VERSION          1
+#define BFLB_OTA_SECTOR_ALIGN(x)        (((x) + BFLB_OTA_SECTOR_SIZE - 1) / BFLB_OTA_SECTOR_SIZE * BFLB_OTA_SECTOR_SIZE)
+
+#if (BFLB_OTA_STREAM_BUF_SIZE % BFLB_OTA_SECTOR_SIZE)
+#error "BFLB_OTA_STREAM_BUF_SIZE must be a multiple of the sector size"
+#endif
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t tag;
+    uint32_t file_size;
+    uint32_t offset;        /* bytes programmed and hashed, buffer aligned */
+    sha256_context sha;     /* hash state at offset */
+    uint32_t crc;
+} bflb_ota_ckpt_t;
+
+/* patch header, then records of a ctrl, diff_len diff bytes and extra_len new bytes */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t old_size;      /* bytes of the active partition the patch reads */
+    uint32_t new_size;
+    uint8_t old_sha[32];    /* SHA-256 of those bytes */
+} bflb_ota_delta_hdr_t;
+
+typedef struct {
+    uint32_t diff_len;      /* new byte = old byte + diff byte, old cursor advances */
+    uint32_t extra_len;     /* new bytes taken as they are */
+    int32_t seek;           /* then the old cursor moves by seek */
+} bflb_ota_delta_ctrl_t;
+
+enum {
+    BFLB_OTA_DELTA_HDR,
+    BFLB_OTA_DELTA_CTRL,
+    BFLB_OTA_DELTA_DIFF,
+    BFLB_OTA_DELTA_EXTRA,
+    BFLB_OTA_DELTA_DONE,
+};
+
+typedef struct {
+    uint8_t state;
+    uint32_t got;           /* bytes of hdr or ctrl collected */
+    union {
+        bflb_ota_delta_hdr_t hdr;
+        bflb_ota_delta_ctrl_t ctrl;
+        uint8_t raw[sizeof(bflb_ota_delta_hdr_t)];
+    } u;
+    uint32_t left;          /* bytes left of the diff or extra part */
+    uint32_t new_pos;
+    uint32_t old_pos;
+    uint32_t old_size;
+    uint32_t old_addr;      /* flash address of the active FW slot */
+    uint32_t old_max;
+} bflb_ota_delta_t;
+
+typedef struct {
+    bflb_mtd_handle_t mtd_handle;
+    uint32_t file_size;
+    uint32_t tag;
+    uint8_t flags;
+    uint8_t fill;           /* buffer the caller writes to */
+    uint8_t drain;          /* buffer poll programs next */
+    volatile uint8_t full[2];
+    uint32_t len[2];
+    uint32_t received;      /* bytes taken from the caller */
+    uint32_t written;       /* bytes programmed and hashed */
+    uint32_t erased;        /* [0, erased) is erased or programmed for this image */
+    uint32_t ckpt_addr;     /* 0 when resume is off */
+    uint32_t ckpt_seq;
+    uint32_t ckpt_slot;
+    uint32_t ckpt_written;
+    sha256_context sha;
+    uint8_t buf[2][BFLB_OTA_STREAM_BUF_SIZE];
+#ifdef BFLB_OTA_XZ
+    xz_ctx_t xz;
+    uint8_t xz_end;
+#endif
+    bflb_ota_delta_t *delta;
+    uint32_t patch_pos;     /* xz output not yet taken by the delta stage */
+    uint32_t patch_len;
+    uint8_t patch[BFLB_OTA_DEC_BUF_SIZE];
+    uint32_t out_pos;       /* decoded image bytes not yet taken by the buffers */
+    uint32_t out_len;
+    uint8_t out[BFLB_OTA_DEC_BUF_SIZE];
+} bflb_ota_stream_t;
+
+static bflb_ota_stream_t *ota_stream = NULL;
+
+static void bflb_ota_stream_free(void)
+{
+#ifdef BFLB_OTA_XZ
+    if (ota_stream->xz.dec != NULL) {
+        xz_ctx_end(&ota_stream->xz);
+    }
+#endif
+    free(ota_stream->delta);
+    bflb_mtd_close(ota_stream->mtd_handle);
+    utils_sha256_free(&ota_stream->sha);
+    free(ota_stream);
+    ota_stream = NULL;
+}
+
+static int bflb_ota_ckpt_valid(bflb_ota_ckpt_t *ckpt)
+{
+    return (ckpt->magic == BFLB_OTA_CKPT_MAGIC) &&
+           (ckpt->crc == bflb_soft_crc32((uint8_t *)ckpt, sizeof(bflb_ota_ckpt_t) - 4));
+}
+
+/* find the newest checkpoint of this download, return the offset to resume from */
+static uint32_t bflb_ota_ckpt_load(void)
+{
+    bflb_ota_ckpt_t ckpt;
+    uint32_t i, best = BFLB_OTA_CKPT_SLOT_NUM, best_seq = 0;
+
+    for (i = 0; i < BFLB_OTA_CKPT_SLOT_NUM; i++) {
+        bflb_mtd_read(ota_stream->mtd_handle, ota_stream->ckpt_addr + i * BFLB_OTA_CKPT_SLOT_SIZE, sizeof(ckpt), (uint8_t *)&ckpt);
+        if (bflb_ota_ckpt_valid(&ckpt) && (ckpt.seq >= best_seq)) {
+            best = i;
+            best_seq = ckpt.seq;
+        }
+    }
+    if (best == BFLB_OTA_CKPT_SLOT_NUM) {
+        return 0;
+    }
+
+    /* a torn slot can not be programmed again, continue in the other sector */
+    ota_stream->ckpt_seq = best_seq;
+    ota_stream->ckpt_slot = (best / (BFLB_OTA_SECTOR_SIZE / BFLB_OTA_CKPT_SLOT_SIZE) + 1) *
+                            (BFLB_OTA_SECTOR_SIZE / BFLB_OTA_CKPT_SLOT_SIZE) % BFLB_OTA_CKPT_SLOT_NUM;
+
+    bflb_mtd_read(ota_stream->mtd_handle, ota_stream->ckpt_addr + best * BFLB_OTA_CKPT_SLOT_SIZE, sizeof(ckpt), (uint8_t *)&ckpt);
+    if ((ckpt.tag != ota_stream->tag) || (ckpt.file_size != ota_stream->file_size) ||
+        (ckpt.offset % BFLB_OTA_STREAM_BUF_SIZE) || (ckpt.offset >= ota_stream->file_size)) {
+        return 0;
+    }
+    memcpy(&ota_stream->sha, &ckpt.sha, sizeof(sha256_context));
+    return ckpt.offset;
+}
+
+static int bflb_ota_ckpt_save(void)
+{
+    bflb_ota_ckpt_t ckpt;
+    uint32_t addr = ota_stream->ckpt_addr + ota_stream->ckpt_slot * BFLB_OTA_CKPT_SLOT_SIZE;
+
+    /* the newest record stays in the other sector while this one is erased */
+    if ((addr % BFLB_OTA_SECTOR_SIZE) == 0) {
+        if (bflb_mtd_erase(ota_stream->mtd_handle, addr, BFLB_OTA_SECTOR_SIZE)) {
+            return -1;
+        }
+    }
+
+    memset(&ckpt, 0, sizeof(ckpt));
+    ckpt.magic = BFLB_OTA_CKPT_MAGIC;
+    ckpt.seq = ++ota_stream->ckpt_seq;
+    ckpt.tag = ota_stream->tag;
+    ckpt.file_size = ota_stream->file_size;
+    ckpt.offset = ota_stream->written;
+    memcpy(&ckpt.sha, &ota_stream->sha, sizeof(sha256_context));
+    ckpt.crc = bflb_soft_crc32((uint8_t *)&ckpt, sizeof(ckpt) - 4);
+
+    if (bflb_mtd_write(ota_stream->mtd_handle, addr, sizeof(ckpt), (uint8_t *)&ckpt)) {
+        return -1;
+    }
+    ota_stream->ckpt_slot = (ota_stream->ckpt_slot + 1) % BFLB_OTA_CKPT_SLOT_NUM;
+    ota_stream->ckpt_written = ota_stream->written;
+    return 0;
+}
+
+static int bflb_ota_stream_decoder_init(void)
+{
+    pt_table_entry_config pt_fw_entry;
+    pt_table_stuff_config pt_table_stuff[2];
+    pt_table_id_type active_id;
+
+    if (ota_stream->flags & BFLB_OTA_STREAM_FLAG_XZ) {
+#ifdef BFLB_OTA_XZ
+        /* ~28 KB of state from malloc, the dictionary once the stream header tells its size */
+        if (xz_ctx_init(&ota_stream->xz, XZ_DYNALLOC, BFLB_OTA_XZ_DICT_MAX, NULL, 0)) {
+            printf("xz init failed\r\n");
+            return -1;
+        }
+#else
+        printf("xz OTA is not enabled\r\n");
+        return -1;
+#endif
+    }
+
+    if (ota_stream->flags & BFLB_OTA_STREAM_FLAG_DELTA) {
+        ota_stream->delta = (bflb_ota_delta_t *)malloc(sizeof(bflb_ota_delta_t));
+        if (NULL == ota_stream->delta) {
+            printf("have not enough memory\r\n");
+            return -1;
+        }
+        memset(ota_stream->delta, 0, sizeof(bflb_ota_delta_t));
+
+        /* the patch applies to the image running now */
+        pt_table_set_flash_operation(bflb_flash_erase, bflb_flash_write, bflb_flash_read);
+        active_id = pt_table_get_active_partition_need_lock(pt_table_stuff);
+        if (PT_TABLE_ID_INVALID == active_id) {
+            printf("No valid PT\r\n");
+            return -1;
+        }
+        if (pt_table_get_active_entries_by_name(&pt_table_stuff[active_id], (uint8_t *)BL_MTD_PARTITION_NAME_FW_DEFAULT, &pt_fw_entry)) {
+            printf("PtTable_Get_Active_Entries fail\r\n");
+            return -1;
+        }
+        ota_stream->delta->old_addr = pt_fw_entry.start_address[pt_fw_entry.active_index & 0x01];
+        ota_stream->delta->old_max = pt_fw_entry.max_len[pt_fw_entry.active_index & 0x01];
+    }
+
+    return 0;
+}
+
+/**
+ * @brief start a streaming OTA to the inactive FW partition
+ * @param file_size image size, the last 32 bytes are the SHA-256 of the rest
+ *        (the decoded size for a packed download)
+ * @param tag identifies the image (e.g. a crc of its version and url), 0 disables resume
+ * @param flags BFLB_OTA_STREAM_FLAG_ASYNC when another task calls bflb_ota_stream_poll,
+ *        BFLB_OTA_STREAM_FLAG_XZ and BFLB_OTA_STREAM_FLAG_DELTA for a packed download
+ * @return offset to continue the download from (0 for a new download), or -1
+ */
+int bflb_ota_stream_start(uint32_t file_size, uint32_t tag, uint8_t flags)
+{
+    unsigned int part_size;
+    uint32_t offset = 0;
+
+    if (ota_stream != NULL) {
+        printf("ota stream had start\r\n");
+        return -1;
+    }
+    if (file_size <= 32) {
+        printf("parm is error!\r\n");
+        return -1;
+    }
+
+    ota_stream = (bflb_ota_stream_t *)malloc(sizeof(bflb_ota_stream_t));
+    if (NULL == ota_stream) {
+        printf("have not enough memory\r\n");
+        return -1;
+    }
+    memset(ota_stream, 0, sizeof(bflb_ota_stream_t));
+    ota_stream->file_size = file_size;
+    ota_stream->tag = tag;
+    ota_stream->flags = flags;
+
+    if (bflb_mtd_open(BL_MTD_PARTITION_NAME_FW_DEFAULT, &ota_stream->mtd_handle, BFLB_MTD_OPEN_FLAG_BACKUP)) {
+        printf("Open Default FW partition failed\r\n");
+        free(ota_stream);
+        ota_stream = NULL;
+        return -1;
+    }
+    bflb_mtd_size(ota_stream->mtd_handle, &part_size);
+    if (file_size > part_size) {
+        printf("file size is more than partition size\r\n");
+        bflb_ota_stream_free();
+        return -1;
+    }
+
+    utils_sha256_init(&ota_stream->sha);
+    utils_sha256_starts(&ota_stream->sha);
+
+    if (flags & (BFLB_OTA_STREAM_FLAG_XZ | BFLB_OTA_STREAM_FLAG_DELTA)) {
+        if (bflb_ota_stream_decoder_init()) {
+            bflb_ota_stream_free();
+            return -1;
+        }
+        ota_stream->tag = 0;
+    }
+
+    /* checkpoints need two spare sectors after the image */
+    if (ota_stream->tag && (BFLB_OTA_SECTOR_ALIGN(file_size) + 2 * BFLB_OTA_SECTOR_SIZE <= part_size)) {
+        ota_stream->ckpt_addr = part_size / BFLB_OTA_SECTOR_SIZE * BFLB_OTA_SECTOR_SIZE - 2 * BFLB_OTA_SECTOR_SIZE;
+        offset = bflb_ota_ckpt_load();
+    } else if (tag) {
+        printf("[OTA] no room for checkpoint or packed image, resume is off\r\n");
+    }
+
+    /* data after the checkpoint may be half programmed, erase it again */
+    ota_stream->received = offset;
+    ota_stream->written = offset;
+    ota_stream->erased = offset;
+    ota_stream->ckpt_written = offset;
+
+    printf("[OTA] stream start, size %lu, resume at %lu\r\n", file_size, offset);
+    return offset;
+}
+
+/* copy image data into the buffers */
+static int bflb_ota_stream_put(const uint8_t *buf, uint32_t len)
+{
+    uint32_t n, taken = 0;
+    uint8_t fill;
+
+    if (len > ota_stream->file_size - ota_stream->received) {
+        printf("[OTA] data beyond file size\r\n");
+        return -1;
+    }
+
+    while (taken < len) {
+        fill = ota_stream->fill;
+        if (ota_stream->full[fill]) {
+            if (ota_stream->flags & BFLB_OTA_STREAM_FLAG_ASYNC) {
+                break;
+            }
+            if (bflb_ota_stream_poll() < 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        n = BFLB_OTA_STREAM_BUF_SIZE - ota_stream->len[fill];
+        if (n > len - taken) {
+            n = len - taken;
+        }
+        memcpy(ota_stream->buf[fill] + ota_stream->len[fill], buf + taken, n);
+        ota_stream->len[fill] += n;
+        ota_stream->received += n;
+        taken += n;
+
+        if ((ota_stream->len[fill] == BFLB_OTA_STREAM_BUF_SIZE) || (ota_stream->received == ota_stream->file_size)) {
+            ota_stream->full[fill] = 1;
+            ota_stream->fill = !fill;
+        }
+    }
+
+    return taken;
+}
+
+/* the active image must be the one the patch was made from */
+static int bflb_ota_delta_check(bflb_ota_delta_t *delta)
+{
+    sha256_context sha;
+    uint8_t sha_check[32];
+    uint32_t pos, n;
+
+    if ((delta->u.hdr.magic != BFLB_OTA_DELTA_MAGIC) || (delta->u.hdr.version != BFLB_OTA_DELTA_VERSION)) {
+        printf("[OTA] not a delta patch\r\n");
+        return -1;
+    }
+    if (delta->u.hdr.new_size != ota_stream->file_size) {
+        printf("[OTA] patch makes %lu bytes, file size is %lu\r\n", delta->u.hdr.new_size, ota_stream->file_size);
+        return -1;
+    }
+    if (delta->u.hdr.old_size > delta->old_max) {
+        printf("[OTA] patch base is larger than the partition\r\n");
+        return -1;
+    }
+
+    /* out is empty while the header is parsed */
+    utils_sha256_init(&sha);
+    utils_sha256_starts(&sha);
+    for (pos = 0; pos < delta->u.hdr.old_size; pos += n) {
+        n = delta->u.hdr.old_size - pos;
+        if (n > BFLB_OTA_DEC_BUF_SIZE) {
+            n = BFLB_OTA_DEC_BUF_SIZE;
+        }
+        bflb_flash_read(delta->old_addr + pos, ota_stream->out, n);
+        utils_sha256_update(&sha, ota_stream->out, n);
+    }
+    utils_sha256_finish(&sha, sha_check);
+    utils_sha256_free(&sha);
+    if (memcmp(sha_check, delta->u.hdr.old_sha, 32) != 0) {
+        printf("[OTA] patch base mismatch, the active image differs\r\n");
+        return -1;
+    }
+
+    delta->old_size = delta->u.hdr.old_size;
+    return 0;
+}
+
+/* turn patch bytes into image bytes in out, return the patch bytes used */
+static int bflb_ota_delta_step(const uint8_t *in, uint32_t len)
+{
+    bflb_ota_delta_t *delta = ota_stream->delta;
+    uint32_t used = 0, need, n, i;
+    uint8_t *out;
+
+    while ((used < len) && (ota_stream->out_len < BFLB_OTA_DEC_BUF_SIZE)) {
+        switch (delta->state) {
+            case BFLB_OTA_DELTA_HDR:
+            case BFLB_OTA_DELTA_CTRL:
+                need = (delta->state == BFLB_OTA_DELTA_HDR) ? sizeof(bflb_ota_delta_hdr_t) : sizeof(bflb_ota_delta_ctrl_t);
+                n = (need - delta->got < len - used) ? need - delta->got : len - used;
+                memcpy(delta->u.raw + delta->got, in + used, n);
+                delta->got += n;
+                used += n;
+                if (delta->got < need) {
+                    break;
+                }
+                delta->got = 0;
+                if (delta->state == BFLB_OTA_DELTA_HDR) {
+                    if (bflb_ota_delta_check(delta)) {
+                        return -1;
+                    }
+                    delta->state = BFLB_OTA_DELTA_CTRL;
+                    break;
+                }
+                n = ota_stream->file_size - delta->new_pos;
+                if ((delta->u.ctrl.diff_len > n) || (delta->u.ctrl.extra_len > n - delta->u.ctrl.diff_len)) {
+                    printf("[OTA] bad patch record\r\n");
+                    return -1;
+                }
+                delta->left = delta->u.ctrl.diff_len;
+                delta->state = BFLB_OTA_DELTA_DIFF;
+                break;
+
+            case BFLB_OTA_DELTA_DIFF:
+                if (delta->left == 0) {
+                    delta->left = delta->u.ctrl.extra_len;
+                    delta->state = BFLB_OTA_DELTA_EXTRA;
+                    break;
+                }
+                n = BFLB_OTA_DEC_BUF_SIZE - ota_stream->out_len;
+                n = (n < delta->left) ? n : delta->left;
+                n = (n < len - used) ? n : len - used;
+                if ((delta->old_pos > delta->old_size) || (n > delta->old_size - delta->old_pos)) {
+                    printf("[OTA] patch reads beyond the old image\r\n");
+                    return -1;
+                }
+                out = ota_stream->out + ota_stream->out_len;
+                bflb_flash_read(delta->old_addr + delta->old_pos, out, n);
+                for (i = 0; i < n; i++) {
+                    out[i] += in[used + i];
+                }
+                ota_stream->out_len += n;
+                delta->old_pos += n;
+                delta->new_pos += n;
+                delta->left -= n;
+                used += n;
+                break;
+
+            case BFLB_OTA_DELTA_EXTRA:
+                if (delta->left == 0) {
+                    delta->old_pos += (uint32_t)delta->u.ctrl.seek;
+                    delta->state = (delta->new_pos == ota_stream->file_size) ? BFLB_OTA_DELTA_DONE : BFLB_OTA_DELTA_CTRL;
+                    break;
+                }
+                n = BFLB_OTA_DEC_BUF_SIZE - ota_stream->out_len;
+                n = (n < delta->left) ? n : delta->left;
+                n = (n < len - used) ? n : len - used;
+                memcpy(ota_stream->out + ota_stream->out_len, in + used, n);
+                ota_stream->out_len += n;
+                delta->new_pos += n;
+                delta->left -= n;
+                used += n;
+                break;
+
+            default:
+                printf("[OTA] data after the end of the patch\r\n");
+                return -1;
+        }
+    }
+
+    return used;
+}
+
+/*
+ * Run the download through xz and/or the patch into out, then into the
+ * buffers. Bytes left in out or patch when the buffers are full wait for the
+ * next call, so input is only taken while everything before it was placed.
+ */
+static int bflb_ota_stream_decode(const uint8_t *buf, uint32_t len)
+{
+    uint32_t taken = 0;
+    int n;
+#ifdef BFLB_OTA_XZ
+    uint8_t *out;
+    uint32_t in_len, out_len;
+    enum xz_ret ret;
+#endif
+
+    while (1) {
+        if (ota_stream->out_pos < ota_stream->out_len) {
+            n = bflb_ota_stream_put(ota_stream->out + ota_stream->out_pos, ota_stream->out_len - ota_stream->out_pos);
+            if (n < 0) {
+                return -1;
+            }
+            ota_stream->out_pos += n;
+            if (ota_stream->out_pos < ota_stream->out_len) {
+                break;
+            }
+        }
+        ota_stream->out_pos = 0;
+        ota_stream->out_len = 0;
+
+        if (ota_stream->patch_pos < ota_stream->patch_len) {
+            n = bflb_ota_delta_step(ota_stream->patch + ota_stream->patch_pos, ota_stream->patch_len - ota_stream->patch_pos);
+            if (n < 0) {
+                return -1;
+            }
+            ota_stream->patch_pos += n;
+            continue;
+        }
+        if (taken == len) {
+            break;
+        }
+
+#ifdef BFLB_OTA_XZ
+        if (ota_stream->flags & BFLB_OTA_STREAM_FLAG_XZ) {
+            if (ota_stream->xz_end) {
+                printf("[OTA] data after the end of the xz stream\r\n");
+                return -1;
+            }
+            out = (ota_stream->delta != NULL) ? ota_stream->patch : ota_stream->out;
+            in_len = len - taken;
+            out_len = BFLB_OTA_DEC_BUF_SIZE;
+            ret = xz_ctx_run(&ota_stream->xz, buf + taken, &in_len, out, &out_len);
+            if (ret == XZ_STREAM_END) {
+                ota_stream->xz_end = 1;
+            } else if (ret != XZ_OK) {
+                printf("[OTA] xz decode error %d\r\n", ret);
+                return -1;
+            }
+            taken += in_len;
+            if (ota_stream->delta != NULL) {
+                ota_stream->patch_pos = 0;
+                ota_stream->patch_len = out_len;
+            } else {
+                ota_stream->out_len = out_len;
+            }
+            continue;
+        }
+#endif
+
+        n = bflb_ota_delta_step(buf + taken, len - taken);
+        if (n < 0) {
+            return -1;
+        }
+        taken += n;
+    }
+
+    return taken;
+}
+
+/**
+ * @brief take download data in order, decoded first for a packed download
+ * @return bytes taken, less than len only in async mode when both buffers wait for poll, or -1
+ */
+int bflb_ota_stream_write(const uint8_t *buf, uint32_t len)
+{
+    if (ota_stream == NULL) {
+        printf("please start ota first\r\n");
+        return -1;
+    }
+    if (NULL == buf) {
+        printf("parm is error!\r\n");
+        return -1;
+    }
+
+    if (ota_stream->flags & (BFLB_OTA_STREAM_FLAG_XZ | BFLB_OTA_STREAM_FLAG_DELTA)) {
+        return bflb_ota_stream_decode(buf, len);
+    }
+    return bflb_ota_stream_put(buf, len);
+}
+
+/**
+ * @brief program a full buffer, or erase one sector ahead when there is none
+ * @return 1 when flash work was done, 0 when idle, -1 on error
+ */
+int bflb_ota_stream_poll(void)
+{
+    uint8_t drain;
+    uint32_t len, hash_len, end;
+
+    if (ota_stream == NULL) {
+        return -1;
+    }
+
+    drain = ota_stream->drain;
+    if (!ota_stream->full[drain]) {
+        end = ota_stream->written + BFLB_OTA_STREAM_ERASE_AHEAD * BFLB_OTA_SECTOR_SIZE;
+        if (end > BFLB_OTA_SECTOR_ALIGN(ota_stream->file_size)) {
+            end = BFLB_OTA_SECTOR_ALIGN(ota_stream->file_size);
+        }
+        if (ota_stream->erased >= end) {
+            return 0;
+        }
+        if (bflb_mtd_erase(ota_stream->mtd_handle, ota_stream->erased, BFLB_OTA_SECTOR_SIZE)) {
+            printf("mtd erase failed\r\n");
+            return -1;
+        }
+        ota_stream->erased += BFLB_OTA_SECTOR_SIZE;
+        return 1;
+    }
+
+    len = ota_stream->len[drain];
+    while (ota_stream->erased < ota_stream->written + len) {
+        if (bflb_mtd_erase(ota_stream->mtd_handle, ota_stream->erased, BFLB_OTA_SECTOR_SIZE)) {
+            printf("mtd erase failed\r\n");
+            return -1;
+        }
+        ota_stream->erased += BFLB_OTA_SECTOR_SIZE;
+    }
+    if (bflb_mtd_write(ota_stream->mtd_handle, ota_stream->written, len, ota_stream->buf[drain])) {
+        printf("mtd write failed\r\n");
+        return -1;
+    }
+
+    /* the trailer is not part of the hash */
+    if (ota_stream->written < ota_stream->file_size - 32) {
+        hash_len = ota_stream->file_size - 32 - ota_stream->written;
+        utils_sha256_update(&ota_stream->sha, ota_stream->buf[drain], (len < hash_len) ? len : hash_len);
+    }
+    ota_stream->written += len;
+    ota_stream->len[drain] = 0;
+    ota_stream->drain = !drain;
+    ota_stream->full[drain] = 0;
+
+    if (ota_stream->ckpt_addr && (ota_stream->written < ota_stream->file_size) &&
+        (ota_stream->written - ota_stream->ckpt_written >= BFLB_OTA_STREAM_CKPT_INTERVAL)) {
+        if (bflb_ota_ckpt_save()) {
+            printf("[OTA] checkpoint save failed\r\n");
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief program what is left, check the hash and switch the FW partition
+ * in async mode call it after the other task stopped polling
+ * @param check_hash compare the inline hash with the trailer of the image
+ */
+int bflb_ota_stream_finish(uint8_t check_hash)
+{
+    uint8_t sha_check[32];
+    uint8_t dst_sha[32];
+    uint32_t bin_size;
+    pt_table_entry_config pt_fw_entry;
+    pt_table_stuff_config pt_table_stuff[2];
+    pt_table_id_type active_id;
+    int status;
+
+    if (ota_stream == NULL) {
+        printf("please start ota first\r\n");
+        return -1;
+    }
+
+    /* decoded bytes may still wait in front of the buffers */
+    if (ota_stream->flags & (BFLB_OTA_STREAM_FLAG_XZ | BFLB_OTA_STREAM_FLAG_DELTA)) {
+        while (1) {
+            if (bflb_ota_stream_decode(NULL, 0) < 0) {
+                bflb_ota_stream_free();
+                return -1;
+            }
+            if ((ota_stream->out_pos == ota_stream->out_len) && (ota_stream->patch_pos == ota_stream->patch_len)) {
+                break;
+            }
+            if (bflb_ota_stream_poll() < 0) {
+                bflb_ota_stream_free();
+                return -1;
+            }
+        }
+#ifdef BFLB_OTA_XZ
+        if ((ota_stream->xz.dec != NULL) && !ota_stream->xz_end) {
+            printf("[OTA] xz stream truncated\r\n");
+            bflb_ota_stream_free();
+            return -1;
+        }
+#endif
+    }
+
+    while (ota_stream->full[ota_stream->drain]) {
+        if (bflb_ota_stream_poll() < 0) {
+            bflb_ota_stream_free();
+            return -1;
+        }
+    }
+    if (ota_stream->written != ota_stream->file_size) {
+        printf("[OTA] image incomplete, %lu of %lu\r\n", ota_stream->written, ota_stream->file_size);
+        bflb_ota_stream_free();
+        return -1;
+    }
+    bin_size = ota_stream->file_size - 32;
+
+    if (check_hash) {
+        utils_sha256_finish(&ota_stream->sha, sha_check);
+        bflb_mtd_read(ota_stream->mtd_handle, bin_size, 32, dst_sha);
+        if (memcmp(sha_check, dst_sha, 32) != 0) {
+            printf("sha256 check error\r\n");
+            bflb_ota_stream_free();
+            return -1;
+        }
+    }
+
+    /* a finished image must not be resumed */
+    if (ota_stream->ckpt_addr) {
+        bflb_mtd_erase(ota_stream->mtd_handle, ota_stream->ckpt_addr, 2 * BFLB_OTA_SECTOR_SIZE);
+    }
+
+    pt_table_set_flash_operation(bflb_flash_erase, bflb_flash_write, bflb_flash_read);
+    active_id = pt_table_get_active_partition_need_lock(pt_table_stuff);
+    if (PT_TABLE_ID_INVALID == active_id) {
+        printf("No valid PT\r\n");
+        bflb_ota_stream_free();
+        return -1;
+    }
+    if (pt_table_get_active_entries_by_name(&pt_table_stuff[active_id], (uint8_t *)BL_MTD_PARTITION_NAME_FW_DEFAULT, &pt_fw_entry)) {
+        printf("PtTable_Get_Active_Entries fail\r\n");
+        bflb_ota_stream_free();
+        return -1;
+    }
+
+    pt_fw_entry.len = bin_size;
+    printf("[OTA] Update PARTITION, partition len is %lu\r\n", pt_fw_entry.len);
+    pt_fw_entry.active_index = !(pt_fw_entry.active_index & 0x01);
+    pt_fw_entry.age++;
+    status = pt_table_update_entry(!active_id, &pt_table_stuff[active_id], &pt_fw_entry);
+    if (status != 0) {
+        printf("pt table update fail! %d\r\n", status);
+    }
+
+    bflb_ota_stream_free();
+    return status ? -1 : 0;
+}
+
+/**
+ * @brief stop the download, the last checkpoint is kept for a later resume
+ */
+void bflb_ota_stream_abort(void)
+{
+    if (ota_stream != NULL) {
+        bflb_ota_stream_free();
+    }
+}
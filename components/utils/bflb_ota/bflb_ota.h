@@ -13,4 +13,15 @@ int bflb_ota_read(uint32_t offset, uint8_t *buf, uint32_t buf_len);
 int bflb_ota_check(void);
 int bflb_ota_apply(void);
 void bflb_ota_abort(void);
+
+/* streaming writer, see bflb_ota_stream_start */
+#define BFLB_OTA_STREAM_FLAG_ASYNC  (1 << 0)  /* bflb_ota_stream_poll runs in another task */
+#define BFLB_OTA_STREAM_FLAG_XZ     (1 << 1)  /* data is an .xz stream, needs CONFIG_BFLB_OTA_XZ */
+#define BFLB_OTA_STREAM_FLAG_DELTA  (1 << 2)  /* data is a patch against the active FW, see tools/ota_pack.py */
+
+int bflb_ota_stream_start(uint32_t file_size, uint32_t tag, uint8_t flags);
+int bflb_ota_stream_write(const uint8_t *buf, uint32_t len);
+int bflb_ota_stream_poll(void);
+int bflb_ota_stream_finish(uint8_t check_hash);
+void bflb_ota_stream_abort(void);
 #endif
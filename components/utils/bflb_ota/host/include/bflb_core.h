@@ -0,0 +1,21 @@
+/* host stand-in of bflb_core.h for ota_bench, only what partition, mtd and ota use */
+#ifndef _BFLB_CORE_H
+#define _BFLB_CORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define arch_memcpy_fast memcpy
+
+uint32_t bflb_soft_crc32(void *in, uint32_t len);
+
+/* library logs are dropped unless ota_bench -v */
+int ota_host_printf(const char *fmt, ...);
+#define printf ota_host_printf
+#define puts(s) ota_host_printf("%s\n", s)
+
+#endif
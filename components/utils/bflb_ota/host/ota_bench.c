@@ -0,0 +1,707 @@
+/**
+ * @file ota_bench.c
+ * @brief host bench of bflb_ota on the flash simulator and a modelled network
+ *
+ * Copyright (c) 2023 Bouffalolab team
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include "bflb_core.h"
+#include "bflb_flash.h"
+#include "partition.h"
+#include "bflb_boot2.h"
+#include "bflb_mtd.h"
+#include "bflb_ota.h"
+#include "utils_sha256.h"
+
+#undef printf
+#undef puts
+
+#define BENCH_FLASH_SIZE (4 * 1024 * 1024)
+#define BENCH_FW_ADDR0   0x10000
+#define BENCH_FW_ADDR1   0x190000
+#define BENCH_FW_SIZE    0x180000
+
+static int bench_verbose = 0;
+static uint32_t bench_rate = 250;   /* network KB/s */
+static uint32_t bench_chunk = 1460; /* bytes per receive */
+static uint32_t bench_size = 1000000;
+static uint32_t bench_rand = 1;
+static uint32_t bench_cpu = 25;     /* device decode time per host decode time */
+
+static uint8_t *bench_image;
+/* packed download of bench_image (-z), made by tools/ota_pack.py */
+static uint8_t *bench_pack;
+static uint32_t bench_pack_size;
+static int bench_delta;
+/* image in the active slot before the packed download (-b) */
+static uint8_t *bench_base;
+static uint32_t bench_base_size;
+/* received data is copied out of a stack buffer, as from a socket */
+static uint8_t bench_rx[8192];
+
+static jmp_buf bench_power_jmp;
+
+typedef struct {
+    const char *name;
+    uint64_t total_us;
+    uint64_t flash_us;
+    uint64_t net_us;
+    uint64_t cpu_us;
+    uint32_t down_kb;
+    uint32_t read_kb;
+    uint32_t erases;
+    uint32_t pages;
+} bench_result_t;
+
+int ota_host_printf(const char *fmt, ...)
+{
+    va_list ap;
+    int n = 0;
+
+    if (bench_verbose) {
+        va_start(ap, fmt);
+        n = vprintf(fmt, ap);
+        va_end(ap);
+    }
+    return n;
+}
+
+uint32_t bflb_soft_crc32(void *in, uint32_t len)
+{
+    uint32_t crc = 0xffffffff;
+    uint8_t *data = (uint8_t *)in;
+    int i;
+
+    while (len--) {
+        crc ^= *data++;
+        for (i = 0; i < 8; i++) {
+            crc = (crc & 1) ? ((crc >> 1) ^ 0xEDB88320) : (crc >> 1);
+        }
+    }
+    return crc ^ 0xffffffff;
+}
+
+static uint32_t bench_random(void)
+{
+    bench_rand ^= bench_rand << 13;
+    bench_rand ^= bench_rand >> 17;
+    bench_rand ^= bench_rand << 5;
+    return bench_rand;
+}
+
+static uint64_t flash_time(void)
+{
+    bflb_flash_sim_stat_t stat;
+
+    bflb_flash_sim_get_stat(&stat);
+    return stat.time_us;
+}
+
+static uint64_t host_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+static uint64_t net_time(uint32_t len)
+{
+    return (uint64_t)len * 1000000 / (bench_rate * 1024);
+}
+
+/* two valid tables with one FW entry of two slots, slot 0 active */
+static void bench_format(void)
+{
+    pt_table_stuff_config pt;
+    uint32_t *crc;
+
+    memset(&pt, 0, sizeof(pt));
+    pt.pt_table.magicCode = BFLB_PT_MAGIC_CODE;
+    pt.pt_table.entryCnt = 1;
+    pt.pt_table.crc32 = bflb_soft_crc32(&pt.pt_table, sizeof(pt_table_config) - 4);
+    pt.pt_entries[0].type = PT_ENTRY_FW_CPU0;
+    strcpy((char *)pt.pt_entries[0].name, BL_MTD_PARTITION_NAME_FW_DEFAULT);
+    pt.pt_entries[0].start_address[0] = BENCH_FW_ADDR0;
+    pt.pt_entries[0].start_address[1] = BENCH_FW_ADDR1;
+    pt.pt_entries[0].max_len[0] = BENCH_FW_SIZE;
+    pt.pt_entries[0].max_len[1] = BENCH_FW_SIZE;
+    crc = (uint32_t *)&pt.pt_entries[1];
+    *crc = bflb_soft_crc32(pt.pt_entries, sizeof(pt_table_entry_config));
+
+    bflb_flash_sim_erase(BFLB_PT_TABLE0_ADDRESS, 2 * 4096);
+    bflb_flash_sim_write(BFLB_PT_TABLE0_ADDRESS, (uint8_t *)&pt, sizeof(pt));
+    bflb_flash_sim_write(BFLB_PT_TABLE1_ADDRESS, (uint8_t *)&pt, sizeof(pt));
+    pt_table_cache_invalidate();
+}
+
+/* what boot2 would do after a reset: reload the table and return the active FW slot */
+static int bench_reboot(void)
+{
+    pt_table_entry_config entry;
+
+    /* RAM is lost, so is the partition table cache */
+    pt_table_cache_invalidate();
+    bflb_boot2_init();
+    if (bflb_boot2_get_active_entries(PT_ENTRY_FW_CPU0, (bflb_partition_config_t *)&entry)) {
+        return -1;
+    }
+    return entry.active_index;
+}
+
+static int bench_check(int slot, const char *name)
+{
+    uint32_t addr = slot ? BENCH_FW_ADDR1 : BENCH_FW_ADDR0;
+
+    if (memcmp(bflb_flash_sim_get_memory() + addr, bench_image, bench_size)) {
+        printf("%s: image in slot %d mismatch\n", name, slot);
+        return -1;
+    }
+    return 0;
+}
+
+static void bench_begin(bench_result_t *res, const char *name)
+{
+    memset(res, 0, sizeof(*res));
+    res->name = name;
+    res->down_kb = bench_size / 1024;
+    bflb_flash_sim_reset_stat();
+}
+
+static void bench_end(bench_result_t *res)
+{
+    bflb_flash_sim_stat_t stat;
+
+    bflb_flash_sim_get_stat(&stat);
+    res->flash_us = stat.time_us;
+    res->read_kb = stat.read_bytes / 1024;
+    res->erases = stat.erase_count;
+    res->pages = stat.prog_pages;
+}
+
+static void bench_print(bench_result_t *res)
+{
+    printf("%-14s %10.1f %10.1f %10.1f %10.1f %8u %8u %8u %8u\n", res->name, res->total_us / 1e3, res->flash_us / 1e3,
+           res->net_us / 1e3, res->cpu_us / 1e3, res->down_kb, res->read_kb, res->erases, res->pages);
+}
+
+/* receive, then write, nothing overlaps */
+static int bench_legacy(bench_result_t *res)
+{
+    uint32_t off, n;
+    uint64_t t;
+    int slot = bench_reboot();
+
+    bench_begin(res, "legacy");
+    if (bflb_ota_start(bench_size)) {
+        return -1;
+    }
+    for (off = 0; off < bench_size; off += n) {
+        n = (bench_size - off < bench_chunk) ? bench_size - off : bench_chunk;
+        memcpy(bench_rx, bench_image + off, n);
+        res->net_us += net_time(n);
+        if (bflb_ota_update(bench_size, off, bench_rx, n)) {
+            return -1;
+        }
+    }
+    t = flash_time();
+    if (bflb_ota_finish(1)) {
+        return -1;
+    }
+    bench_end(res);
+    res->total_us = res->net_us + res->flash_us;
+    printf("  legacy finish re-reads the image: %.1f ms\n", (flash_time() - t) / 1e3);
+
+    if (bench_reboot() != !slot) {
+        printf("legacy: partition not switched\n");
+        return -1;
+    }
+    return bench_check(!slot, res->name);
+}
+
+/*
+ * Download [from, to) of src in async mode. The receiver and the flash writer
+ * each keep a clock, the writer works only on data already received and the
+ * receiver stalls when both buffers wait for the writer. Decoding runs on the
+ * receiver clock, host time scaled by -k.
+ */
+static int bench_stream_run(bench_result_t *res, const uint8_t *src, uint32_t from, uint32_t to)
+{
+    uint64_t net = 0, flash = 0, t, cpu;
+    uint32_t off, n, done;
+    int ret;
+
+    for (off = from; off < to; off += n) {
+        n = (to - off < bench_chunk) ? to - off : bench_chunk;
+        memcpy(bench_rx, src + off, n);
+        net += net_time(n);
+        res->net_us += net_time(n);
+
+        /* the writer catches up with the receiver, or erases ahead while idle */
+        while (flash < net) {
+            t = flash_time();
+            ret = bflb_ota_stream_poll();
+            if (ret < 0) {
+                return -1;
+            }
+            if (ret == 0) {
+                flash = net;
+                break;
+            }
+            flash += flash_time() - t;
+        }
+
+        for (done = 0; done < n;) {
+            t = host_time();
+            ret = bflb_ota_stream_write(bench_rx + done, n - done);
+            cpu = (host_time() - t) * bench_cpu;
+            net += cpu;
+            res->cpu_us += cpu;
+            if (ret < 0) {
+                return -1;
+            }
+            done += ret;
+            if (done < n) {
+                /* both buffers full, wait for one to be programmed */
+                t = flash_time();
+                if (bflb_ota_stream_poll() < 0) {
+                    return -1;
+                }
+                flash += flash_time() - t;
+                if (net < flash) {
+                    net = flash;
+                }
+            }
+        }
+    }
+
+    res->total_us += (net > flash) ? net : flash;
+    return 0;
+}
+
+static int bench_stream_finish(bench_result_t *res)
+{
+    uint64_t t = flash_time();
+
+    if (bflb_ota_stream_finish(1)) {
+        return -1;
+    }
+    res->total_us += flash_time() - t;
+    return 0;
+}
+
+static int bench_stream_sync(bench_result_t *res)
+{
+    uint32_t off, n;
+    int slot = bench_reboot();
+
+    bench_begin(res, "stream sync");
+    if (bflb_ota_stream_start(bench_size, 0, 0) != 0) {
+        return -1;
+    }
+    for (off = 0; off < bench_size; off += n) {
+        n = (bench_size - off < bench_chunk) ? bench_size - off : bench_chunk;
+        memcpy(bench_rx, bench_image + off, n);
+        res->net_us += net_time(n);
+        if (bflb_ota_stream_write(bench_rx, n) != n) {
+            return -1;
+        }
+    }
+    if (bflb_ota_stream_finish(1)) {
+        return -1;
+    }
+    bench_end(res);
+    res->total_us = res->net_us + res->flash_us;
+
+    if (bench_reboot() != !slot) {
+        printf("stream sync: partition not switched\n");
+        return -1;
+    }
+    return bench_check(!slot, res->name);
+}
+
+static int bench_stream_async(bench_result_t *res)
+{
+    int slot = bench_reboot();
+
+    bench_begin(res, "stream async");
+    if (bflb_ota_stream_start(bench_size, 0x1234, BFLB_OTA_STREAM_FLAG_ASYNC) != 0) {
+        return -1;
+    }
+    if (bench_stream_run(res, bench_image, 0, bench_size) || bench_stream_finish(res)) {
+        return -1;
+    }
+    bench_end(res);
+
+    if (bench_reboot() != !slot) {
+        printf("stream async: partition not switched\n");
+        return -1;
+    }
+    return bench_check(!slot, res->name);
+}
+
+/* the link drops several times, every restart resumes from the last checkpoint */
+static int bench_resume(bench_result_t *res, int drops)
+{
+    uint32_t off = 0, cut;
+    uint64_t resent = 0;
+    int i, start, slot = bench_reboot();
+
+    bench_begin(res, "stream resume");
+    for (i = 0; i <= drops; i++) {
+        start = bflb_ota_stream_start(bench_size, 0x5678, BFLB_OTA_STREAM_FLAG_ASYNC);
+        if ((start < 0) || (start > off)) {
+            printf("resume: bad resume offset %d, had %u\n", start, off);
+            return -1;
+        }
+        resent += off - start;
+        cut = (i < drops) ? start + bench_random() % (bench_size - start) : bench_size;
+        if (bench_stream_run(res, bench_image, start, cut)) {
+            return -1;
+        }
+        off = cut;
+        if (i < drops) {
+            bflb_ota_stream_abort();
+            bench_reboot();
+        }
+    }
+    if (bench_stream_finish(res)) {
+        return -1;
+    }
+    bench_end(res);
+    printf("  %d drops, %.1f KB downloaded twice\n", drops, resent / 1024.0);
+
+    if (bench_reboot() != !slot) {
+        printf("resume: partition not switched\n");
+        return -1;
+    }
+    return bench_check(!slot, res->name);
+}
+
+/* put the base image in the active slot with a plain download */
+static int bench_install_base(void)
+{
+    bench_result_t res;
+    uint8_t *image = bench_image;
+    uint32_t size = bench_size;
+    int ret;
+
+    bench_image = bench_base;
+    bench_size = bench_base_size;
+    ret = bench_stream_sync(&res);
+    bench_image = image;
+    bench_size = size;
+    if (ret) {
+        printf("packed: base image install failed\n");
+    }
+    return ret;
+}
+
+/* a packed download that must be rejected without switching the partition */
+static int bench_packed_reject(const uint8_t *src, uint32_t size, uint8_t flags, const char *what)
+{
+    bench_result_t res;
+    int slot = bench_reboot();
+
+    memset(&res, 0, sizeof(res));
+    if (bflb_ota_stream_start(bench_size, 0, flags) == 0) {
+        if (bench_stream_run(&res, src, 0, size) == 0) {
+            if (bflb_ota_stream_finish(1) == 0) {
+                printf("packed: %s was accepted\n", what);
+                return -1;
+            }
+        } else {
+            bflb_ota_stream_abort();
+        }
+    }
+    if (bench_reboot() != slot) {
+        printf("packed: %s switched the partition\n", what);
+        return -1;
+    }
+    printf("  %s rejected\n", what);
+    return 0;
+}
+
+/* the packed file (-z) after the base image (-b) was installed */
+static int bench_packed(bench_result_t *res)
+{
+    uint8_t flags = BFLB_OTA_STREAM_FLAG_ASYNC;
+    uint8_t *bad;
+    int slot;
+
+    if ((bench_pack_size > 6) && !memcmp(bench_pack, "\xfd" "7zXZ\0", 6)) {
+        flags |= BFLB_OTA_STREAM_FLAG_XZ;
+    }
+    if (bench_delta) {
+        flags |= BFLB_OTA_STREAM_FLAG_DELTA;
+    }
+
+    if ((bench_base != NULL) && bench_install_base()) {
+        return -1;
+    }
+
+    slot = bench_reboot();
+    bench_begin(res, (flags & BFLB_OTA_STREAM_FLAG_XZ) ? (bench_delta ? "delta xz" : "xz") : "delta");
+    res->down_kb = bench_pack_size / 1024;
+    if (bflb_ota_stream_start(bench_size, 0, flags) != 0) {
+        return -1;
+    }
+    if (bench_stream_run(res, bench_pack, 0, bench_pack_size) || bench_stream_finish(res)) {
+        printf("packed: download failed\n");
+        return -1;
+    }
+    bench_end(res);
+    if (bench_reboot() != !slot) {
+        printf("packed: partition not switched\n");
+        return -1;
+    }
+    if (bench_check(!slot, res->name)) {
+        return -1;
+    }
+
+    /* now the new image runs, the patch no longer fits it */
+    if (bench_delta && bench_packed_reject(bench_pack, bench_pack_size, flags, "patch on the wrong base")) {
+        return -1;
+    }
+    bad = malloc(bench_pack_size);
+    memcpy(bad, bench_pack, bench_pack_size);
+    bad[bench_pack_size / 2] ^= 0x55;
+    /* back to the base so only the corruption is wrong */
+    if (bench_delta && bench_install_base()) {
+        free(bad);
+        return -1;
+    }
+    if (bench_packed_reject(bad, bench_pack_size, flags, "corrupted download")) {
+        free(bad);
+        return -1;
+    }
+    free(bad);
+    return 0;
+}
+
+static void bench_power_cut(void)
+{
+    longjmp(bench_power_jmp, 1);
+}
+
+/* cut the power at a random flash operation of the download, then resume after reboot */
+static int bench_powerloss(int trials)
+{
+    bench_result_t res;
+    uint32_t ops, start, resent = 0;
+    volatile int cut = 0;
+    int i, slot;
+
+    for (i = 0; i < trials; i++) {
+        slot = bench_reboot();
+        ops = bench_size / 256 + bench_size / 4096;
+
+        if (setjmp(bench_power_jmp) == 0) {
+            bflb_flash_sim_set_power_loss(bench_random() % ops, bench_power_cut);
+            if (bflb_ota_stream_start(bench_size, 0x9abc + i, BFLB_OTA_STREAM_FLAG_ASYNC) != 0) {
+                printf("powerloss: trial %d did not start from 0\n", i);
+                return -1;
+            }
+            memset(&res, 0, sizeof(res));
+            if (bench_stream_run(&res, bench_image, 0, bench_size)) {
+                return -1;
+            }
+            bflb_flash_sim_power_on();
+        } else {
+            /* power is back, the ram state is gone */
+            cut++;
+            bflb_flash_sim_power_on();
+            bflb_ota_stream_abort();
+            if (bench_reboot() != slot) {
+                printf("powerloss: active slot changed before finish\n");
+                return -1;
+            }
+            start = bflb_ota_stream_start(bench_size, 0x9abc + i, BFLB_OTA_STREAM_FLAG_ASYNC);
+            if ((int)start < 0) {
+                return -1;
+            }
+            resent += start;
+            if (bench_stream_run(&res, bench_image, start, bench_size)) {
+                return -1;
+            }
+        }
+        if (bflb_ota_stream_finish(1)) {
+            printf("powerloss: trial %d hash check failed\n", i);
+            return -1;
+        }
+        if ((bench_reboot() != !slot) || bench_check(!slot, "powerloss")) {
+            return -1;
+        }
+    }
+    printf("powerloss: %d trials, %d cut during download, resumed at %.1f KB on average, all images verified\n",
+           trials, cut, cut ? resent / 1024.0 / cut : 0);
+    return 0;
+}
+
+/* a plain bin gets its SHA-256 as the trailer, as ota_pack.py -a does */
+static uint8_t *bench_load(const char *path, uint32_t *size, int trailer)
+{
+    FILE *fp = fopen(path, "rb");
+    uint8_t *data;
+    long n;
+
+    if (fp == NULL) {
+        printf("can not open %s\n", path);
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    n = ftell(fp);
+    rewind(fp);
+    data = malloc(n + 32);
+    if (fread(data, 1, n, fp) != (size_t)n) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    if (trailer && data) {
+        utils_sha256(data, n, data + n);
+        n += 32;
+    }
+    *size = n;
+    return data;
+}
+
+static void usage(void)
+{
+    printf("usage: ota_bench [-s image bytes] [-r network KB/s] [-c receive bytes] [-d drops] [-p power cuts] [-v]\n"
+           "                 [-i new bin] [-b base bin] [-z packed file] [-D] [-k device/host decode time]\n");
+}
+
+int main(int argc, char **argv)
+{
+    bflb_flash_sim_config_t cfg = BFLB_FLASH_SIM_CONFIG_NOR(BENCH_FLASH_SIZE);
+    bench_result_t res[5];
+    const char *new_path = NULL, *base_path = NULL, *pack_path = NULL;
+    int opt, drops = 3, cuts = 0, num = 4, i;
+
+    while ((opt = getopt(argc, argv, "s:r:c:d:p:i:b:z:Dk:vh")) != -1) {
+        switch (opt) {
+            case 'i':
+                new_path = optarg;
+                break;
+            case 'b':
+                base_path = optarg;
+                break;
+            case 'z':
+                pack_path = optarg;
+                break;
+            case 'D':
+                bench_delta = 1;
+                break;
+            case 'k':
+                bench_cpu = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                bench_size = strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                bench_rate = strtoul(optarg, NULL, 0);
+                break;
+            case 'c':
+                bench_chunk = strtoul(optarg, NULL, 0);
+                break;
+            case 'd':
+                drops = atoi(optarg);
+                break;
+            case 'p':
+                cuts = atoi(optarg);
+                break;
+            case 'v':
+                bench_verbose = 1;
+                break;
+            default:
+                usage();
+                return 1;
+        }
+    }
+    if (new_path != NULL) {
+        bench_image = bench_load(new_path, &bench_size, 1);
+    }
+    if (base_path != NULL) {
+        bench_base = bench_load(base_path, &bench_base_size, 1);
+    }
+    if (pack_path != NULL) {
+        bench_pack = bench_load(pack_path, &bench_pack_size, 0);
+    }
+    if ((new_path && !bench_image) || (base_path && !bench_base) || (pack_path && !bench_pack) ||
+        (bench_delta && !bench_base) || (bench_pack && !new_path)) {
+        usage();
+        return 1;
+    }
+    if ((bench_size <= 32) || (bench_size > HOSAL_OTA_FILE_SIZE_MAX) || (bench_chunk == 0) ||
+        (bench_chunk > sizeof(bench_rx)) || (bench_rate == 0)) {
+        usage();
+        return 1;
+    }
+
+    cfg.strict = 1;
+    if (bflb_flash_sim_init(&cfg)) {
+        return 1;
+    }
+    bflb_mtd_set_flash_operation(NULL, NULL, NULL);
+    bench_format();
+
+    /* random body with its SHA-256 as the trailer */
+    if (bench_image == NULL) {
+        bench_image = malloc(bench_size);
+        for (i = 0; i < bench_size - 32; i++) {
+            bench_image[i] = bench_random();
+        }
+        utils_sha256(bench_image, bench_size - 32, bench_image + bench_size - 32);
+    }
+
+    printf("image %u bytes, network %u KB/s in %u byte receives\n", bench_size, bench_rate, bench_chunk);
+    if (bench_legacy(&res[0]) || bench_stream_sync(&res[1]) || bench_stream_async(&res[2]) ||
+        bench_resume(&res[3], drops)) {
+        printf("bench failed\n");
+        return 1;
+    }
+    if (bench_pack != NULL) {
+        if (bench_packed(&res[4])) {
+            printf("bench failed\n");
+            return 1;
+        }
+        num = 5;
+    }
+    printf("%-14s %10s %10s %10s %10s %8s %8s %8s %8s\n", "mode", "total ms", "flash ms", "net ms", "cpu ms",
+           "down KB", "read KB", "erases", "pages");
+    for (i = 0; i < num; i++) {
+        bench_print(&res[i]);
+    }
+
+    if (cuts && bench_powerloss(cuts)) {
+        printf("bench failed\n");
+        return 1;
+    }
+
+    bflb_flash_sim_deinit();
+    free(bench_image);
+    free(bench_base);
+    free(bench_pack);
+    return 0;
+}
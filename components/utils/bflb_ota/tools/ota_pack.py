@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2023 Bouffalolab team
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# Pack an OTA image (firmware with its SHA-256 as the 32 byte trailer) for
+# bflb_ota_stream_start with BFLB_OTA_STREAM_FLAG_XZ and/or _DELTA. The file
+# size to pass is always the size of the new image, it is printed.
+#
+#   ota_pack.py xz new.ota -o new.ota.xz                 (-r RISC-V BCJ, needs xz 5.6)
+#   ota_pack.py delta old.ota new.ota -o new.patch.xz    (-n for a plain patch)
+#
+# Patch layout, little endian, bflb_ota.c applies it in one pass:
+#
+#   uint32_t magic          "BFDL"
+#   uint32_t version        1
+#   uint32_t old_size       bytes of the active partition the patch reads
+#   uint32_t new_size
+#   uint8_t  old_sha[32]    SHA-256 of those bytes
+#   records until new_size bytes are made:
+#     uint32_t diff_len     new = old + diff (mod 256) from the old cursor
+#     uint32_t extra_len    new bytes as they are
+#     int32_t  seek         old cursor moves after the record
+#     diff_len diff bytes, extra_len extra bytes
+#
+# Matches are found bsdiff style: an exact seed, then extended while more
+# than half of the bytes agree, so code that moved with relocated addresses
+# becomes mostly zero diff bytes which xz packs well.
+
+import argparse
+import hashlib
+import lzma
+import shutil
+import struct
+import subprocess
+import sys
+
+DELTA_MAGIC = b"BFDL"
+DELTA_VERSION = 1
+SEED = 8            # exact bytes to start a match
+SEED_STEP = 4       # old positions indexed
+MATCH_MIN = 24      # shorter matches stay extra bytes
+FUZZ_STOP = 64      # end an extension after this many bytes without gain
+
+
+def xz_pack(data, dict_size, extreme, riscv=False):
+    if riscv:
+        # python's liblzma may predate the RISC-V filter, the xz tool has it since 5.6
+        if shutil.which("xz") is None:
+            sys.exit("-r needs the xz tool 5.6 or later")
+        cmd = ["xz", "-c", "--format=xz", "--check=crc32", "--riscv",
+               "--lzma2=preset=9%s,dict=%d" % ("e" if extreme else "", dict_size)]
+        return subprocess.run(cmd, input=data, stdout=subprocess.PIPE, check=True).stdout
+    preset = 9 | lzma.PRESET_EXTREME if extreme else 9
+    # xz-embedded checks CRC32 only, the image has its own SHA-256
+    filters = [{"id": lzma.FILTER_LZMA2, "preset": preset, "dict_size": dict_size}]
+    return lzma.compress(data, format=lzma.FORMAT_XZ, check=lzma.CHECK_CRC32, filters=filters)
+
+
+def extend(old, new, o, n):
+    # length where 2 * matching bytes - length is largest
+    best_len = 0
+    best = 0
+    same = 0
+    i = 0
+    limit = min(len(old) - o, len(new) - n)
+    while i < limit:
+        if old[o + i] == new[n + i]:
+            same += 1
+        i += 1
+        if 2 * same - i > best:
+            best = 2 * same - i
+            best_len = i
+        elif i - best_len > FUZZ_STOP:
+            break
+    return best_len
+
+
+def find_matches(old, new):
+    index = {}
+    for i in range(0, len(old) - SEED + 1, SEED_STEP):
+        index.setdefault(old[i:i + SEED], i)
+
+    matches = []
+    last = 0        # new bytes before last are covered
+    guess = 0       # old position following the last match
+    pos = 0
+    end = len(new) - SEED
+    while pos <= end:
+        # the old cursor often continues right where the last match ended
+        o = guess + (pos - last)
+        if not (0 <= o <= len(old) - SEED and old[o:o + SEED] == new[pos:pos + SEED]):
+            o = None
+            for k in range(SEED_STEP):
+                c = index.get(new[pos + k:pos + k + SEED]) if pos + k <= end else None
+                if c is not None and c >= k:
+                    o = c - k
+                    break
+            if o is None or old[o:o + SEED] != new[pos:pos + SEED]:
+                pos += 1
+                continue
+
+        # grow backwards over bytes not yet covered
+        n = pos
+        while n > last and o > 0 and old[o - 1] == new[n - 1]:
+            n -= 1
+            o -= 1
+        length = extend(old, new, o, n)
+        if length < MATCH_MIN:
+            pos += 1
+            continue
+        matches.append((n, o, length))
+        last = n + length
+        guess = o + length
+        pos = last
+    return matches
+
+
+def delta_pack(old, new):
+    matches = find_matches(old, new)
+    out = [DELTA_MAGIC, struct.pack("<III", DELTA_VERSION, len(old), len(new)), hashlib.sha256(old).digest()]
+    matched = 0
+
+    # a leading record with no diff bytes carries what comes before the first match
+    if not matches or matches[0][0] > 0:
+        first = matches[0][0] if matches else len(new)
+        seek = matches[0][1] if matches else 0
+        out += [struct.pack("<IIi", 0, first, seek), new[:first]]
+    for i, (n, o, length) in enumerate(matches):
+        if i + 1 < len(matches):
+            nxt_n, nxt_o, _ = matches[i + 1]
+        else:
+            nxt_n, nxt_o = len(new), o + length
+        diff = bytes((new[n + k] - old[o + k]) & 0xff for k in range(length))
+        out += [struct.pack("<IIi", length, nxt_n - n - length, nxt_o - o - length), diff, new[n + length:nxt_n]]
+        matched += length
+    return b"".join(out), len(matches), matched
+
+
+def check_trailer(name, data, append):
+    if append:
+        return data + hashlib.sha256(data).digest()
+    if len(data) <= 32 or hashlib.sha256(data[:-32]).digest() != data[-32:]:
+        sys.exit("%s has no SHA-256 trailer, use -a to append one" % name)
+    return data
+
+
+def main():
+    parser = argparse.ArgumentParser(description="pack an OTA image for the bflb_ota stream writer")
+    parser.add_argument("mode", choices=["xz", "delta"])
+    parser.add_argument("files", nargs="+", help="xz: new image, delta: old image and new image")
+    parser.add_argument("-o", dest="out", required=True, help="output file")
+    parser.add_argument("-a", dest="append", action="store_true",
+                        help="the images are plain bins, append their SHA-256 trailers as the device has them")
+    parser.add_argument("-n", dest="plain", action="store_true", help="delta: do not xz the patch")
+    parser.add_argument("-d", dest="dict_size", type=int, default=0x8000,
+                        help="LZMA2 dictionary, not larger than CONFIG_BFLB_OTA_XZ_DICT (default 32768)")
+    parser.add_argument("-9", dest="extreme", action="store_true", help="slower, slightly better compression")
+    parser.add_argument("-r", dest="riscv", action="store_true",
+                        help="xz: RISC-V BCJ filter before LZMA2, the device needs CONFIG_XZ_BCJ_RISCV")
+    args = parser.parse_args()
+
+    if len(args.files) != (1 if args.mode == "xz" else 2):
+        parser.error("xz takes one image, delta takes the old and the new image")
+    if args.dict_size < 4096:
+        parser.error("dictionary must be at least 4096")
+
+    with open(args.files[-1], "rb") as f:
+        new = check_trailer(args.files[-1], f.read(), args.append)
+
+    if args.mode == "xz":
+        out = xz_pack(new, args.dict_size, args.extreme, args.riscv)
+        flags = "BFLB_OTA_STREAM_FLAG_XZ"
+    else:
+        # the patch reads the old image as it is in the active partition
+        with open(args.files[0], "rb") as f:
+            old = f.read()
+        if args.append:
+            old += hashlib.sha256(old).digest()
+        out, records, matched = delta_pack(old, new)
+        print("ota_pack: %d matches cover %d of %d bytes, plain patch %d bytes" %
+              (records, matched, len(new), len(out)))
+        flags = "BFLB_OTA_STREAM_FLAG_DELTA"
+        if not args.plain:
+            out = xz_pack(out, args.dict_size, args.extreme)
+            flags += " | BFLB_OTA_STREAM_FLAG_XZ"
+
+    with open(args.out, "wb") as f:
+        f.write(out)
+    print("ota_pack: %s %d -> %d bytes (%.2fx), start with file_size %d, flags %s" %
+          (args.out, len(new), len(out), len(new) / len(out), len(new), flags))
+
+
+if __name__ == "__main__":
+    main()
@@ -28,6 +28,10 @@
 
 #include "bflog.h"
 
+#ifdef BFLOG_DIRECT_FILE_BLOCK_ENABLE
+#include "utils_crc.h"
+#endif
+
 /** @addtogroup std_func
  * @{
  */
@@ -48,6 +52,14 @@
 #define bflogc_ftell ftell
 #endif
 
+#ifndef bflogc_fseek
+#define bflogc_fseek fseek
+#endif
+
+#ifndef bflogc_fread
+#define bflogc_fread fread
+#endif
+
 #ifndef bflogc_fflush
 #define bflogc_fflush fflush
 #endif
@@ -92,21 +104,29 @@
 #define _BFLOG_CHECK(_expr, _ret) ((void)0)
 #endif
 
-#define _bflog_t(_ptr)            ((bflog_t *)(_ptr))
+#define _bflog_t(_ptr)             ((bflog_t *)(_ptr))
+
+#define _BFLOG_LOCKFREE(_ptr)      ((_bflog_t(_ptr)->mode & (BFLOG_MODE_ASYNC | BFLOG_MODE_LOCKFREE)) == (BFLOG_MODE_ASYNC | BFLOG_MODE_LOCKFREE))
+
+/*!< lockfree queue record align, msg holds 64bit clock */
+#define _BFLOG_QUEUE_ALIGN         8
+/*!< lockfree queue padding record at ring tail */
+#define _BFLOG_QUEUE_SKIP          0x5c
 
-#define _msg_t(_ptr)              ((struct _bflog_msg *)(_ptr))
-#define _tag_t(_ptr)              ((struct _bflog_tag *)(_ptr))
+#define _msg_t(_ptr)               ((struct _bflog_msg *)(_ptr))
+#define _tag_t(_ptr)               ((struct _bflog_tag *)(_ptr))
 
-#define _direct_t(_ptr)           ((bflog_direct_t *)(_ptr))
-#define _direct_buffer_t(_ptr)    ((bflog_direct_buffer_t *)(_ptr))
-#define _direct_stream_t(_ptr)    ((bflog_direct_stream_t *)(_ptr))
-#define _direct_file_t(_ptr)      ((bflog_direct_file_t *)(_ptr))
-#define _direct_file_time_t(_ptr) ((bflog_direct_file_time_t *)(_ptr))
-#define _direct_file_size_t(_ptr) ((bflog_direct_file_size_t *)(_ptr))
+#define _direct_t(_ptr)            ((bflog_direct_t *)(_ptr))
+#define _direct_buffer_t(_ptr)     ((bflog_direct_buffer_t *)(_ptr))
+#define _direct_stream_t(_ptr)     ((bflog_direct_stream_t *)(_ptr))
+#define _direct_file_t(_ptr)       ((bflog_direct_file_t *)(_ptr))
+#define _direct_file_time_t(_ptr)  ((bflog_direct_file_time_t *)(_ptr))
+#define _direct_file_size_t(_ptr)  ((bflog_direct_file_size_t *)(_ptr))
+#define _direct_file_block_t(_ptr) ((bflog_direct_file_block_t *)(_ptr))
 
-#define _layout_simple_t(_ptr)    ((bflog_layout_simple_t *)(_ptr))
-#define _layout_format_t(_ptr)    ((bflog_layout_format_t *)(_ptr))
-#define _layout_yaml_t(_ptr)      ((bflog_layout_yaml_t *)(_ptr))
+#define _layout_simple_t(_ptr)     ((bflog_layout_simple_t *)(_ptr))
+#define _layout_format_t(_ptr)     ((bflog_layout_format_t *)(_ptr))
+#define _layout_yaml_t(_ptr)       ((bflog_layout_yaml_t *)(_ptr))
 
 /*!< default log record flag */
 #ifndef BFLOG_FLAG_DEFAULT
@@ -139,11 +159,26 @@
 #define BFLOG_DIRECT_LEVEL_DEFAULT BFLOG_LEVEL_INFO
 #endif
 
+/*!< lockfree queue msg released to producers per batch */
+#ifndef BFLOG_QUEUE_BATCH
+#define BFLOG_QUEUE_BATCH 8
+#endif
+
+/*!< tag rate limit window, in bflog_clock tick */
+#ifndef BFLOG_RATE_LIMIT_PERIOD
+#define BFLOG_RATE_LIMIT_PERIOD 1000000
+#endif
+
 /*!< file size rotate min size */
 #ifndef BFLOG_FILE_SIZE_MIN
 #define BFLOG_FILE_SIZE_MIN (128 * 1024)
 #endif
 
+/*!< file block direct lz hash table bits, table uses 2 << bits byte */
+#ifndef BFLOG_LZ_HASH_BITS
+#define BFLOG_LZ_HASH_BITS 10
+#endif
+
 /*!< file time rotate min interval */
 #ifndef BFLOG_FILE_INTERVAL_MIN
 #define BFLOG_FILE_INTERVAL_MIN (10 * 60)
@@ -417,6 +452,7 @@ static void queue_free(bflog_t *log, uint16_t free)
         }
 
         space += size;
+        log->drop.full++;
     }
 
     log->queue.rpos = rpos;
@@ -499,6 +535,74 @@ static void queue_get(bflog_t *log, struct _bflog_msg *msg)
     ((char *)msg)[msg->size] = '\0';
 }
 
+/**
+ *   @brief         reset queue, lockfree queue uses power of two size and zeroed pool
+ *   @param  log                    recorder
+ */
+static void queue_reset(bflog_t *log)
+{
+    log->queue.wpos = 0;
+    log->queue.rpos = 0;
+    log->queue.free = log->queue.size;
+
+    log->queue.mask = 0;
+    while (((log->queue.mask << 1) | 1) < log->queue.size) {
+        log->queue.mask = (log->queue.mask << 1) | 1;
+    }
+    log->queue.whead = 0;
+    log->queue.rhead = 0;
+    log->queue.drain = 0;
+
+    if ((log->queue.pool != NULL) && (log->mode & BFLOG_MODE_LOCKFREE)) {
+        memset(log->queue.pool, 0, log->queue.mask + 1);
+    }
+}
+
+/**
+ *   @brief         enqueue without lock, newest msg is dropped when queue full
+ *                  msg never wraps, a skip record pads the ring tail instead
+ *   @param  log                    recorder
+ *   @param  msg                    store message area
+ *   @return int
+ */
+static int queue_put_lockfree(bflog_t *log, struct _bflog_msg *msg)
+{
+    char *pool = (char *)(log->queue.pool);
+    uint32_t size = log->queue.mask + 1;
+    uint32_t whead;
+    uint32_t rhead;
+    uint32_t offset;
+    uint32_t pad;
+
+    msg->size = (msg->size + _BFLOG_QUEUE_ALIGN - 1) & ~(_BFLOG_QUEUE_ALIGN - 1);
+
+    /*!< claim space */
+    whead = __atomic_load_n(&(log->queue.whead), __ATOMIC_RELAXED);
+    do {
+        rhead = __atomic_load_n(&(log->queue.rhead), __ATOMIC_ACQUIRE);
+        offset = whead & log->queue.mask;
+        pad = (msg->size > size - offset) ? (size - offset) : 0;
+
+        if (whead + pad + msg->size - rhead > size) {
+            __atomic_fetch_add(&(log->drop.full), 1, __ATOMIC_RELAXED);
+            return -1;
+        }
+    } while (!__atomic_compare_exchange_n(&(log->queue.whead), &whead, whead + pad + msg->size,
+                                          1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    if (pad) {
+        /*!< size[15:0] level[23:16] zero[31:24] */
+        __atomic_store_n(&(_msg_t(pool + offset)->head), pad | ((uint32_t)_BFLOG_QUEUE_SKIP << 24), __ATOMIC_RELEASE);
+        offset = 0;
+    }
+
+    /*!< body first, then publish head */
+    bflogc_memcpy(pool + offset + sizeof(uint32_t), (char *)msg + sizeof(uint32_t), msg->size - sizeof(uint32_t));
+    __atomic_store_n(&(_msg_t(pool + offset)->head), msg->head, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
 /**
  * @}
  */
@@ -609,6 +713,32 @@ int bflog_global_filter(void *tag_string, uint8_t enable)
     return bflog_filter_set(0xffffffff, tag_string, enable);
 }
 
+/**
+ *   @brief         limit msg of a tag per BFLOG_RATE_LIMIT_PERIOD, thread unsafe
+ *                  msg over limit are dropped and counted in drop.rate
+ *   @param  tag_string             tag string pointer
+ *   @param  rate                   max msg per period, 0 is unlimited
+ *   @return int
+ */
+int bflog_rate_limit(void *tag_string, uint16_t rate)
+{
+    _BFLOG_CHECK(tag_string != NULL, -1);
+
+    struct _bflog_tag *ps = &__bflog_tags_start__;
+    struct _bflog_tag *pe = &__bflog_tags_end__;
+
+    while (ps < pe) {
+        if ((tag_string == ps->tag) || (0 == bflogc_strcmp(tag_string, ps->tag))) {
+            ps->rate = rate;
+            ps->count = 0;
+            return 0;
+        }
+        ps += 1;
+    }
+
+    return -1;
+}
+
 /**
  *   @brief         create recorder, thread unsafe
  *   @param  log                    recorder
@@ -629,11 +759,13 @@ int bflog_create(bflog_t *log, void *pool, uint16_t size, uint8_t mode)
     log->level = BFLOG_LEVEL_DEFAULT;
     log->mode = mode;
 
-    log->queue.free = size;
-    log->queue.wpos = 0;
-    log->queue.rpos = 0;
     log->queue.size = size;
     log->queue.pool = pool;
+    queue_reset(log);
+
+    log->drop.full = 0;
+    log->drop.rate = 0;
+    log->drop.report = 0;
 
     log->enter_critical = dummy;
     log->exit_critical = dummy;
@@ -975,9 +1107,7 @@ int bflog_control(bflog_t *log, uint32_t command, uint32_t param)
             log->queue.size = param & 0xffff;
             break;
         case BFLOG_CMD_QUEUE_RST:
-            log->queue.wpos = 0;
-            log->queue.rpos = 0;
-            log->queue.free = log->queue.size;
+            queue_reset(log);
             break;
         case BFLOG_CMD_FLUSH_NOTICE:
             if ((void *)param == NULL) {
@@ -987,7 +1117,13 @@ int bflog_control(bflog_t *log, uint32_t command, uint32_t param)
             }
             break;
         case BFLOG_CMD_MODE:
-            log->mode = param & 0xff;
+            if ((log->mode ^ param) & BFLOG_MODE_LOCKFREE) {
+                /*!< queue layout changed, drop queued msg */
+                log->mode = param & 0xff;
+                queue_reset(log);
+            } else {
+                log->mode = param & 0xff;
+            }
             break;
         default:
             log->exit_critical();
@@ -1035,6 +1171,206 @@ int bflog_filter(bflog_t *log, void *tag_string, uint8_t enable)
     return ret;
 }
 
+#ifdef BFLOG_DEFERRED_ENABLE
+/** @addtogroup BFLOG_DEFERRED
+ * @{
+ */
+
+/**
+ *   @brief         deferred record stored in msg string
+ */
+struct _bflog_deferred {
+    const char *format; /*!< format string, must be static string, only record pointer */
+    uint32_t size;      /*!< args size */
+    uint8_t args[0];    /*!< raw format args */
+};
+
+#define _deferred_t(_ptr) ((struct _bflog_deferred *)(_ptr))
+
+/**
+ *   @brief         copy raw format args, no formatting
+ *                  integer args take 4byte, long and pointer take native size,
+ *                  long long and double take 8byte, string is copied with '\0'
+ *   @param  out                    args area
+ *   @param  size                   args area size
+ *   @param  format                 format string
+ *   @param  args                   format params
+ *   @return uint32_t               args size, args after overflow are dropped
+ */
+static uint32_t bflog_deferred_pack(uint8_t *out, uint32_t size, const char *format, va_list args)
+{
+    uint32_t pos = 0;
+    const char *p = format;
+
+#define _BFLOG_PACK(_type)                              \
+    do {                                                \
+        _type _val = va_arg(args, _type);               \
+        if (pos + sizeof(_type) > size) {               \
+            return pos;                                 \
+        }                                               \
+        bflogc_memcpy(out + pos, &_val, sizeof(_type)); \
+        pos += sizeof(_type);                           \
+    } while (0)
+
+    while (*p) {
+        if (*p++ != '%') {
+            continue;
+        }
+
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+
+        /*!< flags */
+        while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0' || *p == '\'') {
+            p++;
+        }
+
+        /*!< width */
+        if (*p == '*') {
+            _BFLOG_PACK(int);
+            p++;
+        } else {
+            while (*p >= '0' && *p <= '9') {
+                p++;
+            }
+        }
+
+        /*!< precision */
+        if (*p == '.') {
+            p++;
+            if (*p == '*') {
+                _BFLOG_PACK(int);
+                p++;
+            } else {
+                while (*p >= '0' && *p <= '9') {
+                    p++;
+                }
+            }
+        }
+
+        /*!< length */
+        uint8_t length = 0;
+        while (*p == 'h' || *p == 'l' || *p == 'j' || *p == 'z' || *p == 't' || *p == 'L') {
+            length = (length == 'l' && *p == 'l') ? 'q' : *p;
+            p++;
+        }
+
+        /*!< conversion */
+        switch (*p) {
+            case 'd':
+            case 'i':
+            case 'o':
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'c':
+                if (length == 'q' || length == 'j') {
+                    _BFLOG_PACK(long long);
+                } else if (length == 'l') {
+                    _BFLOG_PACK(long);
+                } else if (length == 'z' || length == 't') {
+                    _BFLOG_PACK(size_t);
+                } else {
+                    _BFLOG_PACK(int);
+                }
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                if (length == 'L') {
+                    /*!< long double is recorded as double */
+                    double _val = (double)va_arg(args, long double);
+                    if (pos + sizeof(double) > size) {
+                        return pos;
+                    }
+                    bflogc_memcpy(out + pos, &_val, sizeof(double));
+                    pos += sizeof(double);
+                } else {
+                    _BFLOG_PACK(double);
+                }
+                break;
+            case 'p':
+                _BFLOG_PACK(void *);
+                break;
+            case 's': {
+                const char *str = va_arg(args, const char *);
+                if (str == NULL) {
+                    str = "(null)";
+                }
+                /*!< always keep '\0', truncate long string */
+                while (*str && (pos + 1 < size)) {
+                    out[pos++] = *str++;
+                }
+                if (pos >= size) {
+                    return pos;
+                }
+                out[pos++] = '\0';
+            } break;
+            case 'n':
+                (void)va_arg(args, void *);
+                break;
+            case '\0':
+                return pos;
+            default:
+                break;
+        }
+        p++;
+    }
+
+#undef _BFLOG_PACK
+
+    return pos;
+}
+
+/**
+ *   @brief         build deferred binary frame
+ *   @param  buf                    frame buffer
+ *   @param  msg                    deferred msg
+ *   @param  tag                    tag string
+ *   @return int                    frame size
+ */
+static int bflog_deferred_frame(void *buf, struct _bflog_msg *msg, const char *tag)
+{
+    struct _bflog_frame *frame = (struct _bflog_frame *)buf;
+    struct _bflog_deferred *deferred = _deferred_t(msg->string);
+    uint32_t size = sizeof(struct _bflog_frame) + deferred->size;
+    uint8_t sum = 0;
+
+    frame->sync[0] = BFLOG_FRAME_SYNC0;
+    frame->sync[1] = BFLOG_FRAME_SYNC1;
+    frame->size = deferred->size;
+    frame->level = msg->level & ~BFLOG_LEVEL_DEFERRED;
+    frame->sum = 0;
+    frame->line = msg->line;
+    frame->time = msg->time;
+    frame->clkl = msg->clkl;
+    frame->clkh = msg->clkh;
+    frame->format = (uint32_t)(uintptr_t)(deferred->format);
+    frame->tag = (uint32_t)(uintptr_t)(tag);
+    frame->file = (uint32_t)(uintptr_t)(msg->file);
+    frame->func = (uint32_t)(uintptr_t)(msg->func);
+    bflogc_memcpy(frame->args, deferred->args, deferred->size);
+
+    for (uint32_t i = 0; i < size; i++) {
+        sum += ((uint8_t *)buf)[i];
+    }
+    frame->sum = 0xff - sum;
+
+    return size;
+}
+
+/**
+ * @}
+ */
+#endif
+
 /**
  *   @brief         record log msg, thread safe
  *                  tag, file, func only recorded pointer
@@ -1079,6 +1415,23 @@ int bflog(void *log, uint8_t level, void *tag, const char *const file, const cha
             ((_tag_t(tag)->en & _bflog_t(log)->filter) != _bflog_t(log)->filter)) {
             return 0;
         }
+
+        /*!< tag rate limit, not exact under contention */
+        if ((tag != NULL) && (_tag_t(tag)->rate != 0)) {
+            uint32_t clk = (uint32_t)bflog_clock();
+
+            if ((clk - _tag_t(tag)->window) >= BFLOG_RATE_LIMIT_PERIOD) {
+                _tag_t(tag)->window = clk;
+                _tag_t(tag)->count = 0;
+            }
+
+            if (_tag_t(tag)->count >= _tag_t(tag)->rate) {
+                __atomic_fetch_add(&(_bflog_t(log)->drop.rate), 1, __ATOMIC_RELAXED);
+                return 0;
+            }
+
+            _tag_t(tag)->count++;
+        }
     }
 
     /*!< record clock tick */
@@ -1136,16 +1489,34 @@ int bflog(void *log, uint8_t level, void *tag, const char *const file, const cha
     /*!< set zero */
     _msg_t(msg)->zero = 0;
 
-    /*!< print string to msg->string */
-    va_start(args, format);
-    ret = bflogc_vsnprintf(_msg_t(msg)->string, BFLOG_LINE_BUFFER_SIZE, format, args);
-    va_end(args);
-
-    /*!< check true size */
-    if ((ret >= 0) && (ret <= BFLOG_LINE_BUFFER_SIZE)) {
-        size += ret;
-    } else {
-        size += BFLOG_LINE_BUFFER_SIZE;
+#ifdef BFLOG_DEFERRED_ENABLE
+    if (_bflog_t(log)->mode & BFLOG_MODE_DEFERRED) {
+        /*!< copy format pointer and raw args to msg->string, format on host */
+        _msg_t(msg)->level |= BFLOG_LEVEL_DEFERRED;
+        _deferred_t(_msg_t(msg)->string)->format = format;
+
+        va_start(args, format);
+        _deferred_t(_msg_t(msg)->string)->size = bflog_deferred_pack(
+            _deferred_t(_msg_t(msg)->string)->args,
+            BFLOG_LINE_BUFFER_SIZE - sizeof(struct _bflog_deferred),
+            format, args);
+        va_end(args);
+
+        size += sizeof(struct _bflog_deferred) + _deferred_t(_msg_t(msg)->string)->size;
+    } else
+#endif
+    {
+        /*!< print string to msg->string */
+        va_start(args, format);
+        ret = bflogc_vsnprintf(_msg_t(msg)->string, BFLOG_LINE_BUFFER_SIZE, format, args);
+        va_end(args);
+
+        /*!< check true size, keep '\0' for in place output */
+        if ((ret >= 0) && (ret < BFLOG_LINE_BUFFER_SIZE)) {
+            size += ret + 1;
+        } else {
+            size += BFLOG_LINE_BUFFER_SIZE;
+        }
     }
 
     /*!< align 4 byte */
@@ -1155,6 +1526,13 @@ int bflog(void *log, uint8_t level, void *tag, const char *const file, const cha
         _msg_t(msg)->size = size;
     }
 
+    if (_BFLOG_LOCKFREE(log)) {
+        /*!< producers never lock, only notice consumer */
+        ret = queue_put_lockfree(_bflog_t(log), _msg_t(msg));
+        _bflog_t(log)->flush_notice();
+        return ret;
+    }
+
     if (_bflog_t(log)->enter_critical()) {
         return -1;
     }
@@ -1181,279 +1559,417 @@ int bflog(void *log, uint8_t level, void *tag, const char *const file, const cha
 }
 
 /**
- *   @brief         flush all msg in queue, thread safe
+ *   @brief         execute layout of one msg and output to all directs
  *   @param  log                    recorder
- *   @return int
+ *   @param  msg                    msg
+ *   @param  buf                    layout buffer, 2xline buffer size
  */
-int bflog_flush(void *log)
+static void bflog_flush_msg(void *log, void *msg, char *buf)
 {
-    _BFLOG_CHECK(log != NULL, -1);
-
-    uint8_t msg[BFLOG_LINE_BUFFER_SIZE + sizeof(struct _bflog_msg)];
-    char buf[BFLOG_LINE_BUFFER_SIZE * 2];
     struct _bflog_list *node;
     void *direct;
     uint32_t filter = _bflog_t(log)->filter;
 
-    /*!< working only during running */
-    switch (_bflog_t(log)->status) {
-        case BFLOG_STATUS_SUSPEND:
-            return -1;
-        case BFLOG_STATUS_RUNNING:
-            break;
-        default:
-            return -1;
-    }
+    /*!< color */
+    char *color;
+    color = bflog_color_strings[_msg_t(msg)->level & BFLOG_LEVEL_MASK];
 
-    do {
-        /*!< reset msg string */
-        _msg_t(msg)->string[0] = '\0';
+    /*!< level */
+    char *level;
+    if (_bflog_t(log)->flags & BFLOG_FLAG_LEVEL) {
+        level = bflog_level_strings[_msg_t(msg)->level & BFLOG_LEVEL_MASK];
+    } else {
+        level = bflog_dummy_string;
+    }
 
-        if (_bflog_t(log)->enter_critical()) {
-            return -1;
-        }
+#ifdef BFLOG_TIMESTAMP_ENABLE
+    /*!< time */
+    bflog_tm_t tm;
 
-        /*!< working only during running */
-        switch (_bflog_t(log)->status) {
-            case BFLOG_STATUS_SUSPEND:
-                _bflog_t(log)->exit_critical();
-                return -1;
-            case BFLOG_STATUS_RUNNING:
-                break;
-            default:
-                _bflog_t(log)->exit_critical();
-                return -1;
-        }
+    bflog_unix2time(_msg_t(msg)->time, &tm);
+#endif
 
-        /*!< get msg(on stack) from queue(on ram) */
-        queue_get(_bflog_t(log), (void *)(&msg));
+    /*!< check if advanced tag */
+    uint8_t advanced_tag;
+    if (((uintptr_t)(&__bflog_tags_start__) <= (uintptr_t)(_msg_t(msg)->tag)) &&
+        ((uintptr_t)(_msg_t(msg)->tag) < (uintptr_t)(&__bflog_tags_end__))) {
+        advanced_tag = 1;
+    } else {
+        advanced_tag = 0;
+    }
 
+    _bflog_t(log)->enter_critical();
+    /*!< foreach direct, execute layout to buf(on stack), then output buf(on stack) */
+    BFLOG_DLIST_FOREACH_NEXT(node, &(_bflog_t(log)->direct))
+    {
         _bflog_t(log)->exit_critical();
 
-        if (_msg_t(msg)->zero != 0) {
-            if (_msg_t(msg)->zero == 0xbd) {
-                /*!< no msg */
-                return 0;
-            } else {
-                /*!< error */
-                return -1;
-            }
-        }
-
-        /*!< color */
-        char *color;
-        color = bflog_color_strings[_msg_t(msg)->level & BFLOG_LEVEL_MASK];
+        int size;
+        direct = BFLOG_DLIST_ENTRY(node, bflog_direct_t, list);
 
-        /*!< level */
-        char *level;
-        if (_bflog_t(log)->flags & BFLOG_FLAG_LEVEL) {
-            level = bflog_level_strings[_msg_t(msg)->level & BFLOG_LEVEL_MASK];
-        } else {
-            level = bflog_dummy_string;
+        /*!< check direct status */
+        if (_direct_t(direct)->status != BFLOG_DIRECT_STATUS_RUNNING) {
+            continue;
         }
 
-#ifdef BFLOG_TIMESTAMP_ENABLE
-        /*!< time */
-        bflog_tm_t tm;
-
-        bflog_unix2time(_msg_t(msg)->time, &tm);
-#endif
-
-        /*!< check if advanced tag */
-        uint8_t advanced_tag;
-        if (((uintptr_t)(&__bflog_tags_start__) <= (uintptr_t)(_msg_t(msg)->tag)) &&
-            ((uintptr_t)(_msg_t(msg)->tag) < (uintptr_t)(&__bflog_tags_end__))) {
-            advanced_tag = 1;
-        } else {
-            advanced_tag = 0;
+        /*!< level filter */
+        if ((_msg_t(msg)->level & BFLOG_LEVEL_MASK) > _direct_t(direct)->level) {
+            continue;
         }
 
-        _bflog_t(log)->enter_critical();
-        /*!< foreach direct, execute layout to buf(on stack), then output buf(on stack) */
-        BFLOG_DLIST_FOREACH_NEXT(node, &(_bflog_t(log)->direct))
-        {
-            _bflog_t(log)->exit_critical();
-
-            int size;
-            direct = BFLOG_DLIST_ENTRY(node, bflog_direct_t, list);
-
-            /*!< check direct status */
-            if (_direct_t(direct)->status != BFLOG_DIRECT_STATUS_RUNNING) {
-                continue;
-            }
-
-            /*!< level filter */
-            if ((_msg_t(msg)->level & BFLOG_LEVEL_MASK) > _direct_t(direct)->level) {
+        if (advanced_tag) {
+            /*!< tag filter */
+            if ((_msg_t(msg)->tag != NULL) &&
+                ((_tag_t(_msg_t(msg)->tag)->en & filter) != filter)) {
                 continue;
             }
+        }
 
-            if (advanced_tag) {
-                /*!< tag filter */
-                if ((_msg_t(msg)->tag != NULL) &&
-                    ((_tag_t(_msg_t(msg)->tag)->en & filter) != filter)) {
-                    continue;
-                }
-            }
+        char *tag;
+        if ((_msg_t(msg)->tag == NULL)) {
+            tag = bflog_dummy_string;
+        } else {
+            tag = advanced_tag ? _tag_t(_msg_t(msg)->tag)->tag : _msg_t(msg)->tag;
+        }
 
-            char *tag;
-            if ((_msg_t(msg)->tag == NULL)) {
-                tag = bflog_dummy_string;
-            } else {
-                tag = advanced_tag ? _tag_t(_msg_t(msg)->tag)->tag : _msg_t(msg)->tag;
-            }
+#ifdef BFLOG_DEFERRED_ENABLE
+        /*!< deferred output, binary frame */
+        if (_msg_t(msg)->level & BFLOG_LEVEL_DEFERRED) {
+            size = bflog_deferred_frame(buf, _msg_t(msg), tag);
+            goto output;
+        }
+#endif
 
-            /*!< raw output */
-            if (_msg_t(msg)->level & BFLOG_LEVEL_RAW) {
-                size = bflogc_snprintf(
-                    buf,
-                    BFLOG_LINE_BUFFER_SIZE * 2,
-                    "%s", _msg_t(msg)->string);
-                goto output;
-            }
+        /*!< raw output */
+        if (_msg_t(msg)->level & BFLOG_LEVEL_RAW) {
+            size = bflogc_snprintf(
+                buf,
+                BFLOG_LINE_BUFFER_SIZE * 2,
+                "%s", _msg_t(msg)->string);
+            goto output;
+        }
 
-            /*!< nolayout */
-            if (_direct_t(direct)->layout == NULL) {
-                goto simple_layout;
-            }
+        /*!< nolayout */
+        if (_direct_t(direct)->layout == NULL) {
+            goto simple_layout;
+        }
 
-            /*!< layout */
-            switch (_direct_t(direct)->layout->type) {
-                case BFLOG_LAYOUT_TYPE_FORMAT:
-                    if (_direct_t(direct)->color) {
+        /*!< layout */
+        switch (_direct_t(direct)->layout->type) {
+            case BFLOG_LAYOUT_TYPE_FORMAT:
+                if (_direct_t(direct)->color) {
 #ifdef BFLOG_TIMESTAMP_ENABLE
-                        size = _layout_format_t(_direct_t(direct)->layout)
-                                   ->snprintf(
-                                       buf,
-                                       BFLOG_LINE_BUFFER_SIZE * 2,
-                                       color,
-                                       level,
-                                       tag,
-                                       &tm,
-                                       _msg_t(msg));
+                    size = _layout_format_t(_direct_t(direct)->layout)
+                               ->snprintf(
+                                   buf,
+                                   BFLOG_LINE_BUFFER_SIZE * 2,
+                                   color,
+                                   level,
+                                   tag,
+                                   &tm,
+                                   _msg_t(msg));
 #else
-                        size = _layout_format_t(_direct_t(direct)->layout)
-                                   ->snprintf(
-                                       buf,
-                                       BFLOG_LINE_BUFFER_SIZE * 2,
-                                       color,
-                                       level,
-                                       tag,
-                                       NULL,
-                                       _msg_t(msg));
+                    size = _layout_format_t(_direct_t(direct)->layout)
+                               ->snprintf(
+                                   buf,
+                                   BFLOG_LINE_BUFFER_SIZE * 2,
+                                   color,
+                                   level,
+                                   tag,
+                                   NULL,
+                                   _msg_t(msg));
 #endif
-                    } else {
+                } else {
 #ifdef BFLOG_TIMESTAMP_ENABLE
-                        size = _layout_format_t(_direct_t(direct)->layout)
-                                   ->snprintf(
-                                       buf,
-                                       BFLOG_LINE_BUFFER_SIZE * 2,
-                                       bflog_dummy_string,
-                                       level,
-                                       tag,
-                                       &tm,
-                                       _msg_t(msg));
+                    size = _layout_format_t(_direct_t(direct)->layout)
+                               ->snprintf(
+                                   buf,
+                                   BFLOG_LINE_BUFFER_SIZE * 2,
+                                   bflog_dummy_string,
+                                   level,
+                                   tag,
+                                   &tm,
+                                   _msg_t(msg));
 #else
-                        size = _layout_format_t(_direct_t(direct)->layout)
-                                   ->snprintf(
-                                       buf,
-                                       BFLOG_LINE_BUFFER_SIZE * 2,
-                                       bflog_dummy_string,
-                                       level,
-                                       tag,
-                                       NULL,
-                                       _msg_t(msg));
+                    size = _layout_format_t(_direct_t(direct)->layout)
+                               ->snprintf(
+                                   buf,
+                                   BFLOG_LINE_BUFFER_SIZE * 2,
+                                   bflog_dummy_string,
+                                   level,
+                                   tag,
+                                   NULL,
+                                   _msg_t(msg));
 #endif
-                    }
-                    goto output;
+                }
+                goto output;
 
-                    /*!< TODO Layout yaml format */
-                case BFLOG_LAYOUT_TYPE_YAML:
-                case BFLOG_LAYOUT_TYPE_SIMPLE:
-                default:
-                    goto simple_layout;
-            }
+                /*!< TODO Layout yaml format */
+            case BFLOG_LAYOUT_TYPE_YAML:
+            case BFLOG_LAYOUT_TYPE_SIMPLE:
+            default:
+                goto simple_layout;
+        }
 
-        simple_layout:
+    simple_layout:
 
-            if (_direct_t(direct)->color) {
-                /*!< default and simple color format */
+        if (_direct_t(direct)->color) {
+            /*!< default and simple color format */
 #ifdef BFLOG_TIMESTAMP_ENABLE
-                size = bflogc_snprintf(
-                    buf,
-                    BFLOG_LINE_BUFFER_SIZE * 2,
-                    BFLOG_SIMPLE_LAYOUT_STRING(
-                        color,
-                        level,
-                        tag,
-                        &tm,
-                        _msg_t(msg)));
+            size = bflogc_snprintf(
+                buf,
+                BFLOG_LINE_BUFFER_SIZE * 2,
+                BFLOG_SIMPLE_LAYOUT_STRING(
+                    color,
+                    level,
+                    tag,
+                    &tm,
+                    _msg_t(msg)));
 #else
-                size = bflogc_snprintf(
-                    buf,
-                    BFLOG_LINE_BUFFER_SIZE * 2,
-                    BFLOG_SIMPLE_LAYOUT_STRING(
-                        color,
-                        level,
-                        tag,
-                        NULL,
-                        _msg_t(msg)));
+            size = bflogc_snprintf(
+                buf,
+                BFLOG_LINE_BUFFER_SIZE * 2,
+                BFLOG_SIMPLE_LAYOUT_STRING(
+                    color,
+                    level,
+                    tag,
+                    NULL,
+                    _msg_t(msg)));
 #endif
 
-            } else {
-                /*!< default and simple no color format */
+        } else {
+            /*!< default and simple no color format */
 #ifdef BFLOG_TIMESTAMP_ENABLE
-                size = bflogc_snprintf(
-                    buf,
-                    BFLOG_LINE_BUFFER_SIZE * 2,
-                    BFLOG_SIMPLE_LAYOUT_STRING(
-                        bflog_dummy_string,
-                        level,
-                        tag,
-                        &tm,
-                        _msg_t(msg)));
+            size = bflogc_snprintf(
+                buf,
+                BFLOG_LINE_BUFFER_SIZE * 2,
+                BFLOG_SIMPLE_LAYOUT_STRING(
+                    bflog_dummy_string,
+                    level,
+                    tag,
+                    &tm,
+                    _msg_t(msg)));
 #else
-                size = bflogc_snprintf(
-                    buf,
-                    BFLOG_LINE_BUFFER_SIZE * 2,
-                    BFLOG_SIMPLE_LAYOUT_STRING(
-                        bflog_dummy_string,
-                        level,
-                        tag,
-                        NULL,
-                        _msg_t(msg)));
+            size = bflogc_snprintf(
+                buf,
+                BFLOG_LINE_BUFFER_SIZE * 2,
+                BFLOG_SIMPLE_LAYOUT_STRING(
+                    bflog_dummy_string,
+                    level,
+                    tag,
+                    NULL,
+                    _msg_t(msg)));
 #endif
-            }
-
-        output:
-            /*!< check true size */
-            if ((size < 0) || (size > BFLOG_LINE_BUFFER_SIZE * 2)) {
-                size = BFLOG_LINE_BUFFER_SIZE * 2;
-            }
+        }
 
-            if (_direct_t(direct)->lock()) {
-                /*!< drop log message */
-            } else {
-                /*!< call write */
-                _direct_t(direct)->write(direct, buf, size);
+    output:
+        /*!< check true size */
+        if ((size < 0) || (size > BFLOG_LINE_BUFFER_SIZE * 2)) {
+            size = BFLOG_LINE_BUFFER_SIZE * 2;
+        }
 
-                _direct_t(direct)->unlock();
-            }
+        if (_direct_t(direct)->lock()) {
+            /*!< drop log message */
+        } else {
+            /*!< call write */
+            _direct_t(direct)->write(direct, buf, size);
 
-            _bflog_t(log)->enter_critical();
+            _direct_t(direct)->unlock();
         }
 
-        _bflog_t(log)->exit_critical();
-    } while (1);
+        _bflog_t(log)->enter_critical();
+    }
 
-    return -1;
+    _bflog_t(log)->exit_critical();
 }
 
 /**
- * @}
+ *   @brief         output drop statistics once after msg lost
+ *   @param  log                    recorder
+ *   @param  buf                    layout buffer, 2xline buffer size
  */
+static void bflog_flush_drop(void *log, char *buf)
+{
+    uint8_t msg[BFLOG_LINE_BUFFER_SIZE + sizeof(struct _bflog_msg)];
+    uint32_t full = __atomic_load_n(&(_bflog_t(log)->drop.full), __ATOMIC_RELAXED);
+    uint32_t rate = __atomic_load_n(&(_bflog_t(log)->drop.rate), __ATOMIC_RELAXED);
+    int ret;
 
-/** @addtogroup BFLOG_DIRECT_API
- * @{
+    if (full + rate == _bflog_t(log)->drop.report) {
+        return;
+    }
+
+    ret = bflogc_snprintf(
+        _msg_t(msg)->string,
+        BFLOG_LINE_BUFFER_SIZE,
+        "bflog dropped %lu msg, queue full %lu, rate limit %lu\r\n",
+        (unsigned long)(full + rate - _bflog_t(log)->drop.report),
+        (unsigned long)full,
+        (unsigned long)rate);
+    _bflog_t(log)->drop.report = full + rate;
+
+    if (ret < 0) {
+        return;
+    }
+
+    _msg_t(msg)->size = sizeof(struct _bflog_msg);
+    _msg_t(msg)->level = BFLOG_LEVEL_WARN;
+    _msg_t(msg)->zero = 0;
+    _msg_t(msg)->time = (_bflog_t(log)->flags & BFLOG_FLAG_TIME) ? bflog_time() : 0;
+    _msg_t(msg)->clk = (_bflog_t(log)->flags & BFLOG_FLAG_CLK) ? bflog_clock() : 0;
+    _msg_t(msg)->line = 0;
+    _msg_t(msg)->func = bflog_dummy_string;
+    _msg_t(msg)->file = bflog_dummy_string;
+    _msg_t(msg)->tag = NULL;
+    _msg_t(msg)->thread = bflog_dummy_string;
+
+    bflog_flush_msg(log, msg, buf);
+}
+
+/**
+ *   @brief         flush lockfree queue, msg is output in place
+ *                  and released in batch of BFLOG_QUEUE_BATCH
+ *   @param  log                    recorder
+ *   @param  buf                    layout buffer, 2xline buffer size
+ *   @return int
+ */
+static int bflog_flush_lockfree(void *log, char *buf)
+{
+    char *pool = (char *)(_bflog_t(log)->queue.pool);
+    uint32_t mask = _bflog_t(log)->queue.mask;
+    uint32_t whead;
+    uint32_t rhead;
+    uint32_t pos;
+    uint32_t head;
+
+    /*!< single consumer, other flusher returns and leave msg to current one */
+    if (__atomic_exchange_n(&(_bflog_t(log)->queue.drain), 1, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+
+    do {
+        /*!< working only during running */
+        if (_bflog_t(log)->status != BFLOG_STATUS_RUNNING) {
+            __atomic_store_n(&(_bflog_t(log)->queue.drain), 0, __ATOMIC_RELEASE);
+            return -1;
+        }
+
+        /*!< never parse past claimed space, beyond whead the pool is free */
+        whead = __atomic_load_n(&(_bflog_t(log)->queue.whead), __ATOMIC_ACQUIRE);
+        rhead = _bflog_t(log)->queue.rhead;
+        pos = rhead;
+
+        for (uint32_t i = 0; (i < BFLOG_QUEUE_BATCH) && (pos != whead); i++) {
+            /*!< head is written last by producer, zero means not committed */
+            head = __atomic_load_n(&(_msg_t(pool + (pos & mask))->head), __ATOMIC_ACQUIRE);
+            if (head == 0) {
+                break;
+            }
+
+            /*!< head is size[15:0] level[23:16] zero[31:24], skip record has zero set */
+            if ((head >> 24) == 0) {
+                bflog_flush_msg(log, pool + (pos & mask), buf);
+            }
+
+            pos += head & 0xffff;
+        }
+
+        if (pos == rhead) {
+            break;
+        }
+
+        /*!< clear whole msg before releasing space to producers, free pool stays zero */
+        /*!< so a claimed but unpublished msg head reads zero, not stale body bytes */
+        while (rhead != pos) {
+            uint16_t size = _msg_t(pool + (rhead & mask))->size;
+            memset(pool + (rhead & mask), 0, size);
+            rhead += size;
+        }
+
+        __atomic_store_n(&(_bflog_t(log)->queue.rhead), pos, __ATOMIC_RELEASE);
+    } while (1);
+
+    __atomic_store_n(&(_bflog_t(log)->queue.drain), 0, __ATOMIC_RELEASE);
+
+    bflog_flush_drop(log, buf);
+
+    return 0;
+}
+
+/**
+ *   @brief         flush all msg in queue, thread safe
+ *   @param  log                    recorder
+ *   @return int
+ */
+int bflog_flush(void *log)
+{
+    _BFLOG_CHECK(log != NULL, -1);
+
+    uint8_t msg[BFLOG_LINE_BUFFER_SIZE + sizeof(struct _bflog_msg)];
+    char buf[BFLOG_LINE_BUFFER_SIZE * 2];
+
+    /*!< working only during running */
+    switch (_bflog_t(log)->status) {
+        case BFLOG_STATUS_SUSPEND:
+            return -1;
+        case BFLOG_STATUS_RUNNING:
+            break;
+        default:
+            return -1;
+    }
+
+    if (_BFLOG_LOCKFREE(log)) {
+        return bflog_flush_lockfree(log, buf);
+    }
+
+    do {
+        /*!< reset msg string */
+        _msg_t(msg)->string[0] = '\0';
+
+        if (_bflog_t(log)->enter_critical()) {
+            return -1;
+        }
+
+        /*!< working only during running */
+        switch (_bflog_t(log)->status) {
+            case BFLOG_STATUS_SUSPEND:
+                _bflog_t(log)->exit_critical();
+                return -1;
+            case BFLOG_STATUS_RUNNING:
+                break;
+            default:
+                _bflog_t(log)->exit_critical();
+                return -1;
+        }
+
+        /*!< get msg(on stack) from queue(on ram) */
+        queue_get(_bflog_t(log), (void *)(&msg));
+
+        _bflog_t(log)->exit_critical();
+
+        if (_msg_t(msg)->zero != 0) {
+            if (_msg_t(msg)->zero == 0xbd) {
+                /*!< no msg */
+                bflog_flush_drop(log, buf);
+                return 0;
+            } else {
+                /*!< error */
+                return -1;
+            }
+        }
+
+        bflog_flush_msg(log, msg, buf);
+    } while (1);
+
+    return -1;
+}
+
+/**
+ * @}
+ */
+
+/** @addtogroup BFLOG_DIRECT_API
+ * @{
  */
 
 /**
@@ -1470,7 +1986,8 @@ int bflog_direct_create(bflog_direct_t *direct, uint8_t type, uint8_t color, voi
             type != BFLOG_DIRECT_TYPE_STREAM ||
             type != BFLOG_DIRECT_TYPE_FILE ||
             type != BFLOG_DIRECT_TYPE_FILE_TIME ||
-            type != BFLOG_DIRECT_TYPE_FILE_SIZE,
+            type != BFLOG_DIRECT_TYPE_FILE_SIZE ||
+            type != BFLOG_DIRECT_TYPE_FILE_BLOCK,
         -1);
 
     bflog_dlist_init(&(direct->list));
@@ -2234,6 +2751,373 @@ int bflog_direct_deinit_file_size(bflog_direct_t *direct)
 
 #endif
 
+#ifdef BFLOG_DIRECT_FILE_BLOCK_ENABLE
+
+/**
+ *   @brief         block header, each block holds one compressed batch
+ *                  blocks are ordered by seq, tstart/tend index the batch time
+ */
+struct _bflog_block_head {
+    uint32_t magic;  /*!< BFLOG_BLOCK_MAGIC */
+    uint32_t seq;    /*!< block sequence, file offset is (seq % count) * block */
+    uint32_t tstart; /*!< time of first record */
+    uint32_t tend;   /*!< time of last record */
+    uint32_t rsize;  /*!< raw size */
+    uint32_t csize;  /*!< payload size */
+    uint32_t flags;  /*!< BFLOG_BLOCK_FLAG_LZ, payload compressed */
+    uint32_t crc;    /*!< crc32 of header with crc 0 and payload */
+};
+
+#define BFLOG_BLOCK_MAGIC   0x42474c42
+#define BFLOG_BLOCK_FLAG_LZ 0x00000001
+
+/*!< lzf format, literal run max 32, match max 264, window 8k */
+#define BFLOG_LZ_HASH_SIZE  (1 << BFLOG_LZ_HASH_BITS)
+#define BFLOG_LZ_WINDOW     (1 << 13)
+#define BFLOG_LZ_MATCH_MAX  (264)
+#define BFLOG_LZ_HASH(_p)   ((((uint32_t)(_p)[0] << 16 | (uint32_t)(_p)[1] << 8 | (_p)[2]) * 2654435761U) >> (32 - BFLOG_LZ_HASH_BITS))
+
+/**
+ *   @brief         compress until input end or output full
+ *   @param  in                     raw data
+ *   @param  in_len                 raw size
+ *   @param  consumed               raw bytes consumed
+ *   @param  out                    payload
+ *   @param  out_size               payload size
+ *   @param  hash                   hash table, BFLOG_LZ_HASH_SIZE entries
+ *   @return uint32_t               payload bytes
+ */
+static uint32_t bflog_lz_compress(const uint8_t *in, uint32_t in_len, uint32_t *consumed, uint8_t *out, uint32_t out_size, uint16_t *hash)
+{
+    uint32_t ip = 0;
+    uint32_t op = 1; /*!< out[0] reserved for first literal run length */
+    uint32_t lit = 0;
+
+    memset(hash, 0, BFLOG_LZ_HASH_SIZE * sizeof(uint16_t));
+
+    /*!< worst case step is a match token plus next literal run length */
+    while ((ip + 2 < in_len) && (op + 4 <= out_size)) {
+        uint32_t h = BFLOG_LZ_HASH(in + ip);
+        uint32_t ref = hash[h];
+        uint32_t off = ip - ref; /*!< distance minus one */
+
+        /*!< hash stores position plus one, 0 is empty */
+        hash[h] = ip + 1;
+
+        if (ref && (off < BFLOG_LZ_WINDOW) &&
+            (in[ref - 1] == in[ip]) && (in[ref] == in[ip + 1]) && (in[ref + 1] == in[ip + 2])) {
+            uint32_t len = 3;
+            uint32_t max = in_len - ip;
+
+            if (max > BFLOG_LZ_MATCH_MAX) {
+                max = BFLOG_LZ_MATCH_MAX;
+            }
+            while ((len < max) && (in[ref - 1 + len] == in[ip + len])) {
+                len++;
+            }
+
+            /*!< close literal run, drop reserved byte if empty */
+            if (lit) {
+                out[op - lit - 1] = lit - 1;
+            } else {
+                op--;
+            }
+
+            if (len - 2 < 7) {
+                out[op++] = (off >> 8) + ((len - 2) << 5);
+            } else {
+                out[op++] = (off >> 8) + (7 << 5);
+                out[op++] = len - 2 - 7;
+            }
+            out[op++] = off & 0xff;
+
+            lit = 0;
+            op++;
+            ip += len;
+        } else {
+            lit++;
+            out[op++] = in[ip++];
+
+            if (lit == 32) {
+                out[op - lit - 1] = lit - 1;
+                lit = 0;
+                op++;
+            }
+        }
+    }
+
+    /*!< tail bytes as literal */
+    while ((ip < in_len) && (ip + 2 >= in_len) && (op + 2 <= out_size)) {
+        lit++;
+        out[op++] = in[ip++];
+
+        if (lit == 32) {
+            out[op - lit - 1] = lit - 1;
+            lit = 0;
+            op++;
+        }
+    }
+
+    if (lit) {
+        out[op - lit - 1] = lit - 1;
+    } else {
+        op--;
+    }
+
+    *consumed = ip;
+
+    return op;
+}
+
+/**
+ *   @brief         write one block from the head of raw batch
+ *   @param  direct
+ */
+static void file_block_flush(bflog_direct_file_block_t *direct)
+{
+    struct _bflog_block_head *head = (struct _bflog_block_head *)(direct->out);
+    uint8_t *payload = direct->out + sizeof(struct _bflog_block_head);
+    uint32_t payload_size = direct->block - sizeof(struct _bflog_block_head);
+    uint32_t consumed;
+    struct crc32_stream_ctx crc;
+
+    if (direct->rawlen == 0) {
+        return;
+    }
+
+    head->csize = bflog_lz_compress(direct->raw, direct->rawlen, &consumed, payload, payload_size, direct->hash);
+    head->flags = BFLOG_BLOCK_FLAG_LZ;
+
+    /*!< store uncompressible batch */
+    if (head->csize >= consumed) {
+        consumed = (direct->rawlen < payload_size) ? direct->rawlen : payload_size;
+        bflogc_memcpy(payload, direct->raw, consumed);
+        head->csize = consumed;
+        head->flags = 0;
+    }
+
+    head->magic = BFLOG_BLOCK_MAGIC;
+    head->seq = direct->seq;
+    head->tstart = direct->tstart;
+    head->tend = direct->tend;
+    head->rsize = consumed;
+    head->crc = 0;
+
+    utils_crc32_stream_init(&crc);
+    utils_crc32_stream_feed_block(&crc, direct->out, sizeof(struct _bflog_block_head) + head->csize);
+    head->crc = utils_crc32_stream_results(&crc);
+
+    /*!< only header and payload are written, stale tail of block is ignored */
+    bflogc_fseek(direct->fp, (long)(direct->seq % direct->count) * direct->block, SEEK_SET);
+    bflogc_fwrite(direct->out, 1, sizeof(struct _bflog_block_head) + head->csize, direct->fp);
+    bflogc_fflush(direct->fp);
+
+    direct->seq++;
+    direct->rawlen -= consumed;
+    memmove(direct->raw, direct->raw + consumed, direct->rawlen);
+    direct->tstart = direct->tend;
+}
+
+/**
+ *   @brief         write data to raw batch, compress to block when batch full or aged
+ *   @param  direct
+ *   @param  ptr
+ *   @param  size
+ */
+static void bflog_direct_write_file_block(bflog_direct_t *direct, void *ptr, uint16_t size)
+{
+    _BFLOG_CHECK(direct != NULL, );
+    _BFLOG_CHECK(ptr != NULL, );
+
+    bflog_direct_file_block_t *block = _direct_file_block_t(direct);
+    uint32_t timestamp;
+
+    if (block->fp == NULL) {
+        return;
+    }
+
+    timestamp = bflog_time();
+
+    while (block->rawlen + size > block->rawsize) {
+        file_block_flush(block);
+    }
+
+    if (block->rawlen == 0) {
+        block->tstart = timestamp;
+    }
+    block->tend = timestamp;
+
+    bflogc_memcpy(block->raw + block->rawlen, ptr, size);
+    block->rawlen += size;
+
+    /*!< limit how long records stay in ram */
+    if (timestamp - block->tstart >= block->interval) {
+        while (block->rawlen) {
+            file_block_flush(block);
+        }
+    }
+}
+
+/**
+ *   @brief         file is a ring of count blocks, write continues after the newest block
+ *   @param  direct                 directed output
+ *   @param  path                   file path
+ *   @param  block                  block size, flash sector size is preferred
+ *   @param  count                  block count in file
+ *   @param  interval               max seconds records stay in ram before written
+ *   @param  buffer                 work buffer, hash table, one block and raw batch
+ *   @param  size                   work buffer size, text compresses about 5x so a raw batch of 6 blocks fills each block
+ *   @return int
+ */
+int bflog_direct_init_file_block(bflog_direct_t *direct, const char *path, uint32_t block, uint32_t count, uint32_t interval, void *buffer, uint32_t size)
+{
+    _BFLOG_CHECK(direct != NULL, -1);
+    _BFLOG_CHECK(path != NULL, -1);
+    _BFLOG_CHECK(buffer != NULL, -1);
+    _BFLOG_CHECK(count > 0, -1);
+
+    char fullpath[256];
+    struct _bflog_block_head head;
+    uint32_t hash_size = BFLOG_LZ_HASH_SIZE * sizeof(uint16_t);
+    int found = 0;
+
+    /*!< block must hold a full line, raw batch must hold a line and index fit in hash */
+    if ((block < sizeof(struct _bflog_block_head) + BFLOG_LINE_BUFFER_SIZE * 2) ||
+        (size < hash_size + block + BFLOG_LINE_BUFFER_SIZE * 2) ||
+        (size - hash_size - block > 0xffff)) {
+        return -1;
+    }
+
+    if (direct->lock()) {
+        return -1;
+    }
+
+    if (direct->type != BFLOG_DIRECT_TYPE_FILE_BLOCK) {
+        direct->unlock();
+        return -1;
+    }
+
+    if (direct->status != BFLOG_DIRECT_STATUS_INIT) {
+        direct->unlock();
+        return -1;
+    }
+
+    size_t pathsize = strlen(path);
+    bflogc_memcpy(fullpath, path, pathsize);
+    bflogc_snprintf(fullpath + pathsize, 16, ".blk");
+
+    _direct_file_block_t(direct)->fp = bflogc_fopen(fullpath, "r+");
+    if (_direct_file_block_t(direct)->fp == NULL) {
+        _direct_file_block_t(direct)->fp = bflogc_fopen(fullpath, "w+");
+    }
+    if (_direct_file_block_t(direct)->fp == NULL) {
+        direct->unlock();
+        return -1;
+    }
+
+    /*!< continue after newest block, only headers are read */
+    _direct_file_block_t(direct)->seq = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (bflogc_fseek(_direct_file_block_t(direct)->fp, (long)i * block, SEEK_SET) ||
+            (bflogc_fread(&head, sizeof(head), 1, _direct_file_block_t(direct)->fp) != 1)) {
+            break;
+        }
+        if ((head.magic == BFLOG_BLOCK_MAGIC) && ((head.seq % count) == i) &&
+            (!found || (int32_t)(head.seq - _direct_file_block_t(direct)->seq) >= 0)) {
+            _direct_file_block_t(direct)->seq = head.seq + 1;
+            found = 1;
+        }
+    }
+
+    _direct_file_block_t(direct)->hash = buffer;
+    _direct_file_block_t(direct)->out = (uint8_t *)buffer + hash_size;
+    _direct_file_block_t(direct)->raw = (uint8_t *)buffer + hash_size + block;
+    _direct_file_block_t(direct)->rawsize = size - hash_size - block;
+    _direct_file_block_t(direct)->rawlen = 0;
+    _direct_file_block_t(direct)->block = block;
+    _direct_file_block_t(direct)->count = count;
+    _direct_file_block_t(direct)->interval = interval;
+    _direct_file_block_t(direct)->path = path;
+
+    direct->status = BFLOG_DIRECT_STATUS_READY;
+    direct->write = bflog_direct_write_file_block;
+
+    direct->unlock();
+
+    return 0;
+}
+
+/**
+ *   @brief         write all batched records to file
+ *   @param  direct
+ *   @return int
+ */
+int bflog_direct_sync_file_block(bflog_direct_t *direct)
+{
+    _BFLOG_CHECK(direct != NULL, -1);
+
+    if (direct->type != BFLOG_DIRECT_TYPE_FILE_BLOCK) {
+        return -1;
+    }
+
+    if (direct->lock()) {
+        return -1;
+    }
+
+    if (_direct_file_block_t(direct)->fp != NULL) {
+        while (_direct_file_block_t(direct)->rawlen) {
+            file_block_flush(_direct_file_block_t(direct));
+        }
+    }
+
+    direct->unlock();
+
+    return 0;
+}
+
+/**
+ *   @brief
+ *   @param  direct
+ *   @return int
+ */
+int bflog_direct_deinit_file_block(bflog_direct_t *direct)
+{
+    _BFLOG_CHECK(direct != NULL, -1);
+
+    if (direct->type != BFLOG_DIRECT_TYPE_FILE_BLOCK) {
+        return -1;
+    }
+
+    if (direct->status != BFLOG_DIRECT_STATUS_READY) {
+        return -1;
+    }
+
+    if (direct->lock()) {
+        return -1;
+    }
+
+    while (_direct_file_block_t(direct)->rawlen) {
+        file_block_flush(_direct_file_block_t(direct));
+    }
+
+    if (bflogc_fclose(_direct_file_block_t(direct)->fp)) {
+        direct->unlock();
+        return -1;
+    }
+
+    direct->status = BFLOG_DIRECT_STATUS_INIT;
+    direct->write = NULL;
+    _direct_file_block_t(direct)->fp = NULL;
+    _direct_file_block_t(direct)->path = NULL;
+    _direct_file_block_t(direct)->rawlen = 0;
+
+    direct->unlock();
+
+    return 0;
+}
+
+#endif
+
 /**
  * @}
  */
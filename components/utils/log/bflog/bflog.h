@@ -190,7 +190,8 @@
 #define BFLOG_LEVEL_INFO            0x03 /*!< level information           */
 #define BFLOG_LEVEL_DEBUG           0x04 /*!< level debug                 */
 #define BFLOG_LEVEL_TRACE           0x05 /*!< level trace information     */
-#define BFLOG_LEVEL_MASK            0x7F /*!< level mask */
+#define BFLOG_LEVEL_MASK            0x3F /*!< level mask */
+#define BFLOG_LEVEL_DEFERRED        0x40 /*!< level deferred bit, set by recorder */
 #define BFLOG_LEVEL_RAW             0x80 /*!< level raw bit */
 /**
  * @}
@@ -231,6 +232,17 @@
  */
 #define BFLOG_MODE_SYNC             ((uint8_t)0x00)
 #define BFLOG_MODE_ASYNC            ((uint8_t)0x01)
+#define BFLOG_MODE_DEFERRED         ((uint8_t)0x02) /*!< record raw args, format on host */
+#define BFLOG_MODE_LOCKFREE         ((uint8_t)0x04) /*!< lockfree multi producer queue, async mode only */
+/**
+ * @}
+ */
+
+/** @addtogroup BFLOG_FRAME
+ * @{
+ */
+#define BFLOG_FRAME_SYNC0           ((uint8_t)0xBF)
+#define BFLOG_FRAME_SYNC1           ((uint8_t)0x5A)
 /**
  * @}
  */
@@ -288,12 +300,13 @@
 /** @addtogroup BFLOG_DIRECT_TYPE
  * @{
  */
-#define BFLOG_DIRECT_TYPE_ILLEGAL   ((uint8_t)0x00)
-#define BFLOG_DIRECT_TYPE_BUFFER    ((uint8_t)0x01)
-#define BFLOG_DIRECT_TYPE_STREAM    ((uint8_t)0x02)
-#define BFLOG_DIRECT_TYPE_FILE      ((uint8_t)0x03)
-#define BFLOG_DIRECT_TYPE_FILE_TIME ((uint8_t)0x04)
-#define BFLOG_DIRECT_TYPE_FILE_SIZE ((uint8_t)0x05)
+#define BFLOG_DIRECT_TYPE_ILLEGAL    ((uint8_t)0x00)
+#define BFLOG_DIRECT_TYPE_BUFFER     ((uint8_t)0x01)
+#define BFLOG_DIRECT_TYPE_STREAM     ((uint8_t)0x02)
+#define BFLOG_DIRECT_TYPE_FILE       ((uint8_t)0x03)
+#define BFLOG_DIRECT_TYPE_FILE_TIME  ((uint8_t)0x04)
+#define BFLOG_DIRECT_TYPE_FILE_SIZE  ((uint8_t)0x05)
+#define BFLOG_DIRECT_TYPE_FILE_BLOCK ((uint8_t)0x06)
 /**
  * @}
  */
@@ -377,6 +390,10 @@ struct _bflog_tag {
     char *tag;
     /*!< max 32 filter */
     uint32_t en;
+    /*!< max msg per BFLOG_RATE_LIMIT_PERIOD clock, 0 is unlimited */
+    uint16_t rate;
+    uint16_t count;
+    uint32_t window;
 };
 
 /**
@@ -411,6 +428,26 @@ struct _bflog_msg {
     char string[0];     /*!< msg string */
 };
 
+/**
+ *   @brief         deferred binary frame, written to direct instead of text
+ *                  string addresses are resolved from elf on host, see scripts/bflog_decode.py
+ */
+struct _bflog_frame {
+    uint8_t sync[2]; /*!< BFLOG_FRAME_SYNC0, BFLOG_FRAME_SYNC1 */
+    uint16_t size;   /*!< args size */
+    uint8_t level;   /*!< msg level */
+    uint8_t sum;     /*!< byte sum of frame and args is 0xff */
+    uint16_t line;   /*!< msg line */
+    uint32_t time;   /*!< rtc timestamp */
+    uint32_t clkl;   /*!< cpu clock tick low 4byte */
+    uint32_t clkh;   /*!< cpu clock tick high 4byte */
+    uint32_t format; /*!< format string address */
+    uint32_t tag;    /*!< tag string address */
+    uint32_t file;   /*!< file string address */
+    uint32_t func;   /*!< func string address */
+    uint8_t args[0]; /*!< raw format args */
+};
+
 /**
  *   @brief         recorder base type
  */
@@ -435,7 +472,18 @@ typedef struct
         uint16_t wpos;
         uint16_t rpos;
         void *pool;
+        uint32_t mask;  /*!< lockfree queue size minus one */
+        uint32_t whead; /*!< lockfree free running write index, claimed by producers */
+        uint32_t rhead; /*!< lockfree free running read index */
+        uint32_t drain; /*!< lockfree consumer busy */
     } queue;
+
+    struct
+    {
+        uint32_t full;   /*!< msg dropped or evicted, queue full */
+        uint32_t rate;   /*!< msg dropped by tag rate limit */
+        uint32_t report; /*!< drop count already reported */
+    } drop;
 } bflog_t;
 
 #define _BFLOG_STRUCT_LAYOUT_EXTENDS \
@@ -548,6 +596,27 @@ typedef struct
     uint32_t keep;
 } bflog_direct_file_size_t;
 
+/**
+ *   @brief         direct compressed block file type
+ */
+typedef struct
+{
+    _BFLOG_STRUCT_DIRECT_EXTENDS;
+    void *fp;
+    const char *path;
+    uint32_t block;    /*!< block size */
+    uint32_t count;    /*!< block count in file */
+    uint32_t interval; /*!< max seconds records stay in ram */
+    uint32_t seq;      /*!< next block sequence */
+    uint32_t tstart;   /*!< time of first batched record */
+    uint32_t tend;     /*!< time of last batched record */
+    uint16_t *hash;    /*!< lz hash table */
+    uint8_t *out;      /*!< block buffer */
+    uint8_t *raw;      /*!< raw batch */
+    uint32_t rawsize;
+    uint32_t rawlen;
+} bflog_direct_file_block_t;
+
 /**
  * @}
  */
@@ -557,6 +626,7 @@ extern uint32_t bflog_time(void);
 extern char *bflog_thread(void);
 
 extern int bflog_global_filter(void *tag_string, uint8_t enable);
+extern int bflog_rate_limit(void *tag_string, uint16_t rate);
 
 extern int bflog_create(bflog_t *log, void *pool, uint16_t size, uint8_t mode);
 extern int bflog_delete(bflog_t *log);
@@ -592,6 +662,10 @@ extern int bflog_direct_deinit_file_size(bflog_direct_t *direct);
 extern int bflog_direct_init_file_time(bflog_direct_t *direct, const char *path, uint32_t interval, uint32_t keep);
 extern int bflog_direct_deinit_file_time(bflog_direct_t *direct);
 
+extern int bflog_direct_init_file_block(bflog_direct_t *direct, const char *path, uint32_t block, uint32_t count, uint32_t interval, void *buffer, uint32_t size);
+extern int bflog_direct_sync_file_block(bflog_direct_t *direct);
+extern int bflog_direct_deinit_file_block(bflog_direct_t *direct);
+
 extern int bflog_layout_create(bflog_layout_t *layout, uint8_t type);
 extern int bflog_layout_delete(bflog_layout_t *layout);
 extern int bflog_layout_format(bflog_layout_t *layout, int (*u_snprintf)(void *ptr, uint16_t size, char *color, char *level, char *tag, bflog_tm_t *tm, struct _bflog_msg *msg));
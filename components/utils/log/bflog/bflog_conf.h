@@ -68,6 +68,10 @@
 /*!< enable file size directed output */
 #define BFLOG_DIRECT_FILE_SIZE_ENABLE
 
+/*!< 使能压缩块文件输出器 */
+/*!< enable compressed block file directed output */
+#define BFLOG_DIRECT_FILE_BLOCK_ENABLE
+
 /*!< 使能短文件名 */
 /*!< enable short file name */
 #define BFLOG_SHORT_FILENAME
@@ -84,6 +88,10 @@
 /*!< enable line record, flash use low */
 #define BFLOG_LINE_ENABLE
 
+/*!< 使能延迟格式化, BFLOG_MODE_DEFERRED 模式下只记录格式串地址和参数, 由主机解析 */
+/*!< enable deferred mode, record format address and args only, decode on host */
+#define BFLOG_DEFERRED_ENABLE
+
 /*!< 行缓冲大小, 使用的是栈上空间, 请确保栈空间足够 */
 /*!< 行缓冲设置大小不足时, 一次长LOG输出可能不完整 */
 /*!< line buffer size (in stack) */
@@ -0,0 +1,62 @@
+/**
+ * @file bflog_conf_user.h
+ * @brief host test config, only the stream direct and plain message output
+ *
+ * Copyright (c) 2021 Bouffalolab team
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#ifndef _BFLOG_CONF_H
+#define _BFLOG_CONF_H
+
+#include "bflog.h"
+
+/*!< log enable */
+#define BFLOG_ENABLE
+
+/*!< log enable level */
+#define BFLOG_LEVEL_ENABLE         BFLOG_LEVEL_TRACE
+
+/*!< default log record level */
+#define BFLOG_LEVEL_DEFAULT        BFLOG_LEVEL_TRACE
+
+/*!< default direct print level */
+#define BFLOG_DIRECT_LEVEL_DEFAULT BFLOG_LEVEL_TRACE
+
+/*!< enable stream directed output */
+#define BFLOG_DIRECT_STREAM_ENABLE
+
+/*!< line buffer size (in stack) */
+#define BFLOG_LINE_BUFFER_SIZE     256
+
+/*!< default record flag config */
+#define BFLOG_FLAG_DEFAULT         (BFLOG_FLAG_LEVEL)
+
+/*!< simple layout, the message only, so the test sees what was logged */
+#define BFLOG_SIMPLE_LAYOUT_STRING(_color, _level, _tag, _tm, _msg) \
+    "%s", ((_msg)->string)
+
+/*!< level string config */
+#define BFLOG_LEVEL_FATAL_STRING   "FATL"
+#define BFLOG_LEVEL_ERROR_STRING   "ERRO"
+#define BFLOG_LEVEL_WARN_STRING    "WARN"
+#define BFLOG_LEVEL_INFO_STRING    "INFO"
+#define BFLOG_LEVEL_DEBUG_STRING   "DBUG"
+#define BFLOG_LEVEL_TRACE_STRING   "TRAC"
+
+#endif
@@ -0,0 +1,220 @@
+/**
+ * @file bflog_test.c
+ * @brief host test of the lockfree queue: message content and order across ring wraps
+ *
+ * Copyright (c) 2021 Bouffalolab team
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include "bflog.h"
+
+#define TEST_PRODUCER_MAX 8
+#define TEST_MSG_LEN_MAX  90
+
+/* no advanced tags on the host, the linker script would define these around .bflog_tags_array */
+struct _bflog_tag __bflog_tags_start__;
+extern struct _bflog_tag __bflog_tags_end__ __attribute__((alias("__bflog_tags_start__")));
+
+static bflog_t test_recorder;
+static bflog_direct_stream_t test_stream;
+static uint64_t test_pool[4096 / 8];
+
+static uint32_t msg_num = 2000;
+static uint32_t last_seq[TEST_PRODUCER_MAX];
+static uint32_t out_msgs;
+static uint32_t out_drops;
+static uint32_t out_bad;
+static volatile int producers_done;
+
+uint64_t bflog_clock(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t bflog_time(void)
+{
+    return (uint32_t)time(NULL);
+}
+
+char *bflog_thread(void)
+{
+    return "";
+}
+
+/* message n of producer id: a header, then a payload whose length and bytes depend on both */
+static int test_format(char *buf, uint32_t id, uint32_t n)
+{
+    int len = sprintf(buf, "p%u n%u ", id, n);
+    uint32_t pay = (id * 31 + n * 37) % TEST_MSG_LEN_MAX;
+
+    for (uint32_t k = 0; k < pay; k++) {
+        buf[len++] = 'a' + (id + n + k) % 26;
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+/* the flusher is the only caller, one call per message */
+static uint16_t test_stream_output(void *ptr, uint16_t size)
+{
+    char expect[BFLOG_LINE_BUFFER_SIZE];
+    uint32_t id, n;
+
+    if ((size >= 13) && !memcmp(ptr, "bflog dropped", 13)) {
+        out_drops++;
+        return size;
+    }
+
+    if ((sscanf(ptr, "p%u n%u ", &id, &n) != 2) || (id >= TEST_PRODUCER_MAX) ||
+        (n < last_seq[id]) || (test_format(expect, id, n) != size) || memcmp(ptr, expect, size)) {
+        if (out_bad++ < 5) {
+            printf("bad msg: %.*s\n", size, (char *)ptr);
+        }
+        return size;
+    }
+
+    /* a producer's messages come out in order, a gap is a drop */
+    last_seq[id] = n + 1;
+    out_msgs++;
+    return size;
+}
+
+static void test_reset(uint16_t pool_size)
+{
+    bflog_suspend(&test_recorder);
+    bflog_control(&test_recorder, BFLOG_CMD_QUEUE_SIZE, pool_size);
+    bflog_control(&test_recorder, BFLOG_CMD_QUEUE_RST, 0);
+    test_recorder.drop.full = 0;
+    test_recorder.drop.rate = 0;
+    test_recorder.drop.report = 0;
+    bflog_resume(&test_recorder);
+
+    memset(last_seq, 0, sizeof(last_seq));
+    out_msgs = out_drops = out_bad = 0;
+}
+
+static void test_log(uint32_t id, uint32_t n)
+{
+    char msg[BFLOG_LINE_BUFFER_SIZE];
+
+    test_format(msg, id, n);
+    bflog(&test_recorder, BFLOG_LEVEL_INFO | BFLOG_LEVEL_RAW, NULL, "", "", 0, "%s", msg);
+}
+
+/* one producer, flushed after each message, nothing may be lost while two msg fit the pool */
+static int test_wrap(uint16_t pool_size, uint32_t num)
+{
+    test_reset(pool_size);
+
+    for (uint32_t n = 0; n < num; n++) {
+        test_log(0, n);
+        bflog_flush(&test_recorder);
+    }
+
+    printf("wrap  pool %4u: %5u msg, %5u out, %u dropped, %u bad\n", pool_size, num, out_msgs,
+           test_recorder.drop.full, out_bad);
+    return ((out_msgs != num) || out_bad || test_recorder.drop.full) ? 1 : 0;
+}
+
+static void *producer_thread(void *arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+
+    for (uint32_t n = 0; n < msg_num; n++) {
+        test_log(id, n);
+        /* give the flusher a turn, or nearly everything is dropped as queue full */
+        sched_yield();
+    }
+    return NULL;
+}
+
+static void *consumer_thread(void *arg)
+{
+    while (!__atomic_load_n(&producers_done, __ATOMIC_ACQUIRE)) {
+        bflog_flush(&test_recorder);
+    }
+    bflog_flush(&test_recorder);
+    return NULL;
+}
+
+/* several producers and a flusher at once, the queue fills and drops the newest */
+static int test_threads(uint16_t pool_size, uint32_t producers)
+{
+    pthread_t tid[TEST_PRODUCER_MAX];
+    pthread_t consumer;
+    uint32_t total = producers * msg_num;
+
+    test_reset(pool_size);
+    producers_done = 0;
+
+    pthread_create(&consumer, NULL, consumer_thread, NULL);
+    for (uint32_t i = 0; i < producers; i++) {
+        pthread_create(&tid[i], NULL, producer_thread, (void *)(uintptr_t)i);
+    }
+    for (uint32_t i = 0; i < producers; i++) {
+        pthread_join(tid[i], NULL);
+    }
+    __atomic_store_n(&producers_done, 1, __ATOMIC_RELEASE);
+    pthread_join(consumer, NULL);
+
+    /* everything logged is either output or counted as dropped */
+    printf("%u thr pool %4u: %5u msg, %5u out, %u dropped, %u bad\n", producers, pool_size, total, out_msgs,
+           test_recorder.drop.full, out_bad);
+    return ((out_msgs + test_recorder.drop.full != total) || out_bad || (out_msgs == 0)) ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    int opt, bad = 0;
+
+    while ((opt = getopt(argc, argv, "n:h")) != -1) {
+        switch (opt) {
+            case 'n':
+                msg_num = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                printf("usage: bflog_test [-n msg per producer]\n");
+                return 1;
+        }
+    }
+
+    bflog_create(&test_recorder, test_pool, sizeof(test_pool), BFLOG_MODE_ASYNC | BFLOG_MODE_LOCKFREE);
+    bflog_direct_create((void *)&test_stream, BFLOG_DIRECT_TYPE_STREAM, BFLOG_DIRECT_COLOR_DISABLE, NULL, NULL);
+    bflog_direct_init_stream((void *)&test_stream, test_stream_output);
+    bflog_append(&test_recorder, (void *)&test_stream);
+    bflog_direct_resume((void *)&test_stream);
+    bflog_resume(&test_recorder);
+
+    bad |= test_wrap(512, 200);
+    bad |= test_wrap(1024, 2000);
+    for (uint32_t producers = 1; producers <= TEST_PRODUCER_MAX; producers <<= 1) {
+        bad |= test_threads(512, producers);
+        bad |= test_threads(4096, producers);
+    }
+
+    printf(bad ? "FAIL\n" : "all ok\n");
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Read the compressed block log file written by the bflog file block direct
+(bflog_direct_init_file_block). Only block headers are read to find the
+blocks covering the requested time range, then those blocks are decompressed
+and printed oldest first.
+
+usage: bflog_block.py log.blk --block 4096 [--since UNIX] [--until UNIX] [--list]
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+BLOCK_MAGIC = 0x42474c42
+BLOCK_FLAG_LZ = 0x1
+HEAD_FMT = "<IIIIIIII"
+HEAD_SIZE = struct.calcsize(HEAD_FMT)
+
+
+def lzf_decompress(data, size):
+    out = bytearray()
+    ip = 0
+    while ip < len(data):
+        ctrl = data[ip]
+        ip += 1
+        if ctrl < 32:
+            out += data[ip:ip + ctrl + 1]
+            ip += ctrl + 1
+            continue
+        length = ctrl >> 5
+        if length == 7:
+            length += data[ip]
+            ip += 1
+        ref = len(out) - ((ctrl & 0x1f) << 8) - data[ip] - 1
+        ip += 1
+        # overlapping copy, byte by byte
+        for i in range(length + 2):
+            out.append(out[ref + i])
+    if len(out) != size:
+        raise ValueError("raw size %d, expect %d" % (len(out), size))
+    return bytes(out)
+
+
+def read_heads(f, block):
+    """Valid headers ordered by seq, the payload crc is not checked here."""
+    heads = []
+    index = 0
+    while True:
+        f.seek(index * block)
+        raw = f.read(HEAD_SIZE)
+        if len(raw) < HEAD_SIZE:
+            break
+        head = struct.unpack(HEAD_FMT, raw)
+        if head[0] == BLOCK_MAGIC:
+            heads.append((index,) + head)
+        index += 1
+    heads.sort(key=lambda h: h[2])
+    return heads
+
+
+def read_block(f, block, head):
+    index, magic, seq, tstart, tend, rsize, csize, flags, crc = head
+    f.seek(index * block)
+    data = f.read(HEAD_SIZE + csize)
+    check = struct.pack(HEAD_FMT, magic, seq, tstart, tend, rsize, csize, flags, 0) + data[HEAD_SIZE:]
+    if len(data) != HEAD_SIZE + csize or zlib.crc32(check) & 0xffffffff != crc:
+        return None
+    payload = data[HEAD_SIZE:]
+    return lzf_decompress(payload, rsize) if flags & BLOCK_FLAG_LZ else payload
+
+
+def main():
+    parser = argparse.ArgumentParser(description="read bflog compressed block log")
+    parser.add_argument("file", help="block log file, <path>.blk")
+    parser.add_argument("--block", type=int, default=4096, help="block size given to bflog_direct_init_file_block")
+    parser.add_argument("--since", type=int, default=0, help="first unix time to print")
+    parser.add_argument("--until", type=int, default=0xffffffff, help="last unix time to print")
+    parser.add_argument("--list", action="store_true", help="list block index only")
+    args = parser.parse_args()
+
+    with open(args.file, "rb") as f:
+        heads = read_heads(f, args.block)
+
+        if args.list:
+            for h in heads:
+                print("block %4d seq %8d time %10d-%10d raw %6d payload %6d ratio %.2f" %
+                      (h[0], h[2], h[3], h[4], h[5], h[6], h[5] / max(h[6], 1)))
+            return
+
+        out = sys.stdout.buffer
+        bad = 0
+        for h in heads:
+            # blocks are in time order, skip by index without reading payload
+            if h[4] < args.since or h[3] > args.until:
+                continue
+            data = read_block(f, args.block, h)
+            if data is None:
+                bad += 1
+                continue
+            out.write(data)
+        out.flush()
+        if bad:
+            sys.stderr.write("%d corrupted blocks skipped\n" % bad)
+
+
+if __name__ == "__main__":
+    main()
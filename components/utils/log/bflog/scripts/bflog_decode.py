@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Rebuild bflog text from the binary frames written in BFLOG_MODE_DEFERRED
+(CONFIG_BFLOG_DEFERRED). Format, file, func and tag strings are read from the
+firmware elf, so it must be the exact image that produced the capture.
+Bytes outside frames (plain printf output) are passed through unchanged.
+
+usage: bflog_decode.py capture.bin --elf app.elf [--no-color]
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+FRAME_SYNC = b"\xbf\x5a"
+FRAME_FMT = "<2sHBBHIIIIIII"
+FRAME_SIZE = struct.calcsize(FRAME_FMT)
+
+LEVEL_MASK = 0x3F
+LEVEL_RAW = 0x80
+LEVEL_NAME = ("FATL", "ERRO", "WARN", "INFO", "DBUG", "TRAC")
+LEVEL_COLOR = ("\033[35m", "\033[31m", "\033[33m", "\033[0m", "\033[37m", "\033[2;37m")
+
+SPEC_RE = re.compile(r"%([-+ #0']*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|j|z|t|L)?([diouxXeEfFgGaAcspn%])")
+
+
+class Elf:
+    """Minimal elf reader, enough to fetch bytes at a loaded address."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF":
+            raise ValueError("%s is not an elf" % path)
+        self.is64 = self.data[4] == 2
+        end = "<" if self.data[5] == 1 else ">"
+        self.end = end
+        if self.is64:
+            shoff, = struct.unpack_from(end + "Q", self.data, 0x28)
+            shentsize, shnum = struct.unpack_from(end + "HH", self.data, 0x3A)
+        else:
+            shoff, = struct.unpack_from(end + "I", self.data, 0x20)
+            shentsize, shnum = struct.unpack_from(end + "HH", self.data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            off = shoff + i * shentsize
+            if self.is64:
+                _, sh_type, flags, addr, offset, size = struct.unpack_from(end + "IIQQQQ", self.data, off)
+            else:
+                _, sh_type, flags, addr, offset, size = struct.unpack_from(end + "IIIIII", self.data, off)
+            # SHF_ALLOC and not SHT_NOBITS
+            if (flags & 0x2) and sh_type != 8 and addr != 0:
+                self.sections.append((addr, size, offset))
+        self.long_size = 8 if self.is64 else 4
+        self.cache = {}
+
+    def _locate(self, addr):
+        # frames carry 32bit addresses, compare on the low word for rv64 images
+        for base, size, offset in self.sections:
+            base &= 0xffffffff
+            if base <= addr < base + size:
+                return offset + addr - base
+        return None
+
+    def string(self, addr):
+        if addr == 0:
+            return ""
+        if addr in self.cache:
+            return self.cache[addr]
+        pos = self._locate(addr)
+        if pos is None:
+            s = None
+        else:
+            stop = self.data.find(b"\0", pos)
+            s = self.data[pos:stop if stop >= 0 else len(self.data)].decode("utf-8", "replace")
+        self.cache[addr] = s
+        return s
+
+
+class Args:
+    def __init__(self, blob, elf):
+        self.blob = blob
+        self.pos = 0
+        self.elf = elf
+        self.short = False
+
+    def take(self, fmt):
+        size = struct.calcsize(fmt)
+        if self.pos + size > len(self.blob):
+            self.short = True
+            return 0
+        val, = struct.unpack_from(self.elf.end + fmt, self.blob, self.pos)
+        self.pos += size
+        return val
+
+    def integer(self, length, signed):
+        if length in ("ll", "j"):
+            code = "q"
+        elif length in ("l", "z", "t"):
+            code = "q" if self.elf.long_size == 8 else "i"
+        else:
+            code = "i"
+        return self.take(code if signed else code.upper())
+
+    def string(self):
+        stop = self.blob.find(b"\0", self.pos)
+        if stop < 0:
+            self.short = True
+            stop = len(self.blob)
+        s = self.blob[self.pos:stop].decode("utf-8", "replace")
+        self.pos = stop + 1
+        return s
+
+
+def render(fmt, args):
+    """printf with args unpacked the same way bflog_deferred_pack packed them."""
+
+    def conv(m):
+        flags, width, prec, length, spec = m.groups()
+        if spec == "%":
+            return "%"
+        if width == "*":
+            width = str(args.take("i"))
+        if prec == "*":
+            prec = str(args.take("i"))
+        pyfmt = "%" + flags.replace("'", "") + (width or "") + ("." + prec if prec is not None else "")
+        if spec in "di":
+            return (pyfmt + "d") % args.integer(length, True)
+        if spec in "ouxX":
+            return (pyfmt + ("d" if spec == "u" else spec)) % args.integer(length, False)
+        if spec == "c":
+            return (pyfmt + "c") % (args.integer(length, False) & 0xff)
+        if spec in "eEfFgG":
+            return (pyfmt + spec) % args.take("d")
+        if spec in "aA":
+            return args.take("d").hex()
+        if spec == "p":
+            return "0x%x" % args.take("Q" if args.elf.long_size == 8 else "I")
+        if spec == "s":
+            return (pyfmt + "s") % args.string()
+        return ""
+
+    text = SPEC_RE.sub(conv, fmt)
+    if args.short:
+        text += "<truncated>"
+    return text
+
+
+def decode_frame(frame, blob, elf, color):
+    _, size, level, _, line, time, clkl, clkh, fmt_addr, tag_addr, file_addr, func_addr = frame
+    fmt = elf.string(fmt_addr)
+    if fmt is None:
+        return "<unknown format 0x%08x>\r\n" % fmt_addr
+    text = render(fmt, Args(blob, elf))
+    if level & LEVEL_RAW:
+        return text
+    lvl = min(level & LEVEL_MASK, len(LEVEL_NAME) - 1)
+    tag = elf.string(tag_addr) or ""
+    file = elf.string(file_addr) or ""
+    prefix = LEVEL_COLOR[lvl] if color else ""
+    return "%s[%c:%10u][%s:%d]%10s> %s" % (prefix, LEVEL_NAME[lvl][0], clkl, file, line, tag, text)
+
+
+def decode(data, elf, color, out):
+    pos = 0
+    frames = bad = 0
+    while pos < len(data):
+        sync = data.find(FRAME_SYNC, pos)
+        if sync < 0:
+            out.write(data[pos:].decode("utf-8", "replace"))
+            break
+        out.write(data[pos:sync].decode("utf-8", "replace"))
+        if sync + FRAME_SIZE > len(data):
+            break
+        frame = struct.unpack_from(FRAME_FMT, data, sync)
+        end = sync + FRAME_SIZE + frame[1]
+        if end > len(data) or sum(data[sync:end]) & 0xff != 0xff:
+            # not a frame, keep the byte as text and resync
+            bad += 1
+            out.write(data[sync:sync + 1].decode("utf-8", "replace"))
+            pos = sync + 1
+            continue
+        out.write(decode_frame(frame, data[sync + FRAME_SIZE:end], elf, color))
+        frames += 1
+        pos = end
+    return frames, bad
+
+
+def main():
+    parser = argparse.ArgumentParser(description="decode bflog deferred binary log")
+    parser.add_argument("capture", help="raw console or log file capture, - for stdin")
+    parser.add_argument("--elf", required=True, help="firmware elf of the running image")
+    parser.add_argument("--no-color", action="store_true", help="do not emit level colors")
+    args = parser.parse_args()
+
+    elf = Elf(args.elf)
+    if args.capture == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.capture, "rb") as f:
+            data = f.read()
+
+    frames, bad = decode(data, elf, not args.no_color, sys.stdout)
+    sys.stderr.write("%d frames decoded, %d false syncs skipped\n" % (frames, bad))
+
+
+if __name__ == "__main__":
+    main()
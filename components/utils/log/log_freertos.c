@@ -20,6 +20,12 @@ BFLOG_DEFINE_TAG(SVC_LOG, DBG_TAG, true);
 #define LOG_THREAD_STACK_SIZE 1024
 #endif
 
+#ifdef CONFIG_BFLOG_LOCKFREE
+#define LOG_MODE_LOCKFREE BFLOG_MODE_LOCKFREE
+#else
+#define LOG_MODE_LOCKFREE 0
+#endif
+
 /* flush notice ------------------------------------------------------------------*/
 
 static EventGroupHandle_t event_group_server_log_flush_notice;
@@ -120,7 +126,7 @@ void log_restart(void)
 
     /*!< reconfig async mode */
     _ASSERT_FUNC(0 == bflog_control(&__bflog_recorder, BFLOG_CMD_FLUSH_NOTICE, (uint32_t)log_flush_notice));
-    _ASSERT_FUNC(0 == bflog_control(&__bflog_recorder, BFLOG_CMD_MODE, BFLOG_MODE_ASYNC));
+    _ASSERT_FUNC(0 == bflog_control(&__bflog_recorder, BFLOG_CMD_MODE, BFLOG_MODE_ASYNC | LOG_MODE_LOCKFREE | (__bflog_recorder.mode & BFLOG_MODE_DEFERRED)));
 
     /*!< recofig uart0 direct stream, set lock unlock function */
     _ASSERT_FUNC(0 == bflog_direct_suspend((void *)&bflog_direct_stream));
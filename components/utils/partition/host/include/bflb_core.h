@@ -0,0 +1,20 @@
+/* host stand-in of bflb_core.h for pt_test, only what partition and boot2 use */
+#ifndef _BFLB_CORE_H
+#define _BFLB_CORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define arch_memcpy_fast memcpy
+
+uint32_t bflb_soft_crc32(void *in, uint32_t len);
+
+/* library logs are dropped unless pt_test -v */
+int pt_host_printf(const char *fmt, ...);
+#define printf pt_host_printf
+
+#endif
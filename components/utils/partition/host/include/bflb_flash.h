@@ -0,0 +1,13 @@
+/* host stand-in of the lhal flash driver, partition and boot2 run on the simulator */
+#ifndef _BFLB_FLASH_H
+#define _BFLB_FLASH_H
+
+#include "bflb_flash_sim.h"
+
+#define FLASH_XIP_BASE 0xA0000000
+
+#define bflb_flash_erase bflb_flash_sim_erase
+#define bflb_flash_write bflb_flash_sim_write
+#define bflb_flash_read  bflb_flash_sim_read
+
+#endif
@@ -0,0 +1,424 @@
+/**
+ * @file pt_test.c
+ * @brief host test of the partition table cache and the two-phase table update on the flash simulator
+ *
+ * Copyright (c) 2023 Bouffalolab team
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include "bflb_core.h"
+#include "bflb_flash.h"
+#include "partition.h"
+#include "bflb_boot2.h"
+
+#undef printf
+
+#ifndef PT_TABLE_CACHE
+#define PT_TABLE_CACHE 1
+#endif
+
+#define PT_FLASH_SIZE (1024 * 1024)
+
+static int pt_verbose = 0;
+static jmp_buf pt_power_jmp;
+
+int pt_host_printf(const char *fmt, ...)
+{
+    va_list ap;
+    int n = 0;
+
+    if (pt_verbose) {
+        va_start(ap, fmt);
+        n = vprintf(fmt, ap);
+        va_end(ap);
+    }
+    return n;
+}
+
+uint32_t bflb_soft_crc32(void *in, uint32_t len)
+{
+    uint32_t crc = 0xffffffff;
+    uint8_t *data = (uint8_t *)in;
+    int i;
+
+    while (len--) {
+        crc ^= *data++;
+        for (i = 0; i < 8; i++) {
+            crc = (crc & 1) ? ((crc >> 1) ^ 0xEDB88320) : (crc >> 1);
+        }
+    }
+    return crc ^ 0xffffffff;
+}
+
+static uint64_t host_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+static void pt_flash_init(uint32_t seed)
+{
+    bflb_flash_sim_config_t cfg = BFLB_FLASH_SIM_CONFIG_NOR(PT_FLASH_SIZE);
+
+    bflb_flash_sim_deinit();
+    cfg.seed = seed;
+    bflb_flash_sim_init(&cfg);
+    pt_table_set_flash_operation(bflb_flash_erase, bflb_flash_write, bflb_flash_read);
+}
+
+static void pt_add_entry(pt_table_stuff_config *pt, uint8_t type, const char *name, uint32_t addr0, uint32_t addr1, uint32_t len)
+{
+    pt_table_entry_config *entry = &pt->pt_entries[pt->pt_table.entryCnt++];
+
+    entry->type = type;
+    strcpy((char *)entry->name, name);
+    entry->start_address[0] = addr0;
+    entry->start_address[1] = addr1;
+    entry->max_len[0] = len;
+    entry->max_len[1] = len;
+}
+
+/* two valid tables as the flash tool writes them, table 0 active */
+static void pt_format(void)
+{
+    pt_table_stuff_config pt;
+    uint32_t *crc;
+
+    memset(&pt, 0, sizeof(pt));
+    pt.pt_table.magicCode = BFLB_PT_MAGIC_CODE;
+    pt_add_entry(&pt, PT_ENTRY_FW_CPU0, "FW", 0x10000, 0x80000, 0x70000);
+    pt_add_entry(&pt, 2, "mfg", 0x80000, 0, 0x70000);
+    pt_add_entry(&pt, 3, "media", 0xf0000, 0, 0x10000);
+    pt_add_entry(&pt, 4, "PSM", 0x100000 - 0x8000, 0, 0x8000);
+    pt.pt_table.crc32 = bflb_soft_crc32(&pt.pt_table, sizeof(pt_table_config) - 4);
+    crc = (uint32_t *)&pt.pt_entries[pt.pt_table.entryCnt];
+    *crc = bflb_soft_crc32(pt.pt_entries, pt.pt_table.entryCnt * sizeof(pt_table_entry_config));
+
+    bflb_flash_sim_erase(BFLB_PT_TABLE0_ADDRESS, 2 * 4096);
+    bflb_flash_sim_write(BFLB_PT_TABLE0_ADDRESS, (uint8_t *)&pt, sizeof(pt));
+    bflb_flash_sim_write(BFLB_PT_TABLE1_ADDRESS, (uint8_t *)&pt, sizeof(pt));
+    pt_table_cache_invalidate();
+}
+
+/* the choice boot2 makes from the raw flash, written apart from partition.c */
+static int pt_boot_select(pt_table_stuff_config *active)
+{
+    pt_table_stuff_config *pt[2];
+    uint32_t entries_len;
+    int valid[2], i;
+
+    for (i = 0; i < 2; i++) {
+        pt[i] = (pt_table_stuff_config *)(bflb_flash_sim_get_memory() + (i ? BFLB_PT_TABLE1_ADDRESS : BFLB_PT_TABLE0_ADDRESS));
+        entries_len = pt[i]->pt_table.entryCnt * sizeof(pt_table_entry_config);
+        valid[i] = (pt[i]->pt_table.magicCode == BFLB_PT_MAGIC_CODE) &&
+                   (pt[i]->pt_table.entryCnt <= PT_ENTRY_MAX) &&
+                   (pt[i]->pt_table.crc32 == bflb_soft_crc32(&pt[i]->pt_table, sizeof(pt_table_config) - 4)) &&
+                   (*(uint32_t *)((uint8_t *)pt[i]->pt_entries + entries_len) == bflb_soft_crc32(pt[i]->pt_entries, entries_len));
+    }
+
+    if (valid[0] && (!valid[1] || pt[0]->pt_table.age >= pt[1]->pt_table.age)) {
+        i = 0;
+    } else if (valid[1]) {
+        i = 1;
+    } else {
+        return -1;
+    }
+
+    memcpy(active, pt[i], sizeof(pt_table_stuff_config));
+    return i;
+}
+
+/* power on: the cache is gone, partition.c must pick what boot2 picks */
+static int pt_reboot(pt_table_stuff_config *active)
+{
+    pt_table_stuff_config pt_stuff[2];
+    pt_table_id_type id;
+    int boot;
+
+    pt_table_cache_invalidate();
+    id = pt_table_get_active_partition_need_lock(pt_stuff);
+    boot = pt_boot_select(active);
+
+    if ((boot < 0) || ((int)id != boot) || memcmp(&pt_stuff[id], active, sizeof(pt_table_stuff_config))) {
+        printf("reboot: partition.c chose table %d, boot2 table %d\n", id, boot);
+        return -1;
+    }
+    return boot;
+}
+
+/* what bflb_ota does when an image is done: flip the FW slot in the inactive table */
+static int pt_update_fw(void)
+{
+    pt_table_stuff_config pt_stuff[2];
+    pt_table_entry_config entry;
+    pt_table_id_type id;
+
+    id = pt_table_get_active_partition_need_lock(pt_stuff);
+    if ((id == PT_TABLE_ID_INVALID) || pt_table_get_active_entries_by_name(&pt_stuff[id], (uint8_t *)"FW", &entry)) {
+        return -1;
+    }
+    entry.active_index = !(entry.active_index & 0x01);
+    entry.age++;
+    return pt_table_update_entry((pt_table_id_type)!id, &pt_stuff[id], &entry);
+}
+
+static int pt_fw_slot(pt_table_stuff_config *pt)
+{
+    pt_table_entry_config entry;
+
+    if (pt_table_get_active_entries_by_name(pt, (uint8_t *)"FW", &entry)) {
+        return -1;
+    }
+    return entry.active_index;
+}
+
+/* the lookups every bflb_ota and mtd call starts with */
+static int pt_test_lookup(int count)
+{
+    pt_table_stuff_config pt_stuff[2];
+    pt_table_entry_config entry;
+    bflb_flash_sim_stat_t stat;
+    pt_table_id_type id;
+    uint64_t t;
+    int i;
+
+    pt_format();
+    bflb_flash_sim_reset_stat();
+    t = host_time();
+    for (i = 0; i < count; i++) {
+        pt_table_set_flash_operation(bflb_flash_erase, bflb_flash_write, bflb_flash_read);
+        id = pt_table_get_active_partition_need_lock(pt_stuff);
+        if ((id != PT_TABLE_ID_0) || pt_table_get_active_entries_by_name(&pt_stuff[id], (uint8_t *)"media", &entry)) {
+            printf("lookup: wrong table %d\n", id);
+            return -1;
+        }
+    }
+    t = host_time() - t;
+    bflb_flash_sim_get_stat(&stat);
+
+    printf("lookup: %d lookups (cache %s), %u flash reads, %.1f KB read, flash %.2f ms, host %.2f ms\n",
+           count, PT_TABLE_CACHE ? "on" : "off", stat.read_count, stat.read_bytes / 1024.0, stat.time_us / 1000.0,
+           t / 1000.0);
+    return 0;
+}
+
+static int pt_test_generation(void)
+{
+    pt_table_stuff_config pt_stuff[2], active;
+    pt_table_entry_config entry;
+    uint32_t gen;
+
+    pt_format();
+    pt_table_get_active_partition_need_lock(pt_stuff);
+    gen = pt_table_get_generation();
+    pt_table_get_active_partition_need_lock(pt_stuff);
+    if (pt_table_get_generation() != gen) {
+        printf("generation: changed by a lookup\n");
+        return -1;
+    }
+
+    if (pt_update_fw() != PT_ERROR_SUCCESS) {
+        printf("generation: update failed\n");
+        return -1;
+    }
+    if (pt_table_get_generation() == gen) {
+        printf("generation: not changed by an update\n");
+        return -1;
+    }
+
+    /* the cache follows the write without a flash read */
+    bflb_flash_sim_reset_stat();
+    if ((pt_table_get_active_partition_need_lock(pt_stuff) != PT_TABLE_ID_1) || (pt_fw_slot(&pt_stuff[1]) != 1)) {
+        printf("generation: cache missed the update\n");
+        return -1;
+    }
+    if (PT_TABLE_CACHE) {
+        bflb_flash_sim_stat_t stat;
+
+        bflb_flash_sim_get_stat(&stat);
+        if (stat.read_count) {
+            printf("generation: cached lookup read the flash\n");
+            return -1;
+        }
+
+        /* overwriting the fallback table in place is refused */
+        pt_table_get_active_entries_by_name(&pt_stuff[1], (uint8_t *)"FW", &entry);
+        if (pt_table_update_entry(PT_TABLE_ID_1, &pt_stuff[1], &entry) != PT_ERROR_PARAMETER) {
+            printf("generation: update of the active table accepted\n");
+            return -1;
+        }
+    }
+
+    if ((pt_reboot(&active) != 1) || (pt_fw_slot(&active) != 1)) {
+        return -1;
+    }
+    printf("generation: lookups keep it, updates change it, the cache follows the write\n");
+    return 0;
+}
+
+/* bflb_boot2 keeps its own table copy, two updates in a row must go to both tables */
+static int pt_test_boot2(void)
+{
+    pt_table_entry_config entry;
+    pt_table_stuff_config active;
+    int i;
+
+    pt_format();
+    if (bflb_boot2_init()) {
+        return -1;
+    }
+    for (i = 0; i < 2; i++) {
+        if (bflb_boot2_get_active_entries(PT_ENTRY_FW_CPU0, (bflb_partition_config_t *)&entry) ||
+            bflb_boot2_update_ptable((bflb_partition_config_t *)&entry)) {
+            printf("boot2: update %d failed\n", i);
+            return -1;
+        }
+    }
+    if ((pt_reboot(&active) != 0) || (active.pt_table.age != 2) || (pt_fw_slot(&active) != 0)) {
+        printf("boot2: second update did not go to the other table\n");
+        return -1;
+    }
+    printf("boot2: two updates without reboot, age %u in table 0, fallback in table 1\n", active.pt_table.age);
+    return 0;
+}
+
+/* header, entries in use and their CRC, the bytes boot2 looks at */
+static int pt_same(pt_table_stuff_config *a, pt_table_stuff_config *b)
+{
+    uint32_t len = sizeof(pt_table_config) + a->pt_table.entryCnt * sizeof(pt_table_entry_config) + 4;
+
+    return (a->pt_table.entryCnt == b->pt_table.entryCnt) && !memcmp(a, b, len);
+}
+
+static void pt_power_cut(void)
+{
+    longjmp(pt_power_jmp, 1);
+}
+
+/* cut the power at every erase and page program of an update, seeds vary the torn data */
+static int pt_test_powercut(int seeds)
+{
+    pt_table_stuff_config old_pt, new_pt, next_pt, active;
+    bflb_flash_sim_stat_t stat;
+    volatile int step;
+    int seed, ops, kept = 0, done = 0;
+
+    /* a clean update tells the steps and the table it makes */
+    pt_flash_init(1);
+    pt_format();
+    if (pt_reboot(&old_pt) != 0) {
+        return -1;
+    }
+    bflb_flash_sim_reset_stat();
+    if (pt_update_fw() != PT_ERROR_SUCCESS) {
+        return -1;
+    }
+    bflb_flash_sim_get_stat(&stat);
+    ops = stat.erase_count + stat.prog_pages;
+    if (pt_reboot(&new_pt) != 1) {
+        return -1;
+    }
+
+    for (seed = 1; seed <= seeds; seed++) {
+        /* the last step cuts right after the update returned */
+        for (step = 0; step <= ops; step++) {
+            pt_flash_init(seed);
+            pt_format();
+            pt_reboot(&active);
+
+            if (setjmp(pt_power_jmp) == 0) {
+                bflb_flash_sim_set_power_loss(step, pt_power_cut);
+                if ((pt_update_fw() != PT_ERROR_SUCCESS) || (step < ops)) {
+                    printf("powercut: step %d of %d was not reached\n", step, ops);
+                    return -1;
+                }
+            }
+            bflb_flash_sim_power_on();
+
+            /* the old table until the update returns, then the whole new one, never a mix */
+            if (pt_reboot(&active) < 0) {
+                printf("powercut: seed %d step %d no valid table\n", seed, step);
+                return -1;
+            }
+            if (pt_same(&active, &old_pt)) {
+                kept++;
+            } else if (pt_same(&active, &new_pt)) {
+                done++;
+            } else {
+                printf("powercut: seed %d step %d booted a table that was never written\n", seed, step);
+                return -1;
+            }
+            if (pt_same(&active, (step < ops) ? &old_pt : &new_pt) == 0) {
+                printf("powercut: seed %d step %d of %d booted the %s table\n", seed, step, ops, (step < ops) ? "new" : "old");
+                return -1;
+            }
+
+            /* and the next update works from there */
+            if ((pt_update_fw() != PT_ERROR_SUCCESS) || (pt_reboot(&next_pt) < 0) ||
+                (pt_fw_slot(&next_pt) == pt_fw_slot(&active))) {
+                printf("powercut: seed %d step %d update after the cut failed\n", seed, step);
+                return -1;
+            }
+        }
+    }
+
+    printf("powercut: %d steps x %d seeds, %d kept the old table, %d took the new one, 0 bad\n", ops + 1, seeds, kept, done);
+    return 0;
+}
+
+static void usage(void)
+{
+    printf("usage: pt_test [-n lookups] [-s seeds] [-v]\n");
+}
+
+int main(int argc, char **argv)
+{
+    int lookups = 1000, seeds = 50, opt;
+
+    while ((opt = getopt(argc, argv, "n:s:vh")) != -1) {
+        switch (opt) {
+            case 'n':
+                lookups = atoi(optarg);
+                break;
+            case 's':
+                seeds = atoi(optarg);
+                break;
+            case 'v':
+                pt_verbose = 1;
+                break;
+            default:
+                usage();
+                return 1;
+        }
+    }
+
+    pt_flash_init(1);
+    if (pt_test_lookup(lookups) || pt_test_generation() || pt_test_boot2() || pt_test_powercut(seeds)) {
+        printf("pt_test failed\n");
+        return 1;
+    }
+    bflb_flash_sim_deinit();
+    printf("pt_test passed\n");
+    return 0;
+}
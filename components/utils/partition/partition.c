@@ -47,12 +47,28 @@
 /** @defgroup  PARTITION_Private_Macros
  *  @{
  */
+/* keep the validated tables in RAM, lookups then cost no flash read and no CRC */
+#ifndef PT_TABLE_CACHE
+#define PT_TABLE_CACHE 1
+#endif
+
+/* read back buffer of the write verification */
+#define PT_TABLE_VERIFY_CHUNK 64
 
 /*@} end of group PARTITION_Private_Macros */
 
 /** @defgroup  PARTITION_Private_Types
  *  @{
  */
+#if PT_TABLE_CACHE
+typedef struct
+{
+    uint8_t loaded;                  /*!< stuff and valid match the flash */
+    uint8_t valid[2];                /*!< pt_table_valid() of each table */
+    pt_table_id_type active_id;      /*!< table the next boot runs with */
+    pt_table_stuff_config stuff[2];  /*!< both tables as read from flash */
+} pt_table_cache_type;
+#endif
 
 /*@} end of group PARTITION_Private_Types */
 
@@ -63,6 +79,10 @@ p_pt_table_flash_erase gp_pt_table_flash_erase = NULL;
 p_pt_table_flash_write gp_pt_table_flash_write = NULL;
 p_pt_table_flash_read gp_pt_table_flash_read = NULL;
 pt_table_iap_param_type p_iap_param;
+static uint32_t pt_table_generation = 0;
+#if PT_TABLE_CACHE
+static pt_table_cache_type pt_table_cache;
+#endif
 
 /*@} end of group PARTITION_Private_Variables */
 
@@ -124,6 +144,158 @@ static uint8_t pt_table_valid(pt_table_stuff_config *pt_stuff)
     return 0;
 }
 
+/****************************************************************************/ /**
+ * @brief  Select the active table the way boot2 does: valid, then the larger age
+ *
+ * @param  pt_stuff: Both partition tables
+ * @param  pt_valid: Validity of both partition tables
+ *
+ * @return Active partition table ID
+ *
+*******************************************************************************/
+static pt_table_id_type pt_table_select(pt_table_stuff_config pt_stuff[2], uint8_t pt_valid[2])
+{
+    if (pt_valid[0] == 1 && pt_valid[1] == 1) {
+        if (pt_stuff[0].pt_table.age >= pt_stuff[1].pt_table.age) {
+            return PT_TABLE_ID_0;
+        } else {
+            return PT_TABLE_ID_1;
+        }
+    } else if (pt_valid[0] == 1) {
+        return PT_TABLE_ID_0;
+    } else if (pt_valid[1] == 1) {
+        return PT_TABLE_ID_1;
+    }
+
+    return PT_TABLE_ID_INVALID;
+}
+
+/****************************************************************************/ /**
+ * @brief  Read and validate both partition tables from flash
+ *
+ * @param  pt_stuff: Partition table stuff pointer to store both tables
+ * @param  pt_valid: Validity of both tables
+ *
+ * @return 0 for success and -1 for flash read fail
+ *
+*******************************************************************************/
+static int pt_table_load(pt_table_stuff_config pt_stuff[2], uint8_t pt_valid[2])
+{
+    int ret = 0;
+
+    for (int i = 0; i < 2; i++) {
+        if (gp_pt_table_flash_read(i ? BFLB_PT_TABLE1_ADDRESS : BFLB_PT_TABLE0_ADDRESS,
+                                   (uint8_t *)&pt_stuff[i], sizeof(pt_table_stuff_config)) != 0) {
+            ret = -1;
+            pt_valid[i] = 0;
+        } else {
+            pt_valid[i] = pt_table_valid(&pt_stuff[i]);
+        }
+    }
+
+    return ret;
+}
+
+/****************************************************************************/ /**
+ * @brief  Record a table just written to flash
+ *
+ * @param  pt_id: Partition table ID written
+ * @param  pt_stuff: Partition table stuff as written, NULL when the table is unknown now
+ *
+ * @return None
+ *
+*******************************************************************************/
+static void pt_table_written(pt_table_id_type pt_id, pt_table_stuff_config *pt_stuff)
+{
+    pt_table_generation++;
+
+#if PT_TABLE_CACHE
+    if (!pt_table_cache.loaded) {
+        return;
+    }
+
+    if (pt_stuff == NULL) {
+        pt_table_cache.loaded = 0;
+        return;
+    }
+
+    arch_memcpy_fast(&pt_table_cache.stuff[pt_id], pt_stuff, sizeof(pt_table_stuff_config));
+    pt_table_cache.valid[pt_id] = pt_table_valid(pt_stuff);
+    pt_table_cache.active_id = pt_table_select(pt_table_cache.stuff, pt_table_cache.valid);
+#else
+    (void)pt_id;
+    (void)pt_stuff;
+#endif
+}
+
+/****************************************************************************/ /**
+ * @brief  Compare flash with the data just written
+ *
+ * @param  addr: Flash address
+ * @param  data: Data written
+ * @param  len: Data length
+ *
+ * @return 0 for same and -1 for different or read fail
+ *
+*******************************************************************************/
+static int pt_table_flash_verify(uint32_t addr, uint8_t *data, uint32_t len)
+{
+    uint8_t buf[PT_TABLE_VERIFY_CHUNK];
+    uint32_t n;
+
+    while (len > 0) {
+        n = len < sizeof(buf) ? len : sizeof(buf);
+
+        if (gp_pt_table_flash_read(addr, buf, n) != 0 || memcmp(buf, data, n) != 0) {
+            return -1;
+        }
+
+        addr += n;
+        data += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+/****************************************************************************/ /**
+ * @brief  Write a whole table in two phases, so a power loss leaves it either
+ *         invalid (the other table stays active) or complete
+ *
+ * @param  write_addr: Table address
+ * @param  pt_stuff: Partition table stuff with header and CRCs ready
+ *
+ * @return Partition write result
+ *
+*******************************************************************************/
+static pt_table_error_type pt_table_flash_commit(uint32_t write_addr, pt_table_stuff_config *pt_stuff)
+{
+    uint32_t body_len = sizeof(pt_table_stuff_config) - sizeof(pt_table_config);
+
+    if (gp_pt_table_flash_erase(write_addr, sizeof(pt_table_stuff_config)) != 0) {
+        //MSG_ERR("Flash Erase error\r\n");
+        return PT_ERROR_FALSH_ERASE;
+    }
+
+    /* Phase 1: entries and their CRC, the erased magic keeps the table invalid */
+    if (gp_pt_table_flash_write(write_addr + sizeof(pt_table_config), (uint8_t *)pt_stuff->pt_entries, body_len) != 0 ||
+        pt_table_flash_verify(write_addr + sizeof(pt_table_config), (uint8_t *)pt_stuff->pt_entries, body_len) != 0) {
+        //MSG_ERR("Flash Write error\r\n");
+        return PT_ERROR_FALSH_WRITE;
+    }
+
+    /* Phase 2: the header is the commit record, one page program at the sector start */
+    if (gp_pt_table_flash_write(write_addr, (uint8_t *)&pt_stuff->pt_table, sizeof(pt_table_config)) != 0 ||
+        pt_table_flash_verify(write_addr, (uint8_t *)&pt_stuff->pt_table, sizeof(pt_table_config)) != 0) {
+        /* a header that reads back wrong must not win a later boot */
+        gp_pt_table_flash_erase(write_addr, sizeof(pt_table_stuff_config));
+        //MSG_ERR("Flash Write error\r\n");
+        return PT_ERROR_FALSH_WRITE;
+    }
+
+    return PT_ERROR_SUCCESS;
+}
+
 /*@} end of group PARTITION_Private_Functions */
 
 /** @defgroup  PARTITION_Public_Functions
@@ -142,6 +314,11 @@ static uint8_t pt_table_valid(pt_table_stuff_config *pt_stuff)
 *******************************************************************************/
 void pt_table_set_flash_operation(p_pt_table_flash_erase erase, p_pt_table_flash_write write, p_pt_table_flash_read read)
 {
+    /* callers set the same functions before every lookup, only a new flash drops the cache */
+    if (read != gp_pt_table_flash_read) {
+        pt_table_cache_invalidate();
+    }
+
     gp_pt_table_flash_erase = erase;
     gp_pt_table_flash_write = write;
     gp_pt_table_flash_read = read;
@@ -157,34 +334,59 @@ void pt_table_set_flash_operation(p_pt_table_flash_erase erase, p_pt_table_flash
 *******************************************************************************/
 pt_table_id_type pt_table_get_active_partition_need_lock(pt_table_stuff_config ptStuff[2])
 {
-    uint32_t pt_valid[2] = { 0, 0 };
-    pt_table_id_type activePtID;
-
     if (ptStuff == NULL) {
         return PT_TABLE_ID_INVALID;
     }
 
-    activePtID = PT_TABLE_ID_INVALID;
+#if PT_TABLE_CACHE
+    if (!pt_table_cache.loaded) {
+        int ret = pt_table_load(pt_table_cache.stuff, pt_table_cache.valid);
 
-    gp_pt_table_flash_read(BFLB_PT_TABLE0_ADDRESS, (uint8_t *)&ptStuff[0], sizeof(pt_table_stuff_config));
-    pt_valid[0] = pt_table_valid(&ptStuff[0]);
+        pt_table_cache.active_id = pt_table_select(pt_table_cache.stuff, pt_table_cache.valid);
+        /* a failed read or no valid table is not kept, the next call reads again */
+        pt_table_cache.loaded = (ret == 0) && (pt_table_cache.active_id != PT_TABLE_ID_INVALID);
+    }
 
-    gp_pt_table_flash_read(BFLB_PT_TABLE1_ADDRESS, (uint8_t *)&ptStuff[1], sizeof(pt_table_stuff_config));
-    pt_valid[1] = pt_table_valid(&ptStuff[1]);
+    arch_memcpy_fast(ptStuff, pt_table_cache.stuff, sizeof(pt_table_cache.stuff));
+    return pt_table_cache.active_id;
+#else
+    uint8_t pt_valid[2] = { 0, 0 };
 
-    if (pt_valid[0] == 1 && pt_valid[1] == 1) {
-        if (ptStuff[0].pt_table.age >= ptStuff[1].pt_table.age) {
-            activePtID = PT_TABLE_ID_0;
-        } else {
-            activePtID = PT_TABLE_ID_1;
-        }
-    } else if (pt_valid[0] == 1) {
-        activePtID = PT_TABLE_ID_0;
-    } else if (pt_valid[1] == 1) {
-        activePtID = PT_TABLE_ID_1;
-    }
+    pt_table_load(ptStuff, pt_valid);
+    return pt_table_select(ptStuff, pt_valid);
+#endif
+}
 
-    return activePtID;
+/****************************************************************************/ /**
+ * @brief  Drop the cached partition tables, for code that wrote the table
+ *         sectors without this module, the next lookup reads the flash
+ *
+ * @param  None
+ *
+ * @return None
+ *
+*******************************************************************************/
+void pt_table_cache_invalidate(void)
+{
+#if PT_TABLE_CACHE
+    pt_table_cache.loaded = 0;
+#endif
+    pt_table_generation++;
+}
+
+/****************************************************************************/ /**
+ * @brief  Get the partition table generation, it changes whenever a table is
+ *         written or the cache is dropped, so a copy taken with an older
+ *         generation may be stale
+ *
+ * @param  None
+ *
+ * @return Generation counter
+ *
+*******************************************************************************/
+uint32_t pt_table_get_generation(void)
+{
+    return pt_table_generation;
 }
 
 /****************************************************************************/ /**
@@ -282,6 +484,14 @@ pt_table_error_type pt_table_update_entry(pt_table_id_type target_table_id,
         return PT_ERROR_TABLE_NOT_VALID;
     }
 
+#if PT_TABLE_CACHE
+    /* the active table is the fallback while the other one is written, never overwrite it */
+    if (pt_table_cache.loaded && target_table_id == pt_table_cache.active_id) {
+        printf("PT update of the active table %d refused\r\n", target_table_id);
+        return PT_ERROR_PARAMETER;
+    }
+#endif
+
     if (target_table_id == PT_TABLE_ID_0) {
         write_addr = BFLB_PT_TABLE0_ADDRESS;
     } else {
@@ -316,24 +526,10 @@ pt_table_error_type pt_table_update_entry(pt_table_id_type target_table_id,
     *crc32 = bflb_soft_crc32((uint8_t *)&pt_entries[0], entries_len);
 
     /* Write back to flash */
-    /* Erase flash first */
-    //ret = gp_pt_table_flash_erase(write_addr, write_addr + sizeof(pt_table_config) + entries_len + 4 - 1);
-    ret = gp_pt_table_flash_erase(write_addr, sizeof(pt_table_config) + entries_len + 4);
+    ret = pt_table_flash_commit(write_addr, pt_stuff);
+    pt_table_written(target_table_id, ret == PT_ERROR_SUCCESS ? pt_stuff : NULL);
 
-    if (ret != 0) {
-        //MSG_ERR("Flash Erase error\r\n");
-        return PT_ERROR_FALSH_WRITE;
-    }
-
-    /* Write flash */
-    ret = gp_pt_table_flash_write(write_addr, (uint8_t *)pt_stuff, sizeof(pt_table_stuff_config));
-
-    if (ret != 0) {
-        //MSG_ERR("Flash Write error\r\n");
-        return PT_ERROR_FALSH_WRITE;
-    }
-
-    return PT_ERROR_SUCCESS;
+    return (pt_table_error_type)ret;
 }
 
 /****************************************************************************/ /**
@@ -369,6 +565,7 @@ pt_table_error_type pt_table_create(pt_table_id_type pt_id)
     /* Write back to flash */
     //ret = gp_pt_table_flash_erase(write_addr, write_addr + sizeof(pt_table_config) - 1);
     ret = gp_pt_table_flash_erase(write_addr,sizeof(pt_table_config));
+    pt_table_written(pt_id, NULL);
 
     if (ret != 0) {
         //MSG_ERR("Flash Erase error\r\n");
@@ -435,44 +632,21 @@ pt_table_error_type pt_table_dump(void)
 
 pt_table_error_type pt_table_get_iap_para(pt_table_iap_param_type *para)
 {
-    uint32_t pt_valid[2] = { 0, 0 };
     pt_table_stuff_config pt_stuff[2];
+    pt_table_id_type active_id;
     uint8_t active_index;
 
-    gp_pt_table_flash_read(BFLB_PT_TABLE0_ADDRESS, (uint8_t *)&pt_stuff[0], sizeof(pt_table_stuff_config));
-    pt_valid[0] = pt_table_valid(&pt_stuff[0]);
-
-    gp_pt_table_flash_read(BFLB_PT_TABLE1_ADDRESS, (uint8_t *)&pt_stuff[1], sizeof(pt_table_stuff_config));
-    pt_valid[1] = pt_table_valid(&pt_stuff[1]);
-
-    if ((pt_valid[0] == 1) && (pt_valid[1] == 1)) {
-        if (pt_stuff[0].pt_table.age >= pt_stuff[1].pt_table.age) {
-            active_index = pt_stuff[0].pt_entries[0].active_index;
-            para->iap_write_addr = para->iap_start_addr = pt_stuff[0].pt_entries[0].start_address[!(active_index & 0x01)];
-            para->inactive_index = !(active_index & 0x01);
-            para->inactive_table_index = 1;
+    active_id = pt_table_get_active_partition_need_lock(pt_stuff);
 
-        } else {
-            active_index = pt_stuff[1].pt_entries[0].active_index;
-            para->iap_write_addr = para->iap_start_addr = pt_stuff[1].pt_entries[0].start_address[!(active_index & 0x01)];
-            para->inactive_index = !(active_index & 0x01);
-            para->inactive_table_index = 0;
-        }
-
-    } else if (pt_valid[1] == 1) {
-        active_index = pt_stuff[1].pt_entries[0].active_index;
-        para->iap_write_addr = para->iap_start_addr = pt_stuff[1].pt_entries[0].start_address[!(active_index & 0x01)];
-        para->inactive_index = !(active_index & 0x01);
-        para->inactive_table_index = 0;
-    } else if (pt_valid[0] == 1) {
-        active_index = pt_stuff[0].pt_entries[0].active_index;
-        para->iap_write_addr = para->iap_start_addr = pt_stuff[0].pt_entries[0].start_address[!(active_index & 0x01)];
-        para->inactive_index = !(active_index & 0x01);
-        para->inactive_table_index = 1;
-    } else {
+    if (active_id == PT_TABLE_ID_INVALID) {
         return PT_ERROR_TABLE_NOT_VALID;
     }
 
+    active_index = pt_stuff[active_id].pt_entries[0].active_index;
+    para->iap_write_addr = para->iap_start_addr = pt_stuff[active_id].pt_entries[0].start_address[!(active_index & 0x01)];
+    para->inactive_index = !(active_index & 0x01);
+    para->inactive_table_index = !active_id;
+
     printf("inactive_table_index %d, inactive index %d , IAP start addr %08x \r\n", para->inactive_table_index, para->inactive_index, para->iap_start_addr);
     return PT_ERROR_SUCCESS;
 }
@@ -500,35 +674,17 @@ pt_table_error_type pt_table_set_iap_para(pt_table_iap_param_type *para)
     *p_crc32 = bflb_soft_crc32((uint8_t *)pt_stuff_write.pt_entries, entries_len);
 
     if (para->inactive_table_index == 1) {
-        //ret = gp_pt_table_flash_erase(BFLB_PT_TABLE1_ADDRESS, BFLB_PT_TABLE1_ADDRESS + sizeof(pt_table_stuff_config) - 1);
-        ret = gp_pt_table_flash_erase(BFLB_PT_TABLE1_ADDRESS, sizeof(pt_table_stuff_config));
-
-        if (ret != 0) {
-            //MSG_ERR("Flash Erase error\r\n");
-            return PT_ERROR_FALSH_ERASE;
-        }
-
-        ret = gp_pt_table_flash_write(BFLB_PT_TABLE1_ADDRESS, (uint8_t *)&pt_stuff_write, sizeof(pt_table_stuff_config));
-
-        if (ret != 0) {
-            //MSG_ERR("Flash Write error\r\n");
-            return PT_ERROR_FALSH_WRITE;
-        }
+        ret = pt_table_flash_commit(BFLB_PT_TABLE1_ADDRESS, &pt_stuff_write);
     } else if (para->inactive_table_index == 0) {
-        //ret = gp_pt_table_flash_erase(BFLB_PT_TABLE0_ADDRESS, BFLB_PT_TABLE0_ADDRESS + sizeof(pt_table_stuff_config) - 1);
-        ret = gp_pt_table_flash_erase(BFLB_PT_TABLE0_ADDRESS, sizeof(pt_table_stuff_config));
-
-        if (ret != 0) {
-            //MSG_ERR("Flash Erase error\r\n");
-            return PT_ERROR_FALSH_ERASE;
-        }
+        ret = pt_table_flash_commit(BFLB_PT_TABLE0_ADDRESS, &pt_stuff_write);
+    } else {
+        return PT_ERROR_PARAMETER;
+    }
 
-        ret = gp_pt_table_flash_write(BFLB_PT_TABLE0_ADDRESS, (uint8_t *)&pt_stuff_write, sizeof(pt_table_stuff_config));
+    pt_table_written((pt_table_id_type)para->inactive_table_index, ret == PT_ERROR_SUCCESS ? &pt_stuff_write : NULL);
 
-        if (ret != 0) {
-            //MSG_ERR("Flash Write error\r\n");
-            return PT_ERROR_FALSH_WRITE;
-        }
+    if (ret != PT_ERROR_SUCCESS) {
+        return (pt_table_error_type)ret;
     }
 
     printf("Update pt_table suss\r\n");
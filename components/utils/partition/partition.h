@@ -197,6 +197,8 @@ pt_table_error_type pt_table_create(pt_table_id_type pt_id);
 pt_table_error_type pt_table_dump(void);
 pt_table_error_type pt_table_get_iap_para(pt_table_iap_param_type *para);
 pt_table_error_type pt_table_set_iap_para(pt_table_iap_param_type *para);
+void pt_table_cache_invalidate(void);
+uint32_t pt_table_get_generation(void);
 
 /*@} end of group PARTITION_Public_Functions */
 
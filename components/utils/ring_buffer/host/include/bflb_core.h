@@ -0,0 +1,12 @@
+/* host stand-in of bflb_core.h for rb_stress, only what the ring buffers use */
+#ifndef _BFLB_CORE_H
+#define _BFLB_CORE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define arch_memcpy_fast memcpy
+
+#endif
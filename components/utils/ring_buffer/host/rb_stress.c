@@ -0,0 +1,334 @@
+/**
+ * @file rb_stress.c
+ * @brief host stress test and throughput bench of the ring buffers on pthreads
+ *
+ * Copyright (c) 2023 Bouffalolab team
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include "ring_buffer.h"
+#include "ring_buffer_lockfree.h"
+
+#define BENCH_BUF_SIZE     1024
+#define BENCH_CHUNK        61
+#define BENCH_ELEM_NUM     64
+#define BENCH_MAX_PRODUCER 16
+
+struct bench_elem {
+    uint32_t producer;
+    uint32_t seq;
+};
+
+static uint32_t stream_bytes = 64 * 1024 * 1024;
+static uint32_t elem_per_producer = 1000000;
+static int max_producers = 8;
+
+static uint8_t stream_buf[BENCH_BUF_SIZE];
+static uint8_t elem_buf[RING_BUFFER_MPSC_BUFFER_SIZE(sizeof(struct bench_elem), BENCH_ELEM_NUM)] __attribute__((aligned(4)));
+
+static Ring_Buffer_Type locked_rb;
+static Ring_Buffer_Spsc_Type spsc_rb;
+static Ring_Buffer_Mpsc_Type mpsc_rb;
+static pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int stream_mode; /* 0 locked, 1 spsc, 2 spsc reserve/commit and read span */
+static int mpsc_mode;   /* 0 mpsc, 1 locked ring under one mutex */
+static int mpsc_producers;
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_lock(void)
+{
+    pthread_mutex_lock(&bench_mutex);
+}
+
+static void bench_unlock(void)
+{
+    pthread_mutex_unlock(&bench_mutex);
+}
+
+static uint32_t stream_write(const uint8_t *data, uint32_t len)
+{
+    if (stream_mode == 0) {
+        return Ring_Buffer_Write(&locked_rb, data, len);
+    } else {
+        return Ring_Buffer_Spsc_Write(&spsc_rb, data, len);
+    }
+}
+
+static uint32_t stream_read(uint8_t *data, uint32_t len)
+{
+    if (stream_mode == 0) {
+        return Ring_Buffer_Read(&locked_rb, data, len);
+    } else {
+        return Ring_Buffer_Spsc_Read(&spsc_rb, data, len);
+    }
+}
+
+static void *stream_producer(void *arg)
+{
+    uint8_t chunk[BENCH_CHUNK];
+    uint32_t sent = 0, len, done, n;
+    uint8_t *span;
+
+    (void)arg;
+    while (sent < stream_bytes) {
+        if (stream_mode == 2) {
+            n = Ring_Buffer_Spsc_Reserve_Write(&spsc_rb, &span, stream_bytes - sent);
+            if (n == 0) {
+                sched_yield();
+                continue;
+            }
+            for (uint32_t i = 0; i < n; i++) {
+                span[i] = (uint8_t)(sent + i);
+            }
+            Ring_Buffer_Spsc_Commit_Write(&spsc_rb, n);
+            sent += n;
+            continue;
+        }
+
+        len = stream_bytes - sent;
+        if (len > sizeof(chunk)) {
+            len = sizeof(chunk);
+        }
+        for (uint32_t i = 0; i < len; i++) {
+            chunk[i] = (uint8_t)(sent + i);
+        }
+        for (done = 0; done < len; done += n) {
+            n = stream_write(&chunk[done], len - done);
+            if (n == 0) {
+                sched_yield();
+            }
+        }
+        sent += len;
+    }
+    return NULL;
+}
+
+/* every byte is its stream position, a lost, doubled or torn byte shows */
+static void *stream_consumer(void *arg)
+{
+    uint8_t chunk[BENCH_CHUNK + 6];
+    uint32_t recv = 0, n;
+    uintptr_t errors = 0;
+    uint8_t *data;
+
+    (void)arg;
+    while (recv < stream_bytes) {
+        if (stream_mode == 2) {
+            n = Ring_Buffer_Spsc_Peek_Read_Span(&spsc_rb, &data);
+        } else {
+            n = stream_read(chunk, sizeof(chunk));
+            data = chunk;
+        }
+        if (n == 0) {
+            sched_yield();
+            continue;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            if (data[i] != (uint8_t)(recv + i)) {
+                errors++;
+            }
+        }
+        if (stream_mode == 2) {
+            Ring_Buffer_Spsc_Consume(&spsc_rb, n);
+        }
+        recv += n;
+    }
+    return (void *)errors;
+}
+
+static uint32_t mpsc_push(const struct bench_elem *elem)
+{
+    uint32_t n = 0;
+
+    if (mpsc_mode == 0) {
+        return Ring_Buffer_Mpsc_Push(&mpsc_rb, elem);
+    }
+    /* whole elements only, the length check and the write under one lock */
+    bench_lock();
+    if (Ring_Buffer_Get_Empty_Length(&locked_rb) >= sizeof(*elem)) {
+        n = Ring_Buffer_Write(&locked_rb, (const uint8_t *)elem, sizeof(*elem));
+    }
+    bench_unlock();
+    return n;
+}
+
+static uint32_t mpsc_pop(struct bench_elem *elem)
+{
+    uint32_t n = 0;
+
+    if (mpsc_mode == 0) {
+        return Ring_Buffer_Mpsc_Pop(&mpsc_rb, elem);
+    }
+    bench_lock();
+    if (Ring_Buffer_Get_Length(&locked_rb) >= sizeof(*elem)) {
+        n = Ring_Buffer_Read(&locked_rb, (uint8_t *)elem, sizeof(*elem));
+    }
+    bench_unlock();
+    return n;
+}
+
+static void *mpsc_producer(void *arg)
+{
+    struct bench_elem elem = { .producer = (uint32_t)(uintptr_t)arg };
+
+    for (elem.seq = 0; elem.seq < elem_per_producer; elem.seq++) {
+        while (!mpsc_push(&elem)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+/* every producer's elements must come out once each and in the order it pushed them */
+static void *mpsc_consumer(void *arg)
+{
+    uint32_t next[BENCH_MAX_PRODUCER] = { 0 };
+    uint32_t total = mpsc_producers * elem_per_producer;
+    struct bench_elem elem;
+    uintptr_t errors = 0;
+
+    (void)arg;
+    for (uint32_t got = 0; got < total;) {
+        if (!mpsc_pop(&elem)) {
+            sched_yield();
+            continue;
+        }
+        if ((elem.producer >= (uint32_t)mpsc_producers) || (elem.seq != next[elem.producer])) {
+            errors++;
+        } else {
+            next[elem.producer]++;
+        }
+        got++;
+    }
+    for (int i = 0; i < mpsc_producers; i++) {
+        if (next[i] != elem_per_producer) {
+            errors++;
+        }
+    }
+    return (void *)errors;
+}
+
+static int bench_stream(int mode, const char *name)
+{
+    pthread_t prod, cons;
+    void *errors;
+    double t;
+
+    stream_mode = mode;
+    Ring_Buffer_Reset(&locked_rb);
+    Ring_Buffer_Spsc_Reset(&spsc_rb);
+
+    t = now_s();
+    pthread_create(&cons, NULL, stream_consumer, NULL);
+    pthread_create(&prod, NULL, stream_producer, NULL);
+    pthread_join(prod, NULL);
+    pthread_join(cons, &errors);
+    t = now_s() - t;
+
+    printf("%-8s  1 -> 1 %10u B  %8.1f MB/s  %lu bad\n", name, stream_bytes, stream_bytes / t / 1e6,
+           (unsigned long)(uintptr_t)errors);
+    return errors ? -1 : 0;
+}
+
+static int bench_mpsc(int mode, const char *name, int producers)
+{
+    pthread_t prod[BENCH_MAX_PRODUCER], cons;
+    void *errors;
+    double t;
+
+    mpsc_mode = mode;
+    mpsc_producers = producers;
+    Ring_Buffer_Mpsc_Init(&mpsc_rb, elem_buf, sizeof(struct bench_elem), BENCH_ELEM_NUM);
+    /* the same number of elements as the mpsc ring */
+    Ring_Buffer_Init(&locked_rb, stream_buf, BENCH_ELEM_NUM * sizeof(struct bench_elem), NULL, NULL);
+
+    t = now_s();
+    pthread_create(&cons, NULL, mpsc_consumer, NULL);
+    for (int i = 0; i < producers; i++) {
+        pthread_create(&prod[i], NULL, mpsc_producer, (void *)(uintptr_t)i);
+    }
+    for (int i = 0; i < producers; i++) {
+        pthread_join(prod[i], NULL);
+    }
+    pthread_join(cons, &errors);
+    t = now_s() - t;
+
+    printf("%-8s %2d -> 1 %10u el %8.2f Mel/s  %lu bad\n", name, producers, producers * elem_per_producer,
+           producers * elem_per_producer / t / 1e6, (unsigned long)(uintptr_t)errors);
+    return errors ? -1 : 0;
+}
+
+static void usage(void)
+{
+    printf("usage: rb_stress [-b stream bytes] [-e elements per producer] [-p max producers]\n");
+}
+
+int main(int argc, char **argv)
+{
+    int opt, bad = 0;
+
+    while ((opt = getopt(argc, argv, "b:e:p:h")) != -1) {
+        switch (opt) {
+            case 'b':
+                stream_bytes = strtoul(optarg, NULL, 0);
+                break;
+            case 'e':
+                elem_per_producer = strtoul(optarg, NULL, 0);
+                break;
+            case 'p':
+                max_producers = atoi(optarg);
+                break;
+            default:
+                usage();
+                return 1;
+        }
+    }
+    if ((max_producers < 1) || (max_producers > BENCH_MAX_PRODUCER)) {
+        usage();
+        return 1;
+    }
+
+    Ring_Buffer_Init(&locked_rb, stream_buf, sizeof(stream_buf), bench_lock, bench_unlock);
+    Ring_Buffer_Spsc_Init(&spsc_rb, stream_buf, sizeof(stream_buf));
+
+    printf("%ld cpus, %d byte stream buffer, %d element rings\n", sysconf(_SC_NPROCESSORS_ONLN), BENCH_BUF_SIZE,
+           BENCH_ELEM_NUM);
+    bad |= bench_stream(0, "locked");
+    bad |= bench_stream(1, "spsc");
+    bad |= bench_stream(2, "span");
+
+    for (int p = 1; p <= max_producers; p *= 2) {
+        bad |= bench_mpsc(1, "locked", p);
+        bad |= bench_mpsc(0, "mpsc", p);
+    }
+
+    printf(bad ? "FAIL\n" : "all ok\n");
+    return bad ? 1 : 0;
+}
@@ -668,6 +668,144 @@ Ring_Buffer_Status_Type Ring_Buffer_Get_Status(Ring_Buffer_Type *rbType)
     return RING_BUFFER_PARTIAL;
 }
 
+/****************************************************************************/ /**
+ * @brief  Get contiguous free space at write index, data can be filled in place (e.g. by dma)
+ *         and then published with Ring_Buffer_Commit_Write
+ *
+ * @param  rbType: Ring buffer type structure pointer
+ * @param  span: Returns start of the free span
+ * @param  length: Length wanted, 0 for as much as possible
+ *
+ * @return Length of the contiguous span, may be less than length when the free space wraps
+ *
+*******************************************************************************/
+uint32_t Ring_Buffer_Reserve_Write(Ring_Buffer_Type *rbType, uint8_t **span, uint32_t length)
+{
+    uint32_t sizeRemained = Ring_Buffer_Get_Empty_Length(rbType);
+
+    if (rbType->lock != NULL) {
+        rbType->lock();
+    }
+
+    /* Free space never crosses the end of buffer in one span */
+    if (sizeRemained > rbType->size - rbType->writeIndex) {
+        sizeRemained = rbType->size - rbType->writeIndex;
+    }
+
+    if (length == 0 || length > sizeRemained) {
+        length = sizeRemained;
+    }
+
+    *span = &rbType->pointer[rbType->writeIndex];
+
+    if (rbType->unlock != NULL) {
+        rbType->unlock();
+    }
+
+    return length;
+}
+
+/****************************************************************************/ /**
+ * @brief  Publish data filled in place after Ring_Buffer_Reserve_Write
+ *
+ * @param  rbType: Ring buffer type structure pointer
+ * @param  length: Length of data filled
+ *
+ * @return Length of data committed actually
+ *
+*******************************************************************************/
+uint32_t Ring_Buffer_Commit_Write(Ring_Buffer_Type *rbType, uint32_t length)
+{
+    uint32_t sizeRemained = Ring_Buffer_Get_Empty_Length(rbType);
+
+    if (rbType->lock != NULL) {
+        rbType->lock();
+    }
+
+    if (length > sizeRemained) {
+        length = sizeRemained;
+    }
+
+    rbType->writeIndex += length;
+
+    if (rbType->writeIndex >= rbType->size) {
+        rbType->writeIndex -= rbType->size;
+        rbType->writeMirror = ~rbType->writeMirror;
+    }
+
+    if (rbType->unlock != NULL) {
+        rbType->unlock();
+    }
+
+    return length;
+}
+
+/****************************************************************************/ /**
+ * @brief  Get contiguous data at read index without copying, release it with
+ *         Ring_Buffer_Consume once processed (e.g. after dma or pbuf send)
+ *
+ * @param  rbType: Ring buffer type structure pointer
+ * @param  span: Returns start of the data span
+ *
+ * @return Length of the contiguous span, the rest follows from the buffer start
+ *
+*******************************************************************************/
+uint32_t Ring_Buffer_Peek_Read_Span(Ring_Buffer_Type *rbType, uint8_t **span)
+{
+    uint32_t size = Ring_Buffer_Get_Length(rbType);
+
+    if (rbType->lock != NULL) {
+        rbType->lock();
+    }
+
+    if (size > rbType->size - rbType->readIndex) {
+        size = rbType->size - rbType->readIndex;
+    }
+
+    *span = &rbType->pointer[rbType->readIndex];
+
+    if (rbType->unlock != NULL) {
+        rbType->unlock();
+    }
+
+    return size;
+}
+
+/****************************************************************************/ /**
+ * @brief  Drop data from ring buffer, usually after Ring_Buffer_Peek_Read_Span
+ *
+ * @param  rbType: Ring buffer type structure pointer
+ * @param  length: Length of data to drop
+ *
+ * @return Length of data dropped actually
+ *
+*******************************************************************************/
+uint32_t Ring_Buffer_Consume(Ring_Buffer_Type *rbType, uint32_t length)
+{
+    uint32_t size = Ring_Buffer_Get_Length(rbType);
+
+    if (rbType->lock != NULL) {
+        rbType->lock();
+    }
+
+    if (length > size) {
+        length = size;
+    }
+
+    rbType->readIndex += length;
+
+    if (rbType->readIndex >= rbType->size) {
+        rbType->readIndex -= rbType->size;
+        rbType->readMirror = ~rbType->readMirror;
+    }
+
+    if (rbType->unlock != NULL) {
+        rbType->unlock();
+    }
+
+    return length;
+}
+
 /*@} end of group RING_BUFFER_Public_Functions */
 
 /*@} end of group RING_BUFFER */
@@ -106,6 +106,10 @@ uint32_t Ring_Buffer_Peek_Byte(Ring_Buffer_Type *rbType, uint8_t *data);
 uint32_t Ring_Buffer_Get_Length(Ring_Buffer_Type *rbType);
 uint32_t Ring_Buffer_Get_Empty_Length(Ring_Buffer_Type *rbType);
 Ring_Buffer_Status_Type Ring_Buffer_Get_Status(Ring_Buffer_Type *rbType);
+uint32_t Ring_Buffer_Reserve_Write(Ring_Buffer_Type *rbType, uint8_t **span, uint32_t length);
+uint32_t Ring_Buffer_Commit_Write(Ring_Buffer_Type *rbType, uint32_t length);
+uint32_t Ring_Buffer_Peek_Read_Span(Ring_Buffer_Type *rbType, uint8_t **span);
+uint32_t Ring_Buffer_Consume(Ring_Buffer_Type *rbType, uint32_t length);
 
 /*@} end of group RING_BUFFER_Public_Functions */
 
@@ -0,0 +1,438 @@
+/**
+ * @file ring_buffer_lockfree.c
+ * @brief
+ *
+ * Copyright (c) 2023 Bouffalolab team
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+#include "ring_buffer_lockfree.h"
+
+/** @addtogroup  BL_Common_Component
+ *  @{
+ */
+
+/** @addtogroup  RING_BUFFER
+ *  @{
+ */
+
+/** @defgroup  RING_BUFFER_LOCKFREE_Private_Macros
+ *  @{
+ */
+#define RB_LOAD_ACQUIRE(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define RB_LOAD_RELAXED(p)     __atomic_load_n((p), __ATOMIC_RELAXED)
+#define RB_STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+#define RB_IS_POWER_OF_TWO(x)  (((x) != 0) && (((x) & ((x)-1)) == 0))
+
+/*@} end of group RING_BUFFER_LOCKFREE_Private_Macros */
+
+/** @defgroup  RING_BUFFER_LOCKFREE_Private_Functions
+ *  @{
+ */
+
+/****************************************************************************/ /**
+ * @brief  Get sequence word of a mpsc slot
+ *
+ * @param  rbType: Mpsc ring buffer type structure pointer
+ * @param  index: Free running index
+ *
+ * @return Pointer of sequence word, element data follows it
+ *
+*******************************************************************************/
+static inline uint32_t *Ring_Buffer_Mpsc_Slot(Ring_Buffer_Mpsc_Type *rbType, uint32_t index)
+{
+    return (uint32_t *)&rbType->pointer[(index & rbType->mask) * rbType->slotSize];
+}
+
+/*@} end of group RING_BUFFER_LOCKFREE_Private_Functions */
+
+/** @defgroup  RING_BUFFER_LOCKFREE_Public_Functions
+ *  @{
+ */
+
+/****************************************************************************/ /**
+ * @brief  Spsc ring buffer init function
+ *
+ * @param  rbType: Spsc ring buffer type structure pointer
+ * @param  buffer: Pointer of ring buffer
+ * @param  size: Size of ring buffer, must be power of two
+ *
+ * @return 0 on success, -1 on bad size
+ *
+*******************************************************************************/
+int Ring_Buffer_Spsc_Init(Ring_Buffer_Spsc_Type *rbType, uint8_t *buffer, uint32_t size)
+{
+    if (!RB_IS_POWER_OF_TWO(size)) {
+        return -1;
+    }
+
+    rbType->pointer = buffer;
+    rbType->mask = size - 1;
+    rbType->writeIndex = 0;
+    rbType->readIndex = 0;
+
+    return 0;
+}
+
+/****************************************************************************/ /**
+ * @brief  Spsc ring buffer reset function, must not race with read or write
+ *
+ * @param  rbType: Spsc ring buffer type structure pointer
+ *
+ * @return None
+ *
+*******************************************************************************/
+void Ring_Buffer_Spsc_Reset(Ring_Buffer_Spsc_Type *rbType)
+{
+    RB_STORE_RELEASE(&rbType->readIndex, 0);
+    RB_STORE_RELEASE(&rbType->writeIndex, 0);
+}
+
+/****************************************************************************/ /**
+ * @brief  Spsc ring buffer write function, producer side only
+ *
+ * @param  rbType: Spsc ring buffer type structure pointer
+ * @param  data: Data to write
+ * @param  length: Length of data
+ *
+ * @return Length of data writted actually
+ *
+*******************************************************************************/
+uint32_t Ring_Buffer_Spsc_Write(Ring_Buffer_Spsc_Type *rbType, const uint8_t *data, uint32_t length)
+{
+    uint32_t writeIndex = RB_LOAD_RELAXED(&rbType->writeIndex);
+    uint32_t readIndex = RB_LOAD_ACQUIRE(&rbType->readIndex);
+    uint32_t sizeRemained = rbType->mask + 1 - (writeIndex - readIndex);
+    uint32_t offset = writeIndex & rbType->mask;
+    uint32_t first;
+
+    if (length > sizeRemained) {
+        length = sizeRemained;
+    }
+
+    if (length == 0) {
+        return 0;
+    }
+
+    first = rbType->mask + 1 - offset;
+    if (first >= length) {
+        arch_memcpy_fast(&rbType->pointer[offset], data, length);
+    } else {
+        arch_memcpy_fast(&rbType->pointer[offset], data, first);
+        arch_memcpy_fast(&rbType->pointer[0], &data[first], length - first);
+    }
+
+    /* Publish data before index */
+    RB_STORE_RELEASE(&rbType->writeIndex, writeIndex + length);
+
+    return length;
+}
+
+/****************************************************************************/ /**
+ * @brief  Spsc ring buffer peek function, consumer side only
+ *
+ * @param  rbType: Spsc ring buffer type structure pointer
+ * @param  data: Buffer for data read
+ * @param  length: Length of data to read
+ *
+ * @return Length of data read actually
+ *
+*******************************************************************************/
+uint32_t Ring_Buffer_Spsc_Peek(Ring_Buffer_Spsc_Type *rbType, uint8_t *data, uint32_t length)
+{
+    uint32_t readIndex = RB_LOAD_RELAXED(&rbType->readIndex);
+    uint32_t writeIndex = RB_LOAD_ACQUIRE(&rbType->writeIndex);
+    uint32_t size = writeIndex - readIndex;
+    uint32_t offset = readIndex & rbType->mask;
+    uint32_t first;
+
+    if (length > size) {
+        length = size;
+    }
+
+    if (length == 0) {
+        return 0;
+    }
+
+    first = rbType->mask + 1 - offset;
+    if (first >= length) {
+        arch_memcpy_fast(data, &rbType->pointer[offset], length);
+    } else {
+        arch_memcpy_fast(data, &rbType->pointer[offset], first);
+        arch_memcpy_fast(&data[first], &rbType->pointer[0], length - first);
+    }
+
+    return length;
+}
+
+/****************************************************************************/ /**
+ * @brief  Spsc ring buffer read function, consumer side only
+ *
+ * @param  rbType: Spsc ring buffer type structure pointer
+ * @param  data: Buffer for data read
+ * @param  length: Length of data to read
+ *
+ * @return Length of data read actually
+ *
+*******************************************************************************/
+uint32_t Ring_Buffer_Spsc_Read(Ring_Buffer_Spsc_Type *rbType, uint8_t *data, uint32_t length)
+{
+    length = Ring_Buffer_Spsc_Peek(rbType, data, length);
+
+    if (length) {
+        /* Release the space only after data has been copied out */
+        RB_STORE_RELEASE(&rbType->readIndex, RB_LOAD_RELAXED(&rbType->readIndex) + length);
+    }
+
+    return length;
+}
+
+/****************************************************************************/ /**
+ * @brief  Get length of data in spsc ring buffer function
+ *
+ * @param  rbType: Spsc ring buffer type structure pointer
+ *
+ * @return Length of data
+ *
+*******************************************************************************/
+uint32_t Ring_Buffer_Spsc_Get_Length(Ring_Buffer_Spsc_Type *rbType)
+{
+    return RB_LOAD_ACQUIRE(&rbType->writeIndex) - RB_LOAD_ACQUIRE(&rbType->readIndex);
+}
+
+/****************************************************************************/ /**
+ * @brief  Get space remained in spsc ring buffer function
+ *
+ * @param  rbType: Spsc ring buffer type structure pointer
+ *
+ * @return Length of space remained
+ *
+*******************************************************************************/
+uint32_t Ring_Buffer_Spsc_Get_Empty_Length(Ring_Buffer_Spsc_Type *rbType)
+{
+    return rbType->mask + 1 - Ring_Buffer_Spsc_Get_Length(rbType);
+}
+
+/****************************************************************************/ /**
+ * @brief  Get contiguous free space at write index, producer side only
+ *
+ * @param  rbType: Spsc ring buffer type structure pointer
+ * @param  span: Returns start of the free span
+ * @param  length: Length wanted, 0 for as much as possible
+ *
+ * @return Length of the contiguous span, may be less than length when the free space wraps
+ *
+*******************************************************************************/
+uint32_t Ring_Buffer_Spsc_Reserve_Write(Ring_Buffer_Spsc_Type *rbType, uint8_t **span, uint32_t length)
+{
+    uint32_t writeIndex = RB_LOAD_RELAXED(&rbType->writeIndex);
+    uint32_t readIndex = RB_LOAD_ACQUIRE(&rbType->readIndex);
+    uint32_t sizeRemained = rbType->mask + 1 - (writeIndex - readIndex);
+    uint32_t offset = writeIndex & rbType->mask;
+
+    if (sizeRemained > rbType->mask + 1 - offset) {
+        sizeRemained = rbType->mask + 1 - offset;
+    }
+
+    if (length == 0 || length > sizeRemained) {
+        length = sizeRemained;
+    }
+
+    *span = &rbType->pointer[offset];
+
+    return length;
+}
+
+/****************************************************************************/ /**
+ * @brief  Publish data filled in place after Ring_Buffer_Spsc_Reserve_Write, producer side only
+ *
+ * @param  rbType: Spsc ring buffer type structure pointer
+ * @param  length: Length of data filled
+ *
+ * @return Length of data committed actually
+ *
+*******************************************************************************/
+uint32_t Ring_Buffer_Spsc_Commit_Write(Ring_Buffer_Spsc_Type *rbType, uint32_t length)
+{
+    uint32_t writeIndex = RB_LOAD_RELAXED(&rbType->writeIndex);
+    uint32_t readIndex = RB_LOAD_ACQUIRE(&rbType->readIndex);
+    uint32_t sizeRemained = rbType->mask + 1 - (writeIndex - readIndex);
+
+    if (length > sizeRemained) {
+        length = sizeRemained;
+    }
+
+    RB_STORE_RELEASE(&rbType->writeIndex, writeIndex + length);
+
+    return length;
+}
+
+/****************************************************************************/ /**
+ * @brief  Get contiguous data at read index without copying, consumer side only
+ *
+ * @param  rbType: Spsc ring buffer type structure pointer
+ * @param  span: Returns start of the data span
+ *
+ * @return Length of the contiguous span, the rest follows from the buffer start
+ *
+*******************************************************************************/
+uint32_t Ring_Buffer_Spsc_Peek_Read_Span(Ring_Buffer_Spsc_Type *rbType, uint8_t **span)
+{
+    uint32_t readIndex = RB_LOAD_RELAXED(&rbType->readIndex);
+    uint32_t writeIndex = RB_LOAD_ACQUIRE(&rbType->writeIndex);
+    uint32_t size = writeIndex - readIndex;
+    uint32_t offset = readIndex & rbType->mask;
+
+    if (size > rbType->mask + 1 - offset) {
+        size = rbType->mask + 1 - offset;
+    }
+
+    *span = &rbType->pointer[offset];
+
+    return size;
+}
+
+/****************************************************************************/ /**
+ * @brief  Release data after Ring_Buffer_Spsc_Peek_Read_Span, consumer side only
+ *
+ * @param  rbType: Spsc ring buffer type structure pointer
+ * @param  length: Length of data to drop
+ *
+ * @return Length of data dropped actually
+ *
+*******************************************************************************/
+uint32_t Ring_Buffer_Spsc_Consume(Ring_Buffer_Spsc_Type *rbType, uint32_t length)
+{
+    uint32_t readIndex = RB_LOAD_RELAXED(&rbType->readIndex);
+    uint32_t writeIndex = RB_LOAD_ACQUIRE(&rbType->writeIndex);
+
+    if (length > writeIndex - readIndex) {
+        length = writeIndex - readIndex;
+    }
+
+    RB_STORE_RELEASE(&rbType->readIndex, readIndex + length);
+
+    return length;
+}
+
+/****************************************************************************/ /**
+ * @brief  Mpsc ring buffer init function
+ *
+ * @param  rbType: Mpsc ring buffer type structure pointer
+ * @param  buffer: Slot memory of RING_BUFFER_MPSC_BUFFER_SIZE(elemSize, elemNum) bytes, 4 byte aligned
+ * @param  elemSize: Size of one element
+ * @param  elemNum: Number of elements, must be power of two
+ *
+ * @return 0 on success, -1 on bad parameter
+ *
+*******************************************************************************/
+int Ring_Buffer_Mpsc_Init(Ring_Buffer_Mpsc_Type *rbType, uint8_t *buffer, uint32_t elemSize, uint32_t elemNum)
+{
+    if (!RB_IS_POWER_OF_TWO(elemNum) || elemSize == 0 || ((uintptr_t)buffer & 3)) {
+        return -1;
+    }
+
+    rbType->pointer = buffer;
+    rbType->elemSize = elemSize;
+    rbType->slotSize = RING_BUFFER_MPSC_SLOT_SIZE(elemSize);
+    rbType->mask = elemNum - 1;
+    rbType->writeIndex = 0;
+    rbType->readIndex = 0;
+
+    /* Slot i is free for the producer that claims index i */
+    for (uint32_t i = 0; i < elemNum; i++) {
+        *Ring_Buffer_Mpsc_Slot(rbType, i) = i;
+    }
+
+    return 0;
+}
+
+/****************************************************************************/ /**
+ * @brief  Mpsc ring buffer push function, safe from any number of tasks and isrs
+ *
+ * @param  rbType: Mpsc ring buffer type structure pointer
+ * @param  elem: Element to copy in, elemSize bytes
+ *
+ * @return 1 if pushed, 0 if ring buffer is full
+ *
+*******************************************************************************/
+uint32_t Ring_Buffer_Mpsc_Push(Ring_Buffer_Mpsc_Type *rbType, const void *elem)
+{
+    uint32_t writeIndex = RB_LOAD_RELAXED(&rbType->writeIndex);
+    uint32_t *slot;
+    int32_t diff;
+
+    while (1) {
+        slot = Ring_Buffer_Mpsc_Slot(rbType, writeIndex);
+        diff = (int32_t)(RB_LOAD_ACQUIRE(slot) - writeIndex);
+
+        if (diff == 0) {
+            /* Slot is free, try to claim it */
+            if (__atomic_compare_exchange_n(&rbType->writeIndex, &writeIndex, writeIndex + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            /* Consumer has not released this slot yet */
+            return 0;
+        } else {
+            /* Another producer claimed it first */
+            writeIndex = RB_LOAD_RELAXED(&rbType->writeIndex);
+        }
+    }
+
+    arch_memcpy_fast(&slot[1], elem, rbType->elemSize);
+
+    /* Hand the slot over to the consumer */
+    RB_STORE_RELEASE(slot, writeIndex + 1);
+
+    return 1;
+}
+
+/****************************************************************************/ /**
+ * @brief  Mpsc ring buffer pop function, consumer side only
+ *
+ * @param  rbType: Mpsc ring buffer type structure pointer
+ * @param  elem: Buffer for element, elemSize bytes
+ *
+ * @return 1 if popped, 0 if ring buffer is empty or the oldest element is still being written
+ *
+*******************************************************************************/
+uint32_t Ring_Buffer_Mpsc_Pop(Ring_Buffer_Mpsc_Type *rbType, void *elem)
+{
+    uint32_t readIndex = rbType->readIndex;
+    uint32_t *slot = Ring_Buffer_Mpsc_Slot(rbType, readIndex);
+
+    if (RB_LOAD_ACQUIRE(slot) != readIndex + 1) {
+        return 0;
+    }
+
+    arch_memcpy_fast(elem, &slot[1], rbType->elemSize);
+
+    /* Give the slot back to producers for the next lap */
+    RB_STORE_RELEASE(slot, readIndex + rbType->mask + 1);
+    rbType->readIndex = readIndex + 1;
+
+    return 1;
+}
+
+/*@} end of group RING_BUFFER_LOCKFREE_Public_Functions */
+
+/*@} end of group RING_BUFFER */
+
+/*@} end of group BL_Common_Component */
@@ -0,0 +1,103 @@
+/**
+ * @file ring_buffer_lockfree.h
+ * @brief
+ *
+ * Copyright (c) 2023 Bouffalolab team
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+#ifndef __RING_BUFFER_LOCKFREE_H__
+#define __RING_BUFFER_LOCKFREE_H__
+
+#include "bflb_core.h"
+
+/** @addtogroup  BL_Common_Component
+ *  @{
+ */
+
+/** @addtogroup  RING_BUFFER
+ *  @{
+ */
+
+/** @defgroup  RING_BUFFER_LOCKFREE_Public_Types
+ *  @{
+ */
+
+/**
+ *  @brief Single producer single consumer byte ring buffer, no lock needed
+ *         between one writer (task or isr) and one reader
+ */
+typedef struct
+{
+    uint8_t *pointer;    /*!< Pointer of ring buffer */
+    uint32_t mask;       /*!< Size of ring buffer minus one, size is power of two */
+    uint32_t writeIndex; /*!< Free running write index, only changed by producer */
+    uint32_t readIndex;  /*!< Free running read index, only changed by consumer */
+} Ring_Buffer_Spsc_Type;
+
+/**
+ *  @brief Multi producer single consumer element ring buffer, producers only
+ *         contend on one compare-and-swap and never wait for each other
+ */
+typedef struct
+{
+    uint8_t *pointer;    /*!< Pointer of slot array */
+    uint32_t elemSize;   /*!< Size of one element */
+    uint32_t slotSize;   /*!< Size of one slot, sequence word and element */
+    uint32_t mask;       /*!< Number of slots minus one, number is power of two */
+    uint32_t writeIndex; /*!< Free running write index, claimed by producers */
+    uint32_t readIndex;  /*!< Free running read index, only changed by consumer */
+} Ring_Buffer_Mpsc_Type;
+
+/*@} end of group RING_BUFFER_LOCKFREE_Public_Types */
+
+/** @defgroup  RING_BUFFER_LOCKFREE_Public_Macros
+ *  @{
+ */
+
+/* Bytes of memory to give Ring_Buffer_Mpsc_Init for elemNum elements of elemSize */
+#define RING_BUFFER_MPSC_SLOT_SIZE(elemSize)            ((sizeof(uint32_t) + (elemSize) + 3) & ~3)
+#define RING_BUFFER_MPSC_BUFFER_SIZE(elemSize, elemNum) (RING_BUFFER_MPSC_SLOT_SIZE(elemSize) * (elemNum))
+
+/*@} end of group RING_BUFFER_LOCKFREE_Public_Macros */
+
+/** @defgroup  RING_BUFFER_LOCKFREE_Public_Functions
+ *  @{
+ */
+int Ring_Buffer_Spsc_Init(Ring_Buffer_Spsc_Type *rbType, uint8_t *buffer, uint32_t size);
+void Ring_Buffer_Spsc_Reset(Ring_Buffer_Spsc_Type *rbType);
+uint32_t Ring_Buffer_Spsc_Write(Ring_Buffer_Spsc_Type *rbType, const uint8_t *data, uint32_t length);
+uint32_t Ring_Buffer_Spsc_Read(Ring_Buffer_Spsc_Type *rbType, uint8_t *data, uint32_t length);
+uint32_t Ring_Buffer_Spsc_Peek(Ring_Buffer_Spsc_Type *rbType, uint8_t *data, uint32_t length);
+uint32_t Ring_Buffer_Spsc_Get_Length(Ring_Buffer_Spsc_Type *rbType);
+uint32_t Ring_Buffer_Spsc_Get_Empty_Length(Ring_Buffer_Spsc_Type *rbType);
+uint32_t Ring_Buffer_Spsc_Reserve_Write(Ring_Buffer_Spsc_Type *rbType, uint8_t **span, uint32_t length);
+uint32_t Ring_Buffer_Spsc_Commit_Write(Ring_Buffer_Spsc_Type *rbType, uint32_t length);
+uint32_t Ring_Buffer_Spsc_Peek_Read_Span(Ring_Buffer_Spsc_Type *rbType, uint8_t **span);
+uint32_t Ring_Buffer_Spsc_Consume(Ring_Buffer_Spsc_Type *rbType, uint32_t length);
+
+int Ring_Buffer_Mpsc_Init(Ring_Buffer_Mpsc_Type *rbType, uint8_t *buffer, uint32_t elemSize, uint32_t elemNum);
+uint32_t Ring_Buffer_Mpsc_Push(Ring_Buffer_Mpsc_Type *rbType, const void *elem);
+uint32_t Ring_Buffer_Mpsc_Pop(Ring_Buffer_Mpsc_Type *rbType, void *elem);
+
+/*@} end of group RING_BUFFER_LOCKFREE_Public_Functions */
+
+/*@} end of group RING_BUFFER */
+
+/*@} end of group BL_Common_Component */
+
+#endif /* __RING_BUFFER_LOCKFREE_H__ */
@@ -7,6 +7,8 @@
 #include "board.h"
 #include "log.h"
 #include "bflb_block_pool.h"
+#include "bflb_slab.h"
+#include "mem.h"
 
 BFLOG_DEFINE_TAG(MAIN, DBG_TAG, true);
 #undef BFLOG_TAG
@@ -17,6 +19,15 @@ BFLOG_DEFINE_TAG(MAIN, DBG_TAG, true);
 static bflb_block_pool_t block_pool;
 __attribute__((aligned(8))) static uint8_t block_pool_memory[BLK_MEMORY_SIZE];
 
+#define BENCH_SLOT_NUM  32
+#define BENCH_ROUNDS    4000
+#define BENCH_POOL_SIZE (32 * 16 + 64 * 16 + 128 * 8 + 256 * 8 + 512 * 4)
+static bflb_slab_t bench_slab;
+__attribute__((aligned(8))) static uint8_t bench_slab_memory[BENCH_POOL_SIZE];
+static const bflb_slab_class_cfg_t bench_slab_cfg[] = {
+    { 32, 16 }, { 64, 16 }, { 128, 8 }, { 256, 8 }, { 512, 4 }
+};
+
 static TaskHandle_t consumer_handle;
 static TaskHandle_t producer_handle;
 
@@ -88,6 +99,107 @@ static void producer_task(void *pvParameters)
     vTaskDelete(NULL);
 }
 
+static inline uint32_t bench_cycle(void)
+{
+    uint32_t cycle;
+
+    __asm volatile("csrr %0, mcycle"
+                   : "=r"(cycle));
+
+    return cycle;
+}
+
+struct bench_stat {
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t cnt;
+};
+
+static void bench_stat_add(struct bench_stat *stat, uint32_t cycle)
+{
+    if (cycle < stat->min) {
+        stat->min = cycle;
+    }
+    if (cycle > stat->max) {
+        stat->max = cycle;
+    }
+    stat->sum += cycle;
+    stat->cnt++;
+}
+
+static void bench_slab_free(void *addr)
+{
+    bflb_slab_free(&bench_slab, addr);
+}
+
+static void *bench_slab_alloc(size_t size)
+{
+    return bflb_slab_alloc(&bench_slab, size);
+}
+
+/* alloc/free latency of the slab against kmalloc, same random size sequence */
+static void bench_run(const char *name, void *(*alloc)(size_t), void (*release)(void *))
+{
+    struct bench_stat alloc_stat = { .min = UINT32_MAX };
+    struct bench_stat free_stat = { .min = UINT32_MAX };
+    void *slot[BENCH_SLOT_NUM] = { NULL };
+    uint32_t seed = 1;
+    uint32_t start;
+    int idx;
+
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        seed = seed * 1103515245 + 12345;
+        idx = (seed >> 16) % BENCH_SLOT_NUM;
+
+        if (slot[idx]) {
+            start = bench_cycle();
+            release(slot[idx]);
+            bench_stat_add(&free_stat, bench_cycle() - start);
+            slot[idx] = NULL;
+        } else {
+            start = bench_cycle();
+            slot[idx] = alloc(16 + ((seed >> 8) % 497));
+            bench_stat_add(&alloc_stat, bench_cycle() - start);
+        }
+    }
+
+    for (int i = 0; i < BENCH_SLOT_NUM; i++) {
+        if (slot[i]) {
+            release(slot[i]);
+        }
+    }
+
+    LOG_I("[%-6s] alloc cycles min %4lu avg %4lu max %6lu, free cycles min %4lu avg %4lu max %6lu\r\n", name,
+          alloc_stat.min, (uint32_t)(alloc_stat.sum / alloc_stat.cnt), alloc_stat.max,
+          free_stat.min, (uint32_t)(free_stat.sum / free_stat.cnt), free_stat.max);
+}
+
+static void bench_task(void *pvParameters)
+{
+    bflb_slab_info_t info;
+
+    _ASSERT_FUNC(0 == bflb_slab_create(&bench_slab, bench_slab_cfg, sizeof(bench_slab_cfg) / sizeof(bench_slab_cfg[0]),
+                                       BFLB_BLOCK_POOL_ALIGN_8, bench_slab_memory, BENCH_POOL_SIZE));
+    _ASSERT_FUNC(0 == bflb_slab_add_fallback(&bench_slab, kmalloc, kfree));
+
+    vTaskDelay(2000);
+
+    while (1) {
+        bench_run("slab", bench_slab_alloc, bench_slab_free);
+        bench_run("kmalloc", kmalloc, kfree);
+
+        for (uint32_t i = 0; i < bench_slab.cls_num; i++) {
+            bflb_slab_info_get(&bench_slab, i, &info);
+            LOG_I("class %3lu: total %2lu free %2lu high-water %2lu alloc %6lu spill %6lu\r\n", info.blk_size,
+                  info.blk_total, info.blk_free, info.high_water, info.alloc_cnt, info.fail_cnt);
+        }
+        LOG_I("fallback to kmalloc %lu times\r\n", bench_slab.fallback_cnt);
+
+        vTaskDelay(5000);
+    }
+}
+
 SemaphoreHandle_t sem;
 SemaphoreHandle_t mtx;
 
@@ -143,6 +255,8 @@ int main(void)
     xTaskCreate(consumer_task, (char *)"consumer_task", 512, NULL, configMAX_PRIORITIES - 2, &consumer_handle);
     LOG_I("Starting producer task...\r\n");
     xTaskCreate(producer_task, (char *)"producer_task", 512, NULL, configMAX_PRIORITIES - 3, &producer_handle);
+    LOG_I("Starting bench task...\r\n");
+    xTaskCreate(bench_task, (char *)"bench_task", 1024, NULL, configMAX_PRIORITIES - 4, NULL);
 
 #ifdef CONFIG_BFLOG
     log_restart();
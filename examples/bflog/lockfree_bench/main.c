@@ -0,0 +1,183 @@
+#include <stdlib.h>
+#include <FreeRTOS.h>
+#include "task.h"
+#include "semphr.h"
+#include "bflb_mtimer.h"
+#include "board.h"
+#include "bflog.h"
+
+#define DBG_TAG "MAIN"
+#include "log.h"
+
+#define BENCH_POOL_SIZE    4096
+#define BENCH_PRODUCER_MAX 8
+#define BENCH_MSG_NUM      500
+
+BFLOG_DEFINE_TAG(BENCH, "bench", true);
+
+#undef BFLOG_TAG
+#define BFLOG_TAG BFLOG_GET_TAG(BENCH)
+
+static bflog_t bench_recorder;
+static bflog_direct_stream_t bench_stream;
+static uint64_t bench_pool[BENCH_POOL_SIZE / 8];
+
+static uint32_t bench_latency[BENCH_PRODUCER_MAX * BENCH_MSG_NUM];
+static volatile uint32_t bench_output;
+
+static SemaphoreHandle_t sem_done = NULL;
+static SemaphoreHandle_t sem_bench = NULL;
+static TaskHandle_t consumer_handle = NULL;
+
+static inline uint32_t bench_cycle(void)
+{
+    uint32_t cycle;
+    __asm volatile("csrr %0, mcycle"
+                   : "=r"(cycle));
+    return cycle;
+}
+
+static int bench_enter_critical(void)
+{
+    return (pdTRUE == xSemaphoreTake(sem_bench, portMAX_DELAY)) ? 0 : -1;
+}
+
+static int bench_exit_critical(void)
+{
+    xSemaphoreGive(sem_bench);
+    return 0;
+}
+
+static int bench_flush_notice(void)
+{
+    xTaskNotifyGive(consumer_handle);
+    return 0;
+}
+
+/* discard output, only the recorder and queue cost is measured */
+static uint16_t bench_stream_output(void *ptr, uint16_t size)
+{
+    bench_output++;
+    return size;
+}
+
+static int bench_compare(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void consumer_task(void *pvParameters)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        bflog_flush(&bench_recorder);
+    }
+}
+
+static void producer_task(void *pvParameters)
+{
+    uint32_t id = (uint32_t)(uintptr_t)pvParameters;
+    uint32_t *latency = &bench_latency[id * BENCH_MSG_NUM];
+    uint32_t start;
+
+    for (uint32_t i = 0; i < BENCH_MSG_NUM; i++) {
+        start = bench_cycle();
+        BFLOG_I(&bench_recorder, "producer %u msg %u value 0x%08x\r\n", id, i, start);
+        latency[i] = bench_cycle() - start;
+    }
+
+    xSemaphoreGive(sem_done);
+    vTaskDelete(NULL);
+}
+
+static void bench_run(uint8_t mode, const char *name, uint32_t producers)
+{
+    uint32_t total = producers * BENCH_MSG_NUM;
+    uint64_t start_us;
+    uint64_t cost_us;
+
+    bflog_suspend(&bench_recorder);
+    bflog_control(&bench_recorder, BFLOG_CMD_MODE, mode);
+    bflog_control(&bench_recorder, BFLOG_CMD_QUEUE_RST, 0);
+    bench_recorder.drop.full = 0;
+    bench_recorder.drop.rate = 0;
+    bench_recorder.drop.report = 0;
+    bench_output = 0;
+    bflog_resume(&bench_recorder);
+
+    start_us = bflb_mtimer_get_time_us();
+    for (uint32_t i = 0; i < producers; i++) {
+        xTaskCreate(producer_task, (char *)"producer", 512, (void *)(uintptr_t)i, configMAX_PRIORITIES - 3, NULL);
+    }
+    for (uint32_t i = 0; i < producers; i++) {
+        xSemaphoreTake(sem_done, portMAX_DELAY);
+    }
+    cost_us = bflb_mtimer_get_time_us() - start_us;
+
+    /* let the consumer drain the tail before reading counters */
+    vTaskDelay(50);
+
+    qsort(bench_latency, total, sizeof(uint32_t), bench_compare);
+
+    LOG_I("[%-8s] %u producers, %llu calls/s, p50 %u p99 %u max %u cycles, output %u, drop full %u rate %u\r\n",
+          name, producers,
+          (uint64_t)total * 1000000 / (cost_us ? cost_us : 1),
+          bench_latency[total / 2],
+          bench_latency[total * 99 / 100],
+          bench_latency[total - 1],
+          bench_output,
+          bench_recorder.drop.full,
+          bench_recorder.drop.rate);
+}
+
+static void bench_task(void *pvParameters)
+{
+    vTaskDelay(100);
+
+    while (1) {
+        for (uint32_t producers = 1; producers <= BENCH_PRODUCER_MAX; producers <<= 1) {
+            bench_run(BFLOG_MODE_ASYNC, "locked", producers);
+            bench_run(BFLOG_MODE_ASYNC | BFLOG_MODE_LOCKFREE, "lockfree", producers);
+        }
+
+        /* 50 msg per second on the bench tag, the rest is counted as rate drop */
+        bflog_rate_limit("bench", 50);
+        bench_run(BFLOG_MODE_ASYNC | BFLOG_MODE_LOCKFREE, "ratelim", BENCH_PRODUCER_MAX);
+        bflog_rate_limit("bench", 0);
+
+        vTaskDelay(3000);
+    }
+}
+
+int main(void)
+{
+    board_init();
+
+    sem_done = xSemaphoreCreateCounting(BENCH_PRODUCER_MAX, 0);
+    sem_bench = xSemaphoreCreateMutex();
+    if ((sem_done == NULL) || (sem_bench == NULL)) {
+        LOG_E("Create sem fail\r\n");
+    }
+
+    bflog_create(&bench_recorder, bench_pool, BENCH_POOL_SIZE, BFLOG_MODE_ASYNC);
+    bflog_control(&bench_recorder, BFLOG_CMD_ENTER_CRITICAL, (uint32_t)bench_enter_critical);
+    bflog_control(&bench_recorder, BFLOG_CMD_EXIT_CRITICAL, (uint32_t)bench_exit_critical);
+    bflog_control(&bench_recorder, BFLOG_CMD_FLUSH_NOTICE, (uint32_t)bench_flush_notice);
+
+    bflog_direct_create((void *)&bench_stream, BFLOG_DIRECT_TYPE_STREAM, BFLOG_DIRECT_COLOR_DISABLE, NULL, NULL);
+    bflog_direct_init_stream((void *)&bench_stream, bench_stream_output);
+    bflog_append(&bench_recorder, (void *)&bench_stream);
+    bflog_direct_resume((void *)&bench_stream);
+    bflog_resume(&bench_recorder);
+
+    xTaskCreate(consumer_task, (char *)"consumer", 1024, NULL, configMAX_PRIORITIES - 3, &consumer_handle);
+    xTaskCreate(bench_task, (char *)"bench", 1024, NULL, configMAX_PRIORITIES - 2, NULL);
+
+    vTaskStartScheduler();
+
+    while (1) {
+    }
+}
@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include "bflb_mtimer.h"
+#include "board.h"
+#include "bflb_mtd.h"
+#include "easyflash.h"
+
+#define BENCH_ROUND_NUM 5
+#define BENCH_TXN_NUM   32
+#define BENCH_CHURN_NUM 2000
+
+static const uint32_t bench_key_num[BENCH_ROUND_NUM] = { 16, 64, 128, 256, 384 };
+static uint32_t bench_txn_buf[1024];
+
+static bool bench_scan_cb(env_node_obj_t env, void *arg1, void *arg2)
+{
+    /* never stop, same as a lookup miss without index */
+    return false;
+}
+
+static uint64_t bench_lookup(const char *prefix, uint32_t num, uint32_t *found)
+{
+    char key[32];
+    uint32_t value;
+    uint64_t start_us;
+
+    *found = 0;
+    start_us = bflb_mtimer_get_time_us();
+    for (uint32_t i = 0; i < num; i++) {
+        snprintf(key, sizeof(key), "%s.%u", prefix, i);
+        if (ef_get_env_blob(key, &value, sizeof(value), NULL) == sizeof(value)) {
+            (*found)++;
+        }
+    }
+
+    return (bflb_mtimer_get_time_us() - start_us) / num;
+}
+
+/* update BENCH_TXN_NUM keys one by one, then in one transaction */
+static void bench_txn(void)
+{
+    char key[32];
+    ef_txn txn;
+    uint64_t single_us, txn_us, start_us;
+
+    start_us = bflb_mtimer_get_time_us();
+    for (uint32_t i = 0; i < BENCH_TXN_NUM; i++) {
+        snprintf(key, sizeof(key), "bench.%u", i);
+        ef_set_env_blob(key, &start_us, sizeof(start_us));
+    }
+    single_us = bflb_mtimer_get_time_us() - start_us;
+
+    start_us = bflb_mtimer_get_time_us();
+    ef_txn_begin(&txn, bench_txn_buf, sizeof(bench_txn_buf));
+    for (uint32_t i = 0; i < BENCH_TXN_NUM; i++) {
+        snprintf(key, sizeof(key), "bench.%u", i);
+        ef_txn_set_env_blob(&txn, key, &start_us, sizeof(start_us));
+    }
+    if (ef_txn_commit(&txn) != EF_NO_ERR) {
+        printf("txn commit failed\r\n");
+    }
+    txn_us = bflb_mtimer_get_time_us() - start_us;
+
+    printf("%u keys update: single %llu us, txn %llu us\r\n", BENCH_TXN_NUM, single_us, txn_us);
+}
+
+/* update random keys, the GC step runs between two sets as the idle hook does */
+static void bench_gc(bool step)
+{
+    char key[32];
+    uint32_t value[8] = { 0 };
+    uint64_t start_us, cost_us, set_max_us = 0, set_total_us = 0, step_max_us = 0;
+
+    for (uint32_t i = 0; i < BENCH_CHURN_NUM; i++) {
+        snprintf(key, sizeof(key), "bench.%u", (unsigned)(rand() % 64));
+        value[0] = i;
+        start_us = bflb_mtimer_get_time_us();
+        ef_set_env_blob(key, value, sizeof(value));
+        cost_us = bflb_mtimer_get_time_us() - start_us;
+        set_total_us += cost_us;
+        if (cost_us > set_max_us) {
+            set_max_us = cost_us;
+        }
+
+        if (step) {
+            start_us = bflb_mtimer_get_time_us();
+            ef_env_gc_step(1);
+            cost_us = bflb_mtimer_get_time_us() - start_us;
+            if (cost_us > step_max_us) {
+                step_max_us = cost_us;
+            }
+        }
+    }
+
+    printf("%u sets %s gc step: avg %llu us, max %llu us, gc step max %llu us\r\n", BENCH_CHURN_NUM,
+           step ? "with" : "without", set_total_us / BENCH_CHURN_NUM, set_max_us, step_max_us);
+}
+
+int main(void)
+{
+    char key[32];
+    uint32_t num = 0;
+    uint32_t found;
+    uint64_t hit_us, miss_us, scan_us, load_us, start_us;
+
+    board_init();
+
+    bflb_mtd_init();
+    easyflash_init();
+
+    /* start from an empty PSM */
+    ef_env_set_default();
+    ef_load_env();
+
+    for (uint32_t round = 0; round < BENCH_ROUND_NUM; round++) {
+        for (; num < bench_key_num[round]; num++) {
+            snprintf(key, sizeof(key), "bench.%u", num);
+            if (ef_set_env_blob(key, &num, sizeof(num)) != EF_NO_ERR) {
+                printf("ENV full at %u keys\r\n", num);
+                goto __exit;
+            }
+        }
+
+        hit_us = bench_lookup("bench", num, &found);
+        miss_us = bench_lookup("miss", num, &found);
+
+        start_us = bflb_mtimer_get_time_us();
+        ef_print_env_cb(bench_scan_cb);
+        scan_us = bflb_mtimer_get_time_us() - start_us;
+
+        start_us = bflb_mtimer_get_time_us();
+        ef_load_env();
+        load_us = bflb_mtimer_get_time_us() - start_us;
+
+        bench_lookup("bench", num, &found);
+        printf("%3u keys: hit %llu us, miss %llu us, full scan %llu us, load %llu us, found %u/%u\r\n",
+               num, hit_us, miss_us, scan_us, load_us, found, num);
+    }
+
+    bench_txn();
+    bench_gc(false);
+    bench_gc(true);
+
+__exit:
+    printf("easyflash bench done\r\n");
+    while (1) {
+    }
+}
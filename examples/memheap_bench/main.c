@@ -0,0 +1,144 @@
+#include <FreeRTOS.h>
+#include "semphr.h"
+#include "bflb_mtimer.h"
+#include "board.h"
+#include "mem.h"
+
+#define DBG_TAG "MAIN"
+#include "log.h"
+
+#define BENCH_TASK_NUM 4
+#define BENCH_SLOT_NUM 32
+#define BENCH_OPS      20000
+
+struct bench_ops {
+    const char *name;
+    void *(*alloc)(size_t size);
+    void (*release)(void *ptr);
+};
+
+static SemaphoreHandle_t sem_done = NULL;
+static SemaphoreHandle_t sem_start = NULL;
+static const struct bench_ops *cur_ops;
+static struct meminfo peak_info;
+
+static void *heap_alloc(size_t size)
+{
+    return bflb_malloc(KMEM_HEAP, size);
+}
+
+static void heap_release(void *ptr)
+{
+    bflb_free(KMEM_HEAP, ptr);
+}
+
+static const struct bench_ops bench_ops_tab[] = {
+    { "tlsf", heap_alloc, heap_release },
+    { "cache", kmalloc, kfree },
+};
+
+static void bench_task(void *pvParameters)
+{
+    uint32_t seed = (uint32_t)(uintptr_t)pvParameters * 2654435761u + 1;
+    void *slot[BENCH_SLOT_NUM];
+    struct meminfo info;
+
+    while (1) {
+        xSemaphoreTake(sem_start, portMAX_DELAY);
+
+        memset(slot, 0, sizeof(slot));
+
+        for (int i = 0; i < BENCH_OPS; i++) {
+            seed = seed * 1103515245 + 12345;
+            int idx = (seed >> 16) % BENCH_SLOT_NUM;
+
+            if (slot[idx]) {
+                cur_ops->release(slot[idx]);
+                slot[idx] = NULL;
+            } else {
+                /* 32~512 bytes, the typical wifi/lwip/audio buffer sizes */
+                slot[idx] = cur_ops->alloc(32 + ((seed >> 8) % 481));
+            }
+        }
+
+        bflb_mem_usage(KMEM_HEAP, &info);
+        taskENTER_CRITICAL();
+        if (peak_info.max_free_size == 0 || info.max_free_size < peak_info.max_free_size) {
+            peak_info = info;
+        }
+        taskEXIT_CRITICAL();
+
+        for (int i = 0; i < BENCH_SLOT_NUM; i++) {
+            if (slot[i]) {
+                cur_ops->release(slot[i]);
+            }
+        }
+
+        xSemaphoreGive(sem_done);
+    }
+}
+
+static void bench_run(const struct bench_ops *ops)
+{
+    uint64_t start_us;
+    uint64_t cost_us;
+
+    cur_ops = ops;
+    memset(&peak_info, 0, sizeof(peak_info));
+
+    start_us = bflb_mtimer_get_time_us();
+    for (int i = 0; i < BENCH_TASK_NUM; i++) {
+        xSemaphoreGive(sem_start);
+    }
+    for (int i = 0; i < BENCH_TASK_NUM; i++) {
+        xSemaphoreTake(sem_done, portMAX_DELAY);
+    }
+    cost_us = bflb_mtimer_get_time_us() - start_us;
+
+    LOG_I("[%-5s] %d tasks, %d ops in %llu us, %llu ops/sec\r\n", ops->name,
+          BENCH_TASK_NUM, BENCH_TASK_NUM * BENCH_OPS, cost_us,
+          (uint64_t)BENCH_TASK_NUM * BENCH_OPS * 1000000 / (cost_us ? cost_us : 1));
+    LOG_I("[%-5s] under load: free %d, free node %d, max free block %d\r\n", ops->name,
+          peak_info.free_size, peak_info.free_node, peak_info.max_free_size);
+}
+
+static void bench_main_task(void *pvParameters)
+{
+    struct mem_cache_info cinfo;
+
+    vTaskDelay(100);
+
+    while (1) {
+        bench_run(&bench_ops_tab[0]);
+        bench_run(&bench_ops_tab[1]);
+
+        bflb_mem_cache_usage(&g_kmemcache, &cinfo);
+        LOG_I("[cache] hit %u, miss %u, parked %u bytes\r\n",
+              (unsigned int)cinfo.hit, (unsigned int)cinfo.miss, (unsigned int)cinfo.cached_size);
+        bflb_mem_cache_flush(&g_kmemcache);
+
+        vTaskDelay(3000);
+    }
+}
+
+int main(void)
+{
+    board_init();
+
+    sem_start = xSemaphoreCreateCounting(BENCH_TASK_NUM, 0);
+    sem_done = xSemaphoreCreateCounting(BENCH_TASK_NUM, 0);
+
+    if (sem_start == NULL || sem_done == NULL) {
+        LOG_E("Create sem fail\r\n");
+    }
+
+    for (int i = 0; i < BENCH_TASK_NUM; i++) {
+        xTaskCreate(bench_task, (char *)"bench_task", 512, (void *)(uintptr_t)i, configMAX_PRIORITIES - 3, NULL);
+    }
+    xTaskCreate(bench_main_task, (char *)"bench_main", 512, NULL, configMAX_PRIORITIES - 2, NULL);
+
+    vTaskStartScheduler();
+
+    while (1) {
+    }
+}
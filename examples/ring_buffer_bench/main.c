@@ -0,0 +1,293 @@
+#include <FreeRTOS.h>
+#include "semphr.h"
+#include "bflb_mtimer.h"
+#include "board.h"
+#include "ring_buffer.h"
+#include "ring_buffer_lockfree.h"
+
+#define DBG_TAG "MAIN"
+#include "log.h"
+
+#define BENCH_BUF_SIZE      1024
+#define BENCH_STREAM_BYTES  (1024 * 1024)
+#define BENCH_CHUNK         61
+#define BENCH_PRODUCER_NUM  4
+#define BENCH_ELEM_NUM      64
+#define BENCH_ELEM_PER_TASK 20000
+
+struct bench_elem {
+    uint32_t producer;
+    uint32_t seq;
+};
+
+static uint8_t stream_buf[BENCH_BUF_SIZE];
+static uint8_t elem_buf[RING_BUFFER_MPSC_BUFFER_SIZE(sizeof(struct bench_elem), BENCH_ELEM_NUM)] __attribute__((aligned(4)));
+
+static Ring_Buffer_Type locked_rb;
+static Ring_Buffer_Spsc_Type spsc_rb;
+static Ring_Buffer_Mpsc_Type mpsc_rb;
+
+static SemaphoreHandle_t sem_done = NULL;
+static volatile int stream_mode;
+
+static void bench_lock(void)
+{
+    taskENTER_CRITICAL();
+}
+
+static void bench_unlock(void)
+{
+    taskEXIT_CRITICAL();
+}
+
+static uint32_t stream_write(const uint8_t *data, uint32_t len)
+{
+    if (stream_mode == 0) {
+        return Ring_Buffer_Write(&locked_rb, data, len);
+    } else {
+        return Ring_Buffer_Spsc_Write(&spsc_rb, data, len);
+    }
+}
+
+static uint32_t stream_read(uint8_t *data, uint32_t len)
+{
+    if (stream_mode == 0) {
+        return Ring_Buffer_Read(&locked_rb, data, len);
+    } else {
+        return Ring_Buffer_Spsc_Read(&spsc_rb, data, len);
+    }
+}
+
+/* zero-copy variant: data is produced and checked in place in the spsc buffer */
+static void span_producer(void)
+{
+    uint32_t sent = 0;
+    uint8_t *span;
+    uint32_t n;
+
+    while (sent < BENCH_STREAM_BYTES) {
+        n = Ring_Buffer_Spsc_Reserve_Write(&spsc_rb, &span, BENCH_STREAM_BYTES - sent);
+        if (n == 0) {
+            taskYIELD();
+            continue;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            span[i] = (uint8_t)(sent + i);
+        }
+        Ring_Buffer_Spsc_Commit_Write(&spsc_rb, n);
+        sent += n;
+    }
+}
+
+static uint32_t span_consumer(void)
+{
+    uint32_t recv = 0;
+    uint32_t errors = 0;
+    uint8_t *span;
+    uint32_t n;
+
+    while (recv < BENCH_STREAM_BYTES) {
+        n = Ring_Buffer_Spsc_Peek_Read_Span(&spsc_rb, &span);
+        if (n == 0) {
+            taskYIELD();
+            continue;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            if (span[i] != (uint8_t)(recv + i)) {
+                errors++;
+            }
+        }
+        Ring_Buffer_Spsc_Consume(&spsc_rb, n);
+        recv += n;
+    }
+
+    return errors;
+}
+
+static void stream_producer_task(void *pvParameters)
+{
+    uint8_t chunk[BENCH_CHUNK];
+    uint32_t sent = 0;
+    uint32_t len;
+    uint32_t done;
+
+    if (stream_mode == 2) {
+        span_producer();
+        sent = BENCH_STREAM_BYTES;
+    }
+
+    while (sent < BENCH_STREAM_BYTES) {
+        len = BENCH_STREAM_BYTES - sent;
+        if (len > sizeof(chunk)) {
+            len = sizeof(chunk);
+        }
+        for (uint32_t i = 0; i < len; i++) {
+            chunk[i] = (uint8_t)(sent + i);
+        }
+
+        done = 0;
+        while (done < len) {
+            uint32_t n = stream_write(&chunk[done], len - done);
+            if (n == 0) {
+                taskYIELD();
+            }
+            done += n;
+        }
+        sent += len;
+    }
+
+    xSemaphoreGive(sem_done);
+    vTaskDelete(NULL);
+}
+
+static void stream_consumer_task(void *pvParameters)
+{
+    uint8_t chunk[BENCH_CHUNK + 6];
+    uint32_t recv = 0;
+    uint32_t errors = 0;
+    uint32_t n;
+
+    if (stream_mode == 2) {
+        errors = span_consumer();
+        recv = BENCH_STREAM_BYTES;
+    }
+
+    while (recv < BENCH_STREAM_BYTES) {
+        n = stream_read(chunk, sizeof(chunk));
+        if (n == 0) {
+            taskYIELD();
+            continue;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            if (chunk[i] != (uint8_t)(recv + i)) {
+                errors++;
+            }
+        }
+        recv += n;
+    }
+
+    if (errors) {
+        LOG_E("stream mode %d: %u corrupted bytes\r\n", stream_mode, (unsigned int)errors);
+    }
+
+    xSemaphoreGive(sem_done);
+    vTaskDelete(NULL);
+}
+
+static void mpsc_producer_task(void *pvParameters)
+{
+    struct bench_elem elem = { .producer = (uint32_t)(uintptr_t)pvParameters };
+
+    for (elem.seq = 0; elem.seq < BENCH_ELEM_PER_TASK; elem.seq++) {
+        while (!Ring_Buffer_Mpsc_Push(&mpsc_rb, &elem)) {
+            taskYIELD();
+        }
+    }
+
+    xSemaphoreGive(sem_done);
+    vTaskDelete(NULL);
+}
+
+static void mpsc_consumer_task(void *pvParameters)
+{
+    uint32_t next[BENCH_PRODUCER_NUM] = { 0 };
+    uint32_t errors = 0;
+    struct bench_elem elem;
+
+    for (uint32_t got = 0; got < BENCH_PRODUCER_NUM * BENCH_ELEM_PER_TASK;) {
+        if (!Ring_Buffer_Mpsc_Pop(&mpsc_rb, &elem)) {
+            taskYIELD();
+            continue;
+        }
+        /* per-producer order must be kept */
+        if (elem.producer >= BENCH_PRODUCER_NUM || elem.seq != next[elem.producer]) {
+            errors++;
+        } else {
+            next[elem.producer]++;
+        }
+        got++;
+    }
+
+    if (errors) {
+        LOG_E("mpsc: %u out of order elements\r\n", (unsigned int)errors);
+    }
+
+    xSemaphoreGive(sem_done);
+    vTaskDelete(NULL);
+}
+
+static void bench_stream(int mode, const char *name)
+{
+    uint64_t start_us;
+    uint64_t cost_us;
+
+    stream_mode = mode;
+    Ring_Buffer_Reset(&locked_rb);
+    Ring_Buffer_Spsc_Reset(&spsc_rb);
+
+    start_us = bflb_mtimer_get_time_us();
+    xTaskCreate(stream_consumer_task, (char *)"consumer", 512, NULL, configMAX_PRIORITIES - 3, NULL);
+    xTaskCreate(stream_producer_task, (char *)"producer", 512, NULL, configMAX_PRIORITIES - 3, NULL);
+    xSemaphoreTake(sem_done, portMAX_DELAY);
+    xSemaphoreTake(sem_done, portMAX_DELAY);
+    cost_us = bflb_mtimer_get_time_us() - start_us;
+
+    LOG_I("[%-6s] %u bytes in %llu us, %llu KB/s\r\n", name, BENCH_STREAM_BYTES, cost_us,
+          (uint64_t)BENCH_STREAM_BYTES * 1000000 / 1024 / (cost_us ? cost_us : 1));
+}
+
+static void bench_mpsc(void)
+{
+    uint64_t start_us;
+    uint64_t cost_us;
+
+    Ring_Buffer_Mpsc_Init(&mpsc_rb, elem_buf, sizeof(struct bench_elem), BENCH_ELEM_NUM);
+
+    start_us = bflb_mtimer_get_time_us();
+    xTaskCreate(mpsc_consumer_task, (char *)"consumer", 512, NULL, configMAX_PRIORITIES - 3, NULL);
+    for (int i = 0; i < BENCH_PRODUCER_NUM; i++) {
+        xTaskCreate(mpsc_producer_task, (char *)"producer", 512, (void *)(uintptr_t)i, configMAX_PRIORITIES - 3, NULL);
+    }
+    for (int i = 0; i < BENCH_PRODUCER_NUM + 1; i++) {
+        xSemaphoreTake(sem_done, portMAX_DELAY);
+    }
+    cost_us = bflb_mtimer_get_time_us() - start_us;
+
+    LOG_I("[mpsc  ] %d producers, %u elements in %llu us, %llu elem/s\r\n", BENCH_PRODUCER_NUM,
+          BENCH_PRODUCER_NUM * BENCH_ELEM_PER_TASK, cost_us,
+          (uint64_t)BENCH_PRODUCER_NUM * BENCH_ELEM_PER_TASK * 1000000 / (cost_us ? cost_us : 1));
+}
+
+static void bench_task(void *pvParameters)
+{
+    vTaskDelay(100);
+
+    while (1) {
+        bench_stream(0, "locked");
+        bench_stream(1, "spsc");
+        bench_stream(2, "span");
+        bench_mpsc();
+
+        vTaskDelay(3000);
+    }
+}
+
+int main(void)
+{
+    board_init();
+
+    sem_done = xSemaphoreCreateCounting(BENCH_PRODUCER_NUM + 1, 0);
+    if (sem_done == NULL) {
+        LOG_E("Create sem fail\r\n");
+    }
+
+    Ring_Buffer_Init(&locked_rb, stream_buf, sizeof(stream_buf), bench_lock, bench_unlock);
+    Ring_Buffer_Spsc_Init(&spsc_rb, stream_buf, sizeof(stream_buf));
+
+    xTaskCreate(bench_task, (char *)"bench", 512, NULL, configMAX_PRIORITIES - 2, NULL);
+
+    vTaskStartScheduler();
+
+    while (1) {
+    }
+}